@@ -33,16 +33,24 @@ dccrg::Dccrg for a starting point in the API.
 
 #include "algorithm"
 #include "array"
+#include "atomic"
+#include "chrono"
+#include "cmath"
 #include "cstdint"
 #include "cstdio"
 #include "cstdlib"
+#include "cstring"
 #include "fstream"
 #include "functional"
 #include "iterator"
 #include "limits"
 #include "map"
+#include "memory"
+#include "mutex"
+#include "ostream"
 #include "set"
 #include "stdexcept"
+#include "thread"
 #include "tuple"
 #include "utility"
 #include "unordered_map"
@@ -69,10 +77,15 @@ MPI_UNSIGNED_LONG in the following:
 #endif
 
 
+#include "dccrg_cell_directory.hpp"
+#include "dccrg_checkpoint_codec.hpp"
+#include "dccrg_checksum.hpp"
+#include "dccrg_cell_storage.hpp"
 #include "dccrg_get_cell_datatype.hpp"
 #include "dccrg_no_geometry.hpp"
 #include "dccrg_mapping.hpp"
 #include "dccrg_mpi_support.hpp"
+#include "dccrg_thread_pool.hpp"
 #include "dccrg_topology.hpp"
 #include "dccrg_types.hpp"
 
@@ -147,7 +160,8 @@ template <
 	class Cell_Data,
 	class Geometry = No_Geometry,
 	class Additional_Cell_Items = std::tuple<>,
-	class Additional_Neighbor_Items = std::tuple<>
+	class Additional_Neighbor_Items = std::tuple<>,
+	class Cell_Storage = Unordered_Cell_Storage
 > class Dccrg;
 
 /*!
@@ -199,21 +213,32 @@ If needed, the arguments to get_mpi_datatype() provide additional information:
 
 Geometry class decides the physical size, shape, etc of the grid.
 
+Cell_Storage class decides how cell data is stored, by default in
+std::unordered_map (Unordered_Cell_Storage). With Contiguous_Cell_Storage
+local cells and copies of remote neighbors are stored in arrays
+ordered along a space-filling curve, which makes iterating over
+cells faster but moves cells' data when cells are added or removed.
+
 \see Dccrg() to instantiate a new grid object.
 */
 template <
 	class Cell_Data,
 	class Geometry,
 	class... Additional_Cell_Items,
-	class... Additional_Neighbor_Items
+	class... Additional_Neighbor_Items,
+	class Cell_Storage
 > class Dccrg<
 	Cell_Data,
 	Geometry,
 	std::tuple<Additional_Cell_Items...>,
-	std::tuple<Additional_Neighbor_Items...>
+	std::tuple<Additional_Neighbor_Items...>,
+	Cell_Storage
 > {
 
 private:
+	// items of local_cells etc., defined with them
+	struct Cells_Item;
+
 	/*!
 	Read-write version of topology for internal use.
 	*/
@@ -289,6 +314,15 @@ public:
 	*/
 	typedef typename std::pair<const uint64_t&, const Cell_Data&> cell_and_data_pair_t;
 
+	/*!
+	Container of cells and their data given by the Cell_Storage template parameter.
+	\see
+	get_cell_data()
+	Unordered_Cell_Storage
+	Contiguous_Cell_Storage
+	*/
+	typedef typename Cell_Storage::template container<Cell_Data> cell_data_container_t;
+
 	/*!
 	Creates an uninitialized instance of dccrg.
 
@@ -304,7 +338,7 @@ public:
 	in the examples directory.
 
 	set_initial_length()
-	Dccrg(const Dccrg<Other_Cell_Data, Other_Geometry>& other)
+	Dccrg(const Dccrg<Other_Cell_Data, Other_Geometry, ..., Other_Cell_Storage>& other)
 	*/
 	Dccrg():geometry_rw(length, mapping, topology){}
 
@@ -315,7 +349,7 @@ public:
 	Call this with all processes unless you really know what you are doing.
 	Must not be used while the instance being copied is updating remote
 	neighbor data or balancing the load.
-	The Cell_Data class can differ between the two grids.
+	The Cell_Data class and Cell_Storage can differ between the two grids.
 	The geometry of this grid must be compatible with the other
 	grid's geometry (it must have a copy contructor taking the
 	other grid's geometry as an argument).
@@ -329,8 +363,17 @@ public:
 	*/
 	template<
 		class Other_Cell_Data,
-		class Other_Geometry
-	> Dccrg(const Dccrg<Other_Cell_Data, Other_Geometry>& other) :
+		class Other_Geometry,
+		class Other_Cell_Storage
+	> Dccrg(
+		const Dccrg<
+			Other_Cell_Data,
+			Other_Geometry,
+			std::tuple<>,
+			std::tuple<>,
+			Other_Cell_Storage
+		>& other
+	) :
 		topology_rw(other.topology),
 		mapping_rw(other.mapping),
 		geometry_rw(length, mapping, topology),
@@ -350,6 +393,8 @@ public:
 		user_neigh_of(other.get_all_user_neigh_of()),
 		user_neigh_to(other.get_all_user_neigh_to()),
 		cell_process(other.get_cell_process()),
+		distributed_ownership(other.get_distributed_ownership()),
+		cell_directory(other.get_cell_directory()),
 		local_cells_on_process_boundary(other.get_local_cells_on_process_boundary_internal()),
 		remote_cells_on_process_boundary(other.get_remote_cells_on_process_boundary_internal()),
 		user_local_cells_on_process_boundary(other.get_user_local_cells_on_process_boundary()),
@@ -365,6 +410,7 @@ public:
 		no_load_balancing(other.get_no_load_balancing()),
 		reserved_options(other.get_reserved_options()),
 		cell_weights(other.get_cell_weights()),
+		additional_cell_weights(other.get_additional_cell_weights()),
 		neighbor_processes(other.get_neighbor_processes()),
 		balancing_load(other.get_balancing_load())
 	{
@@ -389,19 +435,61 @@ public:
 			abort();
 		}
 
+		if (MPI_Comm_dup(this->comm, &this->some_to_some_comm) != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't duplicate communicator while copy constructing"
+				<< std::endl;
+			abort();
+		}
+
 		this->zoltan = Zoltan_Copy(other.get_zoltan());
+		this->incremental_iterator_updates = other.get_incremental_iterator_updates();
+		this->neighbor_refine_propagation = other.get_neighbor_refine_propagation();
+		this->persistent_remote_neighbor_updates = other.get_persistent_remote_neighbor_updates();
+		this->packed_remote_neighbor_updates = other.get_packed_remote_neighbor_updates();
+		this->neighbor_collective_hoods = other.get_neighbor_collective_hoods();
+		this->save_aggregators = other.get_save_aggregators();
+		this->save_stripe_size = other.get_save_stripe_size();
+		this->checkpoint_codec = other.get_checkpoint_codec();
+		this->checkpoint_block_size = other.get_checkpoint_block_size();
+		this->delta_checkpoints = other.get_delta_checkpoints();
+		this->checkpoint_checksums = other.get_checkpoint_checksums();
+		this->checkpoint_checksum_readback = other.get_checkpoint_checksum_readback();
+		this->loaded_region_min = other.get_loaded_region_min();
+		this->loaded_region_max = other.get_loaded_region_max();
+		this->loaded_refinement_levels = other.get_loaded_refinement_levels();
+		this->balanced_loading = other.get_balanced_loading();
+		this->incremental_load_balancing = other.get_incremental_load_balancing();
+		this->incremental_migration_limit = other.get_incremental_migration_limit();
+		this->automatic_cell_weights = other.get_automatic_cell_weights();
+		this->cell_cost_smoothing = other.get_cell_cost_smoothing();
+		this->cell_costs = other.get_cell_costs();
 
 		// default construct Other_Cell_Data of local cells
-		for (typename std::unordered_map<uint64_t, Other_Cell_Data>::const_iterator
-			cell_item = other.get_cell_data().begin();
-			cell_item != other.get_cell_data().end();
-			cell_item++
-		) {
-			this->cell_data[cell_item->first];
+		for (const auto& cell_item: other.get_cell_data()) {
+			this->cell_data[cell_item.first];
 		}
 	}
 
 
+	/*!
+	Frees MPI resources of persistent and neighbor collective
+	remote neighbor updates.
+
+	Copies of the grid don't share these resources, a copy
+	creates its own when it first needs them.
+
+	\see
+	set_persistent_remote_neighbor_updates()
+	set_neighbor_collective_updates()
+	*/
+	~Dccrg()
+	{
+		this->free_persistent_transfers();
+		this->free_neighbor_collective_comms();
+	}
+
+
 	/*!
 	Initializes the instance of the grid with given parameters.
 
@@ -437,7 +525,8 @@ public:
 		Cell_Data,
 		Geometry,
 		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
 	>& initialize(
 		const MPI_Comm& given_comm,
 		const uint64_t sfc_caching_batches = 1
@@ -524,7 +613,8 @@ public:
 		Cell_Data,
 		Geometry,
 		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
 	>& set_geometry(const typename Geometry::Parameters& parameters)
 	{
 		if (not this->geometry_rw.set(parameters)) {
@@ -915,6 +1005,72 @@ public:
 	}
 
 
+	/*!
+	Processes local cells with several threads while updating copies of remote neighbors.
+
+	Starts remote neighbor updates of given neighborhood and calls
+	inner_function for inner_cells with other threads of given pool
+	while the calling thread waits for the updates to complete,
+	after which it helps with remaining inner_cells. Then calls
+	outer_function for outer_cells with all threads of the pool.
+	Functions are called with const cells_item_t& of each cell,
+	concurrently and in any order.
+
+	Only the calling thread calls MPI functions so MPI must have
+	been initialized with at least MPI_THREAD_FUNNELED.
+
+	Returns the same as update_copies_of_remote_neighbors().
+	Must be called simultaneously on all processes and with
+	identical neighborhood_id.
+	Exceptions thrown by given functions in any thread are
+	rethrown in the calling thread after remote neighbor
+	updates have completed, see Thread_Pool::wait(), in which
+	case outer_cells aren't processed if inner_function threw.
+
+	Example:
+	\verbatim
+	typedef dccrg::Dccrg<Cell_Data> Grid;
+	Grid grid;
+	...
+	dccrg::Thread_Pool pool;
+	auto solve = [](const Grid::cells_item_t& cell) {
+		for (const auto& neighbor: cell.neighbors_of) {...}
+	};
+	grid.process_cells_with_remote_neighbor_updates(pool, solve, solve);
+	\endverbatim
+
+	\see
+	update_copies_of_remote_neighbors()
+	Thread_Pool
+	*/
+	template<
+		class Inner_Function,
+		class Outer_Function
+	> bool process_cells_with_remote_neighbor_updates(
+		Thread_Pool& pool,
+		Inner_Function inner_function,
+		Outer_Function outer_function,
+		const int neighborhood_id = default_neighborhood_id
+	) {
+		bool ret_val = true;
+
+		if (!this->start_remote_neighbor_copy_updates(neighborhood_id)) {
+			ret_val = false;
+		}
+
+		pool.start(this->inner_cells, inner_function);
+
+		if (!this->wait_remote_neighbor_copy_updates(neighborhood_id)) {
+			ret_val = false;
+		}
+
+		pool.wait();
+		pool.parallel_for(this->outer_cells, outer_function);
+
+		return ret_val;
+	}
+
+
 	/*!
 	Load balances the grid's cells among processes.
 
@@ -926,6 +1082,14 @@ public:
 	If use_zoltan == true Zoltan will be used to create the new partition,
 	otherwise only pin requests will move local cells to other processes.
 	If Zoltan is used pin requests override decisions made by Zoltan.
+	With incremental load balancing enabled cells are instead moved
+	between neighboring processes, see set_incremental_load_balancing().
+	Imbalance and amount of migration are available afterwards from
+	get_load_balance_statistics() if enabled with
+	set_load_balance_statistics() and can be predicted beforehand
+	with estimate_balance_load().
+	With automatic cell weights enabled estimated costs of cells
+	are updated and used as weights, see set_automatic_cell_weights().
 
 	The following items are discarded after a call to this function:
 		- cell weights
@@ -940,7 +1104,8 @@ public:
 		Cell_Data,
 		Geometry,
 		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
 	>& balance_load(const bool use_zoltan = true)
 	{
 		this->initialize_balance_load(use_zoltan);
@@ -991,6 +1156,19 @@ public:
 
 	During this function the receiving process given to the cells'
 	get_mpi_datatype function is -1 and receiving == false.
+
+	If delta checkpoints are enabled also records a hash of every
+	local cell's data for save_grid_data_delta().
+	If checkpoint checksums are enabled they are written after
+	the grid data, otherwise checksums of a previously saved
+	grid are removed from the end of the file if it has them.
+
+	\see
+	start_saving_grid_data()
+	set_save_aggregators()
+	set_checkpoint_codec()
+	set_delta_checkpoints()
+	set_checkpoint_checksums()
 	*/
 	bool save_grid_data(
 		const std::string& name,
@@ -998,7 +1176,6 @@ public:
 		std::tuple<void*, int, MPI_Datatype> header
 	) {
 		// TODO: use only one ...write_at_all
-		// TODO: use nonblocking versions of ...write_at_all
 		/*
 		File format:
 
@@ -1020,12 +1197,17 @@ public:
 
 		int ret_val = -1;
 
+		if (this->delta_checkpoints and !this->start_delta_chain()) {
+			return false;
+		}
+
+		const uint64_t file_start = uint64_t(offset);
 		MPI_File outfile;
 
 		ret_val = MPI_File_open(
 			this->comm,
 			const_cast<char*>(name.c_str()),
-			MPI_MODE_CREATE | MPI_MODE_WRONLY,
+			MPI_MODE_CREATE | (this->checkpoint_checksums ? MPI_MODE_RDWR : MPI_MODE_WRONLY),
 			MPI_INFO_NULL,
 			&outfile
 		);
@@ -1038,192 +1220,91 @@ public:
 			return false;
 		}
 
-		// process 0 writes user's header
-		if (this->rank == 0) {
-
-			MPI_Datatype header_type = std::get<2>(header);
-
-			if (!Is_Named_Datatype()(header_type)) {
-				ret_val = MPI_Type_commit(&header_type);
-				if (ret_val != MPI_SUCCESS) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< "Process " << this->rank
-						<< " Couldn't commit header datatype: "
-						<< Error_String()(ret_val)
-						<< std::endl;
-					abort();
-				}
-			}
-
-			ret_val = MPI_File_write_at(
+		uint64_t total_number_of_cells = 0;
+		if (
+			!this->write_grid_metadata(
 				outfile,
+				name,
 				offset,
-				std::get<0>(header),
-				std::get<1>(header),
-				header_type,
-				MPI_STATUS_IGNORE
-			);
-			if (ret_val != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't write header to file " << name
-					<< ": " << Error_String()(ret_val)
-					<< std::endl;
-				return false;
-			}
-
-			// everyone moves the offset by header size
-			int header_size = 0;
-			if (MPI_Type_size(header_type, &header_size) != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
-				return false;
-			}
-			header_size *= std::get<1>(header);
-
-			ret_val = MPI_Bcast(&header_size, 1, MPI_INT, 0, this->comm);
-			if (ret_val != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Couldn't send header size: " << Error_String()(ret_val)
-					<< std::endl;
-				return false;
-			}
-			offset += (MPI_Offset) header_size;
-
-			if (!Is_Named_Datatype()(header_type)) {
-				ret_val = MPI_Type_free(&header_type);
-				if (ret_val != MPI_SUCCESS) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< " Couldn't free header datatype: "
-						<< Error_String()(ret_val)
-						<< std::endl;
-					return false;
-				}
-			}
-
-		} else {
-			int header_size = 0;
-			ret_val = MPI_Bcast(&header_size, 1, MPI_INT, 0, this->comm);
-			if (ret_val != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " couldn't receive header size: " << Error_String()(ret_val)
-					<< std::endl;
-				return false;
-			}
-			offset += (MPI_Offset) header_size;
+				header,
+				total_number_of_cells,
+				bool(this->checkpoint_codec)
+			)
+		) {
+			return false;
 		}
 
-		// write endianness check
-		if (this->rank == 0) {
-
-			uint64_t endianness_check = 0x1234567890abcdef;
-
-			ret_val = MPI_File_write_at(
-				outfile,
-				offset,
-				(void*) &endianness_check,
-				1,
-				MPI_UINT64_T,
-				MPI_STATUS_IGNORE
-			);
-			if (ret_val != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't write endianness check to file " << name
-					<< ": " << Error_String()(ret_val)
-					<< std::endl;
-				return false;
-			}
+		File_Checksums checksums;
+		if (!this->start_checksums(outfile, file_start, uint64_t(offset), checksums)) {
+			return false;
 		}
-		offset += sizeof(uint64_t);
-
-		/*
-		Write data needed for initialization.
-		*/
 
-		// write mapping data
-		if (this->rank == 0) {
-			if (!this->mapping.write(outfile, offset)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Couldn't write mapping to file " << name
-					<< std::endl;
-				return false;
-			}
-		}
-		offset += this->mapping.data_size();
+		if (this->checkpoint_codec) {
+			uint64_t local_end = 0;
+			const bool written
+				= this->write_compressed_cells(outfile, name, offset, total_number_of_cells, checksums, local_end)
+				and this->finish_grid_file(outfile, file_start, local_end, checksums);
 
-		// write length of each cell's neighborhood
-		if (this->rank == 0) {
-			ret_val = MPI_File_write_at(
-				outfile,
-				offset,
-				(void*) &(this->neighborhood_length),
-				1,
-				MPI_UNSIGNED,
-				MPI_STATUS_IGNORE
-			);
+			ret_val = MPI_File_close(&outfile);
 			if (ret_val != MPI_SUCCESS) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't write neighborhood length to file " << name
+					<< " Couldn't close file " << name
 					<< ": " << Error_String()(ret_val)
 					<< std::endl;
 				return false;
 			}
+			return written;
 		}
-		offset += sizeof(unsigned int);
 
-		// write periodicity data
-		if (this->rank == 0) {
-			if (!this->topology.write(outfile, offset)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't write topology into file " << name
-					<< std::endl;
+		if (this->save_aggregators > 0) {
+			std::vector<uint64_t> cells_and_data_displacements;
+			std::vector<uint8_t> packed_data;
+			uint64_t cell_list_start = 0, cell_data_start = 0;
+			if (
+				!this->pack_saved_cells(
+					offset,
+					total_number_of_cells,
+					cells_and_data_displacements,
+					packed_data,
+					cell_list_start,
+					cell_data_start
+				)
+			) {
 				return false;
 			}
-		}
-		offset += this->topology.data_size();
 
-		// write geometry data
-		if (this->rank == 0) {
-			size_t written = this->geometry.write(outfile, offset);
-			if (written == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't write geometry to file " << name
-					<< ": " << Error_String()(ret_val)
-					<< std::endl;
-				return false;
+			const std::vector<File_Piece> pieces{
+				{cell_list_start, (const uint8_t*) cells_and_data_displacements.data(),
+					cells_and_data_displacements.size() * sizeof(uint64_t)},
+				{cell_data_start, packed_data.data(), packed_data.size()}
+			};
+			for (const auto& piece: pieces) {
+				checksums.add(piece.offset, piece.data, piece.size);
 			}
-		}
-		offset += this->geometry.data_size();
-
-		// write the total number of cells that will be written
-		uint64_t number_of_cells = this->cell_data.size();
-		const uint64_t total_number_of_cells
-			= All_Reduce()(number_of_cells, this->comm);
+			this->write_aggregated(outfile, pieces);
 
-		if (this->rank == 0) {
-			ret_val = MPI_File_write_at(
+			const bool finished = this->finish_grid_file(
 				outfile,
-				offset,
-				(void*) &total_number_of_cells,
-				1,
-				MPI_UINT64_T,
-				MPI_STATUS_IGNORE
+				file_start,
+				std::max(
+					cell_list_start + cells_and_data_displacements.size() * sizeof(uint64_t),
+					cell_data_start + packed_data.size()
+				),
+				checksums
 			);
+
+			ret_val = MPI_File_close(&outfile);
 			if (ret_val != MPI_SUCCESS) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't write cell list to file " << name
+					<< " Couldn't close file " << name
 					<< ": " << Error_String()(ret_val)
 					<< std::endl;
 				return false;
 			}
+			return finished;
 		}
-		offset += sizeof(uint64_t);
+
+		const uint64_t number_of_cells = this->cell_data.size();
 
 		// contiguous memory version of cell list needed by MPI_Write_...
 		std::vector<uint64_t> cells_to_write = this->get_cells();
@@ -1358,7 +1439,7 @@ public:
 				abort();
 			}
 
-			current_byte_offset += (uint64_t) current_bytes;
+			current_byte_offset += (uint64_t) current_bytes * (uint64_t) counts[i];
 		}
 
 		// tell everyone how many bytes everyone will write
@@ -1431,6 +1512,14 @@ public:
 			cells_and_data_displacements[2 * i] = cells_to_write[i];
 			cells_and_data_displacements[2 * i + 1] = file_displacements[i];
 		}
+		checksums.add(
+			cell_list_start,
+			(const uint8_t*) cells_and_data_displacements.data(),
+			2 * number_of_cells * sizeof(uint64_t)
+		);
+		if (checksums.block_size > 0) {
+			this->add_cells_to_checksums(addresses, counts, mem_datatypes, file_displacements, checksums);
+		}
 
 		// give a valid buffer to ...write_at_all even if no cells to write
 		if (number_of_cells == 0) {
@@ -1600,6 +1689,16 @@ public:
 			}
 		}
 
+		const bool finished = this->finish_grid_file(
+			outfile,
+			file_start,
+			std::max(
+				cell_list_start + 2 * number_of_cells * sizeof(uint64_t),
+				cell_data_start + current_byte_offset
+			),
+			checksums
+		);
+
 		ret_val = MPI_File_close(&outfile);
 		if (ret_val != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
@@ -1609,1210 +1708,1728 @@ public:
 			return false;
 		}
 
-		return true;
+		return finished;
 	}
 
 
 	/*!
-	Restores grid state from given file written by save_grid_data() starting at given offset.
-
-	Call this instead of initialize() to create an instance of the grid from a file.
-	See initialize() for an explanation of given_comm, load_balancing_method and
-	sfc_caching_bathces. TODO: Reads at most number_of_cells number of cell data
-	offsets at a time, give a smaller number if all cell ids won't fit into memory at once.
-
-	All processes read the same data defined by the given header starting at
-	given file offset in bytes. The header does not have to be defined on
-	other processes.
-
-	Must be called by all processes of given_comm and with identical arguments.
-
-	Returns true on success and false otherwise.
+	Appends data of cells changed since the previous save into given file.
+
+	Delta checkpoints must be enabled with set_delta_checkpoints()
+	before the last save_grid_data() or start_saving_grid_data(),
+	which records a hash of every local cell's data. This function
+	hashes cell data again and appends a record containing only
+	cells whose data changed since the previous call to this function
+	or to the functions above into given delta file. Data is copied
+	with MPI_Pack as in start_saving_grid_data(). The first call
+	after the last full save truncates given file so every full save
+	starts a new chain of records.
+
+	load_grid_data() applies all records of a delta file in order
+	on top of cell data loaded from the file of the last full save.
+	Cells must not be refined or unrefined between the full save
+	and its delta records, in which case nothing is written and
+	false is returned on all processes, grid data must then be saved
+	again with save_grid_data(). Cells moved to another process by
+	balance_load() are written again by their new owner.
+
+	File format of each record:
+	\verbatim
+	uint64_t  delta_record_marker
+	uint64_t  number of cells in record
+	uint64_t  size of record in bytes
+	uint64_t  id of 1st cell
+	uint64_t  start of data of 1st cell in file
+	...
+	uint8_t*A data of 1st cell
+	...
+	\endverbatim
 
-	During this function the sending process given to the cells'
-	mpi_datatype function is -1 and receiving == true.
+	Must be called by all processes with identical arguments.
+	Returns true on success, false otherwise (on all processes).
 
 	\see
-	load_cells()
-	save_grid_data()
+	set_delta_checkpoints()
+	load_grid_data()
 	*/
-	bool load_grid_data(
-		const std::string& name,
-		MPI_Offset offset,
-		std::tuple<void*, int, MPI_Datatype> header,
-		const MPI_Comm& given_comm,
-		const char* const load_balancing_method,
-		const uint64_t sfc_caching_batches = 1,
-		const uint64_t number_of_cells = ~uint64_t(0)
-	) {
-		if (
-			!this->start_loading_grid_data(
-				name,
-				offset,
-				header,
-				given_comm,
-				load_balancing_method,
-				sfc_caching_batches,
-				number_of_cells
-			)
-		) {
+	bool save_grid_data_delta(const std::string& name)
+	{
+		if (not this->delta_checkpoints or not this->delta_base_saved) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Delta checkpoints must be enabled before saving grid data"
+				<< std::endl;
 			return false;
 		}
 
-		if (!this->continue_loading_grid_data()) {
+		std::vector<uint64_t> changed_cells_and_sizes;
+		std::vector<uint8_t> changed_data;
+		std::array<uint64_t, 2> hashed_cells{{0, 0}};
+		if (!this->update_cell_hashes(hashed_cells, &changed_cells_and_sizes, &changed_data)) {
 			return false;
 		}
-
-		if (!this->finish_loading_grid_data()) {
+		// loading would require cells that don't exist in the full save
+		if (hashed_cells != this->delta_base_cells) {
+			if (this->rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cells have been refined or unrefined after last full save, not saving delta to "
+					<< name << ", save grid data again instead"
+					<< std::endl;
+			}
 			return false;
 		}
+		const uint64_t number_of_cells = changed_cells_and_sizes.size() / 2;
 
-		return true;
-	}
-
-
-	/*!
-	Initializes dccrg from given file with data starting at given offset in bytes.
-
-	Given header is read first at given offset which should have the same int and
-	MPI_Datatype data when the file was written.
-
-	After calling this function the cell data can start to be loaded with one or
-	more calls to continue_loading_grid_data().
-
-	Before doing any other collective operations with the grid, the function
-	finish_loading_grid_data() should be called, either after this function
-	or after the last call to continue_loading_grid_data().
-
-	Returns true on success, false otherwise.
-
-	\see
-	load_grid_data()
-	*/
-	bool start_loading_grid_data(
-		const std::string& name,
-		MPI_Offset offset,
-		std::tuple<void*, int, MPI_Datatype> header,
-		const MPI_Comm& given_comm,
-		const char* const load_balancing_method,
-		const uint64_t sfc_caching_batches = 1,
-		const uint64_t /*number_of_cells*/ = ~uint64_t(0)
-	) {
-		int ret_val = -1;
-
-		if (!this->initialize_mpi(given_comm)) {
+		const bool fits_one_write
+			= 2 * number_of_cells <= uint64_t(INT_MAX)
+			and changed_data.size() <= uint64_t(INT_MAX);
+		if (not fits_one_write) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't initialize MPI"
+				<< " Process " << this->rank
+				<< " Too much changed cell data for one write: " << changed_data.size()
 				<< std::endl;
+		}
+		// fail on all processes before opening the file collectively
+		if (All_Reduce()(fits_one_write ? 0 : 1, this->comm) > 0) {
 			return false;
 		}
 
-		ret_val = MPI_File_open(
-			given_comm,
+		MPI_File outfile;
+		int ret_val = MPI_File_open(
+			this->comm,
 			const_cast<char*>(name.c_str()),
-			MPI_MODE_RDONLY,
+			MPI_MODE_CREATE | MPI_MODE_WRONLY,
 			MPI_INFO_NULL,
-			&(this->grid_data_file)
+			&outfile
 		);
 		if (ret_val != MPI_SUCCESS) {
-			if (this->rank == 0) {
-				std::cerr << "Couldn't open file " << name
-					<< ": " << Error_String()(ret_val)
-					<< std::endl;
-			}
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't open file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
 
-		// read in user's header
-		MPI_Datatype header_type = std::get<2>(header);
-
-		if (!Is_Named_Datatype()(header_type)) {
-			ret_val = MPI_Type_commit(&header_type);
-			if (ret_val != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< "Process " << this->rank
-					<< " Couldn't commit header datatype: "
-					<< Error_String()(ret_val)
-					<< std::endl;
-				abort();
-			}
+		MPI_Offset record_start = 0;
+		if (this->delta_file_started) {
+			ret_val = MPI_File_get_size(outfile, &record_start);
+		} else {
+			ret_val = MPI_File_set_size(outfile, 0);
 		}
-
-		ret_val = MPI_File_read_at_all(
-			this->grid_data_file,
-			offset,
-			std::get<0>(header),
-			std::get<1>(header),
-			header_type,
-			MPI_STATUS_IGNORE
-		);
 		if (ret_val != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
 				<< " Process " << this->rank
-				<< " Couldn't read header from file " << name
+				<< " Couldn't get or set size of file " << name
 				<< ": " << Error_String()(ret_val)
 				<< std::endl;
 			return false;
 		}
+		this->delta_file_started = true;
 
-		int header_size = 0;
-		if (MPI_Type_size(header_type, &header_size) != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
-			return false;
+		// find out where local cells and data start in record
+		const std::array<uint64_t, 2> local_counts{{number_of_cells, changed_data.size()}};
+		std::vector<uint64_t> all_counts(2 * this->comm_size, 0);
+		ret_val = MPI_Allgather(
+			local_counts.data(),
+			2,
+			MPI_UINT64_T,
+			all_counts.data(),
+			2,
+			MPI_UINT64_T,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " MPI_Allgather failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
 		}
-		header_size *= std::get<1>(header);
-		offset += (MPI_Offset) header_size;
 
-		if (!Is_Named_Datatype()(header_type)) {
-			ret_val = MPI_Type_free(&header_type);
+		uint64_t total_number_of_cells = 0, total_data_size = 0;
+		for (uint64_t i = 0; i < this->comm_size; i++) {
+			total_number_of_cells += all_counts[2 * i];
+			total_data_size += all_counts[2 * i + 1];
+		}
+
+		const uint64_t
+			cell_list_begin = uint64_t(record_start) + 3 * sizeof(uint64_t),
+			data_begin = cell_list_begin + 2 * total_number_of_cells * sizeof(uint64_t);
+
+		uint64_t cell_list_start = cell_list_begin, data_start = data_begin;
+		for (uint64_t i = 0; i < this->rank; i++) {
+			cell_list_start += 2 * all_counts[2 * i] * sizeof(uint64_t);
+			data_start += all_counts[2 * i + 1];
+		}
+
+		// convert sizes of cell data into offsets in file
+		for (uint64_t i = 0; i < number_of_cells; i++) {
+			const uint64_t size = changed_cells_and_sizes[2 * i + 1];
+			changed_cells_and_sizes[2 * i + 1] = data_start;
+			data_start += size;
+		}
+		data_start -= changed_data.size();
+
+		if (this->rank == 0) {
+			const std::array<uint64_t, 3> record_header{{
+				delta_record_marker,
+				total_number_of_cells,
+				data_begin + total_data_size - uint64_t(record_start)
+			}};
+			ret_val = MPI_File_write_at(
+				outfile,
+				record_start,
+				(void*) record_header.data(),
+				3,
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
 			if (ret_val != MPI_SUCCESS) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't free header datatype: "
-					<< Error_String()(ret_val)
+					<< " Couldn't write delta record header to file " << name
+					<< ": " << Error_String()(ret_val)
 					<< std::endl;
 				return false;
 			}
 		}
 
-		// check endianness
-		uint64_t
-			endianness_original = 0x1234567890abcdef,
-			endianness_read = 0;
+		// give valid buffers to ...write_at_all even if nothing to write
+		const uint64_t dummy = error_cell;
 
-		ret_val = MPI_File_read_at_all(
-			this->grid_data_file,
-			offset,
-			&endianness_read,
-			1,
+		ret_val = MPI_File_write_at_all(
+			outfile,
+			(MPI_Offset) cell_list_start,
+			number_of_cells > 0 ? (void*) changed_cells_and_sizes.data() : (void*) &dummy,
+			int(changed_cells_and_sizes.size()),
 			MPI_UINT64_T,
 			MPI_STATUS_IGNORE
 		);
 		if (ret_val != MPI_SUCCESS) {
-			if (this->rank == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Couldn't read endianness check from file " << name
-					<< ": " << Error_String()(ret_val)
-					<< std::endl;
-			}
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't write changed cells to file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
-		offset += sizeof(uint64_t);
 
-		if (endianness_original != endianness_read) {
-			if (this->rank == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " File " << name
-					<< " has wrong endianness, value from file is "
-					<< endianness_read
-					<< " but should be " << endianness_original
-					<< std::endl;
-			}
+		ret_val = MPI_File_write_at_all(
+			outfile,
+			(MPI_Offset) data_start,
+			changed_data.size() > 0 ? (void*) changed_data.data() : (void*) &dummy,
+			int(changed_data.size()),
+			MPI_BYTE,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't write data of changed cells to file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
 
-		this->load_balancing_method = load_balancing_method;
-		if (!this->initialize_zoltan()) {
+		ret_val = MPI_File_close(&outfile);
+		if (ret_val != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't initialize Zoltan"
+				<< " Couldn't close file " << name
+				<< ": " << Error_String()(ret_val)
 				<< std::endl;
 			return false;
 		}
 
-		// initialize mapping
-		if (!this->mapping_rw.read(this->grid_data_file, offset)) {
-			if (rank == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Couldn't read mapping"
-					<< std::endl;
-			}
+		return true;
+	}
+
+
+	/*!
+	Starts writing grid data into given file in the background.
+
+	Writes the same file as save_grid_data() with identical arguments
+	but returns after copying local cell data into an internal buffer
+	and starting nonblocking collective writes of the buffer, so cell
+	data can be modified and the simulation can continue while the
+	file is being written. Only process 0 writes the header and other
+	small data of the grid before returning.
+
+	Cell data is copied with MPI_Pack so the data representation of
+	packed and native data must be identical, as is usually the case
+	when all processes run on identical hardware.
+
+	Compressed files and save aggregators aren't supported,
+	fails on all processes if a checkpoint codec or save
+	aggregators have been set.
+
+	finish_saving_grid_data() must be called before starting to save
+	another file, before the file is used and before MPI_Finalize().
+	The grid itself can be modified e.g. by balance_load() before that.
+
+	Must be called by all processes with identical arguments.
+	Returns true on success, false otherwise (on all processes).
+
+	\see
+	save_grid_data()
+	finish_saving_grid_data()
+	*/
+	bool start_saving_grid_data(
+		const std::string& name,
+		MPI_Offset offset,
+		std::tuple<void*, int, MPI_Datatype> header
+	) {
+		if (this->saving_grid_data) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Previous file is still being saved"
+				<< std::endl;
 			return false;
 		}
-		offset += this->mapping.data_size();
 
-		// initialize default neighborhood
-		unsigned int neighborhood_length = 0;
-		ret_val = MPI_File_read_at_all(
-			this->grid_data_file,
-			offset,
-			(void*) &neighborhood_length,
-			1,
-			MPI_UNSIGNED,
-			MPI_STATUS_IGNORE
-		);
-		if (ret_val != MPI_SUCCESS) {
-			if (rank == 0) {
+		if (this->checkpoint_codec or this->save_aggregators > 0) {
+			if (this->rank == 0) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Couldn't read length of cells' neighborhoods: " << Error_String()(ret_val)
+					<< " Saving in the background doesn't support checkpoint codecs"
+					<< " or save aggregators, use save_grid_data() instead"
 					<< std::endl;
 			}
 			return false;
 		}
-		offset += sizeof(unsigned int);
-		this->neighborhood_length = neighborhood_length;
-		this->initialize_neighborhoods();
 
-		// initialize topology
-		if (!this->topology_rw.read(this->grid_data_file, offset)) {
-			if (rank == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Couldn't read grid topology from file"
-					<< std::endl;
-			}
+		if (this->delta_checkpoints and !this->start_delta_chain()) {
 			return false;
 		}
-		offset += this->topology.data_size();
 
-		// initialize geometry
-		if (!this->geometry_rw.read(this->grid_data_file, offset)) {
-			if (this->rank == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Couldn't read geometry from file"
-					<< std::endl;
-			}
-			return false;
-		}
-		offset += this->geometry.data_size();
-
-		// initial cells must exist along with neighbor lists,
-		// etc. before loading the grid.
-		this->create_level_0_cells(sfc_caching_batches);
-		if (!this->initialize_neighbors()) {
+		this->save_file_start = uint64_t(offset);
+		int ret_val = MPI_File_open(
+			this->comm,
+			const_cast<char*>(name.c_str()),
+			MPI_MODE_CREATE | (this->checkpoint_checksums ? MPI_MODE_RDWR : MPI_MODE_WRONLY),
+			MPI_INFO_NULL,
+			&(this->save_file)
+		);
+		if (ret_val != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't initialize neighbors"
+				<< " Process " << this->rank
+				<< " Couldn't open file " << name
+				<< ": " << Error_String()(ret_val)
 				<< std::endl;
 			return false;
 		}
+		this->saving_grid_data = true;
 
-		// read the total number of cells in the file
 		uint64_t total_number_of_cells = 0;
-		ret_val = MPI_File_read_at_all(
-			this->grid_data_file,
-			offset,
-			&total_number_of_cells,
-			1,
-			MPI_UINT64_T,
-			MPI_STATUS_IGNORE
-		);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << "Couldn't read total number of cells" << std::endl;
-			return false;
+		const bool metadata_written
+			= this->write_grid_metadata(this->save_file, name, offset, header, total_number_of_cells)
+			and this->start_checksums(this->save_file, this->save_file_start, uint64_t(offset), this->save_checksums);
+		// fail together before next collective call
+		if (All_Reduce()(metadata_written ? 0 : 1, this->comm) > 0) {
+			return this->cancel_saving_grid_data();
 		}
-		offset += sizeof(uint64_t);
 
-		// read cells and data displacements
-		std::vector<uint64_t> all_cells_and_data_displacements(2 * total_number_of_cells, error_cell);
-		ret_val = MPI_File_read_at_all(
-			this->grid_data_file,
+		uint64_t cell_list_start = 0, cell_data_start = 0;
+		this->pack_saved_cells(
 			offset,
-			&all_cells_and_data_displacements[0],
-			2 * total_number_of_cells,
-			MPI_UINT64_T,
-			MPI_STATUS_IGNORE
+			total_number_of_cells,
+			this->save_cells_and_data_displacements,
+			this->save_cell_data,
+			cell_list_start,
+			cell_data_start
 		);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << "Couldn't read number of cells" << std::endl;
-			return false;
+		const uint64_t
+			cell_list_size = this->save_cells_and_data_displacements.size() * sizeof(uint64_t),
+			cell_data_size = this->save_cell_data.size();
+		this->save_file_end = std::max(
+			cell_list_start + cell_list_size,
+			cell_data_start + cell_data_size
+		);
+		this->save_checksums.add(
+			cell_list_start,
+			(const uint8_t*) this->save_cells_and_data_displacements.data(),
+			cell_list_size
+		);
+		this->save_checksums.add(cell_data_start, this->save_cell_data.data(), cell_data_size);
+
+		// give valid buffers to ...write_at_all even if no cells to write
+		if (cell_list_size == 0) {
+			this->save_cells_and_data_displacements.push_back(error_cell);
+			this->save_cell_data.push_back(0);
 		}
 
-		// check that correct cells were read properly
-		for (size_t i = 0; i < all_cells_and_data_displacements.size(); i += 2) {
-			const uint64_t cell = all_cells_and_data_displacements[i];
-			if (cell == error_cell) {
+		// all processes start both writes even if one fails locally
+		bool writes_started = true;
+		const std::array<std::pair<uint64_t, uint64_t>, 2> writes{{
+			{cell_list_start, cell_list_size},
+			{cell_data_start, cell_data_size}
+		}};
+		for (size_t i = 0; i < writes.size(); i++) {
+			MPI_Datatype write_datatype = Byte_Datatype()(writes[i].second);
+			ret_val = MPI_File_iwrite_at_all(
+				this->save_file,
+				(MPI_Offset) writes[i].first,
+				i == 0
+					? (void*) this->save_cells_and_data_displacements.data()
+					: (void*) this->save_cell_data.data(),
+				1,
+				write_datatype,
+				&(this->save_requests[i])
+			);
+			MPI_Type_free(&write_datatype);
+			if (ret_val != MPI_SUCCESS) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Invalid cell in cell list at index " << i << ": " << cell
+					<< " Process " << this->rank
+					<< " Couldn't start writing "
+					<< (i == 0 ? "cell and displacement list" : "cell data")
+					<< " to file " << name
+					<< ": " << Error_String()(ret_val)
 					<< std::endl;
-				abort();
+				writes_started = false;
 			}
 		}
+		if (All_Reduce()(writes_started ? 0 : 1, this->comm) > 0) {
+			return this->cancel_saving_grid_data();
+		}
 
-		// remove all but local cell data displacements
-		this->cells_and_data_displacements.clear();
-		this->cells_and_data_displacements.reserve(this->cell_data.size());
+		return true;
+	}
 
-		for (size_t i = 0; i < all_cells_and_data_displacements.size(); i += 2) {
-			const uint64_t
-				cell = all_cells_and_data_displacements[i],
-				offset = all_cells_and_data_displacements[i + 1];
 
-			if (this->cell_overlaps_local(cell)) {
-				this->cells_and_data_displacements.push_back(std::make_pair(cell, offset));
+	/*!
+	Waits until writing the file given to start_saving_grid_data() has finished.
+
+	Must be called by all processes.
+	Returns true on success, false otherwise.
+	Does nothing and returns true if no file is being saved.
+	*/
+	bool finish_saving_grid_data()
+	{
+		if (not this->saving_grid_data) {
+			return true;
+		}
+		this->saving_grid_data = false;
+
+		bool success = true;
+		for (auto& request: this->save_requests) {
+			if (request == MPI_REQUEST_NULL) {
+				continue;
+			}
+			const int ret_val = MPI_Wait(&request, MPI_STATUS_IGNORE);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write grid data: "
+					<< Error_String()(ret_val)
+					<< std::endl;
+				success = false;
 			}
 		}
-		all_cells_and_data_displacements.clear();
 
-		// refine the grid to create cells that exist in the file
-		std::vector<uint64_t> final_cells;
-		final_cells.reserve(this->cells_and_data_displacements.size());
-		for (std::vector<std::pair<uint64_t, uint64_t> >::const_iterator
-			item = this->cells_and_data_displacements.begin();
-			item != this->cells_and_data_displacements.end();
-			item++
+		this->save_cells_and_data_displacements.clear();
+		this->save_cells_and_data_displacements.shrink_to_fit();
+		this->save_cell_data.clear();
+		this->save_cell_data.shrink_to_fit();
+
+		if (
+			!this->finish_grid_file(
+				this->save_file,
+				this->save_file_start,
+				this->save_file_end,
+				this->save_checksums
+			)
 		) {
-			final_cells.push_back(item->first);
+			success = false;
 		}
+		this->save_checksums = File_Checksums();
 
-		if (!this->load_cells(final_cells)) {
+		const int ret_val = MPI_File_close(&(this->save_file));
+		if (ret_val != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't load grid"
+				<< " Process " << this->rank
+				<< " Couldn't close output file: "
+				<< Error_String()(ret_val)
 				<< std::endl;
-			abort();
+			return false;
 		}
-		final_cells.clear();
-
-		const uint64_t number_of_cells = this->cell_data.size();
 
-		if (number_of_cells != this->cells_and_data_displacements.size()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Incorrect number of cell data displacements: "
-				<< this->cells_and_data_displacements.size()
-				<< ", should be " << number_of_cells
-				<< std::endl;
-			abort();
-		}
+		return success;
+	}
 
-		this->grid_initialized = true;
 
-		return true;
+	//! Returns true if start_saving_grid_data() hasn't been finished yet.
+	bool is_saving_grid_data() const
+	{
+		return this->saving_grid_data;
 	}
 
-	/*!
-	Starts/continues reading cell data from given file.
 
-	Data for each cell in the file is assumed to be in format given by
-	each cells' get_mpi_datatype() member function which should return
-	the same MPI_Datatype as it did when saving grid data to given file.
-	If complete MPI_Datatype of cell data used when saving isn't known
-	in advance the saving datatype should be constructed in such a way
-	that data whose size is always known should be first. Then you can
-	call this function several times and give the correct MPI_Datatype
-	from each cell based on the data loaded by previous calls to this
-	function. For example if cell data consists of a vector of ints
-	you should add the number of ints as a size_t variable into the cell
-	and return the size_t variable along with the vector data but so
-	that size_t is earlier in the MPI_Datatype. In other words the
-	memory layout of the returned MPI_Datatype should be:
-	size_t, 1st int, 2nd int, ...
+	/*!
+	Returns the number of processes that write cell data in save_grid_data().
 
-	Before doing anything else with the grid the function finish_loading_grid_data()
-	should be called after this function.
+	\see
+	set_save_aggregators()
+	*/
+	int get_save_aggregators() const
+	{
+		return this->save_aggregators;
+	}
 
-	Returns true on success, false otherwise.
+	/*!
+	Sets the number of processes that write cell data in save_grid_data().
+
+	If 0 (default) every process writes its own cells with collective
+	MPI-IO using a file view that spans local cell data.
+	Otherwise the part of the file with the list of cells and cell
+	data is split into given number of contiguous ranges whose
+	boundaries are multiples of save stripe size, and each range
+	is written by one process, at most 64 stripes at a time.
+	Other processes send their data to those processes which are
+	spread evenly among all processes, e.g. one process per node
+	if given the number of nodes and processes are placed node
+	by node. Written file is identical in both cases.
+	Cell data is copied as in start_saving_grid_data().
+
+	Must be called simultaneously on all processes with the same value.
+	Throws std::invalid_argument if given a negative number.
 
 	\see
-	start_loading_grid_data()
-	finish_loading_grid_data()
+	set_save_stripe_size()
 	*/
-	bool continue_loading_grid_data()
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_save_aggregators(const int given)
 	{
-		int ret_val = -1;
-
-		const uint64_t number_of_cells = this->cell_data.size();
-		if (number_of_cells != this->cells_and_data_displacements.size()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Incorrect number of cell data displacements: "
-				<< this->cells_and_data_displacements.size()
-				<< ", should be " << number_of_cells
-				<< std::endl;
-			abort();
+		if (given < 0) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Number of save aggregators must be >= 0: " + std::to_string(given)
+			);
 		}
+		this->save_aggregators = given;
+		return *this;
+	}
 
-		// datatypes etc. of local cell data in memory
-		std::vector<void*> addresses(number_of_cells, NULL);
-		std::vector<int> counts(number_of_cells, -1);
-		std::vector<MPI_Datatype> mem_datatypes(number_of_cells, MPI_DATATYPE_NULL);
-		std::vector<MPI_Aint>
-			memory_displacements(number_of_cells, 0),
-			file_displacements(number_of_cells, 0);
+	/*!
+	Returns the alignment in bytes of file ranges written by save aggregators.
 
-		// set file view representing local cell data
-		MPI_Datatype file_datatype;
+	\see
+	set_save_stripe_size()
+	*/
+	uint64_t get_save_stripe_size() const
+	{
+		return this->save_stripe_size;
+	}
 
-		if (number_of_cells == 0) {
+	/*!
+	Sets the alignment in bytes of file ranges written by save aggregators.
 
-			MPI_Type_contiguous(0, MPI_BYTE, &file_datatype);
+	Should be the stripe size of the file system, default is 1 MiB.
+	Has no effect if save aggregators aren't used.
+	Throws std::invalid_argument if given 0 or more than INT_MAX / 64
+	bytes (just under 32 MiB) because aggregators write at most 64
+	stripes with one MPI call.
 
-		} else {
+	\see
+	set_save_aggregators()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_save_stripe_size(const uint64_t given)
+	{
+		if (given == 0 or given > uint64_t(std::numeric_limits<int>::max() / 64)) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Save stripe size must be > 0 and <= INT_MAX / 64: " + std::to_string(given)
+			);
+		}
+		this->save_stripe_size = given;
+		return *this;
+	}
 
-			// get datatype info from local cells in memory
-			for (uint64_t i = 0; i < number_of_cells; i++) {
-				const uint64_t cell = this->cells_and_data_displacements[i].first;
+	/*!
+	Returns the codec used for compressing cell data in save_grid_data().
 
-				std::tie(
-					addresses[i],
-					counts[i],
-					mem_datatypes[i]
-				) = detail::get_cell_mpi_datatype(
-					this->cell_data.at(cell),
-					cell,
-					-1,
-					(int) this->rank,
-					true,
-					-1
-				);
-			}
+	\see
+	set_checkpoint_codec()
+	*/
+	std::shared_ptr<const Checkpoint_Codec> get_checkpoint_codec() const
+	{
+		return this->checkpoint_codec;
+	}
 
-			// padding is not included in the file so maybe use contiguous datatypes
-			std::vector<MPI_Datatype> file_datatypes(mem_datatypes.size(), MPI_DATATYPE_NULL);
-			for (size_t i = 0; i < mem_datatypes.size(); i++) {
-				MPI_Datatype& mem_datatype = mem_datatypes[i];
+	/*!
+	Sets the codec used for compressing cell data in save_grid_data().
 
-				if (Is_Named_Datatype()(mem_datatype)) {
+	If null (default) cell data is written uncompressed.
+	Otherwise every process splits data of its cells into blocks
+	of whole cells, in the order of cells in the file, of at
+	most checkpoint block size bytes unless a cell is larger,
+	and compresses each block independently with given codec.
+	Blocks that don't get smaller are written uncompressed.
+	Cell data is copied as in start_saving_grid_data() before
+	compression and save aggregators aren't used.
 
-					file_datatypes[i] = mem_datatype;
+	The file has an index of compressed blocks after the list of
+	cells which is read by every process in load_grid_data().
+	Loading requires a codec with the same id as the one used
+	for saving, if no codec has been set when loading a file
+	compressed with Shuffle_LZ_Codec it is used automatically.
 
-				} else {
+	Must be called simultaneously on all processes with the same codec.
 
-					int size_in_bytes;
-					ret_val = MPI_Type_size(mem_datatypes[i], &size_in_bytes);
-					if (ret_val != MPI_SUCCESS) {
-						std::cerr << __FILE__ << ":" << __LINE__
-							<< " Process " << this->rank
-							<< " Couldn't get datatype size: "
-							<< Error_String()(ret_val)
-							<< std::endl;
-						abort();
-					}
+	\see
+	set_checkpoint_block_size()
+	Checkpoint_Codec
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_checkpoint_codec(std::shared_ptr<const Checkpoint_Codec> given)
+	{
+		this->checkpoint_codec = given;
+		return *this;
+	}
 
-					ret_val =  MPI_Type_contiguous(size_in_bytes, MPI_BYTE, &(file_datatypes[i]));
-					if (ret_val != MPI_SUCCESS) {
-						std::cerr << __FILE__ << ":" << __LINE__
-							<< " Process " << this->rank
-							<< " Couldn't create contiguous datatype: "
-							<< Error_String()(ret_val)
-							<< std::endl;
-						abort();
-					}
-				}
-			}
+	/*!
+	Returns the maximum size of uncompressed blocks of cell data in bytes.
 
-			// displacements for cell data in memory are relative to first cell's data
-			for (size_t i = 0; i < number_of_cells; i++) {
-				memory_displacements[i] = (uint8_t*) addresses[i] - (uint8_t*) addresses[0];
-			}
+	\see
+	set_checkpoint_block_size()
+	*/
+	uint64_t get_checkpoint_block_size() const
+	{
+		return this->checkpoint_block_size;
+	}
 
-			// displacements for cell data in file are relative to start of file
-			for (uint64_t i = 0; i < number_of_cells; i++) {
-				file_displacements[i] = this->cells_and_data_displacements[i].second;
+	/*!
+	Sets the maximum size of uncompressed blocks of cell data in bytes.
 
-				// move cell data offsets in case this function is called again
-				int size_in_bytes;
-				ret_val = MPI_Type_size(mem_datatypes[i], &size_in_bytes);
-				if (ret_val != MPI_SUCCESS) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< " Couldn't get datatype size: "
-						<< Error_String()(ret_val)
-						<< std::endl;
-					abort();
-				}
-
-				this->cells_and_data_displacements[i].second += size_in_bytes;
-			}
+	Default is 1 MiB, larger blocks usually compress better
+	but every process loading a cell reads and decompresses
+	the whole block containing that cell.
+	Throws std::invalid_argument if given 0 or more than 1 GiB.
 
-			ret_val = MPI_Type_create_struct(
-				number_of_cells,
-				&counts[0],
-				&file_displacements[0],
-				&file_datatypes[0],
-				&file_datatype
+	\see
+	set_checkpoint_codec()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_checkpoint_block_size(const uint64_t given)
+	{
+		if (given == 0 or given > (uint64_t(1) << 30)) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Checkpoint block size must be > 0 and <= 1 GiB: " + std::to_string(given)
 			);
-			if (ret_val != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't create datatype for file view: "<< Error_String()(ret_val)
-					<< std::endl;
-				abort();
-			}
-		}
-
-		ret_val = MPI_Type_commit(&file_datatype);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << this->rank
-				<< " Couldn't commit datatype for file view: " << Error_String()(ret_val)
-				<< std::endl;
-			abort();
-		}
-
-		ret_val = MPI_File_set_view(
-			this->grid_data_file,
-			0,
-			MPI_BYTE,
-			file_datatype,
-			const_cast<char*>("native"),
-			MPI_INFO_NULL
-		);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't set file view for cell data: "
-				<< Error_String()(ret_val)
-				<< std::endl;
-			abort();
 		}
+		this->checkpoint_block_size = given;
+		return *this;
+	}
 
-		// create a datatype representing local cell data in memory
-		MPI_Datatype memory_datatype;
+	/*!
+	Returns whether delta checkpoints are enabled.
 
-		if (number_of_cells == 0) {
+	\see
+	set_delta_checkpoints()
+	*/
+	bool get_delta_checkpoints() const
+	{
+		return this->delta_checkpoints;
+	}
 
-			MPI_Type_contiguous(0, MPI_BYTE, &memory_datatype);
-			if (MPI_Type_commit(&memory_datatype) != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << this->rank
-					<< " Couldn't commit datatype for file view"
-					<< std::endl;
-				abort();
-			}
+	/*!
+	Enables or disables delta checkpoints.
 
-		} else {
+	When enabled save_grid_data() and start_saving_grid_data()
+	also hash the data of every local cell, which requires
+	copying it, so that save_grid_data_delta() can write only
+	cells whose data has changed. Disabled by default.
 
-			if (MPI_Type_create_struct(
-				number_of_cells,
-				&counts[0],
-				&memory_displacements[0],
-				&mem_datatypes[0],
-				&memory_datatype) != MPI_SUCCESS
-			) {
-				std::cerr << "Process " << this->rank
-					<< " Couldn't create datatype for local cells"
-					<< std::endl;
-				abort();
-			}
+	Must be called simultaneously on all processes with the same value.
 
-			if (MPI_Type_commit(&memory_datatype) != MPI_SUCCESS) {
-				std::cerr << "Process " << this->rank
-					<< " Couldn't commit datatype for file view"
-					<< std::endl;
-				abort();
-			}
+	\see
+	save_grid_data_delta()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_delta_checkpoints(const bool given)
+	{
+		this->delta_checkpoints = given;
+		if (not given) {
+			this->cell_hashes.clear();
+			this->delta_base_saved = false;
 		}
+		return *this;
+	}
 
-		// give a valid buffer to ...read_at_all even if no cells to read
-		if (number_of_cells == 0) {
-			addresses.push_back((void*) &number_of_cells);
-		}
+	/*!
+	Returns whether checksums of saved grid data are enabled.
 
-		ret_val = MPI_File_read_at_all(
-			this->grid_data_file,
-			0,
-			addresses[0],
-			1,
-			memory_datatype,
-			MPI_STATUS_IGNORE
-		);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << this->rank
-				<< " couldn't read local cell data: "
-				<< Error_String()(ret_val)
-				<< std::endl;
-			abort();
-		}
+	\see
+	set_checkpoint_checksums()
+	*/
+	bool get_checkpoint_checksums() const
+	{
+		return this->checkpoint_checksums;
+	}
 
+	/*!
+	Enables or disables checksums of saved grid data.
 
-		/*
-		Deallocate datatypes
-		*/
+	When enabled save_grid_data() and start_saving_grid_data()
+	write CRC-32C checksums of every checkpoint block size bytes
+	of the file after the saved grid, calculated from the data
+	as it is written without reading the file. load_grid_data() and
+	start_loading_grid_data() then verify the file before loading
+	it and fail if checksums are missing or don't match.
+	Disabled by default, files with checksums can also be loaded
+	without verification. Checksums of saved deltas aren't
+	written.
 
-		ret_val = MPI_Type_free(&memory_datatype);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << this->rank
-				<< " Couldn't free datatype for cell data in memory: "
-				<< Error_String()(ret_val)
-				<< std::endl;
-			return false;
-		}
+	Must be called simultaneously on all processes with the same value.
 
-		ret_val = MPI_Type_free(&file_datatype);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << this->rank
-				<< " Couldn't free datatype for cell data in file: "
-				<< Error_String()(ret_val)
-				<< std::endl;
-			return false;
-		}
+	\see
+	set_checkpoint_block_size()
+	set_checkpoint_checksum_readback()
+	File_Checksums
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_checkpoint_checksums(const bool given)
+	{
+		this->checkpoint_checksums = given;
+		return *this;
+	}
 
-		for(MPI_Datatype& datatype: mem_datatypes) {
-			if (!Is_Named_Datatype()(datatype)) {
-				ret_val = MPI_Type_free(&datatype);
-				if (ret_val != MPI_SUCCESS) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< " Couldn't free user defined datatype: "
-						<< Error_String()(ret_val)
-						<< std::endl;
-					return false;
-				}
-			}
-		}
+	/*!
+	Returns whether checksums of saved grid data are verified by reading the file.
 
-		return true;
+	\see
+	set_checkpoint_checksum_readback()
+	*/
+	bool get_checkpoint_checksum_readback() const
+	{
+		return this->checkpoint_checksum_readback;
 	}
 
-
 	/*!
-	Finalizes reading cell data from given file.
+	Enables or disables verifying checksums of saved grid data by reading the file.
 
-	Returns true on success, false otherwise.
+	When enabled and checkpoint checksums are enabled saving grid
+	data also calculates checksums by reading the saved file back
+	in parallel after synchronizing it and fails if they differ
+	from checksums of written data. Doubles the amount of I/O
+	and reads might be served from cache instead of storage.
+	Disabled by default.
+
+	Must be called simultaneously on all processes with the same value.
 
 	\see
-	start_loading_grid_data()
-	continue_loading_grid_data()
+	set_checkpoint_checksums()
 	*/
-	bool finish_loading_grid_data()
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_checkpoint_checksum_readback(const bool given)
 	{
-		this->cells_and_data_displacements.clear();
-
-		int ret_val = MPI_File_close(&(this->grid_data_file));
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << this->rank
-				<< " Couldn't close input file: "
-				<< Error_String()(ret_val)
-				<< std::endl;
-			return false;
-		}
-
-		return true;
+		this->checkpoint_checksum_readback = given;
+		return *this;
 	}
 
-
 	/*!
-	Creates all children of given cell (and possibly of other cells due to induced refinement).
+	Returns the minimum coordinate of region loaded by load_grid_data().
 
-	Takes priority over unrefining.
-	Refines / unrefines take effect only after a call to stop_refining() and are lost
-	after a call to balance_load().
-	Returns true on success.
-	Does nothing and returns true if given cell:
-		- is at maximum refinement level
-	Does nothing and returns false if given cell:
-		- isn't known to this process
-		- has, or any of its larger neighbors have, been marked by dont_refine()
-		- has already been refined (including induced refinement)
-		  and stop_refining() has not been called afterwards
-		- doesn't exist on this process
-	Children of refined cell(s) are created on their parent's process.
+	\see
+	set_loaded_region()
+	*/
+	const std::array<double, 3>& get_loaded_region_min() const
+	{
+		return this->loaded_region_min;
+	}
 
-	If given cell is at maximum refinement level dont_unrefine will be invoked instead.
+	/*!
+	Returns the maximum coordinate of region loaded by load_grid_data().
 
 	\see
-	dont_refine()
-	refine_completely_at()
-	unrefine_completely()
-	stop_refining()
-	clear_refined_unrefined_data()
-	get_removed_cells()
+	set_loaded_region()
 	*/
-	bool refine_completely(const uint64_t cell)
+	const std::array<double, 3>& get_loaded_region_max() const
 	{
-		if (cell == error_cell) {
-			return false;
-		}
+		return this->loaded_region_max;
+	}
 
-		if (this->cell_process.count(cell) == 0) {
-			return false;
-		}
+	/*!
+	Sets the region of the grid loaded by start_loading_grid_data().
 
-		if (this->cell_data.count(cell) == 0) {
-			return false;
-		}
+	Only cells in the file that overlap the box between given
+	coordinates, resolved with get_indices() of geometry read from
+	the file, are created and their data read. Other cells of the
+	file are skipped and refinement level 0 cells outside the region,
+	which always exist, are default constructed. Only the list of
+	cells in the file is read completely so I/O of cell data is
+	proportional to the size of the region.
 
-		const int refinement_level = this->mapping.get_refinement_level(cell);
+	By default the region covers the whole grid. Throws
+	std::invalid_argument if min_coordinate > max_coordinate
+	in any dimension.
 
-		#ifdef DEBUG
-		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
-			throw std::runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
-		}
+	Must be called before start_loading_grid_data()
+	on all processes with identical arguments.
 
-		// not if cell has children
-		if (cell != this->get_child(cell)) {
-			throw std::runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+	\see
+	set_loaded_refinement_levels()
+	load_grid_data()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_loaded_region(
+		const std::array<double, 3>& min_coordinate,
+		const std::array<double, 3>& max_coordinate
+	) {
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (not (min_coordinate[dim] <= max_coordinate[dim])) {
+				throw std::invalid_argument(
+					"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+					+ "Minimum coordinate of loaded region larger than maximum in dimension "
+					+ std::to_string(dim) + ": " + std::to_string(min_coordinate[dim])
+					+ " > " + std::to_string(max_coordinate[dim])
+				);
+			}
 		}
-		#endif
+		this->loaded_region_min = min_coordinate;
+		this->loaded_region_max = max_coordinate;
+		return *this;
+	}
 
-		if (refinement_level == this->mapping.get_maximum_refinement_level()) {
-			this->dont_unrefine(cell);
-			return true;
-		}
-
-		if (this->cells_not_to_refine.count(cell) > 0) {
-			return false;
-		}
-		const auto* const neighbors = this->get_neighbors_of(cell);
-		if (neighbors == nullptr) {
-			throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
-		}
-		for (const auto& neighbor: *neighbors) {
-			if (
-				this->mapping.get_refinement_level(neighbor.first) < refinement_level
-				and this->cells_not_to_refine.count(neighbor.first) > 0
-			) {
-				return false;
-			}
-		}
+	/*!
+	Returns the minimum and maximum refinement level loaded by load_grid_data().
 
-		this->cells_to_refine.insert(cell);
+	\see
+	set_loaded_refinement_levels()
+	*/
+	const std::pair<int, int>& get_loaded_refinement_levels() const
+	{
+		return this->loaded_refinement_levels;
+	}
 
-		// override local unrefines
-		const std::vector<uint64_t> siblings = this->get_all_children(this->get_parent(cell));
-		for (const auto& sibling: siblings) {
-			this->cells_to_unrefine.erase(sibling);
-		}
+	/*!
+	Sets the range of refinement levels loaded by start_loading_grid_data().
 
-		for(const auto& neighbor_i: this->neighbors_of.at(cell)) {
+	Data is read only for cells in the file whose refinement level
+	is in the given inclusive range. Instead of cells of a larger
+	refinement level than maximum_level their ancestor of that
+	level is created, cells of a smaller refinement level than
+	minimum_level are created. Cells created without data are
+	default constructed. maximum_level < 0 means maximum refinement
+	level of the file which is also the default. Throws
+	std::invalid_argument if minimum_level < 0 or if
+	0 <= maximum_level < minimum_level.
 
-			if (this->mapping.get_refinement_level(neighbor_i.first) <= refinement_level) {
-				const std::vector<uint64_t> neighbor_siblings
-					= this->get_all_children(this->get_parent(neighbor_i.first));
+	Must be called before start_loading_grid_data()
+	on all processes with identical arguments.
 
-				for(const auto& sibling: neighbor_siblings) {
-					this->cells_to_unrefine.erase(sibling);
-				}
-			}
+	\see
+	set_loaded_region()
+	load_grid_data()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_loaded_refinement_levels(const int minimum_level, const int maximum_level = -1)
+	{
+		if (minimum_level < 0 or (maximum_level >= 0 and maximum_level < minimum_level)) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Invalid range of loaded refinement levels: "
+				+ std::to_string(minimum_level) + ", " + std::to_string(maximum_level)
+			);
 		}
+		this->loaded_refinement_levels = std::make_pair(minimum_level, maximum_level);
+		return *this;
+	}
 
-		for(const auto& neighbor_i: this->neighbors_to.at(cell)) {
+	/*!
+	Returns whether loaded cells are assigned to processes by size of their data.
 
-			if (this->mapping.get_refinement_level(neighbor_i.first) <= refinement_level) {
-				const std::vector<uint64_t> neighbor_siblings
-					= this->get_all_children(this->get_parent(neighbor_i.first));
+	\see
+	set_balanced_loading()
+	*/
+	bool get_balanced_loading() const
+	{
+		return this->balanced_loading;
+	}
 
-				for(const auto& sibling: neighbor_siblings) {
-					this->cells_to_unrefine.erase(sibling);
-				}
-			}
-		}
+	/*!
+	Sets how start_loading_grid_data() assigns cells to processes.
+
+	By default refinement level 0 cells are assigned to processes as
+	in initialize() and loaded cells to the owner of their level 0
+	parent, which after restarting with a different number of
+	processes usually requires balance_load(). If given == true
+	level 0 cells are instead sorted in Morton order and split into
+	contiguous ranges with equal total size of data of their loaded
+	descendants in the file, so that cells are read directly into
+	a balanced and local partition. The list of cells in the file
+	is read twice and every process temporarily stores one uint64_t
+	per refinement level 0 cell. Disabled by default.
+
+	Must be called before start_loading_grid_data()
+	on all processes with the same value.
 
-		return true;
+	\see
+	load_grid_data()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_balanced_loading(const bool given)
+	{
+		this->balanced_loading = given;
+		return *this;
 	}
 
 
 	/*!
-	Removes the given cell and its siblings from the grid.
+	Restores grid state from given file written by save_grid_data() starting at given offset.
 
-	Refining (including induced refining) takes priority over unrefining.
-	Refines / unrefines take effect only after a call to stop_refining()
-	and are lost after a call to balance_load().
-	Returns true on success.
-	Does nothing and returns true in at least the following cases:
-		- dont_unrefine was called previously for given cell or its siblings
-		- given cell or one of its siblings has already been unrefined
-		  and stop_refining() has not been called
-		- given cells refinement level is 0
-	Does nothing and returns false in the following cases:
-		- given error_cell
-		- given cell doesn't exist on this process
-		- given cell or its siblings have children
+	Call this instead of initialize() to create an instance of the grid from a file.
+	See initialize() for an explanation of given_comm, load_balancing_method and
+	sfc_caching_bathces. Each process reads at most number_of_cells
+	cell ids and data offsets at a time, give a smaller number if the
+	file's share of one process won't fit into memory at once.
 
-	After a cell and its siblings have been unrefined, their data has been moved
-	to their parent's process.
-	When no longer needed that data can be freed using clear_refined_unrefined_data.
+	All processes read the same data defined by the given header starting at
+	given file offset in bytes. The header does not have to be defined on
+	other processes.
+
+	Must be called by all processes of given_comm and with identical arguments.
+
+	Returns true on success and false otherwise.
+
+	If delta_name isn't empty records of given file written by
+	save_grid_data_delta() after saving given file are applied in
+	order on top of loaded cell data.
+
+	Only a part of the grid is loaded if set_loaded_region() or
+	set_loaded_refinement_levels() was called before this function.
+
+	During this function the sending process given to the cells'
+	mpi_datatype function is -1 and receiving == true.
 
 	\see
-	refine_completely()
-	unrefine_completely()
+	load_cells()
+	save_grid_data()
+	save_grid_data_delta()
 	*/
-	bool unrefine_completely(const uint64_t cell)
-	{
-		if (cell == error_cell) {
+	bool load_grid_data(
+		const std::string& name,
+		MPI_Offset offset,
+		std::tuple<void*, int, MPI_Datatype> header,
+		const MPI_Comm& given_comm,
+		const char* const load_balancing_method,
+		const uint64_t sfc_caching_batches = 1,
+		const uint64_t number_of_cells = ~uint64_t(0),
+		const std::string& delta_name = std::string()
+	) {
+		if (
+			!this->start_loading_grid_data(
+				name,
+				offset,
+				header,
+				given_comm,
+				load_balancing_method,
+				sfc_caching_batches,
+				number_of_cells
+			)
+		) {
 			return false;
 		}
 
-		if (this->cell_process.count(cell) == 0) {
+		if (delta_name.size() > 0 and !this->start_loading_grid_data_delta(delta_name)) {
 			return false;
 		}
 
-		if (this->cell_data.count(cell) == 0) {
+		if (!this->continue_loading_grid_data()) {
 			return false;
 		}
 
-		if (this->mapping.get_refinement_level(cell) == 0) {
-			return true;
+		if (!this->finish_loading_grid_data()) {
+			return false;
 		}
 
-		const std::vector<uint64_t> siblings = this->get_all_children(this->get_parent(cell));
+		return true;
+	}
 
-		// don't unrefine if any sibling...
-		for(const auto& sibling: siblings) {
 
-			// ...has children
-			if (sibling != this->get_child(sibling)) {
-				return false;
-			}
+	/*!
+	Initializes dccrg from given file with data starting at given offset in bytes.
 
-			// ...cannot be unrefined
-			if (this->cells_to_refine.count(sibling) > 0
-			|| this->cells_not_to_unrefine.count(sibling) > 0) {
-				return true;
-			}
-		}
+	Given header is read first at given offset which should have the same int and
+	MPI_Datatype data when the file was written.
 
-		// unrefinement succeeds if parent of unrefined will fulfill requirements
-		const uint64_t parent = this->get_parent(cell);
-		const int refinement_level = this->mapping.get_refinement_level(parent);
+	After calling this function the cell data can start to be loaded with one or
+	more calls to continue_loading_grid_data().
 
-		#ifdef DEBUG
-		if (parent == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Invalid parent" << std::endl;
-			abort();
-		}
+	Each process reads an equal contiguous part of the list of cells
+	in the file, at most number_of_cells cells at a time, and sends
+	the cells to the process owning their refinement level 0 parent,
+	so no process has to store the whole list in memory.
 
-		if (refinement_level < 0) {
+	Before doing any other collective operations with the grid, the function
+	finish_loading_grid_data() should be called, either after this function
+	or after the last call to continue_loading_grid_data().
+
+	Returns true on success, false otherwise.
+
+	\see
+	load_grid_data()
+	*/
+	bool start_loading_grid_data(
+		const std::string& name,
+		MPI_Offset offset,
+		std::tuple<void*, int, MPI_Datatype> header,
+		const MPI_Comm& given_comm,
+		const char* const load_balancing_method,
+		const uint64_t sfc_caching_batches = 1,
+		const uint64_t number_of_cells = ~uint64_t(0)
+	) {
+		int ret_val = -1;
+
+		if (!this->initialize_mpi(given_comm)) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Invalid refinement level for parent"
+				<< " Couldn't initialize MPI"
 				<< std::endl;
-			abort();
+			return false;
 		}
-		#endif
-
-		const auto neighbors
-			= this->find_neighbors_of(
-				parent,
-				this->neighborhood_of,
-				2 * this->max_ref_lvl_diff,
-				true
-			);
-
-		for(const auto& neighbor_i: neighbors) {
-			const auto& neighbor = neighbor_i.first;
 
-			const int neighbor_ref_lvl = this->mapping.get_refinement_level(neighbor);
+		ret_val = MPI_File_open(
+			given_comm,
+			const_cast<char*>(name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&(this->grid_data_file)
+		);
+		if (ret_val != MPI_SUCCESS) {
+			if (this->rank == 0) {
+				std::cerr << "Couldn't open file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+			}
+			return false;
+		}
 
-			if (neighbor_ref_lvl > refinement_level + this->max_ref_lvl_diff) {
-				return true;
+		// verify file before reading anything else from it
+		File_Checksums checksums;
+		if (checksums.read(this->grid_data_file)) {
+			this->loading_data_end = checksums.end;
+		} else {
+			MPI_Offset file_size = 0;
+			ret_val = MPI_File_get_size(this->grid_data_file, &file_size);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't get size of file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
 			}
+			this->loading_data_end = uint64_t(file_size);
 
-			if (neighbor_ref_lvl == refinement_level + this->max_ref_lvl_diff
-			&& this->cells_to_refine.count(neighbor) > 0) {
-				return true;
+			if (this->checkpoint_checksums) {
+				if (this->rank == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " File " << name << " doesn't have checksums"
+						<< std::endl;
+				}
+				return false;
 			}
 		}
 
-		// record only one sibling to unrefine / process
-		for(const auto& sibling: siblings) {
-			if (this->cells_to_unrefine.count(sibling) > 0) {
-				return true;
+		if (this->checkpoint_checksums) {
+			std::vector<uint64_t> bad_blocks;
+			if (!checksums.verify(this->grid_data_file, this->comm, bad_blocks)) {
+				return false;
+			}
+			if (bad_blocks.size() > 0) {
+				if (this->rank == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " File " << name << " is corrupted, "
+						<< bad_blocks.size() << " block(s) of "
+						<< checksums.block_size << " bytes don't match checksums:";
+					for (const auto& block: bad_blocks) {
+						std::cerr << " " << block;
+					}
+					std::cerr << std::endl;
+				}
+				return false;
 			}
 		}
 
-		this->cells_to_unrefine.insert(cell);
+		// read in user's header
+		MPI_Datatype header_type = std::get<2>(header);
 
-		return true;
-	}
+		if (!Is_Named_Datatype()(header_type)) {
+			ret_val = MPI_Type_commit(&header_type);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< "Process " << this->rank
+					<< " Couldn't commit header datatype: "
+					<< Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
 
+		ret_val = MPI_File_read_at_all(
+			this->grid_data_file,
+			offset,
+			std::get<0>(header),
+			std::get<1>(header),
+			header_type,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't read header from file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
 
-	/*!
-	Prevents the given cell or its siblings from being unrefined.
+		int header_size = 0;
+		if (MPI_Type_size(header_type, &header_size) != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
+			return false;
+		}
+		header_size *= std::get<1>(header);
+		offset += (MPI_Offset) header_size;
 
-	Has an effect only during the next call to stop_refining().
-	Has no effect if balance_load() is called before stop_refining().
-	Returns true on success.
-	Doesn't prevent refining given cell.
-	Does nothing and returns true in at least the following cases:
-		- given cell's refinement level is 0
-		- given cell or its sibling(s) already marked by this
-	Does nothing and returns false in the following cases:
-		- given error_cell
-		- given cell doesn't exist on this process
-		- given cell has children
-		- given cell's refinement level is 0
+		if (!Is_Named_Datatype()(header_type)) {
+			ret_val = MPI_Type_free(&header_type);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't free header datatype: "
+					<< Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+		}
 
-	\see
-	dont_refine()
-	dont_unrefine_at()
-	refine_completely()
-	*/
-	bool dont_unrefine(const uint64_t cell)
-	{
-		if (cell == error_cell) {
+		// check endianness
+		uint64_t
+			endianness_original = 0x1234567890abcdef,
+			endianness_read = 0;
+
+		ret_val = MPI_File_read_at_all(
+			this->grid_data_file,
+			offset,
+			&endianness_read,
+			1,
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			if (this->rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't read endianness check from file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+			}
 			return false;
 		}
+		offset += sizeof(uint64_t);
 
-		if (this->cell_process.count(cell) == 0) {
+		if (endianness_original != endianness_read) {
+			if (this->rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " File " << name
+					<< " has wrong endianness, value from file is "
+					<< endianness_read
+					<< " but should be " << endianness_original
+					<< std::endl;
+			}
 			return false;
 		}
 
-		#ifdef DEBUG
-		if (this->cell_data.count(cell) == 0) {
-			throw std::runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		this->load_balancing_method = load_balancing_method;
+		if (!this->initialize_zoltan()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't initialize Zoltan"
+				<< std::endl;
+			return false;
 		}
 
-		if (this->cell_process.count(this->mapping.get_child(cell)) > 0) {
-			throw std::runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		// initialize mapping
+		if (!this->mapping_rw.read(this->grid_data_file, offset)) {
+			if (rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't read mapping"
+					<< std::endl;
+			}
+			return false;
 		}
-		#endif
+		offset += this->mapping.data_size();
 
-		if (this->mapping.get_refinement_level(cell) == 0) {
-			return true;
+		// initialize default neighborhood
+		unsigned int neighborhood_length = 0;
+		ret_val = MPI_File_read_at_all(
+			this->grid_data_file,
+			offset,
+			(void*) &neighborhood_length,
+			1,
+			MPI_UNSIGNED,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			if (rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't read length of cells' neighborhoods: " << Error_String()(ret_val)
+					<< std::endl;
+			}
+			return false;
 		}
+		offset += sizeof(unsigned int);
+		this->neighborhood_length = neighborhood_length;
+		this->initialize_neighborhoods();
 
-		// record only one sibling / process
-		const std::vector<uint64_t> siblings = this->get_all_children(this->get_parent(cell));
-		for(const auto& sibling: siblings) {
-			if (this->cells_not_to_unrefine.count(sibling) > 0) {
-				return true;
+		// initialize topology
+		if (!this->topology_rw.read(this->grid_data_file, offset)) {
+			if (rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't read grid topology from file"
+					<< std::endl;
 			}
+			return false;
 		}
+		offset += this->topology.data_size();
 
-		// override local unrefines
-		for(const auto& sibling: siblings) {
-			this->cells_to_unrefine.erase(sibling);
+		// initialize geometry
+		if (!this->geometry_rw.read(this->grid_data_file, offset)) {
+			if (this->rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't read geometry from file"
+					<< std::endl;
+			}
+			return false;
 		}
+		offset += this->geometry.data_size();
 
-		this->cells_not_to_unrefine.insert(cell);
-
-		return true;
-	}
-
+		this->initialize_load_filter();
 
-	/*!
-	As dont_unrefine but prevents refinement of given cell.
+		// read the total number of cells in the file
+		uint64_t total_number_of_cells = 0;
+		ret_val = MPI_File_read_at_all(
+			this->grid_data_file,
+			offset,
+			&total_number_of_cells,
+			1,
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << "Couldn't read total number of cells" << std::endl;
+			return false;
+		}
+		offset += sizeof(uint64_t);
 
-	Doesn't prevent unrefining given cell.
-	Returns true and does nothing if given cell:
-		- is of maximum refinement level
-	*/
-	bool dont_refine(const uint64_t cell)
-	{
-		using std::to_string;
+		this->loading_codec.reset();
+		this->loading_blocks.clear();
+		this->loaded_blocks.clear();
+		if (total_number_of_cells == compressed_cells_marker) {
+			if (!this->read_compressed_header(name, offset, total_number_of_cells)) {
+				return false;
+			}
+		}
 
-		#ifdef DEBUG
-		if (not this->grid_initialized) {
+		// initial cells must exist along with neighbor lists,
+		// etc. before loading the grid.
+		this->create_level_0_cells(sfc_caching_batches);
+		if (
+			this->balanced_loading
+			and !this->assign_level_0_cells_by_data_size(
+				offset,
+				total_number_of_cells,
+				number_of_cells
+			)
+		) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " DCCRG not initialized before calling " << __func__
+				<< " Process " << this->rank
+				<< " Couldn't assign cells by size of their data in file " << name
 				<< std::endl;
-			abort();
+			return false;
 		}
-		#endif
-
-		if (cell == error_cell) {
+		if (!this->initialize_neighbors()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't initialize neighbors"
+				<< std::endl;
 			return false;
 		}
 
-		if (this->cell_process.count(cell) == 0) {
+		// read cells and data displacements of this process
+		if (
+			!this->read_cells_and_data_displacements(
+				offset,
+				total_number_of_cells,
+				number_of_cells
+			)
+		) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't read cells and data displacements from file " << name
+				<< std::endl;
 			return false;
 		}
 
-		#ifdef DEBUG
-		if (this->cell_process.count(this->mapping.get_child(cell)) > 0) {
-			throw std::runtime_error(__FILE__ "(" + to_string(__LINE__) + ")");
+		// refine the grid to create cells that exist in the file
+		std::vector<uint64_t> final_cells;
+		final_cells.reserve(this->cells_and_data_displacements.size());
+		for (std::vector<std::pair<uint64_t, uint64_t> >::const_iterator
+			item = this->cells_and_data_displacements.begin();
+			item != this->cells_and_data_displacements.end();
+			item++
+		) {
+			final_cells.push_back(item->first);
 		}
-		#endif
 
-		if (
-			this->mapping.get_refinement_level(cell)
-			== this->mapping.get_maximum_refinement_level()
-		) {
-			return true;
+		if (!this->load_cells(final_cells)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't load grid"
+				<< std::endl;
+			abort();
 		}
+		final_cells.clear();
 
-		// override local refines
-		this->cells_to_refine.erase(cell);
+		// load_cells() updates these only if cells were refined
+		this->allocate_copies_of_remote_neighbors();
+		this->update_cell_pointers();
 
-		this->cells_not_to_refine.insert(cell);
+		// cells created without data are last in file order
+		while (
+			this->cells_and_data_displacements.size() > 0
+			and this->cells_and_data_displacements.back().second == no_cell_data
+		) {
+			this->cells_and_data_displacements.pop_back();
+		}
+
+		if (
+			not this->load_filtered
+			and this->cell_data.size() != this->cells_and_data_displacements.size()
+		) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Incorrect number of cell data displacements: "
+				<< this->cells_and_data_displacements.size()
+				<< ", should be " << this->cell_data.size()
+				<< std::endl;
+			abort();
+		}
+
+		this->grid_initialized = true;
 
 		return true;
 	}
 
 	/*!
-	Returns cells which share a face with the given cell.
+	Prepares applying records of given delta file on top of loaded data.
 
-	Only those cells are returned which are considered as neighbors
-	by given cell.
-	Uses the default neighborhood.
-	Does not return error_cell as a face neighbor.
-	Returns nothing in the same cases as get_neighbors_of().
+	Must be called after start_loading_grid_data() and before
+	continue_loading_grid_data() which then reads data of each local
+	cell from the last record of given file written by
+	save_grid_data_delta() that contains the cell, and from the file
+	of the full save only if no record contains the cell. Each process
+	reads an equal part of the list of cells of every record and sends
+	cells to their owners. The delta file is closed by
+	finish_loading_grid_data().
 
-	uint64_t == neighbor id, int == neighbor direction.
-	Directions are +N or -N where N is the Nth dimension and
-	+ means positive direction and - negative in that dimension,
-	e.g. +1 is positive x direction, -3 negative z.
+	Must be called by all processes with identical arguments.
+	Returns true on success, false otherwise.
 
-	TODO:
-	By default uses neighborhood with which this dccrg was initialized,
 	\see
-	default_neighborhood_id()
-	get_neighbors_of()
+	save_grid_data_delta()
+	load_grid_data()
 	*/
-	std::vector<std::pair<uint64_t, int> > get_face_neighbors_of(
-		const uint64_t cell/*,
-		const int neighborhood_id = default_neighborhood_id*/
-	) const {
-		std::vector<std::pair<uint64_t, int> > ret_val;
+	bool start_loading_grid_data_delta(const std::string& name)
+	{
+		if (this->delta_records.size() > 0 or this->delta_data_file_open) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Delta file already being loaded"
+				<< std::endl;
+			return false;
+		}
 
-		if (this->cell_data.count(cell) == 0) {
-			return ret_val;
+		int ret_val = MPI_File_open(
+			this->comm,
+			const_cast<char*>(name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&(this->delta_data_file)
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't open file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
 		}
+		this->delta_data_file_open = true;
 
-		// get location of face neighbors' offsets in neighborhood_of
-		std::array<size_t, 2 * 3> neighborhood_of_indices = {{0, 0, 0, 0, 0, 0}};
-		for (int direction = -1; direction <= 1; direction += 2)
-		for (size_t dimension = 0; dimension < 3; dimension++) {
+		MPI_Offset file_size = 0;
+		ret_val = MPI_File_get_size(this->delta_data_file, &file_size);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't get size of file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
 
-			// neigh_of_indices[n] == negative direction in dimension n,
-			// n + 1 positive direction
-			const size_t neigh_of_indices_index
-				= 2 * dimension + ((direction > 0) ? 1 : 0);
+		// latest record with each local cell and offset of cell's data in it
+		std::unordered_map<uint64_t, std::pair<size_t, uint64_t>> latest_data;
+		size_t number_of_records = 0;
+
+		MPI_Offset record_start = 0;
+		std::vector<uint64_t> record_cells;
+		std::vector<std::vector<uint64_t>>
+			sends(this->comm_size),
+			receives(this->comm_size);
+		while (record_start < file_size) {
+			std::array<uint64_t, 3> record_header{{0, 0, 0}};
+			ret_val = MPI_File_read_at_all(
+				this->delta_data_file,
+				record_start,
+				(void*) record_header.data(),
+				3,
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't read delta record header from file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
 
-			for (size_t i = 0; i <= this->neighborhood_of.size(); i++) {
-				if (i == this->neighborhood_of.size()) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Neighborhood_of offsets not found for face neighbors in dimension: "
-						<< dimension << ", direction: " << direction
-						<< std::endl;
-					abort();
-				}
+			const uint64_t
+				record_number_of_cells = record_header[1],
+				record_size = record_header[2],
+				comm_size = this->comm_size,
+				rank = this->rank,
+				cells_per_process = (record_number_of_cells + comm_size - 1) / comm_size,
+				first_cell = std::min(record_number_of_cells, rank * cells_per_process),
+				last_cell = std::min(record_number_of_cells, first_cell + cells_per_process);
+			if (
+				record_header[0] != delta_record_marker
+				or record_size < 3 * sizeof(uint64_t) + 2 * record_number_of_cells * sizeof(uint64_t)
+				or uint64_t(record_start) + record_size > uint64_t(file_size)
+				or 2 * cells_per_process > uint64_t(INT_MAX)
+			) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Invalid delta record at offset " << record_start
+					<< " in file " << name
+					<< std::endl;
+				return false;
+			}
 
-				bool found = true;
-				for (size_t other_dims = 0; other_dims < 3; other_dims++) {
-					if (other_dims != dimension
-					&& this->neighborhood_of[i][other_dims] != 0) {
-						found = false;
-						break;
-					}
+			record_cells.resize(2 * (last_cell - first_cell));
+			ret_val = MPI_File_read_at_all(
+				this->delta_data_file,
+				record_start + MPI_Offset((3 + 2 * first_cell) * sizeof(uint64_t)),
+				record_cells.size() > 0 ? (void*) record_cells.data() : (void*) record_header.data(),
+				int(record_cells.size()),
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't read cells of delta record from file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+
+			// loaded cells are on the process of their level 0 parent
+			std::vector<uint64_t> parents;
+			parents.reserve(record_cells.size() / 2);
+			for (size_t i = 0; i < record_cells.size(); i += 2) {
+				parents.push_back(this->mapping.get_level_0_parent(record_cells[i]));
+			}
+			if (this->distributed_ownership) {
+				this->fetch_cell_process(parents);
+			}
+
+			for (auto& send: sends) {
+				send.clear();
+			}
+			for (size_t i = 0; i < parents.size(); i++) {
+				// invalid cells aren't counted below
+				const auto owner = this->cell_process.find(parents[i]);
+				if (owner == this->cell_process.end()) {
+					continue;
 				}
+				auto& send = sends[owner->second];
+				send.push_back(record_cells[2 * i]);
+				send.push_back(record_cells[2 * i + 1]);
+			}
 
-				if (this->neighborhood_of[i][dimension] != direction) {
-					found = false;
+			All_To_All()(sends, receives, this->comm);
+
+			uint64_t local_cells = 0;
+			for (const auto& receive: receives) {
+				for (size_t i = 0; i < receive.size(); i += 2) {
+					const uint64_t cell = receive[i];
+					if (this->cell_data.count(cell) == 0) {
+						continue;
+					}
+					local_cells++;
+					if (this->load_filtered and not this->filtered_cell_has_data(cell)) {
+						continue;
+					}
+					latest_data[cell] = std::make_pair(number_of_records, receive[i + 1]);
 				}
+			}
 
-				if (found) {
-					neighborhood_of_indices[neigh_of_indices_index] = i;
-					break;
+			// all cells in record must exist in loaded grid
+			if (
+				not this->load_filtered
+				and All_Reduce()(local_cells, this->comm) != record_number_of_cells
+			) {
+				if (this->rank == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Delta record at offset " << record_start
+						<< " in file " << name
+						<< " has cells that don't exist in loaded grid"
+						<< std::endl;
 				}
+				return false;
 			}
-		}
 
-		// gather cells in given cell's neighbor_of list at indices found above
-		std::array<size_t, 2 * 3> current_index = {{0, 0, 0, 0, 0, 0}};
-		const int refinement_level = this->mapping.get_refinement_level(cell);
+			record_start += MPI_Offset(record_size);
+			number_of_records++;
+		}
 
-		for (size_t
-			neighbor_i = 0;
-			neighbor_i < this->neighbors_of.at(cell).size();
-			neighbor_i++
-		) {
+		// only data from latest record of each cell has to be read
+		this->delta_records.resize(number_of_records);
+		for (const auto& item: latest_data) {
+			this->delta_records[item.second.first].push_back(
+				std::make_pair(item.first, item.second.second)
+			);
+		}
 
-			const auto neighbor = this->neighbors_of.at(cell)[neighbor_i].first;
+		/*
+		Don't read data of cells in records from the full save,
+		otherwise in several calls to continue_loading_grid_data()
+		datatypes of cells for the full save would be given by data
+		loaded from records.
+		*/
+		this->cells_and_data_displacements.erase(
+			std::remove_if(
+				this->cells_and_data_displacements.begin(),
+				this->cells_and_data_displacements.end(),
+				[&latest_data](const std::pair<uint64_t, uint64_t>& item) {
+					return latest_data.count(item.first) > 0;
+				}
+			),
+			this->cells_and_data_displacements.end()
+		);
 
-			if (neighbor == error_cell) {
-				for (size_t i = 0; i < current_index.size(); i++) {
-					current_index[i]++;
+		// file view displacements must be monotonically nondecreasing
+		for (auto& record: this->delta_records) {
+			std::sort(
+				record.begin(),
+				record.end(),
+				[](
+					const std::pair<uint64_t, uint64_t>& a,
+					const std::pair<uint64_t, uint64_t>& b
+				) {
+					return a.second < b.second;
 				}
-				continue;
-			}
+			);
+		}
 
-			const int neigh_ref_lvl = this->mapping.get_refinement_level(neighbor);
+		return true;
+	}
 
-			for (int direction = -1; direction <= 1; direction += 2)
-			for (size_t dimension = 0; dimension < 3; dimension++) {
 
-				// neigh_of_indices[n] == negative direction, n + 1 positive
-				const size_t neigh_of_indices_index
-					= 2 * dimension + ((direction > 0) ? 1 : 0);
+	/*!
+	Starts/continues reading cell data from given file.
 
-				// at correct index in neighbors_of for current dim & dir
-				if (current_index[neigh_of_indices_index]
-				== neighborhood_of_indices[neigh_of_indices_index]) {
+	Data for each cell in the file is assumed to be in format given by
+	each cells' get_mpi_datatype() member function which should return
+	the same MPI_Datatype as it did when saving grid data to given file.
+	If complete MPI_Datatype of cell data used when saving isn't known
+	in advance the saving datatype should be constructed in such a way
+	that data whose size is always known should be first. Then you can
+	call this function several times and give the correct MPI_Datatype
+	from each cell based on the data loaded by previous calls to this
+	function. For example if cell data consists of a vector of ints
+	you should add the number of ints as a size_t variable into the cell
+	and return the size_t variable along with the vector data but so
+	that size_t is earlier in the MPI_Datatype. In other words the
+	memory layout of the returned MPI_Datatype should be:
+	size_t, 1st int, 2nd int, ...
 
-					int final_dir = int(dimension) + 1;
-					if (direction < 0) {
-						final_dir *= -1;
-					}
+	Before doing anything else with the grid the function finish_loading_grid_data()
+	should be called after this function.
 
-					// add one neighbor not smaller than given cell
-					if (neigh_ref_lvl <= refinement_level) {
+	Returns true on success, false otherwise.
 
-						ret_val.push_back(std::make_pair(neighbor, final_dir));
+	\see
+	start_loading_grid_data()
+	finish_loading_grid_data()
+	*/
+	bool continue_loading_grid_data()
+	{
+		// data of each cell is read either from full save or from delta records
+		uint64_t number_of_cells = this->cells_and_data_displacements.size();
+		for (const auto& record: this->delta_records) {
+			number_of_cells += record.size();
+		}
+		if (not this->load_filtered and this->cell_data.size() != number_of_cells) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Incorrect number of cell data displacements: "
+				<< number_of_cells
+				<< ", should be " << this->cell_data.size()
+				<< std::endl;
+			abort();
+		}
 
-					// add only face neighbors in current dim & dir
-					} else {
+		if (this->loading_codec) {
+			if (!this->continue_loading_compressed_cells()) {
+				return false;
+			}
+		} else {
+			if (!this->read_cell_data(this->grid_data_file, this->cells_and_data_displacements)) {
+				return false;
+			}
+		}
 
-						const uint64_t neighs_in_offset = uint64_t(1) << 3;
+		for (auto& record: this->delta_records) {
+			if (!this->read_cell_data(this->delta_data_file, record)) {
+				return false;
+			}
+		}
 
-						#ifdef DEBUG
-						if (this->neighbors_of.at(cell).size() < neighbor_i + neighs_in_offset) {
-							std::cerr << __FILE__ << ":" << __LINE__
-								<< " Invalid number of neighbors for cell " << cell
-								<< " while processing dimension " << dimension
-								<< " and direction " << direction
-								<< " starting at index " << neighbor_i
-								<< std::endl;
-							abort();
-						}
-						#endif
+		return true;
+	}
 
-						// see find_neighbors_of(...) for the order of these
-						std::vector<uint64_t> dir_neighs;
-						for (size_t i = neighbor_i; i < neighbor_i + neighs_in_offset; i++) {
-							dir_neighs.push_back(this->neighbors_of.at(cell)[i].first);
-						}
 
-						// neighbor at offset    0, 1, 2, 3, 4, 5, 6, 7 is
-						// face neighbor of given cell when neighbors are in
-						// dim = 0, dir = -1      , y,  , y,  , y,  , y
-						// dim = 0, dir = +1     y,  , y,  , y,  , y,
-						// dim = 1, dir = -1      ,  , y, y,  ,  , y, y
-						// dim = 1, dir = +1     y, y,  ,  , y, y,  ,
-						// dim = 2, dir = -1      ,  ,  ,  , y, y, y, y
-						// dim = 2, dir = +1     y, y, y, y,  ,  ,  ,
-						const size_t
-							batch_size = size_t(1) << dimension,
-							mod_target = (direction < 0) ? 1 : 0;
+	/*!
+	Finalizes reading cell data from given file.
 
-						for (size_t i = 0; i < neighs_in_offset; i++) {
+	Returns true on success, false otherwise.
 
-							#ifdef DEBUG
-							if (dir_neighs[i] == error_cell) {
-							std::cerr << __FILE__ << ":" << __LINE__
-								<< " Invalid neighbor of cell " << cell
-								<< " at index " << neighbor_i + i
-								<< std::endl;
-							abort();
-							}
-							#endif
-
-							if ((i / batch_size) % 2 == mod_target) {
-								ret_val.push_back(std::make_pair(dir_neighs[i], final_dir));
-							}
-						}
-					}
-				}
-
-				current_index[neigh_of_indices_index]++;
+	\see
+	start_loading_grid_data()
+	continue_loading_grid_data()
+	*/
+	bool finish_loading_grid_data()
+	{
+		this->cells_and_data_displacements.clear();
+		this->load_filtered = false;
+		this->loading_codec.reset();
+		this->loading_blocks.clear();
+		this->loaded_blocks.clear();
+		this->delta_records.clear();
+
+		if (this->delta_data_file_open) {
+			this->delta_data_file_open = false;
+			const int ret_val = MPI_File_close(&(this->delta_data_file));
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't close delta file: "
+					<< Error_String()(ret_val)
+					<< std::endl;
+				return false;
 			}
+		}
 
-			// skip all cells in this neighborhood offset
-			if (neigh_ref_lvl > refinement_level) {
-				neighbor_i += 7;
-			}
+		int ret_val = MPI_File_close(&(this->grid_data_file));
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't close input file: "
+				<< Error_String()(ret_val)
+				<< std::endl;
+			return false;
 		}
 
-		return ret_val;
+		return true;
 	}
 
 
 	/*!
-	Returns true if given cell's neighbor types match given criterion, false otherwise.
+	Creates all children of given cell (and possibly of other cells due to induced refinement).
 
-	Returns false if:
-		- given neighborhood doesn't exist
-		- given cell doesn't exist
-		- given cell is on another process
+	Takes priority over unrefining.
+	Refines / unrefines take effect only after a call to stop_refining() and are lost
+	after a call to balance_load().
+	Returns true on success.
+	Does nothing and returns true if given cell:
+		- is at maximum refinement level
+	Does nothing and returns false if given cell:
+		- isn't known to this process
+		- has, or any of its larger neighbors have, been marked by dont_refine()
+		- has already been refined (including induced refinement)
+		  and stop_refining() has not been called afterwards
+		- doesn't exist on this process
+	Children of refined cell(s) are created on their parent's process.
 
-	\see get_cells()
-	*/
-	bool is_neighbor_type_match(
-		const uint64_t cell,
-		const std::vector<int>& criteria,
-		const bool exact_match,
-		const int neighborhood_id
-	) const {
+	If given cell is at maximum refinement level dont_unrefine will be invoked instead.
 
+	\see
+	dont_refine()
+	refine_completely_at()
+	unrefine_completely()
+	stop_refining()
+	clear_refined_unrefined_data()
+	get_removed_cells()
+	*/
+	bool refine_completely(const uint64_t cell)
+	{
 		if (cell == error_cell) {
 			return false;
 		}
@@ -2821,1704 +3438,1602 @@ public:
 			return false;
 		}
 
-		if (this->cell_process.at(cell) != this->rank) {
+		if (this->cell_data.count(cell) == 0) {
 			return false;
 		}
 
-		if (neighborhood_id != default_neighborhood_id
-		&& this->user_hood_of.count(neighborhood_id) == 0) {
-			return false;
-		}
+		const int refinement_level = this->mapping.get_refinement_level(cell);
 
+		#ifdef DEBUG
+		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
+			throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+		}
 
-		int neighbor_types = 0;
+		// not if cell has children
+		if (cell != this->get_child(cell)) {
+			throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+		}
+		#endif
 
-		const std::vector<
-			std::pair<
-				uint64_t,
-				std::array<int, 4>
-			>
-		>& neighs_of
-			= [&](){
-				if (neighborhood_id == default_neighborhood_id) {
-					return this->neighbors_of.at(cell);
-				} else {
-					return this->user_neigh_of.at(neighborhood_id).at(cell);
-				}
-			}();
+		if (refinement_level == this->mapping.get_maximum_refinement_level()) {
+			this->dont_unrefine(cell);
+			return true;
+		}
 
-		for(const auto& neighbor_i: neighs_of) {
-			if (neighbor_i.first == error_cell) {
-				continue;
+		if (this->cells_not_to_refine.count(cell) > 0) {
+			return false;
+		}
+		const auto* const neighbors = this->get_neighbors_of(cell);
+		if (neighbors == nullptr) {
+			throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+		}
+		for (const auto& neighbor: *neighbors) {
+			if (
+				this->mapping.get_refinement_level(neighbor.first) < refinement_level
+				and this->cells_not_to_refine.count(neighbor.first) > 0
+			) {
+				return false;
 			}
+		}
 
-			if (this->is_local(neighbor_i.first)) {
-				neighbor_types |= has_local_neighbor_of;
-			} else {
-				neighbor_types |= has_remote_neighbor_of;
-			}
+		this->cells_to_refine.insert(cell);
+
+		// override local unrefines
+		const std::vector<uint64_t> siblings = this->get_all_children(this->get_parent(cell));
+		for (const auto& sibling: siblings) {
+			this->cells_to_unrefine.erase(sibling);
 		}
 
-		const std::vector<
-			std::pair<
-				uint64_t,
-				std::array<int, 4>
-			>
-		>& neighs_to
-			= [&](){
-				if (neighborhood_id == default_neighborhood_id) {
-					return this->neighbors_to.at(cell);
-				} else {
-					return this->user_neigh_to.at(neighborhood_id).at(cell);
-				}
-			}();
+		for(const auto& neighbor_i: this->neighbors_of.at(cell)) {
 
-		for (const auto& neighbor_i: neighs_to) {
-			if (neighbor_i.first == error_cell) {
-				continue;
-			}
+			if (this->mapping.get_refinement_level(neighbor_i.first) <= refinement_level) {
+				const std::vector<uint64_t> neighbor_siblings
+					= this->get_all_children(this->get_parent(neighbor_i.first));
 
-			if (this->is_local(neighbor_i.first)) {
-				neighbor_types |= has_local_neighbor_to;
-			} else {
-				neighbor_types |= has_remote_neighbor_to;
+				for(const auto& sibling: neighbor_siblings) {
+					this->cells_to_unrefine.erase(sibling);
+				}
 			}
 		}
 
+		for(const auto& neighbor_i: this->neighbors_to.at(cell)) {
 
-		if (exact_match) {
-			for(const auto& criterion: criteria) {
-				if (neighbor_types == criterion) {
-					return true;
-				}
-			}
-		} else {
-			// with inexact matching all criteria can be merged into one
-			int merged_criteria = 0;
-			for(const auto& criterion: criteria) {
-				merged_criteria |= criterion;
-			}
+			if (this->mapping.get_refinement_level(neighbor_i.first) <= refinement_level) {
+				const std::vector<uint64_t> neighbor_siblings
+					= this->get_all_children(this->get_parent(neighbor_i.first));
 
-			if ((neighbor_types & merged_criteria) > 0) {
-				return true;
+				for(const auto& sibling: neighbor_siblings) {
+					this->cells_to_unrefine.erase(sibling);
+				}
 			}
 		}
 
-		return false;
+		return true;
 	}
 
 
 	/*!
-	Returns the size of cells' neihgbourhood in every direction.
-	*/
-	unsigned int get_neighborhood_length() const
-	{
-		return this->neighborhood_length;
-	}
-
+	Removes the given cell and its siblings from the grid.
 
-	/*!
-	Returns all neighbors of given cell that are at given offset from it.
+	Refining (including induced refining) takes priority over unrefining.
+	Refines / unrefines take effect only after a call to stop_refining()
+	and are lost after a call to balance_load().
+	Returns true on success.
+	Does nothing and returns true in at least the following cases:
+		- dont_unrefine was called previously for given cell or its siblings
+		- given cell or one of its siblings has already been unrefined
+		  and stop_refining() has not been called
+		- given cells refinement level is 0
+	Does nothing and returns false in the following cases:
+		- given error_cell
+		- given cell doesn't exist on this process
+		- given cell or its siblings have children
 
-	Offset is in units of size of the given cell
-	Returns nothing in the following cases:
-		- given cell doesn't exist
-		- given cell is on another process
-		- any of given offsets is larger in absolute value than the neighborhood
-		  size or larger than 1 if neihgborhood size == 0
-		- x == 0 && y == 0 && z == 0
+	After a cell and its siblings have been unrefined, their data has been moved
+	to their parent's process.
+	When no longer needed that data can be freed using clear_refined_unrefined_data.
 
 	\see
-	get_neighbors_of()
+	refine_completely()
+	unrefine_completely()
 	*/
-	std::vector<
-		std::pair<
-			uint64_t,
-			std::array<int, 4>
-		>
-	> get_neighbors_of_at_offset(
-		const uint64_t cell,
-		const int x,
-		const int y,
-		const int z
-	) const {
-		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
-		if (
-			this->cell_process.count(cell) == 0
-			or this->cell_process.at(cell) != this->rank
-			or (x == 0 and y == 0 and z == 0)
-		) {
-			return return_neighbors;
+	bool unrefine_completely(const uint64_t cell)
+	{
+		if (cell == error_cell) {
+			return false;
 		}
 
-		for (const auto& neighbor_i: this->neighbors_of.at(cell)) {
-			const auto& offsets = neighbor_i.second;
-			if (offsets[3] <= 1) {
-				if (offsets[0] == x and offsets[1] == y and offsets[2] == z) {
-					return_neighbors.push_back(neighbor_i);
-				}
-			} else {
-				auto scaled_offsets = offsets;
-				for (size_t i = 0; i < 3; i++) {
-					if (std::abs(scaled_offsets[i]) <= 1) {
-						continue;
-					}
-					// round away from zero, stackoverflow.com/a/2745086
-					if (scaled_offsets[i] > 1) {
-						scaled_offsets[i] += scaled_offsets[3] - 1;
-					} else {
-						scaled_offsets[i] -= scaled_offsets[3] - 1;
-					}
-					scaled_offsets[i] /= scaled_offsets[3];
-				}
-				if (scaled_offsets[0] == x and scaled_offsets[1] == y and scaled_offsets[2] == z) {
-					return_neighbors.push_back(neighbor_i);
-				}
-			}
+		if (this->cell_process.count(cell) == 0) {
+			return false;
 		}
 
-		return return_neighbors;
-	}
+		if (this->cell_data.count(cell) == 0) {
+			return false;
+		}
 
+		if (this->mapping.get_refinement_level(cell) == 0) {
+			return true;
+		}
 
-	/*!
-	Returns neighbors of given local cell that are on another process.
+		const std::vector<uint64_t> siblings = this->get_all_children(this->get_parent(cell));
 
-	Returns nothing if:
-		- given cell doesn't exist
-		- given cell is on another process
-		- given cell doesn't have remote neighbors
-		- given neighborhood doesn't exist
+		// don't unrefine if any sibling...
+		for(const auto& sibling: siblings) {
 
-	By default returned cells are in random order but if sorted == true
-	they are sorted using std::sort before returning.
-	*/
-	std::vector<uint64_t> get_remote_neighbors_of(
-		const uint64_t cell,
-		const int neighborhood_id = default_neighborhood_id,
-		const bool sorted = false
-	) const {
-		std::vector<uint64_t> ret_val;
+			// ...has children
+			if (sibling != this->get_child(sibling)) {
+				return false;
+			}
 
-		if (this->cell_process.count(cell) == 0) {
-			return ret_val;
+			// ...cannot be unrefined
+			if (this->cells_to_refine.count(sibling) > 0
+			|| this->cells_not_to_unrefine.count(sibling) > 0) {
+				return true;
+			}
 		}
 
-		if (this->cell_process.at(cell) != this->rank) {
-			return ret_val;
+		// unrefinement succeeds if parent of unrefined will fulfill requirements
+		const uint64_t parent = this->get_parent(cell);
+		const int refinement_level = this->mapping.get_refinement_level(parent);
+
+		#ifdef DEBUG
+		if (parent == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Invalid parent" << std::endl;
+			abort();
 		}
 
-		if (neighborhood_id != default_neighborhood_id
-		&& this->user_hood_of.count(neighborhood_id) == 0) {
-			return ret_val;
+		if (refinement_level < 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Invalid refinement level for parent"
+				<< std::endl;
+			abort();
 		}
+		#endif
 
-		const std::vector<uint64_t>& neighbors_ref
-			= (neighborhood_id == default_neighborhood_id)
-			? this->neighbors_of.at(cell)
-			: this->user_neigh_of.at(neighborhood_id).at(cell);
+		const auto neighbors
+			= this->find_neighbors_of(
+				parent,
+				this->neighborhood_of,
+				2 * this->max_ref_lvl_diff,
+				true
+			);
 
-		for(const auto& neighbor: neighbors_ref) {
+		for(const auto& neighbor_i: neighbors) {
+			const auto& neighbor = neighbor_i.first;
 
-			if (neighbor == error_cell) {
-				continue;
+			const int neighbor_ref_lvl = this->mapping.get_refinement_level(neighbor);
+
+			if (neighbor_ref_lvl > refinement_level + this->max_ref_lvl_diff) {
+				return true;
 			}
 
-			if (this->cell_process.at(neighbor) != this->rank) {
-				ret_val.push_back(neighbor);
+			if (neighbor_ref_lvl == refinement_level + this->max_ref_lvl_diff
+			&& this->cells_to_refine.count(neighbor) > 0) {
+				return true;
 			}
 		}
 
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
+		// record only one sibling to unrefine / process
+		for(const auto& sibling: siblings) {
+			if (this->cells_to_unrefine.count(sibling) > 0) {
+				return true;
+			}
 		}
 
-		return ret_val;
+		this->cells_to_unrefine.insert(cell);
+
+		return true;
 	}
 
+
 	/*!
-	Returns remote cells that consider given local cell as a neighbor.
+	Prevents the given cell or its siblings from being unrefined.
 
-	Returns nothing if given cell doesn't exist or is on another process
-	or doesn't have remote neighbors.
+	Has an effect only during the next call to stop_refining().
+	Has no effect if balance_load() is called before stop_refining().
+	Returns true on success.
+	Doesn't prevent refining given cell.
+	Does nothing and returns true in at least the following cases:
+		- given cell's refinement level is 0
+		- given cell or its sibling(s) already marked by this
+	Does nothing and returns false in the following cases:
+		- given error_cell
+		- given cell doesn't exist on this process
+		- given cell has children
+		- given cell's refinement level is 0
 
-	By default returned cells are in random order but if sorted == true
-	they are sorted using std::sort before returning.
+	\see
+	dont_refine()
+	dont_unrefine_at()
+	refine_completely()
 	*/
-	std::vector<uint64_t> get_remote_neighbors_to(
-		const uint64_t cell,
-		const int neighborhood_id = default_neighborhood_id,
-		const bool sorted = false
-	) const {
-		std::vector<uint64_t> ret_val;
+	bool dont_unrefine(const uint64_t cell)
+	{
+		if (cell == error_cell) {
+			return false;
+		}
 
 		if (this->cell_process.count(cell) == 0) {
-			return ret_val;
+			return false;
 		}
 
-		if (this->cell_process.at(cell) != this->rank) {
-			return ret_val;
+		#ifdef DEBUG
+		if (this->cell_data.count(cell) == 0) {
+			throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
 		}
 
-		if (neighborhood_id != default_neighborhood_id
-		&& this->user_hood_of.count(neighborhood_id) == 0) {
-			return ret_val;
+		if (cell != this->get_child(cell)) {
+			throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
 		}
+		#endif
 
-		const std::vector<uint64_t>& neighbors_ref
-			= (neighborhood_id == default_neighborhood_id)
-			? this->neighbors_to.at(cell)
-			: this->user_neigh_to.at(neighborhood_id).at(cell);
-
-		for(const auto& neighbor: neighbors_ref) {
-
-			if (neighbor == error_cell) {
-				continue;
-			}
+		if (this->mapping.get_refinement_level(cell) == 0) {
+			return true;
+		}
 
-			if (this->cell_process.at(neighbor) != this->rank) {
-				ret_val.push_back(neighbor);
+		// record only one sibling / process
+		const std::vector<uint64_t> siblings = this->get_all_children(this->get_parent(cell));
+		for(const auto& sibling: siblings) {
+			if (this->cells_not_to_unrefine.count(sibling) > 0) {
+				return true;
 			}
 		}
 
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
+		// override local unrefines
+		for(const auto& sibling: siblings) {
+			this->cells_to_unrefine.erase(sibling);
 		}
 
-		return ret_val;
+		this->cells_not_to_unrefine.insert(cell);
+
+		return true;
 	}
 
 
 	/*!
-	Returns true if given cell is on this process and false otherwise.
+	As dont_unrefine but prevents refinement of given cell.
+
+	Doesn't prevent unrefining given cell.
+	Returns true and does nothing if given cell:
+		- is of maximum refinement level
 	*/
-	bool is_local(const uint64_t cell) const
+	bool dont_refine(const uint64_t cell)
 	{
-		if (this->cell_process.count(cell) > 0
-		&& this->cell_process.at(cell) == this->rank) {
-			return true;
-		} else {
-			return false;
-		}
-	}
-
+		using std::to_string;
 
-	/*!
-	Writes the cells on this process into a vtk file with given name in ASCII format.
+		#ifdef DEBUG
+		if (not this->grid_initialized) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " DCCRG not initialized before calling " << __func__
+				<< std::endl;
+			abort();
+		}
+		#endif
 
-	The cells are written in ascending order.
-	Must be called simultaneously on all processes.
+		if (cell == error_cell) {
+			return false;
+		}
 
-	Returns true on success, false otherwise.
-	*/
-	bool write_vtk_file(const std::string& file_name) const
-	{
-		std::ofstream outfile(file_name);
-		if (!outfile.is_open()) {
-			std::cerr << "Couldn't open file " << file_name << std::endl;
+		if (this->cell_process.count(cell) == 0) {
 			return false;
 		}
 
-		std::vector<uint64_t> leaf_cells = this->get_cells();
+		#ifdef DEBUG
+		if (cell != this->get_child(cell)) {
+			throw std::runtime_error(__FILE__ "(" + std::to_string(__LINE__) + ")");
+		}
+		#endif
 
-		if (leaf_cells.size() > 0) {
-			std::sort(leaf_cells.begin(), leaf_cells.end());
+		if (
+			this->mapping.get_refinement_level(cell)
+			== this->mapping.get_maximum_refinement_level()
+		) {
+			return true;
 		}
 
-		outfile <<
-			"# vtk DataFile Version 2.0\n"
-			"Cartesian cell refinable grid\n"
-			"ASCII\n"
-			"DATASET UNSTRUCTURED_GRID\n";
+		// override local refines
+		this->cells_to_refine.erase(cell);
 
-		// write separate points for every cells corners
-		outfile << "POINTS " << leaf_cells.size() * 8 << " float" << std::endl;
-		for (size_t i = 0; i < leaf_cells.size(); i++) {
-			const std::array<double, 3>
-				cell_min = this->geometry.get_min(leaf_cells[i]),
-				cell_max = this->geometry.get_max(leaf_cells[i]);
-
-			outfile
-				<< cell_min[0] << " " << cell_min[1] << " " << cell_min[2] << "\n"
-				<< cell_max[0] << " " << cell_min[1] << " " << cell_min[2] << "\n"
-				<< cell_min[0] << " " << cell_max[1] << " " << cell_min[2] << "\n"
-				<< cell_max[0] << " " << cell_max[1] << " " << cell_min[2] << "\n"
-				<< cell_min[0] << " " << cell_min[1] << " " << cell_max[2] << "\n"
-				<< cell_max[0] << " " << cell_min[1] << " " << cell_max[2] << "\n"
-				<< cell_min[0] << " " << cell_max[1] << " " << cell_max[2] << "\n"
-				<< cell_max[0] << " " << cell_max[1] << " " << cell_max[2] << "\n";
-		}
-
-		// map cells to written points
-		outfile << "CELLS " << leaf_cells.size() << " " << leaf_cells.size() * 9 << std::endl;
-		for (unsigned int j = 0; j < leaf_cells.size(); j++) {
-			outfile << "8 ";
-			for (int i = 0; i < 8; i++) {
-				 outfile << j * 8 + i << " ";
-			}
-			outfile << std::endl;
-		}
-
-		// cell types
-		outfile << "CELL_TYPES " << leaf_cells.size() << std::endl;
-		for (unsigned int i = 0; i < leaf_cells.size(); i++) {
-			outfile << 11 << std::endl;
-		}
-
-		if (!outfile.good()) {
-			std::cerr << "Writing of vtk file probably failed" << std::endl;
-			// TODO: throw an exception instead
-			exit(EXIT_FAILURE);
-		}
-
-		outfile.close();
+		this->cells_not_to_refine.insert(cell);
 
 		return true;
 	}
 
 
 	/*!
-	As refine_completely(), but uses the smallest existing cell at given coordinates.
+	Thread-safe version of refine_completely().
+
+	Can be called concurrently from several threads, e.g. while
+	evaluating refinement criteria of local cells with Thread_Pool,
+	as long as no thread modifies the grid at the same time.
+	Given cell is only recorded and given to refine_completely()
+	at the beginning of initialize_refines() so return value
+	doesn't tell whether cell will be refined.
+	Returns false if given cell isn't local, true otherwise.
+
+	Concurrent requests are applied in the order dont_refine(),
+	refine_completely(), dont_unrefine(), unrefine_completely()
+	and in order of cell id within each kind so the result
+	doesn't depend on the order of calls from different threads.
+	Calls of the serial functions made before initialize_refines()
+	are applied before concurrent ones.
 
-	Does nothing in the same cases as refine_completely and additionally
-	if the coordinate is outside of the grid.
+	Example:
+	\verbatim
+	dccrg::Thread_Pool pool;
+	pool.parallel_for(grid.local_cells, [&grid](const Grid::cells_item_t& cell) {
+		if (...) {
+			grid.refine_completely_concurrent(cell.id);
+		}
+	});
+	grid.stop_refining();
+	\endverbatim
+	\see
+	unrefine_completely_concurrent()
+	dont_refine_concurrent()
+	dont_unrefine_concurrent()
 	*/
-	bool refine_completely_at(const std::array<double, 3>& coordinate)
+	bool refine_completely_concurrent(const uint64_t cell)
 	{
-		const uint64_t cell = this->get_existing_cell(coordinate);
-		if (cell == error_cell) {
-			return false;
-		}
-
-		return this->refine_completely(cell);
+		return this->add_concurrent_refine_request(cell, concurrent_refine);
 	}
 
-
-	/*!
-	As unrefine_completely(), but uses the smallest existing cell at given coordinates.
-
-	Does nothing in the same cases as unrefine_completely and additionally
-	if the coordinate is outside of the grid.
-	*/
-	bool unrefine_completely_at(const std::array<double, 3>& coordinate)
+	//! Thread-safe version of unrefine_completely(), \see refine_completely_concurrent()
+	bool unrefine_completely_concurrent(const uint64_t cell)
 	{
-		const uint64_t cell = this->get_existing_cell(coordinate);
-		if (cell == error_cell) {
-			return false;
-		}
-
-		return this->unrefine_completely(cell);
+		return this->add_concurrent_refine_request(cell, concurrent_unrefine);
 	}
 
-
-	/*!
-	As dont_unrefine() but uses the smallest existing cell at given coordinates.
-
-	Does nothing in the same cases as dont_unrefine and additionally if the
-	coordinate is outside of the grid.
-	*/
-	bool dont_unrefine_at(const std::array<double, 3>& coordinate)
+	//! Thread-safe version of dont_refine(), \see refine_completely_concurrent()
+	bool dont_refine_concurrent(const uint64_t cell)
 	{
-		const uint64_t cell = this->get_existing_cell(coordinate);
-		if (cell == error_cell) {
-			return false;
-		}
-
-		return this->dont_unrefine(cell);
+		return this->add_concurrent_refine_request(cell, concurrent_dont_refine);
 	}
 
+	//! Thread-safe version of dont_unrefine(), \see refine_completely_concurrent()
+	bool dont_unrefine_concurrent(const uint64_t cell)
+	{
+		return this->add_concurrent_refine_request(cell, concurrent_dont_unrefine);
+	}
 
 	/*!
-	Executes refines / unrefines that have been requested so far.
+	Returns cells which share a face with the given cell.
 
-	Must be called simultaneously on all processes.
-	Returns cells that were created by refinement on this process.
-	Moves user data of unrefined cells to the current process of their parent.
+	Only those cells are returned which are considered as neighbors
+	by given cell.
+	Uses the default neighborhood.
+	Does not return error_cell as a face neighbor.
+	Returns nothing in the same cases as get_neighbors_of().
 
-	By default returned cells are in random order but if sorted == true
-	they are sorted using std::sort before returning.
-	*/
-	void initialize_refines(const bool sorted = false)
-	{
-		if (this->refining) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " initialize_refining() called the second time "
-				<< "before calling finish_refining() first"
-				<< std::endl;
-			abort();
-		}
+	uint64_t == neighbor id, int == neighbor direction.
+	Directions are +N or -N where N is the Nth dimension and
+	+ means positive direction and - negative in that dimension,
+	e.g. +1 is positive x direction, -3 negative z.
 
-		this->refining = true;
+	TODO:
+	By default uses neighborhood with which this dccrg was initialized,
+	\see
+	default_neighborhood_id()
+	get_neighbors_of()
+	*/
+	std::vector<std::pair<uint64_t, int> > get_face_neighbors_of(
+		const uint64_t cell/*,
+		const int neighborhood_id = default_neighborhood_id*/
+	) const {
+		std::vector<std::pair<uint64_t, int> > ret_val;
 
-		phiprof::start("Override refines");
-		this->override_refines();
-		phiprof::stop("Override refines");
+		if (this->cell_data.count(cell) == 0) {
+			return ret_val;
+		}
 
-		phiprof::start("Induce refines");
-		this->induce_refines();
-		phiprof::stop("Induce refines");
+		// get location of face neighbors' offsets in neighborhood_of
+		std::array<size_t, 2 * 3> neighborhood_of_indices = {{0, 0, 0, 0, 0, 0}};
+		for (int direction = -1; direction <= 1; direction += 2)
+		for (size_t dimension = 0; dimension < 3; dimension++) {
 
-		phiprof::start("Override unrefines");
-		this->override_unrefines();
-		phiprof::stop("Override unrefines");
-	}
+			// neigh_of_indices[n] == negative direction in dimension n,
+			// n + 1 positive direction
+			const size_t neigh_of_indices_index
+				= 2 * dimension + ((direction > 0) ? 1 : 0);
 
+			for (size_t i = 0; i <= this->neighborhood_of.size(); i++) {
+				if (i == this->neighborhood_of.size()) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Neighborhood_of offsets not found for face neighbors in dimension: "
+						<< dimension << ", direction: " << direction
+						<< std::endl;
+					abort();
+				}
 
-	/*!
-	Adds refined cells to the grid, removes unrefined cells from the grid.
+				bool found = true;
+				for (size_t other_dims = 0; other_dims < 3; other_dims++) {
+					if (other_dims != dimension
+					&& this->neighborhood_of[i][other_dims] != 0) {
+						found = false;
+						break;
+					}
+				}
 
-	cells_to_refine and cells_to_unrefine must contain the cells to refine/unrefine of all processes.
-	Returns new cells created on this process by refinement.
-	Moves unrefined cell data to the process of their parent.
-	*/
-	std::vector<uint64_t> execute_refines()
-	{
-		#ifdef DEBUG
-		if (!this->verify_remote_neighbor_info()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info is not consistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
+				if (this->neighborhood_of[i][dimension] != direction) {
+					found = false;
+				}
 
-		if (!this->verify_user_data()) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " User data is inconsistent" << std::endl;
-			exit(EXIT_FAILURE);
+				if (found) {
+					neighborhood_of_indices[neigh_of_indices_index] = i;
+					break;
+				}
+			}
 		}
-		#endif
-
-		std::vector<uint64_t> new_cells;
 
-		this->remote_neighbors.clear();
-		this->cells_to_send.clear();
-		this->cells_to_receive.clear();
-		this->refined_cell_data.clear();
-		this->unrefined_cell_data.clear();
+		// gather cells in given cell's neighbor_of list at indices found above
+		std::array<size_t, 2 * 3> current_index = {{0, 0, 0, 0, 0, 0}};
+		const int refinement_level = this->mapping.get_refinement_level(cell);
 
-		#ifdef DEBUG
-		// check that cells_to_refine is identical between processes
-		std::vector<uint64_t> ordered_cells_to_refine(this->cells_to_refine.begin(), this->cells_to_refine.end());
-		std::sort(ordered_cells_to_refine.begin(), ordered_cells_to_refine.end());
+		for (size_t
+			neighbor_i = 0;
+			neighbor_i < this->neighbors_of.at(cell).size();
+			neighbor_i++
+		) {
 
-		std::vector<std::vector<uint64_t>> all_ordered_cells_to_refine;
-		All_Gather()(ordered_cells_to_refine, all_ordered_cells_to_refine, this->comm);
+			const auto neighbor = this->neighbors_of.at(cell)[neighbor_i].first;
 
-		for (unsigned int process = 0; process < this->comm_size; process++) {
-			if (!std::equal(
-				all_ordered_cells_to_refine[process].begin(),
-				all_ordered_cells_to_refine[process].end(),
-				all_ordered_cells_to_refine[0].begin()
-			)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " cells_to_refine differ between processes 0 and " << process
-					<< std::endl;
-				exit(EXIT_FAILURE);
+			if (neighbor == error_cell) {
+				for (size_t i = 0; i < current_index.size(); i++) {
+					current_index[i]++;
+				}
+				continue;
 			}
-		}
 
-		// check that cells_to_unrefine is identical between processes
-		std::vector<uint64_t> ordered_cells_to_unrefine(this->cells_to_unrefine.begin(), this->cells_to_unrefine.end());
-		std::sort(ordered_cells_to_unrefine.begin(), ordered_cells_to_unrefine.end());
+			const int neigh_ref_lvl = this->mapping.get_refinement_level(neighbor);
 
-		std::vector<std::vector<uint64_t>> all_ordered_cells_to_unrefine;
-		All_Gather()(ordered_cells_to_unrefine, all_ordered_cells_to_unrefine, this->comm);
+			for (int direction = -1; direction <= 1; direction += 2)
+			for (size_t dimension = 0; dimension < 3; dimension++) {
 
-		for (unsigned int process = 0; process < this->comm_size; process++) {
-			if (!std::equal(
-				all_ordered_cells_to_unrefine[process].begin(),
-				all_ordered_cells_to_unrefine[process].end(),
-				all_ordered_cells_to_unrefine[0].begin()
-			)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " cells_to_unrefine differ between processes 0 and " << process
-					<< std::endl;
-				exit(EXIT_FAILURE);
-			}
-		}
-		#endif
+				// neigh_of_indices[n] == negative direction, n + 1 positive
+				const size_t neigh_of_indices_index
+					= 2 * dimension + ((direction > 0) ? 1 : 0);
 
-		// cells whose neighbor lists have to be updated afterwards
-		std::unordered_set<uint64_t> update_neighbors;
+				// at correct index in neighbors_of for current dim & dir
+				if (current_index[neigh_of_indices_index]
+				== neighborhood_of_indices[neigh_of_indices_index]) {
 
-		// a separate neighborhood update function has to be used
-		// for cells whose children were removed by unrefining
-		std::unordered_set<uint64_t> update_neighbors_unrefined;
+					int final_dir = int(dimension) + 1;
+					if (direction < 0) {
+						final_dir *= -1;
+					}
 
-		// refines
-		for (const uint64_t refined: this->cells_to_refine) {
+					// add one neighbor not smaller than given cell
+					if (neigh_ref_lvl <= refinement_level) {
 
-			#ifdef DEBUG
-			if (this->cell_process.count(refined) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << refined
-					<< " doesn't exist"
-					<< std::endl;
-				abort();
-			}
+						ret_val.push_back(std::make_pair(neighbor, final_dir));
 
-			if (this->rank == this->cell_process.at(refined)
-			&& this->cell_data.count(refined) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Data for cell " << refined
-					<< " doesn't exist"
-					<< std::endl;
-				abort();
-			}
+					// add only face neighbors in current dim & dir
+					} else {
 
+						const uint64_t neighs_in_offset = uint64_t(1) << 3;
 
-			if (this->cell_process.at(refined) == this->rank
-			&& this->neighbors_of.count(refined) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor list for cell " << refined
-					<< " doesn't exist"
-					<< std::endl;
-				abort();
-			}
+						#ifdef DEBUG
+						if (this->neighbors_of.at(cell).size() < neighbor_i + neighs_in_offset) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " Invalid number of neighbors for cell " << cell
+								<< " while processing dimension " << dimension
+								<< " and direction " << direction
+								<< " starting at index " << neighbor_i
+								<< std::endl;
+							abort();
+						}
+						#endif
 
-			if (this->cell_process.at(refined) == this->rank
-			&& this->neighbors_to.count(refined) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor_to list for cell " << refined
-					<< " doesn't exist"
-					<< std::endl;
-				abort();
-			}
-			#endif
+						// see find_neighbors_of(...) for the order of these
+						std::vector<uint64_t> dir_neighs;
+						for (size_t i = neighbor_i; i < neighbor_i + neighs_in_offset; i++) {
+							dir_neighs.push_back(this->neighbors_of.at(cell)[i].first);
+						}
 
-			const uint64_t process_of_refined = this->cell_process.at(refined);
+						// neighbor at offset    0, 1, 2, 3, 4, 5, 6, 7 is
+						// face neighbor of given cell when neighbors are in
+						// dim = 0, dir = -1      , y,  , y,  , y,  , y
+						// dim = 0, dir = +1     y,  , y,  , y,  , y,
+						// dim = 1, dir = -1      ,  , y, y,  ,  , y, y
+						// dim = 1, dir = +1     y, y,  ,  , y, y,  ,
+						// dim = 2, dir = -1      ,  ,  ,  , y, y, y, y
+						// dim = 2, dir = +1     y, y, y, y,  ,  ,  ,
+						const size_t
+							batch_size = size_t(1) << dimension,
+							mod_target = (direction < 0) ? 1 : 0;
 
-			// move user data of refined cells into refined_cell_data
-			if (this->rank == process_of_refined) {
-				// TODO: move data instead of copying
-				this->refined_cell_data[refined] = this->cell_data.at(refined);
-				this->cell_data.erase(refined);
-			}
+						for (size_t i = 0; i < neighs_in_offset; i++) {
 
-			// add children of refined cells into the grid
-			const std::vector<uint64_t> children = this->get_all_children(refined);
-			for (const uint64_t child: children) {
-				this->cell_process[child] = process_of_refined;
+							#ifdef DEBUG
+							if (dir_neighs[i] == error_cell) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " Invalid neighbor of cell " << cell
+								<< " at index " << neighbor_i + i
+								<< std::endl;
+							abort();
+							}
+							#endif
 
-				if (this->rank == process_of_refined) {
-					this->cell_data[child];
-					this->neighbors_of[child];
-					this->neighbors_to[child];
-					new_cells.push_back(child);
+							if ((i / batch_size) % 2 == mod_target) {
+								ret_val.push_back(std::make_pair(dir_neighs[i], final_dir));
+							}
+						}
+					}
 				}
-			}
 
-			// children of refined cells inherit their pin request status
-			if (this->pin_requests.count(refined) > 0) {
-				for (const uint64_t child: children) {
-					this->pin_requests[child] = this->pin_requests.at(refined);
-				}
-				this->pin_requests.erase(refined);
-			}
-			if (this->new_pin_requests.count(refined) > 0) {
-				for (const uint64_t child: children) {
-					this->new_pin_requests[child] = this->new_pin_requests.at(refined);
-				}
-				this->new_pin_requests.erase(refined);
+				current_index[neigh_of_indices_index]++;
 			}
 
-			// children of refined cells inherit their weight
-			if (this->rank == process_of_refined
-			&& this->cell_weights.count(refined) > 0) {
-				for (const uint64_t child: children) {
-					this->cell_weights[child] = this->cell_weights.at(refined);
-				}
-				this->cell_weights.erase(refined);
+			// skip all cells in this neighborhood offset
+			if (neigh_ref_lvl > refinement_level) {
+				neighbor_i += 7;
 			}
+		}
 
-			// use local neighbor lists to find cells whose neighbor lists have to updated
-			if (this->rank == process_of_refined) {
-				// update the neighbor lists of created local cells
-				for (const uint64_t child: children) {
-					update_neighbors.insert(child);
-				}
-
-				// update neighbor lists of all the parent's neighbors
-				for (const auto& neighbor_i: this->neighbors_of.at(refined)) {
-					const auto& neighbor = neighbor_i.first;
+		return ret_val;
+	}
 
-					if (neighbor == error_cell) {
-						continue;
-					}
 
-					if (this->cell_process.at(neighbor) == this->rank) {
-						update_neighbors.insert(neighbor);
-					}
-				}
+	/*!
+	Returns true if given cell's neighbor types match given criterion, false otherwise.
 
-				for (const auto& neighbor_to_i: this->neighbors_to.at(refined)) {
-					const auto& neighbor_to = neighbor_to_i.first;
-					if (this->cell_process.at(neighbor_to) == this->rank) {
-						update_neighbors.insert(neighbor_to);
-					}
-				}
-			}
+	Returns false if:
+		- given neighborhood doesn't exist
+		- given cell doesn't exist
+		- given cell is on another process
 
-			// without using local neighbor lists figure out rest of the
-			// neighbor lists that need updating
-			if (this->remote_cells_on_process_boundary.count(refined) > 0) {
+	\see get_cells()
+	*/
+	bool is_neighbor_type_match(
+		const uint64_t cell,
+		const std::vector<int>& criteria,
+		const bool exact_match,
+		const int neighborhood_id
+	) const {
 
-				/*
-				No need to update local neighbors_to of refined cell, if they are larger
-				they will also be refined and updated.
-				*/
-				const auto neighbors
-					= this->find_neighbors_of(
-						refined,
-						this->neighborhood_of,
-						2 * this->max_ref_lvl_diff,
-						true
-					);
+		if (cell == error_cell) {
+			return false;
+		}
 
-				for (const auto& neighbor_i: neighbors) {
-					const auto& neighbor = neighbor_i.first;
+		if (this->cell_process.count(cell) == 0) {
+			return false;
+		}
 
-					if (neighbor == error_cell) {
-						continue;
-					}
+		if (this->cell_process.at(cell) != this->rank) {
+			return false;
+		}
 
-					if (this->is_local(neighbor)) {
-						update_neighbors.insert(neighbor);
-					}
-				}
-			}
+		if (neighborhood_id != default_neighborhood_id
+		&& this->user_hood_of.count(neighborhood_id) == 0) {
+			return false;
 		}
 
-		// needed for checking which neighborhoods to update due to unrefining
-		std::unordered_set<uint64_t> parents_of_unrefined;
 
-		// initially only one sibling is recorded per process when unrefining,
-		// insert the rest of them now
-		for (const uint64_t unrefined: this->cells_to_unrefine) {
+		int neighbor_types = 0;
 
-			const uint64_t parent_of_unrefined = this->get_parent(unrefined);
-			#ifdef DEBUG
-			if (unrefined != this->get_child(unrefined)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << unrefined
-					<< " has children"
-					<< std::endl;
-				abort();
-			}
+		const std::vector<
+			std::pair<
+				uint64_t,
+				std::array<int, 4>
+			>
+		>& neighs_of
+			= [&](){
+				if (neighborhood_id == default_neighborhood_id) {
+					return this->neighbors_of.at(cell);
+				} else {
+					return this->user_neigh_of.at(neighborhood_id).at(cell);
+				}
+			}();
 
-			if (parent_of_unrefined == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__ << " Invalid parent cell" << std::endl;
-				abort();
+		for(const auto& neighbor_i: neighs_of) {
+			if (neighbor_i.first == error_cell) {
+				continue;
 			}
 
-			if (parent_of_unrefined == unrefined) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << unrefined
-					<< " has no parent"
-					<< std::endl;
-				abort();
+			if (this->is_local(neighbor_i.first)) {
+				neighbor_types |= has_local_neighbor_of;
+			} else {
+				neighbor_types |= has_remote_neighbor_of;
 			}
-			#endif
-
-			parents_of_unrefined.insert(parent_of_unrefined);
-
-			const std::vector<uint64_t> siblings = this->get_all_children(parent_of_unrefined);
+		}
 
-			#ifdef DEBUG
-			bool unrefined_in_siblings = false;
-			for (const uint64_t sibling: siblings) {
-
-				if (this->cell_process.count(sibling) == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << sibling
-						<< " doesn't exist"
-						<< std::endl;
-					abort();
-				}
-
-				if (sibling != this->get_child(sibling)) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << sibling
-						<< " has has children"
-						<< std::endl;
-					abort();
-				}
-
-				if (this->cell_process.at(sibling) == this->rank
-				&& this->cell_data.count(sibling) == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << sibling
-						<< " has no data"
-						<< std::endl;
-					abort();
+		const std::vector<
+			std::pair<
+				uint64_t,
+				std::array<int, 4>
+			>
+		>& neighs_to
+			= [&](){
+				if (neighborhood_id == default_neighborhood_id) {
+					return this->neighbors_to.at(cell);
+				} else {
+					return this->user_neigh_to.at(neighborhood_id).at(cell);
 				}
+			}();
 
-				if (unrefined == sibling) {
-					unrefined_in_siblings = true;
-				}
+		for (const auto& neighbor_i: neighs_to) {
+			if (neighbor_i.first == error_cell) {
+				continue;
 			}
 
-			if (!unrefined_in_siblings) {
-				std::cerr << __FILE__ << ":" << __LINE__ << " Cell to unrefine isn't its parent's child" << std::endl;
-				abort();
+			if (this->is_local(neighbor_i.first)) {
+				neighbor_types |= has_local_neighbor_to;
+			} else {
+				neighbor_types |= has_remote_neighbor_to;
 			}
-			#endif
-
-			this->all_to_unrefine.insert(siblings.begin(), siblings.end());
 		}
 
-		// unrefines
-		for (const uint64_t unrefined: this->all_to_unrefine) {
 
-			const uint64_t parent_of_unrefined = this->get_parent(unrefined);
-			#ifdef DEBUG
-			if (parent_of_unrefined == unrefined) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << unrefined
-					<< " has no parent"
-					<< std::endl;
-				abort();
+		if (exact_match) {
+			for(const auto& criterion: criteria) {
+				if (neighbor_types == criterion) {
+					return true;
+				}
+			}
+		} else {
+			// with inexact matching all criteria can be merged into one
+			int merged_criteria = 0;
+			for(const auto& criterion: criteria) {
+				merged_criteria |= criterion;
 			}
-			#endif
-
-			const uint64_t process_of_parent = this->cell_process.at(parent_of_unrefined);
-			const uint64_t process_of_unrefined = this->cell_process.at(unrefined);
 
-			// remove unrefined cells and their siblings from the grid, but don't remove user data yet
-			this->cell_process.erase(unrefined);
-			update_neighbors.erase(unrefined);
-			this->pin_requests.erase(unrefined);
-			this->new_pin_requests.erase(unrefined);
-			this->cell_weights.erase(unrefined);
+			if ((neighbor_types & merged_criteria) > 0) {
+				return true;
+			}
+		}
 
-			// don't send unrefined cells' user data to self
-			if (this->rank == process_of_unrefined
-			&& this->rank == process_of_parent) {
+		return false;
+	}
 
-				#ifdef DEBUG
-				if (this->cell_data.count(unrefined) == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << unrefined
-						<< " to be unrefined has no data"
-						<< std::endl;
-					abort();
-				}
-				#endif
 
-				// TODO move data instead of copying
-				this->unrefined_cell_data[unrefined] = this->cell_data.at(unrefined);
-				this->cell_data.erase(unrefined);
+	/*!
+	Returns the size of cells' neihgbourhood in every direction.
+	*/
+	unsigned int get_neighborhood_length() const
+	{
+		return this->neighborhood_length;
+	}
 
-			// send user data of removed cell to the parent's process
-			} else if (this->rank == process_of_unrefined) {
 
-				this->cells_to_send[process_of_parent].push_back(
-					std::make_pair(unrefined, -1)
-				);
+	/*!
+	Returns all neighbors of given cell that are at given offset from it.
 
-			// receive user data of removed cell from its process
-			} else if (this->rank == process_of_parent) {
-				this->cells_to_receive[process_of_unrefined].push_back(
-					std::make_pair(unrefined, -1)
-				);
-			}
-		}
+	Offset is in units of size of the given cell
+	Returns nothing in the following cases:
+		- given cell doesn't exist
+		- given cell is on another process
+		- any of given offsets is larger in absolute value than the neighborhood
+		  size or larger than 1 if neihgborhood size == 0
+		- x == 0 && y == 0 && z == 0
 
-		// receive cells in known order and add message tags
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
-			sender = this->cells_to_receive.begin();
-			sender != this->cells_to_receive.end();
-			sender++
+	\see
+	get_neighbors_of()
+	*/
+	std::vector<
+		std::pair<
+			uint64_t,
+			std::array<int, 4>
+		>
+	> get_neighbors_of_at_offset(
+		const uint64_t cell,
+		const int x,
+		const int y,
+		const int z
+	) const {
+		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
+		if (
+			this->cell_process.count(cell) == 0
+			or this->cell_process.at(cell) != this->rank
+			or (x == 0 and y == 0 and z == 0)
 		) {
-			std::sort(sender->second.begin(), sender->second.end());
-			// TODO: merge with identical code in make_new_partition
-			for (unsigned int i = 0; i < sender->second.size(); i++) {
+			return return_neighbors;
+		}
 
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for receiving cell " << sender->second[i].first
-						<< " from process " << sender->first
-						<< std::endl;
-					abort();
+		for (const auto& neighbor_i: this->neighbors_of.at(cell)) {
+			const auto& offsets = neighbor_i.second;
+			if (offsets[3] <= 1) {
+				if (offsets[0] == x and offsets[1] == y and offsets[2] == z) {
+					return_neighbors.push_back(neighbor_i);
+				}
+			} else {
+				auto scaled_offsets = offsets;
+				for (size_t i = 0; i < 3; i++) {
+					if (std::abs(scaled_offsets[i]) <= 1) {
+						continue;
+					}
+					// round away from zero, stackoverflow.com/a/2745086
+					if (scaled_offsets[i] > 1) {
+						scaled_offsets[i] += scaled_offsets[3] - 1;
+					} else {
+						scaled_offsets[i] -= scaled_offsets[3] - 1;
+					}
+					scaled_offsets[i] /= scaled_offsets[3];
+				}
+				if (scaled_offsets[0] == x and scaled_offsets[1] == y and scaled_offsets[2] == z) {
+					return_neighbors.push_back(neighbor_i);
 				}
-
-				sender->second[i].second = tag;
 			}
 		}
 
-		// send cells in known order and add message tags
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
-			receiver = this->cells_to_send.begin();
-			receiver != this->cells_to_send.end();
-			receiver++
-		) {
-			std::sort(receiver->second.begin(), receiver->second.end());
-			// TODO: check that message tags don't overflow
-			for (unsigned int i = 0; i < receiver->second.size(); i++) {
+		return return_neighbors;
+	}
 
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for sending cell " << receiver->second[i].first
-						<< " to process " << receiver->first
-						<< std::endl;
-					abort();
-				}
 
-				receiver->second[i].second = tag;
-			}
-		}
+	/*!
+	Returns neighbors of given local cell that are on another process.
 
-		// update data for parents (and their neighborhood) of unrefined cells
-		for (const uint64_t parent: parents_of_unrefined) {
+	Returns nothing if:
+		- given cell doesn't exist
+		- given cell is on another process
+		- given cell doesn't have remote neighbors
+		- given neighborhood doesn't exist
 
-			/* TODO: skip unrefined cells far enough away
-			std::vector<uint64_t> children = this->get_all_children(*parent);
-			*/
+	By default returned cells are in random order but if sorted == true
+	they are sorted using std::sort before returning.
+	*/
+	std::vector<uint64_t> get_remote_neighbors_of(
+		const uint64_t cell,
+		const int neighborhood_id = default_neighborhood_id,
+		const bool sorted = false
+	) const {
+		std::vector<uint64_t> ret_val;
 
-			#ifdef DEBUG
-			if (this->cell_process.count(parent) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Parent " << parent
-					<< " doesn't exist"
-					<< std::endl;
-				abort();
-			}
+		if (this->cell_process.count(cell) == 0) {
+			return ret_val;
+		}
 
-			if (parent != this->get_child(parent)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Parent " << parent
-					<< " still has children"
-					<< std::endl;
-				abort();
-			}
-			#endif
-
-			const auto new_neighbors_of
-				= this->find_neighbors_of(parent, this->neighborhood_of, this->max_ref_lvl_diff);
+		if (this->cell_process.at(cell) != this->rank) {
+			return ret_val;
+		}
 
-			for (const auto& neighbor_i: new_neighbors_of) {
-				const auto& neighbor = neighbor_i.first;
+		if (neighborhood_id != default_neighborhood_id
+		&& this->user_hood_of.count(neighborhood_id) == 0) {
+			return ret_val;
+		}
 
-				if (neighbor == 0) {
-					continue;
-				}
+		const std::vector<uint64_t>& neighbors_ref
+			= (neighborhood_id == default_neighborhood_id)
+			? this->neighbors_of.at(cell)
+			: this->user_neigh_of.at(neighborhood_id).at(cell);
 
-				if (this->cell_process.at(neighbor) == this->rank) {
-					update_neighbors.insert(neighbor);
-				}
-			}
+		for(const auto& neighbor: neighbors_ref) {
 
-			const auto new_neighbors_to
-				= this->find_neighbors_to(parent, this->neighborhood_to);
-			for (const auto& neighbor_i: new_neighbors_to) {
-				const auto& neighbor = neighbor_i.first;
-				if (this->cell_process.at(neighbor) == this->rank) {
-					update_neighbors.insert(neighbor);
-				}
+			if (neighbor == error_cell) {
+				continue;
 			}
 
-			// add user data and neighbor lists of local parents of unrefined cells
-			if (this->cell_process.at(parent) == this->rank) {
-				this->cell_data[parent];
-				this->neighbors_of[parent] = new_neighbors_of;
-				this->neighbors_to[parent] = new_neighbors_to;
-
-				// add user neighbor lists
-				for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
-					item = this->user_hood_of.begin();
-					item != this->user_hood_of.end();
-					item++
-				) {
-					this->update_user_neighbors(parent, item->first);
-				}
+			if (this->cell_process.at(neighbor) != this->rank) {
+				ret_val.push_back(neighbor);
 			}
 		}
 
-		// update neighbor lists of cells affected by refining / unrefining
-		for (const uint64_t cell: update_neighbors) {
-			this->update_neighbors(cell);
-			//update also neighbor lists of user neighborhoods
-			for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
-				item = this->user_hood_of.begin();
-				item != this->user_hood_of.end();
-				item++
-			) {
-				this->update_user_neighbors(cell, item->first);
-			}
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
 		}
 
-		// remove neighbor lists of added cells' parents
-		for (const uint64_t refined: this->cells_to_refine) {
-
-			if (this->cell_process.at(refined) == this->rank) {
+		return ret_val;
+	}
 
-				#ifdef DEBUG
-				if (this->neighbors_of.count(refined) == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Neighbor list for cell " << refined
-						<< " doesn't exist"
-						<< std::endl;
-					abort();
-				}
+	/*!
+	Returns remote cells that consider given local cell as a neighbor.
 
-				if (this->neighbors_to.count(refined) == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Neighbor_to list for cell " << refined
-						<< " doesn't exist"
-						<< std::endl;
-					abort();
-				}
-				#endif
+	Returns nothing if given cell doesn't exist or is on another process
+	or doesn't have remote neighbors.
 
-				this->neighbors_of.erase(refined);
-				this->neighbors_to.erase(refined);
+	By default returned cells are in random order but if sorted == true
+	they are sorted using std::sort before returning.
+	*/
+	std::vector<uint64_t> get_remote_neighbors_to(
+		const uint64_t cell,
+		const int neighborhood_id = default_neighborhood_id,
+		const bool sorted = false
+	) const {
+		std::vector<uint64_t> ret_val;
 
-				// remove also from user's neighborhood
-				for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
-					item = this->user_hood_of.begin();
-					item != this->user_hood_of.end();
-					item++
-				) {
-					this->user_neigh_of.at(item->first).erase(refined);
-					this->user_neigh_to.at(item->first).erase(refined);
-				}
-			}
+		if (this->cell_process.count(cell) == 0) {
+			return ret_val;
 		}
 
-		// remove neighbor lists of removed cells
-		for (const uint64_t unrefined: this->all_to_unrefine) {
-			this->neighbors_of.erase(unrefined);
-			this->neighbors_to.erase(unrefined);
-			// also from user neighborhood
-			for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
-				item = this->user_hood_of.begin();
-				item != this->user_hood_of.end();
-				item++
-			) {
-				this->user_neigh_of.at(item->first).erase(unrefined);
-				this->user_neigh_to.at(item->first).erase(unrefined);
-			}
+		if (this->cell_process.at(cell) != this->rank) {
+			return ret_val;
 		}
 
-		this->update_remote_neighbor_info();
-		// also remote neighbor info of user neighborhoods
-		for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
-			item = this->user_hood_of.begin();
-			item != this->user_hood_of.end();
-			item++
-		) {
-			this->update_user_remote_neighbor_info(item->first);
+		if (neighborhood_id != default_neighborhood_id
+		&& this->user_hood_of.count(neighborhood_id) == 0) {
+			return ret_val;
 		}
 
-		#ifdef DEBUG
-		if (!this->verify_neighbors()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Neighbor lists are inconsistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
-		#endif
+		const std::vector<uint64_t>& neighbors_ref
+			= (neighborhood_id == default_neighborhood_id)
+			? this->neighbors_to.at(cell)
+			: this->user_neigh_to.at(neighborhood_id).at(cell);
 
+		for(const auto& neighbor: neighbors_ref) {
 
-		return new_cells;
-	}
+			if (neighbor == error_cell) {
+				continue;
+			}
 
+			if (this->cell_process.at(neighbor) != this->rank) {
+				ret_val.push_back(neighbor);
+			}
+		}
 
-	std::vector<uint64_t> get_local_cells_to_refine()
-	{
-		std::vector<uint64_t> retVal;
-		if (!this->refining) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " get_local_cells_to_refine() called outside refining"
-				<< std::endl;
-			return retVal;
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
 		}
 
-		for (auto i : cells_to_refine)
-			if (is_local(i))
-				retVal.push_back(i);
-		
-		return retVal;
+		return ret_val;
 	}
 
-	std::vector<uint64_t> get_local_cells_to_unrefine()
+
+	/*!
+	Returns true if given cell is on this process and false otherwise.
+	*/
+	bool is_local(const uint64_t cell) const
 	{
-		std::vector<uint64_t> retVal;
-		if (!this->refining) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " get_local_cells_to_unrefine() called outside refining"
-				<< std::endl;
-			return retVal;
+		if (this->cell_process.count(cell) > 0
+		&& this->cell_process.at(cell) == this->rank) {
+			return true;
+		} else {
+			return false;
 		}
-
-		for (auto i : cells_to_unrefine)
-			if (is_local(i))
-				retVal.push_back(i);
-		
-		return retVal;
 	}
 
-	/*!
-	Transfers unrefined cell data between processes.
 
-	Must be called by all processes and not before execute_refines()
-	has been called.
+	/*!
+	Writes the cells on this process into a vtk file with given name in ASCII format.
 
-	The next function to be called after this one (from those that
-	must be called by all processes) must be either this again or
-	finish_refining().
+	The cells are written in ascending order.
+	Must be called simultaneously on all processes.
 
-	\see
-	finish_refining()
+	Returns true on success, false otherwise.
 	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& continue_refining()
+	bool write_vtk_file(const std::string& file_name) const
 	{
-		if (!this->refining) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " continue_refining() called without "
-				<< "calling initialize_refines() first."
-				<< std::endl;
-			abort();
+		std::ofstream outfile(file_name);
+		if (!outfile.is_open()) {
+			std::cerr << "Couldn't open file " << file_name << std::endl;
+			return false;
 		}
 
-		this->start_user_data_transfers(
-			this->unrefined_cell_data,
-			this->cells_to_receive,
-			this->cells_to_send,
-			-3
-		);
+		std::vector<uint64_t> leaf_cells = this->get_cells();
 
-		this->wait_user_data_transfer_receives();
-		this->wait_user_data_transfer_sends();
-		return *this;
-	}
+		if (leaf_cells.size() > 0) {
+			std::sort(leaf_cells.begin(), leaf_cells.end());
+		}
 
-	/*!
-	Finishes the procedure of moving cells between processes.
+		outfile <<
+			"# vtk DataFile Version 2.0\n"
+			"Cartesian cell refinable grid\n"
+			"ASCII\n"
+			"DATASET UNSTRUCTURED_GRID\n";
 
-	Must be called by all processes and not before initialize_balance_load(...)
-	has been called.
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& finish_refining()
-	{
-		if (!this->refining) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " finish_refining() called without "
-				<< "calling initialize_refines() first."
-				<< std::endl;
-			abort();
+		// write separate points for every cells corners
+		outfile << "POINTS " << leaf_cells.size() * 8 << " float" << std::endl;
+		for (size_t i = 0; i < leaf_cells.size(); i++) {
+			const std::array<double, 3>
+				cell_min = this->geometry.get_min(leaf_cells[i]),
+				cell_max = this->geometry.get_max(leaf_cells[i]);
+
+			outfile
+				<< cell_min[0] << " " << cell_min[1] << " " << cell_min[2] << "\n"
+				<< cell_max[0] << " " << cell_min[1] << " " << cell_min[2] << "\n"
+				<< cell_min[0] << " " << cell_max[1] << " " << cell_min[2] << "\n"
+				<< cell_max[0] << " " << cell_max[1] << " " << cell_min[2] << "\n"
+				<< cell_min[0] << " " << cell_min[1] << " " << cell_max[2] << "\n"
+				<< cell_max[0] << " " << cell_min[1] << " " << cell_max[2] << "\n"
+				<< cell_min[0] << " " << cell_max[1] << " " << cell_max[2] << "\n"
+				<< cell_max[0] << " " << cell_max[1] << " " << cell_max[2] << "\n";
 		}
 
-		this->cells_to_receive.clear();
-		this->cells_to_send.clear();
+		// map cells to written points
+		outfile << "CELLS " << leaf_cells.size() << " " << leaf_cells.size() * 9 << std::endl;
+		for (unsigned int j = 0; j < leaf_cells.size(); j++) {
+			outfile << "8 ";
+			for (int i = 0; i < 8; i++) {
+				 outfile << j * 8 + i << " ";
+			}
+			outfile << std::endl;
+		}
 
-		#ifdef DEBUG
-		if (!this->verify_user_data()) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " virhe" << std::endl;
-			exit(EXIT_FAILURE);
+		// cell types
+		outfile << "CELL_TYPES " << leaf_cells.size() << std::endl;
+		for (unsigned int i = 0; i < leaf_cells.size(); i++) {
+			outfile << 11 << std::endl;
 		}
-		#endif
 
-		// remove user data of unrefined cells from this->cell_data
-		for (std::unordered_set<uint64_t>::const_iterator
-			unrefined = this->all_to_unrefine.begin();
-			unrefined != this->all_to_unrefine.end();
-			unrefined++
-		) {
-			this->cell_data.erase(*unrefined);
+		if (!outfile.good()) {
+			std::cerr << "Writing of vtk file probably failed" << std::endl;
+			// TODO: throw an exception instead
+			exit(EXIT_FAILURE);
 		}
 
-		this->cells_to_refine.clear();
-		this->cells_to_unrefine.clear();
-		this->all_to_unrefine.clear();
+		outfile.close();
 
-		this->recalculate_neighbor_update_send_receive_lists();
+		return true;
+	}
 
-		this->allocate_copies_of_remote_neighbors();
-		this->update_cell_pointers();
-		for (const auto& item: this->user_hood_of) {
-			this->allocate_copies_of_remote_neighbors(item.first);
+
+	/*!
+	As refine_completely(), but uses the smallest existing cell at given coordinates.
+
+	Does nothing in the same cases as refine_completely and additionally
+	if the coordinate is outside of the grid.
+	*/
+	bool refine_completely_at(const std::array<double, 3>& coordinate)
+	{
+		const uint64_t cell = this->get_existing_cell(coordinate);
+		if (cell == error_cell) {
+			return false;
 		}
 
-		this->refining = false;
-		return *this;
+		return this->refine_completely(cell);
 	}
 
+
 	/*!
-	Calls initialize_refines(), execute_refines() and finish_refining() in case transfers aren't needed, i.e. no unrefining
+	As unrefine_completely(), but uses the smallest existing cell at given coordinates.
+
+	Does nothing in the same cases as unrefine_completely and additionally
+	if the coordinate is outside of the grid.
 	*/
-	std::vector<uint64_t> stop_refining(const bool sorted = false)
+	bool unrefine_completely_at(const std::array<double, 3>& coordinate)
 	{
-		this->initialize_refines();
-
-		std::vector<uint64_t> ret_val = this->execute_refines();
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
+		const uint64_t cell = this->get_existing_cell(coordinate);
+		if (cell == error_cell) {
+			return false;
 		}
 
-		if (!this->unrefined_cell_data.empty()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " stop_refining() called with unrefined cells. "
-				<< std::endl;
-		}
-		this->finish_refining();
-		return ret_val;
+		return this->unrefine_completely(cell);
 	}
 
 
 	/*!
-	Returns cells that were removed by unrefinement and whose parent is currently a local cell.
-
-	Removed cells' data is currently also on this process,
-	but only until balance_load() is called.
+	As dont_unrefine() but uses the smallest existing cell at given coordinates.
 
-	By default returned cells are in random order but if sorted == true
-	they are sorted using std::sort before returning.
+	Does nothing in the same cases as dont_unrefine and additionally if the
+	coordinate is outside of the grid.
 	*/
-	std::vector<uint64_t> get_removed_cells(const bool sorted = false) const
+	bool dont_unrefine_at(const std::array<double, 3>& coordinate)
 	{
-		std::vector<uint64_t> ret_val;
-		ret_val.reserve(this->unrefined_cell_data.size());
-
-		for (const auto& item: this->unrefined_cell_data) {
-			ret_val.push_back(item.first);
-		}
-
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
+		const uint64_t cell = this->get_existing_cell(coordinate);
+		if (cell == error_cell) {
+			return false;
 		}
 
-		return ret_val;
+		return this->dont_unrefine(cell);
 	}
 
 
 	/*!
-	Returns all cells in the grid that don't have children (e.g. leaf cells).
+	Executes refines / unrefines that have been requested so far.
 
-	Only those cells are returned which this process knows about, this
-	might not include all cells that exist on all processes.
+	Must be called simultaneously on all processes.
+	Returns cells that were created by refinement on this process.
+	Moves user data of unrefined cells to the current process of their parent.
 
 	By default returned cells are in random order but if sorted == true
 	they are sorted using std::sort before returning.
-
-	\see
-	get_cells()
 	*/
-	std::vector<uint64_t> get_all_cells(const bool sorted = false) const
+	void initialize_refines(const bool sorted = false)
 	{
-		std::vector<uint64_t> ret_val;
-		ret_val.reserve(this->cell_process.size());
+		if (this->refining) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " initialize_refining() called the second time "
+				<< "before calling finish_refining() first"
+				<< std::endl;
+			abort();
+		}
 
-		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
-			item = this->cell_process.begin();
-			item != this->cell_process.end();
-			item++
-		) {
+		this->apply_concurrent_refine_requests();
 
-			const uint64_t child = this->get_child(item->first);
+		this->refining = true;
 
-			if (child == item->first) {
-				ret_val.push_back(item->first);
-			}
-		}
+		phiprof::start("Override refines");
+		this->override_refines();
+		phiprof::stop("Override refines");
 
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
-		}
+		phiprof::start("Induce refines");
+		this->induce_refines();
+		phiprof::stop("Induce refines");
 
-		return ret_val;
+		phiprof::start("Override unrefines");
+		this->override_unrefines();
+		phiprof::stop("Override unrefines");
 	}
 
 
 	/*!
-	Returns true if given cell overlaps a local cell.
-
-	Returns true if given cell is either a local cell of
-	refinement level 0 or is a (grandgrand...)child of a
-	local cell with refinement level 0.
-	Returns false otherwise.
+	Adds refined cells to the grid, removes unrefined cells from the grid.
 
-	\see
-	get_cells_overlapping_local()
+	cells_to_refine and cells_to_unrefine must contain the cells to refine/unrefine of all processes.
+	Returns new cells created on this process by refinement.
+	Moves unrefined cell data to the process of their parent.
 	*/
-	bool cell_overlaps_local(const uint64_t cell) const
+	std::vector<uint64_t> execute_refines()
 	{
-		const uint64_t parent = this->mapping.get_level_0_parent(cell);
+		#ifdef DEBUG
+		if (!this->verify_remote_neighbor_info()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info is not consistent"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
 
-		if (this->cell_process.count(parent) > 0
-		&& this->cell_process.at(parent) == this->rank) {
-			return true;
-		} else {
-			return false;
+		if (!this->verify_user_data()) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " User data is inconsistent" << std::endl;
+			exit(EXIT_FAILURE);
 		}
-	}
+		#endif
 
+		std::vector<uint64_t> new_cells;
 
-	/*!
-	Returns those cells from given that are either local or a child of local.
+		// measured times are split between children below
+		this->collect_cell_times();
 
-	Assumes local cells are of refinement level 0.
-	*/
-	std::unordered_set<uint64_t> get_cells_overlapping_local(const std::vector<uint64_t>& given_cells) const
-	{
-		std::unordered_set<uint64_t> result;
+		this->remote_neighbors.clear();
+		this->cells_to_send.clear();
+		this->cells_to_receive.clear();
+		this->refined_cell_data.clear();
+		this->unrefined_cell_data.clear();
 
-		for (const uint64_t cell: given_cells) {
+		#ifdef DEBUG
+		// check that cells_to_refine is identical between processes
+		std::vector<uint64_t> ordered_cells_to_refine(this->cells_to_refine.begin(), this->cells_to_refine.end());
+		std::sort(ordered_cells_to_refine.begin(), ordered_cells_to_refine.end());
 
-			if (this->cell_overlaps_local(cell)) {
-				result.insert(cell);
+		std::vector<std::vector<uint64_t>> all_ordered_cells_to_refine;
+		All_Gather()(ordered_cells_to_refine, all_ordered_cells_to_refine, this->comm);
+
+		for (unsigned int process = 0; process < this->comm_size; process++) {
+			if (!std::equal(
+				all_ordered_cells_to_refine[process].begin(),
+				all_ordered_cells_to_refine[process].end(),
+				all_ordered_cells_to_refine[0].begin()
+			)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " cells_to_refine differ between processes 0 and " << process
+					<< std::endl;
+				exit(EXIT_FAILURE);
 			}
 		}
 
-		return result;
-	}
-
+		// check that cells_to_unrefine is identical between processes
+		std::vector<uint64_t> ordered_cells_to_unrefine(this->cells_to_unrefine.begin(), this->cells_to_unrefine.end());
+		std::sort(ordered_cells_to_unrefine.begin(), ordered_cells_to_unrefine.end());
 
-	/*!
-	Refines the grid so that the given cells exist.
+		std::vector<std::vector<uint64_t>> all_ordered_cells_to_unrefine;
+		All_Gather()(ordered_cells_to_unrefine, all_ordered_cells_to_unrefine, this->comm);
 
-	When calling this function only cells of refinement
-	level 0 must exist in the grid.
-	Must be called by all processes.
-	Ignores cells in given list that aren't a (grand...)
-	child of a local cell (i.e. these cells can be left
-	out of given_cells if they wouldn't fit into memory).
-	Returns true on success and false otherwise.
-
-	\see
-	load_grid_data()
-	cell_overlaps_local()
-	*/
-	bool load_cells(const std::vector<uint64_t>& given_cells)
-	{
-		// get the global maximum refinement level of cells to be loaded
-		std::unordered_set<uint64_t> overlapping
-			= this->get_cells_overlapping_local(given_cells);
+		for (unsigned int process = 0; process < this->comm_size; process++) {
+			if (!std::equal(
+				all_ordered_cells_to_unrefine[process].begin(),
+				all_ordered_cells_to_unrefine[process].end(),
+				all_ordered_cells_to_unrefine[0].begin()
+			)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " cells_to_unrefine differ between processes 0 and " << process
+					<< std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+		#endif
 
-		int local_max_ref_lvl_of_overlapping = 0;
-		for (const uint64_t cell: overlapping) {
-			const int refinement_level = this->mapping.get_refinement_level(cell);
-			local_max_ref_lvl_of_overlapping
-				= std::max(refinement_level, local_max_ref_lvl_of_overlapping);
+		// with distributed ownership only parents of unrefined cells
+		// close to local cells can affect local neighbor lists
+		std::unordered_set<uint64_t> parents_near_local;
+		if (this->distributed_ownership) {
+			parents_near_local = this->fetch_cells_to_adapt();
 		}
 
-		int max_ref_lvl_of_overlapping = 0, result;
-		result = MPI_Allreduce(
-			&local_max_ref_lvl_of_overlapping,
-			&max_ref_lvl_of_overlapping,
-			1,
-			MPI_INT,
-			MPI_MAX,
-			this->comm
-		);
+		// cells whose neighbor lists have to be updated afterwards
+		std::unordered_set<uint64_t> update_neighbors;
 
-		if (result != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< "MPI_Allreduce failed: " << Error_String()(result)
-				<< std::endl;
-			abort();
-		}
+		// a separate neighborhood update function has to be used
+		// for cells whose children were removed by unrefining
+		std::unordered_set<uint64_t> update_neighbors_unrefined;
 
-		/*
-		Starting from refinement level 0 refine each local cell
-		that has a child in given_cells
-		*/
-		std::vector<std::unordered_set<uint64_t>> cells_and_parents(max_ref_lvl_of_overlapping);
+		// refines
+		for (const uint64_t refined: this->cells_to_refine) {
 
-		// refine local cells recursively until all given_cells are created
-		for (const uint64_t cell: overlapping) {
-			uint64_t current_child = cell;
-			const int refinement_level = this->mapping.get_refinement_level(current_child);
-			for (int i = refinement_level - 1; i >= 0; i--) {
-				const uint64_t parent = this->mapping.get_parent(current_child);
-				cells_and_parents[i].insert(parent);
-				current_child = parent;
+			#ifdef DEBUG
+			if (this->cell_process.count(refined) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << refined
+					<< " doesn't exist"
+					<< std::endl;
+				abort();
 			}
-		}
 
-		for (int
-			current_ref_lvl = 0;
-			current_ref_lvl < max_ref_lvl_of_overlapping;
-			current_ref_lvl++
-		) {
-			for (const uint64_t cell: cells_and_parents[current_ref_lvl]) {
-				this->refine_completely(cell);
+			if (this->rank == this->cell_process.at(refined)
+			&& this->cell_data.count(refined) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Data for cell " << refined
+					<< " doesn't exist"
+					<< std::endl;
+				abort();
 			}
-			this->stop_refining();
-			this->clear_refined_unrefined_data();
-		}
-
-		return true;
-	}
 
 
-	/*!
-	Starts the procedure of moving cells between processes.
-
-	Default constructs arriving cells.
-	Does not transfer any cell data, use continue_balance_load() for that,
-	or if cell data doesn't have to be transferred in several steps use
-	balance_load() instead of this function.
+			if (this->cell_process.at(refined) == this->rank
+			&& this->neighbors_of.count(refined) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Neighbor list for cell " << refined
+					<< " doesn't exist"
+					<< std::endl;
+				abort();
+			}
 
-	After calling this the functions get_cells_to_send() and
-	get_cells_to_receive() can be used to query changes to the
-	current partition.
+			if (this->cell_process.at(refined) == this->rank
+			&& this->neighbors_to.count(refined) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Neighbor_to list for cell " << refined
+					<< " doesn't exist"
+					<< std::endl;
+				abort();
+			}
+			#endif
 
-	The next function to be called after this one (from those that
-	must be called by all processes) must be either continue_balance_load()
-	or finish_balance_load(). Information related to the other functions
-	must not be queried after calling this, for example the remote neighbors
-	of local cells, local cells, etc.
+			const uint64_t process_of_refined = this->cell_process.at(refined);
 
-	\see
-	balance_load()
-	continue_balance_load()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& initialize_balance_load(const bool use_zoltan)
-	{
-		if (this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " initialize_balance_load(...) called the second time "
-				<< "before calling finish_balance_load() first"
-				<< std::endl;
-			abort();
-		}
+			// move user data of refined cells into refined_cell_data
+			if (this->rank == process_of_refined) {
+				// TODO: move data instead of copying
+				this->refined_cell_data[refined] = this->cell_data.at(refined);
+				this->cell_data.erase(refined);
+			}
 
-		this->balancing_load = true;
+			// add children of refined cells into the grid
+			const std::vector<uint64_t> children = this->get_all_children(refined);
+			for (const uint64_t child: children) {
+				this->cell_process[child] = process_of_refined;
 
-		#ifdef DEBUG
-		if (!this->verify_remote_neighbor_info()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info is not consistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
+				if (this->rank == process_of_refined) {
+					this->cell_data[child];
+					this->neighbors_of[child];
+					this->neighbors_to[child];
+					this->cells_with_changed_neighbors.insert(child);
+					new_cells.push_back(child);
+				}
+			}
 
-		if (!this->verify_user_data()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " User data not consistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
-		#endif
+			// children of refined cells inherit their pin request status
+			if (this->pin_requests.count(refined) > 0) {
+				for (const uint64_t child: children) {
+					this->pin_requests[child] = this->pin_requests.at(refined);
+				}
+				this->pin_requests.erase(refined);
+			}
+			if (this->new_pin_requests.count(refined) > 0) {
+				for (const uint64_t child: children) {
+					this->new_pin_requests[child] = this->new_pin_requests.at(refined);
+				}
+				this->new_pin_requests.erase(refined);
+			}
 
-		this->make_new_partition(use_zoltan);
+			// children of refined cells inherit their weight
+			if (this->rank == process_of_refined
+			&& this->cell_weights.count(refined) > 0) {
+				for (const uint64_t child: children) {
+					this->cell_weights[child] = this->cell_weights.at(refined);
+				}
+				this->cell_weights.erase(refined);
+			}
+			if (this->rank == process_of_refined
+			&& this->additional_cell_weights.count(refined) > 0) {
+				for (const uint64_t child: children) {
+					this->additional_cell_weights[child] = this->additional_cell_weights.at(refined);
+				}
+				this->additional_cell_weights.erase(refined);
+			}
 
-		// default construct user data of arriving cells
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
-			sender_item = this->cells_to_receive.begin();
-			sender_item != this->cells_to_receive.end();
-			sender_item++
-		) {
-			for (std::vector<std::pair<uint64_t, int>>::const_iterator
-				cell_item = sender_item->second.begin();
-				cell_item != sender_item->second.end();
-				cell_item++
-			) {
-				this->cell_data[cell_item->first];
+			// and an equal share of their measured cost
+			if (this->rank == process_of_refined) {
+				this->split_cell_cost(refined, children, this->cell_costs);
+				this->split_cell_cost(refined, children, this->measured_cell_times);
 			}
-		}
 
-		// clear data related to remote neighbor updates, adaptation, etc.
-		this->local_cells_on_process_boundary.clear();
-		this->remote_cells_on_process_boundary.clear();
-		this->user_local_cells_on_process_boundary.clear();
-		this->user_remote_cells_on_process_boundary.clear();
-		this->user_neigh_cells_to_send.clear();
-		this->user_neigh_cells_to_receive.clear();
-		this->remote_neighbors.clear();
-		this->cells_to_refine.clear();
-		this->refined_cell_data.clear();
-		this->cells_to_unrefine.clear();
-		this->unrefined_cell_data.clear();
-		this->cells_not_to_refine.clear();
-		this->cells_not_to_unrefine.clear();
-		this->cell_weights.clear();
+			// use local neighbor lists to find cells whose neighbor lists have to updated
+			if (this->rank == process_of_refined) {
+				// update the neighbor lists of created local cells
+				for (const uint64_t child: children) {
+					update_neighbors.insert(child);
+				}
 
-		#ifdef DEBUG
-		// check that there are no duplicate adds / removes
-		// removed cells on all processes
-		std::vector<uint64_t> temp_removed_cells(
-			this->removed_cells.begin(),
-			this->removed_cells.end()
-		);
-		std::sort(temp_removed_cells.begin(), temp_removed_cells.end());
+				// update neighbor lists of all the parent's neighbors
+				for (const auto& neighbor_i: this->neighbors_of.at(refined)) {
+					const auto& neighbor = neighbor_i.first;
 
-		std::vector<std::vector<uint64_t>> all_removed_cells;
-		All_Gather()(temp_removed_cells, all_removed_cells, this->comm);
+					if (neighbor == error_cell) {
+						continue;
+					}
 
-		// created cells on all processes
-		std::vector<uint64_t> temp_added_cells(
-			this->added_cells.begin(),
-			this->added_cells.end()
-		);
-		std::sort(temp_added_cells.begin(), temp_added_cells.end());
-
-		std::vector<std::vector<uint64_t>> all_added_cells;
-		All_Gather()(temp_added_cells, all_added_cells, this->comm);
-
-		std::unordered_set<uint64_t> all_adds, all_removes;
-
-		for (const auto& item: all_removed_cells) {
-			for (const uint64_t removed_cell: item) {
+					if (this->cell_process.at(neighbor) == this->rank) {
+						update_neighbors.insert(neighbor);
+					}
+				}
 
-				if (all_removes.count(removed_cell) > 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << removed_cell
-						<< " was already removed"
-						<< std::endl;
-					abort();
+				for (const auto& neighbor_to_i: this->neighbors_to.at(refined)) {
+					const auto& neighbor_to = neighbor_to_i.first;
+					if (this->cell_process.at(neighbor_to) == this->rank) {
+						update_neighbors.insert(neighbor_to);
+					}
 				}
-				all_removes.insert(removed_cell);
 			}
-		}
 
-		for (const auto& item: all_added_cells) {
-			for (const uint64_t added_cell: item) {
+			// without using local neighbor lists figure out rest of the
+			// neighbor lists that need updating
+			if (this->remote_cells_on_process_boundary.count(refined) > 0) {
 
-				if (all_adds.count(added_cell) > 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << added_cell
-						<< " was already removed"
-						<< std::endl;
-					abort();
-				}
-				all_adds.insert(added_cell);
-			}
-		}
+				/*
+				No need to update local neighbors_to of refined cell, if they are larger
+				they will also be refined and updated.
+				*/
+				const auto neighbors
+					= this->find_neighbors_of(
+						refined,
+						this->neighborhood_of,
+						2 * this->max_ref_lvl_diff,
+						true
+					);
 
-		// check that cells were removed by their process
-		for (uint64_t cell_remover = 0; cell_remover < all_removed_cells.size(); cell_remover++) {
+				for (const auto& neighbor_i: neighbors) {
+					const auto& neighbor = neighbor_i.first;
 
-			for (const uint64_t removed_cell: all_removed_cells.at(cell_remover)) {
+					if (neighbor == error_cell) {
+						continue;
+					}
 
-				if (this->cell_process.at(removed_cell) != cell_remover) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << removed_cell
-						<< " doesn't belong to process " << cell_remover
-						<< std::endl;
-					abort();
+					if (this->is_local(neighbor)) {
+						update_neighbors.insert(neighbor);
+					}
 				}
 			}
 		}
-		#endif
-		return *this;
-	}
-
-	/*!
-	Transfers cell data between processes based on the new partition.
-
-	Must be called by all processes and not before initialize_balance_load(...)
-	has been called.
-
-	The next function to be called after this one (from those that
-	must be called by all processes) must be either this again or
-	finish_balance_load().
-
-	\see
-	finish_balance_load()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& continue_balance_load()
-	{
-		if (!this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " continue_balance_load() called without "
-				<< "calling initialize_balance_load(...) first."
-				<< std::endl;
-			abort();
-		}
-
-		this->start_user_data_transfers(
-			this->cell_data,
-			this->cells_to_receive,
-			this->cells_to_send,
-			-2
-		);
-
-		this->wait_user_data_transfer_receives();
-
-		this->wait_user_data_transfer_sends();
-		return *this;
-	}
-
-	/*!
-	Finishes the procedure of moving cells between processes.
-
-	Must be called by all processes and not before initialize_balance_load(...)
-	has been called.
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& finish_balance_load()
-	{
-		if (!this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " finish_balance_load() called without "
-				<< "calling initialize_balance_load(...) first."
-				<< std::endl;
-			abort();
-		}
 
-		this->cells_to_send.clear();
-		this->cells_to_receive.clear();
+		// needed for checking which neighborhoods to update due to unrefining
+		std::unordered_set<uint64_t> parents_of_unrefined;
 
-		/*
-		Calculate where cells have migrated to update internal data structures
-		*/
+		// initially only one sibling is recorded per process when unrefining,
+		// insert the rest of them now
+		for (const uint64_t unrefined: this->cells_to_unrefine) {
 
-		// removed cells on all processes
-		std::vector<uint64_t> temp_removed_cells(
-			this->removed_cells.begin(),
-			this->removed_cells.end()
-		);
+			const uint64_t parent_of_unrefined = this->get_parent(unrefined);
+			#ifdef DEBUG
+			if (unrefined != this->get_child(unrefined)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << unrefined
+					<< " has children"
+					<< std::endl;
+				abort();
+			}
 
-		// created cells on all processes
-		std::vector<uint64_t> temp_added_cells(
-			this->added_cells.begin(),
-			this->added_cells.end()
-		);
+			if (parent_of_unrefined == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__ << " Invalid parent cell" << std::endl;
+				abort();
+			}
 
-		std::vector<std::vector<uint64_t>> all_added_cells;
-		All_Gather()(temp_added_cells, all_added_cells, this->comm);
+			if (parent_of_unrefined == unrefined) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << unrefined
+					<< " has no parent"
+					<< std::endl;
+				abort();
+			}
+			#endif
 
-		#ifdef DEBUG
-		std::vector<std::vector<uint64_t> > all_removed_cells;
-		All_Gather()(temp_removed_cells, all_removed_cells, this->comm);
+			parents_of_unrefined.insert(parent_of_unrefined);
 
-		// check that there are no duplicate adds / removes
-		std::unordered_set<uint64_t> all_adds, all_removes;
+			const std::vector<uint64_t> siblings = this->get_all_children(parent_of_unrefined);
 
-		for (const auto& item: all_removed_cells) {
-			for (const uint64_t removed_cell: item) {
+			#ifdef DEBUG
+			bool unrefined_in_siblings = false;
+			for (const uint64_t sibling: siblings) {
 
-				if (all_removes.count(removed_cell) > 0) {
+				if (this->cell_process.count(sibling) == 0) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << removed_cell
-						<< " was already removed"
+						<< " Cell " << sibling
+						<< " doesn't exist"
 						<< std::endl;
 					abort();
 				}
-				all_removes.insert(removed_cell);
-			}
-		}
-
-		for (const auto& item: all_added_cells) {
-			for (const uint64_t added_cell: item) {
 
-				if (all_adds.count(added_cell) > 0) {
+				if (sibling != this->get_child(sibling)) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << added_cell
-						<< " was already removed"
+						<< " Cell " << sibling
+						<< " has has children"
 						<< std::endl;
 					abort();
 				}
-				all_adds.insert(added_cell);
-			}
-		}
-
-		// check that cells were removed by their process
-		for (uint64_t cell_remover = 0; cell_remover < all_removed_cells.size(); cell_remover++) {
-
-			for (const uint64_t removed_cell: all_removed_cells.at(cell_remover)) {
 
-				if (this->cell_process.at(removed_cell) != cell_remover) {
+				if (this->cell_process.at(sibling) == this->rank
+				&& this->cell_data.count(sibling) == 0) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << removed_cell
-						<< " doesn't belong to process " << cell_remover
+						<< " Cell " << sibling
+						<< " has no data"
 						<< std::endl;
 					abort();
 				}
-			}
-		}
-		#endif
 
-		// update cell to process mappings
-		for (uint64_t cell_creator = 0; cell_creator < all_added_cells.size(); cell_creator++) {
+				if (unrefined == sibling) {
+					unrefined_in_siblings = true;
+				}
+			}
 
-			for (const uint64_t created_cell: all_added_cells.at(cell_creator)) {
-				this->cell_process.at(created_cell) = cell_creator;
+			if (!unrefined_in_siblings) {
+				std::cerr << __FILE__ << ":" << __LINE__ << " Cell to unrefine isn't its parent's child" << std::endl;
+				abort();
 			}
-		}
+			#endif
 
-		#ifdef DEBUG
-		if (!this->is_consistent()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Grid is not consistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
+			this->all_to_unrefine.insert(siblings.begin(), siblings.end());
 		}
 
-		if (!this->pin_requests_succeeded()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Pin requests didn't succeed"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
-		#endif
+		// total cost and number of local children of parents of unrefined cells
+		std::unordered_map<uint64_t, std::pair<double, uint64_t>> unrefined_costs;
 
-		// create neighbor lists for cells without children that came to this process
-		for (const uint64_t added_cell: this->added_cells) {
+		// unrefines
+		for (const uint64_t unrefined: this->all_to_unrefine) {
 
-			if (added_cell != this->get_child(added_cell)) {
+			const uint64_t parent_of_unrefined = this->get_parent(unrefined);
+			#ifdef DEBUG
+			if (parent_of_unrefined == unrefined) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << unrefined
+					<< " has no parent"
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			const uint64_t process_of_parent = this->cell_process.at(parent_of_unrefined);
+			const uint64_t process_of_unrefined = this->cell_process.at(unrefined);
+
+			// remove unrefined cells and their siblings from the grid, but don't remove user data yet
+			this->cell_process.erase(unrefined);
+			update_neighbors.erase(unrefined);
+			this->pin_requests.erase(unrefined);
+			this->new_pin_requests.erase(unrefined);
+			this->cell_weights.erase(unrefined);
+			this->additional_cell_weights.erase(unrefined);
+
+			if (this->rank == process_of_unrefined) {
+				const auto cost = this->cell_costs.find(unrefined);
+				if (cost != this->cell_costs.end()) {
+					if (this->rank == process_of_parent) {
+						auto& parent_cost = unrefined_costs[parent_of_unrefined];
+						parent_cost.first += cost->second;
+						parent_cost.second++;
+					}
+					this->cell_costs.erase(cost);
+				}
+				this->measured_cell_times.erase(unrefined);
+			}
+
+			// don't send unrefined cells' user data to self
+			if (this->rank == process_of_unrefined
+			&& this->rank == process_of_parent) {
+
+				#ifdef DEBUG
+				if (this->cell_data.count(unrefined) == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << unrefined
+						<< " to be unrefined has no data"
+						<< std::endl;
+					abort();
+				}
+				#endif
+
+				// TODO move data instead of copying
+				this->unrefined_cell_data[unrefined] = this->cell_data.at(unrefined);
+				this->cell_data.erase(unrefined);
+
+			// send user data of removed cell to the parent's process
+			} else if (this->rank == process_of_unrefined) {
+
+				this->cells_to_send[process_of_parent].push_back(
+					std::make_pair(unrefined, -1)
+				);
+
+			// receive user data of removed cell from its process
+			} else if (this->rank == process_of_parent) {
+				this->cells_to_receive[process_of_unrefined].push_back(
+					std::make_pair(unrefined, -1)
+				);
+			}
+		}
+
+		// parents get the cost of all children estimated from local ones
+		for (const auto& item: unrefined_costs) {
+			this->cell_costs[item.first]
+				= item.second.first * 8 / double(item.second.second);
+		}
+
+		// receive cells in known order and add message tags
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
+			sender = this->cells_to_receive.begin();
+			sender != this->cells_to_receive.end();
+			sender++
+		) {
+			std::sort(sender->second.begin(), sender->second.end());
+			// TODO: merge with identical code in make_new_partition
+			for (unsigned int i = 0; i < sender->second.size(); i++) {
+
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for receiving cell " << sender->second[i].first
+						<< " from process " << sender->first
+						<< std::endl;
+					abort();
+				}
+
+				sender->second[i].second = tag;
+			}
+		}
+
+		// send cells in known order and add message tags
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
+			receiver = this->cells_to_send.begin();
+			receiver != this->cells_to_send.end();
+			receiver++
+		) {
+			std::sort(receiver->second.begin(), receiver->second.end());
+			// TODO: check that message tags don't overflow
+			for (unsigned int i = 0; i < receiver->second.size(); i++) {
+
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for sending cell " << receiver->second[i].first
+						<< " to process " << receiver->first
+						<< std::endl;
+					abort();
+				}
+
+				receiver->second[i].second = tag;
+			}
+		}
+
+		// update data for parents (and their neighborhood) of unrefined cells
+		for (const uint64_t parent: parents_of_unrefined) {
+
+			if (this->distributed_ownership and parents_near_local.count(parent) == 0) {
 				continue;
 			}
 
-			// TODO: use this->update_neighbors(added_cell)
-			this->neighbors_of[added_cell]
-				= this->find_neighbors_of(added_cell, this->neighborhood_of, this->max_ref_lvl_diff);
-			this->neighbors_to[added_cell]
-				= this->find_neighbors_to(added_cell, this->neighborhood_to);
+			/* TODO: skip unrefined cells far enough away
+			std::vector<uint64_t> children = this->get_all_children(*parent);
+			*/
 
-			// also update user neighbor lists
+			#ifdef DEBUG
+			if (this->cell_process.count(parent) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Parent " << parent
+					<< " doesn't exist"
+					<< std::endl;
+				abort();
+			}
+
+			if (parent != this->get_child(parent)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Parent " << parent
+					<< " still has children"
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			const auto new_neighbors_of
+				= this->find_neighbors_of(parent, this->neighborhood_of, this->max_ref_lvl_diff);
+
+			for (const auto& neighbor_i: new_neighbors_of) {
+				const auto& neighbor = neighbor_i.first;
+
+				if (neighbor == 0) {
+					continue;
+				}
+
+				if (this->cell_process.at(neighbor) == this->rank) {
+					update_neighbors.insert(neighbor);
+				}
+			}
+
+			const auto new_neighbors_to
+				= this->find_neighbors_to(parent, this->neighborhood_to);
+			for (const auto& neighbor_i: new_neighbors_to) {
+				const auto& neighbor = neighbor_i.first;
+				if (this->cell_process.at(neighbor) == this->rank) {
+					update_neighbors.insert(neighbor);
+				}
+			}
+
+			// add user data and neighbor lists of local parents of unrefined cells
+			if (this->cell_process.at(parent) == this->rank) {
+				this->cell_data[parent];
+				this->neighbors_of[parent] = new_neighbors_of;
+				this->neighbors_to[parent] = new_neighbors_to;
+				this->cells_with_changed_neighbors.insert(parent);
+
+				// add user neighbor lists
+				for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
+					item = this->user_hood_of.begin();
+					item != this->user_hood_of.end();
+					item++
+				) {
+					this->update_user_neighbors(parent, item->first);
+				}
+			}
+		}
+
+		// update neighbor lists of cells affected by refining / unrefining
+		for (const uint64_t cell: update_neighbors) {
+			this->update_neighbors(cell);
+			//update also neighbor lists of user neighborhoods
 			for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
 				item = this->user_hood_of.begin();
 				item != this->user_hood_of.end();
 				item++
 			) {
-				this->update_user_neighbors(added_cell, item->first);
+				this->update_user_neighbors(cell, item->first);
 			}
 		}
 
-		// free user data and neighbor lists of cells removed from this process
-		for (const uint64_t removed_cell: this->removed_cells) {
-			this->cell_data.erase(removed_cell);
-			this->neighbors_of.erase(removed_cell);
-			this->neighbors_to.erase(removed_cell);
+		// remove neighbor lists of added cells' parents
+		for (const uint64_t refined: this->cells_to_refine) {
 
-			// also user neighbor lists
+			if (this->cell_process.at(refined) == this->rank) {
+
+				#ifdef DEBUG
+				if (this->neighbors_of.count(refined) == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Neighbor list for cell " << refined
+						<< " doesn't exist"
+						<< std::endl;
+					abort();
+				}
+
+				if (this->neighbors_to.count(refined) == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Neighbor_to list for cell " << refined
+						<< " doesn't exist"
+						<< std::endl;
+					abort();
+				}
+				#endif
+
+				this->neighbors_of.erase(refined);
+				this->neighbors_to.erase(refined);
+				this->cells_with_changed_neighbors.insert(refined);
+
+				// remove also from user's neighborhood
+				for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
+					item = this->user_hood_of.begin();
+					item != this->user_hood_of.end();
+					item++
+				) {
+					this->user_neigh_of.at(item->first).erase(refined);
+					this->user_neigh_to.at(item->first).erase(refined);
+				}
+			}
+		}
+
+		// remove neighbor lists of removed cells
+		for (const uint64_t unrefined: this->all_to_unrefine) {
+			this->neighbors_of.erase(unrefined);
+			this->neighbors_to.erase(unrefined);
+			this->cells_with_changed_neighbors.insert(unrefined);
+			// also from user neighborhood
 			for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
 				item = this->user_hood_of.begin();
 				item != this->user_hood_of.end();
 				item++
 			) {
-				this->user_neigh_of.at(item->first).erase(removed_cell);
-				this->user_neigh_to.at(item->first).erase(removed_cell);
+				this->user_neigh_of.at(item->first).erase(unrefined);
+				this->user_neigh_to.at(item->first).erase(unrefined);
 			}
 		}
 
@@ -4532,4703 +5047,11342 @@ public:
 			this->update_user_remote_neighbor_info(item->first);
 		}
 
-		this->recalculate_neighbor_update_send_receive_lists();
-
-		this->allocate_copies_of_remote_neighbors();
-		this->update_cell_pointers();
-		for (const auto& item: this->user_hood_of) {
-			this->allocate_copies_of_remote_neighbors(item.first);
-		}
-
 		#ifdef DEBUG
-		if (!this->is_consistent()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " The grid is inconsistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
-
 		if (!this->verify_neighbors()) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Neighbor lists are incorrect"
+				<< " Neighbor lists are inconsistent"
 				<< std::endl;
 			exit(EXIT_FAILURE);
 		}
+		#endif
 
-		if (!this->verify_remote_neighbor_info()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info is not consistent"
+
+		return new_cells;
+	}
+
+
+	std::vector<uint64_t> get_local_cells_to_refine()
+	{
+		std::vector<uint64_t> retVal;
+		if (!this->refining) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " get_local_cells_to_refine() called outside refining"
 				<< std::endl;
-			exit(EXIT_FAILURE);
+			return retVal;
 		}
 
-		if (!this->verify_user_data()) {
+		for (auto i : cells_to_refine)
+			if (is_local(i))
+				retVal.push_back(i);
+		
+		return retVal;
+	}
+
+	std::vector<uint64_t> get_local_cells_to_unrefine()
+	{
+		std::vector<uint64_t> retVal;
+		if (!this->refining) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " User data not consistent"
+				<< " get_local_cells_to_unrefine() called outside refining"
 				<< std::endl;
-			exit(EXIT_FAILURE);
+			return retVal;
 		}
-		#endif
 
-		this->added_cells.clear();
-		this->removed_cells.clear();
-		this->balancing_load = false;
-		return *this;
+		for (auto i : cells_to_unrefine)
+			if (is_local(i))
+				retVal.push_back(i);
+		
+		return retVal;
 	}
 
-
 	/*!
-	Returns the parent of given existing cell.
+	Transfers unrefined cell data between processes.
 
-	Returns the given cell if it doesn't have a parent
-	or error_cell if given cell doesn't exist.
+	Must be called by all processes and not before execute_refines()
+	has been called.
+
+	The next function to be called after this one (from those that
+	must be called by all processes) must be either this again or
+	finish_refining().
+
+	\see
+	finish_refining()
 	*/
-	uint64_t get_parent(const uint64_t cell) const
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& continue_refining()
 	{
-		if (this->cell_process.count(cell) == 0) {
-			return error_cell;
-		}
-
-		// given cell cannot have a parent
-		if (this->mapping.get_refinement_level(cell) == 0) {
-			return cell;
+		if (!this->refining) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " continue_refining() called without "
+				<< "calling initialize_refines() first."
+				<< std::endl;
+			abort();
 		}
 
-		const uint64_t parent = this->mapping.get_cell_from_indices(
-			this->mapping.get_indices(cell),
-			this->mapping.get_refinement_level(cell) - 1
+		this->start_user_data_transfers(
+			this->unrefined_cell_data,
+			this->cells_to_receive,
+			this->cells_to_send,
+			-3
 		);
 
-		if (this->cell_process.count(parent) > 0) {
-			return parent;
-		} else {
-			return cell;
-		}
+		this->wait_user_data_transfer_receives();
+		this->wait_user_data_transfer_sends();
+		return *this;
 	}
 
-
 	/*!
-	Returns the indices corresponding to the given neighborhood at given indices.
+	Finishes the procedure of moving cells between processes.
 
-	Neighborhood is returned in units of length_in_indices.
-	If grid is not periodic in some direction then indices which would fall outside
-	of the grid in that direction are returned as error_index.
+	Must be called by all processes and not before initialize_balance_load(...)
+	has been called.
 	*/
-	std::vector<Types<3>::indices_t> indices_from_neighborhood(
-		const Types<3>::indices_t indices,
-		const uint64_t length_in_indices,
-		const std::vector<Types<3>::neighborhood_item_t>& neighborhood
-	) const {
-		// TODO: make neighborhood a const reference
-		std::vector<Types<3>::indices_t> return_indices;
-		return_indices.reserve(neighborhood.size());
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& finish_refining()
+	{
+		if (!this->refining) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " finish_refining() called without "
+				<< "calling initialize_refines() first."
+				<< std::endl;
+			abort();
+		}
 
-		// grid length in indices
-		const uint64_t grid_length[3] = {
-			this->length.get()[0] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
-			this->length.get()[1] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
-			this->length.get()[2] * (uint64_t(1) << this->mapping.get_maximum_refinement_level())
-		};
+		this->cells_to_receive.clear();
+		this->cells_to_send.clear();
 
 		#ifdef DEBUG
-		for (unsigned int dimension = 0; dimension < 3; dimension++) {
-			if (indices[dimension] >= grid_length[dimension]) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Given indices outside of the grid in dimension " << dimension
-					<< std::endl;
-				abort();
-			}
+		if (!this->verify_user_data()) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " virhe" << std::endl;
+			exit(EXIT_FAILURE);
 		}
 		#endif
 
-		for (const auto& offsets: neighborhood) {
-
-			Types<3>::indices_t temp_indices = {{indices[0], indices[1], indices[2]}};
-
-			for (unsigned int dimension = 0; dimension < 3; dimension++) {
-				if (offsets[dimension] < 0) {
-
-					if (this->topology.is_periodic(dimension)) {
-
-						// neighborhood might wrap around the grid several times
-						for (int i = 0; i > offsets[dimension]; i--) {
-
-							#ifdef DEBUG
-							if (temp_indices[dimension] < length_in_indices - 1
-							&& temp_indices[dimension] > 0) {
-								std::cerr << __FILE__ << ":" << __LINE__
-									<< " Cells aren't supposed to wrap around the grid."
-									<< std::endl;
-								abort();
-							}
-							#endif
-
-							if (temp_indices[dimension] >= length_in_indices) {
-								temp_indices[dimension] -= length_in_indices;
-							} else {
-								temp_indices[dimension] = grid_length[dimension] - length_in_indices;
-							}
-						}
-					// use error_indices to signal that this neighborhood item is outside of the grid
-					} else {
-						if (indices[dimension] < abs(offsets[dimension]) * length_in_indices) {
-							temp_indices[0] = error_index;
-							temp_indices[1] = error_index;
-							temp_indices[2] = error_index;
-							break;
-						}
+		// remove user data of unrefined cells from this->cell_data
+		for (std::unordered_set<uint64_t>::const_iterator
+			unrefined = this->all_to_unrefine.begin();
+			unrefined != this->all_to_unrefine.end();
+			unrefined++
+		) {
+			this->cell_data.erase(*unrefined);
+		}
 
-						temp_indices[dimension] += offsets[dimension] * length_in_indices;
-					}
+		this->cells_to_refine.clear();
+		this->cells_to_unrefine.clear();
+		this->all_to_unrefine.clear();
 
-				} else {
+		if (this->distributed_ownership) {
+			this->update_cell_directory();
+		}
 
-					if (this->topology.is_periodic(dimension)) {
-						for (int i = 0; i < offsets[dimension]; i++) {
+		this->recalculate_neighbor_update_send_receive_lists();
 
-							#ifdef DEBUG
-							if (temp_indices[dimension] > grid_length[dimension] - length_in_indices) {
-								std::cerr << __FILE__ << ":" << __LINE__
-									<< " Cells aren't supposed to wrap around the grid."
-									<< std::endl;
-								abort();
-							}
-							#endif
+		this->allocate_copies_of_remote_neighbors();
+		for (const auto& item: this->user_hood_of) {
+			this->allocate_copies_of_remote_neighbors(item.first);
+		}
+		this->update_cell_pointers();
 
-							if (temp_indices[dimension] < grid_length[dimension] - length_in_indices) {
-								temp_indices[dimension] += length_in_indices;
-							} else {
-								temp_indices[dimension] = 0;
-							}
-						}
-					} else {
-						if (
-							indices[dimension] + offsets[dimension] * length_in_indices
-							>= grid_length[dimension]
-						) {
-							temp_indices[0] = error_index;
-							temp_indices[1] = error_index;
-							temp_indices[2] = error_index;
-							break;
-						}
+		this->refining = false;
+		return *this;
+	}
 
-						temp_indices[dimension] += offsets[dimension] * length_in_indices;
-					}
-				}
-			}
+	/*!
+	Calls initialize_refines(), execute_refines() and finish_refining() in case transfers aren't needed, i.e. no unrefining
+	*/
+	std::vector<uint64_t> stop_refining(const bool sorted = false)
+	{
+		this->initialize_refines();
 
-			return_indices.push_back(temp_indices);
+		std::vector<uint64_t> ret_val = this->execute_refines();
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
 		}
 
-		return return_indices;
+		if (!this->unrefined_cell_data.empty()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " stop_refining() called with unrefined cells. "
+				<< std::endl;
+		}
+		this->finish_refining();
+		return ret_val;
 	}
 
 
 	/*!
-	Returns the existing neighbors (that don't have children) of given cell.
+	Returns cells that were removed by unrefinement and whose parent is currently a local cell.
 
-	Uses given neighborhood when searching for neighbors.
-	max_diff is the distance to search in refinement level from given cell inclusive.
-	Returns nothing if the following cases:
-		- given cell has children
-		- given doesn't exist
+	Removed cells' data is currently also on this process,
+	but only until balance_load() is called.
 
-	Cells smaller than given one at any offset are returned in the order in which
-	neighbors' index increases first in x, then in y, ...
-	In other words the first small cell within an neighborhood offset is
-	closest to the origin of the grid, the second one is in direction +1
-	from the first, 3rd is in dir +2 from 1st, 4th is in +1 from 3rd, +2 from 2nd,
-	8th is +3 from 4th, +2 from 6th, +1 from 7th, assuming max_ref_lvl_diff == 1
+	By default returned cells are in random order but if sorted == true
+	they are sorted using std::sort before returning.
 	*/
-	// TODO: make private?
-	std::vector<
-		std::pair<
-			uint64_t,
-			std::array<int, 4> // x, y, z offsets and denominator
-		>
-	> find_neighbors_of(
-		const uint64_t cell,
-		const std::vector<Types<3>::neighborhood_item_t>& neighborhood,
-		const int max_diff,
-		const bool has_children = false
-	) const {
-		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
-
-		const int refinement_level
-			= this->mapping.get_refinement_level(cell);
-
-		#ifdef DEBUG
-		if (max_diff < 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " max_diff must not be negative"
-				<< std::endl;
-			abort();
-		}
-
-		if (cell == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Invalid cell given: " << cell
-				<< std::endl;
-			abort();
-		}
+	std::vector<uint64_t> get_removed_cells(const bool sorted = false) const
+	{
+		std::vector<uint64_t> ret_val;
+		ret_val.reserve(this->unrefined_cell_data.size());
 
-		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Refinement level of given cell (" << cell
-				<< ") is too large: " << refinement_level
-				<< std::endl;
-			abort();
+		for (const auto& item: this->unrefined_cell_data) {
+			ret_val.push_back(item.first);
 		}
 
-		if (refinement_level < 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Invalid refinement level for cell " << cell
-				<< ": " << refinement_level
-				<< std::endl;
-			abort();
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
 		}
-		#endif
 
-		if (this->cell_process.count(cell) == 0) {
-			return return_neighbors;
-		}
+		return ret_val;
+	}
 
-		if (!has_children && cell != this->get_child(cell)) {
-			return return_neighbors;
-		}
 
-		const uint64_t cell_length
-			= this->mapping.get_cell_length_in_indices(cell);
+	/*!
+	Returns all cells in the grid that don't have children (e.g. leaf cells).
 
-		const std::vector<Types<3>::indices_t> indices_of
-			= this->indices_from_neighborhood(
-				this->mapping.get_indices(cell),
-				cell_length,
-				neighborhood
-			);
+	Only those cells are returned which this process knows about, this
+	might not include all cells that exist on all processes.
 
-		for (size_t index_of_i = 0; index_of_i < indices_of.size(); index_of_i++) {
-			const auto& index_of = indices_of[index_of_i];
+	By default returned cells are in random order but if sorted == true
+	they are sorted using std::sort before returning.
 
-			if (index_of[0] == error_index) {
-				return_neighbors.push_back({0, {0, 0, 0, 0}});
-				continue;
-			}
+	\see
+	get_cells()
+	*/
+	std::vector<uint64_t> get_all_cells(const bool sorted = false) const
+	{
+		std::vector<uint64_t> ret_val;
+		ret_val.reserve(this->cell_process.size());
 
-			const uint64_t neighbor = this->get_existing_cell(
-				index_of,
-				[&](){
-					if (refinement_level < max_diff) {
-						return 0;
-					} else {
-						return refinement_level - max_diff;
-					}
-				}(),
-				[&](){
-					if (refinement_level <= this->mapping.get_maximum_refinement_level() - max_diff) {
-						return refinement_level + max_diff;
-					} else {
-						return this->mapping.get_maximum_refinement_level();
-					}
-				}()
-			);
+		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
+			item = this->cell_process.begin();
+			item != this->cell_process.end();
+			item++
+		) {
 
-			#ifdef DEBUG
-			if (neighbor == error_cell) {
-				const Types<3>::indices_t indices = this->mapping.get_indices(cell);
-				const uint64_t smallest
-					= this->get_existing_cell(index_of, 0, this->mapping.get_maximum_refinement_level());
+			const uint64_t child = this->get_child(item->first);
 
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor not found for cell " << cell
-					<< " (at indices " << indices[0]
-					<< "," << indices[1]
-					<< "," << indices[2]
-					<< "; ref. lvl. " << refinement_level
-					<< ", child of " << this->get_parent(cell)
-					<< ") within refinement levels [" << refinement_level - max_diff
-					<< ", " << refinement_level + max_diff
-					<< "], smallest cell found at indices " << index_of[0]
-					<< "," << index_of[1]
-					<< "," << index_of[2]
-					<< " was " << smallest
-					<< " with refinement level " << this->mapping.get_refinement_level(smallest)
-					<< std::endl;
-				abort();
+			if (child == item->first) {
+				ret_val.push_back(item->first);
 			}
+		}
 
-			if (this->cell_process.count(neighbor) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor " << neighbor
-					<< " doesn't exist"
-					<< std::endl;
-				abort();
-			}
-			#endif
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
+		}
 
-			const int neighbor_ref_lvl
-				= this->mapping.get_refinement_level(neighbor);
+		return ret_val;
+	}
 
-			#ifdef DEBUG
-			if (neighbor_ref_lvl < 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Invalid refinement level for neighbor " << neighbor
-					<< " of cell " << cell
-					<< std::endl;
-				abort();
-			}
-			#endif
 
-			if (neighbor_ref_lvl <= refinement_level) {
-				return_neighbors.push_back({
-					neighbor,
-					{
-						neighborhood[index_of_i][0],
-						neighborhood[index_of_i][1],
-						neighborhood[index_of_i][2],
-						[&](){
-							if (neighbor_ref_lvl == refinement_level) {
-								return 1;
-							} else {
-								return -2; // TODO: max ref lvl diff > 1
-							}
-						}()
-					}
-				});
-			// add all cells at current search indices within size of given cell
-			} else {
+	/*!
+	Returns true if given cell overlaps a local cell.
 
-				const Types<3>::indices_t index_max = {{
-					index_of[0] + cell_length - 1,
-					index_of[1] + cell_length - 1,
-					index_of[2] + cell_length - 1
-				}};
+	Returns true if given cell is either a local cell of
+	refinement level 0 or is a (grandgrand...)child of a
+	local cell with refinement level 0.
+	Returns false otherwise.
 
-				const std::vector<uint64_t> current_neighbors = this->find_cells(
-					index_of,
-					index_max,
-					std::max(0, refinement_level - max_diff),
-					std::min(this->mapping.get_maximum_refinement_level(), refinement_level + max_diff)
-				);
+	\see
+	get_cells_overlapping_local()
+	*/
+	bool cell_overlaps_local(const uint64_t cell) const
+	{
+		const uint64_t parent = this->mapping.get_level_0_parent(cell);
 
-				#ifdef DEBUG
-				if (current_neighbors.size() == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " No neighbors for cell " << cell
-						<< " starting at indices " << index_of[0]
-						<< ", " << index_of[1]
-						<< ", " << index_of[2]
-						<< " between refinement levels " << refinement_level - max_diff
-						<< ", " << refinement_level + max_diff
-						<< std::endl;
-					abort();
-				}
+		if (this->cell_process.count(parent) > 0
+		&& this->cell_process.at(parent) == this->rank) {
+			return true;
+		} else {
+			return false;
+		}
+	}
 
-				if (current_neighbors.size() < 8) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Too few neighbors for cell " << cell
-						<< " of size " << cell_length
-						<< " with max_diff " << max_diff
-						<< std::endl;
 
-					std::cerr << "Found: ";
-					for (const uint64_t found: current_neighbors) {
-						std::cerr << found << " ";
-					}
+	/*!
+	Returns those cells from given that are either local or a child of local.
 
-					std::cerr << "\nShould be: ";
-					const std::vector<uint64_t> real_neighbors = this->find_cells(
-						index_of,
-						index_max,
-						0,
-						this->mapping.get_maximum_refinement_level()
-					);
-					for (const uint64_t real: real_neighbors) {
-						std::cerr << real << " ";
-					}
-					std::cerr << std::endl;
+	Assumes local cells are of refinement level 0.
+	*/
+	std::unordered_set<uint64_t> get_cells_overlapping_local(const std::vector<uint64_t>& given_cells) const
+	{
+		std::unordered_set<uint64_t> result;
 
-					abort();
-				}
+		for (const uint64_t cell: given_cells) {
 
-				for (const uint64_t current_neighbor: current_neighbors) {
-					if (this->cell_process.count(current_neighbor) == 0) {
-						std::cerr << __FILE__ << ":" << __LINE__
-							<< " Neighbor " << current_neighbor
-							<< " doesn't exist between refinement levels "
-							<< refinement_level - max_diff
-							<< ", " << refinement_level + max_diff
-							<< std::endl;
-						abort();
-					}
-				}
-				#endif
-
-				if (has_children) {
-					// offsets shouldn't be needed anywhere
-					for (const auto& current_neighbor: current_neighbors) {
-						return_neighbors.push_back({
-							current_neighbor, {0, 0, 0, 0}
-						});
-					}
-
-					continue;
-				}
-
-				if (current_neighbors.size() != 8) {
-					std::cerr << __FILE__ "(" << __LINE__ << ") "
-						<< "Unexpected number of neighbors: "
-						<< current_neighbors.size() << std::endl;
-					abort();
-				}
-
-				const auto
-					offset_x = 2 * neighborhood[index_of_i][0],
-					offset_y = 2 * neighborhood[index_of_i][1],
-					offset_z = 2 * neighborhood[index_of_i][2];
-				size_t neighbor_i = 0;
-				for (int off_mod_z: {-1, 0}) {
-					if (offset_z < 0) {
-						off_mod_z++;
-					} else if (offset_z == 0) {
-						off_mod_z = 0;
-					}
-					for (int off_mod_y: {-1, 0}) {
-						if (offset_y < 0) {
-							off_mod_y++;
-						} else if (offset_y == 0) {
-							off_mod_y = 0;
-						}
-						for (int off_mod_x: {-1, 0}) {
-							if (offset_x < 0) {
-								off_mod_x++;
-							} else if (offset_x == 0) {
-								off_mod_x = 0;
-							}
-							#ifdef DEBUG
-							if (
-								offset_x + off_mod_x == 0
-								and offset_y + off_mod_y == 0
-								and offset_z + off_mod_z == 0
-							) {
-								std::cerr << __FILE__ "(" << __LINE__ << ") "
-									<< "Unexpected neighbor offset for neighborhood indices "
-									<< neighborhood[index_of_i][0] << ", "
-									<< neighborhood[index_of_i][1] << ", "
-									<< neighborhood[index_of_i][2] << ": "
-									<< offset_x << ", " << off_mod_x << "; "
-									<< offset_y << ", " << off_mod_y << "; "
-									<< offset_z << ", " << off_mod_z << std::endl;
-								abort();
-							}
-							#endif
-							return_neighbors.push_back({
-								current_neighbors[neighbor_i++], {
-									offset_x + off_mod_x,
-									offset_y + off_mod_y,
-									offset_z + off_mod_z,
-									2
-								}
-							});
-						}
-					}
-				}
+			if (this->cell_overlaps_local(cell)) {
+				result.insert(cell);
 			}
 		}
 
-		return return_neighbors;
+		return result;
 	}
 
 
-
 	/*!
-	Returns cells (which don't have children) that consider given cell as a neighbor.
+	Refines the grid so that the given cells exist.
 
-	Returns nothing if the following cases:
-		- given cell has children
-		- given cell doesn't exist on any process
-	Returned cells are not in any particular order.
-	Assumes a maximum refinement level difference of one between neighbors
-	(both cases: neighbors_of, neighbors_to).
+	When calling this function only cells of refinement
+	level 0 must exist in the grid.
+	Must be called by all processes.
+	Ignores cells in given list that aren't a (grand...)
+	child of a local cell (i.e. these cells can be left
+	out of given_cells if they wouldn't fit into memory).
+	Returns true on success and false otherwise.
 
-	TODO: currently returned offsets and denominator are all 0.
+	\see
+	load_grid_data()
+	cell_overlaps_local()
 	*/
-	std::vector<
-		std::pair<
-			uint64_t,
-			std::array<int, 4>
-		>
-	> find_neighbors_to(
-		const uint64_t cell,
-		const std::vector<Types<3>::neighborhood_item_t>& neighborhood
-	) const {
-		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
+	bool load_cells(const std::vector<uint64_t>& given_cells)
+	{
+		// get the global maximum refinement level of cells to be loaded
+		std::unordered_set<uint64_t> overlapping
+			= this->get_cells_overlapping_local(given_cells);
 
-		if (
-			cell == error_cell
-			or cell > this->mapping.get_last_cell()
-			or this->cell_process.count(cell) == 0
-			or cell != this->get_child(cell)
-		) {
-			return return_neighbors;
+		int local_max_ref_lvl_of_overlapping = 0;
+		for (const uint64_t cell: overlapping) {
+			const int refinement_level = this->mapping.get_refinement_level(cell);
+			local_max_ref_lvl_of_overlapping
+				= std::max(refinement_level, local_max_ref_lvl_of_overlapping);
 		}
 
-		const int refinement_level = this->mapping.get_refinement_level(cell);
-
-		#ifdef DEBUG
-		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Refinement level (" << refinement_level
-				<< ") of cell " << cell
-				<< " exceeds maximum refinement level of the grid ("
-				<< this->mapping.get_maximum_refinement_level() << ")"
-				<< std::endl;
-			abort();
-		}
+		int max_ref_lvl_of_overlapping = 0, result;
+		result = MPI_Allreduce(
+			&local_max_ref_lvl_of_overlapping,
+			&max_ref_lvl_of_overlapping,
+			1,
+			MPI_INT,
+			MPI_MAX,
+			this->comm
+		);
 
-		if (refinement_level < 0) {
+		if (result != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Refinement level of cell " << cell
-				<< " is less than 0: " << refinement_level
+				<< "MPI_Allreduce failed: " << Error_String()(result)
 				<< std::endl;
 			abort();
 		}
-		#endif
 
 		/*
-		FIXME: neighbors should be unique only in within
-		each offset in user neighborhood?
-		Would allow users to have the same offset
-		multiple times in their neighborhoods.
+		Starting from refinement level 0 refine each local cell
+		that has a child in given_cells
 		*/
-		std::unordered_map<uint64_t, std::array<int, 4>> unique_neighbors;
-
-		// neighbors_to larger than given cell
-		if (refinement_level > 0) {
-			const auto parent = this->get_parent(cell);
-			const auto indices = this->mapping.get_indices(parent);
-			const auto length_in_indices = this->mapping.get_cell_length_in_indices(parent);
-
-			const auto search_indices = this->indices_from_neighborhood(
-				indices,
-				length_in_indices,
-				neighborhood
-			);
-
-			for (size_t i = 0; i < search_indices.size(); i++) {
-				const auto& search_index = search_indices[i];
-
-				if (search_index[0] == error_index) {
-					continue;
-				}
-
-				const uint64_t found
-					= this->mapping.get_cell_from_indices(search_index, refinement_level - 1);
+		std::vector<std::unordered_set<uint64_t>> cells_and_parents(max_ref_lvl_of_overlapping);
 
-				// only add if found cell doesn't have children
-				if (found == this->get_child(found)) {
-					unique_neighbors[found] = {0, 0, 0, 0};
-				}
+		// refine local cells recursively until all given_cells are created
+		for (const uint64_t cell: overlapping) {
+			uint64_t current_child = cell;
+			const int refinement_level = this->mapping.get_refinement_level(current_child);
+			for (int i = refinement_level - 1; i >= 0; i--) {
+				const uint64_t parent = this->mapping.get_parent(current_child);
+				cells_and_parents[i].insert(parent);
+				current_child = parent;
 			}
 		}
 
-		// neighbors_to smaller than given cell
-		if (refinement_level < this->mapping.get_maximum_refinement_level()) {
-
-			const std::vector<uint64_t> children = this->get_all_children(cell);
-			#ifdef DEBUG
-			if (children.size() == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Got no children for cell " << cell
-					<< std::endl;
-				abort();
+		for (int
+			current_ref_lvl = 0;
+			current_ref_lvl < max_ref_lvl_of_overlapping;
+			current_ref_lvl++
+		) {
+			for (const uint64_t cell: cells_and_parents[current_ref_lvl]) {
+				this->refine_completely(cell);
 			}
-			#endif
-
-			const uint64_t length_in_indices = this->mapping.get_cell_length_in_indices(children[0]);
+			this->stop_refining();
+			this->clear_refined_unrefined_data();
+		}
 
-			for (const auto child: children) {
+		return true;
+	}
 
-				const Types<3>::indices_t indices = this->mapping.get_indices(child);
 
-				std::vector<Types<3>::indices_t> search_indices = this->indices_from_neighborhood(
-					indices,
-					length_in_indices,
-					neighborhood
-				);
+	/*!
+	Starts the procedure of moving cells between processes.
 
-				for (const auto& search_index: search_indices) {
+	Default constructs arriving cells.
+	Does not transfer any cell data, use continue_balance_load() for that,
+	or if cell data doesn't have to be transferred in several steps use
+	balance_load() instead of this function.
 
-					if (search_index[0] == error_index) {
-						continue;
-					}
+	After calling this the functions get_cells_to_send() and
+	get_cells_to_receive() can be used to query changes to the
+	current partition.
 
-					const uint64_t found
-						= this->mapping.get_cell_from_indices(search_index, refinement_level + 1);
+	The next function to be called after this one (from those that
+	must be called by all processes) must be either continue_balance_load()
+	or finish_balance_load(). Information related to the other functions
+	must not be queried after calling this, for example the remote neighbors
+	of local cells, local cells, etc.
 
-					if (found == this->get_child(found)) {
-						unique_neighbors[found] = {0, 0, 0, 0};
-					}
-				}
-			}
+	\see
+	balance_load()
+	continue_balance_load()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& initialize_balance_load(const bool use_zoltan)
+	{
+		if (this->balancing_load) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " initialize_balance_load(...) called the second time "
+				<< "before calling finish_balance_load() first"
+				<< std::endl;
+			abort();
 		}
 
-		// neighbors_to of the same size as given cell
-		const Types<3>::indices_t indices = this->mapping.get_indices(cell);
-		const uint64_t length_in_indices = this->mapping.get_cell_length_in_indices(cell);
+		this->balancing_load = true;
 
-		std::vector<Types<3>::indices_t> search_indices = this->indices_from_neighborhood(
-			indices,
-			length_in_indices,
-			neighborhood
-		);
+		#ifdef DEBUG
+		if (!this->verify_remote_neighbor_info()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info is not consistent"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
 
-		for (const auto& search_index: search_indices) {
+		if (!this->verify_user_data()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " User data not consistent"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+		#endif
 
-			if (search_index[0] == error_index) {
-				continue;
-			}
+		if (this->automatic_cell_weights) {
+			this->update_cell_costs();
+		}
 
-			const uint64_t found = this->mapping.get_cell_from_indices(search_index, refinement_level);
-			if (found == this->get_child(found)) {
-				unique_neighbors[found] = {0, 0, 0, 0};
-			}
+		this->make_new_partition(use_zoltan);
+		if (this->collect_load_balance_statistics) {
+			this->update_load_balance_statistics();
 		}
 
-		return_neighbors.reserve(unique_neighbors.size());
+		if (this->automatic_cell_weights) {
+			this->send_cell_costs();
+		}
 
-		for (const auto& neighbor: unique_neighbors) {
-			return_neighbors.push_back(neighbor);
+		// default construct user data of arriving cells
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
+			sender_item = this->cells_to_receive.begin();
+			sender_item != this->cells_to_receive.end();
+			sender_item++
+		) {
+			for (std::vector<std::pair<uint64_t, int>>::const_iterator
+				cell_item = sender_item->second.begin();
+				cell_item != sender_item->second.end();
+				cell_item++
+			) {
+				this->cell_data[cell_item->first];
+			}
 		}
 
-		return return_neighbors;
-	}
+		// clear data related to remote neighbor updates, adaptation, etc.
+		this->local_cells_on_process_boundary.clear();
+		this->remote_cells_on_process_boundary.clear();
+		this->user_local_cells_on_process_boundary.clear();
+		this->user_remote_cells_on_process_boundary.clear();
+		this->user_neigh_cells_to_send.clear();
+		this->user_neigh_cells_to_receive.clear();
+		this->remote_neighbors.clear();
+		this->cells_to_refine.clear();
+		this->refined_cell_data.clear();
+		this->cells_to_unrefine.clear();
+		this->unrefined_cell_data.clear();
+		this->cells_not_to_refine.clear();
+		this->cells_not_to_unrefine.clear();
+		for (auto& requests: this->concurrent_refine_requests) {
+			for (auto& cells: requests.cells) {
+				cells.clear();
+			}
+		}
+		this->cell_weights.clear();
+		this->additional_cell_weights.clear();
 
+		#ifdef DEBUG
+		// check that there are no duplicate adds / removes
+		// removed cells on all processes
+		std::vector<uint64_t> temp_removed_cells(
+			this->removed_cells.begin(),
+			this->removed_cells.end()
+		);
+		std::sort(temp_removed_cells.begin(), temp_removed_cells.end());
 
-	/*!
-	As find_neighbors_to(cell) but uses the given neighbors_of list.
+		std::vector<std::vector<uint64_t>> all_removed_cells;
+		All_Gather()(temp_removed_cells, all_removed_cells, this->comm);
 
-	Given list is assumed to have all neighbors_to of given cell that are
-	as large or smaller than given cell.
-	*/
-	std::vector<
-		std::pair<
-			uint64_t,
-			std::array<int, 4>
-		>
-	> find_neighbors_to(
-		const uint64_t cell,
-		const std::vector<uint64_t>& found_neighbors_of
-	) const {
-		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
+		// created cells on all processes
+		std::vector<uint64_t> temp_added_cells(
+			this->added_cells.begin(),
+			this->added_cells.end()
+		);
+		std::sort(temp_added_cells.begin(), temp_added_cells.end());
 
-		if (
-			cell == 0
-			or cell > this->mapping.get_last_cell()
-			or this->cell_process.count(cell) == 0
-			or cell != this->get_child(cell)
-		) {
-			return return_neighbors;
-		}
+		std::vector<std::vector<uint64_t>> all_added_cells;
+		All_Gather()(temp_added_cells, all_added_cells, this->comm);
 
-		// get neighbors_to of given cell, first from its neighbors_of
-		std::set<uint64_t> unique_neighbors_to;
+		std::unordered_set<uint64_t> all_adds, all_removes;
 
-		for (const auto neighbor_of: found_neighbors_of) {
-			// neighbors_to doesn't store cells that would be outside of the grid
-			if (neighbor_of == 0) {
-				continue;
-			}
+		for (const auto& item: all_removed_cells) {
+			for (const uint64_t removed_cell: item) {
 
-			if (this->is_neighbor(neighbor_of, cell)) {
-				unique_neighbors_to.insert(neighbor_of);
+				if (all_removes.count(removed_cell) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << removed_cell
+						<< " was already removed"
+						<< std::endl;
+					abort();
+				}
+				all_removes.insert(removed_cell);
 			}
 		}
 
-		const int refinement_level = this->mapping.get_refinement_level(cell);
-		#ifdef DEBUG
-		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Refinement level (" << refinement_level
-				<< ") of cell " << cell
-				<< " exceeds maximum refinement level of the grid (" << this->mapping.get_maximum_refinement_level() << ")"
-				<< std::endl;
-			abort();
-		}
-
-		if (refinement_level < 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Refinement level of cell " << cell
-				<< " is less than 0: " << refinement_level
-				<< std::endl;
-			abort();
-		}
-		#endif
-
-		// find cells larger than given cell for neighbors_to list
-		if (refinement_level > 0) {
+		for (const auto& item: all_added_cells) {
+			for (const uint64_t added_cell: item) {
 
-			const uint64_t parent = this->get_parent(cell);
-			#ifdef DEBUG
-			if (parent == cell) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Invalid parent for cell " << cell
-					<< std::endl;
-				abort();
+				if (all_adds.count(added_cell) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << added_cell
+						<< " was already removed"
+						<< std::endl;
+					abort();
+				}
+				all_adds.insert(added_cell);
 			}
-			#endif
-
-			const Types<3>::indices_t indices = this->mapping.get_indices(parent);
-			const uint64_t length_in_indices = this->mapping.get_cell_length_in_indices(parent);
+		}
 
-			const std::vector<Types<3>::indices_t> search_indices
-				= this->indices_from_neighborhood(
-					indices,
-					length_in_indices,
-					this->neighborhood_to
-				);
+		// check that cells were removed by their process
+		for (uint64_t cell_remover = 0; cell_remover < all_removed_cells.size(); cell_remover++) {
 
-			for (const auto& search_index: search_indices) {
+			for (const uint64_t removed_cell: all_removed_cells.at(cell_remover)) {
 
-				if (search_index[0] == error_index) {
+				if (this->distributed_ownership and this->cell_process.count(removed_cell) == 0) {
 					continue;
 				}
 
-				const uint64_t found
-					= this->mapping.get_cell_from_indices(search_index, refinement_level - 1);
-
-				// only add if found cell doesn't have children
-				if (found == this->get_child(found)) {
-					unique_neighbors_to.insert(found);
+				if (this->cell_process.at(removed_cell) != cell_remover) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << removed_cell
+						<< " doesn't belong to process " << cell_remover
+						<< std::endl;
+					abort();
 				}
 			}
 		}
-
-		return_neighbors.reserve(unique_neighbors_to.size());
-		for (const auto& n: unique_neighbors_to) {
-			return_neighbors.push_back({n, {0, 0, 0, 0}});
-		}
-
-		return return_neighbors;
+		#endif
+		return *this;
 	}
 
-
 	/*!
-	Returns unique cells within given rectangular box and refinement levels (both inclusive).
+	Transfers cell data between processes based on the new partition.
 
-	Cells within given volume are always returned in the following order:
-	Starting from the corner closest to the starting corner of the grid cells are returned
-	first in the positive x direction then y direction and finally z direction.
-	*/
-	// TODO: make private?
-	std::vector<uint64_t> find_cells(
-		const Types<3>::indices_t indices_min,
-		const Types<3>::indices_t indices_max,
-		const int minimum_refinement_level,
-		const int maximum_refinement_level
-	) const {
-		// size of cells in indices of given maximum_refinement_level
-		const uint64_t index_increase
-			= uint64_t(1) << (this->mapping.get_maximum_refinement_level() - maximum_refinement_level);
+	Must be called by all processes and not before initialize_balance_load(...)
+	has been called.
 
-		#ifdef DEBUG
-		if (minimum_refinement_level > maximum_refinement_level) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Invalid refinement levels given"
-				<< std::endl;
-			abort();
-		}
+	The next function to be called after this one (from those that
+	must be called by all processes) must be either this again or
+	finish_balance_load().
 
-		if (maximum_refinement_level > this->mapping.get_maximum_refinement_level()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Invalid maximum refinement level given"
-				<< std::endl;
-			abort();
-		}
-
-		// check that outer shell makes sense
-		if (indices_min[0] > indices_max[0]) {
+	\see
+	finish_balance_load()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& continue_balance_load()
+	{
+		if (!this->balancing_load) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " minimum x index > maximum x index"
+				<< " continue_balance_load() called without "
+				<< "calling initialize_balance_load(...) first."
 				<< std::endl;
 			abort();
 		}
 
-		if (indices_min[1] > indices_max[1]) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " minimum y index > maximum y index"
-				<< std::endl;
-			abort();
-		}
+		this->start_user_data_transfers(
+			this->cell_data,
+			this->cells_to_receive,
+			this->cells_to_send,
+			-2
+		);
 
-		if (indices_min[2] > indices_max[2]) {
+		this->wait_user_data_transfer_receives();
+
+		this->wait_user_data_transfer_sends();
+		return *this;
+	}
+
+	/*!
+	Finishes the procedure of moving cells between processes.
+
+	Must be called by all processes and not before initialize_balance_load(...)
+	has been called.
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& finish_balance_load()
+	{
+		if (!this->balancing_load) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " minimum z index > maximum z index"
+				<< " finish_balance_load() called without "
+				<< "calling initialize_balance_load(...) first."
 				<< std::endl;
 			abort();
 		}
-		#endif
-
-		std::vector<uint64_t> result;
-		std::unordered_set<uint64_t> uniques;
 
-		Types<3>::indices_t indices = {{0, 0, 0}};
-		for (indices[2] = indices_min[2]; indices[2] <= indices_max[2]; indices[2] += index_increase)
-		for (indices[1] = indices_min[1]; indices[1] <= indices_max[1]; indices[1] += index_increase)
-		for (indices[0] = indices_min[0]; indices[0] <= indices_max[0]; indices[0] += index_increase) {
+		this->cells_to_send.clear();
+		this->cells_to_receive.clear();
 
-			const uint64_t cell
-				= this->get_existing_cell(
-					indices,
-					minimum_refinement_level,
-					maximum_refinement_level
-				);
+		/*
+		Calculate where cells have migrated to update internal data structures
+		*/
 
-			#ifdef DEBUG
-			if (cell == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " No cell found between refinement levels [" << minimum_refinement_level
-					<< ", " << maximum_refinement_level
-					<< "] at indices " << indices[0]
-					<< " " << indices[1]
-					<< " " << indices[2]
-					<< std::endl;
+		// removed cells on all processes
+		std::vector<uint64_t> temp_removed_cells(
+			this->removed_cells.begin(),
+			this->removed_cells.end()
+		);
 
-				const uint64_t smallest
-					= this->get_existing_cell(indices, 0, this->mapping.get_maximum_refinement_level());
+		// created cells on all processes
+		std::vector<uint64_t> temp_added_cells(
+			this->added_cells.begin(),
+			this->added_cells.end()
+		);
 
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " smallest cell there is " << smallest
-					<< " with refinement level " << this->mapping.get_refinement_level(smallest)
-					<< std::endl;
-				abort();
-			}
+		std::vector<std::vector<uint64_t>> all_added_cells;
+		All_Gather()(temp_added_cells, all_added_cells, this->comm);
 
-			if (this->cell_process.count(cell) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << cell
-					<< " doesn't exist"
-					<< std::endl;
-				abort();
-			}
+		#ifdef DEBUG
+		std::vector<std::vector<uint64_t> > all_removed_cells;
+		All_Gather()(temp_removed_cells, all_removed_cells, this->comm);
 
-			if (cell > this->mapping.get_last_cell()) {
-				std::cerr << __FILE__ << ":" << __LINE__ << " Cell can't exist" << std::endl;
-				abort();
-			}
-			#endif
+		// check that there are no duplicate adds / removes
+		std::unordered_set<uint64_t> all_adds, all_removes;
 
-			/*
-			When searching for neighbors_to, cells may exist with larger refinement
-			level than given in find_neighbors_to and shouldn't be considered.
-			*/
-			if (cell != this->get_child(cell)) {
-				continue;
-			}
+		for (const auto& item: all_removed_cells) {
+			for (const uint64_t removed_cell: item) {
 
-			// don't add the same cell twice
-			if (uniques.count(cell) == 0) {
-				uniques.insert(cell);
-				result.push_back(cell);
+				if (all_removes.count(removed_cell) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << removed_cell
+						<< " was already removed"
+						<< std::endl;
+					abort();
+				}
+				all_removes.insert(removed_cell);
 			}
 		}
 
-		return result;
-	}
-
-
-	/*!
-	An asynchronous version of update_copies_of_remote_neighbors().
-
-	Starts remote neighbor data updates and returns immediately.
-	Use e.g. wait_remote_neighbors_copy_updates() to make sure cell
-	data has been transferred.
-
-	\see
-	wait_remote_neighbor_copy_updates()
-	start_remote_neighbor_copy_receives()
-	start_remote_neighbor_copy_sends()
-	update_copies_of_remote_neighbors()
-	*/
-	bool start_remote_neighbor_copy_updates(
-		const int neighborhood_id = default_neighborhood_id
-	) {
-		if (this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " start_remote_neighbor_data_update(...) called while balancing load"
-				<< std::endl;
-			abort();
-		}
-
-		bool ret_val = true;
-
-		if (!this->start_remote_neighbor_copy_receives(neighborhood_id)) {
-			ret_val = false;
-		}
+		for (const auto& item: all_added_cells) {
+			for (const uint64_t added_cell: item) {
 
-		if (!this->start_remote_neighbor_copy_sends(neighborhood_id)) {
-			ret_val = false;
+				if (all_adds.count(added_cell) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << added_cell
+						<< " was already removed"
+						<< std::endl;
+					abort();
+				}
+				all_adds.insert(added_cell);
+			}
 		}
 
-		return ret_val;
-	}
-
-	/*!
-	Starts receiving updates for local copies of remote neighbor cells.
+		// check that cells were removed by their process
+		for (uint64_t cell_remover = 0; cell_remover < all_removed_cells.size(); cell_remover++) {
 
-	A local copy of a remote neighbor is default constructed if it does
-	not exist already.
+			for (const uint64_t removed_cell: all_removed_cells.at(cell_remover)) {
 
-	\see
-	wait_remote_neighbor_copy_update_receives()
-	start_remote_neighbor_copy_sends()
-	start_remote_neighbor_copy_updates()
-	*/
-	bool start_remote_neighbor_copy_receives(
-		const int neighborhood_id = default_neighborhood_id
-	) {
-		bool ret_val = true;
+				if (this->distributed_ownership and this->cell_process.count(removed_cell) == 0) {
+					continue;
+				}
 
-		if (neighborhood_id == default_neighborhood_id) {
-			return this->start_user_data_receives(
-				this->remote_neighbors,
-				this->cells_to_receive,
-				neighborhood_id
-			);
+				if (this->cell_process.at(removed_cell) != cell_remover) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << removed_cell
+						<< " doesn't belong to process " << cell_remover
+						<< std::endl;
+					abort();
+				}
+			}
 		}
+		#endif
 
-		if (this->user_hood_of.count(neighborhood_id) == 0) {
+		// update cell to process mappings
+		for (uint64_t cell_creator = 0; cell_creator < all_added_cells.size(); cell_creator++) {
 
-			#ifdef DEBUG
-			// TODO: merge debugging code with original
-			if (this->user_hood_to.count(neighborhood_id) > 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should not have id " << neighborhood_id
-					<< std::endl;
-				abort();
+			for (const uint64_t created_cell: all_added_cells.at(cell_creator)) {
+				if (this->distributed_ownership) {
+					const auto item = this->cell_process.find(created_cell);
+					if (item != this->cell_process.end()) {
+						item->second = cell_creator;
+					}
+				} else {
+					this->cell_process.at(created_cell) = cell_creator;
+				}
 			}
+		}
 
-			if (this->user_neigh_of.count(neighborhood_id) > 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should not have id " << neighborhood_id
-					<< std::endl;
-				abort();
-			}
+		if (this->distributed_ownership) {
+			std::vector<uint64_t> added(this->added_cells.begin(), this->added_cells.end());
 
-			if (this->user_neigh_to.count(neighborhood_id) > 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should not have id " << neighborhood_id
-					<< std::endl;
-				abort();
+			// processes of ancestors don't change so get them from the old directory
+			std::vector<uint64_t> ancestors;
+			for (const uint64_t added_cell: added) {
+				uint64_t current = added_cell;
+				while (this->mapping.get_refinement_level(current) > 0) {
+					current = this->mapping.get_parent(current);
+					ancestors.push_back(current);
+				}
 			}
-			#endif
+			this->fetch_cell_process(ancestors);
+			ancestors.clear();
 
-			ret_val = false;
+			for (const uint64_t added_cell: added) {
+				this->cell_process[added_cell] = this->rank;
+			}
+			this->update_cell_directory();
+			this->fetch_cells_near(added);
 		}
 
 		#ifdef DEBUG
-		if (this->user_hood_to.count(neighborhood_id) == 0) {
+		if (!this->is_consistent()) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
+				<< " Grid is not consistent"
 				<< std::endl;
-			abort();
+			exit(EXIT_FAILURE);
 		}
 
-		if (this->user_neigh_of.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-
-		if (this->user_neigh_to.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-
-		if (this->user_neigh_cells_to_send.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-
-		if (this->user_neigh_cells_to_receive.count(neighborhood_id) == 0) {
+		if (!this->pin_requests_succeeded()) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
+				<< " Pin requests didn't succeed"
 				<< std::endl;
-			abort();
+			exit(EXIT_FAILURE);
 		}
 		#endif
 
-		if (!this->start_user_data_receives(
-			this->remote_neighbors,
-			this->user_neigh_cells_to_receive.at(neighborhood_id),
-			neighborhood_id
-		)) {
-			ret_val = false;
-		}
+		// create neighbor lists for cells without children that came to this process
+		for (const uint64_t added_cell: this->added_cells) {
 
-		return ret_val;
-	}
+			if (added_cell != this->get_child(added_cell)) {
+				continue;
+			}
 
-	/*!
-	Starts sending updates to remote copies of local neighboring cells.
+			// TODO: use this->update_neighbors(added_cell)
+			this->neighbors_of[added_cell]
+				= this->find_neighbors_of(added_cell, this->neighborhood_of, this->max_ref_lvl_diff);
+			this->neighbors_to[added_cell]
+				= this->find_neighbors_to(added_cell, this->neighborhood_to);
+			this->cells_with_changed_neighbors.insert(added_cell);
 
-	\see
-	wait_remote_neighbor_copy_update_sends()
-	start_remote_neighbor_copy_receives()
-	start_remote_neighbor_copy_updates()
-	*/
-	bool start_remote_neighbor_copy_sends(
-		const int neighborhood_id = default_neighborhood_id
-	) {
-		if (this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " start_remote_neighbor_data_update(...) called while balancing load"
-				<< std::endl;
-			abort();
+			// also update user neighbor lists
+			for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
+				item = this->user_hood_of.begin();
+				item != this->user_hood_of.end();
+				item++
+			) {
+				this->update_user_neighbors(added_cell, item->first);
+			}
 		}
 
-		bool ret_val = true;
+		// free user data and neighbor lists of cells removed from this process
+		for (const uint64_t removed_cell: this->removed_cells) {
+			this->cell_data.erase(removed_cell);
+			this->neighbors_of.erase(removed_cell);
+			this->neighbors_to.erase(removed_cell);
+			this->cells_with_changed_neighbors.insert(removed_cell);
 
-		if (neighborhood_id == default_neighborhood_id) {
-			return this->start_user_data_sends(this->cells_to_send, neighborhood_id);
+			// also user neighbor lists
+			for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
+				item = this->user_hood_of.begin();
+				item != this->user_hood_of.end();
+				item++
+			) {
+				this->user_neigh_of.at(item->first).erase(removed_cell);
+				this->user_neigh_to.at(item->first).erase(removed_cell);
+			}
 		}
 
-		if (this->user_hood_of.count(neighborhood_id) == 0) {
-
-			#ifdef DEBUG
-			if (this->user_hood_to.count(neighborhood_id) > 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should not have id " << neighborhood_id
-					<< std::endl;
-				abort();
-			}
+		this->update_remote_neighbor_info();
+		// also remote neighbor info of user neighborhoods
+		for (std::unordered_map<int, std::vector<Types<3>::neighborhood_item_t>>::const_iterator
+			item = this->user_hood_of.begin();
+			item != this->user_hood_of.end();
+			item++
+		) {
+			this->update_user_remote_neighbor_info(item->first);
+		}
 
-			if (this->user_neigh_of.count(neighborhood_id) > 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should not have id " << neighborhood_id
-					<< std::endl;
-				abort();
-			}
+		if (this->distributed_ownership) {
+			this->update_cell_directory();
+		}
 
-			if (this->user_neigh_to.count(neighborhood_id) > 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should not have id " << neighborhood_id
-					<< std::endl;
-				abort();
-			}
-			#endif
+		this->recalculate_neighbor_update_send_receive_lists();
 
-			ret_val = false;
+		this->allocate_copies_of_remote_neighbors();
+		for (const auto& item: this->user_hood_of) {
+			this->allocate_copies_of_remote_neighbors(item.first);
 		}
+		this->update_cell_pointers();
 
 		#ifdef DEBUG
-		if (this->user_hood_to.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-
-		if (this->user_neigh_of.count(neighborhood_id) == 0) {
+		if (!this->is_consistent()) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
+				<< " The grid is inconsistent"
 				<< std::endl;
-			abort();
+			exit(EXIT_FAILURE);
 		}
 
-		if (this->user_neigh_to.count(neighborhood_id) == 0) {
+		if (!this->verify_neighbors()) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
+				<< " Neighbor lists are incorrect"
 				<< std::endl;
-			abort();
+			exit(EXIT_FAILURE);
 		}
 
-		if (this->user_neigh_cells_to_send.count(neighborhood_id) == 0) {
+		if (!this->verify_remote_neighbor_info()) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
+				<< " Remote neighbor info is not consistent"
 				<< std::endl;
-			abort();
+			exit(EXIT_FAILURE);
 		}
 
-		if (this->user_neigh_cells_to_receive.count(neighborhood_id) == 0) {
+		if (!this->verify_user_data()) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should have id " << neighborhood_id
+				<< " User data not consistent"
 				<< std::endl;
-			abort();
+			exit(EXIT_FAILURE);
 		}
 		#endif
 
-		if (!this->start_user_data_sends(
-			this->user_neigh_cells_to_send.at(neighborhood_id),
-			neighborhood_id
-		)) {
-			ret_val = false;
-		}
-
-		return ret_val;
+		this->added_cells.clear();
+		this->removed_cells.clear();
+		this->balancing_load = false;
+		return *this;
 	}
 
 
 	/*!
-	Finishes what start_remote_neighbor_data_update() started.
+	Returns the parent of given existing cell.
 
-	\see
-	start_remote_neighbor_copy_updates()
+	Returns the given cell if it doesn't have a parent
+	or error_cell if given cell doesn't exist.
 	*/
-	bool wait_remote_neighbor_copy_updates(
-		const int neighborhood_id = default_neighborhood_id
-	) {
-		if (this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " wait_remote_neighbor_copy_updates(...) called while balancing load"
-				<< std::endl;
-			abort();
+	uint64_t get_parent(const uint64_t cell) const
+	{
+		if (this->cell_process.count(cell) == 0) {
+			return error_cell;
 		}
 
-		bool ret_val = true;
-
-		if (!this->wait_remote_neighbor_copy_update_receives(neighborhood_id)) {
-			ret_val = false;
-		}
-		if (!this->wait_remote_neighbor_copy_update_sends()) {
-			ret_val = false;
+		// given cell cannot have a parent
+		if (this->mapping.get_refinement_level(cell) == 0) {
+			return cell;
 		}
 
-		return ret_val;
+		const uint64_t parent = this->mapping.get_cell_from_indices(
+			this->mapping.get_indices(cell),
+			this->mapping.get_refinement_level(cell) - 1
+		);
+
+		if (this->cell_process.count(parent) > 0) {
+			return parent;
+		} else {
+			return cell;
+		}
 	}
 
 
 	/*!
-	Waits for sends started by start_remote_neighbor_copy_updates().
+	Returns the indices corresponding to the given neighborhood at given indices.
 
-	\see
-	start_remote_neighbor_copy_updates()
+	Neighborhood is returned in units of length_in_indices.
+	If grid is not periodic in some direction then indices which would fall outside
+	of the grid in that direction are returned as error_index.
 	*/
-	bool wait_remote_neighbor_copy_update_sends()
-	{
-		if (this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " wait_remote_neighbor_copy_update_sends() called while balancing load"
-				<< std::endl;
-			abort();
+	std::vector<Types<3>::indices_t> indices_from_neighborhood(
+		const Types<3>::indices_t indices,
+		const uint64_t length_in_indices,
+		const std::vector<Types<3>::neighborhood_item_t>& neighborhood
+	) const {
+		// TODO: make neighborhood a const reference
+		std::vector<Types<3>::indices_t> return_indices;
+		return_indices.reserve(neighborhood.size());
+
+		// grid length in indices
+		const uint64_t grid_length[3] = {
+			this->length.get()[0] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
+			this->length.get()[1] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
+			this->length.get()[2] * (uint64_t(1) << this->mapping.get_maximum_refinement_level())
+		};
+
+		#ifdef DEBUG
+		for (unsigned int dimension = 0; dimension < 3; dimension++) {
+			if (indices[dimension] >= grid_length[dimension]) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Given indices outside of the grid in dimension " << dimension
+					<< std::endl;
+				abort();
+			}
 		}
+		#endif
 
-		return this->wait_user_data_transfer_sends();
-	}
+		for (const auto& offsets: neighborhood) {
 
+			Types<3>::indices_t temp_indices = {{indices[0], indices[1], indices[2]}};
 
-	/*!
-	Waits for receives started by start_remote_neighbor_copy_updates().
+			for (unsigned int dimension = 0; dimension < 3; dimension++) {
+				if (offsets[dimension] < 0) {
 
-	\see
-	start_remote_neighbor_copy_updates()
-	*/
-	bool wait_remote_neighbor_copy_update_receives(
-		const int neighborhood_id = default_neighborhood_id
-	) {
-		if (this->balancing_load) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " wait_remote_neighbor_copy_update_receives(...) called while balancing load"
-				<< std::endl;
-			abort();
-		}
-
-		bool ret_val = true;
-
-		if (neighborhood_id == default_neighborhood_id) {
-			return this->wait_user_data_transfer_receives();
-		}
+					if (this->topology.is_periodic(dimension)) {
 
-		if (this->user_hood_of.count(neighborhood_id) == 0) {
-			ret_val = false;
-		}
+						// neighborhood might wrap around the grid several times
+						for (int i = 0; i > offsets[dimension]; i--) {
 
-		if (!this->wait_user_data_transfer_receives()) {
-			ret_val = false;
-		}
+							#ifdef DEBUG
+							if (temp_indices[dimension] < length_in_indices - 1
+							&& temp_indices[dimension] > 0) {
+								std::cerr << __FILE__ << ":" << __LINE__
+									<< " Cells aren't supposed to wrap around the grid."
+									<< std::endl;
+								abort();
+							}
+							#endif
 
-		return ret_val;
-	}
+							if (temp_indices[dimension] >= length_in_indices) {
+								temp_indices[dimension] -= length_in_indices;
+							} else {
+								temp_indices[dimension] = grid_length[dimension] - length_in_indices;
+							}
+						}
+					// use error_indices to signal that this neighborhood item is outside of the grid
+					} else {
+						if (indices[dimension] < abs(offsets[dimension]) * length_in_indices) {
+							temp_indices[0] = error_index;
+							temp_indices[1] = error_index;
+							temp_indices[2] = error_index;
+							break;
+						}
 
+						temp_indices[dimension] += offsets[dimension] * length_in_indices;
+					}
 
-	/*!
-	Returns number of cells that will be sent in a remote neighbor data update.
+				} else {
 
-	The total amount of cells to be sent is returned so if one cell's data
-	is sent to N processes it is counted N times.
+					if (this->topology.is_periodic(dimension)) {
+						for (int i = 0; i < offsets[dimension]; i++) {
 
-	Returns maximum uint64_t if given neighborhood id doesn't exist.
+							#ifdef DEBUG
+							if (temp_indices[dimension] > grid_length[dimension] - length_in_indices) {
+								std::cerr << __FILE__ << ":" << __LINE__
+									<< " Cells aren't supposed to wrap around the grid."
+									<< std::endl;
+								abort();
+							}
+							#endif
 
-	\see
-	update_copies_of_remote_neighbors()
-	add_neighborhood()
-	*/
-	uint64_t get_number_of_update_send_cells(
-		const int neighborhood_id = default_neighborhood_id
-	) const {
-		uint64_t ret_val = 0;
+							if (temp_indices[dimension] < grid_length[dimension] - length_in_indices) {
+								temp_indices[dimension] += length_in_indices;
+							} else {
+								temp_indices[dimension] = 0;
+							}
+						}
+					} else {
+						if (
+							indices[dimension] + offsets[dimension] * length_in_indices
+							>= grid_length[dimension]
+						) {
+							temp_indices[0] = error_index;
+							temp_indices[1] = error_index;
+							temp_indices[2] = error_index;
+							break;
+						}
 
-		if (neighborhood_id == default_neighborhood_id) {
-			for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
-				receiver = cells_to_send.begin();
-				receiver != cells_to_send.end();
-				receiver++
-			) {
-				ret_val += receiver->second.size();
+						temp_indices[dimension] += offsets[dimension] * length_in_indices;
+					}
+				}
 			}
-			return ret_val;
-		}
-
-		if (this->user_hood_to.count(neighborhood_id) == 0) {
-			return std::numeric_limits<uint64_t>::max();
-		}
-
-		#ifdef DEBUG
-		if (this->user_neigh_cells_to_send.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No neighborhood with id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-		#endif
 
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
-			receiver_item = this->user_neigh_cells_to_send.at(neighborhood_id).begin();
-			receiver_item != this->user_neigh_cells_to_send.at(neighborhood_id).end();
-			receiver_item++
-		) {
-			ret_val += receiver_item->second.size();
+			return_indices.push_back(temp_indices);
 		}
 
-		return ret_val;
+		return return_indices;
 	}
 
 
 	/*!
-	Returns the number of cells whose data this process has to receive during a neighbor data update.
-
-
-	Same as get_number_of_update_receive_cells() but for given neighborhood id.
+	Returns the existing neighbors (that don't have children) of given cell.
 
-	Returns maximum uint64_t if given neighborhood id doesn't exist.
+	Uses given neighborhood when searching for neighbors.
+	max_diff is the distance to search in refinement level from given cell inclusive.
+	Returns nothing if the following cases:
+		- given cell has children
+		- given doesn't exist
 
-	\see
-	get_number_of_update_send_cells()
+	Cells smaller than given one at any offset are returned in the order in which
+	neighbors' index increases first in x, then in y, ...
+	In other words the first small cell within an neighborhood offset is
+	closest to the origin of the grid, the second one is in direction +1
+	from the first, 3rd is in dir +2 from 1st, 4th is in +1 from 3rd, +2 from 2nd,
+	8th is +3 from 4th, +2 from 6th, +1 from 7th, assuming max_ref_lvl_diff == 1
 	*/
-	uint64_t get_number_of_update_receive_cells(
-		const int neighborhood_id = default_neighborhood_id
+	// TODO: make private?
+	std::vector<
+		std::pair<
+			uint64_t,
+			std::array<int, 4> // x, y, z offsets and denominator
+		>
+	> find_neighbors_of(
+		const uint64_t cell,
+		const std::vector<Types<3>::neighborhood_item_t>& neighborhood,
+		const int max_diff,
+		const bool has_children = false
 	) const {
-		uint64_t ret_val = 0;
-
-		if (neighborhood_id == default_neighborhood_id) {
-			for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
-				sender = this->cells_to_receive.begin();
-				sender != this->cells_to_receive.end();
-				sender++
-			) {
-				ret_val += sender->second.size();
-			}
-			return ret_val;
-		}
+		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
 
-		if (this->user_hood_of.count(neighborhood_id) == 0) {
-			return std::numeric_limits<uint64_t>::max();
-		}
+		const int refinement_level
+			= this->mapping.get_refinement_level(cell);
 
 		#ifdef DEBUG
-		if (this->user_neigh_cells_to_receive.count(neighborhood_id) == 0) {
+		if (max_diff < 0) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No neighborhood with id " << neighborhood_id
+				<< " max_diff must not be negative"
 				<< std::endl;
 			abort();
 		}
-		#endif
 
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
-			sender_item = this->user_neigh_cells_to_receive.at(neighborhood_id).begin();
-			sender_item != this->user_neigh_cells_to_receive.at(neighborhood_id).end();
-			sender_item++
-		) {
-			ret_val += sender_item->second.size();
+		if (cell == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Invalid cell given: " << cell
+				<< std::endl;
+			abort();
 		}
 
-		return ret_val;
-	}
+		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Refinement level of given cell (" << cell
+				<< ") is too large: " << refinement_level
+				<< std::endl;
+			abort();
+		}
 
+		if (refinement_level < 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Invalid refinement level for cell " << cell
+				<< ": " << refinement_level
+				<< std::endl;
+			abort();
+		}
+		#endif
 
-	/*!
-	Removes Cell_Data of refined and unrefined cells from this process.
+		if (this->cell_process.count(cell) == 0) {
+			return return_neighbors;
+		}
 
-	\see
-	refine_completely()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& clear_refined_unrefined_data()
-	{
-		this->refined_cell_data.clear();
-		this->unrefined_cell_data.clear();
-		return *this;
-	}
+		if (!has_children && cell != this->get_child(cell)) {
+			return return_neighbors;
+		}
 
+		const uint64_t cell_length
+			= this->mapping.get_cell_length_in_indices(cell);
 
-	/*!
-	Sets the given option of non-hierarchial partitioning to given value.
+		const std::vector<Types<3>::indices_t> indices_of
+			= this->indices_from_neighborhood(
+				this->mapping.get_indices(cell),
+				cell_length,
+				neighborhood
+			);
 
-	Does nothing if option name is one of:
-		- RETURN_LISTS
-		- EDGE_WEIGHT_DIM
-		- NUM_GID_ENTRIES
-		- OBJ_WEIGHT_DIM
+		for (size_t index_of_i = 0; index_of_i < indices_of.size(); index_of_i++) {
+			const auto& index_of = indices_of[index_of_i];
 
-	Call this with name = LB_METHOD and value = HIER to use hierarchial
-	partitioning.
+			if (index_of[0] == error_index) {
+				return_neighbors.push_back({0, {0, 0, 0, 0}});
+				continue;
+			}
 
-	\see
-	get_partitioning_option_value()
-	add_partitioning_level()
-	*/
-	Dccrg<
-		Cell_Data,
+			const uint64_t neighbor = this->get_existing_cell(
+				index_of,
+				[&](){
+					if (refinement_level < max_diff) {
+						return 0;
+					} else {
+						return refinement_level - max_diff;
+					}
+				}(),
+				[&](){
+					if (refinement_level <= this->mapping.get_maximum_refinement_level() - max_diff) {
+						return refinement_level + max_diff;
+					} else {
+						return this->mapping.get_maximum_refinement_level();
+					}
+				}()
+			);
+
+			#ifdef DEBUG
+			if (neighbor == error_cell) {
+				const Types<3>::indices_t indices = this->mapping.get_indices(cell);
+				const uint64_t smallest
+					= this->get_existing_cell(index_of, 0, this->mapping.get_maximum_refinement_level());
+
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Neighbor not found for cell " << cell
+					<< " (at indices " << indices[0]
+					<< "," << indices[1]
+					<< "," << indices[2]
+					<< "; ref. lvl. " << refinement_level
+					<< ", child of " << this->get_parent(cell)
+					<< ") within refinement levels [" << refinement_level - max_diff
+					<< ", " << refinement_level + max_diff
+					<< "], smallest cell found at indices " << index_of[0]
+					<< "," << index_of[1]
+					<< "," << index_of[2]
+					<< " was " << smallest
+					<< " with refinement level " << this->mapping.get_refinement_level(smallest)
+					<< std::endl;
+				abort();
+			}
+
+			if (this->cell_process.count(neighbor) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Neighbor " << neighbor
+					<< " doesn't exist"
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			const int neighbor_ref_lvl
+				= this->mapping.get_refinement_level(neighbor);
+
+			#ifdef DEBUG
+			if (neighbor_ref_lvl < 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Invalid refinement level for neighbor " << neighbor
+					<< " of cell " << cell
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			if (neighbor_ref_lvl <= refinement_level) {
+				return_neighbors.push_back({
+					neighbor,
+					{
+						neighborhood[index_of_i][0],
+						neighborhood[index_of_i][1],
+						neighborhood[index_of_i][2],
+						[&](){
+							if (neighbor_ref_lvl == refinement_level) {
+								return 1;
+							} else {
+								return -2; // TODO: max ref lvl diff > 1
+							}
+						}()
+					}
+				});
+			// add all cells at current search indices within size of given cell
+			} else {
+
+				const Types<3>::indices_t index_max = {{
+					index_of[0] + cell_length - 1,
+					index_of[1] + cell_length - 1,
+					index_of[2] + cell_length - 1
+				}};
+
+				const std::vector<uint64_t> current_neighbors = this->find_cells(
+					index_of,
+					index_max,
+					std::max(0, refinement_level - max_diff),
+					std::min(this->mapping.get_maximum_refinement_level(), refinement_level + max_diff)
+				);
+
+				#ifdef DEBUG
+				if (current_neighbors.size() == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " No neighbors for cell " << cell
+						<< " starting at indices " << index_of[0]
+						<< ", " << index_of[1]
+						<< ", " << index_of[2]
+						<< " between refinement levels " << refinement_level - max_diff
+						<< ", " << refinement_level + max_diff
+						<< std::endl;
+					abort();
+				}
+
+				if (current_neighbors.size() < 8) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Too few neighbors for cell " << cell
+						<< " of size " << cell_length
+						<< " with max_diff " << max_diff
+						<< std::endl;
+
+					std::cerr << "Found: ";
+					for (const uint64_t found: current_neighbors) {
+						std::cerr << found << " ";
+					}
+
+					std::cerr << "\nShould be: ";
+					const std::vector<uint64_t> real_neighbors = this->find_cells(
+						index_of,
+						index_max,
+						0,
+						this->mapping.get_maximum_refinement_level()
+					);
+					for (const uint64_t real: real_neighbors) {
+						std::cerr << real << " ";
+					}
+					std::cerr << std::endl;
+
+					abort();
+				}
+
+				for (const uint64_t current_neighbor: current_neighbors) {
+					if (this->cell_process.count(current_neighbor) == 0) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " Neighbor " << current_neighbor
+							<< " doesn't exist between refinement levels "
+							<< refinement_level - max_diff
+							<< ", " << refinement_level + max_diff
+							<< std::endl;
+						abort();
+					}
+				}
+				#endif
+
+				if (has_children) {
+					// offsets shouldn't be needed anywhere
+					for (const auto& current_neighbor: current_neighbors) {
+						return_neighbors.push_back({
+							current_neighbor, {0, 0, 0, 0}
+						});
+					}
+
+					continue;
+				}
+
+				if (current_neighbors.size() != 8) {
+					std::cerr << __FILE__ "(" << __LINE__ << ") "
+						<< "Unexpected number of neighbors: "
+						<< current_neighbors.size() << std::endl;
+					abort();
+				}
+
+				const auto
+					offset_x = 2 * neighborhood[index_of_i][0],
+					offset_y = 2 * neighborhood[index_of_i][1],
+					offset_z = 2 * neighborhood[index_of_i][2];
+				size_t neighbor_i = 0;
+				for (int off_mod_z: {-1, 0}) {
+					if (offset_z < 0) {
+						off_mod_z++;
+					} else if (offset_z == 0) {
+						off_mod_z = 0;
+					}
+					for (int off_mod_y: {-1, 0}) {
+						if (offset_y < 0) {
+							off_mod_y++;
+						} else if (offset_y == 0) {
+							off_mod_y = 0;
+						}
+						for (int off_mod_x: {-1, 0}) {
+							if (offset_x < 0) {
+								off_mod_x++;
+							} else if (offset_x == 0) {
+								off_mod_x = 0;
+							}
+							#ifdef DEBUG
+							if (
+								offset_x + off_mod_x == 0
+								and offset_y + off_mod_y == 0
+								and offset_z + off_mod_z == 0
+							) {
+								std::cerr << __FILE__ "(" << __LINE__ << ") "
+									<< "Unexpected neighbor offset for neighborhood indices "
+									<< neighborhood[index_of_i][0] << ", "
+									<< neighborhood[index_of_i][1] << ", "
+									<< neighborhood[index_of_i][2] << ": "
+									<< offset_x << ", " << off_mod_x << "; "
+									<< offset_y << ", " << off_mod_y << "; "
+									<< offset_z << ", " << off_mod_z << std::endl;
+								abort();
+							}
+							#endif
+							return_neighbors.push_back({
+								current_neighbors[neighbor_i++], {
+									offset_x + off_mod_x,
+									offset_y + off_mod_y,
+									offset_z + off_mod_z,
+									2
+								}
+							});
+						}
+					}
+				}
+			}
+		}
+
+		return return_neighbors;
+	}
+
+
+
+	/*!
+	Returns cells (which don't have children) that consider given cell as a neighbor.
+
+	Returns nothing if the following cases:
+		- given cell has children
+		- given cell doesn't exist on any process
+	Returned cells are not in any particular order.
+	Assumes a maximum refinement level difference of one between neighbors
+	(both cases: neighbors_of, neighbors_to).
+
+	TODO: currently returned offsets and denominator are all 0.
+	*/
+	std::vector<
+		std::pair<
+			uint64_t,
+			std::array<int, 4>
+		>
+	> find_neighbors_to(
+		const uint64_t cell,
+		const std::vector<Types<3>::neighborhood_item_t>& neighborhood
+	) const {
+		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
+
+		if (
+			cell == error_cell
+			or cell > this->mapping.get_last_cell()
+			or this->cell_process.count(cell) == 0
+			or cell != this->get_child(cell)
+		) {
+			return return_neighbors;
+		}
+
+		const int refinement_level = this->mapping.get_refinement_level(cell);
+
+		#ifdef DEBUG
+		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Refinement level (" << refinement_level
+				<< ") of cell " << cell
+				<< " exceeds maximum refinement level of the grid ("
+				<< this->mapping.get_maximum_refinement_level() << ")"
+				<< std::endl;
+			abort();
+		}
+
+		if (refinement_level < 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Refinement level of cell " << cell
+				<< " is less than 0: " << refinement_level
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		/*
+		FIXME: neighbors should be unique only in within
+		each offset in user neighborhood?
+		Would allow users to have the same offset
+		multiple times in their neighborhoods.
+		*/
+		std::unordered_map<uint64_t, std::array<int, 4>> unique_neighbors;
+
+		// neighbors_to larger than given cell
+		if (refinement_level > 0) {
+			const auto parent = this->get_parent(cell);
+			const auto indices = this->mapping.get_indices(parent);
+			const auto length_in_indices = this->mapping.get_cell_length_in_indices(parent);
+
+			const auto search_indices = this->indices_from_neighborhood(
+				indices,
+				length_in_indices,
+				neighborhood
+			);
+
+			for (size_t i = 0; i < search_indices.size(); i++) {
+				const auto& search_index = search_indices[i];
+
+				if (search_index[0] == error_index) {
+					continue;
+				}
+
+				const uint64_t found
+					= this->mapping.get_cell_from_indices(search_index, refinement_level - 1);
+
+				// only add if found cell doesn't have children
+				if (found == this->get_child(found)) {
+					unique_neighbors[found] = {0, 0, 0, 0};
+				}
+			}
+		}
+
+		// neighbors_to smaller than given cell
+		if (refinement_level < this->mapping.get_maximum_refinement_level()) {
+
+			const std::vector<uint64_t> children = this->get_all_children(cell);
+			#ifdef DEBUG
+			if (children.size() == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Got no children for cell " << cell
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			const uint64_t length_in_indices = this->mapping.get_cell_length_in_indices(children[0]);
+
+			for (const auto child: children) {
+
+				const Types<3>::indices_t indices = this->mapping.get_indices(child);
+
+				std::vector<Types<3>::indices_t> search_indices = this->indices_from_neighborhood(
+					indices,
+					length_in_indices,
+					neighborhood
+				);
+
+				for (const auto& search_index: search_indices) {
+
+					if (search_index[0] == error_index) {
+						continue;
+					}
+
+					const uint64_t found
+						= this->mapping.get_cell_from_indices(search_index, refinement_level + 1);
+
+					if (found == this->get_child(found)) {
+						unique_neighbors[found] = {0, 0, 0, 0};
+					}
+				}
+			}
+		}
+
+		// neighbors_to of the same size as given cell
+		const Types<3>::indices_t indices = this->mapping.get_indices(cell);
+		const uint64_t length_in_indices = this->mapping.get_cell_length_in_indices(cell);
+
+		std::vector<Types<3>::indices_t> search_indices = this->indices_from_neighborhood(
+			indices,
+			length_in_indices,
+			neighborhood
+		);
+
+		for (const auto& search_index: search_indices) {
+
+			if (search_index[0] == error_index) {
+				continue;
+			}
+
+			const uint64_t found = this->mapping.get_cell_from_indices(search_index, refinement_level);
+			if (found == this->get_child(found)) {
+				unique_neighbors[found] = {0, 0, 0, 0};
+			}
+		}
+
+		return_neighbors.reserve(unique_neighbors.size());
+
+		for (const auto& neighbor: unique_neighbors) {
+			return_neighbors.push_back(neighbor);
+		}
+
+		return return_neighbors;
+	}
+
+
+	/*!
+	As find_neighbors_to(cell) but uses the given neighbors_of list.
+
+	Given list is assumed to have all neighbors_to of given cell that are
+	as large or smaller than given cell.
+	*/
+	std::vector<
+		std::pair<
+			uint64_t,
+			std::array<int, 4>
+		>
+	> find_neighbors_to(
+		const uint64_t cell,
+		const std::vector<uint64_t>& found_neighbors_of
+	) const {
+		std::vector<std::pair<uint64_t, std::array<int, 4>>> return_neighbors;
+
+		if (
+			cell == 0
+			or cell > this->mapping.get_last_cell()
+			or this->cell_process.count(cell) == 0
+			or cell != this->get_child(cell)
+		) {
+			return return_neighbors;
+		}
+
+		// get neighbors_to of given cell, first from its neighbors_of
+		std::set<uint64_t> unique_neighbors_to;
+
+		for (const auto neighbor_of: found_neighbors_of) {
+			// neighbors_to doesn't store cells that would be outside of the grid
+			if (neighbor_of == 0) {
+				continue;
+			}
+
+			if (this->is_neighbor(neighbor_of, cell)) {
+				unique_neighbors_to.insert(neighbor_of);
+			}
+		}
+
+		const int refinement_level = this->mapping.get_refinement_level(cell);
+		#ifdef DEBUG
+		if (refinement_level > this->mapping.get_maximum_refinement_level()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Refinement level (" << refinement_level
+				<< ") of cell " << cell
+				<< " exceeds maximum refinement level of the grid (" << this->mapping.get_maximum_refinement_level() << ")"
+				<< std::endl;
+			abort();
+		}
+
+		if (refinement_level < 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Refinement level of cell " << cell
+				<< " is less than 0: " << refinement_level
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		// find cells larger than given cell for neighbors_to list
+		if (refinement_level > 0) {
+
+			const uint64_t parent = this->get_parent(cell);
+			#ifdef DEBUG
+			if (parent == cell) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Invalid parent for cell " << cell
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			const Types<3>::indices_t indices = this->mapping.get_indices(parent);
+			const uint64_t length_in_indices = this->mapping.get_cell_length_in_indices(parent);
+
+			const std::vector<Types<3>::indices_t> search_indices
+				= this->indices_from_neighborhood(
+					indices,
+					length_in_indices,
+					this->neighborhood_to
+				);
+
+			for (const auto& search_index: search_indices) {
+
+				if (search_index[0] == error_index) {
+					continue;
+				}
+
+				const uint64_t found
+					= this->mapping.get_cell_from_indices(search_index, refinement_level - 1);
+
+				// only add if found cell doesn't have children
+				if (found == this->get_child(found)) {
+					unique_neighbors_to.insert(found);
+				}
+			}
+		}
+
+		return_neighbors.reserve(unique_neighbors_to.size());
+		for (const auto& n: unique_neighbors_to) {
+			return_neighbors.push_back({n, {0, 0, 0, 0}});
+		}
+
+		return return_neighbors;
+	}
+
+
+	/*!
+	Returns unique cells within given rectangular box and refinement levels (both inclusive).
+
+	Cells within given volume are always returned in the following order:
+	Starting from the corner closest to the starting corner of the grid cells are returned
+	first in the positive x direction then y direction and finally z direction.
+	*/
+	// TODO: make private?
+	std::vector<uint64_t> find_cells(
+		const Types<3>::indices_t indices_min,
+		const Types<3>::indices_t indices_max,
+		const int minimum_refinement_level,
+		const int maximum_refinement_level
+	) const {
+		// size of cells in indices of given maximum_refinement_level
+		const uint64_t index_increase
+			= uint64_t(1) << (this->mapping.get_maximum_refinement_level() - maximum_refinement_level);
+
+		#ifdef DEBUG
+		if (minimum_refinement_level > maximum_refinement_level) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Invalid refinement levels given"
+				<< std::endl;
+			abort();
+		}
+
+		if (maximum_refinement_level > this->mapping.get_maximum_refinement_level()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Invalid maximum refinement level given"
+				<< std::endl;
+			abort();
+		}
+
+		// check that outer shell makes sense
+		if (indices_min[0] > indices_max[0]) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " minimum x index > maximum x index"
+				<< std::endl;
+			abort();
+		}
+
+		if (indices_min[1] > indices_max[1]) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " minimum y index > maximum y index"
+				<< std::endl;
+			abort();
+		}
+
+		if (indices_min[2] > indices_max[2]) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " minimum z index > maximum z index"
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		std::vector<uint64_t> result;
+		std::unordered_set<uint64_t> uniques;
+
+		Types<3>::indices_t indices = {{0, 0, 0}};
+		for (indices[2] = indices_min[2]; indices[2] <= indices_max[2]; indices[2] += index_increase)
+		for (indices[1] = indices_min[1]; indices[1] <= indices_max[1]; indices[1] += index_increase)
+		for (indices[0] = indices_min[0]; indices[0] <= indices_max[0]; indices[0] += index_increase) {
+
+			const uint64_t cell
+				= this->get_existing_cell(
+					indices,
+					minimum_refinement_level,
+					maximum_refinement_level
+				);
+
+			#ifdef DEBUG
+			if (cell == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " No cell found between refinement levels [" << minimum_refinement_level
+					<< ", " << maximum_refinement_level
+					<< "] at indices " << indices[0]
+					<< " " << indices[1]
+					<< " " << indices[2]
+					<< std::endl;
+
+				const uint64_t smallest
+					= this->get_existing_cell(indices, 0, this->mapping.get_maximum_refinement_level());
+
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " smallest cell there is " << smallest
+					<< " with refinement level " << this->mapping.get_refinement_level(smallest)
+					<< std::endl;
+				abort();
+			}
+
+			if (this->cell_process.count(cell) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << cell
+					<< " doesn't exist"
+					<< std::endl;
+				abort();
+			}
+
+			if (cell > this->mapping.get_last_cell()) {
+				std::cerr << __FILE__ << ":" << __LINE__ << " Cell can't exist" << std::endl;
+				abort();
+			}
+			#endif
+
+			/*
+			When searching for neighbors_to, cells may exist with larger refinement
+			level than given in find_neighbors_to and shouldn't be considered.
+			*/
+			if (cell != this->get_child(cell)) {
+				continue;
+			}
+
+			// don't add the same cell twice
+			if (uniques.count(cell) == 0) {
+				uniques.insert(cell);
+				result.push_back(cell);
+			}
+		}
+
+		return result;
+	}
+
+
+	/*!
+	An asynchronous version of update_copies_of_remote_neighbors().
+
+	Starts remote neighbor data updates and returns immediately.
+	Use e.g. wait_remote_neighbors_copy_updates() to make sure cell
+	data has been transferred.
+
+	\see
+	wait_remote_neighbor_copy_updates()
+	start_remote_neighbor_copy_receives()
+	start_remote_neighbor_copy_sends()
+	update_copies_of_remote_neighbors()
+	*/
+	bool start_remote_neighbor_copy_updates(
+		const int neighborhood_id = default_neighborhood_id
+	) {
+		if (this->balancing_load) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " start_remote_neighbor_data_update(...) called while balancing load"
+				<< std::endl;
+			abort();
+		}
+
+		bool ret_val = true;
+
+		if (!this->start_remote_neighbor_copy_receives(neighborhood_id)) {
+			ret_val = false;
+		}
+
+		if (!this->start_remote_neighbor_copy_sends(neighborhood_id)) {
+			ret_val = false;
+		}
+
+		return ret_val;
+	}
+
+	/*!
+	Starts receiving updates for local copies of remote neighbor cells.
+
+	A local copy of a remote neighbor is default constructed if it does
+	not exist already.
+
+	\see
+	wait_remote_neighbor_copy_update_receives()
+	start_remote_neighbor_copy_sends()
+	start_remote_neighbor_copy_updates()
+	*/
+	bool start_remote_neighbor_copy_receives(
+		const int neighborhood_id = default_neighborhood_id
+	) {
+		bool ret_val = true;
+
+		// started with sends
+		if (this->neighbor_collective_hoods.count(neighborhood_id) > 0) {
+			return true;
+		}
+
+		if (this->persistent_remote_neighbor_updates) {
+			if (
+				neighborhood_id != default_neighborhood_id
+				and this->user_hood_of.count(neighborhood_id) == 0
+			) {
+				return false;
+			}
+			return this->start_persistent_receives(neighborhood_id);
+		}
+
+		if (this->packed_remote_neighbor_updates) {
+			if (
+				neighborhood_id != default_neighborhood_id
+				and this->user_hood_of.count(neighborhood_id) == 0
+			) {
+				return false;
+			}
+			return this->start_packed_receives(neighborhood_id);
+		}
+
+		if (neighborhood_id == default_neighborhood_id) {
+			return this->start_user_data_receives(
+				this->remote_neighbors,
+				this->cells_to_receive,
+				neighborhood_id
+			);
+		}
+
+		if (this->user_hood_of.count(neighborhood_id) == 0) {
+
+			#ifdef DEBUG
+			// TODO: merge debugging code with original
+			if (this->user_hood_to.count(neighborhood_id) > 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should not have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+
+			if (this->user_neigh_of.count(neighborhood_id) > 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should not have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+
+			if (this->user_neigh_to.count(neighborhood_id) > 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should not have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			ret_val = false;
+		}
+
+		#ifdef DEBUG
+		if (this->user_hood_to.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_of.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_to.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_cells_to_send.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_cells_to_receive.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		if (!this->start_user_data_receives(
+			this->remote_neighbors,
+			this->user_neigh_cells_to_receive.at(neighborhood_id),
+			neighborhood_id
+		)) {
+			ret_val = false;
+		}
+
+		return ret_val;
+	}
+
+	/*!
+	Starts sending updates to remote copies of local neighboring cells.
+
+	\see
+	wait_remote_neighbor_copy_update_sends()
+	start_remote_neighbor_copy_receives()
+	start_remote_neighbor_copy_updates()
+	*/
+	bool start_remote_neighbor_copy_sends(
+		const int neighborhood_id = default_neighborhood_id
+	) {
+		if (this->balancing_load) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " start_remote_neighbor_data_update(...) called while balancing load"
+				<< std::endl;
+			abort();
+		}
+
+		bool ret_val = true;
+
+		if (this->neighbor_collective_hoods.count(neighborhood_id) > 0) {
+			return this->start_neighbor_collective_update(neighborhood_id);
+		}
+
+		if (this->persistent_remote_neighbor_updates) {
+			if (
+				neighborhood_id != default_neighborhood_id
+				and this->user_hood_to.count(neighborhood_id) == 0
+			) {
+				return false;
+			}
+			return this->start_persistent_sends(neighborhood_id);
+		}
+
+		if (this->packed_remote_neighbor_updates) {
+			if (
+				neighborhood_id != default_neighborhood_id
+				and this->user_hood_to.count(neighborhood_id) == 0
+			) {
+				return false;
+			}
+			return this->start_packed_sends(neighborhood_id);
+		}
+
+		if (neighborhood_id == default_neighborhood_id) {
+			return this->start_user_data_sends(this->cells_to_send, neighborhood_id);
+		}
+
+		if (this->user_hood_of.count(neighborhood_id) == 0) {
+
+			#ifdef DEBUG
+			if (this->user_hood_to.count(neighborhood_id) > 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should not have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+
+			if (this->user_neigh_of.count(neighborhood_id) > 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should not have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+
+			if (this->user_neigh_to.count(neighborhood_id) > 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should not have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			ret_val = false;
+		}
+
+		#ifdef DEBUG
+		if (this->user_hood_to.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_of.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_to.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_cells_to_send.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_cells_to_receive.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		if (!this->start_user_data_sends(
+			this->user_neigh_cells_to_send.at(neighborhood_id),
+			neighborhood_id
+		)) {
+			ret_val = false;
+		}
+
+		return ret_val;
+	}
+
+
+	/*!
+	Finishes what start_remote_neighbor_data_update() started.
+
+	\see
+	start_remote_neighbor_copy_updates()
+	*/
+	bool wait_remote_neighbor_copy_updates(
+		const int neighborhood_id = default_neighborhood_id
+	) {
+		if (this->balancing_load) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " wait_remote_neighbor_copy_updates(...) called while balancing load"
+				<< std::endl;
+			abort();
+		}
+
+		bool ret_val = true;
+
+		if (!this->wait_remote_neighbor_copy_update_receives(neighborhood_id)) {
+			ret_val = false;
+		}
+		if (!this->wait_remote_neighbor_copy_update_sends()) {
+			ret_val = false;
+		}
+
+		return ret_val;
+	}
+
+
+	/*!
+	Waits for sends started by start_remote_neighbor_copy_updates().
+
+	\see
+	start_remote_neighbor_copy_updates()
+	*/
+	bool wait_remote_neighbor_copy_update_sends()
+	{
+		if (this->balancing_load) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " wait_remote_neighbor_copy_update_sends() called while balancing load"
+				<< std::endl;
+			abort();
+		}
+
+		bool ret_val = true;
+		if (!this->wait_neighbor_collective_updates()) {
+			ret_val = false;
+		}
+		if (!this->wait_user_data_transfer_sends()) {
+			ret_val = false;
+		}
+		return ret_val;
+	}
+
+
+	/*!
+	Waits for receives started by start_remote_neighbor_copy_updates().
+
+	\see
+	start_remote_neighbor_copy_updates()
+	*/
+	bool wait_remote_neighbor_copy_update_receives(
+		const int neighborhood_id = default_neighborhood_id
+	) {
+		if (this->balancing_load) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " wait_remote_neighbor_copy_update_receives(...) called while balancing load"
+				<< std::endl;
+			abort();
+		}
+
+		bool ret_val = true;
+
+		if (
+			neighborhood_id != default_neighborhood_id
+			and this->user_hood_of.count(neighborhood_id) == 0
+		) {
+			ret_val = false;
+		}
+
+		if (!this->wait_neighbor_collective_updates()) {
+			ret_val = false;
+		}
+
+		if (!this->wait_user_data_transfer_receives()) {
+			ret_val = false;
+		}
+
+		this->unpack_remote_neighbor_data();
+
+		return ret_val;
+	}
+
+
+	/*!
+	Returns number of cells that will be sent in a remote neighbor data update.
+
+	The total amount of cells to be sent is returned so if one cell's data
+	is sent to N processes it is counted N times.
+
+	Returns maximum uint64_t if given neighborhood id doesn't exist.
+
+	\see
+	update_copies_of_remote_neighbors()
+	add_neighborhood()
+	*/
+	uint64_t get_number_of_update_send_cells(
+		const int neighborhood_id = default_neighborhood_id
+	) const {
+		uint64_t ret_val = 0;
+
+		if (neighborhood_id == default_neighborhood_id) {
+			for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
+				receiver = cells_to_send.begin();
+				receiver != cells_to_send.end();
+				receiver++
+			) {
+				ret_val += receiver->second.size();
+			}
+			return ret_val;
+		}
+
+		if (this->user_hood_to.count(neighborhood_id) == 0) {
+			return std::numeric_limits<uint64_t>::max();
+		}
+
+		#ifdef DEBUG
+		if (this->user_neigh_cells_to_send.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No neighborhood with id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
+			receiver_item = this->user_neigh_cells_to_send.at(neighborhood_id).begin();
+			receiver_item != this->user_neigh_cells_to_send.at(neighborhood_id).end();
+			receiver_item++
+		) {
+			ret_val += receiver_item->second.size();
+		}
+
+		return ret_val;
+	}
+
+
+	/*!
+	Returns the number of cells whose data this process has to receive during a neighbor data update.
+
+
+	Same as get_number_of_update_receive_cells() but for given neighborhood id.
+
+	Returns maximum uint64_t if given neighborhood id doesn't exist.
+
+	\see
+	get_number_of_update_send_cells()
+	*/
+	uint64_t get_number_of_update_receive_cells(
+		const int neighborhood_id = default_neighborhood_id
+	) const {
+		uint64_t ret_val = 0;
+
+		if (neighborhood_id == default_neighborhood_id) {
+			for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
+				sender = this->cells_to_receive.begin();
+				sender != this->cells_to_receive.end();
+				sender++
+			) {
+				ret_val += sender->second.size();
+			}
+			return ret_val;
+		}
+
+		if (this->user_hood_of.count(neighborhood_id) == 0) {
+			return std::numeric_limits<uint64_t>::max();
+		}
+
+		#ifdef DEBUG
+		if (this->user_neigh_cells_to_receive.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No neighborhood with id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
+			sender_item = this->user_neigh_cells_to_receive.at(neighborhood_id).begin();
+			sender_item != this->user_neigh_cells_to_receive.at(neighborhood_id).end();
+			sender_item++
+		) {
+			ret_val += sender_item->second.size();
+		}
+
+		return ret_val;
+	}
+
+
+	/*!
+	Removes Cell_Data of refined and unrefined cells from this process.
+
+	\see
+	refine_completely()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& clear_refined_unrefined_data()
+	{
+		this->refined_cell_data.clear();
+		this->unrefined_cell_data.clear();
+		return *this;
+	}
+
+
+	/*!
+	Sets the given option of non-hierarchial partitioning to given value.
+
+	Does nothing if option name is one of:
+		- RETURN_LISTS
+		- EDGE_WEIGHT_DIM
+		- NUM_GID_ENTRIES
+		- OBJ_WEIGHT_DIM
+
+	Call this with name = LB_METHOD and value = HIER to use hierarchial
+	partitioning.
+
+	\see
+	get_partitioning_option_value()
+	add_partitioning_level()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_partitioning_option(const std::string name, const std::string value)
+	{
+		if (this->reserved_options.count(name) > 0) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Option " + name + " is reserved for dccrg"
+			);
+		}
+
+		Zoltan_Set_Param(this->zoltan, name.c_str(), value.c_str());
+		return *this;
+	}
+
+
+	/*!
+	Adds a new level for hierarchial partitioning with each part having given number of processes.
+
+	Assigns default partitioning options for the added level.
+	Does nothing if processes_per_part < 1.
+
+	\see
+	add_partitioning_option()
+	remove_partitioning_level()
+	set_partitioning_option()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& add_partitioning_level(const int processes)
+	{
+		if (processes < 1) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Must assign at least 1 process to hierarchial partitioning level"
+			);
+		}
+
+		this->processes_per_part.push_back(processes);
+
+		// create default partitioning options for the level
+		std::unordered_map<std::string, std::string> default_load_balance_options;
+		default_load_balance_options["LB_METHOD"] = "HYPERGRAPH";
+		default_load_balance_options["PHG_CUT_OBJECTIVE"] = "CONNECTIVITY";
+		this->partitioning_options.push_back(default_load_balance_options);
+		return *this;
+	}
+
+
+	/*!
+	Rremoves the given hierarhchial partitioning level.
+
+	Level numbering starts from 0.
+	Does nothing if given level doesn't exist.
+
+	\see
+	add_partitioning_level()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& remove_partitioning_level(const int hierarchial_partitioning_level)
+	{
+		if (hierarchial_partitioning_level < 0
+		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
+			return *this;
+		}
+
+		this->processes_per_part.erase(
+			this->processes_per_part.begin() + hierarchial_partitioning_level
+		);
+		this->partitioning_options.erase(
+			this->partitioning_options.begin() + hierarchial_partitioning_level
+		);
+		return *this;
+	}
+
+
+	/*!
+	Adds (or overwrites) the given option and its value for
+	hierarchial partitioning of given level.
+
+	Level numbering starts from 0.
+	Does nothing in the following cases:
+		- option name is one of: RETURN_LISTS, ...
+		- given level doesn't exist
+
+	\see
+	remove_partitioning_option()
+	add_partitioning_level()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& add_partitioning_option(
+		const int hierarchial_partitioning_level,
+		const std::string name,
+		const std::string value
+	) {
+		if (hierarchial_partitioning_level < 0
+		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
+			return *this;
+		}
+
+		if (this->reserved_options.count(name) > 0) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Option " + name + " is reserved for dccrg"
+			);
+		}
+
+		this->partitioning_options[hierarchial_partitioning_level][name] = value;
+		return *this;
+	}
+
+
+	/*!
+	Removes the given option from the given level of hierarchial partitioning.
+
+	Level numbering starts from 0.
+	Does nothing if given level doesn't exist.
+
+	\see
+	add_partitioning_option()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& remove_partitioning_option(
+		const int hierarchial_partitioning_level,
+		const std::string name
+	) {
+		if (hierarchial_partitioning_level < 0
+		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
+			return *this;
+		}
+
+		this->partitioning_options[hierarchial_partitioning_level].erase(name);
+		return *this;
+	}
+
+
+	/*!
+	Returns the names of partitioning options for hierarchial partitioning at given level.
+
+	Returns nothing if given level doesn't exist.
+	*/
+	std::vector<std::string> get_partitioning_options(const int hierarchial_partitioning_level) const
+	{
+		std::vector<std::string> partitioning_options;
+
+		if (hierarchial_partitioning_level < 0
+		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
+			return partitioning_options;
+		}
+
+		for (std::unordered_map<std::string, std::string>::const_iterator
+			option = this->partitioning_options.at(hierarchial_partitioning_level).begin();
+			option != this->partitioning_options.at(hierarchial_partitioning_level).end();
+			option++
+		) {
+			partitioning_options.push_back(option->first);
+		}
+
+		return partitioning_options;
+	}
+
+
+	/*!
+	Returns the value of given non-hierarchial partitioning option.
+
+	Returns an empty string if given option or given level doesn't exist.
+	*/
+	std::string get_partitioning_option_value(
+		const int hierarchial_partitioning_level,
+		const std::string name
+	) const {
+		std::string value;
+
+		if (hierarchial_partitioning_level < 0
+		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
+			return value;
+		}
+
+		if (this->partitioning_options.at(hierarchial_partitioning_level).count(name) > 0) {
+			value = this->partitioning_options.at(hierarchial_partitioning_level).at(name);
+		}
+
+		return value;
+	}
+
+
+	/*!
+	Returns the process which has the given cell or -1 if the cell doesn't exist.
+	*/
+	int get_process(const uint64_t cell) const
+	{
+		if (this->cell_process.count(cell) == 0) {
+			return -1;
+		} else {
+			return this->cell_process.at(cell);
+		}
+	}
+
+
+	/*!
+	Returns the processes which have the given cells or -1 for cells that don't exist.
+
+	Processes are returned in the same order as given cells.
+	Unlike get_process(const uint64_t) also works for cells
+	far from local cells when using distributed ownership.
+	Must be called simultaneously on all processes.
+
+	\see set_distributed_ownership()
+	*/
+	std::vector<int> get_process(const std::vector<uint64_t>& cells)
+	{
+		std::vector<int> processes(cells.size(), -1);
+
+		if (not this->distributed_ownership) {
+			for (size_t i = 0; i < cells.size(); i++) {
+				processes[i] = this->get_process(cells[i]);
+			}
+			return processes;
+		}
+
+		// query cells not known locally without storing the answers
+		std::vector<uint64_t> unknown;
+		std::vector<size_t> unknown_positions;
+		for (size_t i = 0; i < cells.size(); i++) {
+			const auto item = this->cell_process.find(cells[i]);
+			if (item != this->cell_process.cend()) {
+				processes[i] = int(item->second);
+			} else {
+				unknown.push_back(cells[i]);
+				unknown_positions.push_back(i);
+			}
+		}
+
+		const auto owners = this->cell_directory.get_process(unknown, this->comm);
+		for (size_t i = 0; i < owners.size(); i++) {
+			if (owners[i] != Cell_Directory::error_process()) {
+				processes[unknown_positions[i]] = int(owners[i]);
+			}
+		}
+
+		return processes;
+	}
+
+
+	/*!
+	Returns the smallest existing cells at given coordinates.
+
+	Cells are returned in the same order as given coordinates,
+	error_cell is returned for coordinates outside of the grid.
+	Unlike get_existing_cell(const std::array<double, 3>&) also
+	works for coordinates far from local cells when using
+	distributed ownership.
+	Must be called simultaneously on all processes.
+
+	\see set_distributed_ownership()
+	*/
+	std::vector<uint64_t> get_existing_cells(const std::vector<std::array<double, 3>>& coordinates)
+	{
+		std::vector<uint64_t> cells(coordinates.size(), error_cell);
+
+		if (not this->distributed_ownership) {
+			for (size_t i = 0; i < coordinates.size(); i++) {
+				cells[i] = this->get_existing_cell(coordinates[i]);
+			}
+			return cells;
+		}
+
+		const int max_ref_lvl = this->mapping.get_maximum_refinement_level();
+
+		// start from cells of refinement level 0 which always exist
+		std::vector<Types<3>::indices_t> indices(coordinates.size());
+		std::vector<size_t> searching;
+		for (size_t i = 0; i < coordinates.size(); i++) {
+			indices[i] = this->geometry.get_indices(coordinates[i]);
+			if (
+				indices[i][0] == error_index
+				or indices[i][1] == error_index
+				or indices[i][2] == error_index
+			) {
+				continue;
+			}
+
+			cells[i] = this->mapping.get_cell_from_indices(indices[i], 0);
+			if (max_ref_lvl > 0) {
+				searching.push_back(i);
+			}
+		}
+
+		// descend one refinement level at a time while children exist
+		for (
+			int child_ref_lvl = 1;
+			All_Reduce()(searching.size(), this->comm) > 0;
+			child_ref_lvl++
+		) {
+			std::vector<uint64_t> unknown;
+			for (const size_t i: searching) {
+				const uint64_t child = this->mapping.get_cell_from_indices(indices[i], child_ref_lvl);
+				if (this->cell_process.count(child) == 0) {
+					unknown.push_back(child);
+				}
+			}
+
+			std::unordered_set<uint64_t> existing;
+			const auto owners = this->cell_directory.get_process(unknown, this->comm);
+			for (size_t i = 0; i < owners.size(); i++) {
+				if (owners[i] != Cell_Directory::error_process()) {
+					existing.insert(unknown[i]);
+				}
+			}
+
+			std::vector<size_t> still_searching;
+			for (const size_t i: searching) {
+				const uint64_t child = this->mapping.get_cell_from_indices(indices[i], child_ref_lvl);
+				if (this->cell_process.count(child) == 0 and existing.count(child) == 0) {
+					continue;
+				}
+
+				cells[i] = child;
+				if (child_ref_lvl < max_ref_lvl) {
+					still_searching.push_back(i);
+				}
+			}
+			searching.swap(still_searching);
+		}
+
+		return cells;
+	}
+
+
+	/*!
+	Sets whether the owners of all cells are stored on every process.
+
+	By default every process stores the process of every cell in the
+	grid which requires memory proportional to the total number of cells.
+	If given == true each process stores only the processes of local cells
+	and of cells near them, the owners of other cells are kept in a
+	directory distributed over all processes and are queried collectively
+	when needed, for example during refining and load balancing.
+
+	With distributed ownership functions that take a single cell or
+	coordinate, like get_process(const uint64_t) and get_existing_cell(),
+	only know about cells near local cells, use the versions taking a
+	vector of cells or coordinates for other cells.
+	Internal consistency of cell_process between processes is then
+	not checked even if DEBUG is defined.
+
+	If called before initialize() or start_loading_grid_data() cells of
+	refinement level 0 are never stored on all processes, otherwise must
+	be called simultaneously on all processes with the same value and not
+	while refining or balancing load.
+
+	\see get_distributed_ownership() get_memory_usage()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_distributed_ownership(const bool given)
+	{
+		if (not this->grid_initialized) {
+			this->distributed_ownership = given;
+			return *this;
+		}
+
+		if (this->refining or this->balancing_load) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Ownership can't be changed while refining or balancing load"
+			);
+		}
+
+		if (given == this->distributed_ownership) {
+			return *this;
+		}
+
+		if (given) {
+			this->distributed_ownership = true;
+			this->update_cell_directory();
+			return *this;
+		}
+
+		// every process needs the owners of all cells again
+		std::vector<uint64_t> cells_and_processes;
+		cells_and_processes.reserve(2 * this->cell_directory.size());
+		for (const auto& item: this->cell_directory.get_owners()) {
+			cells_and_processes.push_back(item.first);
+			cells_and_processes.push_back(item.second);
+		}
+
+		std::vector<std::vector<uint64_t>> all_cells_and_processes;
+		All_Gather()(cells_and_processes, all_cells_and_processes, this->comm);
+		cells_and_processes.clear();
+
+		for (const auto& items: all_cells_and_processes) {
+			for (size_t i = 0; i + 1 < items.size(); i += 2) {
+				this->cell_process[items[i]] = items[i + 1];
+			}
+		}
+
+		this->cell_directory.clear();
+		this->distributed_ownership = false;
+
+		return *this;
+	}
+
+
+	/*!
+	Returns whether owners of cells are stored in a distributed directory.
+
+	\see set_distributed_ownership()
+	*/
+	bool get_distributed_ownership() const
+	{
+		return this->distributed_ownership;
+	}
+
+
+	/*!
+	Returns an estimate of the memory used by internal data structures of this process.
+
+	Keys are names of data structures and values are estimates in bytes,
+	memory allocated by cells' data themselves is not included.
+
+	\see set_distributed_ownership()
+	*/
+	std::map<std::string, uint64_t> get_memory_usage() const
+	{
+		std::map<std::string, uint64_t> usage;
+
+		usage["cell_process"] = get_container_memory_usage(this->cell_process);
+		usage["cell_directory"] = this->cell_directory.get_memory_usage();
+		usage["cell_data"]
+			= Cell_Storage::get_memory_usage(this->cell_data)
+			+ Cell_Storage::get_memory_usage(this->remote_neighbors);
+
+		uint64_t neighbors
+			= get_container_memory_usage(this->neighbors_of)
+			+ get_container_memory_usage(this->neighbors_to);
+		for (const auto& item: this->neighbors_of) {
+			neighbors += item.second.capacity() * sizeof(item.second[0]);
+		}
+		for (const auto& item: this->neighbors_to) {
+			neighbors += item.second.capacity() * sizeof(item.second[0]);
+		}
+		usage["neighbors"] = neighbors;
+
+		return usage;
+	}
+
+
+	/*!
+	\brief Cell data exchanged with one process in one neighborhood.
+
+	\see get_communication_graph()
+	*/
+	struct Communication_Graph_Edge
+	{
+		//! process with which cells are exchanged
+		int process = -1;
+		//! default_neighborhood_id or id of user's neighborhood
+		int neighborhood_id = default_neighborhood_id;
+		//! number of cells sent to / received from process per update
+		uint64_t sent_cells = 0, received_cells = 0;
+		//! number of bytes of cell data sent to / received from process per update
+		uint64_t sent_bytes = 0, received_bytes = 0;
+	};
+
+	/*!
+	Returns the data exchanged by this process in remote neighbor updates.
+
+	Returns one edge per neighborhood and process with which this process
+	exchanges cells in that neighborhood, sorted by neighborhood id and
+	process. Bytes are sizes of cells' get_mpi_datatype(), or cells'
+	packed sizes with packed remote neighbor updates, and don't include
+	any overhead of MPI. Comparing the edges of processes shows whether
+	halos are imbalanced.
+
+	Doesn't communicate with other processes.
+
+	\see
+	get_neighbor_processes()
+	write_communication_graph_csv()
+	write_communication_graph_json()
+	*/
+	std::vector<Communication_Graph_Edge> get_communication_graph() const
+	{
+		std::map<std::pair<int, int>, Communication_Graph_Edge> edges;
+
+		/*
+		get_mpi_datatype() of cells isn't necessarily const and
+		e.g. variable size cells can resize themselves when receiving,
+		so sizes are queried from a copy of each cell instead.
+		Remote neighbors without data use default constructed data.
+		*/
+		const Cell_Data default_data{};
+		Cell_Data cell_copy{};
+
+		const auto add_edges = [&](
+			const int neighborhood_id,
+			const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& to_send,
+			const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& to_receive
+		) {
+			for (const auto& receiver: to_send) {
+				auto& edge = edges[std::make_pair(neighborhood_id, receiver.first)];
+				edge.process = receiver.first;
+				edge.neighborhood_id = neighborhood_id;
+				edge.sent_cells += receiver.second.size();
+				for (const auto& item: receiver.second) {
+					cell_copy = this->cell_data.at(item.first);
+					edge.sent_bytes += this->get_transfer_size(
+						cell_copy,
+						item.first,
+						int(this->rank),
+						receiver.first,
+						false,
+						neighborhood_id
+					);
+				}
+			}
+
+			for (const auto& sender: to_receive) {
+				auto& edge = edges[std::make_pair(neighborhood_id, sender.first)];
+				edge.process = sender.first;
+				edge.neighborhood_id = neighborhood_id;
+				edge.received_cells += sender.second.size();
+				for (const auto& item: sender.second) {
+					cell_copy
+						= this->remote_neighbors.count(item.first) > 0
+						? this->remote_neighbors.at(item.first)
+						: default_data;
+					edge.received_bytes += this->get_transfer_size(
+						cell_copy,
+						item.first,
+						sender.first,
+						int(this->rank),
+						true,
+						neighborhood_id
+					);
+				}
+			}
+		};
+
+		add_edges(default_neighborhood_id, this->cells_to_send, this->cells_to_receive);
+		for (const auto& item: this->user_neigh_cells_to_send) {
+			const int neighborhood_id = item.first;
+			add_edges(
+				neighborhood_id,
+				item.second,
+				this->user_neigh_cells_to_receive.at(neighborhood_id)
+			);
+		}
+
+		std::vector<Communication_Graph_Edge> graph;
+		graph.reserve(edges.size());
+		for (const auto& item: edges) {
+			graph.push_back(item.second);
+		}
+		return graph;
+	}
+
+	/*!
+	Writes get_communication_graph() into given stream as comma separated values.
+
+	Writes one line per edge with columns
+	rank,process,neighborhood_id,sent_cells,received_cells,sent_bytes,received_bytes
+	preceded by a line with column names if header == true, so that
+	output of all processes can be concatenated into one file.
+
+	\see write_communication_graph_json()
+	*/
+	void write_communication_graph_csv(std::ostream& out, const bool header = true) const
+	{
+		if (header) {
+			out << "rank,process,neighborhood_id,sent_cells,received_cells,sent_bytes,received_bytes\n";
+		}
+		for (const auto& edge: this->get_communication_graph()) {
+			out << this->rank << ","
+				<< edge.process << ","
+				<< edge.neighborhood_id << ","
+				<< edge.sent_cells << ","
+				<< edge.received_cells << ","
+				<< edge.sent_bytes << ","
+				<< edge.received_bytes << "\n";
+		}
+	}
+
+	/*!
+	Writes get_communication_graph() into given stream as a JSON object.
+
+	For example:
+	\verbatim
+	{"rank": 0, "edges": [
+	{"process": 1, "neighborhood_id": -3532, "sent_cells": 10, "received_cells": 10, "sent_bytes": 80, "received_bytes": 80}
+	]}
+	\endverbatim
+
+	\see write_communication_graph_csv()
+	*/
+	void write_communication_graph_json(std::ostream& out) const
+	{
+		out << "{\"rank\": " << this->rank << ", \"edges\": [";
+		bool first = true;
+		for (const auto& edge: this->get_communication_graph()) {
+			out << (first ? "\n" : ",\n")
+				<< "{\"process\": " << edge.process
+				<< ", \"neighborhood_id\": " << edge.neighborhood_id
+				<< ", \"sent_cells\": " << edge.sent_cells
+				<< ", \"received_cells\": " << edge.received_cells
+				<< ", \"sent_bytes\": " << edge.sent_bytes
+				<< ", \"received_bytes\": " << edge.received_bytes
+				<< "}";
+			first = false;
+		}
+		out << "\n]}\n";
+	}
+
+
+	/*!
+	Given cell is kept on this process during subsequent load balancing.
+
+	\see
+	pin(const uint64_t cell, const int process)
+	*/
+	bool pin(const uint64_t cell)
+	{
+		return this->pin(cell, this->rank);
+	}
+
+	/*!
+	Given cell is sent to the given process and kept there during subsequent load balancing.
+
+	Returns true on success, does nothing and returns false in the following cases:
+		- given cell doesn't exist
+		- given cell exists on another process
+		- given cell has children
+		- given process doesn't exist
+
+	\see
+	unpin()
+	pin(const uint64_t cell)
+	*/
+	bool pin(const uint64_t cell, const int process)
+	{
+		if (this->cell_process.count(cell) == 0) {
+			return false;
+		}
+
+		if (this->cell_process.at(cell) != this->rank) {
+			return false;
+		}
+
+		if (cell != this->get_child(cell)) {
+			return false;
+		}
+
+		if (process < 0 || process >= (int) this->comm_size) {
+			return false;
+		}
+
+		// do nothing if the request already exists
+		if (this->pin_requests.count(cell) > 0
+		&& (int) this->pin_requests.at(cell) == process) {
+			return true;
+		}
+
+		this->new_pin_requests[cell] = (uint64_t) process;
+
+		return true;
+	}
+
+	/*!
+	Allows the given cell to be moved to another process during subsequent load balancing.
+
+	Returns true on success, does nothing and returns false in the following cases:
+		- given cell has children
+		- given cell doesn't exist
+		- given cell exists on another process
+
+	\see
+	unpin_local_cells()
+	pin(const uint64_t cell)
+	*/
+	bool unpin(const uint64_t cell)
+	{
+		if (this->cell_process.count(cell) == 0) {
+			return false;
+		}
+
+		if (this->cell_process.at(cell) != this->rank) {
+			return false;
+		}
+
+		if (cell != this->get_child(cell)) {
+			return false;
+		}
+
+		if (this->pin_requests.count(cell) > 0) {
+			// non-existing process means unpin
+			this->new_pin_requests[cell] = this->comm_size;
+		} else {
+			this->new_pin_requests.erase(cell);
+		}
+
+		return true;
+	}
+
+	/*!
+	Executes unpin(cell) for all cells on this process.
+
+	Returns true if all unpins succeeded, false otherwise.
+
+	TODO: only execute for cells that are pinned
+
+	\see
+	unpin()
+	*/
+	bool unpin_local_cells()
+	{
+		#ifdef DEBUG
+		// check that all child cells on this process are also in this->cell_data.
+		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
+			i = this->cell_process.begin();
+			i != this->cell_process.end();
+			i++
+		) {
+			const uint64_t cell = i->first;
+
+			if (this->cell_process.at(cell) != this->rank) {
+				continue;
+			}
+
+			if (cell == this->get_child(cell)) {
+				if (this->cell_data.count(cell) == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << cell
+						<< " should be in this->cell_data of process " << this->rank
+						<< std::endl;
+					abort();
+				}
+			} else {
+				if (this->cell_data.count(cell) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << cell
+						<< " shouldn't be in this->cell_data of process " << this->rank
+						<< std::endl;
+					abort();
+				}
+			}
+		}
+		#endif
+
+		bool ret_val = true;
+		for (const auto& item: this->cell_data) {
+			if (!this->unpin(item.first)) {
+				ret_val = false;
+			}
+		}
+
+		return ret_val;
+	}
+
+	/*!
+	All cells in the grid are free to move between processes.
+
+	Must be called simultaneously on all processes.
+
+	\see
+	unpin()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& unpin_all_cells()
+	{
+		this->new_pin_requests.clear();
+		this->pin_requests.clear();
+		return *this;
+	}
+
+
+	/*!
+	Returns cells that are on the local process boundary.
+
+	Returns cells for which either of the following is true:
+		- a cell on another process is considered as a neighbor
+		- are considered as a neighbor by a cell on another process
+
+	Given neighborhood is used when considering neighbor relations.
+
+	By default returned cells are in random order but if sorted == true
+	they are sorted using std::sort before returning.
+
+	Returns nothing if neighborhood with given id doesn't exist.
+
+	\see get_cells() is more general than this but slower.
+	*/
+	std::vector<uint64_t> get_local_cells_on_process_boundary(
+		const int neighborhood_id = default_neighborhood_id,
+		const bool sorted = false
+	) const {
+		std::vector<uint64_t> ret_val;
+
+		if (neighborhood_id == default_neighborhood_id) {
+			ret_val.insert(
+				ret_val.end(),
+				this->local_cells_on_process_boundary.begin(),
+				this->local_cells_on_process_boundary.end()
+			);
+		} else if (this->user_hood_of.count(neighborhood_id) > 0) {
+			ret_val.insert(
+				ret_val.end(),
+				this->user_local_cells_on_process_boundary.at(neighborhood_id).begin(),
+				this->user_local_cells_on_process_boundary.at(neighborhood_id).end()
+			);
+		}
+
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
+		}
+
+		return ret_val;
+	}
+
+
+	/*!
+	Returns cells that are not on the local process boundary.
+
+	Returns cells which do not consider a cell on another process
+	as a neighbor and which are not considered as a neighbor
+	by a cell on another process.
+
+	By default returned cells are in random order but if sorted == true
+	they are sorted using std::sort before returning.
+
+	Returns nothing if neighborhood with given id doesn't exist.
+
+	\see get_cells() is more general than this but a bit slower.
+	*/
+	std::vector<uint64_t> get_local_cells_not_on_process_boundary(
+		const int neighborhood_id = default_neighborhood_id,
+		const bool sorted = false
+	) const {
+		std::vector<uint64_t> ret_val;
+
+		if (neighborhood_id == default_neighborhood_id) {
+
+			for (const auto& item: this->cell_data) {
+				const uint64_t cell = item.first;
+				if (this->local_cells_on_process_boundary.count(cell) == 0) {
+					ret_val.push_back(cell);
+				}
+			}
+
+		} else if (this->user_hood_of.count(neighborhood_id) > 0) {
+
+			for (const auto& item: this->cell_data) {
+				const uint64_t cell = item.first;
+				if (this->user_local_cells_on_process_boundary.at(neighborhood_id).count(cell) == 0) {
+					ret_val.push_back(cell);
+				}
+			}
+		}
+
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
+		}
+
+		return ret_val;
+	}
+
+
+	/*!
+	Returns remote cells that are on the local process boundary.
+
+	Returns cells for which either of the following is true:
+		- a local cell is considered as a neighbor
+		- are considered as a neighbor by a local cell
+
+	By default returned cells are in random order but if sorted == true
+	they are sorted using std::sort before returning.
+
+	Returns nothing if neighborhood with given id doesn't exist.
+
+	\see get_cells() is more general than this but a bit slower.
+	*/
+	std::vector<uint64_t> get_remote_cells_on_process_boundary(
+		const int neighborhood_id = default_neighborhood_id,
+		const bool sorted = false
+	) const {
+		std::vector<uint64_t> ret_val;
+
+		if (neighborhood_id == default_neighborhood_id) {
+			ret_val.insert(
+				ret_val.end(),
+				this->remote_cells_on_process_boundary.begin(),
+				this->remote_cells_on_process_boundary.end()
+			);
+		} else if (this->user_hood_of.count(neighborhood_id) > 0) {
+			ret_val.insert(ret_val.end(),
+				this->user_remote_cells_on_process_boundary.at(neighborhood_id).begin(),
+				this->user_remote_cells_on_process_boundary.at(neighborhood_id).end()
+			);
+		}
+
+		if (sorted && ret_val.size() > 0) {
+			std::sort(ret_val.begin(), ret_val.end());
+		}
+
+		return ret_val;
+	}
+
+
+	/*!
+	Sets the weight of given local existing cell without children.
+
+	Does nothing if above conditions are not met.
+	Cell weights are given to Zoltan when balancing the load.
+	Unset cell weights are assumed to be 1.
+
+	User set cell weights are removed when balance_load is called.
+	Children of refined cells inherit their parent's weight.
+	Parents of unrefined cells do not inherit the moved cells' weights.
+	User set weights override weights from measured costs,
+	see set_automatic_cell_weights().
+
+	Returns true on success, does nothing and returns false otherwise.
+	*/
+	bool set_cell_weight(const uint64_t cell, const double weight)
+	{
+		if (this->cell_process.count(cell) == 0) {
+			return false;
+		}
+
+		if (this->cell_process.at(cell) != this->rank) {
+			return false;
+		}
+
+		if (cell != this->get_child(cell)) {
+			return false;
+		}
+
+		this->cell_weights[cell] = weight;
+
+		return true;
+	}
+
+	/*!
+	Sets several weights of given local existing cell without children.
+
+	Does nothing if above conditions are not met.
+	The first weight is equal to that given to set_cell_weight()
+	and is the only one used in incremental load balancing
+	and load balance statistics. All weights are given to
+	Zoltan, which balances them simultaneously if supported
+	by the partitioning method, for example RCB with option
+	RCB_MULTICRITERIA, and to load balancing method HILBERT,
+	which balances the maximum of each cell's weights divided
+	by total weight of all cells with the same index.
+	The number of weights is the largest given on any process
+	to any cell, unset weights are assumed to be 1.
+
+	For example compute and memory can be balanced with:
+	\verbatim
+	grid.set_cell_weights(cell, std::array<double, 2>{{time, bytes}});
+	\endverbatim
+	Weights are removed like those of set_cell_weight().
+
+	Returns true on success, does nothing and returns false otherwise.
+	*/
+	template<size_t Number_Of_Weights> bool set_cell_weights(
+		const uint64_t cell,
+		const std::array<double, Number_Of_Weights>& weights
+	) {
+		static_assert(Number_Of_Weights > 0, "At least one weight is required");
+
+		if (!this->set_cell_weight(cell, weights[0])) {
+			return false;
+		}
+
+		if (Number_Of_Weights > 1) {
+			this->additional_cell_weights[cell].assign(weights.begin() + 1, weights.end());
+		} else {
+			this->additional_cell_weights.erase(cell);
+		}
+
+		return true;
+	}
+
+	/*!
+	Returns the weight of given local existing cell without children.
+
+	Returns a quiet nan if above conditions are not met.
+	Unset cell weights are assumed to be 1.
+	*/
+	double get_cell_weight(const uint64_t cell) const
+	{
+		if (this->cell_process.count(cell) == 0) {
+			return std::numeric_limits<double>::quiet_NaN();
+		}
+
+		if (this->cell_process.at(cell) != this->rank) {
+			return std::numeric_limits<double>::quiet_NaN();
+		}
+
+		if (cell != this->get_child(cell)) {
+			return std::numeric_limits<double>::quiet_NaN();
+		}
+
+		if (this->cell_weights.count(cell) == 0) {
+			return 1;
+		} else {
+			return this->cell_weights.at(cell);
+		}
+	}
+
+
+	/*!
+	Adds given time spent computing given local cell to its measured cost.
+
+	Does nothing unless automatic cell weights are enabled,
+	see set_automatic_cell_weights(). Times are in arbitrary
+	but same units on all processes, and are accumulated
+	until the next call to balance_load().
+	Not thread safe, use the version taking an item of
+	local_cells from several threads.
+	*/
+	void add_cell_time(const uint64_t cell, const double time)
+	{
+		if (this->automatic_cell_weights) {
+			this->measured_cell_times[cell] += time;
+		}
+	}
+
+	/*!
+	Adds given time spent computing given item of local_cells to its measured cost.
+
+	As add_cell_time() with a cell id but thread safe, the time
+	is added atomically into a slot of the cell without
+	allocating memory. Given item must be from local_cells,
+	inner_cells or outer_cells of this grid, which mustn't
+	have changed e.g. by refining since the item was obtained.
+	*/
+	void add_cell_time(const Cells_Item& cell, const double time)
+	{
+		if (not this->automatic_cell_weights) {
+			return;
+		}
+
+		const std::less<const Cells_Item*> is_before;
+		auto& slots = this->cell_time_slots.times;
+		if (
+			is_before(&cell, this->cells.data())
+			or not is_before(&cell, this->cells.data() + slots.size())
+		) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Cell " << cell.id << " isn't an item of local cells of this grid"
+				<< std::endl;
+			abort();
+		}
+
+		auto& slot = slots[size_t(&cell - this->cells.data())];
+		double old_time = slot.load(std::memory_order_relaxed);
+		while (
+			not slot.compare_exchange_weak(
+				old_time,
+				old_time + time,
+				std::memory_order_relaxed
+			)
+		) {}
+	}
+
+	/*!
+	Measures time spent computing one cell for automatic cell weights.
+
+	Adds time elapsed between construction and destruction
+	to given item of local_cells with add_cell_time(), for example:
+	\verbatim
+	for (const auto& cell: grid.local_cells) {
+		const Grid::Cell_Timer timer(grid, cell);
+		solve(cell);
+	}
+	\endverbatim
+	Thread safe, cells can also be timed by several threads
+	simultaneously. Doesn't read the clock unless automatic
+	cell weights are enabled at construction, nothing is
+	measured if they're enabled only before destruction.
+	*/
+	class Cell_Timer
+	{
+	public:
+		Cell_Timer(
+			Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>& given_grid,
+			const Cells_Item& given_cell
+		) :
+			grid(given_grid),
+			cell(given_cell),
+			timing(given_grid.get_automatic_cell_weights())
+		{
+			if (this->timing) {
+				this->start = std::chrono::steady_clock::now();
+			}
+		}
+
+		Cell_Timer(const Cell_Timer&) = delete;
+		Cell_Timer& operator=(const Cell_Timer&) = delete;
+
+		~Cell_Timer()
+		{
+			if (this->timing) {
+				this->grid.add_cell_time(
+					this->cell,
+					std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count()
+				);
+			}
+		}
+
+	private:
+		Dccrg<
+			Cell_Data,
+			Geometry,
+			std::tuple<Additional_Cell_Items...>,
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
+		>& grid;
+		const Cells_Item& cell;
+		// whether automatic cell weights were enabled at construction
+		const bool timing;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	/*!
+	Returns the estimated cost of given local cell from measured times.
+
+	Returns a quiet nan if the cell has no estimate,
+	estimates are updated by balance_load().
+	\see set_automatic_cell_weights()
+	*/
+	double get_cell_cost(const uint64_t cell) const
+	{
+		const auto cost = this->cell_costs.find(cell);
+		if (cost == this->cell_costs.end()) {
+			return std::numeric_limits<double>::quiet_NaN();
+		}
+		return cost->second;
+	}
+
+
+	/*!
+	Returns the cells that will be added to this process by load balancing.
+	*/
+	const std::unordered_set<uint64_t>& get_cells_added_by_balance_load() const
+	{
+		return this->added_cells;
+	}
+
+	/*!
+	Returns the cells that will be removed from this process by load balancing.
+	*/
+	const std::unordered_set<uint64_t>& get_cells_removed_by_balance_load() const
+	{
+		return this->removed_cells;
+	}
+
+	/*!
+	Load of processes and amount of migration in one call to balance_load().
+
+	Imbalance is the maximum total weight of cells of a process
+	divided by the average, 1 if all cells have zero weight.
+	*/
+	struct Load_Balance_Statistics {
+		double imbalance_before = 1, imbalance_after = 1;
+		uint64_t cells_moved = 0, bytes_moved = 0;
+	};
+
+	/*!
+	Returns statistics of the latest call to balance_load() or initialize_balance_load().
+
+	Only collected if enabled with set_load_balance_statistics().
+	Weights of cells are those used for balancing the load,
+	bytes moved are given by cells' get_mpi_datatype() when
+	sending them. Identical on all processes.
+	*/
+	const Load_Balance_Statistics& get_load_balance_statistics() const
+	{
+		return this->load_balance_statistics;
+	}
+
+	/*!
+	Predicted results of balance_load(), see estimate_balance_load().
+
+	Halo size is the total number of remote cells which
+	have a local neighbor, summed over all processes.
+	*/
+	struct Load_Balance_Estimate: public Load_Balance_Statistics {
+		uint64_t halo_before = 0, halo_after = 0;
+	};
+
+	/*!
+	Predicts results of balance_load() without migrating cells.
+
+	Creates a new partition as balance_load(use_zoltan) would
+	and returns imbalance, cells and bytes that would be
+	migrated and sizes of halo before and after migration.
+	Doesn't change the grid, cell weights, estimated cell
+	costs or statistics of previous load balancing, so
+	balance_load() can be called afterwards with the same
+	weights if the estimated gain is worth the migration.
+	Pin requests are applied as if balancing the load.
+	Zoltan is only guaranteed to give the same partition
+	again for deterministic partitioning methods.
+
+	Must be called simultaneously on all processes and
+	not while balancing load. Identical on all processes.
+	*/
+	Load_Balance_Estimate estimate_balance_load(const bool use_zoltan = true)
+	{
+		if (this->balancing_load) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " estimate_balance_load(...) called while balancing load"
+				<< std::endl;
+			abort();
+		}
+
+		// changed by partitioning
+		this->collect_cell_times();
+		const auto
+			saved_cell_weights = this->cell_weights,
+			saved_measured_cell_times = this->measured_cell_times,
+			saved_cell_costs = this->cell_costs;
+		const auto saved_statistics = this->load_balance_statistics;
+		std::unordered_set<uint64_t> saved_added_cells, saved_removed_cells;
+		std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>
+			saved_cells_to_send,
+			saved_cells_to_receive;
+		std::swap(saved_added_cells, this->added_cells);
+		std::swap(saved_removed_cells, this->removed_cells);
+		std::swap(saved_cells_to_send, this->cells_to_send);
+		std::swap(saved_cells_to_receive, this->cells_to_receive);
+
+		if (this->automatic_cell_weights) {
+			this->update_cell_costs();
+		}
+
+		this->make_new_partition(use_zoltan);
+		this->update_load_balance_statistics();
+
+		Load_Balance_Estimate estimate;
+		static_cast<Load_Balance_Statistics&>(estimate) = this->load_balance_statistics;
+		const auto halo_sizes = this->get_halo_sizes();
+		estimate.halo_before = halo_sizes[0];
+		estimate.halo_after = halo_sizes[1];
+
+		this->cell_weights = saved_cell_weights;
+		this->measured_cell_times = saved_measured_cell_times;
+		this->cell_costs = saved_cell_costs;
+		this->load_balance_statistics = saved_statistics;
+		this->added_cells = std::move(saved_added_cells);
+		this->removed_cells = std::move(saved_removed_cells);
+		this->cells_to_send = std::move(saved_cells_to_send);
+		this->cells_to_receive = std::move(saved_cells_to_receive);
+
+		return estimate;
+	}
+
+
+	/*!
+	Returns the smallest existing cell at the given coordinate.
+
+	Returns error_cell if the coordinate is outside of the grid
+	or this process doesn't know which remote cells exist at given (x, y, z).
+	*/
+	uint64_t get_existing_cell(const std::array<double, 3>& coordinate) const
+	{
+		const Types<3>::indices_t indices = this->geometry.get_indices(coordinate);
+
+		if (indices[0] == error_index
+		|| indices[1] == error_index
+		|| indices[2] == error_index) {
+			return error_cell;
+		}
+
+		return this->get_existing_cell(indices, 0, this->mapping.get_maximum_refinement_level());
+	}
+
+
+ 	/*!
+	Returns the siblings of given cell regardless of whether they exist.
+
+	If given a cell of refinement level 0 returns the given cell.
+	Returns nothing if given cell's refinement level exceeds the maximum of this grid.
+	*/
+	std::vector<uint64_t> get_siblings(const uint64_t cell) const
+	{
+		std::vector<uint64_t> siblings;
+
+		const int refinement_level = this->mapping.get_refinement_level(cell);
+		if (refinement_level < 0
+		|| refinement_level > this->mapping.get_maximum_refinement_level()) {
+			return siblings;
+		}
+
+		if (refinement_level == 0) {
+			siblings.push_back(cell);
+			return siblings;
+		}
+
+		return this->get_all_children(this->get_parent(cell));
+	}
+
+
+	/*!
+	Returns all children of given cell regardless of whether they exist.
+
+	Returns nothing if childrens' refinement level would exceed max_refinement_level or
+	given cell doesn't exist.
+	 */
+	std::vector<uint64_t> get_all_children(const uint64_t cell) const
+	{
+		std::vector<uint64_t> children;
+
+		if (cell == error_cell) {
+			return children;
+		}
+
+		if (this->cell_process.count(cell) == 0) {
+			return children;
+		}
+
+		// given cell cannot have children
+		int refinement_level = this->mapping.get_refinement_level(cell);
+		if (refinement_level >= this->mapping.get_maximum_refinement_level()) {
+			return children;
+		}
+
+		children.reserve(8);
+
+		Types<3>::indices_t indices = this->mapping.get_indices(cell);
+
+		// get indices of next refinement level within this cell
+		refinement_level++;
+		const uint64_t index_offset
+			= (uint64_t(1) << (this->mapping.get_maximum_refinement_level() - refinement_level));
+
+		for (uint64_t
+			z_index_offset = 0;
+			z_index_offset < 2 * index_offset;
+			z_index_offset += index_offset
+		)
+		for (uint64_t
+			y_index_offset = 0;
+			y_index_offset < 2 * index_offset;
+			y_index_offset += index_offset
+		)
+		for (uint64_t
+			x_index_offset = 0;
+			x_index_offset < 2 * index_offset;
+			x_index_offset += index_offset
+		) {
+			const Types<3>::indices_t index = {{
+				indices[0] + x_index_offset,
+				indices[1] + y_index_offset,
+				indices[2] + z_index_offset,
+			}};
+
+			children.push_back(
+				this->mapping.get_cell_from_indices(index, refinement_level)
+			);
+		}
+
+		return children;
+	}
+
+
+	/*!
+	Returns cell weights that have been set.
+	*/
+	const std::unordered_map<uint64_t, double>& get_cell_weights() const
+	{
+		return this->cell_weights;
+	}
+
+	const std::unordered_map<uint64_t, std::vector<double>>& get_additional_cell_weights() const
+	{
+		return this->additional_cell_weights;
+	}
+
+	const std::unordered_map<uint64_t, double>& get_cell_costs() const
+	{
+		return this->cell_costs;
+	}
+
+
+	/*!
+	Adds a new neighborhood for updating Cell_Data between neighbors on different processes.
+
+	Must be called with identical parameters on all processes.
+	No neighborhood_item_t can have all offsets equal to 0.
+	Returns true on success and false in any of the following cases:
+		- given default_neighborhood_id
+		- given id already exists, use remove_neighborhood() before calling this
+		- (part of) given neighborhood is outside of initial neighborhood size
+
+	Can be used to reduce the amount of data transferred between
+	processes if Cell_Data from the full neighborhood isn't needed.
+
+	Returns true on success and false on failure.
+
+	\see
+	initialize()
+	remove_neighborhood()
+	*/
+	bool add_neighborhood(
+		const int neighborhood_id,
+		const std::vector<Types<3>::neighborhood_item_t>& given_neigh
+	) {
+		if (neighborhood_id == default_neighborhood_id) {
+			return false;
+		}
+
+		if (this->user_hood_of.count(neighborhood_id) > 0) {
+
+			#ifdef DEBUG
+			if (this->user_hood_to.count(neighborhood_id) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+
+			if (this->user_neigh_of.count(neighborhood_id) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+
+			if (this->user_neigh_to.count(neighborhood_id) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Should have id " << neighborhood_id
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			return false;
+		}
+
+		#ifdef DEBUG
+		if (this->user_hood_to.count(neighborhood_id) > 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should not have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_of.count(neighborhood_id) > 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should not have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_to.count(neighborhood_id) > 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should not have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_cells_to_send.count(neighborhood_id) > 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should not have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+
+		if (this->user_neigh_cells_to_receive.count(neighborhood_id) > 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Should not have id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		if (this->neighborhood_length > 0) {
+
+			for (const auto& neigh_item: given_neigh) {
+				for (size_t i = 0; i < 3; i++) {
+					if ((unsigned int) abs(neigh_item[i]) > this->neighborhood_length) {
+						return false;
+					}
+				}
+
+				if (neigh_item[0] == 0 && neigh_item[1] == 0 && neigh_item[2] == 0) {
+					return false;
+				}
+			}
+
+		} else {
+
+			for (const auto& neigh_item: given_neigh) {
+				int zero_offsets = 0;
+
+				for (size_t i = 0; i < 3; i++) {
+					if (neigh_item[i] == 0) {
+						zero_offsets++;
+					}
+					if (abs(neigh_item[i]) > 1) {
+						return false;
+					}
+				}
+
+				if (zero_offsets != 2) {
+					return false;
+				}
+			}
+
+		}
+
+		// set user_hood_of and _to
+		this->user_hood_of[neighborhood_id] = given_neigh;
+		this->user_hood_to[neighborhood_id].clear();
+		for (const auto& neigh_item: given_neigh) {
+			const Types<3>::neighborhood_item_t neigh_item_to = {{
+				-neigh_item[0],
+				-neigh_item[1],
+				-neigh_item[2]
+			}};
+			this->user_hood_to.at(neighborhood_id).push_back(neigh_item_to);
+		}
+
+		for (const auto& item: this->cell_data) {
+			this->update_user_neighbors(item.first, neighborhood_id);
+		}
+
+		this->update_user_remote_neighbor_info(neighborhood_id);
+
+		this->recalculate_neighbor_update_send_receive_lists(neighborhood_id);
+		this->update_neighbor_processes();
+		this->create_neighbor_collectives();
+		this->allocate_copies_of_remote_neighbors(neighborhood_id);
+
+		// new copies of remote neighbors might have moved other cells' data
+		if (not Cell_Storage::stable_addresses) {
+			this->update_cell_pointers();
+		}
+
+		#ifdef DEBUG
+		if (!this->is_consistent()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " The grid is inconsistent"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		if (!this->verify_neighbors()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Neighbor lists are incorrect"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		if (!this->verify_remote_neighbor_info()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info is not consistent"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+
+		if (!this->verify_user_data()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " User data not consistent"
+				<< std::endl;
+			exit(EXIT_FAILURE);
+		}
+		#endif
+
+		return true;
+	}
+
+
+	/*!
+	Removes the given neighborhood.
+
+	Must be called with identical id on all processes.
+	Frees local neighbor lists and other resources associated
+	with given neighborhood.
+
+	\see
+	add_neighborhood()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& remove_neighborhood(const int neighborhood_id)
+	{
+		if (neighborhood_id == default_neighborhood_id) {
+			return *this;
+		}
+
+		this->user_hood_of.erase(neighborhood_id);
+		this->user_hood_to.erase(neighborhood_id);
+		this->user_neigh_of.erase(neighborhood_id);
+		this->user_neigh_to.erase(neighborhood_id);
+		this->user_neigh_cells_to_send.erase(neighborhood_id);
+		this->user_neigh_cells_to_receive.erase(neighborhood_id);
+		this->user_local_cells_on_process_boundary.erase(neighborhood_id);
+		this->user_remote_cells_on_process_boundary.erase(neighborhood_id);
+		this->free_persistent_transfers(neighborhood_id);
+		this->free_neighbor_collective_comms(neighborhood_id);
+		this->neighbor_collective_hoods.erase(neighborhood_id);
+		this->packed_send_buffers.erase(neighborhood_id);
+		this->packed_receive_buffers.erase(neighborhood_id);
+		this->update_neighbor_processes();
+		return *this;
+	}
+
+
+	/*!
+	Returns whether this dccrg instance has been initialized.
+	*/
+	bool get_initialized() const
+	{
+		return this->grid_initialized;
+	}
+
+	/*!
+	Returns whether this dccrg instance's cell id mapping has been initialized.
+	*/
+	bool get_mapping_initialized() const
+	{
+		return this->mapping_initialized;
+	}
+
+	/*!
+	Returns the maximum value an MPI tag can have.
+	*/
+	unsigned int get_max_tag() const
+	{
+		return this->max_tag;
+	}
+
+	/*!
+	Returns the maximum allowed difference in refinement level between neighboring cells.
+
+	This difference in enforced both between a cell and its neighbors_of and its neighbors_to.
+	*/
+	int get_max_ref_lvl_diff() const
+	{
+		return this->max_ref_lvl_diff;
+	}
+
+	/*!
+	Returns whether cell data is transferred using one message or more.
+
+	If true then one MPI message per cell is used, otherwise all cells
+	are transferred in one message.
+
+	\see
+	set_send_single_cells()
+	*/
+	bool get_send_single_cells() const
+	{
+		return this->send_single_cells;
+	}
+
+	/*!
+	Sets whether cell data is transferred using one message or more.
+
+	Do not switch sending type while data transfers are going on,
+	for example with start_remote_neighbor_data_update(...).
+
+	\see
+	get_send_single_cells()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_send_single_cells(const bool given)
+	{
+		if (given != this->send_single_cells) {
+			this->free_persistent_transfers();
+		}
+		this->send_single_cells = given;
+		return *this;
+	}
+
+	/*!
+	Returns whether cell iterators are updated incrementally.
+
+	\see
+	set_incremental_iterator_updates()
+	*/
+	bool get_incremental_iterator_updates() const
+	{
+		return this->incremental_iterator_updates;
+	}
+
+	/*!
+	Sets whether cell iterators are updated incrementally.
+
+	If true (default) after refining, unrefining or balancing
+	load dccrg recalculates items of cells iterators only for
+	cells whose neighbor lists changed and reuses the items of
+	other cells, updating only their data pointers.
+	If false neighbors of all local cells are recalculated
+	every time iterators are updated.
+	Iterators are identical in both cases, with DEBUG defined
+	reused items are also verified against recalculated ones.
+
+	\see
+	get_incremental_iterator_updates()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_incremental_iterator_updates(const bool given)
+	{
+		this->incremental_iterator_updates = given;
+		return *this;
+	}
+
+	/*!
+	Returns whether refinement requests spread only between neighboring processes.
+
+	\see
+	set_neighbor_refine_propagation()
+	*/
+	bool get_neighbor_refine_propagation() const
+	{
+		return this->neighbor_refine_propagation;
+	}
+
+	/*!
+	Sets whether refinement requests spread only between neighboring processes.
+
+	If false (default) every round of spreading dont_refine()s and
+	inducing refines in stop_refining() gathers the new requests
+	of all processes to every process.
+	If true new requests are sent only to processes that have
+	cells near them, i.e. to processes in send and receive lists
+	of remote neighbor updates, and every round ends with a global
+	sum of the number of new requests to check whether all processes
+	are done. The final cells to refine and unrefine are still gathered
+	to all processes once, as required by execution of refines.
+	Cells that are refined are identical in both cases.
+	Off by default because gathering is faster unless the number
+	of processes is large compared to the number of neighbors of
+	each process, tests/refine/scalability times both.
+
+	Must be called simultaneously on all processes with the same value
+	and not while refining.
+
+	\see
+	get_neighbor_refine_propagation()
+	stop_refining()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_neighbor_refine_propagation(const bool given)
+	{
+		if (this->refining) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Refine propagation can't be changed while refining"
+			);
+		}
+		this->neighbor_refine_propagation = given;
+		return *this;
+	}
+
+	/*!
+	Returns whether remote neighbor updates use persistent MPI requests.
+
+	\see
+	set_persistent_remote_neighbor_updates()
+	*/
+	bool get_persistent_remote_neighbor_updates() const
+	{
+		return this->persistent_remote_neighbor_updates;
+	}
+
+	/*!
+	Sets whether remote neighbor updates use persistent MPI requests.
+
+	If true MPI datatypes and persistent requests used by
+	update_copies_of_remote_neighbors() and related functions
+	are created by the first update of each neighborhood after
+	cells to send or receive have changed, e.g. by refining,
+	load balancing or adding neighborhoods, and are reused by
+	subsequent updates with MPI_Startall.
+
+	Requires that MPI transfer info of Cell_Data doesn't change
+	as long as the cell isn't moved, declare this with a
+	static constexpr bool stable_mpi_datatype = true member
+	of Cell_Data (see detail::has_stable_mpi_datatype).
+	With DEBUG defined transfer info is verified before every update.
+
+	Throws std::invalid_argument if enabling and Cell_Data
+	isn't declared stable.
+	Do not switch while remote neighbor updates are going on.
+
+	\see
+	get_persistent_remote_neighbor_updates()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_persistent_remote_neighbor_updates(const bool given)
+	{
+		if (given and not detail::has_stable_mpi_datatype<Cell_Data>::value) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Persistent remote neighbor updates require "
+				+ "Cell_Data::stable_mpi_datatype == true"
+			);
+		}
+		if (given and this->packed_remote_neighbor_updates) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Persistent and packed remote neighbor updates can't be used together"
+			);
+		}
+
+		this->persistent_remote_neighbor_updates = given;
+		if (not given) {
+			this->free_persistent_transfers();
+		}
+		return *this;
+	}
+
+	/*!
+	Returns whether remote neighbor updates pack cell data into contiguous buffers.
+
+	\see
+	set_packed_remote_neighbor_updates()
+	*/
+	bool get_packed_remote_neighbor_updates() const
+	{
+		return this->packed_remote_neighbor_updates;
+	}
+
+	/*!
+	Sets whether remote neighbor updates pack cell data into contiguous buffers.
+
+	If true update_copies_of_remote_neighbors() and related
+	functions copy data of all cells sent to a process into one
+	buffer which is sent as one message of MPI_PACKED and is
+	unpacked into copies of remote neighbors by the receiver
+	in wait_remote_neighbor_copy_update_receives().
+	Messages are received with their sent size so packed size of
+	a cell's copy can differ from that of the cell before update.
+	Buffers are reused by later updates.
+	Can be faster than the default derived datatype of all cells
+	if Cell_Data's datatype consists of many small blocks.
+
+	Cell data is packed with user's pack hooks if Cell_Data
+	has them (see detail::has_pack_hooks) and with MPI_Pack
+	and get_mpi_datatype() otherwise.
+	set_send_single_cells() has no effect on packed updates.
+
+	Throws std::invalid_argument if enabling while persistent
+	remote neighbor updates are enabled.
+	Do not switch while remote neighbor updates are going on.
+
+	\see
+	get_packed_remote_neighbor_updates()
+	set_persistent_remote_neighbor_updates()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_packed_remote_neighbor_updates(const bool given)
+	{
+		if (given and this->persistent_remote_neighbor_updates) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Persistent and packed remote neighbor updates can't be used together"
+			);
+		}
+
+		this->packed_remote_neighbor_updates = given;
+		if (not given) {
+			this->packed_send_buffers.clear();
+			this->packed_receive_buffers.clear();
+		}
+		return *this;
+	}
+
+	/*!
+	Returns whether remote neighbor updates of given neighborhood use neighbor collectives.
+
+	\see
+	set_neighbor_collective_updates()
+	*/
+	bool get_neighbor_collective_updates(
+		const int neighborhood_id = default_neighborhood_id
+	) const {
+		return this->neighbor_collective_hoods.count(neighborhood_id) > 0;
+	}
+
+	/*!
+	Returns neighborhoods whose remote neighbor updates use neighbor collectives.
+	*/
+	const std::unordered_set<int>& get_neighbor_collective_hoods() const
+	{
+		return this->neighbor_collective_hoods;
+	}
+
+	/*!
+	Sets whether remote neighbor updates of given neighborhood use neighbor collectives.
+
+	If true update_copies_of_remote_neighbors() and related
+	functions exchange data of given neighborhood with one
+	MPI_Ineighbor_alltoallw over a distributed graph communicator
+	of processes that exchange cells in the neighborhood instead
+	of point-to-point messages, which allows the MPI library
+	to optimize the exchange.
+	The communicator is recreated whenever cells to send or
+	receive change, e.g. by refining, load balancing or adding
+	neighborhoods, and reused by updates until then.
+	If Cell_Data has stable_mpi_datatype (see
+	set_persistent_remote_neighbor_updates()) datatypes of
+	cells are also reused and with MPI >= 4 updates use a
+	persistent request.
+	Takes precedence over persistent and packed updates and
+	set_send_single_cells() for given neighborhood.
+
+	Both start_remote_neighbor_copy_receives() and
+	start_remote_neighbor_copy_sends() must be called but the
+	exchange starts only in the latter.
+
+	Must be called with identical arguments on all processes.
+	Do not switch while remote neighbor updates are going on.
+
+	\see
+	get_neighbor_collective_updates()
+	*/
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_neighbor_collective_updates(
+		const bool given,
+		const int neighborhood_id = default_neighborhood_id
+	) {
+		if (given) {
+			this->neighbor_collective_hoods.insert(neighborhood_id);
+		} else {
+			this->neighbor_collective_hoods.erase(neighborhood_id);
+			this->free_neighbor_collective_comms(neighborhood_id);
+		}
+		return *this;
+	}
+
+	/*!
+	Returns dccrg's communicator.
+
+	Returns a duplicate of the MPI communicator of dccrg
+	which itself is a duplicate of the communicator that
+	was given to dccrg's initialize function.
+	*/
+	MPI_Comm get_communicator() const
+	{
+		if (!this->grid_initialized) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " get_communicator called before initialize()"
+				<< std::endl;
+			abort();
+		}
+
+		MPI_Comm ret_val;
+		int result = MPI_Comm_dup(this->comm, &ret_val);
+		if (result != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't duplicate communicator: " << Error_String()(result)
+				<< std::endl;
+		}
+		return ret_val;
+	}
+
+	/*!
+	Returns the MPI process number, i.e. rank, of this process.
+	*/
+	int get_rank() const
+	{
+		return int(this->rank);
+	}
+
+	/*!
+	Returns the number of MPI processes participating in this dccrg instance.
+	*/
+	int get_comm_size() const
+	{
+		return int(this->comm_size);
+	}
+
+	/*!
+	Returns the storage of mostly local cell ids and their data.
+	*/
+	const cell_data_container_t& get_cell_data() const
+	{
+		return this->cell_data;
+	}
+
+	/*!
+	Returns the neighborhood of cells.
+
+	Returns offsets in which cells are considered as neighbors of a cell.
+	*/
+	const std::vector<Types<3>::neighborhood_item_t>& get_neighborhood_of() const
+	{
+		return this->neighborhood_of;
+	}
+
+	/*!
+	Returns the opposite of neighborhood of cells.
+
+	Returns offsets in which cells consider a cell as neighbor.
+	*/
+	const std::vector<Types<3>::neighborhood_item_t>& get_neighborhood_to() const
+	{
+		return this->neighborhood_to;
+	}
+
+	/*!
+	Returns the offsets of user defined neighborhoods.
+	*/
+	const std::unordered_map<
+		int,
+		std::vector<Types<3>::neighborhood_item_t>
+	>& get_user_hood_of() const
+	{
+		return this->user_hood_of;
+	}
+
+	/*!
+	Returns the opposite of offsets of user defined neighborhoods
+	*/
+	const std::unordered_map<
+		int,
+		std::vector<Types<3>::neighborhood_item_t>
+	>& get_user_hood_to() const
+	{
+		return this->user_hood_to;
+	}
+
+	/*!
+	Returns cells (2nd value) which consider a cell (1st value) as neighbor
+	*/
+	const std::unordered_map<
+		uint64_t,
+		std::vector<
+			std::pair<
+				uint64_t,
+				std::array<int, 4>
+			>
+		>
+	>& get_all_neighbors_to() const
+	{
+		return this->neighbors_to;
+	}
+
+	/*!
+	User defined neighborhood version of get_cell_neighbor.
+	*/
+	const std::unordered_map<
+		int,
+		std::unordered_map<
+			uint64_t,
+			std::vector<
+				std::pair<
+					uint64_t,
+					std::array<int, 4>
+				>
+			>
+		>
+	>& get_all_user_neigh_of() const
+	{
+		return this->user_neigh_of;
+	}
+
+	/*!
+	User defined neighborhood version of get_all_neighbors_to().
+	*/
+	const std::unordered_map<
+		int,
+		std::unordered_map<
+			uint64_t,
+			std::vector<
+				std::pair<
+					uint64_t,
+					std::array<int, 4>
+				>
+			>
+		>
+	>& get_all_user_neigh_to() const
+	{
+		return this->user_neigh_to;
+	}
+
+	/*!
+	Returns the process (2nd value) of each cell (1st value).
+	*/
+	const std::unordered_map<uint64_t, uint64_t>& get_cell_process() const
+	{
+		return this->cell_process;
+	}
+
+	/*!
+	Returns the part of the distributed directory of cell owners stored on this process.
+
+	\see set_distributed_ownership()
+	*/
+	const Cell_Directory& get_cell_directory() const
+	{
+		return this->cell_directory;
+	}
+
+	/*!
+	Returns cells which have a remote neighbor.
+	*/
+	const std::unordered_set<uint64_t>& get_local_cells_on_process_boundary_internal() const
+	{
+		return this->local_cells_on_process_boundary;
+	}
+
+	/*!
+	Returns remote cells which have a local neighbor.
+	*/
+	const std::unordered_set<uint64_t>& get_remote_cells_on_process_boundary_internal() const
+	{
+		return this->remote_cells_on_process_boundary;
+	}
+
+	/*!
+	Returns cells which have a remote neighbor for each used defined neighborhood.
+	*/
+	const std::unordered_map<
+		int,
+		std::unordered_set<uint64_t>
+	>& get_user_local_cells_on_process_boundary() const
+	{
+		return this->user_local_cells_on_process_boundary;
+	}
+
+	/*!
+	Returns remote cells which have a local neighbor for each used defined neighborhood.
+	*/
+	const std::unordered_map<
+		int,
+		std::unordered_set<uint64_t>
+	>& get_user_remote_cells_on_process_boundary() const
+	{
+		return this->user_remote_cells_on_process_boundary;
+	}
+
+	/*!
+	Returns cells that will be sent to other processes.
+
+	First int is the target process, uint64_t is cell id and
+	last int is the message tag when dccrg sends one cell / MPI_Isend.
+	*/
+	const std::unordered_map<
+		int,
+		std::vector<std::pair<uint64_t, int>>
+	>& get_cells_to_send() const
+	{
+		return this->cells_to_send;
+	}
+
+	/*!
+	Returns cells that will be received from other processes.
+
+	First int is the sending process, uint64_t is cell id and
+	last int is the message tag when dccrg receives one cell / MPI_Irecv.
+	*/
+	const std::unordered_map<
+		int,
+		std::vector<std::pair<uint64_t, int>>
+	>& get_cells_to_receive() const
+	{
+		return this->cells_to_receive;
+	}
+
+	/*!
+	Returns cells which will be sent for each user defined neighborhood.
+	*/
+	const std::unordered_map<
+		int,
+		std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>
+	>& get_user_neigh_cells_to_send() const
+	{
+		return this->user_neigh_cells_to_send;
+	}
+
+	/*!
+	Returns cells which will be received for each user defined neighborhood.
+	*/
+	const std::unordered_map<
+		int,
+		std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>
+	>& get_user_neigh_cells_to_receive() const
+	{
+		return this->user_neigh_cells_to_receive;
+	}
+
+	/*!
+	Returns pin requests currently in force.
+	*/
+	const std::unordered_map<uint64_t, uint64_t>& get_pin_requests() const
+	{
+		return this->pin_requests;
+	}
+
+	/*!
+	Returns pin requests of this process.
+
+	These have not been told to other processes yet.
+	*/
+	const std::unordered_map<uint64_t, uint64_t>& get_new_pin_requests() const
+	{
+		return this->new_pin_requests;
+	}
+
+	/*!
+	Returns the pointer to this instances Zoltan data structure.
+	*/
+	const Zoltan_Struct* get_zoltan() const
+	{
+		return this->zoltan;
+	}
+
+	/*!
+	Returns the number of processes per Zoltan partition.
+
+	First partition has vec[0] number of processes, second vec[1], etc.
+	*/
+	const std::vector<unsigned int>& get_processes_per_part() const
+	{
+		return this->processes_per_part;
+	}
+
+	/*!
+	Returns the options that are given to Zoltan when partitioning.
+	*/
+	const std::vector<
+		std::unordered_map<std::string, std::string>
+	> get_partitioning_options() const
+	{
+		return this->partitioning_options;
+	}
+
+	/*!
+	Returns whether load balancing by Zoltan is supposed to fail.
+	*/
+	bool get_no_load_balancing() const
+	{
+		return this->no_load_balancing;
+	}
+
+	/*!
+	Returns options to Zoltan which cannot be set by the user.
+	*/
+	const std::unordered_set<std::string>& get_reserved_options() const
+	{
+		return this->reserved_options;
+	}
+
+	/*!
+	Returns processes with which this process exchanges cells in remote neighbor updates.
+
+	Includes processes that send cells to or receive cells from this
+	process in the default or any user neighborhood, any two processes
+	either have or don't have each other in returned processes.
+	Updated whenever send and receive lists of remote neighbor updates
+	change, e.g. after refining, balancing load and adding neighborhoods.
+
+	\see get_communication_graph()
+	*/
+	const std::unordered_set<uint64_t>& get_neighbor_processes() const
+	{
+		return this->neighbor_processes;
+	}
+
+	/*!
+	Returns whether this instance is currently balancing the load.
+	*/
+	bool get_balancing_load() const
+	{
+		return this->balancing_load;
+	}
+
+
+	/*!
+	Default constructs local copy of the data of remote neighbor cells.
+
+	Use this function to modify the default constructed incoming cells
+	before they start receiving data from other processes.
+
+	For example if the default constructed version of cell data class
+	doesn't return a correct MPI_Datatype when updating remote neighbor
+	data then call this beforehand and use get_remote_neighbors_to() to
+	get a list of cells which you should change.
+	*/
+	Dccrg<
+		Cell_Data,
 		Geometry,
 		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& set_partitioning_option(const std::string name, const std::string value)
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& allocate_copies_of_remote_neighbors(const int neighborhood_id = default_neighborhood_id)
+	{
+		if (
+			neighborhood_id != default_neighborhood_id
+			and this->user_hood_of.count(neighborhood_id) == 0
+		) {
+			throw std::invalid_argument("Neighborhood with given id doesn't exist.");
+		}
+
+		const auto& receives_to_use = [&neighborhood_id, this](){
+			if (neighborhood_id == default_neighborhood_id) {
+				return this->cells_to_receive;
+			} else {
+				return this->user_neigh_cells_to_receive.at(neighborhood_id);
+			}
+		}();
+
+		for (const auto& sender : receives_to_use) {
+			for (const auto& item: sender.second) {
+				this->remote_neighbors[item.first];
+			}
+		}
+
+		return *this;
+	}
+
+
+
+private:
+	bool
+		mapping_initialized = false,
+		grid_initialized = false;
+
+	// size of the neighbor stencil of a cells in cells (of the same size as the cell itself)
+	unsigned int neighborhood_length = 1;
+
+	std::string load_balancing_method{"RCB"};
+
+	// maximum value an MPI tag can have
+	unsigned int max_tag;
+
+	// maximum difference in refinement level between neighbors
+	int max_ref_lvl_diff = 1;
+
+	// whether to send user's cell data between processes
+	// with only one message or one message / cell
+	bool send_single_cells = false;
+
+	// the grid is distributed between these processes
+	MPI_Comm comm;
+	// duplicate of comm reserved for Some_To_Some()
+	MPI_Comm some_to_some_comm = MPI_COMM_NULL;
+	uint64_t rank, comm_size;
+
+	// cells and their data on this process
+	cell_data_container_t cell_data;
+
+	/*!
+	Cell on this process and cells it considers as neighbors
+
+	Owner(s) of neighbors_of send user data of neighbors_of to owner
+	of the cell during remote neighbor data update.
+	*/
+	std::unordered_map<
+		uint64_t,
+		std::vector<
+			std::pair<
+				uint64_t,
+				std::array<int, 4>
+			>
+		>
+	> neighbors_of;
+
+	/*
+	Offsets of cells that are considered as neighbors of a cell and
+	offsets of cells that consider a cell as a neighbor
+	*/
+	std::vector<Types<3>::neighborhood_item_t> neighborhood_of, neighborhood_to;
+
+	/*
+	User defined versions of neighborhood_of and _to.
+	*/
+	std::unordered_map<
+		int, // user defined id of neighborhood
+		std::vector<Types<3>::neighborhood_item_t>
+	> user_hood_of, user_hood_to;
+
+	/*!
+	Cell on this process and those cells that aren't neighbors of
+	this cell but whose neighbor this cell is.
+	For example with a stencil size of 1 in the following grid:
+\verbatim
+|-----------|
+|     |5 |6 |
+|  1  |--|--|
+|     |9 |10|
+|-----------|
+\endverbatim
+	neighbors_to[6] = 1 because neighbors[6] = 5, 9, 10 while
+	neighbors_to[5] is empty because neighbors[5] = 1, 6, 9, 10
+	*/
+	std::unordered_map<
+		uint64_t,
+		std::vector<
+			std::pair<
+				uint64_t,
+				std::array<int, 4>
+			>
+		>
+	> neighbors_to;
+
+	/*
+	User defined versions of neighbors_of and _to
+	*/
+	std::unordered_map<
+		int, // user defined id of neighbor lists
+		std::unordered_map< // same as neighbors_of and _to
+			uint64_t, // TODO named struct would be more readable...
+			std::vector<
+				std::pair<
+					uint64_t,
+					std::array<int, 4>
+				>
+			>
+		>
+	> user_neigh_of, user_neigh_to;
+
+	/*
+	On which process every cell in the grid is.
+
+	With distributed ownership only cells near local cells
+	are stored and the rest can be queried from cell_directory.
+	*/
+	std::unordered_map<uint64_t, uint64_t> cell_process;
+
+	// whether the owners of all cells are stored on every process
+	bool distributed_ownership = false;
+
+	// owners of all cells when distributed_ownership == true
+	Cell_Directory cell_directory;
+
+	// cells on this process that have a neighbor on another
+	// process or are considered as a neighbor of a cell on another process
+	std::unordered_set<uint64_t> local_cells_on_process_boundary;
+
+	// cells on other processes that have a neighbor on this process
+	// or are considered as a neighbor of a cell on this process
+	std::unordered_set<uint64_t> remote_cells_on_process_boundary;
+
+	/*
+	User defined versions of local_cells_on_process_boundary and remote_cells_on_process_boundary
+	*/
+	std::unordered_map<
+		int, // user defined id of neighbor lists
+		std::unordered_set<uint64_t>
+	> user_local_cells_on_process_boundary, user_remote_cells_on_process_boundary;
+
+	// remote neighbors and their data, of cells on this process
+	cell_data_container_t remote_neighbors;
+
+	std::unordered_map<
+		int,
+		std::vector<MPI_Request>
+	> send_requests, receive_requests;
+
+	/*
+	Container of MPI objects owned by one instance of dccrg.
+
+	Copies start out empty and moved from containers are
+	emptied so the destructor frees each object only once.
+	*/
+	template<class Container> struct Owned_MPI_Objects : public Container {
+		Owned_MPI_Objects() = default;
+		Owned_MPI_Objects(const Owned_MPI_Objects&) : Container() {}
+		Owned_MPI_Objects(Owned_MPI_Objects&& other) : Container(std::move(other))
+		{
+			other.clear();
+		}
+		Owned_MPI_Objects& operator=(const Owned_MPI_Objects&) = delete;
+	};
+
+	/*
+	Persistent MPI requests of remote neighbor updates of one
+	neighborhood and derived datatypes used by them.
+	*/
+	struct Persistent_Transfers {
+		// process to receive from / send to
+		std::unordered_map<int, std::vector<MPI_Request>> receives, sends;
+		std::vector<MPI_Datatype> datatypes;
+		#ifdef DEBUG
+		// cell, other process, cell's address and count when requests were created
+		std::vector<std::tuple<uint64_t, int, void*, int>> receive_info, send_info;
+		#endif
+	};
+	// created by get_persistent_transfers()
+	Owned_MPI_Objects<std::unordered_map<int, Persistent_Transfers>> persistent_transfers;
+
+	// whether remote neighbor updates use persistent_transfers
+	bool persistent_remote_neighbor_updates = false;
+
+	// whether remote neighbor updates use packed buffers
+	bool packed_remote_neighbor_updates = false;
+	// packed data of remote neighbor updates of neighborhood, process
+	std::unordered_map<int, std::unordered_map<int, std::vector<char>>>
+		packed_send_buffers, packed_receive_buffers;
+	// neighborhoods whose packed receives haven't been unpacked yet
+	std::vector<int> packed_receives_to_unpack;
+
+	// neighborhoods whose remote neighbor updates use neighbor collectives
+	std::unordered_set<int> neighbor_collective_hoods;
+	/*
+	Distributed graph communicator of neighbor collective remote
+	neighbor updates of one neighborhood, the order of processes
+	in it and arguments of updates, which must not be freed until
+	an update completes.
+	*/
+	struct Neighbor_Collective {
+		MPI_Comm comm = MPI_COMM_NULL;
+		std::vector<int> sources, destinations;
+		// kept between updates if Cell_Data has stable_mpi_datatype
+		bool have_types = false;
+		std::vector<int> receive_counts, send_counts;
+		std::vector<MPI_Aint> receive_displacements, send_displacements;
+		std::vector<MPI_Datatype> receive_types, send_types;
+		// persistent with MPI >= 4 if types are kept
+		MPI_Request request = MPI_REQUEST_NULL;
+		bool started = false;
+	};
+	// created by create_neighbor_collectives() and get_neighbor_collective()
+	Owned_MPI_Objects<std::unordered_map<int, Neighbor_Collective>> neighbor_collectives;
+	// neighborhoods whose neighbor collective updates are in progress
+	std::vector<int> neighbor_collective_updates;
+
+	// cells whose data has to be received / sent by this process from the process as the key
+	std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>
+		cells_to_send, cells_to_receive;
+
+	/*
+	User defined neighborhood versions of cells_to_send and _receive.
+	*/
+	std::unordered_map<
+		int, // user defined id of neighbor lists
+		std::unordered_map<
+			int, // process to send to / receive from
+			std::vector<std::pair<uint64_t, int>>
+		>
+	> user_neigh_cells_to_send, user_neigh_cells_to_receive;
+
+	// cells added to / removed from this process by load balancing
+	std::unordered_set<uint64_t> added_cells, removed_cells;
+
+	// cells to be refined / unrefined after a call to stop_refining()
+	std::unordered_set<uint64_t> cells_to_refine, cells_to_unrefine, all_to_unrefine;
+
+	// cells that shouldn't be refined / unrefined after a call to stop_refining()
+	std::unordered_set<uint64_t> cells_not_to_refine, cells_not_to_unrefine;
+
+	// whether refines and dont_refines spread only between neighboring processes
+	bool neighbor_refine_propagation = false;
+
+	// kinds of requests from *_concurrent() refinement functions
+	enum Concurrent_Refine_Request {
+		concurrent_dont_refine,
+		concurrent_refine,
+		concurrent_dont_unrefine,
+		concurrent_unrefine,
+		number_of_concurrent_refine_requests
+	};
+
+	/*
+	Requests from *_concurrent() refinement functions,
+	each thread uses one of these based on its id so
+	threads rarely wait for each other.
+	Copies get their own unlocked mutex so grids
+	stay copyable and movable.
+	*/
+	struct Concurrent_Refine_Requests {
+		std::mutex mutex;
+		std::array<
+			std::vector<uint64_t>,
+			number_of_concurrent_refine_requests
+		> cells;
+
+		Concurrent_Refine_Requests() = default;
+		Concurrent_Refine_Requests(const Concurrent_Refine_Requests& other) :
+			cells(other.cells)
+		{}
+		Concurrent_Refine_Requests(Concurrent_Refine_Requests&& other) :
+			cells(std::move(other.cells))
+		{}
+		Concurrent_Refine_Requests& operator=(const Concurrent_Refine_Requests& other)
+		{
+			this->cells = other.cells;
+			return *this;
+		}
+	};
+	std::array<Concurrent_Refine_Requests, 64> concurrent_refine_requests;
+
+	// stores user data of cells whose children were created while refining
+	std::unordered_map<uint64_t, Cell_Data> refined_cell_data;
+	// stores user data of cells that were removed while unrefining
+	std::unordered_map<uint64_t, Cell_Data> unrefined_cell_data;
+
+	// cell that should be kept on a particular process
+	std::unordered_map<uint64_t, uint64_t> pin_requests;
+	// pin requests given since that last time load was balanced
+	std::unordered_map<uint64_t, uint64_t> new_pin_requests;
+
+	// variables for load balancing using Zoltan
+	Zoltan_Struct* zoltan;
+	// number of processes per part in a hierarchy level (numbering starts from 0)
+	std::vector<unsigned int> processes_per_part;
+	// options for each level of hierarchial load balancing (numbering start from 0)
+	std::vector<std::unordered_map<std::string, std::string>> partitioning_options;
+	// record whether Zoltan_LB_Partition is expected to fail
+	// (when the user selects NONE as the load balancing algorithm)
+	bool no_load_balancing;
+	// reserved options that the user cannot change
+	std::unordered_set<std::string> reserved_options;
+
+	// optional user-given weights of cells on this process
+	std::unordered_map<uint64_t, double> cell_weights;
+	// optional user-given weights after the first one
+	std::unordered_map<uint64_t, std::vector<double>> additional_cell_weights;
+
+	// whether balance_load() diffuses load to neighboring processes
+	bool incremental_load_balancing = false;
+	// maximum fraction of local weight sent by incremental load balancing
+	double incremental_migration_limit = 0.1;
+	// number of diffusion iterations of incremental load balancing
+	static constexpr unsigned int diffusion_iterations = 10;
+	// whether balance_load() collects load_balance_statistics
+	bool collect_load_balance_statistics = false;
+	// statistics of latest load balancing
+	Load_Balance_Statistics load_balance_statistics;
+
+	// whether cell weights are set from measured costs
+	bool automatic_cell_weights = false;
+	// weight of latest measurement in estimated costs
+	double cell_cost_smoothing = 0.5;
+	// times given to add_cell_time() since latest load balancing
+	std::unordered_map<uint64_t, double> measured_cell_times;
+
+	/*
+	Times given to add_cell_time() for items of local cells
+	since previous update_cell_pointers() in the order of
+	cells, moved into measured_cell_times by collect_cell_times().
+	Copies get copies of the times so grids stay copyable.
+	*/
+	struct Cell_Time_Slots {
+		std::vector<std::atomic<double>> times;
+
+		Cell_Time_Slots() = default;
+		Cell_Time_Slots(const Cell_Time_Slots& other)
+		{
+			*this = other;
+		}
+		Cell_Time_Slots& operator=(const Cell_Time_Slots& other)
+		{
+			this->reset(other.times.size());
+			for (size_t i = 0; i < this->times.size(); i++) {
+				this->times[i].store(other.times[i].load());
+			}
+			return *this;
+		}
+
+		// replaces times with given number of zeros
+		void reset(const size_t size)
+		{
+			std::vector<std::atomic<double>> new_times(size);
+			for (auto& time: new_times) {
+				time.store(0);
+			}
+			this->times.swap(new_times);
+		}
+	};
+	Cell_Time_Slots cell_time_slots;
+	// estimated costs of local cells
+	std::unordered_map<uint64_t, double> cell_costs;
+
+	// processes in send and receive lists of remote neighbor updates of any neighborhood
+	std::unordered_set<uint64_t> neighbor_processes;
+
+	bool balancing_load = false;
+	bool refining = false;
+
+
+	//! stores begin and end iterators for range-based for loop
+	template<class T> struct Iterator_Storage {
+		typename std::vector<T>::const_iterator begin_, end_ /*TODO: = nullptr (c++14)*/;
+		typename std::vector<T>::const_iterator begin() const { return this->begin_; }
+		typename std::vector<T>::const_iterator cbegin() const { return this->begin_; }
+		typename std::vector<T>::const_iterator end() const { return this->end_; }
+		typename std::vector<T>::const_iterator cend() const { return this->end_; }
+	};
+
+
+	struct Neighbors_Item : Additional_Neighbor_Items... {
+		uint64_t id;
+		Cell_Data* data;
+		/*!
+		Neighbor's offset from cell, in units of cell's size
+
+		Offset of a face neighbor is always 1 regardless of denominator
+		(in one dimension, 0 in others). Offset of edge neighbor is
+		always 1 in two dimensions and offset of vertex neighbor is
+		always 1 in all dimensions.
+
+		Examples:
+		\verbatim
+		indices           |0|1|2|3|4|5|6|7|8|9|...
+		cell position     |---|
+		offset (denom = 2)    |1|2|3|4|5|6|...
+		       (denom = 1)    | 1 | 2 | 3 | 4 |...
+		       (denom = -2)   | 1 or 2| 3 or 4|...
+
+		cell position     |-------|
+		offset (denom = 4)        |1|2|3|4|5|...
+		offset (denom = 2)        | 1 | 2 |...
+		\endverbatim
+
+		\see tests/advection/solve.hpp
+		*/
+		int x, y, z;
+		/*!
+		Denominator / divisor of offset from cell.
+
+		Value is = 1 if neighbor is same size as cell, > 1 if neighbor
+		is smaller than cell and < -1 if neighbor is larger than cell.
+		Value is 2 for neighbor half the size of cell, 4 for neighbor
+		quarter the size of cell, etc.
+		Value is -2 for neighbor twice the size of cell, -4 for neighbor
+		four times the size of cell, etc.
+		*/
+		int denom;
+
+
+		// everything done in update_caller() with three or more arguments
+		template<class Grid, class Cell_Item, class Neighbor_Item, class...> void update_caller(const Grid&, const Cell_Item&, const Neighbor_Item&) {}
+
+		/*!
+		@cell is \class Cells_Item of cell whose neighbors are being cached,
+		this update is called for each neighbor item created for that cell.
+		*/
+		template<
+			class Grid,
+			class Cell_Item,
+			class Neighbor_Item,
+			class A,
+			class... B
+		> void update_caller(
+			const Grid& grid,
+			const Cell_Item& cell,
+			const Neighbor_Item& neighbor,
+			const A& a,
+			const B&... b
+		) {
+			A::update(grid, cell, neighbor, a);
+			update_caller(grid, cell, neighbor, b...);
+		}
+	};
+
+	std::vector<Neighbors_Item> neighbors_rw;
+
+public:
+	/*!
+	Neighbors of cells owned by this process.
+
+	See \cells for iterating over neighbors of specific cells.
+
+	Offset of neighbor that's larger than cell depends on
+	neighbor's position in cell's neighbor list. If cell's
+	neighborhood overlaps a larger neighbor more than once,
+	that neighbor will be included several times with offsets
+	corresponding to each neighborhood item.
+
+	In most cases contains cells multiple times.
+	*/
+	const std::vector<Neighbors_Item>& neighbors = this->neighbors_rw;
+
+private:
+	struct Cells_Item : Additional_Cell_Items...
+	{
+		uint64_t id = error_cell;
+		Cell_Data* data = nullptr;
+		Iterator_Storage<Neighbors_Item>
+			//! iterator to cells considered as neighbor by this cell
+			neighbors_of,
+			//! iterator to cells that consider this one as neighbor
+			neighbors_to;
+
+		friend bool operator < (const Cells_Item& a, const Cells_Item& b)
+		{
+			return a.id < b.id;
+		}
+
+		// everything done in update_caller() with three or more arguments
+		template<class Grid, class Cell, class...> void update_caller(const Grid&, const Cell&) {}
+
+		template<
+			class Grid,
+			class Cell,
+			class A,
+			class... B
+		> void update_caller(
+			const Grid& grid,
+			const Cell& cell,
+			const A& a,
+			const B&... b
+		) {
+			A::update(grid, cell, a);
+			update_caller(grid, cell, b...);
+		}
+	};
+	// writable version of this->cells
+	std::vector<Cells_Item> cells_rw;
+
+	/*!
+	Neighbors of a local cell in the order used by neighbors_rw.
+
+	\see get_neighbor_items()
+	*/
+	struct Neighbor_Items {
+		// ids of neighbors and their offsets from the cell
+		std::vector<std::pair<uint64_t, std::array<int, 4>>> neighbors;
+		// number of neighbors only in neighbors_of and in both neighbors_of and _to
+		size_t only_of = 0, both = 0;
+	};
+
+	// cells whose neighbor lists changed or which were removed since previous update_cell_pointers()
+	std::unordered_set<uint64_t> cells_with_changed_neighbors;
+
+	// whether neighbor lists of all cells changed since previous update_cell_pointers()
+	bool all_neighbors_changed = true;
+
+	// whether update_cell_pointers() recalculates neighbors only for cells_with_changed_neighbors
+	bool incremental_iterator_updates = true;
+
+public:
+	/*!
+	Cells owned by this process (TODO: and their remote neighbors)
+
+	Provides fast iteration over cells owned by this process (TODO:
+	and local copy of their neighbors owned by other processes).
+	The following members are available:
+		- id, unique id of cell
+		- data, pointer to cell's data (Cell_Data given by user)
+		- neighbors_of, iterators to cells considered as neighbor by this one
+		- neighbors_to, iterators to cells that consider this one as neighbor
+
+	Example where every process prints the id and address of every local cell:
+	\verbatim
+	struct Cell_Data {...};
+	dccrg<Cell_Data> grid;
+	...
+	for (const auto& cell: grid.local_cells) {
+		cout << "Data of cell " << cell.id << " is stored at " << cell.data << endl;
+	}
+	\endverbatim
+	\see examples/simple_game_of_life.cpp Neighbors_Item
+	*/
+	const std::vector<Cells_Item>& cells = this->cells_rw;
+
+	/*!
+	Type of items in cells, local_cells, inner_cells, etc.
+
+	\see Thread_Pool
+	*/
+	typedef Cells_Item cells_item_t;
+
+	/*!
+	Holds iterators for fast iteration over a subset of cells owned by this process.
+
+	Example:
+	\verbatim
+	struct Cell_Data {...};
+	dccrg<Cell_Data> grid;
+	...
+	for (const auto& cell: grid.inner_cells) {
+		use data of neighbors of cell here...
+	}
+	grid.update_copies_of_remote_neighbors();
+	for (const auto& cell: grid.outer_cells) {
+		use data of neighbors of cell here...
+	}
+	\endverbatim
+	*/
+	Iterator_Storage<Cells_Item>
+		//! iterator over local cells without neighbors on other processes
+		inner_cells{this->cells.cbegin(), this->cells.cbegin()},
+		//! iterator over local cells with neighbor(s) on other processes
+		outer_cells{this->cells.cbegin(), this->cells.cbegin()},
+		//! iterator over local cells
+		local_cells{this->cells.cbegin(), this->cells.cbegin()},
+		//! iterator over copies of cells of other processes that have neighbor(s) on this process
+		remote_cells{this->cells.cbegin(), this->cells.cbegin()};
+
+
+private:
+
+	/*
+	Variables related to file I/O when loading grid data.
+	*/
+
+	MPI_File grid_data_file;
+
+	// each local cells' data offset in bytes when reading from a file
+	std::vector<std::pair<uint64_t, uint64_t> > cells_and_data_displacements;
+
+	// coordinates of box loaded by start_loading_grid_data()
+	std::array<double, 3>
+		loaded_region_min{{
+			std::numeric_limits<double>::lowest(),
+			std::numeric_limits<double>::lowest(),
+			std::numeric_limits<double>::lowest()
+		}},
+		loaded_region_max{{
+			std::numeric_limits<double>::max(),
+			std::numeric_limits<double>::max(),
+			std::numeric_limits<double>::max()
+		}};
+	// refinement levels loaded by start_loading_grid_data(), < 0 == maximum
+	std::pair<int, int> loaded_refinement_levels{0, -1};
+
+	// whether level 0 cells are assigned by size of data when loading
+	bool balanced_loading = false;
+
+	// whether only a part of grid is being loaded
+	bool load_filtered = false;
+	// loaded region and refinement levels of file being loaded
+	Types<3>::indices_t load_min_indices{{0, 0, 0}}, load_max_indices{{0, 0, 0}};
+	int load_min_ref_lvl = 0, load_max_ref_lvl = 0;
+	// data offset of cells created without data when loading
+	static constexpr uint64_t no_cell_data = ~uint64_t(0);
+
+	/*
+	Variables related to file I/O when saving grid data in the background.
+	*/
+
+	MPI_File save_file;
+	bool saving_grid_data = false;
+	// requests of writing the cell list and cell data
+	std::array<MPI_Request, 2> save_requests{{MPI_REQUEST_NULL, MPI_REQUEST_NULL}};
+	// local cells and their data offsets in file being saved
+	std::vector<uint64_t> save_cells_and_data_displacements;
+	// copy of local cell data being saved
+	std::vector<uint8_t> save_cell_data;
+	// start of file being saved and end of data written by this process
+	uint64_t save_file_start = 0, save_file_end = 0;
+	// checksums of data written into file being saved
+	File_Checksums save_checksums;
+	// whether file being saved without checksums ended with old checksums
+	bool remove_old_checksums = false;
+
+	// number of processes writing cell data in save_grid_data(), 0 == all
+	int save_aggregators = 0;
+	// alignment of file ranges written by aggregators
+	uint64_t save_stripe_size = uint64_t(1) << 20;
+
+	// compresses cell data in save_grid_data() if not null
+	std::shared_ptr<const Checkpoint_Codec> checkpoint_codec;
+	// maximum uncompressed size of compressed blocks
+	uint64_t checkpoint_block_size = uint64_t(1) << 20;
+
+	// codec of compressed file being loaded, null if file isn't compressed
+	std::shared_ptr<const Checkpoint_Codec> loading_codec;
+	// index of compressed blocks of file being loaded
+	std::vector<std::array<uint64_t, 4>> loading_blocks;
+	// decompressed blocks of file being loaded
+	std::unordered_map<uint64_t, std::vector<uint8_t>> loaded_blocks;
+
+	// whether saved files end with checksums which are verified when loading
+	bool checkpoint_checksums = false;
+	// whether checksums of saved files are verified by reading them back
+	bool checkpoint_checksum_readback = false;
+	// end of grid data in file being loaded, excludes checksums
+	uint64_t loading_data_end = 0;
+
+	// whether full saves record hashes for save_grid_data_delta()
+	bool delta_checkpoints = false;
+	// whether cell_hashes were recorded by a full save
+	bool delta_base_saved = false;
+	// whether delta file has been truncated after last full save
+	bool delta_file_started = false;
+	// hashes of local cells' data at previous save
+	std::unordered_map<uint64_t, uint64_t> cell_hashes;
+	// total number of cells and sum of hashes of their ids at last full save
+	std::array<uint64_t, 2> delta_base_cells{{0, 0}};
+
+	// starts every record in files written by save_grid_data_delta()
+	static constexpr uint64_t delta_record_marker = 0xdcc0de17a5a7e001;
+
+	// file of delta records being loaded
+	MPI_File delta_data_file;
+	bool delta_data_file_open = false;
+	// local cells and their data offsets of every delta record being loaded
+	std::vector<std::vector<std::pair<uint64_t, uint64_t>>> delta_records;
+
+	// part of file written by one process
+	struct File_Piece {
+		uint64_t offset;
+		const uint8_t* data;
+		uint64_t size;
+	};
+
+
+
+
+	/*!
+	Writes given header and data needed by load_grid_data() before the list of cells.
+
+	Writes into given file starting at given offset which is moved
+	to where the list of cells starts, only process 0 writes.
+	Without checkpoint checksums process 0 also checks whether the
+	file ends with checksums of a previously saved grid, which
+	finish_grid_file() then removes.
+	Stores the total number of cells in the grid into total_number_of_cells
+	which is written into the file unless compressed == true in which
+	case compressed_cells_marker is written instead.
+
+	Must be called simultaneously on all processes.
+	\see save_grid_data()
+	*/
+	bool write_grid_metadata(
+		MPI_File& outfile,
+		const std::string& name,
+		MPI_Offset& offset,
+		std::tuple<void*, int, MPI_Datatype> header,
+		uint64_t& total_number_of_cells,
+		const bool compressed = false
+	) {
+		int ret_val = -1;
+
+		// process 0 writes user's header
+		if (this->rank == 0) {
+
+			// checksums of a previous file must be removed if not writing new ones
+			int old_checksums = 0;
+			if (not this->checkpoint_checksums) {
+				MPI_File old_file;
+				if (
+					MPI_File_open(
+						MPI_COMM_SELF,
+						const_cast<char*>(name.c_str()),
+						MPI_MODE_RDONLY,
+						MPI_INFO_NULL,
+						&old_file
+					) == MPI_SUCCESS
+				) {
+					old_checksums = File_Checksums().read(old_file) ? 1 : 0;
+					MPI_File_close(&old_file);
+				}
+			}
+
+			MPI_Datatype header_type = std::get<2>(header);
+
+			if (!Is_Named_Datatype()(header_type)) {
+				ret_val = MPI_Type_commit(&header_type);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< "Process " << this->rank
+						<< " Couldn't commit header datatype: "
+						<< Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+			}
+
+			ret_val = MPI_File_write_at(
+				outfile,
+				offset,
+				std::get<0>(header),
+				std::get<1>(header),
+				header_type,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write header to file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+
+			// everyone moves the offset by header size
+			int header_size = 0;
+			if (MPI_Type_size(header_type, &header_size) != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
+				return false;
+			}
+			header_size *= std::get<1>(header);
+
+			std::array<int, 2> header_size_and_old_checksums{{header_size, old_checksums}};
+			ret_val = MPI_Bcast(header_size_and_old_checksums.data(), 2, MPI_INT, 0, this->comm);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't send header size: " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+			offset += (MPI_Offset) header_size;
+			this->remove_old_checksums = old_checksums > 0;
+
+			if (!Is_Named_Datatype()(header_type)) {
+				ret_val = MPI_Type_free(&header_type);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't free header datatype: "
+						<< Error_String()(ret_val)
+						<< std::endl;
+					return false;
+				}
+			}
+
+		} else {
+			std::array<int, 2> header_size_and_old_checksums{{0, 0}};
+			ret_val = MPI_Bcast(header_size_and_old_checksums.data(), 2, MPI_INT, 0, this->comm);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " couldn't receive header size: " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+			offset += (MPI_Offset) header_size_and_old_checksums[0];
+			this->remove_old_checksums = header_size_and_old_checksums[1] > 0;
+		}
+
+		// write endianness check
+		if (this->rank == 0) {
+
+			uint64_t endianness_check = 0x1234567890abcdef;
+
+			ret_val = MPI_File_write_at(
+				outfile,
+				offset,
+				(void*) &endianness_check,
+				1,
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write endianness check to file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+		}
+		offset += sizeof(uint64_t);
+
+		/*
+		Write data needed for initialization.
+		*/
+
+		// write mapping data
+		if (this->rank == 0) {
+			if (!this->mapping.write(outfile, offset)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't write mapping to file " << name
+					<< std::endl;
+				return false;
+			}
+		}
+		offset += this->mapping.data_size();
+
+		// write length of each cell's neighborhood
+		if (this->rank == 0) {
+			ret_val = MPI_File_write_at(
+				outfile,
+				offset,
+				(void*) &(this->neighborhood_length),
+				1,
+				MPI_UNSIGNED,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write neighborhood length to file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+		}
+		offset += sizeof(unsigned int);
+
+		// write periodicity data
+		if (this->rank == 0) {
+			if (!this->topology.write(outfile, offset)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write topology into file " << name
+					<< std::endl;
+				return false;
+			}
+		}
+		offset += this->topology.data_size();
+
+		// write geometry data
+		if (this->rank == 0) {
+			size_t written = this->geometry.write(outfile, offset);
+			if (written == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write geometry to file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+		}
+		offset += this->geometry.data_size();
+
+		// write the total number of cells that will be written
+		const uint64_t number_of_cells = this->cell_data.size();
+		total_number_of_cells = All_Reduce()(number_of_cells, this->comm);
+
+		if (this->rank == 0) {
+			const uint64_t number_of_cells_item
+				= compressed ? uint64_t(compressed_cells_marker) : total_number_of_cells;
+			ret_val = MPI_File_write_at(
+				outfile,
+				offset,
+				(void*) &number_of_cells_item,
+				1,
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write cell list to file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+		}
+		offset += sizeof(uint64_t);
+
+		return true;
+	}
+
+
+	/*!
+	Cleans up after start_saving_grid_data() failed after opening the file.
+
+	Waits for writes that were already started, frees buffers
+	and closes the file so that saving can be started again.
+	Returns false.
+
+	Must be called simultaneously on all processes.
+	*/
+	bool cancel_saving_grid_data()
 	{
-		if (this->reserved_options.count(name) > 0) {
-			throw std::invalid_argument(
-				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
-				+ "Option " + name + " is reserved for dccrg"
+		for (auto& request: this->save_requests) {
+			if (request != MPI_REQUEST_NULL) {
+				MPI_Wait(&request, MPI_STATUS_IGNORE);
+			}
+		}
+
+		this->save_cells_and_data_displacements.clear();
+		this->save_cells_and_data_displacements.shrink_to_fit();
+		this->save_cell_data.clear();
+		this->save_cell_data.shrink_to_fit();
+
+		MPI_File_close(&(this->save_file));
+		this->saving_grid_data = false;
+
+		return false;
+	}
+
+
+	/*!
+	Copies local cell data for saving into packed_data.
+
+	Stores local cells and offsets of their data in file into
+	cells_and_data_displacements in the format of save_grid_data().
+	Given offset is where the list of cells starts in file and where
+	local part of the list and cell data start is stored into
+	cell_list_start and cell_data_start.
+
+	Must be called simultaneously on all processes.
+	\see start_saving_grid_data()
+	*/
+	bool pack_saved_cells(
+		const MPI_Offset offset,
+		const uint64_t total_number_of_cells,
+		std::vector<uint64_t>& cells_and_data_displacements,
+		std::vector<uint8_t>& packed_data,
+		uint64_t& cell_list_start,
+		uint64_t& cell_data_start
+	) {
+		int ret_val = -1;
+
+		const std::vector<uint64_t> cells_to_write = this->get_cells();
+		const uint64_t number_of_cells = cells_to_write.size();
+
+		// copy local cell data in the order of cells_to_write
+		std::vector<uint64_t> cell_sizes(number_of_cells, 0);
+		packed_data.clear();
+		// each cell is packed separately so total can exceed INT_MAX
+		uint64_t packed_size = 0;
+		for (size_t i = 0; i < number_of_cells; i++) {
+			const uint64_t cell = cells_to_write[i];
+
+			void* address = NULL;
+			int count = -1;
+			MPI_Datatype datatype = MPI_DATATYPE_NULL;
+			std::tie(
+				address,
+				count,
+				datatype
+			) = detail::get_cell_mpi_datatype(
+				this->cell_data.at(cell),
+				cell,
+				(int) this->rank,
+				-1,
+				false,
+				-1
+			);
+
+			if (!Is_Named_Datatype()(datatype)) {
+				ret_val = MPI_Type_commit(&datatype);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't commit datatype of cell " << cell
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+			}
+
+			int datatype_size = 0, pack_size = 0;
+			if (
+				MPI_Type_size(datatype, &datatype_size) != MPI_SUCCESS
+				or MPI_Pack_size(count, datatype, this->comm, &pack_size) != MPI_SUCCESS
+			) {
+				std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
+				abort();
+			}
+			cell_sizes[i] = uint64_t(datatype_size) * uint64_t(count);
+			packed_data.resize(size_t(packed_size + uint64_t(pack_size)));
+
+			int position = 0;
+			ret_val = MPI_Pack(
+				address,
+				count,
+				datatype,
+				packed_data.data() + packed_size,
+				pack_size,
+				&position,
+				this->comm
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " MPI_Pack failed for cell " << cell
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+			if (uint64_t(position) != cell_sizes[i]) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Packed size of cell " << cell
+					<< " (" << position
+					<< ") differs from its size in memory (" << cell_sizes[i]
+					<< ")"
+					<< std::endl;
+				abort();
+			}
+
+			if (!Is_Named_Datatype()(datatype)) {
+				ret_val = MPI_Type_free(&datatype);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't free datatype of cell " << cell
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+			}
+			packed_size += uint64_t(position);
+		}
+		packed_data.resize(size_t(packed_size));
+
+		// find out where local cells and their data start in file
+		std::array<uint64_t, 2> local_counts{{number_of_cells, packed_size}};
+		std::vector<uint64_t> all_counts(2 * this->comm_size, 0);
+		ret_val = MPI_Allgather(
+			local_counts.data(),
+			2,
+			MPI_UINT64_T,
+			all_counts.data(),
+			2,
+			MPI_UINT64_T,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " MPI_Allgather failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		cell_list_start = (uint64_t) offset;
+		cell_data_start = (uint64_t) offset + 2 * total_number_of_cells * sizeof(uint64_t);
+		for (size_t i = 0; i < (size_t) this->rank; i++) {
+			cell_list_start += all_counts[2 * i] * 2 * sizeof(uint64_t);
+			cell_data_start += all_counts[2 * i + 1];
+		}
+
+		cells_and_data_displacements.assign(2 * number_of_cells, 0);
+		uint64_t current_byte_offset = cell_data_start;
+		for (size_t i = 0; i < number_of_cells; i++) {
+			cells_and_data_displacements[2 * i] = cells_to_write[i];
+			cells_and_data_displacements[2 * i + 1] = current_byte_offset;
+			current_byte_offset += cell_sizes[i];
+		}
+
+		return true;
+	}
+
+
+	/*!
+	Writes given pieces of all processes into file via save aggregators.
+
+	All processes must give the same number of pieces and pieces of
+	all processes must cover a contiguous range of file without gaps.
+	The range is split into save_aggregators domains whose boundaries
+	are multiples of save_stripe_size, which are sent to and written
+	by aggregators in windows of 64 stripes, also starting at multiples
+	of stripe size except at the beginning of the range.
+	Data is sent in a duplicate of the grid's communicator.
+
+	Must be called simultaneously on all processes.
+	\see set_save_aggregators()
+	*/
+	void write_aggregated(
+		MPI_File& file,
+		const std::vector<File_Piece>& pieces
+	) {
+		const size_t N = pieces.size();
+
+		// offsets and sizes of every process' pieces
+		std::vector<uint64_t> local_pieces(2 * N, 0);
+		for (size_t i = 0; i < N; i++) {
+			local_pieces[2 * i] = pieces[i].offset;
+			local_pieces[2 * i + 1] = pieces[i].size;
+		}
+		std::vector<uint64_t> all_pieces(2 * N * this->comm_size, 0);
+		int ret_val = MPI_Allgather(
+			local_pieces.data(),
+			int(2 * N),
+			MPI_UINT64_T,
+			all_pieces.data(),
+			int(2 * N),
+			MPI_UINT64_T,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " MPI_Allgather failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		uint64_t begin = std::numeric_limits<uint64_t>::max(), end = 0;
+		for (size_t i = 0; i < all_pieces.size(); i += 2) {
+			if (all_pieces[i + 1] > 0) {
+				begin = std::min(begin, all_pieces[i]);
+				end = std::max(end, all_pieces[i] + all_pieces[i + 1]);
+			}
+		}
+		if (end <= begin) {
+			return;
+		}
+
+		/*
+		Domain i of aggregators is [domain_starts[i], domain_starts[i + 1])
+		and starts at a stripe boundary, first domain before begin
+		has nothing to write.
+		*/
+		const uint64_t
+			aggregators = std::min(uint64_t(this->save_aggregators), this->comm_size),
+			stripe = this->save_stripe_size,
+			round_size = 64 * stripe,
+			aligned_begin = begin / stripe * stripe;
+		std::vector<uint64_t> domain_starts(aggregators + 1, end);
+		domain_starts[0] = aligned_begin;
+		for (uint64_t i = 1; i < aggregators; i++) {
+			const uint64_t start = aligned_begin + i * ((end - aligned_begin) / aggregators);
+			domain_starts[i] = std::max(
+				domain_starts[i - 1],
+				std::min(end, (start + stripe - 1) / stripe * stripe)
+			);
+		}
+
+		uint64_t rounds = 0;
+		for (uint64_t i = 0; i < aggregators; i++) {
+			rounds = std::max(
+				rounds,
+				(domain_starts[i + 1] - domain_starts[i] + round_size - 1) / round_size
 			);
 		}
 
-		Zoltan_Set_Param(this->zoltan, name.c_str(), value.c_str());
-		return *this;
+		// returns the part of aggregator's domain written in given round
+		const auto get_window = [&](const uint64_t aggregator, const uint64_t round) {
+			const uint64_t start = std::min(
+				domain_starts[aggregator + 1],
+				domain_starts[aggregator] + round * round_size
+			);
+			const uint64_t window_end = std::min(domain_starts[aggregator + 1], start + round_size);
+			return std::make_pair(std::min(window_end, std::max(begin, start)), window_end);
+		};
+
+		MPI_Comm comm;
+		ret_val = MPI_Comm_dup(this->comm, &comm);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't duplicate communicator: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		uint64_t local_aggregator = aggregators;
+		for (uint64_t i = 0; i < aggregators; i++) {
+			if (i * this->comm_size / aggregators == this->rank) {
+				local_aggregator = i;
+			}
+		}
+
+		std::vector<uint8_t> buffer;
+		std::vector<MPI_Request> requests;
+		for (uint64_t round = 0; round < rounds; round++) {
+			requests.clear();
+
+			std::pair<uint64_t, uint64_t> window{0, 0};
+			if (local_aggregator < aggregators) {
+				window = get_window(local_aggregator, round);
+				buffer.resize(window.second - window.first);
+				#ifdef DEBUG
+				if (
+					window.first < window.second
+					and window.first != begin
+					and window.first % stripe != 0
+				) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Window of aggregator doesn't start at a stripe boundary: "
+						<< window.first
+						<< std::endl;
+					abort();
+				}
+				#endif
+
+				for (uint64_t process = 0; process < this->comm_size; process++) {
+				for (size_t i = 0; i < N; i++) {
+					const uint64_t
+						piece_start = all_pieces[2 * (N * process + i)],
+						piece_end = piece_start + all_pieces[2 * (N * process + i) + 1],
+						first = std::max(piece_start, window.first),
+						last = std::min(piece_end, window.second);
+					if (first >= last) {
+						continue;
+					}
+
+					requests.push_back(MPI_REQUEST_NULL);
+					ret_val = MPI_Irecv(
+						buffer.data() + (first - window.first),
+						int(last - first),
+						MPI_BYTE,
+						int(process),
+						int(i),
+						comm,
+						&requests.back()
+					);
+					if (ret_val != MPI_SUCCESS) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " Process " << this->rank
+							<< " MPI_Irecv failed: " << Error_String()(ret_val)
+							<< std::endl;
+						abort();
+					}
+				}}
+			}
+
+			for (uint64_t aggregator = 0; aggregator < aggregators; aggregator++) {
+				const auto aggregator_window = get_window(aggregator, round);
+				for (size_t i = 0; i < N; i++) {
+					const uint64_t
+						first = std::max(pieces[i].offset, aggregator_window.first),
+						last = std::min(pieces[i].offset + pieces[i].size, aggregator_window.second);
+					if (pieces[i].size == 0 or first >= last) {
+						continue;
+					}
+
+					requests.push_back(MPI_REQUEST_NULL);
+					ret_val = MPI_Isend(
+						pieces[i].data + (first - pieces[i].offset),
+						int(last - first),
+						MPI_BYTE,
+						int(aggregator * this->comm_size / aggregators),
+						int(i),
+						comm,
+						&requests.back()
+					);
+					if (ret_val != MPI_SUCCESS) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " Process " << this->rank
+							<< " MPI_Isend failed: " << Error_String()(ret_val)
+							<< std::endl;
+						abort();
+					}
+				}
+			}
+
+			ret_val = MPI_Waitall(int(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " MPI_Waitall failed: " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+
+			if (buffer.size() > 0) {
+				ret_val = MPI_File_write_at(
+					file,
+					(MPI_Offset) window.first,
+					(void*) buffer.data(),
+					int(buffer.size()),
+					MPI_BYTE,
+					MPI_STATUS_IGNORE
+				);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't write aggregated data: " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+				buffer.clear();
+			}
+		}
+
+		MPI_Comm_free(&comm);
 	}
 
 
 	/*!
-	Adds a new level for hierarchial partitioning with each part having given number of processes.
+	Reads data of given cells from given file.
 
-	Assigns default partitioning options for the added level.
-	Does nothing if processes_per_part < 1.
+	Data of each cell is read starting at the offset in bytes
+	given with the cell which is moved past the data that was read.
+	Offsets must be in nondecreasing order.
 
-	\see
-	add_partitioning_option()
-	remove_partitioning_level()
-	set_partitioning_option()
+	Must be called simultaneously on all processes.
 	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& add_partitioning_level(const int processes)
-	{
-		if (processes < 1) {
-			throw std::invalid_argument(
-				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
-				+ "Must assign at least 1 process to hierarchial partitioning level"
+	bool read_cell_data(
+		MPI_File& file,
+		std::vector<std::pair<uint64_t, uint64_t>>& cells_and_offsets
+	) {
+		int ret_val = -1;
+
+		const uint64_t number_of_cells = cells_and_offsets.size();
+
+		// datatypes etc. of local cell data in memory
+		std::vector<void*> addresses(number_of_cells, NULL);
+		std::vector<int> counts(number_of_cells, -1);
+		std::vector<MPI_Datatype> mem_datatypes(number_of_cells, MPI_DATATYPE_NULL);
+		std::vector<MPI_Aint>
+			memory_displacements(number_of_cells, 0),
+			file_displacements(number_of_cells, 0);
+
+		// set file view representing local cell data
+		MPI_Datatype file_datatype;
+
+		if (number_of_cells == 0) {
+
+			MPI_Type_contiguous(0, MPI_BYTE, &file_datatype);
+
+		} else {
+
+			// get datatype info from local cells in memory
+			for (uint64_t i = 0; i < number_of_cells; i++) {
+				const uint64_t cell = cells_and_offsets[i].first;
+
+				std::tie(
+					addresses[i],
+					counts[i],
+					mem_datatypes[i]
+				) = detail::get_cell_mpi_datatype(
+					this->cell_data.at(cell),
+					cell,
+					-1,
+					(int) this->rank,
+					true,
+					-1
+				);
+			}
+
+			// padding is not included in the file so maybe use contiguous datatypes
+			std::vector<MPI_Datatype> file_datatypes(mem_datatypes.size(), MPI_DATATYPE_NULL);
+			for (size_t i = 0; i < mem_datatypes.size(); i++) {
+				MPI_Datatype& mem_datatype = mem_datatypes[i];
+
+				if (Is_Named_Datatype()(mem_datatype)) {
+
+					file_datatypes[i] = mem_datatype;
+
+				} else {
+
+					int size_in_bytes;
+					ret_val = MPI_Type_size(mem_datatypes[i], &size_in_bytes);
+					if (ret_val != MPI_SUCCESS) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " Process " << this->rank
+							<< " Couldn't get datatype size: "
+							<< Error_String()(ret_val)
+							<< std::endl;
+						abort();
+					}
+
+					ret_val =  MPI_Type_contiguous(size_in_bytes, MPI_BYTE, &(file_datatypes[i]));
+					if (ret_val != MPI_SUCCESS) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " Process " << this->rank
+							<< " Couldn't create contiguous datatype: "
+							<< Error_String()(ret_val)
+							<< std::endl;
+						abort();
+					}
+				}
+			}
+
+			// displacements for cell data in memory are relative to first cell's data
+			for (size_t i = 0; i < number_of_cells; i++) {
+				memory_displacements[i] = (uint8_t*) addresses[i] - (uint8_t*) addresses[0];
+			}
+
+			// displacements for cell data in file are relative to start of file
+			for (uint64_t i = 0; i < number_of_cells; i++) {
+				file_displacements[i] = cells_and_offsets[i].second;
+
+				// move cell data offsets in case this function is called again
+				int size_in_bytes;
+				ret_val = MPI_Type_size(mem_datatypes[i], &size_in_bytes);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't get datatype size: "
+						<< Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+
+				cells_and_offsets[i].second += uint64_t(size_in_bytes) * uint64_t(counts[i]);
+			}
+
+			ret_val = MPI_Type_create_struct(
+				number_of_cells,
+				&counts[0],
+				&file_displacements[0],
+				&file_datatypes[0],
+				&file_datatype
 			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't create datatype for file view: "<< Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
+
+		ret_val = MPI_Type_commit(&file_datatype);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't commit datatype for file view: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		ret_val = MPI_File_set_view(
+			file,
+			0,
+			MPI_BYTE,
+			file_datatype,
+			const_cast<char*>("native"),
+			MPI_INFO_NULL
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't set file view for cell data: "
+				<< Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		// create a datatype representing local cell data in memory
+		MPI_Datatype memory_datatype;
+
+		if (number_of_cells == 0) {
+
+			MPI_Type_contiguous(0, MPI_BYTE, &memory_datatype);
+			if (MPI_Type_commit(&memory_datatype) != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't commit datatype for file view"
+					<< std::endl;
+				abort();
+			}
+
+		} else {
+
+			if (MPI_Type_create_struct(
+				number_of_cells,
+				&counts[0],
+				&memory_displacements[0],
+				&mem_datatypes[0],
+				&memory_datatype) != MPI_SUCCESS
+			) {
+				std::cerr << "Process " << this->rank
+					<< " Couldn't create datatype for local cells"
+					<< std::endl;
+				abort();
+			}
+
+			if (MPI_Type_commit(&memory_datatype) != MPI_SUCCESS) {
+				std::cerr << "Process " << this->rank
+					<< " Couldn't commit datatype for file view"
+					<< std::endl;
+				abort();
+			}
+		}
+
+		// give a valid buffer to ...read_at_all even if no cells to read
+		if (number_of_cells == 0) {
+			addresses.push_back((void*) &number_of_cells);
+		}
+
+		ret_val = MPI_File_read_at_all(
+			file,
+			0,
+			addresses[0],
+			1,
+			memory_datatype,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " couldn't read local cell data: "
+				<< Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+
+		/*
+		Deallocate datatypes
+		*/
+
+		ret_val = MPI_Type_free(&memory_datatype);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't free datatype for cell data in memory: "
+				<< Error_String()(ret_val)
+				<< std::endl;
+			return false;
 		}
 
-		this->processes_per_part.push_back(processes);
+		ret_val = MPI_Type_free(&file_datatype);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't free datatype for cell data in file: "
+				<< Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
 
-		// create default partitioning options for the level
-		std::unordered_map<std::string, std::string> default_load_balance_options;
-		default_load_balance_options["LB_METHOD"] = "HYPERGRAPH";
-		default_load_balance_options["PHG_CUT_OBJECTIVE"] = "CONNECTIVITY";
-		this->partitioning_options.push_back(default_load_balance_options);
-		return *this;
+		for(MPI_Datatype& datatype: mem_datatypes) {
+			if (!Is_Named_Datatype()(datatype)) {
+				ret_val = MPI_Type_free(&datatype);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't free user defined datatype: "
+						<< Error_String()(ret_val)
+						<< std::endl;
+					return false;
+				}
+			}
+		}
+
+		return true;
 	}
 
 
 	/*!
-	Rremoves the given hierarhchial partitioning level.
-
-	Level numbering starts from 0.
-	Does nothing if given level doesn't exist.
-
-	\see
-	add_partitioning_level()
+	Records hashes of local cells' data and starts a new chain of delta records.
 	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& remove_partitioning_level(const int hierarchial_partitioning_level)
+	bool start_delta_chain()
 	{
-		if (hierarchial_partitioning_level < 0
-		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
-			return *this;
+		if (!this->update_cell_hashes(this->delta_base_cells)) {
+			return false;
 		}
-
-		this->processes_per_part.erase(
-			this->processes_per_part.begin() + hierarchial_partitioning_level
-		);
-		this->partitioning_options.erase(
-			this->partitioning_options.begin() + hierarchial_partitioning_level
-		);
-		return *this;
+		this->delta_base_saved = true;
+		this->delta_file_started = false;
+		return true;
 	}
 
 
 	/*!
-	Adds (or overwrites) the given option and its value for
-	hierarchial partitioning of given level.
+	Hashes data of local cells and finds cells whose data changed.
 
-	Level numbering starts from 0.
-	Does nothing in the following cases:
-		- option name is one of: RETURN_LISTS, ...
-		- given level doesn't exist
+	Cell data is packed as in save_grid_data(), hashes of cells'
+	packed data replace hashes of previous call. If given, cells
+	whose hash changed or didn't exist are appended to
+	changed_cells_and_sizes as pairs of cell id and number of
+	bytes of packed data and their data to changed_data.
+	Total number of cells in the grid and sum of hashes of their
+	ids are stored in hashed_cells for detecting refined and
+	unrefined cells.
 
-	\see
-	remove_partitioning_option()
-	add_partitioning_level()
+	Must be called simultaneously on all processes.
 	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& add_partitioning_option(
-		const int hierarchial_partitioning_level,
-		const std::string name,
-		const std::string value
+	bool update_cell_hashes(
+		std::array<uint64_t, 2>& hashed_cells,
+		std::vector<uint64_t>* const changed_cells_and_sizes = nullptr,
+		std::vector<uint8_t>* const changed_data = nullptr
 	) {
-		if (hierarchial_partitioning_level < 0
-		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
-			return *this;
+		std::vector<uint64_t> cells_and_data_displacements;
+		std::vector<uint8_t> packed_data;
+		uint64_t cell_list_start = 0, cell_data_start = 0;
+		if (
+			!this->pack_saved_cells(
+				0,
+				0,
+				cells_and_data_displacements,
+				packed_data,
+				cell_list_start,
+				cell_data_start
+			)
+		) {
+			return false;
 		}
 
-		if (this->reserved_options.count(name) > 0) {
-			throw std::invalid_argument(
-				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
-				+ "Option " + name + " is reserved for dccrg"
+		std::unordered_map<uint64_t, uint64_t> new_hashes;
+		const uint64_t number_of_cells = cells_and_data_displacements.size() / 2;
+		std::array<uint64_t, 2> local_cells{{number_of_cells, 0}};
+		for (uint64_t i = 0; i < number_of_cells; i++) {
+			const uint64_t
+				cell = cells_and_data_displacements[2 * i],
+				data_start = cells_and_data_displacements[2 * i + 1] - cell_data_start,
+				data_end
+					= (i + 1 < number_of_cells)
+					? cells_and_data_displacements[2 * (i + 1) + 1] - cell_data_start
+					: packed_data.size();
+
+			// 64-bit FNV-1a
+			uint64_t hash = 0xcbf29ce484222325;
+			for (uint64_t j = data_start; j < data_end; j++) {
+				hash = (hash ^ packed_data[j]) * 0x100000001b3;
+			}
+			new_hashes[cell] = hash;
+
+			// splitmix64 finalizer, sum doesn't depend on cell order or owners
+			uint64_t id_hash = cell;
+			id_hash = (id_hash ^ (id_hash >> 30)) * 0xbf58476d1ce4e5b9;
+			id_hash = (id_hash ^ (id_hash >> 27)) * 0x94d049bb133111eb;
+			local_cells[1] += id_hash ^ (id_hash >> 31);
+
+			if (changed_cells_and_sizes == nullptr or changed_data == nullptr) {
+				continue;
+			}
+
+			const auto old_hash = this->cell_hashes.find(cell);
+			if (old_hash != this->cell_hashes.end() and old_hash->second == hash) {
+				continue;
+			}
+			changed_cells_and_sizes->push_back(cell);
+			changed_cells_and_sizes->push_back(data_end - data_start);
+			changed_data->insert(
+				changed_data->end(),
+				packed_data.begin() + data_start,
+				packed_data.begin() + data_end
 			);
 		}
+		this->cell_hashes = std::move(new_hashes);
 
-		this->partitioning_options[hierarchial_partitioning_level][name] = value;
-		return *this;
+		const int ret_val = MPI_Allreduce(
+			local_cells.data(),
+			hashed_cells.data(),
+			2,
+			MPI_UINT64_T,
+			MPI_SUM,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " MPI_Allreduce failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		return true;
 	}
 
 
 	/*!
-	Removes the given option from the given level of hierarchial partitioning.
+	Writes local cells and their data compressed with checkpoint_codec.
 
-	Level numbering starts from 0.
-	Does nothing if given level doesn't exist.
+	Given offset must be where the number of cells would be
+	written in an uncompressed file and must be preceded by
+	compressed_cells_marker. Written data is added to given
+	checksums and end of data written by this process is stored
+	into local_end.
 
-	\see
-	add_partitioning_option()
+	Must be called simultaneously on all processes.
+	\see set_checkpoint_codec()
 	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& remove_partitioning_option(
-		const int hierarchial_partitioning_level,
-		const std::string name
+	bool write_compressed_cells(
+		MPI_File& outfile,
+		const std::string& name,
+		MPI_Offset offset,
+		const uint64_t total_number_of_cells,
+		File_Checksums& checksums,
+		uint64_t& local_end
 	) {
-		if (hierarchial_partitioning_level < 0
-		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
-			return *this;
+		int ret_val = -1;
+
+		// cell data offsets are relative to start of uncompressed data
+		std::vector<uint64_t> cells_and_data_displacements;
+		std::vector<uint8_t> packed_data;
+		uint64_t cell_list_start = 0, cell_data_start = 0;
+		if (
+			!this->pack_saved_cells(
+				0,
+				0,
+				cells_and_data_displacements,
+				packed_data,
+				cell_list_start,
+				cell_data_start
+			)
+		) {
+			return false;
 		}
+		const uint64_t number_of_cells = cells_and_data_displacements.size() / 2;
 
-		this->partitioning_options[hierarchial_partitioning_level].erase(name);
-		return *this;
-	}
+		// compress blocks of whole cells
+		std::vector<uint64_t> block_index;
+		std::vector<uint8_t> compressed_data, compressed_block;
+		uint64_t block_start = 0;
+		for (uint64_t i = 0; i < number_of_cells; i++) {
+			const uint64_t cell_end
+				= (i + 1 < number_of_cells)
+				? cells_and_data_displacements[2 * (i + 1) + 1] - cell_data_start
+				: packed_data.size();
 
+			const uint64_t next_cell_end
+				= (i + 2 < number_of_cells)
+				? cells_and_data_displacements[2 * (i + 2) + 1] - cell_data_start
+				: packed_data.size();
 
-	/*!
-	Returns the names of partitioning options for hierarchial partitioning at given level.
+			if (
+				i + 1 < number_of_cells
+				and next_cell_end - block_start <= this->checkpoint_block_size
+			) {
+				continue;
+			}
 
-	Returns nothing if given level doesn't exist.
-	*/
-	std::vector<std::string> get_partitioning_options(const int hierarchial_partitioning_level) const
-	{
-		std::vector<std::string> partitioning_options;
+			const uint64_t block_size = cell_end - block_start;
+			compressed_block.clear();
+			this->checkpoint_codec->compress(
+				packed_data.data() + block_start,
+				size_t(block_size),
+				compressed_block
+			);
 
-		if (hierarchial_partitioning_level < 0
-		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
-			return partitioning_options;
+			block_index.push_back(compressed_data.size());
+			if (compressed_block.size() < block_size) {
+				block_index.push_back(compressed_block.size());
+				compressed_data.insert(compressed_data.end(), compressed_block.begin(), compressed_block.end());
+			} else {
+				block_index.push_back(block_size);
+				compressed_data.insert(
+					compressed_data.end(),
+					packed_data.begin() + block_start,
+					packed_data.begin() + cell_end
+				);
+			}
+			block_index.push_back(cell_data_start + block_start);
+			block_index.push_back(block_size);
+
+			block_start = cell_end;
 		}
+		packed_data.clear();
+		packed_data.shrink_to_fit();
 
-		for (std::unordered_map<std::string, std::string>::const_iterator
-			option = this->partitioning_options.at(hierarchial_partitioning_level).begin();
-			option != this->partitioning_options.at(hierarchial_partitioning_level).end();
-			option++
+		if (
+			compressed_data.size() > uint64_t(INT_MAX)
+			or cells_and_data_displacements.size() > uint64_t(INT_MAX)
+			or block_index.size() > uint64_t(INT_MAX)
 		) {
-			partitioning_options.push_back(option->first);
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Compressed cell data doesn't fit into an int number of items"
+				<< std::endl;
+			return false;
 		}
 
-		return partitioning_options;
-	}
-
-
-	/*!
-	Returns the value of given non-hierarchial partitioning option.
-
-	Returns an empty string if given option or given level doesn't exist.
-	*/
-	std::string get_partitioning_option_value(
-		const int hierarchial_partitioning_level,
-		const std::string name
-	) const {
-		std::string value;
-
-		if (hierarchial_partitioning_level < 0
-		|| hierarchial_partitioning_level >= int(this->processes_per_part.size())) {
-			return value;
+		// find out where local items start in file
+		const std::array<uint64_t, 3> local_counts{{
+			number_of_cells,
+			block_index.size() / 4,
+			compressed_data.size()
+		}};
+		std::vector<uint64_t> all_counts(3 * this->comm_size, 0);
+		ret_val = MPI_Allgather(
+			local_counts.data(),
+			3,
+			MPI_UINT64_T,
+			all_counts.data(),
+			3,
+			MPI_UINT64_T,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " MPI_Allgather failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
 		}
 
-		if (this->partitioning_options.at(hierarchial_partitioning_level).count(name) > 0) {
-			value = this->partitioning_options.at(hierarchial_partitioning_level).at(name);
+		uint64_t total_number_of_blocks = 0;
+		for (uint64_t i = 0; i < this->comm_size; i++) {
+			total_number_of_blocks += all_counts[3 * i + 1];
 		}
 
-		return value;
-	}
-
+		const uint64_t
+			header_start = uint64_t(offset),
+			cell_list_begin = header_start + 3 * sizeof(uint64_t),
+			block_index_begin = cell_list_begin + 2 * total_number_of_cells * sizeof(uint64_t),
+			compressed_data_begin = block_index_begin + 4 * total_number_of_blocks * sizeof(uint64_t);
 
-	/*!
-	Returns the process which has the given cell or -1 if the cell doesn't exist.
-	*/
-	int get_process(const uint64_t cell) const
-	{
-		if (this->cell_process.count(cell) == 0) {
-			return -1;
-		} else {
-			return this->cell_process.at(cell);
+		uint64_t
+			local_cell_list_start = cell_list_begin,
+			local_block_index_start = block_index_begin,
+			local_compressed_data_start = compressed_data_begin;
+		for (uint64_t i = 0; i < this->rank; i++) {
+			local_cell_list_start += 2 * all_counts[3 * i] * sizeof(uint64_t);
+			local_block_index_start += 4 * all_counts[3 * i + 1] * sizeof(uint64_t);
+			local_compressed_data_start += all_counts[3 * i + 2];
 		}
-	}
+		for (size_t i = 0; i < block_index.size(); i += 4) {
+			block_index[i] += local_compressed_data_start;
+		}
+		local_end = local_compressed_data_start + compressed_data.size();
 
+		if (this->rank == 0) {
+			const std::array<uint64_t, 3> compressed_header{{
+				this->checkpoint_codec->get_id(),
+				total_number_of_cells,
+				total_number_of_blocks
+			}};
+			ret_val = MPI_File_write_at(
+				outfile,
+				(MPI_Offset) header_start,
+				(void*) compressed_header.data(),
+				3,
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write compression header to file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+			checksums.add(
+				header_start,
+				(const uint8_t*) compressed_header.data(),
+				compressed_header.size() * sizeof(uint64_t)
+			);
+		}
 
-	/*!
-	Given cell is kept on this process during subsequent load balancing.
+		// give valid buffers to ...write_at_all even if nothing to write
+		const uint64_t dummy = error_cell;
+
+		const std::array<std::tuple<uint64_t, const void*, int, MPI_Datatype>, 3> writes{{
+			std::make_tuple(
+				local_cell_list_start,
+				number_of_cells > 0 ? (const void*) cells_and_data_displacements.data() : (const void*) &dummy,
+				int(cells_and_data_displacements.size()),
+				MPI_UINT64_T
+			),
+			std::make_tuple(
+				local_block_index_start,
+				block_index.size() > 0 ? (const void*) block_index.data() : (const void*) &dummy,
+				int(block_index.size()),
+				MPI_UINT64_T
+			),
+			std::make_tuple(
+				local_compressed_data_start,
+				compressed_data.size() > 0 ? (const void*) compressed_data.data() : (const void*) &dummy,
+				int(compressed_data.size()),
+				MPI_BYTE
+			)
+		}};
+		for (const auto& write: writes) {
+			const uint64_t item_size = (std::get<3>(write) == MPI_UINT64_T) ? sizeof(uint64_t) : 1;
+			checksums.add(
+				std::get<0>(write),
+				(const uint8_t*) std::get<1>(write),
+				uint64_t(std::get<2>(write)) * item_size
+			);
 
-	\see
-	pin(const uint64_t cell, const int process)
-	*/
-	bool pin(const uint64_t cell)
-	{
-		return this->pin(cell, this->rank);
+			ret_val = MPI_File_write_at_all(
+				outfile,
+				(MPI_Offset) std::get<0>(write),
+				const_cast<void*>(std::get<1>(write)),
+				std::get<2>(write),
+				std::get<3>(write),
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't write compressed cells to file " << name
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+		}
+
+		return true;
 	}
 
+
 	/*!
-	Given cell is sent to the given process and kept there during subsequent load balancing.
+	Prepares given checksums for data written into given file after its metadata.
 
-	Returns true on success, does nothing and returns false in the following cases:
-		- given cell doesn't exist
-		- given cell exists on another process
-		- given cell has children
-		- given process doesn't exist
+	Grid data starts at file_start and metadata written by
+	write_grid_metadata() ends at metadata_end. Process 0 reads
+	back the metadata it wrote, which is small and partly written
+	by geometry and other classes, and adds it to checksums.
+	Without checkpoint checksums data added to checksums is ignored.
 
-	\see
-	unpin()
-	pin(const uint64_t cell)
+	Must be called simultaneously on all processes.
+	\see finish_grid_file()
 	*/
-	bool pin(const uint64_t cell, const int process)
-	{
-		if (this->cell_process.count(cell) == 0) {
-			return false;
+	bool start_checksums(
+		MPI_File& file,
+		const uint64_t file_start,
+		const uint64_t metadata_end,
+		File_Checksums& checksums
+	) {
+		checksums = File_Checksums();
+		if (not this->checkpoint_checksums) {
+			return true;
 		}
+		checksums.start = file_start;
+		checksums.block_size = this->checkpoint_block_size;
 
-		if (this->cell_process.at(cell) != this->rank) {
-			return false;
+		if (this->rank != 0 or metadata_end <= file_start) {
+			return true;
 		}
 
-		if (cell != this->get_child(cell)) {
+		std::vector<uint8_t> metadata(metadata_end - file_start);
+		const int ret_val = MPI_File_read_at(
+			file,
+			MPI_Offset(file_start),
+			(void*) metadata.data(),
+			int(metadata.size()),
+			MPI_BYTE,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't read back grid metadata: " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
+		checksums.add(file_start, metadata.data(), metadata.size());
 
-		if (process < 0 || process >= (int) this->comm_size) {
-			return false;
-		}
+		return true;
+	}
 
-		// do nothing if the request already exists
-		if (this->pin_requests.count(cell) > 0
-		&& (int) this->pin_requests.at(cell) == process) {
-			return true;
-		}
 
-		this->new_pin_requests[cell] = (uint64_t) process;
+	/*!
+	Adds cell data given as in save_grid_data() to given checksums.
 
-		return true;
+	Packs data of each cell to get its bytes as written into file.
+	*/
+	void add_cells_to_checksums(
+		const std::vector<void*>& addresses,
+		const std::vector<int>& counts,
+		std::vector<MPI_Datatype>& datatypes,
+		const std::vector<MPI_Aint>& file_displacements,
+		File_Checksums& checksums
+	) {
+		std::vector<uint8_t> packed_data;
+		for (size_t i = 0; i < addresses.size(); i++) {
+			if (!Is_Named_Datatype()(datatypes[i])) {
+				const int ret_val = MPI_Type_commit(&datatypes[i]);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't commit datatype of cell data: "
+						<< Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+			}
+
+			int pack_size = 0;
+			if (MPI_Pack_size(counts[i], datatypes[i], this->comm, &pack_size) != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
+				abort();
+			}
+			packed_data.resize(size_t(pack_size));
+
+			int position = 0;
+			const int ret_val = MPI_Pack(
+				addresses[i],
+				counts[i],
+				datatypes[i],
+				packed_data.data(),
+				pack_size,
+				&position,
+				this->comm
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " MPI_Pack failed: " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+
+			checksums.add(uint64_t(file_displacements[i]), packed_data.data(), uint64_t(position));
+		}
 	}
 
+
 	/*!
-	Allows the given cell to be moved to another process during subsequent load balancing.
+	Writes checksums of saved grid data into given file if enabled.
 
-	Returns true on success, does nothing and returns false in the following cases:
-		- given cell has children
-		- given cell doesn't exist
-		- given cell exists on another process
+	Data starts at file_start and local_end is the end of
+	data written by this process. Checksums are combined
+	from given checksums of written data and compared with
+	checksums of the file read back if that is enabled.
+	Without checksums does nothing unless the file ended with
+	checksums of a previously saved grid before saving, in which
+	case the file is truncated to the end of data so they
+	don't remain in it.
 
-	\see
-	unpin_local_cells()
-	pin(const uint64_t cell)
+	Must be called simultaneously on all processes.
+	\see set_checkpoint_checksums()
 	*/
-	bool unpin(const uint64_t cell)
-	{
-		if (this->cell_process.count(cell) == 0) {
-			return false;
+	bool finish_grid_file(
+		MPI_File& file,
+		const uint64_t file_start,
+		const uint64_t local_end,
+		File_Checksums& checksums
+	) {
+		if (not this->checkpoint_checksums and not this->remove_old_checksums) {
+			return true;
 		}
 
-		if (this->cell_process.at(cell) != this->rank) {
+		uint64_t data_end = 0;
+		int ret_val = MPI_Allreduce(
+			&local_end,
+			&data_end,
+			1,
+			MPI_UINT64_T,
+			MPI_MAX,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " MPI_Allreduce failed: " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
 
-		if (cell != this->get_child(cell)) {
+		// cell data might have been written through a view
+		ret_val = MPI_File_set_view(
+			file,
+			0,
+			MPI_BYTE,
+			MPI_BYTE,
+			const_cast<char*>("native"),
+			MPI_INFO_NULL
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << this->rank
+				<< " Couldn't reset file view: " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
 
-		if (this->pin_requests.count(cell) > 0) {
-			// non-existing process means unpin
-			this->new_pin_requests[cell] = this->comm_size;
-		} else {
-			this->new_pin_requests.erase(cell);
+		if (not this->checkpoint_checksums) {
+			MPI_Offset file_size = 0;
+			ret_val = MPI_File_get_size(file, &file_size);
+			if (ret_val == MPI_SUCCESS and uint64_t(file_size) > data_end) {
+				ret_val = MPI_File_set_size(file, MPI_Offset(data_end));
+			}
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " Couldn't truncate file: " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+			return true;
 		}
 
-		return true;
-	}
-
-	/*!
-	Executes unpin(cell) for all cells on this process.
-
-	Returns true if all unpins succeeded, false otherwise.
-
-	TODO: only execute for cells that are pinned
-
-	\see
-	unpin()
-	*/
-	bool unpin_local_cells()
-	{
-		#ifdef DEBUG
-		// check that all child cells on this process are also in this->cell_data.
-		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
-			i = this->cell_process.begin();
-			i != this->cell_process.end();
-			i++
-		) {
-			const uint64_t cell = i->first;
+		checksums.start = file_start;
+		checksums.end = data_end;
+		checksums.block_size = this->checkpoint_block_size;
+		if (not checksums.calculate_from_parts(file, this->comm)) {
+			return false;
+		}
 
-			if (this->cell_process.at(cell) != this->rank) {
-				continue;
+		if (this->checkpoint_checksum_readback) {
+			File_Checksums read_back = checksums;
+			if (not read_back.calculate(file, this->comm)) {
+				return false;
 			}
 
-			if (cell == this->get_child(cell)) {
-				if (this->cell_data.count(cell) == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << cell
-						<< " should be in this->cell_data of process " << this->rank
-						<< std::endl;
-					abort();
+			uint64_t bad_blocks = 0;
+			for (size_t i = 0; i < checksums.checksums.size(); i++) {
+				if (read_back.checksums[i] != checksums.checksums[i]) {
+					bad_blocks++;
 				}
-			} else {
-				if (this->cell_data.count(cell) > 0) {
+			}
+			if (bad_blocks > 0) {
+				if (this->rank == 0) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << cell
-						<< " shouldn't be in this->cell_data of process " << this->rank
+						<< " Checksums of " << bad_blocks
+						<< " blocks read back from file differ from written data"
 						<< std::endl;
-					abort();
 				}
+				return false;
 			}
 		}
-		#endif
-
-		bool ret_val = true;
-		for (const auto& item: this->cell_data) {
-			if (!this->unpin(item.first)) {
-				ret_val = false;
-			}
-		}
-
-		return ret_val;
-	}
 
-	/*!
-	All cells in the grid are free to move between processes.
-
-	Must be called simultaneously on all processes.
-
-	\see
-	unpin()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& unpin_all_cells()
-	{
-		this->new_pin_requests.clear();
-		this->pin_requests.clear();
-		return *this;
+		return checksums.write(file, this->comm);
 	}
 
 
 	/*!
-	Returns cells that are on the local process boundary.
-
-	Returns cells for which either of the following is true:
-		- a cell on another process is considered as a neighbor
-		- are considered as a neighbor by a cell on another process
+	Reads header and block index of compressed file being loaded.
 
-	Given neighborhood is used when considering neighbor relations.
+	Given offset must be just after compressed_cells_marker and
+	is moved to the start of list of cells, into total_number_of_cells
+	is stored the number of cells in the file.
 
-	By default returned cells are in random order but if sorted == true
-	they are sorted using std::sort before returning.
+	Must be called simultaneously on all processes.
+	*/
+	bool read_compressed_header(
+		const std::string& name,
+		MPI_Offset& offset,
+		uint64_t& total_number_of_cells
+	) {
+		std::array<uint64_t, 3> compressed_header{{0, 0, 0}};
+		int ret_val = MPI_File_read_at_all(
+			this->grid_data_file,
+			offset,
+			compressed_header.data(),
+			3,
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't read compression header from file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+		offset += 3 * sizeof(uint64_t);
 
-	Returns nothing if neighborhood with given id doesn't exist.
+		const uint64_t
+			codec_id = compressed_header[0],
+			total_number_of_blocks = compressed_header[2];
+		total_number_of_cells = compressed_header[1];
 
-	\see get_cells() is more general than this but slower.
-	*/
-	std::vector<uint64_t> get_local_cells_on_process_boundary(
-		const int neighborhood_id = default_neighborhood_id,
-		const bool sorted = false
-	) const {
-		std::vector<uint64_t> ret_val;
+		if (this->checkpoint_codec and this->checkpoint_codec->get_id() == codec_id) {
+			this->loading_codec = this->checkpoint_codec;
+		} else if (not this->checkpoint_codec and codec_id == Shuffle_LZ_Codec().get_id()) {
+			this->loading_codec = std::make_shared<Shuffle_LZ_Codec>();
+		} else {
+			if (this->rank == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " File " << name << " is compressed with codec " << codec_id
+					<< ", set a codec with that id with set_checkpoint_codec()"
+					<< std::endl;
+			}
+			return false;
+		}
 
-		if (neighborhood_id == default_neighborhood_id) {
-			ret_val.insert(
-				ret_val.end(),
-				this->local_cells_on_process_boundary.begin(),
-				this->local_cells_on_process_boundary.end()
-			);
-		} else if (this->user_hood_of.count(neighborhood_id) > 0) {
-			ret_val.insert(
-				ret_val.end(),
-				this->user_local_cells_on_process_boundary.at(neighborhood_id).begin(),
-				this->user_local_cells_on_process_boundary.at(neighborhood_id).end()
-			);
+		if (4 * total_number_of_blocks > uint64_t(INT_MAX)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Too many compressed blocks in file " << name
+				<< ": " << total_number_of_blocks
+				<< std::endl;
+			return false;
 		}
 
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
+		this->loading_blocks.resize(total_number_of_blocks);
+		ret_val = MPI_File_read_at_all(
+			this->grid_data_file,
+			offset + MPI_Offset(2 * total_number_of_cells * sizeof(uint64_t)),
+			(void*) this->loading_blocks.data(),
+			int(4 * total_number_of_blocks),
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't read index of compressed blocks from file " << name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
 		}
 
-		return ret_val;
+		return true;
 	}
 
 
 	/*!
-	Returns cells that are not on the local process boundary.
-
-	Returns cells which do not consider a cell on another process
-	as a neighbor and which are not considered as a neighbor
-	by a cell on another process.
-
-	By default returned cells are in random order but if sorted == true
-	they are sorted using std::sort before returning.
+	Version of continue_loading_grid_data() for compressed files.
 
-	Returns nothing if neighborhood with given id doesn't exist.
-
-	\see get_cells() is more general than this but a bit slower.
+	Reads and decompresses blocks containing local cells
+	that haven't been decompressed yet and unpacks cell data
+	from them.
 	*/
-	std::vector<uint64_t> get_local_cells_not_on_process_boundary(
-		const int neighborhood_id = default_neighborhood_id,
-		const bool sorted = false
-	) const {
-		std::vector<uint64_t> ret_val;
+	bool continue_loading_compressed_cells()
+	{
+		int ret_val = -1;
 
-		if (neighborhood_id == default_neighborhood_id) {
+		std::vector<uint8_t> compressed_block;
+		for (auto& item: this->cells_and_data_displacements) {
+			const uint64_t cell = item.first;
 
-			for (const auto& item: this->cell_data) {
-				const uint64_t cell = item.first;
-				if (this->local_cells_on_process_boundary.count(cell) == 0) {
-					ret_val.push_back(cell);
+			// find block of cell, blocks are in order of uncompressed data
+			const auto block_iter = std::upper_bound(
+				this->loading_blocks.cbegin(),
+				this->loading_blocks.cend(),
+				item.second,
+				[](const uint64_t data_start, const std::array<uint64_t, 4>& block) {
+					return data_start < block[2];
 				}
+			);
+			if (block_iter == this->loading_blocks.cbegin()) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " No compressed block for cell " << cell
+					<< std::endl;
+				return false;
 			}
+			const auto& block = *(block_iter - 1);
+			const uint64_t block_id = uint64_t(block_iter - 1 - this->loading_blocks.cbegin());
 
-		} else if (this->user_hood_of.count(neighborhood_id) > 0) {
-
-			for (const auto& item: this->cell_data) {
-				const uint64_t cell = item.first;
-				if (this->user_local_cells_on_process_boundary.at(neighborhood_id).count(cell) == 0) {
-					ret_val.push_back(cell);
+			if (this->loaded_blocks.count(block_id) == 0) {
+				if (block[1] > uint64_t(INT_MAX) or block[3] > uint64_t(INT_MAX)) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Compressed block " << block_id << " is too large"
+						<< std::endl;
+					return false;
 				}
-			}
-		}
-
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
-		}
-
-		return ret_val;
-	}
-
-
-	/*!
-	Returns remote cells that are on the local process boundary.
 
-	Returns cells for which either of the following is true:
-		- a local cell is considered as a neighbor
-		- are considered as a neighbor by a local cell
+				compressed_block.resize(block[1]);
+				ret_val = MPI_File_read_at(
+					this->grid_data_file,
+					(MPI_Offset) block[0],
+					(void*) compressed_block.data(),
+					int(block[1]),
+					MPI_BYTE,
+					MPI_STATUS_IGNORE
+				);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't read compressed block " << block_id
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					return false;
+				}
 
-	By default returned cells are in random order but if sorted == true
-	they are sorted using std::sort before returning.
+				auto& decompressed = this->loaded_blocks[block_id];
+				if (block[1] == block[3]) {
+					decompressed = compressed_block;
+				} else {
+					decompressed.resize(block[3]);
+					if (
+						not this->loading_codec->decompress(
+							compressed_block.data(),
+							compressed_block.size(),
+							decompressed.data(),
+							decompressed.size()
+						)
+					) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " Process " << this->rank
+							<< " Couldn't decompress block " << block_id
+							<< std::endl;
+						return false;
+					}
+				}
+			}
+			auto& decompressed = this->loaded_blocks.at(block_id);
 
-	Returns nothing if neighborhood with given id doesn't exist.
+			void* address = NULL;
+			int count = -1;
+			MPI_Datatype datatype = MPI_DATATYPE_NULL;
+			std::tie(
+				address,
+				count,
+				datatype
+			) = detail::get_cell_mpi_datatype(
+				this->cell_data.at(cell),
+				cell,
+				-1,
+				(int) this->rank,
+				true,
+				-1
+			);
 
-	\see get_cells() is more general than this but a bit slower.
-	*/
-	std::vector<uint64_t> get_remote_cells_on_process_boundary(
-		const int neighborhood_id = default_neighborhood_id,
-		const bool sorted = false
-	) const {
-		std::vector<uint64_t> ret_val;
+			if (!Is_Named_Datatype()(datatype)) {
+				ret_val = MPI_Type_commit(&datatype);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't commit datatype of cell " << cell
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+			}
 
-		if (neighborhood_id == default_neighborhood_id) {
-			ret_val.insert(
-				ret_val.end(),
-				this->remote_cells_on_process_boundary.begin(),
-				this->remote_cells_on_process_boundary.end()
-			);
-		} else if (this->user_hood_of.count(neighborhood_id) > 0) {
-			ret_val.insert(ret_val.end(),
-				this->user_remote_cells_on_process_boundary.at(neighborhood_id).begin(),
-				this->user_remote_cells_on_process_boundary.at(neighborhood_id).end()
+			int position = int(item.second - block[2]);
+			ret_val = MPI_Unpack(
+				decompressed.data(),
+				int(decompressed.size()),
+				&position,
+				address,
+				count,
+				datatype,
+				this->comm
 			);
-		}
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " MPI_Unpack failed for cell " << cell
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+			// move cell data offset in case this function is called again
+			item.second = block[2] + uint64_t(position);
 
-		if (sorted && ret_val.size() > 0) {
-			std::sort(ret_val.begin(), ret_val.end());
+			if (!Is_Named_Datatype()(datatype)) {
+				ret_val = MPI_Type_free(&datatype);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " Couldn't free datatype of cell " << cell
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+			}
 		}
 
-		return ret_val;
+		return true;
 	}
 
 
 	/*!
-	Sets the weight of given local existing cell without children.
-
-	Does nothing if above conditions are not met.
-	Cell weights are given to Zoltan when balancing the load.
-	Unset cell weights are assumed to be 1.
-
-	User set cell weights are removed when balance_load is called.
-	Children of refined cells inherit their parent's weight.
-	Parents of unrefined cells do not inherit the moved cells' weights.
-
-	Returns true on success, does nothing and returns false otherwise.
+	Checks and initializes MPI related stuff.
 	*/
-	bool set_cell_weight(const uint64_t cell, const double weight)
+	bool initialize_mpi(const MPI_Comm& given_comm)
 	{
-		if (this->cell_process.count(cell) == 0) {
+		int ret_val = -1;
+
+		/*
+		Setup MPI related stuff
+		*/
+
+		ret_val = MPI_Comm_dup(given_comm, &this->comm);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't duplicate communicator: " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+		ret_val = MPI_Comm_dup(this->comm, &this->some_to_some_comm);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't duplicate communicator: " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
 
-		if (this->cell_process.at(cell) != this->rank) {
+		int temp_size = 0;
+		ret_val = MPI_Comm_size(this->comm, &temp_size);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't get size of communicator: " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+		if (temp_size < 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Negative MPI comm size not supported: " << temp_size
+				<< std::endl;
 			return false;
 		}
+		this->comm_size = (uint64_t) temp_size;
 
-		if (cell != this->get_child(cell)) {
+		int temp_rank = 0;
+		ret_val = MPI_Comm_rank(this->comm, &temp_rank);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't get rank for communicator: " << Error_String()(ret_val)
+				<< std::endl;
 			return false;
 		}
+		if (temp_rank < 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Negative MPI rank not supported: " << temp_rank
+				<< std::endl;
+			abort();
+		}
+		this->rank = (uint64_t) temp_rank;
 
-		this->cell_weights[cell] = weight;
+		// get maximum tag value
+		int attr_flag = -1, *attr = NULL;
+		ret_val = MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &attr, &attr_flag);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't get MPI_TAG_UB: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+		if (attr == NULL) {
+			// guaranteed by MPI
+			this->max_tag = 32767;
+		} else {
+			this->max_tag = (unsigned int) *attr;
+		}
 
 		return true;
 	}
 
 	/*!
-	Returns the weight of given local existing cell without children.
-
-	Returns a quiet nan if above conditions are not met.
-	Unset cell weights are assumed to be 1.
+	Initializes Zoltan related stuff.
 	*/
-	double get_cell_weight(const uint64_t cell) const
+	bool initialize_zoltan()
 	{
-		if (this->cell_process.count(cell) == 0) {
-			return std::numeric_limits<double>::quiet_NaN();
-		}
+		int ret_val = -1;
 
-		if (this->cell_process.at(cell) != this->rank) {
-			return std::numeric_limits<double>::quiet_NaN();
+		MPI_Comm temp; // give a separate comminucator to zoltan
+		ret_val = MPI_Comm_dup(this->comm, &temp);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << "Couldn't duplicate communicator for Zoltan" << std::endl;
+			return false;
+		}
+		this->zoltan = Zoltan_Create(temp);
+		if (this->zoltan == NULL) {
+			std::cerr << "Zoltan_Create failed" << std::endl;
+			return false;
 		}
 
-		if (cell != this->get_child(cell)) {
-			return std::numeric_limits<double>::quiet_NaN();
+		// check whether Zoltan_LB_Partition is expected to fail
+		if (this->load_balancing_method == "NONE") {
+			this->no_load_balancing = true;
+		} else {
+			this->no_load_balancing = false;
 		}
 
-		if (this->cell_weights.count(cell) == 0) {
-			return 1;
-		} else {
-			return this->cell_weights.at(cell);
+		// reserved options that the user cannot change
+		this->reserved_options.insert("EDGE_WEIGHT_DIM");
+		this->reserved_options.insert("NUM_GID_ENTRIES");
+		this->reserved_options.insert("NUM_LID_ENTRIES");
+		this->reserved_options.insert("OBJ_WEIGHT_DIM");
+		this->reserved_options.insert("RETURN_LISTS");
+		this->reserved_options.insert("NUM_GLOBAL_PARTS");
+		this->reserved_options.insert("NUM_LOCAL_PARTS");
+		this->reserved_options.insert("AUTO_MIGRATE");
+
+		/*
+		Set reserved options
+		*/
+		// 0 because Zoltan crashes in hierarchial with larger values
+		Zoltan_Set_Param(this->zoltan, "EDGE_WEIGHT_DIM", "0");
+		Zoltan_Set_Param(this->zoltan, "NUM_GID_ENTRIES", "1");
+		Zoltan_Set_Param(this->zoltan, "NUM_LID_ENTRIES", "0");
+		Zoltan_Set_Param(this->zoltan, "OBJ_WEIGHT_DIM", "1");
+		Zoltan_Set_Param(this->zoltan, "RETURN_LISTS", "ALL");
+
+		// set other options
+		Zoltan_Set_Param(this->zoltan, "DEBUG_LEVEL", "0");
+		Zoltan_Set_Param(this->zoltan, "HIER_DEBUG_LEVEL", "0");
+		Zoltan_Set_Param(this->zoltan, "HIER_CHECKS", "0");
+		// HILBERT is partitioned without Zoltan
+		if (this->load_balancing_method != "HILBERT") {
+			Zoltan_Set_Param(this->zoltan, "LB_METHOD", this->load_balancing_method.c_str());
 		}
-	}
+		Zoltan_Set_Param(this->zoltan, "REMAP", "1");
 
+		// set the grids callback functions in Zoltan
+		Zoltan_Set_Num_Obj_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::get_number_of_cells,
+			this
+		);
 
-	/*!
-	Returns the cells that will be added to this process by load balancing.
-	*/
-	const std::unordered_set<uint64_t>& get_cells_added_by_balance_load() const
-	{
-		return this->added_cells;
-	}
+		Zoltan_Set_Obj_List_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_cell_list,
+			this
+		);
 
-	/*!
-	Returns the cells that will be removed from this process by load balancing.
-	*/
-	const std::unordered_set<uint64_t>& get_cells_removed_by_balance_load() const
-	{
-		return this->removed_cells;
-	}
+		Zoltan_Set_Num_Geom_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::get_grid_dimensionality,
+			NULL
+		);
 
+		Zoltan_Set_Geom_Multi_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_with_cell_coordinates,
+			this
+		);
 
-	/*!
-	Returns the smallest existing cell at the given coordinate.
+		Zoltan_Set_Num_Edges_Multi_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_number_of_neighbors_for_cells,
+			this
+		);
 
-	Returns error_cell if the coordinate is outside of the grid
-	or this process doesn't know which remote cells exist at given (x, y, z).
-	*/
-	uint64_t get_existing_cell(const std::array<double, 3>& coordinate) const
-	{
-		const Types<3>::indices_t indices = this->geometry.get_indices(coordinate);
+		Zoltan_Set_Edge_List_Multi_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_neighbor_lists,
+			this
+		);
 
-		if (indices[0] == error_index
-		|| indices[1] == error_index
-		|| indices[2] == error_index) {
-			return error_cell;
-		}
+		Zoltan_Set_HG_Size_CS_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_number_of_hyperedges,
+			this
+		);
 
-		return this->get_existing_cell(indices, 0, this->mapping.get_maximum_refinement_level());
-	}
+		Zoltan_Set_HG_CS_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_hyperedge_lists,
+			this
+		);
 
+		Zoltan_Set_HG_Size_Edge_Wts_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_number_of_edge_weights,
+			this
+		);
 
- 	/*!
-	Returns the siblings of given cell regardless of whether they exist.
+		Zoltan_Set_HG_Edge_Wts_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::fill_edge_weights,
+			this
+		);
 
-	If given a cell of refinement level 0 returns the given cell.
-	Returns nothing if given cell's refinement level exceeds the maximum of this grid.
-	*/
-	std::vector<uint64_t> get_siblings(const uint64_t cell) const
-	{
-		std::vector<uint64_t> siblings;
+		Zoltan_Set_Hier_Num_Levels_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::get_number_of_load_balancing_hierarchies,
+			this
+		);
 
-		const int refinement_level = this->mapping.get_refinement_level(cell);
-		if (refinement_level < 0
-		|| refinement_level > this->mapping.get_maximum_refinement_level()) {
-			return siblings;
-		}
+		Zoltan_Set_Hier_Part_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::get_part_number,
+			this
+		);
 
-		if (refinement_level == 0) {
-			siblings.push_back(cell);
-			return siblings;
-		}
+		Zoltan_Set_Hier_Method_Fn(
+			this->zoltan,
+			&Dccrg<
+				Cell_Data,
+				Geometry,
+				std::tuple<Additional_Cell_Items...>,
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
+			>::set_partitioning_options,
+			this
+		);
 
-		return this->get_all_children(this->get_parent(cell));
+		return true;
 	}
 
 
 	/*!
-	Returns all children of given cell regardless of whether they exist.
-
-	Returns nothing if childrens' refinement level would exceed max_refinement_level or
-	given cell doesn't exist.
-	 */
-	std::vector<uint64_t> get_all_children(const uint64_t cell) const
-	{
-		std::vector<uint64_t> children;
-
-		if (cell == error_cell) {
-			return children;
-		}
-
-		if (this->cell_process.count(cell) == 0) {
-			return children;
-		}
-
-		// given cell cannot have children
-		int refinement_level = this->mapping.get_refinement_level(cell);
-		if (refinement_level >= this->mapping.get_maximum_refinement_level()) {
-			return children;
-		}
-
-		children.reserve(8);
-
-		Types<3>::indices_t indices = this->mapping.get_indices(cell);
+	Sets the default neighborhoods of cells.
 
-		// get indices of next refinement level within this cell
-		refinement_level++;
-		const uint64_t index_offset
-			= (uint64_t(1) << (this->mapping.get_maximum_refinement_level() - refinement_level));
+	\see set_neighborhood_length()
+	*/
+	void initialize_neighborhoods() {
+		// set neighborhood_of
+		if (this->neighborhood_length == 0) {
 
-		for (uint64_t
-			z_index_offset = 0;
-			z_index_offset < 2 * index_offset;
-			z_index_offset += index_offset
-		)
-		for (uint64_t
-			y_index_offset = 0;
-			y_index_offset < 2 * index_offset;
-			y_index_offset += index_offset
-		)
-		for (uint64_t
-			x_index_offset = 0;
-			x_index_offset < 2 * index_offset;
-			x_index_offset += index_offset
-		) {
-			const Types<3>::indices_t index = {{
-				indices[0] + x_index_offset,
-				indices[1] + y_index_offset,
-				indices[2] + z_index_offset,
-			}};
+			{
+			this->neighborhood_of.push_back({0, 0, -1});
+			}
+			{
+			Types<3>::neighborhood_item_t item = {{0, -1, 0}};
+			this->neighborhood_of.push_back(item);
+			}
+			{
+			Types<3>::neighborhood_item_t item = {{-1, 0, 0}};
+			this->neighborhood_of.push_back(item);
+			}
+			{
+			Types<3>::neighborhood_item_t item = {{1, 0, 0}};
+			this->neighborhood_of.push_back(item);
+			}
+			{
+			Types<3>::neighborhood_item_t item = {{0, 1, 0}};
+			this->neighborhood_of.push_back(item);
+			}
+			{
+			Types<3>::neighborhood_item_t item = {{0, 0, 1}};
+			this->neighborhood_of.push_back(item);
+			}
+
+		} else {
+
+			for (int
+				z = -this->neighborhood_length;
+				(unsigned int) abs(z) < this->neighborhood_length + 1;
+				z++
+			)
+			for (int
+				y = -this->neighborhood_length;
+				(unsigned int) abs(y) < this->neighborhood_length + 1;
+				y++
+			)
+			for (int
+				x = -this->neighborhood_length;
+				(unsigned int) abs(x) < this->neighborhood_length + 1;
+				x++
+			) {
+				if (x == 0 && y == 0 && z == 0) {
+					continue;
+				}
+				const Types<3>::neighborhood_item_t item = {{x, y, z}};
+				this->neighborhood_of.push_back(item);
+			}
 
-			children.push_back(
-				this->mapping.get_cell_from_indices(index, refinement_level)
-			);
 		}
 
-		return children;
+		// set neighborhood_to
+		for (const auto& offset: this->neighborhood_of) {
+			Types<3>::neighborhood_item_t item = {{-offset[0], -offset[1], -offset[2]}};
+			this->neighborhood_to.push_back(item);
+		}
 	}
 
 
 	/*!
-	Returns cell weights that have been set.
+	Creates cells of refinement level 0 and assigns them to processes.
+
+	If USE_SFC is defined when compiling the cells will be assigned to
+	processes using a space-filling curve which should improve the
+	initial computational load.
+
+	this->length and this->mapping must have been initialized prior
+	to calling this function.
 	*/
-	const std::unordered_map<uint64_t, double>& get_cell_weights() const
+	bool create_level_0_cells(const uint64_t sfc_caching_batches)
 	{
-		return this->cell_weights;
-	}
-
+		if (sfc_caching_batches == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " sfc_caching_batches must be > 0"
+				<< std::endl;
+			return false;
+		}
 
-	/*!
-	Adds a new neighborhood for updating Cell_Data between neighbors on different processes.
+		const uint64_t total_cells
+			= this->length.get()[0]
+			* this->length.get()[1]
+			* this->length.get()[2];
 
-	Must be called with identical parameters on all processes.
-	No neighborhood_item_t can have all offsets equal to 0.
-	Returns true on success and false in any of the following cases:
-		- given default_neighborhood_id
-		- given id already exists, use remove_neighborhood() before calling this
-		- (part of) given neighborhood is outside of initial neighborhood size
+		uint64_t cells_per_process = 0;
 
-	Can be used to reduce the amount of data transferred between
-	processes if Cell_Data from the full neighborhood isn't needed.
+		if (total_cells < this->comm_size) {
+			cells_per_process = 1;
+		} else if (total_cells % this->comm_size > 0) {
+			cells_per_process = total_cells / this->comm_size + 1;
+		} else {
+			cells_per_process = total_cells / this->comm_size;
+		}
 
-	Returns true on success and false on failure.
+		// some processes get fewer cells if grid size not divisible by this->comm_size
+		const uint64_t procs_with_fewer = cells_per_process * this->comm_size - total_cells;
 
-	\see
-	initialize()
-	remove_neighborhood()
-	*/
-	bool add_neighborhood(
-		const int neighborhood_id,
-		const std::vector<Types<3>::neighborhood_item_t>& given_neigh
-	) {
-		if (neighborhood_id == default_neighborhood_id) {
-			return false;
-		}
+		#ifndef USE_SFC
 
-		if (this->user_hood_of.count(neighborhood_id) > 0) {
+		uint64_t cell_to_create = 1;
+		for (uint64_t process = 0; process < this->comm_size; process++) {
 
-			#ifdef DEBUG
-			if (this->user_hood_to.count(neighborhood_id) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should have id " << neighborhood_id
-					<< std::endl;
-				abort();
+			uint64_t cells_to_create;
+			if (process < procs_with_fewer) {
+				cells_to_create = cells_per_process - 1;
+			} else {
+				cells_to_create = cells_per_process;
 			}
 
-			if (this->user_neigh_of.count(neighborhood_id) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should have id " << neighborhood_id
-					<< std::endl;
-				abort();
+			// only cells of this process are needed with a cell directory
+			if (this->distributed_ownership and process != this->rank) {
+				cell_to_create += cells_to_create;
+				continue;
 			}
 
-			if (this->user_neigh_to.count(neighborhood_id) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Should have id " << neighborhood_id
-					<< std::endl;
-				abort();
+			for (uint64_t i = 0; i < cells_to_create; i++) {
+				this->cell_process[cell_to_create] = process;
+				if (process == this->rank) {
+					this->cell_data[cell_to_create];
+				}
+				cell_to_create++;
 			}
-			#endif
-
-			return false;
 		}
 
 		#ifdef DEBUG
-		if (this->user_hood_to.count(neighborhood_id) > 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should not have id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-
-		if (this->user_neigh_of.count(neighborhood_id) > 0) {
+		if (cell_to_create != total_cells + 1) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should not have id " << neighborhood_id
+				<< " Incorrect number of cells created: " << cell_to_create - 1
+				<< ", should be " << total_cells
 				<< std::endl;
 			abort();
 		}
+		#endif
 
-		if (this->user_neigh_to.count(neighborhood_id) > 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should not have id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
+		#else // ifndef USE_SFC
 
-		if (this->user_neigh_cells_to_send.count(neighborhood_id) > 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should not have id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
+		const dccrg::Types<3>::indices_t sfc_length = {{
+			this->length.get()[0],
+			this->length.get()[1],
+			this->length.get()[2]
+		}};
+		sfc::Sfc<3, uint64_t> sfc_mapping(sfc_length);
 
-		if (this->user_neigh_cells_to_receive.count(neighborhood_id) > 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Should not have id " << neighborhood_id
-				<< std::endl;
-			abort();
+		/*
+		Cache only batch_size number of sfc indices at a time.
+		Saves memory and can even be faster than caching everything at once
+		*/
+		uint64_t batch_size;
+		if (sfc_mapping.size() % sfc_caching_batches > 0) {
+			batch_size = 1 + sfc_mapping.size() / sfc_caching_batches;
+		} else {
+			batch_size = sfc_mapping.size() / sfc_caching_batches;
 		}
-		#endif
 
-		if (this->neighborhood_length > 0) {
+		uint64_t cache_start = 0, cache_end = batch_size - 1;
+		sfc_mapping.cache_sfc_index_range(cache_start, cache_end);
 
-			for (const auto& neigh_item: given_neigh) {
-				for (size_t i = 0; i < 3; i++) {
-					if ((unsigned int) abs(neigh_item[i]) > this->neighborhood_length) {
-						return false;
-					}
-				}
+		uint64_t sfc_index = 0;
+		for (uint64_t process = 0; process < this->comm_size; process++) {
 
-				if (neigh_item[0] == 0 && neigh_item[1] == 0 && neigh_item[2] == 0) {
-					return false;
-				}
+			uint64_t cells_to_create;
+			if (process < procs_with_fewer) {
+				cells_to_create = cells_per_process - 1;
+			} else {
+				cells_to_create = cells_per_process;
 			}
 
-		} else {
+			for (uint64_t i = 0; i < cells_to_create; i++) {
 
-			for (const auto& neigh_item: given_neigh) {
-				int zero_offsets = 0;
+				// cache new sfc index batch
+				if (sfc_index > cache_end) {
+					cache_start = cache_end;
+					cache_end = cache_start + batch_size;
 
-				for (size_t i = 0; i < 3; i++) {
-					if (neigh_item[i] == 0) {
-						zero_offsets++;
-					}
-					if (abs(neigh_item[i]) > 1) {
-						return false;
+					if (cache_end >= sfc_mapping.size()) {
+						cache_end = sfc_mapping.size() - 1;
 					}
-				}
 
-				if (zero_offsets != 2) {
-					return false;
+					sfc_mapping.clear();
+					sfc_mapping.cache_sfc_index_range(cache_start, cache_end);
 				}
-			}
-
-		}
-
-		// set user_hood_of and _to
-		this->user_hood_of[neighborhood_id] = given_neigh;
-		this->user_hood_to[neighborhood_id].clear();
-		for (const auto& neigh_item: given_neigh) {
-			const Types<3>::neighborhood_item_t neigh_item_to = {{
-				-neigh_item[0],
-				-neigh_item[1],
-				-neigh_item[2]
-			}};
-			this->user_hood_to.at(neighborhood_id).push_back(neigh_item_to);
-		}
-
-		for (const auto& item: this->cell_data) {
-			this->update_user_neighbors(item.first, neighborhood_id);
-		}
-
-		this->update_user_remote_neighbor_info(neighborhood_id);
-
-		this->recalculate_neighbor_update_send_receive_lists(neighborhood_id);
-		this->allocate_copies_of_remote_neighbors(neighborhood_id);
 
-		#ifdef DEBUG
-		if (!this->is_consistent()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " The grid is inconsistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
+				dccrg::Types<3>::indices_t indices = sfc_mapping.get_indices(sfc_index);
+				// transform indices to those of refinement level 0 cells
+				indices[0] *= uint64_t(1) << this->mapping.get_maximum_refinement_level();
+				indices[1] *= uint64_t(1) << this->mapping.get_maximum_refinement_level();
+				indices[2] *= uint64_t(1) << this->mapping.get_maximum_refinement_level();
+				const uint64_t cell_to_create = this->mapping.get_cell_from_indices(indices, 0);
 
-		if (!this->verify_neighbors()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Neighbor lists are incorrect"
-				<< std::endl;
-			exit(EXIT_FAILURE);
-		}
+				if (not this->distributed_ownership or process == this->rank) {
+					this->cell_process[cell_to_create] = process;
+				}
+				if (process == this->rank) {
+					this->cell_data[cell_to_create];
+				}
 
-		if (!this->verify_remote_neighbor_info()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info is not consistent"
-				<< std::endl;
-			exit(EXIT_FAILURE);
+				sfc_index++;
+			}
 		}
+		sfc_mapping.clear();
 
-		if (!this->verify_user_data()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " User data not consistent"
+		if (sfc_index != total_cells) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Process " << this->rank
+				<< ": Incorrect number of cells created: " << sfc_index
+				<< ", should be " << total_cells
 				<< std::endl;
-			exit(EXIT_FAILURE);
+			abort();
 		}
-		#endif
+
+		#endif // ifndef USE_SFC
+		// TODO: check that the last index in the grid in every direction is less than error_index
 
 		return true;
 	}
 
-
+public:
 	/*!
-	Removes the given neighborhood.
+	Sets size of grid in cells of refinement level 0.
 
-	Must be called with identical id on all processes.
-	Frees local neighbor lists and other resources associated
-	with given neighborhood.
+	Sets how many cells of largest possible size this
+	grid will be created with at initialization.
 
-	\see
-	add_neighborhood()
+	Must be called before initialize().
+
+	\see set_maximum_refinement_level() initialize()
 	*/
 	Dccrg<
 		Cell_Data,
 		Geometry,
 		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& remove_neighborhood(const int neighborhood_id)
-	{
-		if (neighborhood_id == default_neighborhood_id) {
-			return *this;
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_initial_length(const std::array<uint64_t, 3>& initial_size) {
+		if (this->mapping_initialized) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Initial size of grid already set"
+			);
 		}
 
-		this->user_hood_of.erase(neighborhood_id);
-		this->user_hood_to.erase(neighborhood_id);
-		this->user_neigh_of.erase(neighborhood_id);
-		this->user_neigh_to.erase(neighborhood_id);
-		this->user_neigh_cells_to_send.erase(neighborhood_id);
-		this->user_neigh_cells_to_receive.erase(neighborhood_id);
-		this->user_local_cells_on_process_boundary.erase(neighborhood_id);
-		this->user_remote_cells_on_process_boundary.erase(neighborhood_id);
-		return *this;
-	}
-
+		if (!this->mapping_rw.set_length(initial_size)) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Couldn't set initial size of grid"
+			);
+		}
+		this->mapping_initialized = true;
 
-	/*!
-	Returns whether this dccrg instance has been initialized.
-	*/
-	bool get_initialized() const
-	{
-		return this->grid_initialized;
+		return *this;
 	}
 
 	/*!
-	Returns whether this dccrg instance's cell id mapping has been initialized.
-	*/
-	bool get_mapping_initialized() const
-	{
-		return this->mapping_initialized;
-	}
+	Sets maximum possible refinement level of cells.
 
-	/*!
-	Returns the maximum value an MPI tag can have.
-	*/
-	unsigned int get_max_tag() const
-	{
-		return this->max_tag;
-	}
+	Using @max_ref_lvl < 0 sets it to maximum possible value (<= 21).
+	Refining a cell past maximum refinement level succeeds but does nothing.
 
-	/*!
-	Returns the maximum allowed difference in refinement level between neighboring cells.
+	Must be called before initialize().
 
-	This difference in enforced both between a cell and its neighbors_of and its neighbors_to.
+	\see set_periodic() local_cells update_copies_of_remote_neighbors() refine_completely()
 	*/
-	int get_max_ref_lvl_diff() const
-	{
-		return this->max_ref_lvl_diff;
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_maximum_refinement_level(const int max_ref_lvl) {
+		if (max_ref_lvl < 0) {
+			this->mapping_rw.set_maximum_refinement_level(
+				this->mapping_rw.get_maximum_possible_refinement_level()
+			);
+		} else if (not this->mapping_rw.set_maximum_refinement_level(max_ref_lvl)) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Couldn't set maximum refinement level to "
+				+ std::to_string(max_ref_lvl)
+			);
+		}
+		return *this;
 	}
 
 	/*!
-	Returns whether cell data is transferred using one message or more.
+	Sets grid periodicity.
 
-	If true then one MPI message per cell is used, otherwise all cells
-	are transferred in one message.
+	In periodic dimension cells on opposite sides are neighbors
+	as-if the grid was neighbor to itself on both sides in that
+	dimension.
 
-	\see
-	set_send_single_cells()
+	Must be called before initialize().
 	*/
-	bool get_send_single_cells() const
-	{
-		return this->send_single_cells;
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_periodic(const bool x, const bool y, const bool z) {
+		this->topology_rw.set_periodicity(0, x);
+		this->topology_rw.set_periodicity(1, y);
+		this->topology_rw.set_periodicity(2, z);
+		return *this;
 	}
 
 	/*!
-	Sets whether cell data is transferred using one message or more.
+	Sets default distance within which cells are considered neighbors.
 
-	Do not switch sending type while data transfers are going on,
-	for example with start_remote_neighbor_data_update(...).
+	With value == 0 only face neighbors are considered neighbors.
+	With value > 0 cells within that distance are considered neighbors
+	(in units of logical size of cell doing the considering).
 
-	\see
-	get_send_single_cells()
+	Must be called before initialize().
+
+	\see add_neighborhood()
 	*/
 	Dccrg<
 		Cell_Data,
 		Geometry,
 		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& set_send_single_cells(const bool given)
-	{
-		this->send_single_cells = given;
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_neighborhood_length(const unsigned int given_length) {
+		this->neighborhood_length = given_length;
 		return *this;
 	}
 
 	/*!
-	Returns dccrg's communicator.
+	Sets load balancing method used by Zoltan.
 
-	Returns a duplicate of the MPI communicator of dccrg
-	which itself is a duplicate of the communicator that
-	was given to dccrg's initialize function.
-	*/
-	MPI_Comm get_communicator() const
-	{
-		if (!this->grid_initialized) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " get_communicator called before initialize()"
-				<< std::endl;
-			abort();
-		}
+	HILBERT partitions cells without Zoltan by cutting a Hilbert
+	curve through the grid at its finest refinement level into
+	pieces of equal total cell weight. It is faster than Zoltan's
+	methods but ignores partitioning levels and options.
 
-		MPI_Comm ret_val;
-		int result = MPI_Comm_dup(this->comm, &ret_val);
-		if (result != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't duplicate communicator: " << Error_String()(result)
-				<< std::endl;
-		}
-		return ret_val;
-	}
+	Must be called before initialize().
 
-	/*!
-	Returns the MPI process number, i.e. rank, of this process.
+	\see balance_load()
 	*/
-	int get_rank() const
-	{
-		return int(this->rank);
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_load_balancing_method(const std::string& given_method) {
+		this->load_balancing_method = given_method;
+		return *this;
 	}
 
-	/*!
-	Returns the number of MPI processes participating in this dccrg instance.
-	*/
-	int get_comm_size() const
-	{
-		return int(this->comm_size);
+	const std::string& get_load_balancing_method() const {
+		return this->load_balancing_method;
 	}
 
 	/*!
-	Returns the storage of mostly local cell ids and their data.
+	Enables or disables incremental load balancing.
+
+	When enabled balance_load() doesn't create a new partition
+	but moves local cells on process boundaries from processes
+	with more weight to neighboring processes with less weight,
+	by amounts given by diffusion of weights between neighboring
+	processes. Every call moves at most the fraction of each
+	process' weight given to set_incremental_migration_limit(),
+	so several calls might be needed to balance the load.
+	Suitable for correcting small imbalances with little migration,
+	see get_load_balance_statistics(). Disabled by default.
+
+	Must be called simultaneously on all processes with the same value.
 	*/
-	const std::unordered_map<uint64_t, Cell_Data>& get_cell_data() const
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_incremental_load_balancing(const bool given)
 	{
-		return this->cell_data;
+		this->incremental_load_balancing = given;
+		return *this;
 	}
 
-	/*!
-	Returns the neighborhood of cells.
-
-	Returns offsets in which cells are considered as neighbors of a cell.
-	*/
-	const std::vector<Types<3>::neighborhood_item_t>& get_neighborhood_of() const
+	bool get_incremental_load_balancing() const
 	{
-		return this->neighborhood_of;
+		return this->incremental_load_balancing;
 	}
 
 	/*!
-	Returns the opposite of neighborhood of cells.
+	Sets maximum fraction of weight a process sends in incremental load balancing.
 
-	Returns offsets in which cells consider a cell as neighbor.
-	*/
-	const std::vector<Types<3>::neighborhood_item_t>& get_neighborhood_to() const
-	{
-		return this->neighborhood_to;
-	}
+	Default is 0.1. Throws std::invalid_argument if given
+	value isn't in range [0, 1].
 
-	/*!
-	Returns the offsets of user defined neighborhoods.
+	\see set_incremental_load_balancing()
 	*/
-	const std::unordered_map<
-		int,
-		std::vector<Types<3>::neighborhood_item_t>
-	>& get_user_hood_of() const
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_incremental_migration_limit(const double given)
 	{
-		return this->user_hood_of;
+		if (not (given >= 0 and given <= 1)) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Incremental migration limit must be in range [0, 1]: " + std::to_string(given)
+			);
+		}
+		this->incremental_migration_limit = given;
+		return *this;
 	}
 
-	/*!
-	Returns the opposite of offsets of user defined neighborhoods
-	*/
-	const std::unordered_map<
-		int,
-		std::vector<Types<3>::neighborhood_item_t>
-	>& get_user_hood_to() const
+	double get_incremental_migration_limit() const
 	{
-		return this->user_hood_to;
+		return this->incremental_migration_limit;
 	}
 
 	/*!
-	Returns cells (2nd value) which consider a cell (1st value) as neighbor
+	Enables or disables statistics of load balancing.
+
+	When enabled balance_load() and initialize_balance_load()
+	collect imbalance and amount of migration into
+	get_load_balance_statistics(), which requires an extra
+	all-to-all exchange and the datatype of every migrated
+	cell. estimate_balance_load() collects them regardless.
+	Disabled by default.
+
+	Must be called simultaneously on all processes with the same value.
 	*/
-	const std::unordered_map<
-		uint64_t,
-		std::vector<
-			std::pair<
-				uint64_t,
-				std::array<int, 4>
-			>
-		>
-	>& get_all_neighbors_to() const
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_load_balance_statistics(const bool given)
 	{
-		return this->neighbors_to;
+		this->collect_load_balance_statistics = given;
+		return *this;
 	}
 
-	/*!
-	User defined neighborhood version of get_cell_neighbor.
-	*/
-	const std::unordered_map<
-		int,
-		std::unordered_map<
-			uint64_t,
-			std::vector<
-				std::pair<
-					uint64_t,
-					std::array<int, 4>
-				>
-			>
-		>
-	>& get_all_user_neigh_of() const
+	bool get_load_balance_statistics_enabled() const
 	{
-		return this->user_neigh_of;
+		return this->collect_load_balance_statistics;
 	}
 
 	/*!
-	User defined neighborhood version of get_all_neighbors_to().
+	Enables or disables cell weights from measured computation times.
+
+	When enabled times given to add_cell_time(), for example by
+	Cell_Timer, are used to estimate the cost of each local cell.
+	Every balance_load() updates the estimates with the total
+	time measured since the previous one, see
+	set_cell_cost_smoothing(), and uses them as weights of cells
+	for which set_cell_weight() hasn't been called. Cells without
+	an estimate get the average estimate of all cells.
+	Children of refined cells get an equal share of their parent's
+	estimate and parents of unrefined cells the sum of their
+	children's. Estimates move with cells between processes.
+	Disabled by default.
+
+	Must be called simultaneously on all processes with the same value.
 	*/
-	const std::unordered_map<
-		int,
-		std::unordered_map<
-			uint64_t,
-			std::vector<
-				std::pair<
-					uint64_t,
-					std::array<int, 4>
-				>
-			>
-		>
-	>& get_all_user_neigh_to() const
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_automatic_cell_weights(const bool given)
 	{
-		return this->user_neigh_to;
+		this->automatic_cell_weights = given;
+		if (given) {
+			this->cell_time_slots.reset(this->cell_data.size());
+		} else {
+			this->measured_cell_times.clear();
+			this->cell_time_slots.reset(0);
+		}
+		return *this;
 	}
 
-	/*!
-	Returns the process (2nd value) of each cell (1st value).
-	*/
-	const std::unordered_map<uint64_t, uint64_t>& get_cell_process() const
+	bool get_automatic_cell_weights() const
 	{
-		return this->cell_process;
+		return this->automatic_cell_weights;
 	}
 
 	/*!
-	Returns cells which have a remote neighbor.
+	Sets weight of latest measured time in estimated costs of cells.
+
+	Estimated cost of a cell is given value times the time
+	measured since previous balance_load() plus 1 - given
+	value times the previous estimate. 1 uses only the
+	latest measurement, default is 0.5. Throws
+	std::invalid_argument if given value isn't in range (0, 1].
+
+	\see set_automatic_cell_weights()
 	*/
-	const std::unordered_set<uint64_t>& get_local_cells_on_process_boundary_internal() const
+	Dccrg<
+		Cell_Data,
+		Geometry,
+		std::tuple<Additional_Cell_Items...>,
+		std::tuple<Additional_Neighbor_Items...>,
+		Cell_Storage
+	>& set_cell_cost_smoothing(const double given)
 	{
-		return this->local_cells_on_process_boundary;
+		if (not (given > 0 and given <= 1)) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Cell cost smoothing must be in range (0, 1]: " + std::to_string(given)
+			);
+		}
+		this->cell_cost_smoothing = given;
+		return *this;
 	}
 
-	/*!
-	Returns remote cells which have a local neighbor.
-	*/
-	const std::unordered_set<uint64_t>& get_remote_cells_on_process_boundary_internal() const
+	double get_cell_cost_smoothing() const
 	{
-		return this->remote_cells_on_process_boundary;
+		return this->cell_cost_smoothing;
 	}
 
+
 	/*!
-	Returns cells which have a remote neighbor for each used defined neighborhood.
+	Returns the index of given cell on a Hilbert curve through the whole grid.
+
+	Indices of cells are shifted right by given number of bits
+	before calculating the index from 21 bits in each dimension,
+	cells whose shifted indices are equal get the same index.
+	Used by load balancing method HILBERT.
 	*/
-	const std::unordered_map<
-		int,
-		std::unordered_set<uint64_t>
-	>& get_user_local_cells_on_process_boundary() const
+	uint64_t get_hilbert_index(const uint64_t cell, const unsigned int shift) const
 	{
-		return this->user_local_cells_on_process_boundary;
+		constexpr unsigned int bits = 21;
+
+		const auto indices = this->mapping.get_indices(cell);
+		std::array<uint64_t, 3> x{{
+			indices[0] >> shift,
+			indices[1] >> shift,
+			indices[2] >> shift
+		}};
+
+		// transpose of Hilbert index (J. Skilling, AIP Conf. Proc. 707, 381 (2004))
+		const uint64_t first_bit = uint64_t(1) << (bits - 1);
+		for (uint64_t q = first_bit; q > 1; q >>= 1) {
+			const uint64_t p = q - 1;
+			for (size_t dim = 0; dim < 3; dim++) {
+				if ((x[dim] & q) > 0) {
+					x[0] ^= p;
+				} else {
+					const uint64_t t = (x[0] ^ x[dim]) & p;
+					x[0] ^= t;
+					x[dim] ^= t;
+				}
+			}
+		}
+		x[1] ^= x[0];
+		x[2] ^= x[1];
+		uint64_t t = 0;
+		for (uint64_t q = first_bit; q > 1; q >>= 1) {
+			if ((x[2] & q) > 0) {
+				t ^= q - 1;
+			}
+		}
+		for (size_t dim = 0; dim < 3; dim++) {
+			x[dim] ^= t;
+		}
+
+		uint64_t index = 0;
+		for (unsigned int bit = bits; bit > 0; bit--) {
+			for (size_t dim = 0; dim < 3; dim++) {
+				index = (index << 1) | ((x[dim] >> (bit - 1)) & 1);
+			}
+		}
+		return index;
 	}
 
+
+private:
 	/*!
-	Returns remote cells which have a local neighbor for each used defined neighborhood.
+	Initializes local cells' neighbor lists and related data structures.
+
+	this->create_level_0_cells() must have been called prior to this.
 	*/
-	const std::unordered_map<
-		int,
-		std::unordered_set<uint64_t>
-	>& get_user_remote_cells_on_process_boundary() const
+	bool initialize_neighbors()
 	{
-		return this->user_remote_cells_on_process_boundary;
+		if (this->distributed_ownership) {
+			this->update_cell_directory();
+			std::vector<uint64_t> local_cells;
+			local_cells.reserve(this->cell_data.size());
+			for (const auto& item: this->cell_data) {
+				local_cells.push_back(item.first);
+			}
+			this->fetch_cells_near(local_cells);
+		}
+
+		// neighbor lists of all cells are new
+		this->all_neighbors_changed = true;
+		this->cells_with_changed_neighbors.clear();
+
+		// update neighbor lists of created cells
+		for (const auto& item: this->cell_data) {
+			this->neighbors_of[item.first]
+				= this->find_neighbors_of(item.first, this->neighborhood_of, this->max_ref_lvl_diff);
+			#ifdef DEBUG
+			for (const auto& neighbor: this->neighbors_of.at(item.first)) {
+				if (neighbor.first == error_cell) {
+					continue;
+				}
+				if (
+					neighbor.second[0] == 0
+					and neighbor.second[1] == 0
+					and neighbor.second[2] == 0
+				) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< "Invalid offset for neighbor " << neighbor.first
+						<< " of cell " << item.first << std::endl;
+					abort();
+				}
+			}
+			#endif
+
+			this->neighbors_to[item.first]
+				= this->find_neighbors_to(item.first, this->neighborhood_to);
+		}
+		#ifdef DEBUG
+		if (!this->verify_neighbors()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Neighbor lists are inconsistent"
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		this->update_remote_neighbor_info();
+		#ifdef DEBUG
+		if (!this->verify_remote_neighbor_info()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info is not consistent"
+				<< std::endl;
+			abort();
+		}
+		#endif
+
+		if (this->distributed_ownership) {
+			this->update_cell_directory();
+		}
+
+		this->recalculate_neighbor_update_send_receive_lists();
+
+		return true;
 	}
 
+
 	/*!
-	Returns cells that will be sent to other processes.
+	Updates user pin requests globally based on new_pin_requests.
 
-	First int is the target process, uint64_t is cell id and
-	last int is the message tag when dccrg sends one cell / MPI_Isend.
+	Must be called simultaneously on all processes.
 	*/
-	const std::unordered_map<
-		int,
-		std::vector<std::pair<uint64_t, int>>
-	>& get_cells_to_send() const
+	void update_pin_requests()
 	{
-		return this->cells_to_send;
+		std::vector<uint64_t> new_pinned_cells, new_pinned_processes;
+
+		new_pinned_cells.reserve(this->new_pin_requests.size());
+		new_pinned_processes.reserve(this->new_pin_requests.size());
+		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
+			item = this->new_pin_requests.begin();
+			item != this->new_pin_requests.end();
+			item++
+		) {
+			new_pinned_cells.push_back(item->first);
+			new_pinned_processes.push_back(item->second);
+		}
+
+		std::vector<std::vector<uint64_t>> all_new_pinned_cells, all_new_pinned_processes;
+		All_Gather()(new_pinned_cells, all_new_pinned_cells, this->comm);
+		All_Gather()(new_pinned_processes, all_new_pinned_processes, this->comm);
+
+		for (uint64_t process = 0; process < all_new_pinned_cells.size(); process++) {
+			for (uint64_t i = 0; i < all_new_pinned_cells.at(process).size(); i++) {
+
+				const uint64_t requested_process = all_new_pinned_processes[process][i];
+
+				if (requested_process >= this->comm_size) {
+					this->pin_requests.erase(all_new_pinned_cells[process][i]);
+				} else {
+					this->pin_requests[all_new_pinned_cells[process][i]] = requested_process;
+				}
+
+				#ifdef DEBUG
+				if (
+					this->cell_process.count(all_new_pinned_cells[process][i]) > 0
+					and this->cell_process.at(all_new_pinned_cells[process][i]) != process
+				) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << process
+						<< " tried pin cell " << all_new_pinned_cells[process][i]
+						<< std::endl;
+					exit(EXIT_FAILURE);
+				}
+				#endif
+			}
+		}
+
+		this->new_pin_requests.clear();
+
+		// owners of pinned cells are needed when partitioning
+		if (this->distributed_ownership) {
+			std::vector<uint64_t> pinned_cells;
+			pinned_cells.reserve(this->pin_requests.size());
+			for (const auto& item: this->pin_requests) {
+				pinned_cells.push_back(item.first);
+			}
+			this->fetch_cell_process(pinned_cells);
+		}
 	}
 
-	/*!
-	Returns cells that will be received from other processes.
 
-	First int is the sending process, uint64_t is cell id and
-	last int is the message tag when dccrg receives one cell / MPI_Irecv.
-	*/
-	const std::unordered_map<
-		int,
-		std::vector<std::pair<uint64_t, int>>
-	>& get_cells_to_receive() const
-	{
-		return this->cells_to_receive;
+	/*!
+	Reads ids and data offsets of cells owned by this process from grid_data_file.
+
+	The list of cells written by save_grid_data() is assumed to
+	start at given offset and to have total_number_of_cells items.
+	Each process reads a contiguous part of the list, at most
+	max_cells_per_read cells at a time, and sends every cell to the
+	owner of its level 0 parent. Received cells are stored into
+	cells_and_data_displacements in the order of data offsets.
+
+	Must be called simultaneously on all processes.
+	*/
+	bool read_cells_and_data_displacements(
+		const MPI_Offset offset,
+		const uint64_t total_number_of_cells,
+		uint64_t max_cells_per_read
+	) {
+		const uint64_t
+			comm_size = this->comm_size,
+			rank = this->rank,
+			cells_per_process = (total_number_of_cells + comm_size - 1) / comm_size,
+			first_cell = std::min(total_number_of_cells, rank * cells_per_process),
+			last_cell = std::min(total_number_of_cells, first_cell + cells_per_process);
+
+		// item count given to MPI must fit into an int
+		max_cells_per_read = std::max(uint64_t(1), std::min(max_cells_per_read, uint64_t(INT_MAX / 2)));
+		// all processes must do the same number of collective reads
+		const uint64_t number_of_reads
+			= (cells_per_process + max_cells_per_read - 1) / max_cells_per_read;
+
+		this->cells_and_data_displacements.clear();
+
+		std::vector<uint64_t> cells_and_data_displacements, parents;
+		std::vector<std::vector<uint64_t>>
+			sends(this->comm_size),
+			receives(this->comm_size);
+		uint64_t current_cell = first_cell;
+		for (uint64_t read = 0; read < number_of_reads; read++) {
+			const uint64_t number_to_read
+				= std::min(max_cells_per_read, last_cell - current_cell);
+
+			cells_and_data_displacements.assign(2 * number_to_read, error_cell);
+			const int ret_val = MPI_File_read_at_all(
+				this->grid_data_file,
+				offset + MPI_Offset(2 * sizeof(uint64_t) * current_cell),
+				cells_and_data_displacements.data(),
+				int(2 * number_to_read),
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't read cells and data displacements: "
+					<< Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+
+			// check that correct cells were read properly
+			parents.clear();
+			for (size_t i = 0; i < cells_and_data_displacements.size(); i += 2) {
+				const uint64_t cell = cells_and_data_displacements[i];
+				if (cell == error_cell) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Invalid cell in cell list at index "
+						<< 2 * current_cell + i << ": " << cell
+						<< std::endl;
+					abort();
+				}
+				parents.push_back(this->mapping.get_level_0_parent(cell));
+			}
+			current_cell += number_to_read;
+
+			if (this->distributed_ownership) {
+				this->fetch_cell_process(parents);
+			}
+
+			for (auto& send: sends) {
+				send.clear();
+			}
+			for (size_t i = 0; i < parents.size(); i++) {
+				if (this->cell_process.count(parents[i]) == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " No owner for parent " << parents[i]
+						<< " of cell " << cells_and_data_displacements[2 * i]
+						<< std::endl;
+					abort();
+				}
+
+				uint64_t
+					cell = cells_and_data_displacements[2 * i],
+					data_displacement = cells_and_data_displacements[2 * i + 1];
+				if (this->load_filtered) {
+					if (not this->filtered_cell_has_data(cell)) {
+						data_displacement = no_cell_data;
+					}
+					cell = this->get_filtered_cell(cell);
+					if (cell == error_cell) {
+						continue;
+					}
+				}
+
+				auto& send = sends[this->cell_process.at(parents[i])];
+				send.push_back(cell);
+				send.push_back(data_displacement);
+			}
+
+			All_To_All()(sends, receives, this->comm);
+
+			for (const auto& receive: receives) {
+				for (size_t i = 0; i < receive.size(); i += 2) {
+					this->cells_and_data_displacements.push_back(
+						std::make_pair(receive[i], receive[i + 1])
+					);
+				}
+			}
+		}
+
+		// file view used for reading cell data must be in file order
+		std::sort(
+			this->cells_and_data_displacements.begin(),
+			this->cells_and_data_displacements.end(),
+			[](
+				const std::pair<uint64_t, uint64_t>& a,
+				const std::pair<uint64_t, uint64_t>& b
+			) {
+				return a.second < b.second;
+			}
+		);
+
+		return true;
 	}
 
-	/*!
-	Returns cells which will be sent for each user defined neighborhood.
-	*/
-	const std::unordered_map<
-		int,
-		std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>
-	>& get_user_neigh_cells_to_send() const
-	{
-		return this->user_neigh_cells_to_send;
-	}
 
 	/*!
-	Returns cells which will be received for each user defined neighborhood.
+	Reassigns refinement level 0 cells based on size of cell data in grid_data_file.
+
+	Reads the list of total_number_of_cells cells starting at given
+	offset as read_cells_and_data_displacements() does and adds the
+	size of data of every loaded cell, plus one, to the weight of its
+	level 0 parent. Level 0 cells sorted in Morton order are then
+	assigned to processes in contiguous ranges of equal weight with
+	partition_curve(), each process stores weights of only about
+	1 / comm_size of level 0 cells.
+
+	Must be called simultaneously on all processes after
+	create_level_0_cells() and before initialize_neighbors().
 	*/
-	const std::unordered_map<
-		int,
-		std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>
-	>& get_user_neigh_cells_to_receive() const
-	{
-		return this->user_neigh_cells_to_receive;
-	}
+	bool assign_level_0_cells_by_data_size(
+		const MPI_Offset offset,
+		const uint64_t total_number_of_cells,
+		uint64_t max_cells_per_read
+	) {
+		int ret_val = -1;
 
-	/*!
-	Returns pin requests currently in force.
-	*/
-	const std::unordered_map<uint64_t, uint64_t>& get_pin_requests() const
-	{
-		return this->pin_requests;
-	}
+		// end of cell data in file, data offsets of compressed files are in uncompressed data
+		uint64_t data_end = this->loading_data_end;
+		if (this->loading_codec) {
+			data_end = 0;
+			if (this->loading_blocks.size() > 0) {
+				data_end = this->loading_blocks.back()[2] + this->loading_blocks.back()[3];
+			}
+		}
 
-	/*!
-	Returns pin requests of this process.
+		const auto& grid_length = this->length.get();
+		const uint64_t
+			total_level_0_cells = grid_length[0] * grid_length[1] * grid_length[2],
+			comm_size = this->comm_size,
+			rank = this->rank,
+			cells_per_process = (total_number_of_cells + comm_size - 1) / comm_size,
+			first_cell = std::min(total_number_of_cells, rank * cells_per_process),
+			last_cell = std::min(total_number_of_cells, first_cell + cells_per_process);
 
-	These have not been told to other processes yet.
-	*/
-	const std::unordered_map<uint64_t, uint64_t>& get_new_pin_requests() const
-	{
-		return this->new_pin_requests;
-	}
+		// weights of level 0 parents of cells read by this process
+		std::unordered_map<uint64_t, uint64_t> parent_weights;
 
-	/*!
-	Returns the pointer to this instances Zoltan data structure.
-	*/
-	const Zoltan_Struct* get_zoltan() const
-	{
-		return this->zoltan;
-	}
+		max_cells_per_read = std::max(uint64_t(1), std::min(max_cells_per_read, uint64_t(INT_MAX / 2) - 1));
+		const uint64_t number_of_reads
+			= (cells_per_process + max_cells_per_read - 1) / max_cells_per_read;
 
-	/*!
-	Returns the number of processes per Zoltan partition.
+		std::vector<uint64_t> cells_and_data_displacements;
+		uint64_t current_cell = first_cell;
+		for (uint64_t read = 0; read < number_of_reads; read++) {
+			const uint64_t
+				number_to_read = std::min(max_cells_per_read, last_cell - current_cell),
+				// data size of last cell needs offset of next cell
+				number_with_next = std::min(number_to_read + 1, total_number_of_cells - current_cell);
+
+			cells_and_data_displacements.assign(2 * number_with_next, error_cell);
+			ret_val = MPI_File_read_at_all(
+				this->grid_data_file,
+				offset + MPI_Offset(2 * sizeof(uint64_t) * current_cell),
+				cells_and_data_displacements.data(),
+				int(2 * number_with_next),
+				MPI_UINT64_T,
+				MPI_STATUS_IGNORE
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't read cells and data displacements: "
+					<< Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
 
-	First partition has vec[0] number of processes, second vec[1], etc.
-	*/
-	const std::vector<unsigned int>& get_processes_per_part() const
-	{
-		return this->processes_per_part;
-	}
+			for (uint64_t i = 0; i < number_to_read; i++) {
+				const uint64_t
+					cell = cells_and_data_displacements[2 * i],
+					data_start = cells_and_data_displacements[2 * i + 1],
+					data_end_of_cell
+						= i + 1 < number_with_next
+						? cells_and_data_displacements[2 * (i + 1) + 1]
+						: data_end,
+					parent = this->mapping.get_level_0_parent(cell);
 
-	/*!
-	Returns the options that are given to Zoltan when partitioning.
-	*/
-	const std::vector<
-		std::unordered_map<std::string, std::string>
-	> get_partitioning_options() const
-	{
-		return this->partitioning_options;
-	}
+				if (parent == error_cell or parent > total_level_0_cells) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Invalid cell in cell list at index "
+						<< current_cell + i << ": " << cell
+						<< std::endl;
+					return false;
+				}
 
-	/*!
-	Returns whether load balancing by Zoltan is supposed to fail.
-	*/
-	bool get_no_load_balancing() const
-	{
-		return this->no_load_balancing;
+				if (this->load_filtered and not this->filtered_cell_has_data(cell)) {
+					continue;
+				}
+				// data of cells is in the order of the list except maybe between processes
+				if (data_end_of_cell > data_start) {
+					parent_weights[parent] += data_end_of_cell - data_start;
+				}
+			}
+			current_cell += number_to_read;
+		}
+		cells_and_data_displacements.clear();
+
+		/*
+		Level 0 cells are numbered from 1 in order of their indices,
+		weights are summed by processes holding contiguous ranges
+		of them so no process needs weights of all cells
+		*/
+		const uint64_t
+			cells_per_holder = (total_level_0_cells + comm_size - 1) / comm_size,
+			first_held = std::min(total_level_0_cells, rank * cells_per_holder) + 1,
+			end_held = std::min(total_level_0_cells, (rank + 1) * cells_per_holder) + 1;
+
+		std::vector<std::vector<uint64_t>> sent_weights(comm_size), received_weights;
+		for (const auto& item: parent_weights) {
+			const uint64_t holder = (item.first - 1) / cells_per_holder;
+			sent_weights[holder].push_back(item.first);
+			sent_weights[holder].push_back(item.second);
+		}
+		parent_weights.clear();
+		All_To_All()(sent_weights, received_weights, this->comm);
+		sent_weights.clear();
+
+		// every cell has weight 1 in addition to its data
+		std::vector<uint64_t> weights(end_held - first_held, 1);
+		for (const auto& process_weights: received_weights) {
+			for (size_t i = 0; i + 1 < process_weights.size(); i += 2) {
+				weights[process_weights[i] - first_held] += process_weights[i + 1];
+			}
+		}
+		received_weights.clear();
+
+		// Morton index, cell and weight of held level 0 cells
+		std::vector<std::array<uint64_t, 3>> held;
+		held.reserve(weights.size());
+		for (uint64_t cell = first_held; cell < end_held; cell++) {
+			const uint64_t i = cell - 1;
+			const std::array<uint64_t, 3> indices{{
+				i % grid_length[0],
+				(i / grid_length[0]) % grid_length[1],
+				i / (grid_length[0] * grid_length[1])
+			}};
+			uint64_t key = 0;
+			for (unsigned int bit = 0; bit < 21; bit++) {
+				for (size_t dim = 0; dim < 3; dim++) {
+					key |= ((indices[dim] >> bit) & 1) << (3 * bit + dim);
+				}
+			}
+			const double weight = double(weights[cell - first_held]);
+			uint64_t weight_bits = 0;
+			std::memcpy(&weight_bits, &weight, sizeof(weight));
+			held.push_back({{key, cell, weight_bits}});
+		}
+		weights.clear();
+		weights.shrink_to_fit();
+
+		// tell new processes which cells they own
+		std::vector<std::vector<uint64_t>> sent(comm_size), received;
+		for (const auto& cells_and_processes: this->partition_curve(held)) {
+			for (size_t i = 0; i + 1 < cells_and_processes.size(); i += 2) {
+				sent[cells_and_processes[i + 1]].push_back(cells_and_processes[i]);
+			}
+		}
+		All_To_All()(sent, received, this->comm);
+		sent.clear();
+
+		for (const auto& item: this->cell_data) {
+			this->cell_process.erase(item.first);
+		}
+		this->cell_data.clear();
+
+		std::vector<uint64_t> new_local_cells;
+		for (const auto& process_cells: received) {
+			new_local_cells.insert(new_local_cells.end(), process_cells.begin(), process_cells.end());
+		}
+		received.clear();
+		for (const uint64_t cell: new_local_cells) {
+			this->cell_process[cell] = rank;
+			this->cell_data[cell];
+		}
+
+		// without a cell directory every process stores owners of all cells
+		if (not this->distributed_ownership) {
+			std::vector<std::vector<uint64_t>> all_new_cells;
+			All_Gather()(new_local_cells, all_new_cells, this->comm);
+			for (uint64_t process = 0; process < comm_size; process++) {
+				for (const uint64_t cell: all_new_cells[process]) {
+					this->cell_process[cell] = process;
+				}
+			}
+		}
+
+		return true;
 	}
 
+
 	/*!
-	Returns options to Zoltan which cannot be set by the user.
+	Prepares filtering cells of file being loaded.
+
+	Resolves loaded region and refinement levels into indices and
+	refinement levels of the grid read from the file, sets
+	load_filtered if they don't cover the whole grid.
 	*/
-	const std::unordered_set<std::string>& get_reserved_options() const
+	void initialize_load_filter()
 	{
-		return this->reserved_options;
+		const int max_ref_lvl = this->mapping.get_maximum_refinement_level();
+		this->load_min_ref_lvl = std::min(this->loaded_refinement_levels.first, max_ref_lvl);
+		this->load_max_ref_lvl
+			= this->loaded_refinement_levels.second < 0
+			? max_ref_lvl
+			: std::min(this->loaded_refinement_levels.second, max_ref_lvl);
+
+		const auto
+			grid_start = this->geometry.get_start(),
+			grid_end = this->geometry.get_end();
+
+		bool whole_grid = true, empty = false;
+		std::array<double, 3> min_coordinate, max_coordinate;
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (
+				this->loaded_region_min[dim] > grid_start[dim]
+				or this->loaded_region_max[dim] < grid_end[dim]
+			) {
+				whole_grid = false;
+			}
+			if (
+				this->loaded_region_min[dim] >= grid_end[dim]
+				or this->loaded_region_max[dim] < grid_start[dim]
+			) {
+				empty = true;
+			}
+
+			// coordinates at end of grid aren't inside any cell
+			const double last_inside = std::nextafter(grid_end[dim], grid_start[dim]);
+			min_coordinate[dim] = std::max(grid_start[dim], std::min(last_inside, this->loaded_region_min[dim]));
+			max_coordinate[dim] = std::max(grid_start[dim], std::min(last_inside, this->loaded_region_max[dim]));
+		}
+
+		this->load_filtered
+			= not whole_grid
+			or this->load_min_ref_lvl > 0
+			or this->load_max_ref_lvl < max_ref_lvl;
+
+		if (empty) {
+			this->load_min_indices = {{error_index, error_index, error_index}};
+			this->load_max_indices = {{0, 0, 0}};
+		} else {
+			this->load_min_indices = this->geometry.get_indices(min_coordinate);
+			this->load_max_indices = this->geometry.get_indices(max_coordinate);
+		}
 	}
 
+
 	/*!
-	Returns processes which have cells close enough to any cell of this process.
+	Returns the cell that must exist for given cell of file being loaded.
 
-	Close enough is number of refinement level 0 cells * size of default neighborhood.
-	FIXME not implemented yet so doesn't return anything at the moment.
+	Returns the ancestor of given cell of largest loaded refinement
+	level or given cell if its refinement level isn't larger.
+	Returns error_cell if that cell doesn't overlap loaded region.
+
+	\see initialize_load_filter()
 	*/
-	const std::unordered_set<uint64_t>& get_neighbor_processes() const
+	uint64_t get_filtered_cell(const uint64_t cell) const
 	{
-		return this->neighbor_processes;
+		const uint64_t filtered
+			= this->mapping.get_refinement_level(cell) > this->load_max_ref_lvl
+			? this->mapping.get_cell_from_indices(this->mapping.get_indices(cell), this->load_max_ref_lvl)
+			: cell;
+
+		const auto indices = this->mapping.get_indices(filtered);
+		const uint64_t length = this->mapping.get_cell_length_in_indices(filtered);
+		for (size_t dim = 0; dim < 3; dim++) {
+			if (
+				indices[dim] > this->load_max_indices[dim]
+				or indices[dim] + length <= this->load_min_indices[dim]
+			) {
+				return error_cell;
+			}
+		}
+
+		return filtered;
 	}
 
+
 	/*!
-	Returns whether this instance is currently balancing the load.
+	Returns true if data of given cell of file being loaded is read.
+
+	\see get_filtered_cell()
 	*/
-	bool get_balancing_load() const
+	bool filtered_cell_has_data(const uint64_t cell) const
 	{
-		return this->balancing_load;
+		return
+			this->mapping.get_refinement_level(cell) >= this->load_min_ref_lvl
+			and this->get_filtered_cell(cell) == cell;
 	}
 
 
 	/*!
-	Default constructs local copy of the data of remote neighbor cells.
-
-	Use this function to modify the default constructed incoming cells
-	before they start receiving data from other processes.
+	Adds the processes of given cells into cell_process.
 
-	For example if the default constructed version of cell data class
-	doesn't return a correct MPI_Datatype when updating remote neighbor
-	data then call this beforehand and use get_remote_neighbors_to() to
-	get a list of cells which you should change.
+	Cells that don't exist aren't added.
+	Must be called simultaneously on all processes
+	when using distributed ownership.
 	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& allocate_copies_of_remote_neighbors(const int neighborhood_id = default_neighborhood_id)
+	void fetch_cell_process(const std::vector<uint64_t>& cells)
 	{
-		if (
-			neighborhood_id != default_neighborhood_id
-			and this->user_hood_of.count(neighborhood_id) == 0
-		) {
-			throw std::invalid_argument("Neighborhood with given id doesn't exist.");
-		}
-
-		const auto& receives_to_use = [&neighborhood_id, this](){
-			if (neighborhood_id == default_neighborhood_id) {
-				return this->cells_to_receive;
-			} else {
-				return this->user_neigh_cells_to_receive.at(neighborhood_id);
+		std::vector<uint64_t> unknown;
+		unknown.reserve(cells.size());
+		for (const uint64_t cell: cells) {
+			if (cell != error_cell and this->cell_process.count(cell) == 0) {
+				unknown.push_back(cell);
 			}
-		}();
+		}
+		std::sort(unknown.begin(), unknown.end());
+		unknown.erase(std::unique(unknown.begin(), unknown.end()), unknown.end());
 
-		for (const auto& sender : receives_to_use) {
-			for (const auto& item: sender.second) {
-				this->remote_neighbors[item.first];
+		const auto owners = this->cell_directory.get_process(unknown, this->comm);
+		for (size_t i = 0; i < owners.size(); i++) {
+			if (owners[i] != Cell_Directory::error_process()) {
+				this->cell_process[unknown[i]] = owners[i];
 			}
 		}
-
-		return *this;
 	}
 
 
+	/*!
+	Returns cells of possibly different refinement levels near given cells.
+
+	Around each given cell the cells of refinement level
+	max_ref_lvl_diff smaller than the given cell which are
+	at most one cell farther away than the largest neighborhood
+	are returned in near and their ancestors in ancestors_of_near.
+	Neighbor searches of given cells and of their children and
+	parents only visit cells that overlap the returned ones.
+	*/
+	void get_cells_near(
+		const std::vector<uint64_t>& cells,
+		std::unordered_set<uint64_t>& near,
+		std::unordered_set<uint64_t>& ancestors_of_near
+	) const {
+		const int radius = int(std::max(this->neighborhood_length, 1u)) + 1;
+		std::vector<Types<3>::neighborhood_item_t> cube;
+		for (int z = -radius; z <= radius; z++) {
+		for (int y = -radius; y <= radius; y++) {
+		for (int x = -radius; x <= radius; x++) {
+			cube.push_back({{x, y, z}});
+		}}}
+
+		std::unordered_set<uint64_t> centers;
+		for (const uint64_t cell: cells) {
+			if (cell == error_cell) {
+				continue;
+			}
 
-private:
-	bool
-		mapping_initialized = false,
-		grid_initialized = false;
-
-	// size of the neighbor stencil of a cells in cells (of the same size as the cell itself)
-	unsigned int neighborhood_length = 1;
-
-	std::string load_balancing_method{"RCB"};
-
-	// maximum value an MPI tag can have
-	unsigned int max_tag;
-
-	// maximum difference in refinement level between neighbors
-	int max_ref_lvl_diff = 1;
-
-	// whether to send user's cell data between processes
-	// with only one message or one message / cell
-	bool send_single_cells = false;
-
-	// the grid is distributed between these processes
-	MPI_Comm comm;
-	uint64_t rank, comm_size;
-
-	// cells and their data on this process
-	std::unordered_map<uint64_t, Cell_Data> cell_data;
+			const int ref_lvl = std::max(
+				0,
+				this->mapping.get_refinement_level(cell) - this->max_ref_lvl_diff
+			);
+			const uint64_t center = this->mapping.get_cell_from_indices(
+				this->mapping.get_indices(cell),
+				ref_lvl
+			);
+			if (not centers.insert(center).second) {
+				continue;
+			}
 
-	/*!
-	Cell on this process and cells it considers as neighbors
+			const auto search_indices = this->indices_from_neighborhood(
+				this->mapping.get_indices(center),
+				this->mapping.get_cell_length_in_indices(center),
+				cube
+			);
+			for (const auto& indices: search_indices) {
+				if (indices[0] == error_index) {
+					continue;
+				}
 
-	Owner(s) of neighbors_of send user data of neighbors_of to owner
-	of the cell during remote neighbor data update.
-	*/
-	std::unordered_map<
-		uint64_t,
-		std::vector<
-			std::pair<
-				uint64_t,
-				std::array<int, 4>
-			>
-		>
-	> neighbors_of;
+				uint64_t current = this->mapping.get_cell_from_indices(indices, ref_lvl);
+				if (not near.insert(current).second) {
+					continue;
+				}
 
-	/*
-	Offsets of cells that are considered as neighbors of a cell and
-	offsets of cells that consider a cell as a neighbor
-	*/
-	std::vector<Types<3>::neighborhood_item_t> neighborhood_of, neighborhood_to;
+				while (this->mapping.get_refinement_level(current) > 0) {
+					current = this->mapping.get_parent(current);
+					if (not ancestors_of_near.insert(current).second) {
+						break;
+					}
+				}
+			}
+		}
+	}
 
-	/*
-	User defined versions of neighborhood_of and _to.
-	*/
-	std::unordered_map<
-		int, // user defined id of neighborhood
-		std::vector<Types<3>::neighborhood_item_t>
-	> user_hood_of, user_hood_to;
 
 	/*!
-	Cell on this process and those cells that aren't neighbors of
-	this cell but whose neighbor this cell is.
-	For example with a stencil size of 1 in the following grid:
-\verbatim
-|-----------|
-|     |5 |6 |
-|  1  |--|--|
-|     |9 |10|
-|-----------|
-\endverbatim
-	neighbors_to[6] = 1 because neighbors[6] = 5, 9, 10 while
-	neighbors_to[5] is empty because neighbors[5] = 1, 6, 9, 10
-	*/
-	std::unordered_map<
-		uint64_t,
-		std::vector<
-			std::pair<
-				uint64_t,
-				std::array<int, 4>
-			>
-		>
-	> neighbors_to;
+	Returns true if given cell overlaps any cell in near.
 
-	/*
-	User defined versions of neighbors_of and _to
+	\see get_cells_near()
 	*/
-	std::unordered_map<
-		int, // user defined id of neighbor lists
-		std::unordered_map< // same as neighbors_of and _to
-			uint64_t, // TODO named struct would be more readable...
-			std::vector<
-				std::pair<
-					uint64_t,
-					std::array<int, 4>
-				>
-			>
-		>
-	> user_neigh_of, user_neigh_to;
+	bool overlaps_cells_near(
+		const uint64_t cell,
+		const std::unordered_set<uint64_t>& near,
+		const std::unordered_set<uint64_t>& ancestors_of_near
+	) const {
+		if (ancestors_of_near.count(cell) > 0) {
+			return true;
+		}
 
-	// on which process every cell in the grid is
-	std::unordered_map<uint64_t, uint64_t> cell_process;
+		uint64_t current = cell;
+		while (true) {
+			if (near.count(current) > 0) {
+				return true;
+			}
+			if (this->mapping.get_refinement_level(current) == 0) {
+				return false;
+			}
+			current = this->mapping.get_parent(current);
+		}
+	}
 
-	// cells on this process that have a neighbor on another
-	// process or are considered as a neighbor of a cell on another process
-	std::unordered_set<uint64_t> local_cells_on_process_boundary;
 
-	// cells on other processes that have a neighbor on this process
-	// or are considered as a neighbor of a cell on this process
-	std::unordered_set<uint64_t> remote_cells_on_process_boundary;
+	/*!
+	Adds all existing cells near given cells into cell_process.
 
-	/*
-	User defined versions of local_cells_on_process_boundary and remote_cells_on_process_boundary
+	Also adds the first child of every cell overlapping the
+	area near given cells so that get_child() is correct for them.
+	Must be called simultaneously on all processes
+	when using distributed ownership.
+
+	\see get_cells_near()
 	*/
-	std::unordered_map<
-		int, // user defined id of neighbor lists
-		std::unordered_set<uint64_t>
-	> user_local_cells_on_process_boundary, user_remote_cells_on_process_boundary;
+	void fetch_cells_near(const std::vector<uint64_t>& cells)
+	{
+		std::unordered_set<uint64_t> near, ancestors_of_near;
+		this->get_cells_near(cells, near, ancestors_of_near);
 
-	// remote neighbors and their data, of cells on this process
-	std::unordered_map<uint64_t, Cell_Data> remote_neighbors;
+		std::unordered_set<uint64_t> candidates;
+		for (const uint64_t cell: near) {
+			candidates.insert(this->mapping.get_level_0_parent(cell));
+		}
 
-	std::unordered_map<
-		int,
-		std::vector<MPI_Request>
-	> send_requests, receive_requests;
+		// descend one refinement level at a time through existing cells
+		while (All_Reduce()(candidates.size(), this->comm) > 0) {
+			this->fetch_cell_process(
+				std::vector<uint64_t>(candidates.begin(), candidates.end())
+			);
 
-	// cells whose data has to be received / sent by this process from the process as the key
-	std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>
-		cells_to_send, cells_to_receive;
+			std::unordered_set<uint64_t> next_candidates;
+			for (const uint64_t cell: candidates) {
+				if (
+					this->cell_process.count(cell) == 0
+					or this->cell_data.count(cell) > 0
+					or this->mapping.get_refinement_level(cell)
+						>= this->mapping.get_maximum_refinement_level()
+					or not this->overlaps_cells_near(cell, near, ancestors_of_near)
+				) {
+					continue;
+				}
 
-	/*
-	User defined neighborhood versions of cells_to_send and _receive.
+				const auto children = this->mapping.get_all_children(cell);
+				next_candidates.insert(children[0]);
+				for (const uint64_t child: children) {
+					if (this->overlaps_cells_near(child, near, ancestors_of_near)) {
+						next_candidates.insert(child);
+					}
+				}
+			}
+			candidates.swap(next_candidates);
+		}
+	}
+
+
+	/*!
+	Adds cells required by execute_refines() into cell_process.
+
+	Processes of all cells to refine and all parents and siblings of
+	cells to unrefine are fetched along with cells near local refined
+	cells, remote refined cells on the process boundary and parents
+	of unrefined cells which are close to local cells.
+
+	Returns parents of unrefined cells close to local cells,
+	neighbor lists of other cells can't be affected by them.
+	Must be called simultaneously on all processes
+	when using distributed ownership.
 	*/
-	std::unordered_map<
-		int, // user defined id of neighbor lists
-		std::unordered_map<
-			int, // process to send to / receive from
-			std::vector<std::pair<uint64_t, int>>
-		>
-	> user_neigh_cells_to_send, user_neigh_cells_to_receive;
+	std::unordered_set<uint64_t> fetch_cells_to_adapt()
+	{
+		std::vector<uint64_t> cells(this->cells_to_refine.begin(), this->cells_to_refine.end());
 
-	// cells added to / removed from this process by load balancing
-	std::unordered_set<uint64_t> added_cells, removed_cells;
+		std::unordered_set<uint64_t> parents_of_unrefined;
+		for (const uint64_t unrefined: this->cells_to_unrefine) {
+			parents_of_unrefined.insert(this->mapping.get_parent(unrefined));
+		}
+		for (const uint64_t parent: parents_of_unrefined) {
+			cells.push_back(parent);
+			for (const uint64_t sibling: this->mapping.get_all_children(parent)) {
+				cells.push_back(sibling);
+			}
+		}
+		this->fetch_cell_process(cells);
+		cells.clear();
 
-	// cells to be refined / unrefined after a call to stop_refining()
-	std::unordered_set<uint64_t> cells_to_refine, cells_to_unrefine, all_to_unrefine;
+		std::vector<uint64_t> local_cells;
+		local_cells.reserve(this->cell_data.size());
+		for (const auto& item: this->cell_data) {
+			local_cells.push_back(item.first);
+		}
 
-	// cells that shouldn't be refined / unrefined after a call to stop_refining()
-	std::unordered_set<uint64_t> cells_not_to_refine, cells_not_to_unrefine;
+		std::unordered_set<uint64_t> near, ancestors_of_near;
+		this->get_cells_near(local_cells, near, ancestors_of_near);
+		local_cells.clear();
 
-	// stores user data of cells whose children were created while refining
-	std::unordered_map<uint64_t, Cell_Data> refined_cell_data;
-	// stores user data of cells that were removed while unrefining
-	std::unordered_map<uint64_t, Cell_Data> unrefined_cell_data;
+		for (const uint64_t refined: this->cells_to_refine) {
+			if (
+				this->is_local(refined)
+				or this->remote_cells_on_process_boundary.count(refined) > 0
+			) {
+				cells.push_back(refined);
+			}
+		}
 
-	// cell that should be kept on a particular process
-	std::unordered_map<uint64_t, uint64_t> pin_requests;
-	// pin requests given since that last time load was balanced
-	std::unordered_map<uint64_t, uint64_t> new_pin_requests;
+		std::unordered_set<uint64_t> parents_near_local;
+		for (const uint64_t parent: parents_of_unrefined) {
+			if (
+				this->is_local(parent)
+				or this->overlaps_cells_near(parent, near, ancestors_of_near)
+			) {
+				parents_near_local.insert(parent);
+				cells.push_back(parent);
+			}
+		}
 
-	// variables for load balancing using Zoltan
-	Zoltan_Struct* zoltan;
-	// number of processes per part in a hierarchy level (numbering starts from 0)
-	std::vector<unsigned int> processes_per_part;
-	// options for each level of hierarchial load balancing (numbering start from 0)
-	std::vector<std::unordered_map<std::string, std::string>> partitioning_options;
-	// record whether Zoltan_LB_Partition is expected to fail
-	// (when the user selects NONE as the load balancing algorithm)
-	bool no_load_balancing;
-	// reserved options that the user cannot change
-	std::unordered_set<std::string> reserved_options;
+		this->fetch_cells_near(cells);
 
-	// optional user-given weights of cells on this process
-	std::unordered_map<uint64_t, double> cell_weights;
+		return parents_near_local;
+	}
 
-	// processes which have cells close enough from cells of this process
-	std::unordered_set<uint64_t> neighbor_processes;
 
-	bool balancing_load = false;
-	bool refining = false;
+	/*!
+	Removes unnecessary cells from cell_process and updates cell_directory.
+
+	Keeps local cells, cells in neighbor lists and pinned
+	cells along with their ancestors and all cells near
+	local cells, and stores the processes of local cells
+	and their ancestors in cell_directory.
+	Must be called simultaneously on all processes
+	when using distributed ownership.
+	*/
+	void update_cell_directory()
+	{
+		std::vector<uint64_t> local_cells;
+		local_cells.reserve(this->cell_data.size());
+		for (const auto& item: this->cell_data) {
+			local_cells.push_back(item.first);
+		}
 
+		std::unordered_set<uint64_t> near, ancestors_of_near;
+		this->get_cells_near(local_cells, near, ancestors_of_near);
 
-	//! stores begin and end iterators for range-based for loop
-	template<class T> struct Iterator_Storage {
-		typename std::vector<T>::const_iterator begin_, end_ /*TODO: = nullptr (c++14)*/;
-		typename std::vector<T>::const_iterator begin() const { return this->begin_; }
-		typename std::vector<T>::const_iterator cbegin() const { return this->begin_; }
-		typename std::vector<T>::const_iterator end() const { return this->end_; }
-		typename std::vector<T>::const_iterator cend() const { return this->end_; }
-	};
+		std::unordered_set<uint64_t> keep(local_cells.begin(), local_cells.end());
+		const auto add_to_keep = [&keep](
+			const std::unordered_map<
+				uint64_t,
+				std::vector<std::pair<uint64_t, std::array<int, 4>>>
+			>& neighbor_lists
+		) {
+			for (const auto& item: neighbor_lists) {
+				keep.insert(item.first);
+				for (const auto& neighbor: item.second) {
+					keep.insert(neighbor.first);
+				}
+			}
+		};
+		add_to_keep(this->neighbors_of);
+		add_to_keep(this->neighbors_to);
+		for (const auto& item: this->user_neigh_of) {
+			add_to_keep(item.second);
+		}
+		for (const auto& item: this->user_neigh_to) {
+			add_to_keep(item.second);
+		}
+		for (const auto& item: this->pin_requests) {
+			keep.insert(item.first);
+		}
+		keep.erase(error_cell);
 
+		std::vector<uint64_t> ancestors;
+		for (const uint64_t cell: keep) {
+			uint64_t current = cell;
+			while (this->mapping.get_refinement_level(current) > 0) {
+				current = this->mapping.get_parent(current);
+				ancestors.push_back(current);
+			}
+		}
+		keep.insert(ancestors.begin(), ancestors.end());
+		ancestors.clear();
 
-	struct Neighbors_Item : Additional_Neighbor_Items... {
-		uint64_t id;
-		Cell_Data* data;
-		/*!
-		Neighbor's offset from cell, in units of cell's size
+		// children of cells near local cells are needed by get_child()
+		for (auto item = this->cell_process.begin(); item != this->cell_process.end();) {
+			const uint64_t cell = item->first;
+			if (
+				keep.count(cell) > 0
+				or this->overlaps_cells_near(cell, near, ancestors_of_near)
+				or (
+					this->mapping.get_refinement_level(cell) > 0
+					and this->overlaps_cells_near(
+						this->mapping.get_parent(cell),
+						near,
+						ancestors_of_near
+					)
+				)
+			) {
+				item++;
+			} else {
+				item = this->cell_process.erase(item);
+			}
+		}
 
-		Offset of a face neighbor is always 1 regardless of denominator
-		(in one dimension, 0 in others). Offset of edge neighbor is
-		always 1 in two dimensions and offset of vertex neighbor is
-		always 1 in all dimensions.
+		// every existing cell has at least one local descendant somewhere
+		std::unordered_set<uint64_t> local_and_ancestors;
+		std::vector<std::pair<uint64_t, uint64_t>> owners;
+		for (const uint64_t cell: local_cells) {
+			uint64_t current = cell;
+			while (local_and_ancestors.insert(current).second) {
+				owners.push_back(std::make_pair(current, this->cell_process.at(current)));
+				if (this->mapping.get_refinement_level(current) == 0) {
+					break;
+				}
+				current = this->mapping.get_parent(current);
+			}
+		}
+		this->cell_directory.set(owners, this->comm);
+	}
 
-		Examples:
-		\verbatim
-		indices           |0|1|2|3|4|5|6|7|8|9|...
-		cell position     |---|
-		offset (denom = 2)    |1|2|3|4|5|6|...
-		       (denom = 1)    | 1 | 2 | 3 | 4 |...
-		       (denom = -2)   | 1 or 2| 3 or 4|...
 
-		cell position     |-------|
-		offset (denom = 4)        |1|2|3|4|5|...
-		offset (denom = 2)        | 1 | 2 |...
-		\endverbatim
+	/*!
+	Returns an estimate of memory in bytes used by given unordered container.
+	*/
+	template<class Container> static uint64_t get_container_memory_usage(
+		const Container& container
+	) {
+		return
+			container.bucket_count() * sizeof(void*)
+			+ container.size() * (sizeof(typename Container::value_type) + 2 * sizeof(void*));
+	}
 
-		\see tests/advection/solve.hpp
+
+	/*!
+	Cuts a space-filling curve through given cells into comm_size pieces of equal weight.
+
+	Given local cells are items of curve index, cell and bits of
+	the cell's weight as a double, every cell must be given by one
+	process. Cells are sorted by their index on the curve with a
+	parallel sample sort whose splitters are chosen by process 0
+	from at most 64 samples per process. Clears given cells and
+	returns pairs of cell and new process of given cells, in
+	vectors of processes that sorted them.
+
+	Must be called simultaneously on all processes.
+	*/
+	std::vector<std::vector<uint64_t>> partition_curve(
+		std::vector<std::array<uint64_t, 3>>& local
+	) {
+		const uint64_t comm_size = this->comm_size;
+
+		std::sort(local.begin(), local.end());
+
+		/*
+		Regularly spaced samples from every process are sorted by
+		process 0 which broadcasts the splitters. Samples per process
+		are limited so that process 0 doesn't need O(comm_size^2)
+		memory, uneven parts only affect the work of sorting.
 		*/
-		int x, y, z;
-		/*!
-		Denominator / divisor of offset from cell.
+		const uint64_t samples_per_process = std::min(comm_size, uint64_t(64));
+		std::vector<uint64_t> samples;
+		for (uint64_t i = 0; i < samples_per_process and local.size() > 0; i++) {
+			const auto& sampled = local[i * local.size() / samples_per_process];
+			samples.push_back(sampled[0]);
+			samples.push_back(sampled[1]);
+		}
+
+		const int number_of_samples = int(samples.size());
+		std::vector<int> sample_counts(comm_size, 0), sample_displacements(comm_size, 0);
+		int ret_val = MPI_Gather(
+			&number_of_samples,
+			1,
+			MPI_INT,
+			sample_counts.data(),
+			1,
+			MPI_INT,
+			0,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Gather failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+		for (uint64_t i = 1; i < comm_size; i++) {
+			sample_displacements[i] = sample_displacements[i - 1] + sample_counts[i - 1];
+		}
+
+		std::vector<uint64_t> all_samples;
+		if (this->rank == 0) {
+			all_samples.resize(size_t(sample_displacements.back() + sample_counts.back()));
+		}
+		// give valid buffers to gather even if no samples
+		uint64_t dummy = 0;
+		ret_val = MPI_Gatherv(
+			samples.size() > 0 ? samples.data() : &dummy,
+			number_of_samples,
+			MPI_UINT64_T,
+			all_samples.size() > 0 ? all_samples.data() : &dummy,
+			sample_counts.data(),
+			sample_displacements.data(),
+			MPI_UINT64_T,
+			0,
+			this->comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Gatherv failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		// hilbert index and cell of each splitter
+		std::vector<uint64_t> splitter_items;
+		if (this->rank == 0) {
+			std::vector<std::pair<uint64_t, uint64_t>> sorted_samples;
+			for (size_t i = 0; i + 1 < all_samples.size(); i += 2) {
+				sorted_samples.push_back(std::make_pair(all_samples[i], all_samples[i + 1]));
+			}
+			all_samples.clear();
+			std::sort(sorted_samples.begin(), sorted_samples.end());
 
-		Value is = 1 if neighbor is same size as cell, > 1 if neighbor
-		is smaller than cell and < -1 if neighbor is larger than cell.
-		Value is 2 for neighbor half the size of cell, 4 for neighbor
-		quarter the size of cell, etc.
-		Value is -2 for neighbor twice the size of cell, -4 for neighbor
-		four times the size of cell, etc.
-		*/
-		int denom;
+			for (uint64_t i = 1; i < comm_size and sorted_samples.size() > 0; i++) {
+				const auto& splitter = sorted_samples[i * sorted_samples.size() / comm_size];
+				splitter_items.push_back(splitter.first);
+				splitter_items.push_back(splitter.second);
+			}
+		}
 
+		uint64_t number_of_splitter_items = splitter_items.size();
+		ret_val = MPI_Bcast(&number_of_splitter_items, 1, MPI_UINT64_T, 0, this->comm);
+		if (ret_val == MPI_SUCCESS and number_of_splitter_items > 0) {
+			splitter_items.resize(number_of_splitter_items);
+			ret_val = MPI_Bcast(
+				splitter_items.data(),
+				int(number_of_splitter_items),
+				MPI_UINT64_T,
+				0,
+				this->comm
+			);
+		}
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Bcast failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
 
-		// everything done in update_caller() with three or more arguments
-		template<class Grid, class Cell_Item, class Neighbor_Item, class...> void update_caller(const Grid&, const Cell_Item&, const Neighbor_Item&) {}
+		std::vector<std::pair<uint64_t, uint64_t>> splitters;
+		for (size_t i = 0; i + 1 < splitter_items.size(); i += 2) {
+			splitters.push_back(std::make_pair(splitter_items[i], splitter_items[i + 1]));
+		}
 
-		/*!
-		@cell is \class Cells_Item of cell whose neighbors are being cached,
-		this update is called for each neighbor item created for that cell.
-		*/
-		template<
-			class Grid,
-			class Cell_Item,
-			class Neighbor_Item,
-			class A,
-			class... B
-		> void update_caller(
-			const Grid& grid,
-			const Cell_Item& cell,
-			const Neighbor_Item& neighbor,
-			const A& a,
-			const B&... b
-		) {
-			A::update(grid, cell, neighbor, a);
-			update_caller(grid, cell, neighbor, b...);
+		// send cells to process sorting their part of the curve
+		std::vector<std::vector<uint64_t>> to_sort(comm_size), sorting;
+		for (const auto& item: local) {
+			const uint64_t process = uint64_t(
+				std::upper_bound(
+					splitters.begin(),
+					splitters.end(),
+					std::make_pair(item[0], item[1])
+				) - splitters.begin()
+			);
+			to_sort[process].insert(to_sort[process].end(), item.begin(), item.end());
+		}
+		local.clear();
+		All_To_All()(to_sort, sorting, this->comm);
+		to_sort.clear();
+
+		// hilbert index, cell, weight and current process
+		std::vector<std::tuple<uint64_t, uint64_t, double, uint64_t>> sorted;
+		for (uint64_t process = 0; process < comm_size; process++) {
+			for (size_t i = 0; i + 2 < sorting[process].size(); i += 3) {
+				double weight = 0;
+				std::memcpy(&weight, &sorting[process][i + 2], sizeof(weight));
+				sorted.push_back(std::make_tuple(
+					sorting[process][i],
+					sorting[process][i + 1],
+					weight,
+					process
+				));
+			}
+		}
+		sorting.clear();
+		std::sort(sorted.begin(), sorted.end());
+
+		double local_weight = 0;
+		for (const auto& item: sorted) {
+			local_weight += std::get<2>(item);
+		}
+		double weight_before = 0, total_weight = 0;
+		MPI_Exscan(&local_weight, &weight_before, 1, MPI_DOUBLE, MPI_SUM, this->comm);
+		MPI_Allreduce(&local_weight, &total_weight, 1, MPI_DOUBLE, MPI_SUM, this->comm);
+		if (this->rank == 0) {
+			weight_before = 0;
+		}
+
+		// cut curve at equal weights and tell current processes
+		std::vector<std::vector<uint64_t>> new_processes(comm_size), received_processes;
+		for (const auto& item: sorted) {
+			const double weight = std::get<2>(item);
+			uint64_t process = 0;
+			if (total_weight > 0) {
+				process = std::min(
+					comm_size - 1,
+					uint64_t((weight_before + weight / 2) * double(comm_size) / total_weight)
+				);
+			}
+			weight_before += weight;
+
+			new_processes[std::get<3>(item)].push_back(std::get<1>(item));
+			new_processes[std::get<3>(item)].push_back(process);
 		}
-	};
+		sorted.clear();
+		All_To_All()(new_processes, received_processes, this->comm);
+		new_processes.clear();
 
-	std::vector<Neighbors_Item> neighbors_rw;
+		return received_processes;
+	}
 
-public:
-	/*!
-	Neighbors of cells owned by this process.
 
-	See \cells for iterating over neighbors of specific cells.
+	/*!
+	Partitions local cells along a Hilbert curve without Zoltan.
 
-	Offset of neighbor that's larger than cell depends on
-	neighbor's position in cell's neighbor list. If cell's
-	neighborhood overlaps a larger neighbor more than once,
-	that neighbor will be included several times with offsets
-	corresponding to each neighborhood item.
+	The curve is cut into comm_size pieces of equal weight with
+	partition_curve() using cell_weights (1 for cells without a weight).
+	With several weights per cell the weight of a cell is the
+	maximum of its weights divided by their total over all cells.
+	Cells that move from this process and their new processes are
+	stored into cells_to_send and receivers, cells that move to this
+	process and their current processes into cells_to_receive and
+	senders.
 
-	In most cases contains cells multiple times.
+	Must be called simultaneously on all processes.
+	\see set_load_balancing_method()
 	*/
-	const std::vector<Neighbors_Item>& neighbors = this->neighbors_rw;
-
-private:
-	struct Cells_Item : Additional_Cell_Items...
-	{
-		uint64_t id = error_cell;
-		Cell_Data* data = nullptr;
-		Iterator_Storage<Neighbors_Item>
-			//! iterator to cells considered as neighbor by this cell
-			neighbors_of,
-			//! iterator to cells that consider this one as neighbor
-			neighbors_to;
+	void make_hilbert_partition(
+		std::vector<ZOLTAN_ID_TYPE>& cells_to_send,
+		std::vector<int>& receivers,
+		std::vector<ZOLTAN_ID_TYPE>& cells_to_receive,
+		std::vector<int>& senders
+	) {
+		cells_to_send.clear();
+		receivers.clear();
+		cells_to_receive.clear();
+		senders.clear();
+
+		const uint64_t comm_size = this->comm_size;
+
+		// drop bits of indices that don't fit into the curve
+		const auto& grid_length = this->length.get();
+		const uint64_t max_index
+			= (*std::max_element(grid_length.begin(), grid_length.end())
+			<< this->mapping.get_maximum_refinement_level()) - 1;
+		unsigned int index_bits = 0;
+		while (index_bits < 64 and (max_index >> index_bits) > 0) {
+			index_bits++;
+		}
+		const unsigned int shift = index_bits > 21 ? index_bits - 21 : 0;
+
+		const uint64_t number_of_weights = this->get_number_of_cell_weights();
+		std::vector<double> total_weights(number_of_weights, 0);
+		if (number_of_weights > 1) {
+			std::vector<double> local_weights(number_of_weights, 0);
+			for (const auto& item: this->cell_data) {
+				for (uint64_t i = 0; i < number_of_weights; i++) {
+					local_weights[i] += this->get_balancing_weight(item.first, i);
+				}
+			}
+			const int ret_val = MPI_Allreduce(
+				local_weights.data(),
+				total_weights.data(),
+				int(number_of_weights),
+				MPI_DOUBLE,
+				MPI_SUM,
+				this->comm
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Allreduce failed: " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
 
-		friend bool operator < (const Cells_Item& a, const Cells_Item& b)
-		{
-			return a.id < b.id;
+		// hilbert index, cell and weight of local cells
+		std::vector<std::array<uint64_t, 3>> local;
+		local.reserve(this->cell_data.size());
+		for (const auto& item: this->cell_data) {
+			double weight = 0;
+			if (number_of_weights > 1) {
+				for (uint64_t i = 0; i < number_of_weights; i++) {
+					if (total_weights[i] > 0) {
+						weight = std::max(weight, this->get_balancing_weight(item.first, i) / total_weights[i]);
+					}
+				}
+			} else {
+				weight = this->get_balancing_weight(item.first);
+			}
+			uint64_t weight_bits = 0;
+			std::memcpy(&weight_bits, &weight, sizeof(weight));
+			local.push_back({{this->get_hilbert_index(item.first, shift), item.first, weight_bits}});
 		}
 
-		// everything done in update_caller() with three or more arguments
-		template<class Grid, class Cell, class...> void update_caller(const Grid&, const Cell&) {}
+		// cells' new processes
+		const auto received_processes = this->partition_curve(local);
 
-		template<
-			class Grid,
-			class Cell,
-			class A,
-			class... B
-		> void update_caller(
-			const Grid& grid,
-			const Cell& cell,
-			const A& a,
-			const B&... b
-		) {
-			A::update(grid, cell, a);
-			update_caller(grid, cell, b...);
+		// tell new processes which cells they receive
+		std::vector<std::vector<uint64_t>> sent(comm_size), received;
+		for (const auto& process_cells: received_processes) {
+			for (size_t i = 0; i + 1 < process_cells.size(); i += 2) {
+				const uint64_t cell = process_cells[i], process = process_cells[i + 1];
+				if (process == this->rank) {
+					continue;
+				}
+				cells_to_send.push_back(ZOLTAN_ID_TYPE(cell));
+				receivers.push_back(int(process));
+				sent[process].push_back(cell);
+			}
 		}
-	};
-	// writable version of this->cells
-	std::vector<Cells_Item> cells_rw;
+		All_To_All()(sent, received, this->comm);
+
+		for (uint64_t process = 0; process < comm_size; process++) {
+			for (const uint64_t cell: received[process]) {
+				cells_to_receive.push_back(ZOLTAN_ID_TYPE(cell));
+				senders.push_back(int(process));
+			}
+		}
+	}
+
 
-public:
 	/*!
-	Cells owned by this process (TODO: and their remote neighbors)
+	Gives an equal share of given cell's value in given map to given children.
 
-	Provides fast iteration over cells owned by this process (TODO:
-	and local copy of their neighbors owned by other processes).
-	The following members are available:
-		- id, unique id of cell
-		- data, pointer to cell's data (Cell_Data given by user)
-		- neighbors_of, iterators to cells considered as neighbor by this one
-		- neighbors_to, iterators to cells that consider this one as neighbor
+	Removes the cell from the map, does nothing if it isn't there.
+	*/
+	void split_cell_cost(
+		const uint64_t cell,
+		const std::vector<uint64_t>& children,
+		std::unordered_map<uint64_t, double>& costs
+	) {
+		const auto cost = costs.find(cell);
+		if (cost == costs.end() or children.size() == 0) {
+			return;
+		}
 
-	Example where every process prints the id and address of every local cell:
-	\verbatim
-	struct Cell_Data {...};
-	dccrg<Cell_Data> grid;
-	...
-	for (const auto& cell: grid.local_cells) {
-		cout << "Data of cell " << cell.id << " is stored at " << cell.data << endl;
+		const double child_cost = cost->second / double(children.size());
+		costs.erase(cost);
+		for (const uint64_t child: children) {
+			costs[child] = child_cost;
+		}
 	}
-	\endverbatim
-	\see examples/simple_game_of_life.cpp Neighbors_Item
-	*/
-	const std::vector<Cells_Item>& cells = this->cells_rw;
+
 
 	/*!
-	Holds iterators for fast iteration over a subset of cells owned by this process.
+	Moves times from cell_time_slots into measured_cell_times.
 
-	Example:
-	\verbatim
-	struct Cell_Data {...};
-	dccrg<Cell_Data> grid;
-	...
-	for (const auto& cell: grid.inner_cells) {
-		use data of neighbors of cell here...
-	}
-	grid.update_copies_of_remote_neighbors();
-	for (const auto& cell: grid.outer_cells) {
-		use data of neighbors of cell here...
-	}
-	\endverbatim
+	Must be called before cells change their positions in
+	cells, e.g. at the start of update_cell_pointers().
 	*/
-	Iterator_Storage<Cells_Item>
-		//! iterator over local cells without neighbors on other processes
-		inner_cells{this->cells.cbegin(), this->cells.cbegin()},
-		//! iterator over local cells with neighbor(s) on other processes
-		outer_cells{this->cells.cbegin(), this->cells.cbegin()},
-		//! iterator over local cells
-		local_cells{this->cells.cbegin(), this->cells.cbegin()},
-		//! iterator over copies of cells of other processes that have neighbor(s) on this process
-		remote_cells{this->cells.cbegin(), this->cells.cbegin()};
+	void collect_cell_times()
+	{
+		auto& slots = this->cell_time_slots.times;
+		for (size_t i = 0; i < slots.size() and i < this->cells.size(); i++) {
+			const double time = slots[i].exchange(0);
+			if (time != 0) {
+				this->measured_cell_times[this->cells[i].id] += time;
+			}
+		}
+	}
 
 
-private:
+	/*!
+	Updates estimated costs of local cells from measured times and sets cell weights from them.
 
-	/*
-	Variables related to file I/O when loading grid data.
+	Weights set with set_cell_weight() aren't changed.
+	Must be called simultaneously on all processes.
 	*/
+	void update_cell_costs()
+	{
+		this->collect_cell_times();
+		for (const auto& item: this->measured_cell_times) {
+			if (this->cell_data.count(item.first) == 0) {
+				continue;
+			}
 
-	MPI_File grid_data_file;
+			const auto cost = this->cell_costs.find(item.first);
+			if (cost == this->cell_costs.end()) {
+				this->cell_costs[item.first] = item.second;
+			} else {
+				cost->second
+					= this->cell_cost_smoothing * item.second
+					+ (1 - this->cell_cost_smoothing) * cost->second;
+			}
+		}
+		this->measured_cell_times.clear();
 
-	// each local cells' data offset in bytes when reading from a file
-	std::vector<std::pair<uint64_t, uint64_t> > cells_and_data_displacements;
+		for (auto item = this->cell_costs.begin(); item != this->cell_costs.end(); ) {
+			if (this->cell_data.count(item->first) == 0) {
+				item = this->cell_costs.erase(item);
+			} else {
+				item++;
+			}
+		}
 
+		std::array<double, 2> local{{0, 0}}, total{{0, 0}};
+		for (const auto& item: this->cell_costs) {
+			local[0] += item.second;
+			local[1]++;
+		}
+		const int ret_val = MPI_Allreduce(local.data(), total.data(), 2, MPI_DOUBLE, MPI_SUM, this->comm);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Allreduce failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+		const double average_cost = total[1] > 0 ? total[0] / total[1] : 1;
 
+		for (const auto& item: this->cell_data) {
+			if (this->cell_weights.count(item.first) > 0) {
+				continue;
+			}
+			const auto cost = this->cell_costs.find(item.first);
+			this->cell_weights[item.first]
+				= cost == this->cell_costs.end() ? average_cost : cost->second;
+		}
+	}
 
 
 	/*!
-	Checks and initializes MPI related stuff.
+	Sends estimated costs of cells to be migrated to their receivers.
+
+	Must be called by all processes after send lists
+	of load balancing have been created.
 	*/
-	bool initialize_mpi(const MPI_Comm& given_comm)
+	void send_cell_costs()
 	{
-		int ret_val = -1;
+		std::unordered_set<int> processes;
+		std::unordered_map<int, std::vector<uint64_t>> to_send, received;
+		for (const auto& item: this->cells_to_send) {
+			processes.insert(item.first);
+			auto& values = to_send[item.first];
+			for (const auto& cell_item: item.second) {
+				const auto cost = this->cell_costs.find(cell_item.first);
+				if (cost == this->cell_costs.end()) {
+					continue;
+				}
+				uint64_t cost_bits = 0;
+				std::memcpy(&cost_bits, &(cost->second), sizeof(cost_bits));
+				values.push_back(cell_item.first);
+				values.push_back(cost_bits);
+				this->cell_costs.erase(cost);
+			}
+		}
+		for (const auto& item: this->cells_to_receive) {
+			processes.insert(item.first);
+		}
 
-		/*
-		Setup MPI related stuff
-		*/
+		Some_To_Some()(to_send, processes, received, this->some_to_some_comm);
 
-		ret_val = MPI_Comm_dup(given_comm, &this->comm);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't duplicate communicator: " << Error_String()(ret_val)
-				<< std::endl;
-			return false;
+		for (const auto& item: received) {
+			for (size_t i = 0; i + 1 < item.second.size(); i += 2) {
+				double cost = 0;
+				std::memcpy(&cost, &(item.second[i + 1]), sizeof(cost));
+				this->cell_costs[item.second[i]] = cost;
+			}
 		}
+	}
 
-		int temp_size = 0;
-		ret_val = MPI_Comm_size(this->comm, &temp_size);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't get size of communicator: " << Error_String()(ret_val)
-				<< std::endl;
-			return false;
+
+	/*!
+	Returns the weight of given local cell used in load balancing.
+	*/
+	double get_balancing_weight(const uint64_t cell) const
+	{
+		return this->cell_weights.count(cell) > 0 ? this->cell_weights.at(cell) : 1;
+	}
+
+	/*!
+	Returns the weight with given index of given local cell used in load balancing.
+	*/
+	double get_balancing_weight(const uint64_t cell, const uint64_t index) const
+	{
+		if (index == 0) {
+			return this->get_balancing_weight(cell);
 		}
-		if (temp_size < 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Negative MPI comm size not supported: " << temp_size
-				<< std::endl;
-			return false;
+
+		const auto weights = this->additional_cell_weights.find(cell);
+		if (weights == this->additional_cell_weights.end() or index > weights->second.size()) {
+			return 1;
 		}
-		this->comm_size = (uint64_t) temp_size;
+		return weights->second[index - 1];
+	}
 
-		int temp_rank = 0;
-		ret_val = MPI_Comm_rank(this->comm, &temp_rank);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't get rank for communicator: " << Error_String()(ret_val)
-				<< std::endl;
-			return false;
+
+	/*!
+	Returns the largest number of weights of any cell on any process.
+
+	Must be called simultaneously on all processes.
+	*/
+	uint64_t get_number_of_cell_weights()
+	{
+		uint64_t local_number = 1;
+		for (const auto& item: this->additional_cell_weights) {
+			local_number = std::max(local_number, uint64_t(1 + item.second.size()));
 		}
-		if (temp_rank < 0) {
+
+		uint64_t number = 1;
+		const int ret_val = MPI_Allreduce(&local_number, &number, 1, MPI_UINT64_T, MPI_MAX, this->comm);
+		if (ret_val != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Negative MPI rank not supported: " << temp_rank
+				<< " MPI_Allreduce failed: " << Error_String()(ret_val)
 				<< std::endl;
 			abort();
 		}
-		this->rank = (uint64_t) temp_rank;
+		return number;
+	}
 
-		// get maximum tag value
-		int attr_flag = -1, *attr = NULL;
-		ret_val = MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &attr, &attr_flag);
-		if (ret_val != MPI_SUCCESS) {
+
+	/*!
+	Returns the number of bytes sent from given local cell to given process when balancing load.
+	*/
+	uint64_t get_migrated_bytes(const uint64_t cell, const int receiver)
+	{
+		void* address = NULL;
+		int count = -1;
+		MPI_Datatype datatype = MPI_DATATYPE_NULL;
+		std::tie(
+			address,
+			count,
+			datatype
+		) = detail::get_cell_mpi_datatype(
+			this->cell_data.at(cell),
+			cell,
+			(int) this->rank,
+			receiver,
+			false,
+			-2
+		);
+
+		int datatype_size = 0;
+		if (MPI_Type_size(datatype, &datatype_size) != MPI_SUCCESS) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Couldn't get MPI_TAG_UB: " << Error_String()(ret_val)
+				<< " Process " << this->rank
+				<< " Couldn't get size of datatype of cell " << cell
 				<< std::endl;
 			abort();
 		}
-		if (attr == NULL) {
-			// guaranteed by MPI
-			this->max_tag = 32767;
-		} else {
-			this->max_tag = (unsigned int) *attr;
+		if (!Is_Named_Datatype()(datatype)) {
+			MPI_Type_free(&datatype);
 		}
 
-		return true;
+		return uint64_t(datatype_size) * uint64_t(std::max(0, count));
 	}
 
+
 	/*!
-	Initializes Zoltan related stuff.
+	Partitions cells by diffusing weight between neighboring processes.
+
+	Every process exchanges its total weight of cells with
+	neighbor_processes diffusion_iterations times and accumulates
+	the weight flowing to each neighbor, with diffusion
+	coefficients 1 / (1 + maximum number of neighbors of either
+	process). Outflow is limited to incremental_migration_limit
+	of local weight and is realized by offering local cells
+	on process boundaries with the most neighbors on the
+	receiving process first. Receivers accept offered cells
+	only up to their weight after diffusion plus their accepted
+	outflow, repeated until no process rejects more cells, so
+	no process ends up with more weight than the maximum of its
+	current weight and its weight after diffusion and the
+	maximum weight of processes never increases.
+	Stores results like make_hilbert_partition().
+
+	Must be called simultaneously on all processes.
+	\see set_incremental_load_balancing()
 	*/
-	bool initialize_zoltan()
-	{
-		int ret_val = -1;
+	void make_diffusive_partition(
+		std::vector<ZOLTAN_ID_TYPE>& cells_to_send,
+		std::vector<int>& receivers,
+		std::vector<ZOLTAN_ID_TYPE>& cells_to_receive,
+		std::vector<int>& senders
+	) {
+		cells_to_send.clear();
+		receivers.clear();
+		cells_to_receive.clear();
+		senders.clear();
 
-		MPI_Comm temp; // give a separate comminucator to zoltan
-		ret_val = MPI_Comm_dup(this->comm, &temp);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << "Couldn't duplicate communicator for Zoltan" << std::endl;
-			return false;
+		std::unordered_set<int> neighbors;
+		for (const uint64_t process: this->neighbor_processes) {
+			if (process != this->rank) {
+				neighbors.insert(int(process));
+			}
 		}
-		this->zoltan = Zoltan_Create(temp);
-		if (this->zoltan == NULL) {
-			std::cerr << "Zoltan_Create failed" << std::endl;
-			return false;
+
+		double local_weight = 0;
+		for (const auto& item: this->cell_data) {
+			local_weight += this->get_balancing_weight(item.first);
 		}
 
-		// check whether Zoltan_LB_Partition is expected to fail
-		if (this->load_balancing_method == "NONE") {
-			this->no_load_balancing = true;
-		} else {
-			this->no_load_balancing = false;
+		const auto double_to_uint64 = [](const double value) {
+			uint64_t result = 0;
+			std::memcpy(&result, &value, sizeof(value));
+			return result;
+		};
+		const auto uint64_to_double = [](const uint64_t value) {
+			double result = 0;
+			std::memcpy(&result, &value, sizeof(value));
+			return result;
+		};
+
+		// number of neighbors of neighbors
+		std::unordered_map<int, std::vector<uint64_t>> to_send, received;
+		for (const int neighbor: neighbors) {
+			to_send[neighbor] = {uint64_t(neighbors.size())};
+		}
+		Some_To_Some()(to_send, neighbors, received, this->some_to_some_comm);
+		std::unordered_map<int, double> coefficients;
+		for (const int neighbor: neighbors) {
+			const uint64_t neighbor_neighbors
+				= received.count(neighbor) > 0 and received.at(neighbor).size() > 0
+				? received.at(neighbor)[0]
+				: 0;
+			coefficients[neighbor]
+				= 1.0 / double(1 + std::max(uint64_t(neighbors.size()), neighbor_neighbors));
+		}
+
+		// weight flowing to each neighbor, negative if from neighbor
+		std::unordered_map<int, double> flows;
+		double weight = local_weight;
+		for (unsigned int iteration = 0; iteration < diffusion_iterations; iteration++) {
+			for (const int neighbor: neighbors) {
+				to_send[neighbor] = {double_to_uint64(weight)};
+			}
+			Some_To_Some()(to_send, neighbors, received, this->some_to_some_comm);
+
+			double change = 0;
+			for (const int neighbor: neighbors) {
+				if (received.count(neighbor) == 0 or received.at(neighbor).size() == 0) {
+					continue;
+				}
+				const double flow
+					= coefficients.at(neighbor)
+					* (weight - uint64_to_double(received.at(neighbor)[0]));
+				flows[neighbor] += flow;
+				change -= flow;
+			}
+			weight += change;
+		}
+
+		double outflow = 0;
+		for (const auto& item: flows) {
+			outflow += std::max(0.0, item.second);
+		}
+		const double
+			max_outflow = this->incremental_migration_limit * local_weight,
+			scale = outflow > max_outflow ? max_outflow / outflow : 1;
+
+		// offer cells with most neighbors on receiver first
+		std::unordered_set<uint64_t> offered;
+		std::unordered_map<int, std::vector<uint64_t>> offers;
+		std::vector<int> sorted_neighbors(neighbors.begin(), neighbors.end());
+		std::sort(sorted_neighbors.begin(), sorted_neighbors.end());
+		for (const int neighbor: sorted_neighbors) {
+			const double max_flow = scale * flows[neighbor];
+			if (max_flow <= 0) {
+				continue;
+			}
+
+			std::vector<std::pair<uint64_t, uint64_t>> candidates;
+			for (const uint64_t cell: this->local_cells_on_process_boundary) {
+				if (
+					offered.count(cell) > 0
+					or this->pin_requests.count(cell) > 0
+					or this->neighbors_of.count(cell) == 0
+				) {
+					continue;
+				}
+				uint64_t neighbors_on_receiver = 0;
+				for (const auto& neighbor_item: this->neighbors_of.at(cell)) {
+					const auto owner = this->cell_process.find(neighbor_item.first);
+					if (owner != this->cell_process.end() and owner->second == uint64_t(neighbor)) {
+						neighbors_on_receiver++;
+					}
+				}
+				if (neighbors_on_receiver > 0) {
+					candidates.push_back(std::make_pair(~neighbors_on_receiver, cell));
+				}
+			}
+			std::sort(candidates.begin(), candidates.end());
+
+			double flow = 0;
+			for (const auto& candidate: candidates) {
+				const uint64_t cell = candidate.second;
+				const double cell_weight = this->get_balancing_weight(cell);
+				if (flow + cell_weight > max_flow) {
+					continue;
+				}
+				flow += cell_weight;
+				offered.insert(cell);
+				// cell and its weight
+				offers[neighbor].push_back(cell);
+				offers[neighbor].push_back(double_to_uint64(cell_weight));
+			}
 		}
 
-		// reserved options that the user cannot change
-		this->reserved_options.insert("EDGE_WEIGHT_DIM");
-		this->reserved_options.insert("NUM_GID_ENTRIES");
-		this->reserved_options.insert("NUM_LID_ENTRIES");
-		this->reserved_options.insert("OBJ_WEIGHT_DIM");
-		this->reserved_options.insert("RETURN_LISTS");
-		this->reserved_options.insert("NUM_GLOBAL_PARTS");
-		this->reserved_options.insert("NUM_LOCAL_PARTS");
-		this->reserved_options.insert("AUTO_MIGRATE");
+		std::unordered_map<int, std::vector<uint64_t>> received_offers;
+		Some_To_Some()(offers, neighbors, received_offers, this->some_to_some_comm);
 
 		/*
-		Set reserved options
+		Number of offered cells accepted by this process from
+		each neighbor and by each neighbor from this process,
+		prefixes of offers. Receivers decrease the number of
+		accepted cells until their inflow is at most their weight
+		after diffusion minus remaining weight, which increases
+		when other receivers reject cells.
 		*/
-		// 0 because Zoltan crashes in hierarchial with larger values
-		Zoltan_Set_Param(this->zoltan, "EDGE_WEIGHT_DIM", "0");
-		Zoltan_Set_Param(this->zoltan, "NUM_GID_ENTRIES", "1");
-		Zoltan_Set_Param(this->zoltan, "NUM_LID_ENTRIES", "0");
-		Zoltan_Set_Param(this->zoltan, "OBJ_WEIGHT_DIM", "1");
-		Zoltan_Set_Param(this->zoltan, "RETURN_LISTS", "ALL");
+		std::unordered_map<int, uint64_t> accepted_in, accepted_out;
+		for (const int neighbor: neighbors) {
+			accepted_in[neighbor]
+				= received_offers.count(neighbor) > 0
+				? received_offers.at(neighbor).size() / 2
+				: 0;
+			accepted_out[neighbor]
+				= offers.count(neighbor) > 0
+				? offers.at(neighbor).size() / 2
+				: 0;
+		}
+
+		while (true) {
+			double outflow = 0;
+			for (const int neighbor: neighbors) {
+				for (uint64_t i = 0; i < accepted_out.at(neighbor); i++) {
+					outflow += uint64_to_double(offers.at(neighbor)[2 * i + 1]);
+				}
+			}
+			const double max_inflow = std::max(0.0, weight - (local_weight - outflow));
+
+			uint64_t rejected = 0;
+			double inflow = 0;
+			for (const int neighbor: sorted_neighbors) {
+				uint64_t& accepted = accepted_in.at(neighbor);
+				for (uint64_t i = 0; i < accepted; i++) {
+					const double cell_weight = uint64_to_double(received_offers.at(neighbor)[2 * i + 1]);
+					if (inflow + cell_weight > max_inflow) {
+						rejected += accepted - i;
+						accepted = i;
+						break;
+					}
+					inflow += cell_weight;
+				}
+			}
 
-		// set other options
-		Zoltan_Set_Param(this->zoltan, "DEBUG_LEVEL", "0");
-		Zoltan_Set_Param(this->zoltan, "HIER_DEBUG_LEVEL", "0");
-		Zoltan_Set_Param(this->zoltan, "HIER_CHECKS", "0");
-		Zoltan_Set_Param(this->zoltan, "LB_METHOD", this->load_balancing_method.c_str());
-		Zoltan_Set_Param(this->zoltan, "REMAP", "1");
+			if (All_Reduce()(rejected, this->comm) == 0) {
+				break;
+			}
 
-		// set the grids callback functions in Zoltan
-		Zoltan_Set_Num_Obj_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::get_number_of_cells,
-			this
-		);
+			for (const int neighbor: neighbors) {
+				to_send[neighbor] = {accepted_in.at(neighbor)};
+			}
+			Some_To_Some()(to_send, neighbors, received, this->some_to_some_comm);
+			for (const int neighbor: neighbors) {
+				if (received.count(neighbor) > 0 and received.at(neighbor).size() > 0) {
+					accepted_out.at(neighbor) = received.at(neighbor)[0];
+				}
+			}
+		}
 
-		Zoltan_Set_Obj_List_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_cell_list,
-			this
-		);
+		for (const int neighbor: sorted_neighbors) {
+			for (uint64_t i = 0; i < accepted_out.at(neighbor); i++) {
+				cells_to_send.push_back(ZOLTAN_ID_TYPE(offers.at(neighbor)[2 * i]));
+				receivers.push_back(neighbor);
+			}
+			for (uint64_t i = 0; i < accepted_in.at(neighbor); i++) {
+				cells_to_receive.push_back(ZOLTAN_ID_TYPE(received_offers.at(neighbor)[2 * i]));
+				senders.push_back(neighbor);
+			}
+		}
+	}
 
-		Zoltan_Set_Num_Geom_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::get_grid_dimensionality,
-			NULL
-		);
 
-		Zoltan_Set_Geom_Multi_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_with_cell_coordinates,
-			this
-		);
+	/*!
+	Returns total halo size of all processes now and after migrating cells in current send lists.
 
-		Zoltan_Set_Num_Edges_Multi_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_number_of_neighbors_for_cells,
-			this
-		);
+	\see Load_Balance_Estimate
+	Must be called simultaneously on all processes
+	after send lists of load balancing have been created.
+	*/
+	std::array<uint64_t, 2> get_halo_sizes()
+	{
+		// new processes of migrating local cells and their remote neighbors
+		std::unordered_map<uint64_t, uint64_t> new_processes;
+		for (const auto& item: this->cells_to_send) {
+			for (const auto& cell_item: item.second) {
+				new_processes[cell_item.first] = uint64_t(item.first);
+			}
+		}
 
-		Zoltan_Set_Edge_List_Multi_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_neighbor_lists,
-			this
-		);
+		std::vector<uint64_t> migrating;
+		for (const uint64_t cell: this->local_cells_on_process_boundary) {
+			const auto new_process = new_processes.find(cell);
+			if (new_process != new_processes.end()) {
+				migrating.push_back(cell);
+				migrating.push_back(new_process->second);
+			}
+		}
 
-		Zoltan_Set_HG_Size_CS_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_number_of_hyperedges,
-			this
-		);
+		std::unordered_set<int> neighbors;
+		std::unordered_map<int, std::vector<uint64_t>> to_send, received;
+		for (const uint64_t process: this->neighbor_processes) {
+			if (process != this->rank) {
+				neighbors.insert(int(process));
+				to_send[int(process)] = migrating;
+			}
+		}
+		Some_To_Some()(to_send, neighbors, received, this->some_to_some_comm);
+		for (const auto& item: received) {
+			for (size_t i = 0; i + 1 < item.second.size(); i += 2) {
+				new_processes[item.second[i]] = item.second[i + 1];
+			}
+		}
 
-		Zoltan_Set_HG_CS_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_hyperedge_lists,
-			this
-		);
+		// remote neighbors of local cells now and after migration
+		std::unordered_set<uint64_t> halo_before, halo_after;
+		std::vector<std::vector<uint64_t>> halos_to_send(this->comm_size), halos_received;
+		for (const auto& item: this->cell_data) {
+			const auto new_process_of_cell = new_processes.find(item.first);
+			const uint64_t process
+				= new_process_of_cell == new_processes.end()
+				? this->rank
+				: new_process_of_cell->second;
+
+			for (const auto* neighbor_lists: {&this->neighbors_of, &this->neighbors_to}) {
+				const auto neighbor_list = neighbor_lists->find(item.first);
+				if (neighbor_list == neighbor_lists->end()) {
+					continue;
+				}
 
-		Zoltan_Set_HG_Size_Edge_Wts_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_number_of_edge_weights,
-			this
-		);
+				for (const auto& neighbor_item: neighbor_list->second) {
+					const uint64_t neighbor = neighbor_item.first;
+					if (neighbor == error_cell) {
+						continue;
+					}
+					const auto old_process = this->cell_process.find(neighbor);
+					if (old_process == this->cell_process.end()) {
+						continue;
+					}
+					if (old_process->second != this->rank) {
+						halo_before.insert(neighbor);
+					}
 
-		Zoltan_Set_HG_Edge_Wts_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::fill_edge_weights,
-			this
-		);
+					const auto new_process_of_neighbor = new_processes.find(neighbor);
+					const uint64_t neighbor_process
+						= new_process_of_neighbor == new_processes.end()
+						? old_process->second
+						: new_process_of_neighbor->second;
+					if (neighbor_process == process) {
+						continue;
+					}
+					if (process == this->rank) {
+						halo_after.insert(neighbor);
+					} else {
+						halos_to_send[process].push_back(neighbor);
+					}
+				}
+			}
+		}
 
-		Zoltan_Set_Hier_Num_Levels_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::get_number_of_load_balancing_hierarchies,
-			this
+		for (auto& halo: halos_to_send) {
+			std::sort(halo.begin(), halo.end());
+			halo.erase(std::unique(halo.begin(), halo.end()), halo.end());
+		}
+		All_To_All()(halos_to_send, halos_received, this->comm);
+		for (const auto& halo: halos_received) {
+			halo_after.insert(halo.begin(), halo.end());
+		}
+
+		return {{
+			All_Reduce()(uint64_t(halo_before.size()), this->comm),
+			All_Reduce()(uint64_t(halo_after.size()), this->comm)
+		}};
+	}
+
+
+	/*!
+	Sets load_balance_statistics from current send lists.
+
+	Must be called simultaneously on all processes
+	after send lists of load balancing have been created.
+	*/
+	void update_load_balance_statistics()
+	{
+		double local_weight = 0;
+		for (const auto& item: this->cell_data) {
+			local_weight += this->get_balancing_weight(item.first);
+		}
+
+		std::vector<double>
+			sent_weights(this->comm_size, 0),
+			received_weights(this->comm_size, 0);
+		std::array<uint64_t, 2> moved{{0, 0}};
+		for (const auto& item: this->cells_to_send) {
+			for (const auto& cell_item: item.second) {
+				const double weight = this->get_balancing_weight(cell_item.first);
+				sent_weights[size_t(item.first)] += weight;
+				moved[0]++;
+				moved[1] += this->get_migrated_bytes(cell_item.first, item.first);
+			}
+		}
+
+		int ret_val = MPI_Alltoall(
+			sent_weights.data(),
+			1,
+			MPI_DOUBLE,
+			received_weights.data(),
+			1,
+			MPI_DOUBLE,
+			this->comm
 		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Alltoall failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
 
-		Zoltan_Set_Hier_Part_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::get_part_number,
-			this
-		);
+		std::array<double, 2> weights{{local_weight, local_weight}};
+		for (uint64_t process = 0; process < this->comm_size; process++) {
+			weights[1] += received_weights[process] - sent_weights[process];
+		}
 
-		Zoltan_Set_Hier_Method_Fn(
-			this->zoltan,
-			&Dccrg<
-				Cell_Data,
-				Geometry,
-				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
-			>::set_partitioning_options,
-			this
-		);
+		std::array<double, 2> max_weights{{0, 0}}, total_weights{{0, 0}};
+		std::array<uint64_t, 2> total_moved{{0, 0}};
+		ret_val = MPI_Allreduce(weights.data(), max_weights.data(), 2, MPI_DOUBLE, MPI_MAX, this->comm);
+		if (ret_val == MPI_SUCCESS) {
+			ret_val = MPI_Allreduce(weights.data(), total_weights.data(), 2, MPI_DOUBLE, MPI_SUM, this->comm);
+		}
+		if (ret_val == MPI_SUCCESS) {
+			ret_val = MPI_Allreduce(moved.data(), total_moved.data(), 2, MPI_UINT64_T, MPI_SUM, this->comm);
+		}
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Allreduce failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
 
-		return true;
+		const auto get_imbalance = [this](const double max, const double total) {
+			return total > 0 ? max * double(this->comm_size) / total : 1.0;
+		};
+		this->load_balance_statistics.imbalance_before = get_imbalance(max_weights[0], total_weights[0]);
+		this->load_balance_statistics.imbalance_after = get_imbalance(max_weights[1], total_weights[1]);
+		this->load_balance_statistics.cells_moved = total_moved[0];
+		this->load_balance_statistics.bytes_moved = total_moved[1];
 	}
 
 
 	/*!
-	Sets the default neighborhoods of cells.
+	Repartitions cells across processes based on user requests and
+	Zoltan if use_zoltan is true.
 
-	\see set_neighborhood_length()
+	With incremental load balancing make_diffusive_partition()
+	and with load balancing method HILBERT make_hilbert_partition()
+	is used instead of Zoltan.
+
+	Updates send & receive lists.
 	*/
-	void initialize_neighborhoods() {
-		// set neighborhood_of
-		if (this->neighborhood_length == 0) {
+	void make_new_partition(const bool use_zoltan)
+	{
+		this->update_pin_requests();
 
-			{
-			this->neighborhood_of.push_back({0, 0, -1});
+		const bool
+			use_diffusion = use_zoltan and this->incremental_load_balancing,
+			use_hilbert = use_zoltan and this->load_balancing_method == "HILBERT",
+			use_native = use_diffusion or use_hilbert;
+
+		int
+			partition_changed,
+			global_id_size,
+			local_id_size,
+			number_to_receive,
+			number_to_send,
+			*sender_processes,
+			*receiver_processes;
+
+		ZOLTAN_ID_PTR
+			global_ids_to_receive,
+			local_ids_to_receive,
+			global_ids_to_send,
+			local_ids_to_send;
+
+		// lists of Zoltan point to these with native partitioners
+		std::vector<ZOLTAN_ID_TYPE> native_cells_to_send, native_cells_to_receive;
+		std::vector<int> native_receivers, native_senders;
+
+		if (use_zoltan and not use_native) {
+			Zoltan_Set_Param(
+				this->zoltan,
+				"OBJ_WEIGHT_DIM",
+				std::to_string(this->get_number_of_cell_weights()).c_str()
+			);
+		}
+
+		if (use_native) {
+			if (use_diffusion) {
+				this->make_diffusive_partition(
+					native_cells_to_send,
+					native_receivers,
+					native_cells_to_receive,
+					native_senders
+				);
+			} else {
+				this->make_hilbert_partition(
+					native_cells_to_send,
+					native_receivers,
+					native_cells_to_receive,
+					native_senders
+				);
 			}
-			{
-			Types<3>::neighborhood_item_t item = {{0, -1, 0}};
-			this->neighborhood_of.push_back(item);
+			number_to_send = int(native_cells_to_send.size());
+			global_ids_to_send = native_cells_to_send.data();
+			receiver_processes = native_receivers.data();
+			number_to_receive = int(native_cells_to_receive.size());
+			global_ids_to_receive = native_cells_to_receive.data();
+			sender_processes = native_senders.data();
+		} else if (use_zoltan && Zoltan_LB_Balance(
+			this->zoltan,
+			&partition_changed,
+			&global_id_size,
+			&local_id_size,
+			&number_to_receive,
+			&global_ids_to_receive,
+			&local_ids_to_receive,
+			&sender_processes,
+			&number_to_send,
+			&global_ids_to_send,
+			&local_ids_to_send,
+			&receiver_processes
+			) != ZOLTAN_OK
+		) {
+			if (!this->no_load_balancing) {
+				if (this->rank == 0) {
+					std::cerr << "Zoltan_LB_Partition failed" << std::endl;
+				}
+				Zoltan_Destroy(&this->zoltan);
+				// TODO: throw an exception instead
+				abort();
 			}
-			{
-			Types<3>::neighborhood_item_t item = {{-1, 0, 0}};
-			this->neighborhood_of.push_back(item);
+
+			#ifdef DEBUG
+			// check that processes have the cells they're supposed to send
+			for (int i = 0; i < number_to_send; i++) {
+				if (this->cell_data.count(global_ids_to_send[i]) == 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cannot send cell " << global_ids_to_send[i]
+						<< " to process " << receiver_processes[i]
+						<< std::endl;
+					abort();
+				}
 			}
-			{
-			Types<3>::neighborhood_item_t item = {{1, 0, 0}};
-			this->neighborhood_of.push_back(item);
+
+			// check that cells to be received are on the sending process
+			for (int i = 0; i < number_to_receive; i++) {
+				if (
+					this->distributed_ownership
+					and this->cell_process.count(global_ids_to_receive[i]) == 0
+				) {
+					continue;
+				}
+
+				if (this->cell_process.at(global_ids_to_receive[i]) != (uint64_t)sender_processes[i]) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cannot receive cell " << global_ids_to_receive[i]
+						<< " from process " << sender_processes[i]
+						<< std::endl;
+					abort();
+				}
 			}
-			{
-			Types<3>::neighborhood_item_t item = {{0, 1, 0}};
-			this->neighborhood_of.push_back(item);
+			#endif
+		}
+
+		this->added_cells.clear();
+		this->removed_cells.clear();
+		this->cells_to_receive.clear();
+		this->cells_to_send.clear();
+
+		/*
+		Processes and the cells for which data has to be received by this process
+		*/
+
+		// migration from user
+		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
+			pin_request = this->pin_requests.begin();
+			pin_request != this->pin_requests.end();
+			pin_request++
+		) {
+			const uint64_t current_process_of_cell = this->cell_process.at(pin_request->first);
+
+			if (pin_request->second == this->rank
+			&& current_process_of_cell != this->rank) {
+				this->cells_to_receive[int(current_process_of_cell)].push_back(
+					std::make_pair(pin_request->first, -1)
+				);
+				this->added_cells.insert(pin_request->first);
 			}
-			{
-			Types<3>::neighborhood_item_t item = {{0, 0, 1}};
-			this->neighborhood_of.push_back(item);
+		}
+
+		// migration from Zoltan
+		if (use_zoltan) {
+			for (int i = 0; i < number_to_receive; i++) {
+
+				// don't send / receive from self
+				if ((uint64_t)sender_processes[i] == this->rank) {
+					continue;
+				}
+
+				// skip user-migrated cells
+				if (this->pin_requests.count(global_ids_to_receive[i]) > 0) {
+					continue;
+				}
+
+				this->cells_to_receive[sender_processes[i]].push_back(
+					std::make_pair(global_ids_to_receive[i], -1)
+				);
+
+				#ifdef DEBUG
+				if (this->added_cells.count(global_ids_to_receive[i]) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << global_ids_to_receive[i]
+						<< " has already been received from process " << this->rank
+						<< std::endl;
+					abort();
+				}
+				#endif
+
+				this->added_cells.insert(global_ids_to_receive[i]);
+			}
+		}
+
+		// receive cells in known order and add message tags
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
+			sender = this->cells_to_receive.begin();
+			sender != this->cells_to_receive.end();
+			sender++
+		) {
+			std::sort(sender->second.begin(), sender->second.end());
+
+			for (unsigned int i = 0; i < sender->second.size(); i++) {
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for receiving cell " << sender->second[i].first
+						<< " from process " << sender->first
+						<< std::endl;
+					abort();
+				}
+				sender->second[i].second = tag;
 			}
+		}
 
-		} else {
 
-			for (int
-				z = -this->neighborhood_length;
-				(unsigned int) abs(z) < this->neighborhood_length + 1;
-				z++
-			)
-			for (int
-				y = -this->neighborhood_length;
-				(unsigned int) abs(y) < this->neighborhood_length + 1;
-				y++
-			)
-			for (int
-				x = -this->neighborhood_length;
-				(unsigned int) abs(x) < this->neighborhood_length + 1;
-				x++
-			) {
-				if (x == 0 && y == 0 && z == 0) {
+		/*
+		Processes and the cells for which data has to be sent by this process
+		*/
+
+		// migration from user
+		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
+			pin_request = this->pin_requests.begin();
+			pin_request != this->pin_requests.end();
+			pin_request++
+		) {
+			const uint64_t current_process_of_cell = this->cell_process.at(pin_request->first);
+			const uint64_t destination_process = pin_request->second;
+
+			if (destination_process != this->rank
+			&& current_process_of_cell == this->rank) {
+				this->cells_to_send[int(destination_process)].push_back(
+					std::make_pair(pin_request->first, -1)
+				);
+				this->removed_cells.insert(pin_request->first);
+			}
+		}
+
+		// migration from Zoltan
+		if (use_zoltan) {
+			for (int i = 0; i < number_to_send; i++) {
+
+				// don't send / receive from self
+				if ((uint64_t) receiver_processes[i] == this->rank) {
 					continue;
 				}
-				const Types<3>::neighborhood_item_t item = {{x, y, z}};
-				this->neighborhood_of.push_back(item);
+
+				// skip user-migrated cells
+				if (this->pin_requests.count(global_ids_to_send[i]) > 0) {
+					continue;
+				}
+
+				this->cells_to_send[receiver_processes[i]].push_back(
+					std::make_pair(global_ids_to_send[i], -1)
+				);
+
+				#ifdef DEBUG
+				if (this->removed_cells.count(global_ids_to_send[i]) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Cell " << global_ids_to_send[i]
+						<< " has already been sent from process " << this->rank
+						<< std::endl;
+					abort();
+				}
+				#endif
+
+				this->removed_cells.insert(global_ids_to_send[i]);
 			}
 
+			if (not use_native) {
+				Zoltan_LB_Free_Data(
+					&global_ids_to_receive,
+					&local_ids_to_receive,
+					&sender_processes,
+					&global_ids_to_send,
+					&local_ids_to_send,
+					&receiver_processes
+				);
+			}
 		}
 
-		// set neighborhood_to
-		for (const auto& offset: this->neighborhood_of) {
-			Types<3>::neighborhood_item_t item = {{-offset[0], -offset[1], -offset[2]}};
-			this->neighborhood_to.push_back(item);
+		// send cells in known order and add message tags
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
+			receiver = this->cells_to_send.begin();
+			receiver != this->cells_to_send.end();
+			receiver++
+		) {
+			std::sort(receiver->second.begin(), receiver->second.end());
+			for (unsigned int i = 0; i < receiver->second.size(); i++) {
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for sending cell " << receiver->second[i].first
+						<< " to process " << receiver->first
+						<< std::endl;
+					abort();
+				}
+				receiver->second[i].second = tag;
+			}
 		}
 	}
 
 
 	/*!
-	Creates cells of refinement level 0 and assigns them to processes.
-
-	If USE_SFC is defined when compiling the cells will be assigned to
-	processes using a space-filling curve which should improve the
-	initial computational load.
+	Calculates what to send and where during a remote neighbor data update.
 
-	this->length and this->mapping must have been initialized prior
-	to calling this function.
+	Assumes up-to-date internal and user neighbor lists,
+	clears previous send / receive lists.
 	*/
-	bool create_level_0_cells(const uint64_t sfc_caching_batches)
+	void recalculate_neighbor_update_send_receive_lists()
 	{
-		if (sfc_caching_batches == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " sfc_caching_batches must be > 0"
-				<< std::endl;
-			return false;
-		}
-
-		const uint64_t total_cells
-			= this->length.get()[0]
-			* this->length.get()[1]
-			* this->length.get()[2];
+		this->free_persistent_transfers();
+		this->free_neighbor_collective_comms();
 
-		uint64_t cells_per_process = 0;
+		// clear previous lists
+		this->cells_to_send.clear();
+		this->cells_to_receive.clear();
 
-		if (total_cells < this->comm_size) {
-			cells_per_process = 1;
-		} else if (total_cells % this->comm_size > 0) {
-			cells_per_process = total_cells / this->comm_size + 1;
-		} else {
-			cells_per_process = total_cells / this->comm_size;
-		}
+		// only send a cell to a process once
+		std::unordered_map<
+			int, // process to send to / receive from
+			std::unordered_set<uint64_t>
+		> unique_cells_to_send, unique_cells_to_receive;
 
-		// some processes get fewer cells if grid size not divisible by this->comm_size
-		const uint64_t procs_with_fewer = cells_per_process * this->comm_size - total_cells;
+		// calculate new lists for neighbor data updates
+		for (const uint64_t cell: this->local_cells_on_process_boundary) {
 
-		#ifndef USE_SFC
+			#ifdef DEBUG
+			if (cell != this->get_child(cell)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << cell << " has children"
+					<< std::endl;
+				abort();
+			}
 
-		uint64_t cell_to_create = 1;
-		for (uint64_t process = 0; process < this->comm_size; process++) {
+			if (this->neighbors_of.count(cell) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " No neighbor_of list for cell " << cell
+					<< std::endl;
+				abort();
+			}
 
-			uint64_t cells_to_create;
-			if (process < procs_with_fewer) {
-				cells_to_create = cells_per_process - 1;
-			} else {
-				cells_to_create = cells_per_process;
+			if (this->neighbors_to.count(cell) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " No neighbor_to list for cell " << cell
+					<< std::endl;
+				abort();
 			}
+			#endif
 
-			for (uint64_t i = 0; i < cells_to_create; i++) {
-				this->cell_process[cell_to_create] = process;
-				if (process == this->rank) {
-					this->cell_data[cell_to_create];
+			const int current_process = int(this->rank);
+
+			// data must be received from neighbors_of
+			for (const auto& neighbor_i: this->neighbors_of.at(cell)) {
+				const auto& neighbor = neighbor_i.first;
+
+				if (neighbor == error_cell) {
+					continue;
+				}
+
+				const int other_process = int(this->cell_process.at(neighbor));
+
+				if (other_process != current_process) {
+					unique_cells_to_receive[other_process].insert(neighbor);
 				}
-				cell_to_create++;
 			}
-		}
 
-		#ifdef DEBUG
-		if (cell_to_create != total_cells + 1) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Incorrect number of cells created: " << cell_to_create - 1
-				<< ", should be " << total_cells
-				<< std::endl;
-			abort();
-		}
-		#endif
+			// data must be sent to neighbors_to
+			for (const auto& neighbor_i: this->neighbors_to.at(cell)) {
+				const auto& neighbor = neighbor_i.first;
 
-		#else // ifndef USE_SFC
+				if (neighbor == error_cell) {
+					continue;
+				}
 
-		const dccrg::Types<3>::indices_t sfc_length = {{
-			this->length.get()[0],
-			this->length.get()[1],
-			this->length.get()[2]
-		}};
-		sfc::Sfc<3, uint64_t> sfc_mapping(sfc_length);
+				const int other_process = int(this->cell_process.at(neighbor));
 
-		/*
-		Cache only batch_size number of sfc indices at a time.
-		Saves memory and can even be faster than caching everything at once
-		*/
-		uint64_t batch_size;
-		if (sfc_mapping.size() % sfc_caching_batches > 0) {
-			batch_size = 1 + sfc_mapping.size() / sfc_caching_batches;
-		} else {
-			batch_size = sfc_mapping.size() / sfc_caching_batches;
+				if (other_process != current_process) {
+					unique_cells_to_send[other_process].insert(cell);
+				}
+			}
 		}
 
-		uint64_t cache_start = 0, cache_end = batch_size - 1;
-		sfc_mapping.cache_sfc_index_range(cache_start, cache_end);
-
-		uint64_t sfc_index = 0;
-		for (uint64_t process = 0; process < this->comm_size; process++) {
+		// populate final send list data structures and sort them
+		for (const auto& receiver: unique_cells_to_send) {
+			const int process = receiver.first;
 
-			uint64_t cells_to_create;
-			if (process < procs_with_fewer) {
-				cells_to_create = cells_per_process - 1;
-			} else {
-				cells_to_create = cells_per_process;
+			#ifdef DEBUG
+			if ((uint64_t) process == this->rank) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << process << " would send to self"
+					<< std::endl;
+				abort();
 			}
+			#endif
 
-			for (uint64_t i = 0; i < cells_to_create; i++) {
+			this->cells_to_send[process].reserve(receiver.second.size());
 
-				// cache new sfc index batch
-				if (sfc_index > cache_end) {
-					cache_start = cache_end;
-					cache_end = cache_start + batch_size;
+			for (const uint64_t cell: receiver.second) {
+				this->cells_to_send.at(process).push_back(
+					std::make_pair(cell, -1)
+				);
+			}
 
-					if (cache_end >= sfc_mapping.size()) {
-						cache_end = sfc_mapping.size() - 1;
-					}
+			if (this->cells_to_send.at(process).size() > 0) {
+				std::sort(
+					this->cells_to_send.at(process).begin(),
+					this->cells_to_send.at(process).end()
+				);
+			}
 
-					sfc_mapping.clear();
-					sfc_mapping.cache_sfc_index_range(cache_start, cache_end);
+			// sequential tags for messages: 1, 2, ...
+			for (size_t i = 0; i < this->cells_to_send.at(process).size(); i++) {
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					const uint64_t cell = this->cells_to_send.at(process)[i].first;
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for sending cell " << cell
+						<< " to process " << process
+						<< std::endl;
+					abort();
 				}
+				this->cells_to_send.at(process)[i].second = tag;
+			}
+		}
 
-				dccrg::Types<3>::indices_t indices = sfc_mapping.get_indices(sfc_index);
-				// transform indices to those of refinement level 0 cells
-				indices[0] *= uint64_t(1) << this->mapping.get_maximum_refinement_level();
-				indices[1] *= uint64_t(1) << this->mapping.get_maximum_refinement_level();
-				indices[2] *= uint64_t(1) << this->mapping.get_maximum_refinement_level();
-				const uint64_t cell_to_create = this->mapping.get_cell_from_indices(indices, 0);
+		// populate final receive list data structures and sort them
+		for (const auto& sender: unique_cells_to_receive) {
+			const int process = sender.first;
+
+			#ifdef DEBUG
+			if ((uint64_t) process == this->rank) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << process << " would receive from self"
+					<< std::endl;
+				abort();
+			}
+			#endif
+
+			this->cells_to_receive[process].reserve(sender.second.size());
+
+			for (const uint64_t cell: sender.second) {
+				this->cells_to_receive.at(process).push_back(
+					std::make_pair(cell, -1)
+				);
+			}
 
-				this->cell_process[cell_to_create] = process;
-				if (process == this->rank) {
-					this->cell_data[cell_to_create];
+			if (this->cells_to_receive.at(process).size() > 0) {
+				std::sort(
+					this->cells_to_receive.at(process).begin(),
+					this->cells_to_receive.at(process).end()
+				);
+			}
+
+			// sequential tags for messages: 1, 2, ...
+			for (size_t i = 0; i < this->cells_to_receive.at(process).size(); i++) {
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					const uint64_t cell = this->cells_to_receive.at(process)[i].first;
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for receiving cell " << cell
+						<< " from process " << process
+						<< std::endl;
+					abort();
 				}
 
-				sfc_index++;
+				this->cells_to_receive.at(process)[i].second = tag;
 			}
 		}
-		sfc_mapping.clear();
+		for (const auto& item: this->user_hood_of) {
+			this->recalculate_neighbor_update_send_receive_lists(item.first);
+		}
+		this->update_neighbor_processes();
+		this->create_neighbor_collectives();
+	}
 
-		if (sfc_index != total_cells) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Process " << this->rank
-				<< ": Incorrect number of cells created: " << sfc_index
-				<< ", should be " << total_cells
+	/*!
+	Same as the version without an id but for user defined neighborhood.
+
+	Updates send/receive lists of cells using only the given
+	neighborhood id.
+	*/
+	void recalculate_neighbor_update_send_receive_lists(const int neighborhood_id)
+	{
+		#ifdef DEBUG
+		if (this->user_local_cells_on_process_boundary.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No neighborhood with id " << neighborhood_id
 				<< std::endl;
 			abort();
 		}
+		#endif
 
-		#endif // ifndef USE_SFC
-		// TODO: check that the last index in the grid in every direction is less than error_index
-
-		return true;
-	}
+		this->free_persistent_transfers(neighborhood_id);
+		this->free_neighbor_collective_comms(neighborhood_id);
 
-public:
-	/*!
-	Sets size of grid in cells of refinement level 0.
+		// clear previous lists
+		this->user_neigh_cells_to_send[neighborhood_id].clear();
+		this->user_neigh_cells_to_receive[neighborhood_id].clear();
 
-	Sets how many cells of largest possible size this
-	grid will be created with at initialization.
+		std::unordered_map<int, std::unordered_set<uint64_t>>
+			user_neigh_unique_sends,
+			user_neigh_unique_receives;
 
-	Must be called before initialize().
+		// calculate new lists for neighbor data updates
+		for (const uint64_t cell: this->user_local_cells_on_process_boundary.at(neighborhood_id)) {
 
-	\see set_maximum_refinement_level() initialize()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& set_initial_length(const std::array<uint64_t, 3>& initial_size) {
-		if (this->mapping_initialized) {
-			throw std::invalid_argument(
-				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
-				+ "Initial size of grid already set"
-			);
-		}
+			#ifdef DEBUG
+			if (cell != this->get_child(cell)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << cell << " has children"
+					<< std::endl;
+				abort();
+			}
+			#endif
 
-		if (!this->mapping_rw.set_length(initial_size)) {
-			throw std::invalid_argument(
-				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
-				+ "Couldn't set initial size of grid"
-			);
-		}
-		this->mapping_initialized = true;
+			// data must be received from neighbors_of
+			for (const auto& neighbor_i: this->user_neigh_of.at(neighborhood_id).at(cell)) {
+				const auto& neighbor = neighbor_i.first;
 
-		return *this;
-	}
+				if (neighbor == error_cell) {
+					continue;
+				}
 
-	/*!
-	Sets maximum possible refinement level of cells.
+				if (this->cell_process.at(neighbor) != this->rank) {
+					user_neigh_unique_receives[int(this->cell_process.at(neighbor))].insert(neighbor);
+				}
+			}
 
-	Using @max_ref_lvl < 0 sets it to maximum possible value (<= 21).
-	Refining a cell past maximum refinement level succeeds but does nothing.
+			// data must be sent to neighbors_to
+			for (const auto& neighbor_i: this->user_neigh_to.at(neighborhood_id).at(cell)) {
+				const auto& neighbor = neighbor_i.first;
 
-	Must be called before initialize().
+				if (neighbor == error_cell) {
+					continue;
+				}
 
-	\see set_periodic() local_cells update_copies_of_remote_neighbors() refine_completely()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& set_maximum_refinement_level(const int max_ref_lvl) {
-		if (max_ref_lvl < 0) {
-			this->mapping_rw.set_maximum_refinement_level(
-				this->mapping_rw.get_maximum_possible_refinement_level()
-			);
-		} else if (not this->mapping_rw.set_maximum_refinement_level(max_ref_lvl)) {
-			throw std::invalid_argument(
-				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
-				+ "Couldn't set maximum refinement level to "
-				+ std::to_string(max_ref_lvl)
-			);
+				if (this->cell_process.at(neighbor) != this->rank) {
+					user_neigh_unique_sends[int(this->cell_process.at(neighbor))].insert(cell);
+				}
+			}
 		}
-		return *this;
-	}
-
-	/*!
-	Sets grid periodicity.
 
-	In periodic dimension cells on opposite sides are neighbors
-	as-if the grid was neighbor to itself on both sides in that
-	dimension.
+		// populate final send list data structures and sort them
+		for (std::unordered_map<int, std::unordered_set<uint64_t>>::const_iterator
+			receiver = user_neigh_unique_sends.begin();
+			receiver != user_neigh_unique_sends.end();
+			receiver++
+		) {
+			const int receiving_process = receiver->first;
 
-	Must be called before initialize().
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& set_periodic(const bool x, const bool y, const bool z) {
-		this->topology_rw.set_periodicity(0, x);
-		this->topology_rw.set_periodicity(1, y);
-		this->topology_rw.set_periodicity(2, z);
-		return *this;
-	}
+			std::vector<std::pair<uint64_t, int>>& current_cells_to_send
+				= this->user_neigh_cells_to_send.at(neighborhood_id)[receiving_process];
 
-	/*!
-	Sets default distance within which cells are considered neighbors.
+			current_cells_to_send.reserve(receiver->second.size());
 
-	With value == 0 only face neighbors are considered neighbors.
-	With value > 0 cells within that distance are considered neighbors
-	(in units of logical size of cell doing the considering).
+			for (const uint64_t cell: receiver->second) {
+				current_cells_to_send.push_back(std::make_pair(cell, -1));
+			}
 
-	Must be called before initialize().
+			std::sort(current_cells_to_send.begin(), current_cells_to_send.end());
 
-	\see add_neighborhood()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& set_neighborhood_length(const unsigned int given_length) {
-		this->neighborhood_length = given_length;
-		return *this;
-	}
+			// sequential tags for messages: 1, 2, ...
+			for (unsigned int i = 0; i < current_cells_to_send.size(); i++) {
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					const uint64_t cell = current_cells_to_send[i].first;
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for sending cell " << cell
+						<< " to process " << receiving_process
+						<< std::endl;
+					abort();
+				}
 
-	/*!
-	Sets load balancing method used by Zoltan.
+				current_cells_to_send[i].second = tag;
+			}
+		}
 
-	Must be called before initialize().
+		// populate final receive list data structures and sort them
+		for (std::unordered_map<int, std::unordered_set<uint64_t>>::const_iterator
+			sender = user_neigh_unique_receives.begin();
+			sender != user_neigh_unique_receives.end();
+			sender++
+		) {
+			const int sending_process = sender->first;
 
-	\see balance_load()
-	*/
-	Dccrg<
-		Cell_Data,
-		Geometry,
-		std::tuple<Additional_Cell_Items...>,
-		std::tuple<Additional_Neighbor_Items...>
-	>& set_load_balancing_method(const std::string& given_method) {
-		this->load_balancing_method = given_method;
-		return *this;
-	}
+			std::vector<std::pair<uint64_t, int>>& current_cells_to_receive
+				= this->user_neigh_cells_to_receive[neighborhood_id][sending_process];
 
-	const std::string& get_load_balancing_method() const {
-		return this->load_balancing_method;
-	}
+			current_cells_to_receive.reserve(sender->second.size());
 
+			for (const uint64_t cell: sender->second) {
+				current_cells_to_receive.push_back(std::make_pair(cell, -1));
+			}
 
-private:
-	/*!
-	Initializes local cells' neighbor lists and related data structures.
+			std::sort(current_cells_to_receive.begin(), current_cells_to_receive.end());
 
-	this->create_level_0_cells() must have been called prior to this.
-	*/
-	bool initialize_neighbors()
-	{
-		// update neighbor lists of created cells
-		for (const auto& item: this->cell_data) {
-			this->neighbors_of[item.first]
-				= this->find_neighbors_of(item.first, this->neighborhood_of, this->max_ref_lvl_diff);
-			#ifdef DEBUG
-			for (const auto& neighbor: this->neighbors_of.at(item.first)) {
-				if (neighbor.first == error_cell) {
-					continue;
-				}
-				if (
-					neighbor.second[0] == 0
-					and neighbor.second[1] == 0
-					and neighbor.second[2] == 0
-				) {
+			// sequential tags for messages: 1, 2, ...
+			for (unsigned int i = 0; i < current_cells_to_receive.size(); i++) {
+				const int tag = (int) i + 1;
+				if (tag > (int) this->max_tag) {
+					const uint64_t cell = current_cells_to_receive[i].first;
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< "Invalid offset for neighbor " << neighbor.first
-						<< " of cell " << item.first << std::endl;
+						<< " Process " << this->rank
+						<< ": Message tag would overflow for receiving cell " << cell
+						<< " from process " << sending_process
+						<< std::endl;
 					abort();
 				}
-			}
-			#endif
-
-			this->neighbors_to[item.first]
-				= this->find_neighbors_to(item.first, this->neighborhood_to);
-		}
-		#ifdef DEBUG
-		if (!this->verify_neighbors()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Neighbor lists are inconsistent"
-				<< std::endl;
-			abort();
-		}
-		#endif
 
-		this->update_remote_neighbor_info();
-		#ifdef DEBUG
-		if (!this->verify_remote_neighbor_info()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info is not consistent"
-				<< std::endl;
-			abort();
+				current_cells_to_receive[i].second = tag;
+			}
 		}
-		#endif
-
-		this->recalculate_neighbor_update_send_receive_lists();
-
-		return true;
 	}
 
 
 	/*!
-	Updates user pin requests globally based on new_pin_requests.
+	Updates neighbor and neighbor_to lists around given cell's neighborhood.
 
-	Must be called simultaneously on all processes.
+	Does nothing in the following cases:
+		- given cell doesn't exist in the grid
+		- given cell has children
+	Assumes that the refinement level difference between given cell and
+	its neighborhood is no larger than 1.
 	*/
-	void update_pin_requests()
+	void update_neighbors(const uint64_t cell)
 	{
-		std::vector<uint64_t> new_pinned_cells, new_pinned_processes;
-
-		new_pinned_cells.reserve(this->new_pin_requests.size());
-		new_pinned_processes.reserve(this->new_pin_requests.size());
-		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
-			item = this->new_pin_requests.begin();
-			item != this->new_pin_requests.end();
-			item++
-		) {
-			new_pinned_cells.push_back(item->first);
-			new_pinned_processes.push_back(item->second);
+		if (this->cell_process.count(cell) == 0) {
+			return;
 		}
 
-		std::vector<std::vector<uint64_t>> all_new_pinned_cells, all_new_pinned_processes;
-		All_Gather()(new_pinned_cells, all_new_pinned_cells, this->comm);
-		All_Gather()(new_pinned_processes, all_new_pinned_processes, this->comm);
+		if (this->cell_process.at(cell) != this->rank) {
+			return;
+		}
 
-		for (uint64_t process = 0; process < all_new_pinned_cells.size(); process++) {
-			for (uint64_t i = 0; i < all_new_pinned_cells.at(process).size(); i++) {
+		if (cell != this->get_child(cell)) {
+			return;
+		}
 
-				const uint64_t requested_process = all_new_pinned_processes[process][i];
+		this->neighbors_of.at(cell) = this->find_neighbors_of(cell, this->neighborhood_of, this->max_ref_lvl_diff);
+		std::vector<uint64_t> found_neighbors_of;
+		for (const auto& i: this->neighbors_of.at(cell)) {
+			found_neighbors_of.push_back(i.first);
+		}
+		this->neighbors_to.at(cell) = this->find_neighbors_to(cell, found_neighbors_of);
+		this->cells_with_changed_neighbors.insert(cell);
 
-				if (requested_process >= this->comm_size) {
-					this->pin_requests.erase(all_new_pinned_cells[process][i]);
-				} else {
-					this->pin_requests[all_new_pinned_cells[process][i]] = requested_process;
-				}
+		#ifdef DEBUG
+		if (
+			!this->verify_neighbors(
+				cell,
+				this->neighborhood_of,
+				this->neighborhood_to,
+				this->neighbors_of,
+				this->neighbors_to
+			)
+		) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Neighbor update failed for cell " << cell
+				<< " (child of " << this->get_parent(cell) << ")"
+				<< std::endl;
+			abort();
+		}
 
-				#ifdef DEBUG
-				if (this->cell_process.at(all_new_pinned_cells[process][i]) != process) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << process
-						<< " tried pin cell " << all_new_pinned_cells[process][i]
-						<< std::endl;
-					exit(EXIT_FAILURE);
-				}
-				#endif
+		for (const auto& neighbor: this->neighbors_of.at(cell)) {
+			if (neighbor.first == error_cell) {
+				continue;
+			}
+			if (
+				neighbor.second[0] == 0
+				and neighbor.second[1] == 0
+				and neighbor.second[2] == 0
+			) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Invalid offset of neighbor " << neighbor.first
+					<< " for cell " << cell << std::endl;
+				abort();
 			}
 		}
-
-		this->new_pin_requests.clear();
+		#endif
 	}
 
 
 	/*!
-	Repartitions cells across processes based on user requests and
-	Zoltan if use_zoltan is true.
+	Updates the neighbors and _to of given cell based on given neighborhood.
 
-	Updates send & receive lists.
+	Does nothing in the following cases:
+		- given cell doesn't exist in the grid
+		- given cell has children
+	Assumes that update_neighbors(cell) has been called prior to this.
 	*/
-	void make_new_partition(const bool use_zoltan)
+	void update_user_neighbors(const uint64_t cell, const int neighborhood_id)
 	{
-		this->update_pin_requests();
-
-		int
-			partition_changed,
-			global_id_size,
-			local_id_size,
-			number_to_receive,
-			number_to_send,
-			*sender_processes,
-			*receiver_processes;
-
-		ZOLTAN_ID_PTR
-			global_ids_to_receive,
-			local_ids_to_receive,
-			global_ids_to_send,
-			local_ids_to_send;
-
-		if (use_zoltan && Zoltan_LB_Balance(
-			this->zoltan,
-			&partition_changed,
-			&global_id_size,
-			&local_id_size,
-			&number_to_receive,
-			&global_ids_to_receive,
-			&local_ids_to_receive,
-			&sender_processes,
-			&number_to_send,
-			&global_ids_to_send,
-			&local_ids_to_send,
-			&receiver_processes
-			) != ZOLTAN_OK
-		) {
-			if (!this->no_load_balancing) {
-				if (this->rank == 0) {
-					std::cerr << "Zoltan_LB_Partition failed" << std::endl;
-				}
-				Zoltan_Destroy(&this->zoltan);
-				// TODO: throw an exception instead
-				abort();
-			}
+		if (this->user_hood_of.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No user neighborhood with id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
 
-			#ifdef DEBUG
-			// check that processes have the cells they're supposed to send
-			for (int i = 0; i < number_to_send; i++) {
-				if (this->cell_data.count(global_ids_to_send[i]) == 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cannot send cell " << global_ids_to_send[i]
-						<< " to process " << receiver_processes[i]
-						<< std::endl;
-					abort();
-				}
-			}
+		#ifdef DEBUG
+		if (this->user_hood_to.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No user neighborhood to with id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
+		#endif
 
-			// check that cells to be received are on the sending process
-			for (int i = 0; i < number_to_receive; i++) {
-				if (this->cell_process.at(global_ids_to_receive[i]) != (uint64_t)sender_processes[i]) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cannot receive cell " << global_ids_to_receive[i]
-						<< " from process " << sender_processes[i]
-						<< std::endl;
-					abort();
-				}
-			}
-			#endif
+		// find neighbors_of, should be in order given by user
+		this->user_neigh_of[neighborhood_id][cell].clear();
+		for (const auto& item: this->user_hood_of[neighborhood_id]) {
+			const auto cells_at_offset
+				= this->get_neighbors_of_at_offset(cell, item[0], item[1], item[2]);
+			this->user_neigh_of[neighborhood_id][cell].insert(
+				this->user_neigh_of[neighborhood_id][cell].end(),
+				cells_at_offset.begin(),
+				cells_at_offset.end()
+			);
 		}
 
-		this->added_cells.clear();
-		this->removed_cells.clear();
-		this->cells_to_receive.clear();
-		this->cells_to_send.clear();
+		// find neighbors_to
+		this->user_neigh_to[neighborhood_id][cell]
+			= this->find_neighbors_to(cell, this->user_hood_to[neighborhood_id]);
+	}
 
-		/*
-		Processes and the cells for which data has to be received by this process
-		*/
 
-		// migration from user
-		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
-			pin_request = this->pin_requests.begin();
-			pin_request != this->pin_requests.end();
-			pin_request++
-		) {
-			const uint64_t current_process_of_cell = this->cell_process.at(pin_request->first);
+	/*!
+	Updates the remote neighbor info of given cell on this process without children.
 
-			if (pin_request->second == this->rank
-			&& current_process_of_cell != this->rank) {
-				this->cells_to_receive[int(current_process_of_cell)].push_back(
-					std::make_pair(pin_request->first, -1)
-				);
-				this->added_cells.insert(pin_request->first);
-			}
+	Uses current neighbor lists.
+	Does nothing if given cell doesn't exist on this process or has children
+	*/
+	void update_remote_neighbor_info(const uint64_t cell)
+	{
+		if (this->cell_data.count(cell) == 0) {
+			return;
 		}
 
-		// migration from Zoltan
-		if (use_zoltan) {
-			for (int i = 0; i < number_to_receive; i++) {
+		if (cell != this->get_child(cell)) {
+			return;
+		}
 
-				// don't send / receive from self
-				if ((uint64_t)sender_processes[i] == this->rank) {
-					continue;
-				}
+		// TODO: also update remote_cells_on_process_boundary
+		this->local_cells_on_process_boundary.erase(cell);
 
-				// skip user-migrated cells
-				if (this->pin_requests.count(global_ids_to_receive[i]) > 0) {
-					continue;
-				}
+		#ifdef DEBUG
+		if (this->neighbors_of.count(cell) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Neighbor list for cell " << cell
+				<< " doesn't exist"
+				<< std::endl;
+			abort();
+		}
 
-				this->cells_to_receive[sender_processes[i]].push_back(
-					std::make_pair(global_ids_to_receive[i], -1)
-				);
+		if (this->neighbors_to.count(cell) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Neighbors_to list for cell " << cell
+				<< " doesn't exist"
+				<< std::endl;
+			abort();
+		}
+		#endif
 
-				#ifdef DEBUG
-				if (this->added_cells.count(global_ids_to_receive[i]) > 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << global_ids_to_receive[i]
-						<< " has already been received from process " << this->rank
-						<< std::endl;
-					abort();
-				}
-				#endif
+		// neighbors of given cell
+		for (const auto& neighbor_i: this->neighbors_of.at(cell)) {
+			const auto& neighbor = neighbor_i.first;
 
-				this->added_cells.insert(global_ids_to_receive[i]);
+			if (neighbor == error_cell) {
+				continue;
 			}
-		}
 
-		// receive cells in known order and add message tags
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
-			sender = this->cells_to_receive.begin();
-			sender != this->cells_to_receive.end();
-			sender++
-		) {
-			std::sort(sender->second.begin(), sender->second.end());
+			#ifdef DEBUG
+			if (this->cell_process.count(neighbor) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Neighbor " << neighbor
+					<< " doesn't exist in cell_process"
+					<< std::endl;
+				abort();
+			}
+			#endif
 
-			for (unsigned int i = 0; i < sender->second.size(); i++) {
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for receiving cell " << sender->second[i].first
-						<< " from process " << sender->first
-						<< std::endl;
-					abort();
-				}
-				sender->second[i].second = tag;
+			if (this->cell_process.at(neighbor) != this->rank) {
+				this->local_cells_on_process_boundary.insert(cell);
+				this->remote_cells_on_process_boundary.insert(neighbor);
 			}
 		}
 
+		// cells with given cell as neighbor
+		for (const auto& neighbor_to_i: this->neighbors_to.at(cell)) {
+			const auto& neighbor_to = neighbor_to_i.first;
 
-		/*
-		Processes and the cells for which data has to be sent by this process
-		*/
-
-		// migration from user
-		for (std::unordered_map<uint64_t, uint64_t>::const_iterator
-			pin_request = this->pin_requests.begin();
-			pin_request != this->pin_requests.end();
-			pin_request++
-		) {
-			const uint64_t current_process_of_cell = this->cell_process.at(pin_request->first);
-			const uint64_t destination_process = pin_request->second;
+			#ifdef DEBUG
+			if (this->cell_process.count(neighbor_to) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Neighbor_to " << neighbor_to
+					<< " doesn't exist in cell_process"
+					<< std::endl;
+				abort();
+			}
+			#endif
 
-			if (destination_process != this->rank
-			&& current_process_of_cell == this->rank) {
-				this->cells_to_send[int(destination_process)].push_back(
-					std::make_pair(pin_request->first, -1)
-				);
-				this->removed_cells.insert(pin_request->first);
+			if (this->cell_process.at(neighbor_to) != this->rank) {
+				this->local_cells_on_process_boundary.insert(cell);
+				this->remote_cells_on_process_boundary.insert(neighbor_to);
 			}
 		}
 
-		// migration from Zoltan
-		if (use_zoltan) {
-			for (int i = 0; i < number_to_send; i++) {
+		#ifdef DEBUG
+		if (!this->verify_remote_neighbor_info(cell)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info for cell " << cell
+				<< " is not consistent"
+				<< std::endl;
+			abort();
+		}
+		#endif
+	}
 
-				// don't send / receive from self
-				if ((uint64_t) receiver_processes[i] == this->rank) {
-					continue;
-				}
+	/*!
+	Updates the remote neighbor info of given cell on this process without children.
 
-				// skip user-migrated cells
-				if (this->pin_requests.count(global_ids_to_send[i]) > 0) {
-					continue;
-				}
+	Uses current neighbor lists of neighborhood with given id.
+	Does nothing if given cell doesn't exist on this process or has children.
+	*/
+	void update_user_remote_neighbor_info(const uint64_t cell, const int neighborhood_id)
+	{
+		if (this->cell_data.count(cell) == 0) {
+			return;
+		}
 
-				this->cells_to_send[receiver_processes[i]].push_back(
-					std::make_pair(global_ids_to_send[i], -1)
-				);
+		if (cell != this->get_child(cell)) {
+			return;
+		}
 
-				#ifdef DEBUG
-				if (this->removed_cells.count(global_ids_to_send[i]) > 0) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Cell " << global_ids_to_send[i]
-						<< " has already been sent from process " << this->rank
-						<< std::endl;
-					abort();
-				}
-				#endif
+		#ifdef DEBUG
+		if (this->user_hood_of.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No user neighborhood with id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
 
-				this->removed_cells.insert(global_ids_to_send[i]);
-			}
+		if (this->user_hood_to.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No user neighborhood to with id " << neighborhood_id
+				<< std::endl;
+			abort();
+		}
 
-			Zoltan_LB_Free_Data(
-				&global_ids_to_receive,
-				&local_ids_to_receive,
-				&sender_processes,
-				&global_ids_to_send,
-				&local_ids_to_send,
-				&receiver_processes
-			);
+		if (this->user_neigh_of.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No neighborhood with id " << neighborhood_id
+				<< " in neighbor lists"
+				<< std::endl;
+			abort();
 		}
 
-		// send cells in known order and add message tags
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::iterator
-			receiver = this->cells_to_send.begin();
-			receiver != this->cells_to_send.end();
-			receiver++
-		) {
-			std::sort(receiver->second.begin(), receiver->second.end());
-			for (unsigned int i = 0; i < receiver->second.size(); i++) {
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for sending cell " << receiver->second[i].first
-						<< " to process " << receiver->first
-						<< std::endl;
-					abort();
-				}
-				receiver->second[i].second = tag;
-			}
+		if (this->user_neigh_of.at(neighborhood_id).count(cell) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No neighbor list with neighborhood id " << neighborhood_id
+				<< " for cell " << cell
+				<< std::endl;
+			abort();
 		}
-	}
 
+		if (this->user_neigh_to.count(neighborhood_id) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No neighborhood with id " << neighborhood_id
+				<< " in neighbor_to lists"
+				<< std::endl;
+			abort();
+		}
 
-	/*!
-	Calculates what to send and where during a remote neighbor data update.
+		if (this->user_neigh_to.at(neighborhood_id).count(cell) == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " No neighbor_to list with neighborhood id " << neighborhood_id
+				<< " for cell " << cell
+				<< std::endl;
+			abort();
+		}
+		#endif
 
-	Assumes up-to-date internal and user neighbor lists,
-	clears previous send / receive lists.
-	*/
-	void recalculate_neighbor_update_send_receive_lists()
-	{
-		// clear previous lists
-		this->cells_to_send.clear();
-		this->cells_to_receive.clear();
+		this->user_local_cells_on_process_boundary.at(neighborhood_id).erase(cell);
 
-		// only send a cell to a process once
-		std::unordered_map<
-			int, // process to send to / receive from
-			std::unordered_set<uint64_t>
-		> unique_cells_to_send, unique_cells_to_receive;
+		// neighbors of given cell
+		for (const auto& neighbor_i: this->user_neigh_of.at(neighborhood_id).at(cell)) {
+			const auto& neighbor = neighbor_i.first;
 
-		// calculate new lists for neighbor data updates
-		for (const uint64_t cell: this->local_cells_on_process_boundary) {
+			if (neighbor == 0) {
+				continue;
+			}
 
 			#ifdef DEBUG
-			if (cell != this->get_child(cell)) {
+			if (this->cell_process.count(neighbor) == 0) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << cell << " has children"
+					<< " Neighbor " << neighbor
+					<< " doesn't exist in cell_process"
 					<< std::endl;
 				abort();
 			}
+			#endif
+
+			if (this->cell_process.at(neighbor) != this->rank) {
+				this->user_local_cells_on_process_boundary.at(neighborhood_id).insert(cell);
+				this->user_remote_cells_on_process_boundary.at(neighborhood_id).insert(neighbor);
+			}
+		}
 
-			if (this->neighbors_of.count(cell) == 0) {
+		// cells with given cell as neighbor
+		for (const auto& neighbor_to_i: this->user_neigh_to.at(neighborhood_id).at(cell)) {
+			const auto& neighbor_to = neighbor_to_i.first;
+
+			#ifdef DEBUG
+			if (neighbor_to == error_cell) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " No neighbor_of list for cell " << cell
+					<< " Invalid cell in neighbor_to list of cell " << cell
 					<< std::endl;
 				abort();
 			}
 
-			if (this->neighbors_to.count(cell) == 0) {
+			if (this->cell_process.count(neighbor_to) == 0) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " No neighbor_to list for cell " << cell
+					<< " Neighbor_to " << neighbor_to
+					<< " doesn't exist in cell_process"
 					<< std::endl;
 				abort();
 			}
 			#endif
 
-			const int current_process = int(this->rank);
-
-			// data must be received from neighbors_of
-			for (const auto& neighbor_i: this->neighbors_of.at(cell)) {
-				const auto& neighbor = neighbor_i.first;
-
-				if (neighbor == error_cell) {
-					continue;
-				}
+			if (this->cell_process.at(neighbor_to) != this->rank) {
+				this->user_local_cells_on_process_boundary.at(neighborhood_id).insert(cell);
+				this->user_remote_cells_on_process_boundary.at(neighborhood_id).insert(neighbor_to);
+			}
+		}
 
-				const int other_process = int(this->cell_process.at(neighbor));
+		#ifdef DEBUG
+		if (!this->verify_remote_neighbor_info(cell)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info for cell " << cell
+				<< " is not consistent"
+				<< std::endl;
+			abort();
+		}
+		#endif
+	}
 
-				if (other_process != current_process) {
-					unique_cells_to_receive[other_process].insert(neighbor);
-				}
-			}
 
-			// data must be sent to neighbors_to
-			for (const auto& neighbor_i: this->neighbors_to.at(cell)) {
-				const auto& neighbor = neighbor_i.first;
+	/*!
+	Updates the remote neighbor info of all cells on this process without children.
 
-				if (neighbor == error_cell) {
-					continue;
-				}
+	Uses current neighbor lists.
+	*/
+	void update_remote_neighbor_info()
+	{
+		// TODO this probably can't be optimized without
+		// storing neighbor lists also for remote neighbors
+		this->local_cells_on_process_boundary.clear();
+		this->remote_cells_on_process_boundary.clear();
 
-				const int other_process = int(this->cell_process.at(neighbor));
+		for (const auto& item: this->cell_data) {
 
-				if (other_process != current_process) {
-					unique_cells_to_send[other_process].insert(cell);
-				}
+			if (item.first != this->get_child(item.first)) {
+				continue;
 			}
-		}
 
-		// populate final send list data structures and sort them
-		for (const auto& receiver: unique_cells_to_send) {
-			const int process = receiver.first;
+			this->update_remote_neighbor_info(item.first);
 
 			#ifdef DEBUG
-			if ((uint64_t) process == this->rank) {
+			if (!this->verify_remote_neighbor_info(item.first)) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << process << " would send to self"
+					<< " Remote neighbor info for cell " << item.first
+					<< " is not consistent"
 					<< std::endl;
 				abort();
 			}
 			#endif
+		}
 
-			this->cells_to_send[process].reserve(receiver.second.size());
+		#ifdef DEBUG
+		if (!this->verify_remote_neighbor_info()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info is not consistent"
+				<< std::endl;
+			abort();
+		}
+		#endif
+	}
 
-			for (const uint64_t cell: receiver.second) {
-				this->cells_to_send.at(process).push_back(
-					std::make_pair(cell, -1)
-				);
-			}
+	/*!
+	Updates the remote neighbor info of all cells on this process without children.
 
-			if (this->cells_to_send.at(process).size() > 0) {
-				std::sort(
-					this->cells_to_send.at(process).begin(),
-					this->cells_to_send.at(process).end()
-				);
-			}
+	Uses current neighbor lists of neighborhood with given id.
+	*/
+	void update_user_remote_neighbor_info(const int neighborhood_id)
+	{
+		this->user_local_cells_on_process_boundary[neighborhood_id].clear();
+		this->user_remote_cells_on_process_boundary[neighborhood_id].clear();
 
-			// sequential tags for messages: 1, 2, ...
-			for (size_t i = 0; i < this->cells_to_send.at(process).size(); i++) {
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					const uint64_t cell = this->cells_to_send.at(process)[i].first;
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for sending cell " << cell
-						<< " to process " << process
-						<< std::endl;
-					abort();
-				}
-				this->cells_to_send.at(process)[i].second = tag;
+		for (const auto& item: this->cell_data) {
+
+			if (item.first != this->get_child(item.first)) {
+				continue;
 			}
-		}
 
-		// populate final receive list data structures and sort them
-		for (const auto& sender: unique_cells_to_receive) {
-			const int process = sender.first;
+			this->update_user_remote_neighbor_info(item.first, neighborhood_id);
 
 			#ifdef DEBUG
-			if ((uint64_t) process == this->rank) {
+			if (!this->verify_remote_neighbor_info(item.first)) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Process " << process << " would receive from self"
+					<< " Remote neighbor info for cell " << item.first
+					<< " is not consistent"
 					<< std::endl;
 				abort();
 			}
 			#endif
+		}
 
-			this->cells_to_receive[process].reserve(sender.second.size());
+		#ifdef DEBUG
+		if (!this->verify_remote_neighbor_info()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Remote neighbor info is not consistent"
+				<< std::endl;
+			abort();
+		}
+		#endif
+	}
 
-			for (const uint64_t cell: sender.second) {
-				this->cells_to_receive.at(process).push_back(
-					std::make_pair(cell, -1)
-				);
+
+	/*!
+	Returns true if cell1 considers cell2 as a neighbor, even if neither of them exists
+	*/
+	bool is_neighbor(const uint64_t cell1, const uint64_t cell2) const
+	{
+		#ifdef DEBUG
+		if (cell1 == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Invalid cell1 given." << std::endl;
+			abort();
+		}
+
+		if (cell1 > this->mapping.get_last_cell()) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Impossible cell1 given." << std::endl;
+			abort();
+		}
+
+		if (cell2 == 0) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Invalid cell2 given." << std::endl;
+			abort();
+		}
+
+		if (cell2 > this->mapping.get_last_cell()) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Impossible cell2 given." << std::endl;
+			abort();
+		}
+		#endif
+
+		const Types<3>::indices_t indices1 = this->mapping.get_indices(cell1);
+		const Types<3>::indices_t indices2 = this->mapping.get_indices(cell2);
+		const uint64_t cell1_length = this->mapping.get_cell_length_in_indices(cell1);
+		const uint64_t cell2_length = this->mapping.get_cell_length_in_indices(cell2);
+
+		// distance in indices between given cells
+		Types<3>::indices_t distance = {{0, 0, 0}};
+
+		const uint64_t grid_length[3] = {
+			this->length.get()[0] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
+			this->length.get()[1] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
+			this->length.get()[2] * (uint64_t(1) << this->mapping.get_maximum_refinement_level())
+		};
+
+		uint64_t max_distance = 0;
+
+		for (unsigned int i = 0; i < 3; i++) {
+			if (indices1[i] <= indices2[i]) {
+				if (indices2[i] <= indices1[i] + cell1_length) {
+					distance[i] = 0;
+				} else {
+					distance[i] = indices2[i] - (indices1[i] + cell1_length);
+				}
+
+				if (this->topology.is_periodic(i)) {
+					const uint64_t distance_to_end = grid_length[i] - (indices2[i] + cell2_length);
+					distance[i] = std::min(distance[i], indices1[i] + distance_to_end);
+				}
+			} else {
+				if (indices1[i] <= indices2[i] + cell2_length) {
+					distance[i] = 0;
+				} else {
+					distance[i] = indices1[i] - (indices2[i] + cell2_length);
+				}
+
+				if (this->topology.is_periodic(i)) {
+					const uint64_t distance_to_end = grid_length[i] - (indices1[i] + cell1_length);
+					distance[i] = std::min(distance[i], indices2[i] + distance_to_end);
+				}
 			}
 
-			if (this->cells_to_receive.at(process).size() > 0) {
-				std::sort(
-					this->cells_to_receive.at(process).begin(),
-					this->cells_to_receive.at(process).end()
-				);
+			max_distance = std::max(max_distance, distance[i]);
+		}
+
+		if (this->neighborhood_length == 0) {
+			if (max_distance < cell1_length
+			&& this->overlapping_indices(cell1, cell2) >= 2) {
+				return true;
+			// diagonal cell isn't a neighbor
+			} else {
+				return false;
 			}
+		}
 
-			// sequential tags for messages: 1, 2, ...
-			for (size_t i = 0; i < this->cells_to_receive.at(process).size(); i++) {
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					const uint64_t cell = this->cells_to_receive.at(process)[i].first;
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for receiving cell " << cell
-						<< " from process " << process
-						<< std::endl;
-					abort();
-				}
+		if (max_distance < this->neighborhood_length * cell1_length) {
+			return true;
+		} else {
+			return false;
+		}
+	}
+
+
+	/*!
+	Given a cell that exists and has children returns one of the children.
+
+	Returns the given cell if it doesn't have children or error_cell if the cell doesn't exist.
+	*/
+	uint64_t get_child(const uint64_t cell) const
+	{
+		if (this->cell_process.count(cell) == 0) {
+			return error_cell;
+		}
 
-				this->cells_to_receive.at(process)[i].second = tag;
-			}
+		const int refinement_level = this->mapping.get_refinement_level(cell);
+
+		// given cell cannot have children
+		if (refinement_level == this->mapping.get_maximum_refinement_level()) {
+			return cell;
 		}
-		for (const auto& item: this->user_hood_of) {
-			this->recalculate_neighbor_update_send_receive_lists(item.first);
+
+		const uint64_t child = this->mapping.get_cell_from_indices(
+			this->mapping.get_indices(cell),
+			refinement_level + 1
+		);
+
+		if (this->cell_process.count(child) > 0) {
+			return child;
 		}
+
+		return cell;
 	}
 
+
 	/*!
-	Same as the version without an id but for user defined neighborhood.
+	Enforces maximum refinement level difference between neighbors.
 
-	Updates send/receive lists of cells using only the given
-	neighborhood id.
+	Adds new cells to cells_to_refine in order to enforce maximum refinement
+	level difference of max_ref_lvl_diff between neighbors (also across processes).
+	After this function cells_to_refine will contain the refines of all processes.
 	*/
-	void recalculate_neighbor_update_send_receive_lists(const int neighborhood_id)
+	void induce_refines()
 	{
-		#ifdef DEBUG
-		if (this->user_local_cells_on_process_boundary.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No neighborhood with id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-		#endif
-
-		// clear previous lists
-		this->user_neigh_cells_to_send[neighborhood_id].clear();
-		this->user_neigh_cells_to_receive[neighborhood_id].clear();
+		const auto neighbor_processes = this->get_refine_neighbor_processes();
 
-		std::unordered_map<int, std::unordered_set<uint64_t>>
-			user_neigh_unique_sends,
-			user_neigh_unique_receives;
+		std::vector<uint64_t> new_refines(this->cells_to_refine.begin(), this->cells_to_refine.end());
+		while (All_Reduce()(new_refines.size(), this->comm) > 0) {
 
-		// calculate new lists for neighbor data updates
-		for (const uint64_t cell: this->user_local_cells_on_process_boundary.at(neighborhood_id)) {
+			// new refines of other processes
+			std::unordered_map<int, std::vector<uint64_t>> remote_new_refines;
+			if (this->neighbor_refine_propagation) {
+				// only processes with neighbors of refined cells need them
+				std::unordered_map<int, std::vector<uint64_t>> refines_to_send;
+				for (const uint64_t refined: new_refines) {
+					std::unordered_set<int> receivers;
+					for (const auto* const neighbors: {
+						&this->neighbors_of.at(refined),
+						&this->neighbors_to.at(refined)
+					}) {
+						for (const auto& neighbor_i: *neighbors) {
+							const auto& neighbor = neighbor_i.first;
+							if (neighbor == error_cell) {
+								continue;
+							}
 
-			#ifdef DEBUG
-			if (cell != this->get_child(cell)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << cell << " has children"
-					<< std::endl;
-				abort();
+							const uint64_t process = this->cell_process.at(neighbor);
+							if (process != this->rank) {
+								receivers.insert(int(process));
+							}
+						}
+					}
+					for (const int receiver: receivers) {
+						refines_to_send[receiver].push_back(refined);
+					}
+				}
+				Some_To_Some()(refines_to_send, neighbor_processes, remote_new_refines, this->some_to_some_comm);
+			} else {
+				std::vector<std::vector<uint64_t>> all_new_refines;
+				All_Gather()(new_refines, all_new_refines, this->comm);
+				for (unsigned int process = 0; process < this->comm_size; process++) {
+					if (process != this->rank) {
+						remote_new_refines[int(process)].swap(all_new_refines[process]);
+					}
+				}
 			}
-			#endif
 
-			// data must be received from neighbors_of
-			for (const auto& neighbor_i: this->user_neigh_of.at(neighborhood_id).at(cell)) {
-				const auto& neighbor = neighbor_i.first;
+			std::vector<uint64_t> local_new_refines;
+			local_new_refines.swap(new_refines);
 
-				if (neighbor == error_cell) {
-					continue;
+			std::unordered_set<uint64_t> unique_induced_refines;
+
+			// induced refines on this process
+			for (const uint64_t refined: local_new_refines) {
+
+				// refine local neighbors that are too large
+				for (const auto& neighbor_i: this->neighbors_of.at(refined)) {
+					const auto& neighbor = neighbor_i.first;
+
+					if (neighbor == error_cell) {
+						continue;
+					}
+
+					#ifdef DEBUG
+					if (this->cell_process.count(neighbor) == 0) {
+						std::cerr << "Process " << this->rank
+							<< ": Cell " << refined
+							<< " had a non-existing neighbor in neighbor list: " << neighbor
+							<< std::endl;
+					}
+					#endif
+
+					// TODO switch to is_local()
+					if (this->cell_process.at(neighbor) != this->rank) {
+						continue;
+					}
+
+					if (this->mapping.get_refinement_level(neighbor) < this->mapping.get_refinement_level(refined)) {
+						if (this->cells_to_refine.count(neighbor) == 0) {
+							unique_induced_refines.insert(neighbor);
+						}
+					}
 				}
 
-				if (this->cell_process.at(neighbor) != this->rank) {
-					user_neigh_unique_receives[int(this->cell_process.at(neighbor))].insert(neighbor);
+				for (const auto& neighbor_to_i: this->neighbors_to.at(refined)) {
+					const auto& neighbor_to = neighbor_to_i.first;
+
+					if (neighbor_to == error_cell) {
+						continue;
+					}
+
+					#ifdef DEBUG
+					if (this->cell_process.count(neighbor_to) == 0) {
+						std::cerr << "Process " << this->rank
+							<< ": Cell " << refined
+							<< " had a non-existing neighbor in neighbor list: " << neighbor_to
+							<< std::endl;
+					}
+					#endif
+
+					if (this->cell_process.at(neighbor_to) != this->rank) {
+						continue;
+					}
+
+					if (this->mapping.get_refinement_level(neighbor_to) < this->mapping.get_refinement_level(refined)) {
+						if (this->cells_to_refine.count(neighbor_to) == 0) {
+							unique_induced_refines.insert(neighbor_to);
+						}
+					}
 				}
 			}
 
-			// data must be sent to neighbors_to
-			for (const auto& neighbor_i: this->user_neigh_to.at(neighborhood_id).at(cell)) {
-				const auto& neighbor = neighbor_i.first;
+			// refines induced here by other processes
+			for (const auto& item: remote_new_refines) {
 
-				if (neighbor == error_cell) {
-					continue;
-				}
+				for (const uint64_t refined: item.second) {
 
-				if (this->cell_process.at(neighbor) != this->rank) {
-					user_neigh_unique_sends[int(this->cell_process.at(neighbor))].insert(cell);
+					if (this->remote_cells_on_process_boundary.count(refined) == 0) {
+						continue;
+					}
+
+					// refine all local cells that are too large and neighboring the refined cell
+					/*
+					TODO: probably faster to search for local neighbors of refined
+					cell, even faster would be to also store neighbors lists of
+					remote cells with local neighbors
+					*/
+					for (const uint64_t local: this->local_cells_on_process_boundary) {
+
+						if (this->is_neighbor(local, refined)
+						&& this->mapping.get_refinement_level(local) < this->mapping.get_refinement_level(refined)
+						&& this->cells_to_refine.count(local) == 0) {
+							unique_induced_refines.insert(local);
+						}
+					}
 				}
 			}
+			remote_new_refines.clear();
+
+			new_refines.insert(
+				new_refines.end(),
+				unique_induced_refines.begin(),
+				unique_induced_refines.end()
+			);
+			this->cells_to_refine.insert(
+				unique_induced_refines.begin(),
+				unique_induced_refines.end()
+			);
+			unique_induced_refines.clear();
 		}
 
-		// populate final send list data structures and sort them
-		for (std::unordered_map<int, std::unordered_set<uint64_t>>::const_iterator
-			receiver = user_neigh_unique_sends.begin();
-			receiver != user_neigh_unique_sends.end();
-			receiver++
-		) {
-			const int receiving_process = receiver->first;
+		// add refines from all processes to cells_to_refine
+		std::vector<uint64_t> refines(this->cells_to_refine.begin(), this->cells_to_refine.end());
+		std::vector<std::vector<uint64_t>> all_refines;
+		All_Gather()(refines, all_refines, this->comm);
 
-			std::vector<std::pair<uint64_t, int>>& current_cells_to_send
-				= this->user_neigh_cells_to_send.at(neighborhood_id)[receiving_process];
+		for (unsigned int process = 0; process < this->comm_size; process++) {
+			this->cells_to_refine.insert(all_refines[process].begin(), all_refines[process].end());
+		}
 
-			current_cells_to_send.reserve(receiver->second.size());
+		#ifdef DEBUG
+		// check that all required refines have been induced
+		for (const uint64_t refined: this->cells_to_refine) {
 
-			for (const uint64_t cell: receiver->second) {
-				current_cells_to_send.push_back(std::make_pair(cell, -1));
+			// only cells near local cells are known
+			if (this->distributed_ownership and not this->is_local(refined)) {
+				continue;
 			}
 
-			std::sort(current_cells_to_send.begin(), current_cells_to_send.end());
+			const auto neighbors_of
+				= this->find_neighbors_of(refined, this->neighborhood_of, this->max_ref_lvl_diff);
 
-			// sequential tags for messages: 1, 2, ...
-			for (unsigned int i = 0; i < current_cells_to_send.size(); i++) {
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					const uint64_t cell = current_cells_to_send[i].first;
+			for (const auto& neighbor_of_i: neighbors_of) {
+				const auto& neighbor_of = neighbor_of_i.first;
+
+				if (neighbor_of == error_cell) {
+					continue;
+				}
+
+				if (this->mapping.get_refinement_level(neighbor_of) < this->mapping.get_refinement_level(refined)
+				&& this->cells_to_refine.count(neighbor_of) == 0) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for sending cell " << cell
-						<< " to process " << receiving_process
+						<< " Neighbor (" << neighbor_of
+						<< ") of cell that will be refined (" << refined
+						<< ", ref lvl " << this->mapping.get_refinement_level(refined)
+						<< ") has too small refinement level: " << this->mapping.get_refinement_level(neighbor_of)
 						<< std::endl;
 					abort();
 				}
-
-				current_cells_to_send[i].second = tag;
 			}
-		}
-
-		// populate final receive list data structures and sort them
-		for (std::unordered_map<int, std::unordered_set<uint64_t>>::const_iterator
-			sender = user_neigh_unique_receives.begin();
-			sender != user_neigh_unique_receives.end();
-			sender++
-		) {
-			const int sending_process = sender->first;
-
-			std::vector<std::pair<uint64_t, int>>& current_cells_to_receive
-				= this->user_neigh_cells_to_receive[neighborhood_id][sending_process];
-
-			current_cells_to_receive.reserve(sender->second.size());
 
-			for (const uint64_t cell: sender->second) {
-				current_cells_to_receive.push_back(std::make_pair(cell, -1));
-			}
+			const auto neighbors_to
+				= this->find_neighbors_to(refined, this->neighborhood_to);
+			for (const auto& neighbor_to_i: neighbors_to) {
+				const auto& neighbor_to = neighbor_to_i.first;
 
-			std::sort(current_cells_to_receive.begin(), current_cells_to_receive.end());
+				if (neighbor_to == error_cell) {
+					continue;
+				}
 
-			// sequential tags for messages: 1, 2, ...
-			for (unsigned int i = 0; i < current_cells_to_receive.size(); i++) {
-				const int tag = (int) i + 1;
-				if (tag > (int) this->max_tag) {
-					const uint64_t cell = current_cells_to_receive[i].first;
+				if (this->mapping.get_refinement_level(neighbor_to) < this->mapping.get_refinement_level(refined)
+				&& this->cells_to_refine.count(neighbor_to) == 0) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Process " << this->rank
-						<< ": Message tag would overflow for receiving cell " << cell
-						<< " from process " << sending_process
+						<< " Neighbor (" << neighbor_to
+						<< ") of cell that will be refined (" << refined
+						<< ", ref lvl " << this->mapping.get_refinement_level(refined)
+						<< ") has too small refinement level: " << this->mapping.get_refinement_level(neighbor_to)
 						<< std::endl;
 					abort();
 				}
-
-				current_cells_to_receive[i].second = tag;
 			}
 		}
+
+		if (!this->is_consistent()) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Grid isn't consistent" << std::endl;
+			abort();
+		}
+		#endif
 	}
 
 
 	/*!
-	Updates neighbor and neighbor_to lists around given cell's neighborhood.
+	Returns the number of bytes of given cell in remote neighbor updates.
 
-	Does nothing in the following cases:
-		- given cell doesn't exist in the grid
-		- given cell has children
-	Assumes that the refinement level difference between given cell and
-	its neighborhood is no larger than 1.
+	\see get_communication_graph()
 	*/
-	void update_neighbors(const uint64_t cell)
-	{
-		if (this->cell_process.count(cell) == 0) {
-			return;
-		}
-
-		if (this->cell_process.at(cell) != this->rank) {
-			return;
-		}
-
-		if (cell != this->get_child(cell)) {
-			return;
+	uint64_t get_transfer_size(
+		Cell_Data& cell,
+		const uint64_t cell_id,
+		const int sender,
+		const int receiver,
+		const bool receiving,
+		const int neighborhood_id
+	) const {
+		if (this->packed_remote_neighbor_updates) {
+			return uint64_t(detail::get_cell_packed_size(
+				cell, cell_id, sender, receiver, receiving, neighborhood_id, this->comm
+			));
 		}
 
-		this->neighbors_of.at(cell) = this->find_neighbors_of(cell, this->neighborhood_of, this->max_ref_lvl_diff);
-		std::vector<uint64_t> found_neighbors_of;
-		for (const auto& i: this->neighbors_of.at(cell)) {
-			found_neighbors_of.push_back(i.first);
-		}
-		this->neighbors_to.at(cell) = this->find_neighbors_to(cell, found_neighbors_of);
+		return detail::get_cell_transfer_size(
+			cell, cell_id, sender, receiver, receiving, neighborhood_id
+		);
+	}
 
-		#ifdef DEBUG
-		if (
-			!this->verify_neighbors(
-				cell,
-				this->neighborhood_of,
-				this->neighborhood_to,
-				this->neighbors_of,
-				this->neighbors_to
-			)
-		) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Neighbor update failed for cell " << cell
-				<< " (child of " << this->get_parent(cell) << ")"
-				<< std::endl;
-			abort();
-		}
 
-		for (const auto& neighbor: this->neighbors_of.at(cell)) {
-			if (neighbor.first == error_cell) {
-				continue;
-			}
-			if (
-				neighbor.second[0] == 0
-				and neighbor.second[1] == 0
-				and neighbor.second[2] == 0
-			) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Invalid offset of neighbor " << neighbor.first
-					<< " for cell " << cell << std::endl;
-				abort();
+	/*!
+	Sets neighbor_processes from send and receive lists of all neighborhoods.
+	*/
+	void update_neighbor_processes()
+	{
+		this->neighbor_processes.clear();
+		for (const auto* const lists: {&this->cells_to_send, &this->cells_to_receive}) {
+			for (const auto& item: *lists) {
+				this->neighbor_processes.insert(uint64_t(item.first));
+			}
+		}
+		for (const auto* const hood_lists: {
+			&this->user_neigh_cells_to_send,
+			&this->user_neigh_cells_to_receive
+		}) {
+			for (const auto& hood_item: *hood_lists) {
+				for (const auto& item: hood_item.second) {
+					this->neighbor_processes.insert(uint64_t(item.first));
+				}
 			}
 		}
-		#endif
 	}
 
 
 	/*!
-	Updates the neighbors and _to of given cell based on given neighborhood.
+	Returns processes that have cells near local cells.
 
-	Does nothing in the following cases:
-		- given cell doesn't exist in the grid
-		- given cell has children
-	Assumes that update_neighbors(cell) has been called prior to this.
+	Those are processes in send and receive lists of remote neighbor
+	updates in the default neighborhood, any two processes either
+	have or don't have each other in returned processes.
 	*/
-	void update_user_neighbors(const uint64_t cell, const int neighborhood_id)
+	std::unordered_set<int> get_refine_neighbor_processes() const
 	{
-		if (this->user_hood_of.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No user neighborhood with id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
-
-		#ifdef DEBUG
-		if (this->user_hood_to.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No user neighborhood to with id " << neighborhood_id
-				<< std::endl;
-			abort();
+		std::unordered_set<int> processes;
+		for (const auto& item: this->cells_to_send) {
+			processes.insert(item.first);
 		}
-		#endif
-
-		// find neighbors_of, should be in order given by user
-		this->user_neigh_of[neighborhood_id][cell].clear();
-		for (const auto& item: this->user_hood_of[neighborhood_id]) {
-			const auto cells_at_offset
-				= this->get_neighbors_of_at_offset(cell, item[0], item[1], item[2]);
-			this->user_neigh_of[neighborhood_id][cell].insert(
-				this->user_neigh_of[neighborhood_id][cell].end(),
-				cells_at_offset.begin(),
-				cells_at_offset.end()
-			);
+		for (const auto& item: this->cells_to_receive) {
+			processes.insert(item.first);
 		}
-
-		// find neighbors_to
-		this->user_neigh_to[neighborhood_id][cell]
-			= this->find_neighbors_to(cell, this->user_hood_to[neighborhood_id]);
+		return processes;
 	}
 
 
 	/*!
-	Updates the remote neighbor info of given cell on this process without children.
-
-	Uses current neighbor lists.
-	Does nothing if given cell doesn't exist on this process or has children
+	Sends the numbers in s to all other processes and adds the numbers sent by all others to s.
 	*/
-	void update_remote_neighbor_info(const uint64_t cell)
+	void all_to_all_set(std::unordered_set<uint64_t>& s)
 	{
-		if (this->cell_data.count(cell) == 0) {
-			return;
-		}
-
-		if (cell != this->get_child(cell)) {
-			return;
-		}
-
-		// TODO: also update remote_cells_on_process_boundary
-		this->local_cells_on_process_boundary.erase(cell);
-
-		#ifdef DEBUG
-		if (this->neighbors_of.count(cell) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Neighbor list for cell " << cell
-				<< " doesn't exist"
-				<< std::endl;
-			abort();
-		}
-
-		if (this->neighbors_to.count(cell) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Neighbors_to list for cell " << cell
-				<< " doesn't exist"
-				<< std::endl;
-			abort();
-		}
-		#endif
-
-		// neighbors of given cell
-		for (const auto& neighbor_i: this->neighbors_of.at(cell)) {
-			const auto& neighbor = neighbor_i.first;
-
-			if (neighbor == error_cell) {
-				continue;
-			}
-
-			#ifdef DEBUG
-			if (this->cell_process.count(neighbor) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor " << neighbor
-					<< " doesn't exist in cell_process"
-					<< std::endl;
-				abort();
-			}
-			#endif
-
-			if (this->cell_process.at(neighbor) != this->rank) {
-				this->local_cells_on_process_boundary.insert(cell);
-				this->remote_cells_on_process_boundary.insert(neighbor);
-			}
-		}
-
-		// cells with given cell as neighbor
-		for (const auto& neighbor_to_i: this->neighbors_to.at(cell)) {
-			const auto& neighbor_to = neighbor_to_i.first;
+		std::vector<uint64_t> local_s(s.begin(), s.end());
 
-			#ifdef DEBUG
-			if (this->cell_process.count(neighbor_to) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor_to " << neighbor_to
-					<< " doesn't exist in cell_process"
-					<< std::endl;
-				abort();
-			}
-			#endif
+		std::vector<std::vector<uint64_t>> all_s;
+		All_Gather()(local_s, all_s, this->comm);
 
-			if (this->cell_process.at(neighbor_to) != this->rank) {
-				this->local_cells_on_process_boundary.insert(cell);
-				this->remote_cells_on_process_boundary.insert(neighbor_to);
+		for (const auto& i: all_s) {
+			for (const uint64_t cell: i) {
+				s.insert(cell);
 			}
 		}
-
-		#ifdef DEBUG
-		if (!this->verify_remote_neighbor_info(cell)) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info for cell " << cell
-				<< " is not consistent"
-				<< std::endl;
-			abort();
-		}
-		#endif
 	}
 
+
 	/*!
-	Updates the remote neighbor info of given cell on this process without children.
+	Overrides local unrefines based on global refines.
 
-	Uses current neighbor lists of neighborhood with given id.
-	Does nothing if given cell doesn't exist on this process or has children.
+	Removes cells from cells_to_unrefine in order to enforce maximum refinement level
+	difference of one between neighbors.
+	cells_to_refine must be identical between processes.
+	After this function cells_to_unrefine will contain the unrefines of all processes.
 	*/
-	void update_user_remote_neighbor_info(const uint64_t cell, const int neighborhood_id)
+	void override_unrefines()
 	{
-		if (this->cell_data.count(cell) == 0) {
-			return;
-		}
-
-		if (cell != this->get_child(cell)) {
-			return;
-		}
-
-		#ifdef DEBUG
-		if (this->user_hood_of.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No user neighborhood with id " << neighborhood_id
-				<< std::endl;
-			abort();
-		}
+		using std::to_string;
 
-		if (this->user_hood_to.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No user neighborhood to with id " << neighborhood_id
-				<< std::endl;
-			abort();
+		// neighbor searches below need cells near parents of local unrefines
+		if (this->distributed_ownership) {
+			std::vector<uint64_t> parents;
+			parents.reserve(this->cells_to_unrefine.size());
+			for (const uint64_t unrefined: this->cells_to_unrefine) {
+				parents.push_back(this->mapping.get_parent(unrefined));
+			}
+			this->fetch_cells_near(parents);
 		}
 
-		if (this->user_neigh_of.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No neighborhood with id " << neighborhood_id
-				<< " in neighbor lists"
-				<< std::endl;
-			abort();
-		}
+		this->all_to_all_set(this->cells_not_to_unrefine);
 
-		if (this->user_neigh_of.at(neighborhood_id).count(cell) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No neighbor list with neighborhood id " << neighborhood_id
-				<< " for cell " << cell
-				<< std::endl;
-			abort();
-		}
+		// unrefines that were not overridden
+		std::unordered_set<uint64_t> final_unrefines;
 
-		if (this->user_neigh_to.count(neighborhood_id) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No neighborhood with id " << neighborhood_id
-				<< " in neighbor_to lists"
-				<< std::endl;
-			abort();
-		}
+		// don't unrefine if...
+		for (const uint64_t unrefined: this->cells_to_unrefine) {
 
-		if (this->user_neigh_to.at(neighborhood_id).count(cell) == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " No neighbor_to list with neighborhood id " << neighborhood_id
-				<< " for cell " << cell
-				<< std::endl;
-			abort();
-		}
-		#endif
+			bool can_unrefine = true;
 
-		this->user_local_cells_on_process_boundary.at(neighborhood_id).erase(cell);
+			// ...any sibling cannot be
+			const uint64_t parent = this->get_parent(unrefined);
+			const std::vector<uint64_t> siblings = this->get_all_children(parent);
 
-		// neighbors of given cell
-		for (const auto& neighbor_i: this->user_neigh_of.at(neighborhood_id).at(cell)) {
-			const auto& neighbor = neighbor_i.first;
+			for (const uint64_t sibling: siblings) {
+				if (this->cells_to_refine.count(sibling) > 0
+				|| this->cells_not_to_unrefine.count(sibling) > 0) {
+					can_unrefine = false;
+					break;
+				}
+			}
 
-			if (neighbor == 0) {
+			if (!can_unrefine) {
 				continue;
 			}
 
+			// ...parent of unrefined wouldn't fulfill requirements
+			const int refinement_level = this->mapping.get_refinement_level(parent);
+
 			#ifdef DEBUG
-			if (this->cell_process.count(neighbor) == 0) {
+			if (parent == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__ << " Invalid parent" << std::endl;
+				abort();
+			}
+
+			if (refinement_level < 0) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor " << neighbor
-					<< " doesn't exist in cell_process"
+					<< " Invalid refinement level for parent"
 					<< std::endl;
 				abort();
 			}
 			#endif
 
-			if (this->cell_process.at(neighbor) != this->rank) {
-				this->user_local_cells_on_process_boundary.at(neighborhood_id).insert(cell);
-				this->user_remote_cells_on_process_boundary.at(neighborhood_id).insert(neighbor);
+			const auto neighbors
+				= this->find_neighbors_of(
+					parent,
+					this->neighborhood_of,
+					2 * this->max_ref_lvl_diff,
+					true
+				);
+
+			for (const auto& neighbor_i: neighbors) {
+				const auto& neighbor = neighbor_i.first;
+
+				const int neighbor_ref_lvl = this->mapping.get_refinement_level(neighbor);
+
+				if (neighbor_ref_lvl == refinement_level + this->max_ref_lvl_diff
+				&& this->cells_to_refine.count(neighbor) > 0) {
+					can_unrefine = false;
+					break;
+				}
+			}
+
+			if (can_unrefine) {
+				final_unrefines.insert(unrefined);
 			}
 		}
+		this->cells_to_unrefine.clear();
+		this->cells_not_to_unrefine.clear();
 
-		// cells with given cell as neighbor
-		for (const auto& neighbor_to_i: this->user_neigh_to.at(neighborhood_id).at(cell)) {
-			const auto& neighbor_to = neighbor_to_i.first;
+		// add unrefines from all processes to cells_to_unrefine
+		std::vector<uint64_t> unrefines(final_unrefines.begin(), final_unrefines.end());
+		std::vector<std::vector<uint64_t>> all_unrefines;
+		All_Gather()(unrefines, all_unrefines, this->comm);
 
-			#ifdef DEBUG
-			if (neighbor_to == error_cell) {
+		for (unsigned int process = 0; process < this->comm_size; process++) {
+			this->cells_to_unrefine.insert(
+				all_unrefines[process].begin(),
+				all_unrefines[process].end()
+			);
+		}
+
+		#ifdef DEBUG
+		// check that maximum refinement level difference between future neighbors <= 1
+		for (const uint64_t unrefined: this->cells_to_unrefine) {
+
+			// only cells near local cells are known
+			if (this->distributed_ownership and not this->is_local(unrefined)) {
+				continue;
+			}
+
+			if (unrefined != this->get_child(unrefined)) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Invalid cell in neighbor_to list of cell " << cell
+					<< " Cell " << unrefined
+					<< " has children"
 					<< std::endl;
 				abort();
 			}
 
-			if (this->cell_process.count(neighbor_to) == 0) {
+			if (this->cell_process.count(unrefined) == 0) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Neighbor_to " << neighbor_to
-					<< " doesn't exist in cell_process"
+					<< " Cell " << unrefined
+					<< " to be unrefined doesn't exist"
 					<< std::endl;
 				abort();
 			}
-			#endif
 
-			if (this->cell_process.at(neighbor_to) != this->rank) {
-				this->user_local_cells_on_process_boundary.at(neighborhood_id).insert(cell);
-				this->user_remote_cells_on_process_boundary.at(neighborhood_id).insert(neighbor_to);
+			if (this->cell_process.at(unrefined) == this->rank
+			&& this->cell_data.count(unrefined) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << unrefined
+					<< " to be unrefined has no data"
+					<< std::endl;
+				abort();
+			}
+
+			const int ref_lvl = this->mapping.get_refinement_level(unrefined);
+
+			// neighbors_of
+			const auto neighbors
+				= this->find_neighbors_of(
+					this->get_parent(unrefined),
+					this->neighborhood_of,
+					2 * this->max_ref_lvl_diff,
+					true
+				);
+
+			for (const auto& neighbor_i: neighbors) {
+				const auto& neighbor = neighbor_i.first;
+
+				if (neighbor == 0) {
+					continue;
+				}
+
+				const int neighbor_ref_lvl = this->mapping.get_refinement_level(neighbor);
+
+				if (neighbor_ref_lvl > ref_lvl) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Neighbor " << neighbor
+						<< " of cell that will be unrefined (" << unrefined
+						<< ", ref lvl " << ref_lvl
+						<< ") has too large refinement level: " << neighbor_ref_lvl
+						<< std::endl;
+					abort();
+				}
+
+				if (neighbor_ref_lvl == ref_lvl
+				&& this->cells_to_refine.count(neighbor) > 0) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Neighbor " << neighbor
+						<< " of cell that will be unrefined (" << unrefined
+						<< ", ref lvl " << ref_lvl
+						<< ") is identical in size and will be refined"
+						<< std::endl;
+					abort();
+				}
 			}
 		}
 
-		#ifdef DEBUG
-		if (!this->verify_remote_neighbor_info(cell)) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info for cell " << cell
-				<< " is not consistent"
-				<< std::endl;
+		if (!this->is_consistent()) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Grid isn't consistent" << std::endl;
 			abort();
 		}
 		#endif
@@ -9236,740 +16390,889 @@ private:
 
 
 	/*!
-	Updates the remote neighbor info of all cells on this process without children.
+	Records given request of *_concurrent() refinement functions.
 
-	Uses current neighbor lists.
+	Returns false if given cell isn't local, true otherwise.
 	*/
-	void update_remote_neighbor_info()
-	{
-		// TODO this probably can't be optimized without
-		// storing neighbor lists also for remote neighbors
-		this->local_cells_on_process_boundary.clear();
-		this->remote_cells_on_process_boundary.clear();
-
-		for (const auto& item: this->cell_data) {
-
-			if (item.first != this->get_child(item.first)) {
-				continue;
-			}
-
-			this->update_remote_neighbor_info(item.first);
+	bool add_concurrent_refine_request(
+		const uint64_t cell,
+		const Concurrent_Refine_Request request
+	) {
+		if (cell == error_cell) {
+			return false;
+		}
 
-			#ifdef DEBUG
-			if (!this->verify_remote_neighbor_info(item.first)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Remote neighbor info for cell " << item.first
-					<< " is not consistent"
-					<< std::endl;
-				abort();
-			}
-			#endif
+		if (this->cell_process.count(cell) == 0) {
+			return false;
 		}
 
-		#ifdef DEBUG
-		if (!this->verify_remote_neighbor_info()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info is not consistent"
-				<< std::endl;
-			abort();
+		if (this->cell_data.count(cell) == 0) {
+			return false;
 		}
-		#endif
+
+		auto& requests = this->concurrent_refine_requests[
+			std::hash<std::thread::id>()(std::this_thread::get_id())
+			% this->concurrent_refine_requests.size()
+		];
+		std::lock_guard<std::mutex> lock(requests.mutex);
+		requests.cells[request].push_back(cell);
+
+		return true;
 	}
 
+
 	/*!
-	Updates the remote neighbor info of all cells on this process without children.
+	Gives requests of *_concurrent() refinement functions to serial ones.
 
-	Uses current neighbor lists of neighborhood with given id.
+	Requests are applied in order of Concurrent_Refine_Request
+	and cell id so the result doesn't depend on which thread
+	made which request.
 	*/
-	void update_user_remote_neighbor_info(const int neighborhood_id)
+	void apply_concurrent_refine_requests()
 	{
-		this->user_local_cells_on_process_boundary[neighborhood_id].clear();
-		this->user_remote_cells_on_process_boundary[neighborhood_id].clear();
-
-		for (const auto& item: this->cell_data) {
-
-			if (item.first != this->get_child(item.first)) {
-				continue;
+		for (size_t request = 0; request < number_of_concurrent_refine_requests; request++) {
+			std::vector<uint64_t> cells;
+			for (auto& requests: this->concurrent_refine_requests) {
+				cells.insert(
+					cells.end(),
+					requests.cells[request].cbegin(),
+					requests.cells[request].cend()
+				);
+				requests.cells[request].clear();
 			}
 
-			this->update_user_remote_neighbor_info(item.first, neighborhood_id);
+			std::sort(cells.begin(), cells.end());
+			cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
 
-			#ifdef DEBUG
-			if (!this->verify_remote_neighbor_info(item.first)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Remote neighbor info for cell " << item.first
-					<< " is not consistent"
-					<< std::endl;
-				abort();
+			for (const auto& cell: cells) {
+				switch (request) {
+				case concurrent_dont_refine:
+					this->dont_refine(cell);
+					break;
+				case concurrent_refine:
+					this->refine_completely(cell);
+					break;
+				case concurrent_dont_unrefine:
+					this->dont_unrefine(cell);
+					break;
+				case concurrent_unrefine:
+					this->unrefine_completely(cell);
+					break;
+				default:
+					break;
+				}
 			}
-			#endif
-		}
-
-		#ifdef DEBUG
-		if (!this->verify_remote_neighbor_info()) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Remote neighbor info is not consistent"
-				<< std::endl;
-			abort();
 		}
-		#endif
 	}
 
 
 	/*!
-	Returns true if cell1 considers cell2 as a neighbor, even if neither of them exists
+	Removes cells from local cells_to_refine based on all dont_refines.
 	*/
-	bool is_neighbor(const uint64_t cell1, const uint64_t cell2) const
+	void override_refines()
 	{
-		#ifdef DEBUG
-		if (cell1 == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Invalid cell1 given." << std::endl;
-			abort();
-		}
+		using std::to_string;
 
-		if (cell1 > this->mapping.get_last_cell()) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Impossible cell1 given." << std::endl;
-			abort();
-		}
+		const auto neighbor_processes = this->get_refine_neighbor_processes();
+
+		// spread dont_refines accross processes and neighborhoods
+		std::unordered_set<uint64_t> new_donts, donts, old_donts;
+		bool spreading = true;
+		do {
+			donts = new_donts;
+			new_donts.clear();
 
-		if (cell2 == 0) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Invalid cell2 given." << std::endl;
-			abort();
-		}
+			donts.insert(this->cells_not_to_refine.cbegin(), this->cells_not_to_refine.cend());
+			this->cells_not_to_refine.clear();
 
-		if (cell2 > this->mapping.get_last_cell()) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Impossible cell2 given." << std::endl;
-			abort();
-		}
-		#endif
+			for (const auto& cell: donts) {
+				std::set<uint64_t> all_neighbors;
 
-		const Types<3>::indices_t indices1 = this->mapping.get_indices(cell1);
-		const Types<3>::indices_t indices2 = this->mapping.get_indices(cell2);
-		const uint64_t cell1_length = this->mapping.get_cell_length_in_indices(cell1);
-		const uint64_t cell2_length = this->mapping.get_cell_length_in_indices(cell2);
+				const auto* const neighs_of = this->get_neighbors_of(cell);
+				if (neighs_of != nullptr) {
+					for (const auto& n: *neighs_of) {
+						all_neighbors.insert(n.first);
+					}
+				}
 
-		// distance in indices between given cells
-		Types<3>::indices_t distance = {{0, 0, 0}};
+				const auto* const neighs_to = this->get_neighbors_to(cell);
+				if (neighs_to != nullptr) {
+					for (const auto& n: *neighs_to) {
+						all_neighbors.insert(n.first);
+					}
+				}
 
-		const uint64_t grid_length[3] = {
-			this->length.get()[0] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
-			this->length.get()[1] * (uint64_t(1) << this->mapping.get_maximum_refinement_level()),
-			this->length.get()[2] * (uint64_t(1) << this->mapping.get_maximum_refinement_level())
-		};
+				const auto ref_lvl = this->mapping.get_refinement_level(cell);
+				for (const auto& neighbor: all_neighbors) {
+					if (old_donts.count(neighbor) > 0 or donts.count(neighbor) > 0) {
+						continue;
+					}
 
-		uint64_t max_distance = 0;
+					const auto neigh_ref_lvl = this->mapping.get_refinement_level(neighbor);
+					if (neigh_ref_lvl > ref_lvl) {
+						new_donts.insert(neighbor);
+					}
+				}
+			}
+			old_donts.insert(donts.cbegin(), donts.cend());
+			donts.clear();
 
-		for (unsigned int i = 0; i < 3; i++) {
-			if (indices1[i] <= indices2[i]) {
-				if (indices2[i] <= indices1[i] + cell1_length) {
-					distance[i] = 0;
-				} else {
-					distance[i] = indices2[i] - (indices1[i] + cell1_length);
+			if (this->neighbor_refine_propagation) {
+				// only owners of new donts spread them further
+				std::unordered_map<int, std::vector<uint64_t>> donts_to_send, received_donts;
+				for (auto dont = new_donts.begin(); dont != new_donts.end(); ) {
+					const uint64_t process = this->cell_process.at(*dont);
+					if (process == this->rank) {
+						dont++;
+						continue;
+					}
+					donts_to_send[int(process)].push_back(*dont);
+					old_donts.insert(*dont);
+					dont = new_donts.erase(dont);
 				}
+				Some_To_Some()(donts_to_send, neighbor_processes, received_donts, this->some_to_some_comm);
 
-				if (this->topology.is_periodic(i)) {
-					const uint64_t distance_to_end = grid_length[i] - (indices2[i] + cell2_length);
-					distance[i] = std::min(distance[i], indices1[i] + distance_to_end);
+				for (const auto& item: received_donts) {
+					for (const uint64_t cell: item.second) {
+						if (old_donts.count(cell) == 0) {
+							new_donts.insert(cell);
+						}
+					}
 				}
+				spreading = All_Reduce()(new_donts.size(), this->comm) > 0;
 			} else {
-				if (indices1[i] <= indices2[i] + cell2_length) {
-					distance[i] = 0;
+				this->all_to_all_set(new_donts);
+				spreading = new_donts.size() > 0;
+			}
+		} while (spreading);
+
+		this->cells_not_to_refine = old_donts;
+		if (not this->neighbor_refine_propagation) {
+			this->all_to_all_set(this->cells_not_to_refine);
+		}
+
+		for (const auto& cell: this->cells_not_to_refine) {
+			this->cells_to_refine.erase(cell);
+		}
+
+		// We can't collect refines from all processes, since induce_refines() wants only local refines
+		if (this->neighbor_refine_propagation) {
+			for (auto refined = this->cells_to_refine.begin(); refined != this->cells_to_refine.end(); ) {
+				if (is_local(*refined)) {
+					refined++;
 				} else {
-					distance[i] = indices1[i] - (indices2[i] + cell2_length);
+					refined = this->cells_to_refine.erase(refined);
 				}
+			}
+		} else {
+			std::vector<uint64_t> refines(this->cells_to_refine.cbegin(), this->cells_to_refine.cend());
+			std::vector<std::vector<uint64_t>> all_refines;
+			All_Gather()(refines, all_refines, this->comm);
 
-				if (this->topology.is_periodic(i)) {
-					const uint64_t distance_to_end = grid_length[i] - (indices1[i] + cell1_length);
-					distance[i] = std::min(distance[i], indices2[i] + distance_to_end);
+			this->cells_to_refine.clear();
+			for (unsigned int process = 0; process < this->comm_size; process++) {
+				for (auto i : all_refines[process]) {
+					if (is_local(i)) {
+						this->cells_to_refine.insert(i);
+					}
 				}
 			}
-
-			max_distance = std::max(max_distance, distance[i]);
 		}
 
-		if (this->neighborhood_length == 0) {
-			if (max_distance < cell1_length
-			&& this->overlapping_indices(cell1, cell2) >= 2) {
-				return true;
-			// diagonal cell isn't a neighbor
-			} else {
-				return false;
+		#ifdef DEBUG
+		// check that maximum refinement level difference between future neighbors <= 1
+		for (const uint64_t refined: this->cells_to_refine) {
+
+			if (refined != this->get_child(refined)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << refined
+					<< " has children"
+					<< std::endl;
+				abort();
+			}
+
+			if (this->cell_process.count(refined) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << refined
+					<< " to be refined doesn't exist"
+					<< std::endl;
+				abort();
+			}
+
+			if (this->cell_process.at(refined) == this->rank
+			&& this->cell_data.count(refined) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << refined
+					<< " to be refined has no data"
+					<< std::endl;
+				abort();
 			}
 		}
 
-		if (max_distance < this->neighborhood_length * cell1_length) {
-			return true;
-		} else {
-			return false;
+		if (!this->is_consistent()) {
+			std::cerr << __FILE__ << ":" << __LINE__ << " Grid isn't consistent" << std::endl;
+			abort();
 		}
+		#endif
 	}
 
 
 	/*!
-	Given a cell that exists and has children returns one of the children.
+	Starts user data transfers between processes based on cells_to_send and cells_to_receive.
 
-	Returns the given cell if it doesn't have children or error_cell if the cell doesn't exist.
+	User data arriving to this process is saved in given destination except when using boost
+	and sending all cells in one message in which case the destination is actually used by
+	wait_user_data_transfer_receives(...).
 	*/
-	uint64_t get_child(const uint64_t cell) const
-	{
-		if (this->cell_process.count(cell) == 0) {
-			return error_cell;
-		}
-
-		const int refinement_level = this->mapping.get_refinement_level(cell);
+	template<class Destination> bool start_user_data_transfers(
+		Destination& destination,
+		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& receive_item,
+		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& send_item,
+		const int neighborhood_id
+	) {
+		bool ret_val = true;
 
-		// given cell cannot have children
-		if (refinement_level == this->mapping.get_maximum_refinement_level()) {
-			return cell;
+		if (!this->start_user_data_receives(destination, receive_item, neighborhood_id)) {
+			ret_val = false;
 		}
 
-		const uint64_t child = this->mapping.get_cell_from_indices(
-			this->mapping.get_indices(cell),
-			refinement_level + 1
-		);
-
-		if (this->cell_process.count(child) > 0) {
-			return child;
+		if (!this->start_user_data_sends(send_item, neighborhood_id)) {
+			ret_val = false;
 		}
 
-		return cell;
+		return ret_val;
 	}
 
 
 	/*!
-	Enforces maximum refinement level difference between neighbors.
-
-	Adds new cells to cells_to_refine in order to enforce maximum refinement
-	level difference of max_ref_lvl_diff between neighbors (also across processes).
-	After this function cells_to_refine will contain the refines of all processes.
+	Posts MPI_Irecvs for start_user_data_transfers().
 	*/
-	void induce_refines()
-	{
-		std::vector<uint64_t> new_refines(this->cells_to_refine.begin(), this->cells_to_refine.end());
-		while (All_Reduce()(new_refines.size(), this->comm) > 0) {
-
-			std::vector<std::vector<uint64_t>> all_new_refines;
-			All_Gather()(new_refines, all_new_refines, this->comm);
-			new_refines.clear();
-
-			std::unordered_set<uint64_t> unique_induced_refines;
-
-			// induced refines on this process
-			for (const uint64_t refined: all_new_refines.at(this->rank)) {
+	template<class Destination> bool start_user_data_receives(
+		Destination& destination,
+		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& receive_item,
+		const int neighborhood_id
+	) {
+		/*
+		Reserve space for incoming user data before posting any receives
+		as adding cells can move other cells' data in the destination.
+		TODO: move into a separate function callable by user
+		*/
+		for (const auto& sender: receive_item) {
+			for (const auto& item: sender.second) {
+				if (destination.count(item.first) == 0) {
+					destination[item.first];
+				}
+			}
+		}
 
-				// refine local neighbors that are too large
-				for (const auto& neighbor_i: this->neighbors_of.at(refined)) {
-					const auto& neighbor = neighbor_i.first;
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
+			sender = receive_item.begin();
+			sender != receive_item.end();
+			sender++
+		) {
+			const int sending_process = sender->first;
+			const size_t number_of_receives = sender->second.size();
 
-					if (neighbor == error_cell) {
-						continue;
-					}
+			#ifdef DEBUG
+			if (sending_process == (int) this->rank
+			&& number_of_receives > 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << this->rank
+					<< " trying to transfer to self"
+					<< std::endl;
+				abort();
+			}
+			#endif
 
-					#ifdef DEBUG
-					if (this->cell_process.count(neighbor) == 0) {
-						std::cerr << "Process " << this->rank
-							<< ": Cell " << refined
-							<< " had a non-existing neighbor in neighbor list: " << neighbor
-							<< std::endl;
-					}
-					#endif
+			int ret_val = -1;
 
-					// TODO switch to is_local()
-					if (this->cell_process.at(neighbor) != this->rank) {
-						continue;
-					}
+			if (this->send_single_cells) {
 
-					if (this->mapping.get_refinement_level(neighbor) < this->mapping.get_refinement_level(refined)) {
-						if (this->cells_to_refine.count(neighbor) == 0) {
-							unique_induced_refines.insert(neighbor);
-						}
-					}
-				}
+				for (std::vector<std::pair<uint64_t, int>>::const_iterator
+					item = sender->second.begin();
+					item != sender->second.end();
+					item++
+				) {
+					const uint64_t cell = item->first;
 
-				for (const auto& neighbor_to_i: this->neighbors_to.at(refined)) {
-					const auto& neighbor_to = neighbor_to_i.first;
+					this->receive_requests[sending_process].push_back(MPI_Request());
 
-					if (neighbor_to == error_cell) {
-						continue;
-					}
+					void* address = NULL;
+					int count = -1;
+					MPI_Datatype user_datatype = MPI_DATATYPE_NULL;
 
-					#ifdef DEBUG
-					if (this->cell_process.count(neighbor_to) == 0) {
-						std::cerr << "Process " << this->rank
-							<< ": Cell " << refined
-							<< " had a non-existing neighbor in neighbor list: " << neighbor_to
-							<< std::endl;
-					}
-					#endif
+					std::tie(
+						address,
+						count,
+						user_datatype
+					) = detail::get_cell_mpi_datatype(
+						destination.at(cell),
+						cell,
+						sending_process,
+						(int) this->rank,
+						true,
+						neighborhood_id
+					);
 
-					if (this->cell_process.at(neighbor_to) != this->rank) {
-						continue;
-					}
+					const bool is_named_datatype = Is_Named_Datatype()(user_datatype);
 
-					if (this->mapping.get_refinement_level(neighbor_to) < this->mapping.get_refinement_level(refined)) {
-						if (this->cells_to_refine.count(neighbor_to) == 0) {
-							unique_induced_refines.insert(neighbor_to);
+					if (!is_named_datatype) {
+						ret_val = MPI_Type_commit(&user_datatype);
+						if (ret_val != MPI_SUCCESS) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " MPI_Type_commit failed on process " << this->rank
+								<< ", for datatype of cell " << cell
+								<< " with returned buffer address " << address
+								<< " and returned count " << count
+								<< ": " << Error_String()(ret_val)
+								<< std::endl;
+							abort();
 						}
 					}
-				}
-			}
-
-			// refines induced here by other processes
-			for (unsigned int process = 0; process < this->comm_size; process++) {
-
-				if (process == this->rank) {
-					continue;
-				}
 
-				for (const uint64_t refined: all_new_refines.at(process)) {
+					ret_val = MPI_Irecv(
+						address,
+						count,
+						user_datatype,
+						sending_process,
+						item->second,
+						this->comm,
+						&(this->receive_requests[sending_process].back())
+					);
 
-					if (this->remote_cells_on_process_boundary.count(refined) == 0) {
-						continue;
+					if (ret_val != MPI_SUCCESS) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " MPI_Irecv failed on process " << this->rank
+							<< ", for cell " << cell
+							<< ", from process " << sending_process
+							<< ": " << Error_String()(ret_val)
+							<< std::endl;
+						abort();
 					}
 
-					// refine all local cells that are too large and neighboring the refined cell
-					/*
-					TODO: probably faster to search for local neighbors of refined
-					cell, even faster would be to also store neighbors lists of
-					remote cells with local neighbors
-					*/
-					for (const uint64_t local: this->local_cells_on_process_boundary) {
-
-						if (this->is_neighbor(local, refined)
-						&& this->mapping.get_refinement_level(local) < this->mapping.get_refinement_level(refined)
-						&& this->cells_to_refine.count(local) == 0) {
-							unique_induced_refines.insert(local);
+					if (!is_named_datatype) {
+						ret_val = MPI_Type_free(&user_datatype);
+						if (ret_val != MPI_SUCCESS) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " MPI_Type_free failed on process " << this->rank
+								<< ", for a derived datatype of cell " << cell
+								<< ": " << Error_String()(ret_val)
+								<< std::endl;
+							abort();
 						}
 					}
 				}
-			}
-			all_new_refines.clear();
-
-			new_refines.insert(
-				new_refines.end(),
-				unique_induced_refines.begin(),
-				unique_induced_refines.end()
-			);
-			this->cells_to_refine.insert(
-				unique_induced_refines.begin(),
-				unique_induced_refines.end()
-			);
-			unique_induced_refines.clear();
-		}
-
-		// add refines from all processes to cells_to_refine
-		std::vector<uint64_t> refines(this->cells_to_refine.begin(), this->cells_to_refine.end());
-		std::vector<std::vector<uint64_t>> all_refines;
-		All_Gather()(refines, all_refines, this->comm);
 
-		for (unsigned int process = 0; process < this->comm_size; process++) {
-			this->cells_to_refine.insert(all_refines[process].begin(), all_refines[process].end());
-		}
+			} else { // if this->send_single_cells
 
-		#ifdef DEBUG
-		// check that all required refines have been induced
-		for (const uint64_t refined: this->cells_to_refine) {
+				// get mpi transfer info from cells
+				std::vector<void*> addresses(number_of_receives, NULL);
+				std::vector<int> counts(number_of_receives, -1);
+				std::vector<MPI_Datatype> datatypes(number_of_receives, MPI_DATATYPE_NULL);
 
-			const auto neighbors_of
-				= this->find_neighbors_of(refined, this->neighborhood_of, this->max_ref_lvl_diff);
+				for (size_t i = 0; i < number_of_receives; i++) {
+					const uint64_t cell = sender->second[i].first;
 
-			for (const auto& neighbor_of_i: neighbors_of) {
-				const auto& neighbor_of = neighbor_of_i.first;
+					std::tie(
+						addresses[i],
+						counts[i],
+						datatypes[i]
+					) = detail::get_cell_mpi_datatype(
+						destination.at(cell),
+						cell,
+						sending_process,
+						(int) this->rank,
+						true,
+						neighborhood_id
+					);
+				}
 
-				if (neighbor_of == error_cell) {
-					continue;
+				// get displacements in bytes for incoming user data
+				std::vector<MPI_Aint> displacements(number_of_receives, 0);
+				for (size_t i = 0; i < number_of_receives; i++) {
+					displacements[i] = (uint8_t*) addresses[i] - (uint8_t*) addresses[0];
 				}
 
-				if (this->mapping.get_refinement_level(neighbor_of) < this->mapping.get_refinement_level(refined)
-				&& this->cells_to_refine.count(neighbor_of) == 0) {
+				MPI_Datatype receive_datatype;
+				ret_val = MPI_Type_create_struct(
+					(int) number_of_receives,
+					&counts[0],
+					&displacements[0],
+					&datatypes[0],
+					&receive_datatype
+				);
+				if (ret_val != MPI_SUCCESS) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Neighbor (" << neighbor_of
-						<< ") of cell that will be refined (" << refined
-						<< ", ref lvl " << this->mapping.get_refinement_level(refined)
-						<< ") has too small refinement level: " << this->mapping.get_refinement_level(neighbor_of)
+						<< " MPI_Type_create_struct failed for process " << this->rank
+						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
-			}
-
-			const auto neighbors_to
-				= this->find_neighbors_to(refined, this->neighborhood_to);
-			for (const auto& neighbor_to_i: neighbors_to) {
-				const auto& neighbor_to = neighbor_to_i.first;
-
-				if (neighbor_to == error_cell) {
-					continue;
-				}
 
-				if (this->mapping.get_refinement_level(neighbor_to) < this->mapping.get_refinement_level(refined)
-				&& this->cells_to_refine.count(neighbor_to) == 0) {
+				ret_val = MPI_Type_commit(&receive_datatype);
+				if (ret_val != MPI_SUCCESS) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Neighbor (" << neighbor_to
-						<< ") of cell that will be refined (" << refined
-						<< ", ref lvl " << this->mapping.get_refinement_level(refined)
-						<< ") has too small refinement level: " << this->mapping.get_refinement_level(neighbor_to)
+						<< " MPI_Type_commit failed for process " << this->rank
+						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
-			}
-		}
-
-		if (!this->is_consistent()) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Grid isn't consistent" << std::endl;
-			abort();
-		}
-		#endif
-	}
-
-
-	/*!
-	Sends the numbers in s to all other processes and adds the numbers sent by all others to s.
-	*/
-	void all_to_all_set(std::unordered_set<uint64_t>& s)
-	{
-		std::vector<uint64_t> local_s(s.begin(), s.end());
-
-		std::vector<std::vector<uint64_t>> all_s;
-		All_Gather()(local_s, all_s, this->comm);
-
-		for (const auto& i: all_s) {
-			for (const uint64_t cell: i) {
-				s.insert(cell);
-			}
-		}
-	}
-
-
-	/*!
-	Overrides local unrefines based on global refines.
-
-	Removes cells from cells_to_unrefine in order to enforce maximum refinement level
-	difference of one between neighbors.
-	cells_to_refine must be identical between processes.
-	After this function cells_to_unrefine will contain the unrefines of all processes.
-	*/
-	void override_unrefines()
-	{
-		using std::to_string;
-
-		this->all_to_all_set(this->cells_not_to_unrefine);
-
-		// unrefines that were not overridden
-		std::unordered_set<uint64_t> final_unrefines;
-
-		// don't unrefine if...
-		for (const uint64_t unrefined: this->cells_to_unrefine) {
 
-			bool can_unrefine = true;
+				this->receive_requests[sender->first].push_back(MPI_Request());
 
-			// ...any sibling cannot be
-			const uint64_t parent = this->get_parent(unrefined);
-			const std::vector<uint64_t> siblings = this->get_all_children(parent);
+				ret_val = MPI_Irecv(
+					addresses[0],
+					1,
+					receive_datatype,
+					sender->first,
+					0,
+					this->comm,
+					&(this->receive_requests[sender->first].back())
+				);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " MPI_Irecv failed for process " << this->rank
+						<< ", source process " << sender->first
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
 
-			for (const uint64_t sibling: siblings) {
-				if (this->cells_to_refine.count(sibling) > 0
-				|| this->cells_not_to_unrefine.count(sibling) > 0) {
-					can_unrefine = false;
-					break;
+				MPI_Type_free(&receive_datatype);
+				for (auto& type: datatypes) {
+					if (!Is_Named_Datatype()(type)) {
+						ret_val = MPI_Type_free(&type);
+						if (ret_val != MPI_SUCCESS) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " MPI_Type_free failed on process " << this->rank
+								<< ", for a derived datatype of user data: "
+								<< Error_String()(ret_val)
+								<< std::endl;
+							abort();
+						}
+					}
 				}
 			}
+		}
 
-			if (!can_unrefine) {
-				continue;
-			}
+		return true;
+	}
 
-			// ...parent of unrefined wouldn't fulfill requirements
-			const int refinement_level = this->mapping.get_refinement_level(parent);
 
-			#ifdef DEBUG
-			if (parent == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__ << " Invalid parent" << std::endl;
-				abort();
-			}
+	/*!
+	Posts MPI_Isends for start_user_data_transfers().
+	*/
+	bool start_user_data_sends(
+		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& send_item,
+		const int neighborhood_id
+	) {
+		int ret_val = -1;
 
-			if (refinement_level < 0) {
+		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
+			receiver = send_item.begin();
+			receiver != send_item.end();
+			receiver++
+		) {
+			const int receiving_process = receiver->first;
+			const size_t number_of_sends = receiver->second.size();
+
+			#ifdef DEBUG
+			if (receiving_process == (int) this->rank
+			&& number_of_sends > 0) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Invalid refinement level for parent"
+					<< " Trying to transfer to self"
 					<< std::endl;
 				abort();
 			}
 			#endif
 
-			const auto neighbors
-				= this->find_neighbors_of(
-					parent,
-					this->neighborhood_of,
-					2 * this->max_ref_lvl_diff,
-					true
-				);
+			if (this->send_single_cells) {
 
-			for (const auto& neighbor_i: neighbors) {
-				const auto& neighbor = neighbor_i.first;
+				for (std::vector<std::pair<uint64_t, int>>::const_iterator
+					item = receiver->second.begin();
+					item != receiver->second.end();
+					item++
+				) {
+					const uint64_t cell = item->first;
 
-				const int neighbor_ref_lvl = this->mapping.get_refinement_level(neighbor);
+					this->send_requests[receiving_process].push_back(MPI_Request());
 
-				if (neighbor_ref_lvl == refinement_level + this->max_ref_lvl_diff
-				&& this->cells_to_refine.count(neighbor) > 0) {
-					can_unrefine = false;
-					break;
-				}
-			}
+					void* address = NULL;
+					int count = -1;
+					MPI_Datatype user_datatype = MPI_DATATYPE_NULL;
 
-			if (can_unrefine) {
-				final_unrefines.insert(unrefined);
-			}
-		}
-		this->cells_to_unrefine.clear();
-		this->cells_not_to_unrefine.clear();
+					std::tie(
+						address,
+						count,
+						user_datatype
+					) = detail::get_cell_mpi_datatype(
+						this->cell_data.at(cell),
+						cell,
+						(int) this->rank,
+						receiving_process,
+						false,
+						neighborhood_id
+					);
 
-		// add unrefines from all processes to cells_to_unrefine
-		std::vector<uint64_t> unrefines(final_unrefines.begin(), final_unrefines.end());
-		std::vector<std::vector<uint64_t>> all_unrefines;
-		All_Gather()(unrefines, all_unrefines, this->comm);
+					const bool is_named_datatype = Is_Named_Datatype()(user_datatype);
 
-		for (unsigned int process = 0; process < this->comm_size; process++) {
-			this->cells_to_unrefine.insert(
-				all_unrefines[process].begin(),
-				all_unrefines[process].end()
-			);
-		}
+					if (!is_named_datatype) {
+						ret_val = MPI_Type_commit(&user_datatype);
+						if (ret_val != MPI_SUCCESS) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " MPI_Type_commit failed on process " << this->rank
+								<< ", for datatype of cell " << cell
+								<< " with returned buffer address " << address
+								<< " and returned count " << count
+								<< ": " << Error_String()(ret_val)
+								<< std::endl;
+							abort();
+						}
+					}
 
-		#ifdef DEBUG
-		// check that maximum refinement level difference between future neighbors <= 1
-		for (const uint64_t unrefined: this->cells_to_unrefine) {
+					ret_val = MPI_Isend(
+						address,
+						count,
+						user_datatype,
+						receiving_process,
+						item->second,
+						this->comm,
+						&(this->send_requests[receiving_process].back())
+					);
 
-			if (unrefined != this->get_child(unrefined)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << unrefined
-					<< " has children"
-					<< std::endl;
-				abort();
-			}
+					if (ret_val != MPI_SUCCESS) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " MPI_Isend failed on process " << this->rank
+							<< ", for cell " << cell
+							<< ", to process " << receiving_process
+							<< ": " << Error_String()(ret_val)
+							<< std::endl;
+						abort();
+					}
 
-			if (this->cell_process.count(unrefined) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << unrefined
-					<< " to be unrefined doesn't exist"
-					<< std::endl;
-				abort();
-			}
+					if (!is_named_datatype) {
+						ret_val = MPI_Type_free(&user_datatype);
+						if (ret_val != MPI_SUCCESS) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " MPI_Type_free failed on process " << this->rank
+								<< ", for a derived datatype of cell " << cell
+								<< ": " << Error_String()(ret_val)
+								<< std::endl;
+							abort();
+						}
+					}
+				}
 
-			if (this->cell_process.at(unrefined) == this->rank
-			&& this->cell_data.count(unrefined) == 0) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << unrefined
-					<< " to be unrefined has no data"
-					<< std::endl;
-				abort();
-			}
+			} else { // if this->send_single_cells
 
-			const int ref_lvl = this->mapping.get_refinement_level(unrefined);
+				// get mpi transfer info from cells
+				std::vector<void*> addresses(number_of_sends, NULL);
+				std::vector<int> counts(number_of_sends, -1);
+				std::vector<MPI_Datatype> datatypes(number_of_sends, MPI_DATATYPE_NULL);
 
-			// neighbors_of
-			const auto neighbors
-				= this->find_neighbors_of(
-					this->get_parent(unrefined),
-					this->neighborhood_of,
-					2 * this->max_ref_lvl_diff,
-					true
-				);
+				for (size_t i = 0; i < number_of_sends; i++) {
+					const uint64_t cell = receiver->second[i].first;
 
-			for (const auto& neighbor_i: neighbors) {
-				const auto& neighbor = neighbor_i.first;
+					std::tie(
+						addresses[i],
+						counts[i],
+						datatypes[i]
+					) = detail::get_cell_mpi_datatype(
+						this->cell_data.at(cell),
+						cell,
+						(int) this->rank,
+						receiving_process,
+						false,
+						neighborhood_id
+					);
+				}
 
-				if (neighbor == 0) {
-					continue;
+				// get displacements in bytes for outgoing user data
+				std::vector<MPI_Aint> displacements(number_of_sends, 0);
+				for (size_t i = 0; i < number_of_sends; i++) {
+					displacements[i] = (uint8_t*) addresses[i] - (uint8_t*) addresses[0];
 				}
 
-				const int neighbor_ref_lvl = this->mapping.get_refinement_level(neighbor);
+				MPI_Datatype send_datatype;
 
-				if (neighbor_ref_lvl > ref_lvl) {
+				ret_val = MPI_Type_create_struct(
+					(int) number_of_sends,
+					&counts[0],
+					&displacements[0],
+					&datatypes[0],
+					&send_datatype
+				);
+				if (ret_val != MPI_SUCCESS) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Neighbor " << neighbor
-						<< " of cell that will be unrefined (" << unrefined
-						<< ", ref lvl " << ref_lvl
-						<< ") has too large refinement level: " << neighbor_ref_lvl
+						<< " MPI_Type_create_struct failed for process " << this->rank
+						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
 
-				if (neighbor_ref_lvl == ref_lvl
-				&& this->cells_to_refine.count(neighbor) > 0) {
+				MPI_Type_commit(&send_datatype);
+				if (ret_val != MPI_SUCCESS) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " Neighbor " << neighbor
-						<< " of cell that will be unrefined (" << unrefined
-						<< ", ref lvl " << ref_lvl
-						<< ") is identical in size and will be refined"
+						<< " MPI_Type_commit failed for process " << this->rank
+						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
+
+				this->send_requests[receiver->first].push_back(MPI_Request());
+
+				ret_val = MPI_Isend(
+					addresses[0],
+					1,
+					send_datatype,
+					receiver->first,
+					0,
+					this->comm,
+					&(this->send_requests[receiver->first].back())
+				);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " MPI_Isend failed from process " << this->rank
+						<< ", target process " << receiver->first
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+
+				MPI_Type_free(&send_datatype);
+				for (auto& type: datatypes) {
+					if (!Is_Named_Datatype()(type)) {
+						ret_val = MPI_Type_free(&type);
+						if (ret_val != MPI_SUCCESS) {
+							std::cerr << __FILE__ << ":" << __LINE__
+								<< " MPI_Type_free failed on process " << this->rank
+								<< ", for a derived datatype of user data: "
+								<< Error_String()(ret_val)
+								<< std::endl;
+							abort();
+						}
+					}
+				}
 			}
 		}
 
-		if (!this->is_consistent()) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Grid isn't consistent" << std::endl;
-			abort();
-		}
-		#endif
+		return true;
 	}
 
 
 	/*!
-	Removes cells from local cells_to_refine based on all dont_refines.
+	Waits for the receives of user data transfers between processes to complete.
+
+	User data arriving to this process is saved in given destination.
 	*/
-	void override_refines()
+	bool wait_user_data_transfer_receives()
 	{
-		using std::to_string;
-
-		// spread dont_refines accross processes and neighborhoods
-		std::unordered_set<uint64_t> new_donts, donts, old_donts;
-		do {
-			donts = new_donts;
-			new_donts.clear();
-
-			donts.insert(this->cells_not_to_refine.cbegin(), this->cells_not_to_refine.cend());
-			this->cells_not_to_refine.clear();
+		bool success = true;
+		int ret_val = -1;
 
-			for (const auto& cell: donts) {
-				std::set<uint64_t> all_neighbors;
+		for (std::unordered_map<int, std::vector<MPI_Request>>::iterator
+			process = this->receive_requests.begin();
+			process != this->receive_requests.end();
+			process++
+		) {
+			std::vector<MPI_Status> statuses;
+			statuses.resize(process->second.size());
 
-				const auto* const neighs_of = this->get_neighbors_of(cell);
-				if (neighs_of != nullptr) {
-					for (const auto& n: *neighs_of) {
-						all_neighbors.insert(n.first);
+			ret_val = MPI_Waitall(process->second.size(), &(process->second[0]), &(statuses[0]));
+			if (ret_val != MPI_SUCCESS) {
+				for (const auto& status: statuses) {
+					if (status.MPI_ERROR != MPI_SUCCESS) {
+						success = false;
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " MPI receive failed from process " << status.MPI_SOURCE
+							<< " with tag " << status.MPI_TAG
+							<< std::endl;
 					}
 				}
+			}
+		}
 
-				const auto* const neighs_to = this->get_neighbors_to(cell);
-				if (neighs_to != nullptr) {
-					for (const auto& n: *neighs_to) {
-						all_neighbors.insert(n.first);
-					}
-				}
+		this->receive_requests.clear();
 
-				const auto ref_lvl = this->mapping.get_refinement_level(cell);
-				for (const auto& neighbor: all_neighbors) {
-					if (old_donts.count(neighbor) > 0 or donts.count(neighbor) > 0) {
-						continue;
-					}
+		return success;
+	}
 
-					const auto neigh_ref_lvl = this->mapping.get_refinement_level(neighbor);
-					if (neigh_ref_lvl > ref_lvl) {
-						new_donts.insert(neighbor);
+
+	/*!
+	Waits for the sends of user data transfers between processes to complete.
+	*/
+	bool wait_user_data_transfer_sends()
+	{
+		for (std::unordered_map<int, std::vector<MPI_Request>>::iterator
+			process = this->send_requests.begin();
+			process != this->send_requests.end();
+			process++
+		) {
+			std::vector<MPI_Status> statuses;
+			statuses.resize(process->second.size());
+
+			if (
+				MPI_Waitall(process->second.size(), &(process->second[0]), &(statuses[0]))
+				!= MPI_SUCCESS
+			) {
+				for (const auto& status: statuses) {
+					if (status.MPI_ERROR != MPI_SUCCESS) {
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " MPI receive failed from process " << status.MPI_SOURCE
+							<< " with tag " << status.MPI_TAG
+							<< std::endl;
+						abort();
 					}
 				}
 			}
-			old_donts.insert(donts.cbegin(), donts.cend());
-			donts.clear();
+		}
 
-			this->all_to_all_set(new_donts);
-		} while (new_donts.size() > 0);
+		this->send_requests.clear();
 
-		this->cells_not_to_refine = old_donts;
-		this->all_to_all_set(this->cells_not_to_refine);
+		return true;
+	}
 
-		for (const auto& cell: this->cells_not_to_refine) {
-			this->cells_to_refine.erase(cell);
-		}
 
-		std::vector<uint64_t> refines(this->cells_to_refine.cbegin(), this->cells_to_refine.cend());
-		std::vector<std::vector<uint64_t>> all_refines;
-		All_Gather()(refines, all_refines, this->comm);
+	/*!
+	Starts persistent receives of remote neighbor updates of given neighborhood.
 
-		// We can't collect refines from all processes, since induce_refines() wants only local refines
-		this->cells_to_refine.clear();
-		for (unsigned int process = 0; process < this->comm_size; process++) {
-			for (auto i : all_refines[process]) {
-				if (is_local(i)) {
-					this->cells_to_refine.insert(i);
-				}
-			}
-		}
+	Requests are waited for and not freed by wait_user_data_transfer_receives().
+	*/
+	bool start_persistent_receives(const int neighborhood_id)
+	{
+		auto& transfers = this->get_persistent_transfers(neighborhood_id);
 
 		#ifdef DEBUG
-		// check that maximum refinement level difference between future neighbors <= 1
-		for (const uint64_t refined: this->cells_to_refine) {
+		this->verify_persistent_transfer_info(transfers.receive_info, true, neighborhood_id);
+		#endif
 
-			if (refined != this->get_child(refined)) {
-				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << refined
-					<< " has children"
-					<< std::endl;
-				abort();
+		for (auto& sender: transfers.receives) {
+			if (sender.second.size() == 0) {
+				continue;
 			}
 
-			if (this->cell_process.count(refined) == 0) {
+			const int ret_val = MPI_Startall(int(sender.second.size()), sender.second.data());
+			if (ret_val != MPI_SUCCESS) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << refined
-					<< " to be refined doesn't exist"
+					<< " MPI_Startall failed on process " << this->rank
+					<< " for receives from process " << sender.first
+					<< ": " << Error_String()(ret_val)
 					<< std::endl;
 				abort();
 			}
 
-			if (this->cell_process.at(refined) == this->rank
-			&& this->cell_data.count(refined) == 0) {
+			// persistent requests stay allocated after completion
+			auto& requests = this->receive_requests[sender.first];
+			requests.insert(requests.end(), sender.second.cbegin(), sender.second.cend());
+		}
+
+		return true;
+	}
+
+	/*!
+	Starts persistent sends of remote neighbor updates of given neighborhood.
+	*/
+	bool start_persistent_sends(const int neighborhood_id)
+	{
+		auto& transfers = this->get_persistent_transfers(neighborhood_id);
+
+		#ifdef DEBUG
+		this->verify_persistent_transfer_info(transfers.send_info, false, neighborhood_id);
+		#endif
+
+		for (auto& receiver: transfers.sends) {
+			if (receiver.second.size() == 0) {
+				continue;
+			}
+
+			const int ret_val = MPI_Startall(int(receiver.second.size()), receiver.second.data());
+			if (ret_val != MPI_SUCCESS) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Cell " << refined
-					<< " to be refined has no data"
+					<< " MPI_Startall failed on process " << this->rank
+					<< " for sends to process " << receiver.first
+					<< ": " << Error_String()(ret_val)
 					<< std::endl;
 				abort();
 			}
-		}
 
-		if (!this->is_consistent()) {
-			std::cerr << __FILE__ << ":" << __LINE__ << " Grid isn't consistent" << std::endl;
-			abort();
+			auto& requests = this->send_requests[receiver.first];
+			requests.insert(requests.end(), receiver.second.cbegin(), receiver.second.cend());
 		}
-		#endif
+
+		return true;
 	}
 
 
 	/*!
-	Starts user data transfers between processes based on cells_to_send and cells_to_receive.
+	Returns persistent requests of remote neighbor updates of given neighborhood.
 
-	User data arriving to this process is saved in given destination except when using boost
-	and sending all cells in one message in which case the destination is actually used by
-	wait_user_data_transfer_receives(...).
+	Creates requests and datatypes from current cells to send and
+	receive of the neighborhood if they don't exist.
 	*/
-	bool start_user_data_transfers(
-		std::unordered_map<uint64_t, Cell_Data>& destination,
-		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& receive_item,
-		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& send_item,
-		const int neighborhood_id
-	) {
-		bool ret_val = true;
-
-		if (!this->start_user_data_receives(destination, receive_item, neighborhood_id)) {
-			ret_val = false;
+	Persistent_Transfers& get_persistent_transfers(const int neighborhood_id)
+	{
+		auto item = this->persistent_transfers.find(neighborhood_id);
+		if (item != this->persistent_transfers.end()) {
+			return item->second;
+		}
+
+		const auto& receive_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_receive
+			: this->user_neigh_cells_to_receive.at(neighborhood_id);
+		const auto& send_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_send
+			: this->user_neigh_cells_to_send.at(neighborhood_id);
+
+		// receives must not add cells into remote_neighbors later
+		bool added_remote_neighbors = false;
+		for (const auto& sender: receive_item) {
+			for (const auto& cell_item: sender.second) {
+				if (this->remote_neighbors.count(cell_item.first) == 0) {
+					this->remote_neighbors[cell_item.first];
+					added_remote_neighbors = true;
+				}
+			}
 		}
-
-		if (!this->start_user_data_sends(send_item, neighborhood_id)) {
-			ret_val = false;
+		// which might have moved data of other neighborhoods' transfers
+		if (added_remote_neighbors and not Cell_Storage::stable_addresses) {
+			this->free_persistent_transfers();
 		}
 
-		return ret_val;
+		auto& transfers = this->persistent_transfers[neighborhood_id];
+		this->create_persistent_requests(receive_item, true, neighborhood_id, transfers);
+		this->create_persistent_requests(send_item, false, neighborhood_id, transfers);
+
+		return transfers;
 	}
 
 
 	/*!
-	Posts MPI_Irecvs for start_user_data_transfers().
+	Creates persistent receives or sends of given cells for given transfers.
+
+	Creates one request per cell if send_single_cells is true
+	and one request per process otherwise.
 	*/
-	bool start_user_data_receives(
-		std::unordered_map<uint64_t, Cell_Data>& destination,
-		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& receive_item,
-		const int neighborhood_id
+	void create_persistent_requests(
+		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& transfer_item,
+		const bool receiving,
+		const int neighborhood_id,
+		Persistent_Transfers& transfers
 	) {
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
-			sender = receive_item.begin();
-			sender != receive_item.end();
-			sender++
-		) {
-			const int sending_process = sender->first;
-			const size_t number_of_receives = sender->second.size();
+		auto& cells = receiving ? this->remote_neighbors : this->cell_data;
+		auto& requests = receiving ? transfers.receives : transfers.sends;
+
+		int ret_val = -1;
+		for (const auto& process_item: transfer_item) {
+			const int other_process = process_item.first;
+			const auto& cells_item = process_item.second;
+			if (cells_item.size() == 0) {
+				continue;
+			}
 
 			#ifdef DEBUG
-			if (sending_process == (int) this->rank
-			&& number_of_receives > 0) {
+			if (other_process == (int) this->rank) {
 				std::cerr << __FILE__ << ":" << __LINE__
 					<< " Process " << this->rank
 					<< " trying to transfer to self"
@@ -9978,465 +17281,837 @@ private:
 			}
 			#endif
 
-			int ret_val = -1;
-
-			if (this->send_single_cells) {
-
-				for (std::vector<std::pair<uint64_t, int>>::const_iterator
-					item = sender->second.begin();
-					item != sender->second.end();
-					item++
-				) {
-					const uint64_t cell = item->first;
-
-					if (destination.count(cell) == 0) {
-						destination[cell];
-					}
+			// get mpi transfer info from cells
+			std::vector<void*> addresses(cells_item.size(), NULL);
+			std::vector<int> counts(cells_item.size(), -1);
+			std::vector<MPI_Datatype> datatypes(cells_item.size(), MPI_DATATYPE_NULL);
 
-					this->receive_requests[sending_process].push_back(MPI_Request());
+			for (size_t i = 0; i < cells_item.size(); i++) {
+				const uint64_t cell = cells_item[i].first;
 
-					void* address = NULL;
-					int count = -1;
-					MPI_Datatype user_datatype = MPI_DATATYPE_NULL;
+				std::tie(
+					addresses[i],
+					counts[i],
+					datatypes[i]
+				) = detail::get_cell_mpi_datatype(
+					cells.at(cell),
+					cell,
+					receiving ? other_process : (int) this->rank,
+					receiving ? (int) this->rank : other_process,
+					receiving,
+					neighborhood_id
+				);
 
-					std::tie(
-						address,
-						count,
-						user_datatype
-					) = detail::get_cell_mpi_datatype(
-						destination.at(cell),
-						cell,
-						sending_process,
-						(int) this->rank,
-						true,
-						neighborhood_id
-					);
+				#ifdef DEBUG
+				(receiving ? transfers.receive_info : transfers.send_info).emplace_back(
+					cell, other_process, addresses[i], counts[i]
+				);
+				#endif
+			}
 
-					const bool is_named_datatype = Is_Named_Datatype()(user_datatype);
+			if (this->send_single_cells) {
 
-					if (!is_named_datatype) {
-						ret_val = MPI_Type_commit(&user_datatype);
+				for (size_t i = 0; i < cells_item.size(); i++) {
+					if (!Is_Named_Datatype()(datatypes[i])) {
+						ret_val = MPI_Type_commit(&datatypes[i]);
 						if (ret_val != MPI_SUCCESS) {
 							std::cerr << __FILE__ << ":" << __LINE__
 								<< " MPI_Type_commit failed on process " << this->rank
-								<< ", for datatype of cell " << cell
-								<< " with returned buffer address " << address
-								<< " and returned count " << count
+								<< ", for datatype of cell " << cells_item[i].first
 								<< ": " << Error_String()(ret_val)
 								<< std::endl;
 							abort();
 						}
+						transfers.datatypes.push_back(datatypes[i]);
 					}
 
-					ret_val = MPI_Irecv(
-						address,
-						count,
-						user_datatype,
-						sending_process,
-						item->second,
-						this->comm,
-						&(this->receive_requests[sending_process].back())
-					);
-
+					requests[other_process].push_back(MPI_REQUEST_NULL);
+					if (receiving) {
+						ret_val = MPI_Recv_init(
+							addresses[i],
+							counts[i],
+							datatypes[i],
+							other_process,
+							cells_item[i].second,
+							this->comm,
+							&(requests[other_process].back())
+						);
+					} else {
+						ret_val = MPI_Send_init(
+							addresses[i],
+							counts[i],
+							datatypes[i],
+							other_process,
+							cells_item[i].second,
+							this->comm,
+							&(requests[other_process].back())
+						);
+					}
 					if (ret_val != MPI_SUCCESS) {
-						std::cerr << __FILE__ << ":" << __LINE__
-							<< " MPI_Irecv failed on process " << this->rank
-							<< ", for cell " << cell
-							<< ", from process " << sending_process
+						std::cerr << __FILE__ << ":" << __LINE__
+							<< " Couldn't create persistent request on process " << this->rank
+							<< " for cell " << cells_item[i].first
+							<< " with process " << other_process
 							<< ": " << Error_String()(ret_val)
 							<< std::endl;
 						abort();
 					}
+				}
 
-					if (!is_named_datatype) {
-						ret_val = MPI_Type_free(&user_datatype);
+			} else { // if this->send_single_cells
+
+				// get displacements in bytes for user data
+				std::vector<MPI_Aint> displacements(cells_item.size(), 0);
+				for (size_t i = 0; i < cells_item.size(); i++) {
+					displacements[i] = (uint8_t*) addresses[i] - (uint8_t*) addresses[0];
+				}
+
+				MPI_Datatype transfer_datatype;
+				ret_val = MPI_Type_create_struct(
+					(int) cells_item.size(),
+					counts.data(),
+					displacements.data(),
+					datatypes.data(),
+					&transfer_datatype
+				);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " MPI_Type_create_struct failed for process " << this->rank
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+
+				ret_val = MPI_Type_commit(&transfer_datatype);
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " MPI_Type_commit failed for process " << this->rank
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
+				}
+				transfers.datatypes.push_back(transfer_datatype);
+
+				for (auto& type: datatypes) {
+					if (!Is_Named_Datatype()(type)) {
+						ret_val = MPI_Type_free(&type);
 						if (ret_val != MPI_SUCCESS) {
 							std::cerr << __FILE__ << ":" << __LINE__
 								<< " MPI_Type_free failed on process " << this->rank
-								<< ", for a derived datatype of cell " << cell
-								<< ": " << Error_String()(ret_val)
+								<< ", for a derived datatype of user data: "
+								<< Error_String()(ret_val)
 								<< std::endl;
 							abort();
 						}
 					}
 				}
 
-			} else { // if this->send_single_cells
-
-				// reserve space for incoming user data in this end
-				// TODO: move into a separate function callable by user
-				for (size_t i = 0; i < number_of_receives; i++) {
-					const uint64_t cell = sender->second[i].first;
-					if (destination.count(cell) == 0) {
-						destination[cell];
-					}
+				requests[other_process].push_back(MPI_REQUEST_NULL);
+				if (receiving) {
+					ret_val = MPI_Recv_init(
+						addresses[0],
+						1,
+						transfer_datatype,
+						other_process,
+						0,
+						this->comm,
+						&(requests[other_process].back())
+					);
+				} else {
+					ret_val = MPI_Send_init(
+						addresses[0],
+						1,
+						transfer_datatype,
+						other_process,
+						0,
+						this->comm,
+						&(requests[other_process].back())
+					);
+				}
+				if (ret_val != MPI_SUCCESS) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Couldn't create persistent request on process " << this->rank
+						<< " with process " << other_process
+						<< ": " << Error_String()(ret_val)
+						<< std::endl;
+					abort();
 				}
+			}
+		}
+	}
 
-				// get mpi transfer info from cells
-				std::vector<void*> addresses(number_of_receives, NULL);
-				std::vector<int> counts(number_of_receives, -1);
-				std::vector<MPI_Datatype> datatypes(number_of_receives, MPI_DATATYPE_NULL);
 
-				for (size_t i = 0; i < number_of_receives; i++) {
-					const uint64_t cell = sender->second[i].first;
+	/*!
+	Prepares receiving packed remote neighbor updates of given neighborhood.
 
-					std::tie(
-						addresses[i],
-						counts[i],
-						datatypes[i]
-					) = detail::get_cell_mpi_datatype(
-						destination.at(cell),
-						cell,
-						sending_process,
-						(int) this->rank,
-						true,
-						neighborhood_id
-					);
-				}
+	Packed size of a cell can depend on data that only the sender
+	has so nothing is posted here, unpack_remote_neighbor_data()
+	receives each message with a buffer sized from the message.
+	*/
+	bool start_packed_receives(const int neighborhood_id)
+	{
+		const auto& receive_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_receive
+			: this->user_neigh_cells_to_receive.at(neighborhood_id);
 
-				// get displacements in bytes for incoming user data
-				std::vector<MPI_Aint> displacements(number_of_receives, 0);
-				for (size_t i = 0; i < number_of_receives; i++) {
-					displacements[i] = (uint8_t*) addresses[i] - (uint8_t*) addresses[0];
+		// adding cells later could move other cells' data
+		for (const auto& sender: receive_item) {
+			for (const auto& item: sender.second) {
+				if (this->remote_neighbors.count(item.first) == 0) {
+					this->remote_neighbors[item.first];
 				}
+			}
+		}
 
-				MPI_Datatype receive_datatype;
-				ret_val = MPI_Type_create_struct(
-					(int) number_of_receives,
-					&counts[0],
-					&displacements[0],
-					&datatypes[0],
-					&receive_datatype
+		this->packed_receives_to_unpack.push_back(neighborhood_id);
+
+		return true;
+	}
+
+	/*!
+	Packs and sends remote neighbor updates of given neighborhood.
+	*/
+	bool start_packed_sends(const int neighborhood_id)
+	{
+		const auto& send_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_send
+			: this->user_neigh_cells_to_send.at(neighborhood_id);
+
+		auto& buffers = this->packed_send_buffers[neighborhood_id];
+		for (const auto& receiver: send_item) {
+			const int receiving_process = receiver.first;
+			if (receiver.second.size() == 0) {
+				continue;
+			}
+
+			int size = 0;
+			for (const auto& item: receiver.second) {
+				size += detail::get_cell_packed_size(
+					this->cell_data.at(item.first),
+					item.first,
+					(int) this->rank,
+					receiving_process,
+					false,
+					neighborhood_id,
+					this->comm
+				);
+			}
+
+			auto& buffer = buffers[receiving_process];
+			buffer.resize(size);
+
+			int position = 0;
+			for (const auto& item: receiver.second) {
+				detail::pack_cell(
+					this->cell_data.at(item.first),
+					item.first,
+					(int) this->rank,
+					receiving_process,
+					neighborhood_id,
+					this->comm,
+					buffer.data(),
+					size,
+					position
 				);
+			}
+
+			this->send_requests[receiving_process].push_back(MPI_Request());
+			const int ret_val = MPI_Isend(
+				buffer.data(),
+				position,
+				MPI_PACKED,
+				receiving_process,
+				0,
+				this->comm,
+				&(this->send_requests[receiving_process].back())
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Isend failed on process " << this->rank
+					<< ", target process " << receiving_process
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
+
+		return true;
+	}
+
+	/*!
+	Receives and unpacks packed remote neighbor updates prepared by
+	start_packed_receives() into copies of remote neighbors.
+
+	Receive buffers are resized to the size of each probed message.
+	*/
+	void unpack_remote_neighbor_data()
+	{
+		for (const int neighborhood_id: this->packed_receives_to_unpack) {
+			const auto& receive_item
+				= neighborhood_id == default_neighborhood_id
+				? this->cells_to_receive
+				: this->user_neigh_cells_to_receive.at(neighborhood_id);
+
+			auto& buffers = this->packed_receive_buffers[neighborhood_id];
+			for (const auto& sender: receive_item) {
+				const int sending_process = sender.first;
+				if (sender.second.size() == 0) {
+					continue;
+				}
+
+				MPI_Status status;
+				int ret_val = MPI_Probe(sending_process, 0, this->comm, &status);
 				if (ret_val != MPI_SUCCESS) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " MPI_Type_create_struct failed for process " << this->rank
+						<< " MPI_Probe failed on process " << this->rank
+						<< ", source process " << sending_process
 						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
 
-				ret_val = MPI_Type_commit(&receive_datatype);
-				if (ret_val != MPI_SUCCESS) {
+				int size = 0;
+				ret_val = MPI_Get_count(&status, MPI_PACKED, &size);
+				if (ret_val != MPI_SUCCESS or size == MPI_UNDEFINED) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " MPI_Type_commit failed for process " << this->rank
+						<< " MPI_Get_count failed on process " << this->rank
+						<< ", source process " << sending_process
 						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
 
-				this->receive_requests[sender->first].push_back(MPI_Request());
+				auto& buffer = buffers[sending_process];
+				buffer.resize(size);
 
-				ret_val = MPI_Irecv(
-					addresses[0],
-					1,
-					receive_datatype,
-					sender->first,
+				ret_val = MPI_Recv(
+					buffer.data(),
+					size,
+					MPI_PACKED,
+					sending_process,
 					0,
 					this->comm,
-					&(this->receive_requests[sender->first].back())
+					MPI_STATUS_IGNORE
 				);
 				if (ret_val != MPI_SUCCESS) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " MPI_Irecv failed for process " << this->rank
-						<< ", source process " << sender->first
+						<< " MPI_Recv failed on process " << this->rank
+						<< ", source process " << sending_process
 						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
 
-				MPI_Type_free(&receive_datatype);
-				for (auto& type: datatypes) {
-					if (!Is_Named_Datatype()(type)) {
-						ret_val = MPI_Type_free(&type);
-						if (ret_val != MPI_SUCCESS) {
-							std::cerr << __FILE__ << ":" << __LINE__
-								<< " MPI_Type_free failed on process " << this->rank
-								<< ", for a derived datatype of user data: "
-								<< Error_String()(ret_val)
-								<< std::endl;
-							abort();
-						}
-					}
+				int position = 0;
+				for (const auto& item: sender.second) {
+					detail::unpack_cell(
+						this->remote_neighbors.at(item.first),
+						item.first,
+						sending_process,
+						(int) this->rank,
+						neighborhood_id,
+						this->comm,
+						buffer.data(),
+						size,
+						position
+					);
+				}
+				if (position != size) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << this->rank
+						<< " unpacked " << position
+						<< " bytes of " << size
+						<< " received from process " << sending_process
+						<< std::endl;
+					abort();
 				}
 			}
 		}
-
-		return true;
+		this->packed_receives_to_unpack.clear();
 	}
 
 
 	/*!
-	Posts MPI_Isends for start_user_data_transfers().
+	Returns the derived datatype of given cells' data relative to MPI_BOTTOM.
+
+	Returned datatype is committed and must be freed by the caller.
 	*/
-	bool start_user_data_sends(
-		const std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>& send_item,
+	template<class Cell_Container> MPI_Datatype get_cells_datatype(
+		Cell_Container& cells,
+		const std::vector<std::pair<uint64_t, int>>& cells_item,
+		const int other_process,
+		const bool receiving,
 		const int neighborhood_id
 	) {
+		std::vector<int> counts(cells_item.size(), -1);
+		std::vector<MPI_Aint> displacements(cells_item.size(), 0);
+		std::vector<MPI_Datatype> datatypes(cells_item.size(), MPI_DATATYPE_NULL);
+
 		int ret_val = -1;
+		for (size_t i = 0; i < cells_item.size(); i++) {
+			const uint64_t cell = cells_item[i].first;
 
-		for (std::unordered_map<int, std::vector<std::pair<uint64_t, int>>>::const_iterator
-			receiver = send_item.begin();
-			receiver != send_item.end();
-			receiver++
-		) {
-			const int receiving_process = receiver->first;
-			const size_t number_of_sends = receiver->second.size();
+			void* address = NULL;
+			std::tie(
+				address,
+				counts[i],
+				datatypes[i]
+			) = detail::get_cell_mpi_datatype(
+				cells.at(cell),
+				cell,
+				receiving ? other_process : (int) this->rank,
+				receiving ? (int) this->rank : other_process,
+				receiving,
+				neighborhood_id
+			);
 
-			#ifdef DEBUG
-			if (receiving_process == (int) this->rank
-			&& number_of_sends > 0) {
+			ret_val = MPI_Get_address(address, &displacements[i]);
+			if (ret_val != MPI_SUCCESS) {
 				std::cerr << __FILE__ << ":" << __LINE__
-					<< " Trying to transfer to self"
+					<< " MPI_Get_address failed on process " << this->rank
+					<< " for cell " << cell
+					<< ": " << Error_String()(ret_val)
 					<< std::endl;
 				abort();
 			}
-			#endif
+		}
 
-			if (this->send_single_cells) {
+		MPI_Datatype cells_datatype;
+		ret_val = MPI_Type_create_struct(
+			(int) cells_item.size(),
+			counts.data(),
+			displacements.data(),
+			datatypes.data(),
+			&cells_datatype
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Type_create_struct failed for process " << this->rank
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
 
-				for (std::vector<std::pair<uint64_t, int>>::const_iterator
-					item = receiver->second.begin();
-					item != receiver->second.end();
-					item++
-				) {
-					const uint64_t cell = item->first;
+		ret_val = MPI_Type_commit(&cells_datatype);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Type_commit failed for process " << this->rank
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
 
-					this->send_requests[receiving_process].push_back(MPI_Request());
+		for (auto& type: datatypes) {
+			if (!Is_Named_Datatype()(type)) {
+				MPI_Type_free(&type);
+			}
+		}
 
-					void* address = NULL;
-					int count = -1;
-					MPI_Datatype user_datatype = MPI_DATATYPE_NULL;
+		return cells_datatype;
+	}
 
-					std::tie(
-						address,
-						count,
-						user_datatype
-					) = detail::get_cell_mpi_datatype(
-						this->cell_data.at(cell),
-						cell,
-						(int) this->rank,
-						receiving_process,
-						false,
-						neighborhood_id
-					);
 
-					const bool is_named_datatype = Is_Named_Datatype()(user_datatype);
+	/*!
+	Creates distributed graph communicators of neighborhoods using neighbor collectives.
 
-					if (!is_named_datatype) {
-						ret_val = MPI_Type_commit(&user_datatype);
-						if (ret_val != MPI_SUCCESS) {
-							std::cerr << __FILE__ << ":" << __LINE__
-								<< " MPI_Type_commit failed on process " << this->rank
-								<< ", for datatype of cell " << cell
-								<< " with returned buffer address " << address
-								<< " and returned count " << count
-								<< ": " << Error_String()(ret_val)
-								<< std::endl;
-							abort();
-						}
-					}
+	Called after cells to send and receive have been recalculated
+	so updates reuse communicators until the next change.
+	Neighborhoods are processed in order of id so all processes
+	create communicators in the same order.
+	*/
+	void create_neighbor_collectives()
+	{
+		std::vector<int> hoods(
+			this->neighbor_collective_hoods.cbegin(),
+			this->neighbor_collective_hoods.cend()
+		);
+		std::sort(hoods.begin(), hoods.end());
+
+		for (const int neighborhood_id: hoods) {
+			if (
+				neighborhood_id == default_neighborhood_id
+				or this->user_hood_of.count(neighborhood_id) > 0
+			) {
+				this->get_neighbor_collective(neighborhood_id);
+			}
+		}
+	}
 
-					ret_val = MPI_Isend(
-						address,
-						count,
-						user_datatype,
-						receiving_process,
-						item->second,
-						this->comm,
-						&(this->send_requests[receiving_process].back())
-					);
 
-					if (ret_val != MPI_SUCCESS) {
-						std::cerr << __FILE__ << ":" << __LINE__
-							<< " MPI_Isend failed on process " << this->rank
-							<< ", for cell " << cell
-							<< ", to process " << receiving_process
-							<< ": " << Error_String()(ret_val)
-							<< std::endl;
-						abort();
-					}
+	/*!
+	Returns the distributed graph communicator of given neighborhood's updates.
 
-					if (!is_named_datatype) {
-						ret_val = MPI_Type_free(&user_datatype);
-						if (ret_val != MPI_SUCCESS) {
-							std::cerr << __FILE__ << ":" << __LINE__
-								<< " MPI_Type_free failed on process " << this->rank
-								<< ", for a derived datatype of cell " << cell
-								<< ": " << Error_String()(ret_val)
-								<< std::endl;
-							abort();
-						}
-					}
-				}
+	Creates the communicator from current cells to send
+	and receive of the neighborhood if it doesn't exist,
+	e.g. if neighbor collectives were enabled after cells
+	to send and receive were recalculated.
+	Collective if communicator doesn't exist.
+	*/
+	Neighbor_Collective& get_neighbor_collective(const int neighborhood_id)
+	{
+		auto item = this->neighbor_collectives.find(neighborhood_id);
+		if (item != this->neighbor_collectives.end()) {
+			return item->second;
+		}
 
-			} else { // if this->send_single_cells
+		const auto& receive_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_receive
+			: this->user_neigh_cells_to_receive.at(neighborhood_id);
+		const auto& send_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_send
+			: this->user_neigh_cells_to_send.at(neighborhood_id);
 
-				// get mpi transfer info from cells
-				std::vector<void*> addresses(number_of_sends, NULL);
-				std::vector<int> counts(number_of_sends, -1);
-				std::vector<MPI_Datatype> datatypes(number_of_sends, MPI_DATATYPE_NULL);
+		auto& collective = this->neighbor_collectives[neighborhood_id];
+		for (const auto& sender: receive_item) {
+			if (sender.second.size() > 0) {
+				collective.sources.push_back(sender.first);
+			}
+		}
+		for (const auto& receiver: send_item) {
+			if (receiver.second.size() > 0) {
+				collective.destinations.push_back(receiver.first);
+			}
+		}
+		std::sort(collective.sources.begin(), collective.sources.end());
+		std::sort(collective.destinations.begin(), collective.destinations.end());
 
-				for (size_t i = 0; i < number_of_sends; i++) {
-					const uint64_t cell = receiver->second[i].first;
+		const int ret_val = MPI_Dist_graph_create_adjacent(
+			this->comm,
+			(int) collective.sources.size(),
+			collective.sources.data(),
+			MPI_UNWEIGHTED,
+			(int) collective.destinations.size(),
+			collective.destinations.data(),
+			MPI_UNWEIGHTED,
+			MPI_INFO_NULL,
+			0,
+			&collective.comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Dist_graph_create_adjacent failed on process " << this->rank
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
 
-					std::tie(
-						addresses[i],
-						counts[i],
-						datatypes[i]
-					) = detail::get_cell_mpi_datatype(
-						this->cell_data.at(cell),
-						cell,
-						(int) this->rank,
-						receiving_process,
-						false,
-						neighborhood_id
-					);
-				}
+		return collective;
+	}
 
-				// get displacements in bytes for outgoing user data
-				std::vector<MPI_Aint> displacements(number_of_sends, 0);
-				for (size_t i = 0; i < number_of_sends; i++) {
-					displacements[i] = (uint8_t*) addresses[i] - (uint8_t*) addresses[0];
-				}
 
-				MPI_Datatype send_datatype;
+	/*!
+	Starts remote neighbor updates of given neighborhood with a neighbor collective.
 
-				ret_val = MPI_Type_create_struct(
-					(int) number_of_sends,
-					&counts[0],
-					&displacements[0],
-					&datatypes[0],
-					&send_datatype
-				);
-				if (ret_val != MPI_SUCCESS) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " MPI_Type_create_struct failed for process " << this->rank
-						<< ": " << Error_String()(ret_val)
-						<< std::endl;
-					abort();
-				}
+	Datatypes of cells are created by the first update after
+	cells to send or receive have changed and are reused if
+	Cell_Data has stable_mpi_datatype, in which case updates
+	use a persistent MPI_Neighbor_alltoallw_init request with
+	MPI >= 4 and MPI_Ineighbor_alltoallw otherwise.
+	*/
+	bool start_neighbor_collective_update(const int neighborhood_id)
+	{
+		if (
+			neighborhood_id != default_neighborhood_id
+			and this->user_hood_of.count(neighborhood_id) == 0
+		) {
+			return false;
+		}
 
-				MPI_Type_commit(&send_datatype);
-				if (ret_val != MPI_SUCCESS) {
-					std::cerr << __FILE__ << ":" << __LINE__
-						<< " MPI_Type_commit failed for process " << this->rank
-						<< ": " << Error_String()(ret_val)
-						<< std::endl;
-					abort();
+		const auto& receive_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_receive
+			: this->user_neigh_cells_to_receive.at(neighborhood_id);
+		const auto& send_item
+			= neighborhood_id == default_neighborhood_id
+			? this->cells_to_send
+			: this->user_neigh_cells_to_send.at(neighborhood_id);
+
+		// adding cells later could move other cells' data
+		bool added_remote_neighbors = false;
+		for (const auto& sender: receive_item) {
+			for (const auto& item: sender.second) {
+				if (this->remote_neighbors.count(item.first) == 0) {
+					this->remote_neighbors[item.first];
+					added_remote_neighbors = true;
 				}
+			}
+		}
+		// which might have moved data of other neighborhoods' updates
+		if (added_remote_neighbors and not Cell_Storage::stable_addresses) {
+			this->free_neighbor_collective_types();
+		}
 
-				this->send_requests[receiver->first].push_back(MPI_Request());
+		auto& collective = this->get_neighbor_collective(neighborhood_id);
+		if (collective.started) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Neighbor collective update of neighborhood " << neighborhood_id
+				<< " already started on process " << this->rank
+				<< std::endl;
+			return false;
+		}
 
-				ret_val = MPI_Isend(
-					addresses[0],
-					1,
-					send_datatype,
-					receiver->first,
-					0,
-					this->comm,
-					&(this->send_requests[receiver->first].back())
+		if (not collective.have_types) {
+			collective.receive_counts.assign(collective.sources.size(), 1);
+			collective.send_counts.assign(collective.destinations.size(), 1);
+			collective.receive_displacements.assign(collective.sources.size(), 0);
+			collective.send_displacements.assign(collective.destinations.size(), 0);
+			collective.receive_types.assign(collective.sources.size(), MPI_DATATYPE_NULL);
+			collective.send_types.assign(collective.destinations.size(), MPI_DATATYPE_NULL);
+
+			for (size_t i = 0; i < collective.sources.size(); i++) {
+				collective.receive_types[i] = this->get_cells_datatype(
+					this->remote_neighbors,
+					receive_item.at(collective.sources[i]),
+					collective.sources[i],
+					true,
+					neighborhood_id
+				);
+			}
+			for (size_t i = 0; i < collective.destinations.size(); i++) {
+				collective.send_types[i] = this->get_cells_datatype(
+					this->cell_data,
+					send_item.at(collective.destinations[i]),
+					collective.destinations[i],
+					false,
+					neighborhood_id
+				);
+			}
+			collective.have_types = true;
+		}
+
+		int ret_val = MPI_SUCCESS;
+		#if MPI_VERSION >= 4
+		if (detail::has_stable_mpi_datatype<Cell_Data>::value) {
+			if (collective.request == MPI_REQUEST_NULL) {
+				ret_val = MPI_Neighbor_alltoallw_init(
+					MPI_BOTTOM,
+					collective.send_counts.data(),
+					collective.send_displacements.data(),
+					collective.send_types.data(),
+					MPI_BOTTOM,
+					collective.receive_counts.data(),
+					collective.receive_displacements.data(),
+					collective.receive_types.data(),
+					collective.comm,
+					MPI_INFO_NULL,
+					&collective.request
 				);
 				if (ret_val != MPI_SUCCESS) {
 					std::cerr << __FILE__ << ":" << __LINE__
-						<< " MPI_Isend failed from process " << this->rank
-						<< ", target process " << receiver->first
+						<< " MPI_Neighbor_alltoallw_init failed on process " << this->rank
 						<< ": " << Error_String()(ret_val)
 						<< std::endl;
 					abort();
 				}
-
-				MPI_Type_free(&send_datatype);
-				for (auto& type: datatypes) {
-					if (!Is_Named_Datatype()(type)) {
-						ret_val = MPI_Type_free(&type);
-						if (ret_val != MPI_SUCCESS) {
-							std::cerr << __FILE__ << ":" << __LINE__
-								<< " MPI_Type_free failed on process " << this->rank
-								<< ", for a derived datatype of user data: "
-								<< Error_String()(ret_val)
-								<< std::endl;
-							abort();
-						}
-					}
-				}
 			}
+			ret_val = MPI_Start(&collective.request);
+		} else
+		#endif
+		ret_val = MPI_Ineighbor_alltoallw(
+			MPI_BOTTOM,
+			collective.send_counts.data(),
+			collective.send_displacements.data(),
+			collective.send_types.data(),
+			MPI_BOTTOM,
+			collective.receive_counts.data(),
+			collective.receive_displacements.data(),
+			collective.receive_types.data(),
+			collective.comm,
+			&collective.request
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't start neighbor collective update on process " << this->rank
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
 		}
 
+		collective.started = true;
+		this->neighbor_collective_updates.push_back(neighborhood_id);
+
 		return true;
 	}
 
 
 	/*!
-	Waits for the receives of user data transfers between processes to complete.
+	Waits for neighbor collective remote neighbor updates to complete.
 
-	User data arriving to this process is saved in given destination.
+	Frees datatypes of updates unless Cell_Data has stable_mpi_datatype.
 	*/
-	bool wait_user_data_transfer_receives()
+	bool wait_neighbor_collective_updates()
 	{
 		bool success = true;
-		int ret_val = -1;
-
-		for (std::unordered_map<int, std::vector<MPI_Request>>::iterator
-			process = this->receive_requests.begin();
-			process != this->receive_requests.end();
-			process++
-		) {
-			std::vector<MPI_Status> statuses;
-			statuses.resize(process->second.size());
 
-			ret_val = MPI_Waitall(process->second.size(), &(process->second[0]), &(statuses[0]));
+		for (const int neighborhood_id: this->neighbor_collective_updates) {
+			auto& collective = this->neighbor_collectives.at(neighborhood_id);
+			const int ret_val = MPI_Wait(&collective.request, MPI_STATUS_IGNORE);
 			if (ret_val != MPI_SUCCESS) {
-				for (const auto& status: statuses) {
-					if (status.MPI_ERROR != MPI_SUCCESS) {
-						success = false;
-						std::cerr << __FILE__ << ":" << __LINE__
-							<< " MPI receive failed from process " << status.MPI_SOURCE
-							<< " with tag " << status.MPI_TAG
-							<< std::endl;
-					}
-				}
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Neighbor collective update failed on process " << this->rank
+					<< ": " << Error_String()(ret_val)
+					<< std::endl;
+				success = false;
 			}
-		}
+			collective.started = false;
 
-		this->receive_requests.clear();
+			if (not detail::has_stable_mpi_datatype<Cell_Data>::value) {
+				this->free_neighbor_collective_types(collective);
+			}
+		}
+		this->neighbor_collective_updates.clear();
 
 		return success;
 	}
 
 
 	/*!
-	Waits for the sends of user data transfers between processes to complete.
+	Frees datatypes and persistent request of given neighbor collective.
 	*/
-	bool wait_user_data_transfer_sends()
+	void free_neighbor_collective_types(Neighbor_Collective& collective)
 	{
-		for (std::unordered_map<int, std::vector<MPI_Request>>::iterator
-			process = this->send_requests.begin();
-			process != this->send_requests.end();
-			process++
-		) {
-			std::vector<MPI_Status> statuses;
-			statuses.resize(process->second.size());
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (not finalized) {
+			if (collective.request != MPI_REQUEST_NULL) {
+				MPI_Request_free(&collective.request);
+			}
+			for (auto* types: {&collective.receive_types, &collective.send_types}) {
+				for (auto& type: *types) {
+					MPI_Type_free(&type);
+				}
+			}
+		}
+		collective.request = MPI_REQUEST_NULL;
+		collective.receive_types.clear();
+		collective.send_types.clear();
+		collective.have_types = false;
+	}
 
-			if (
-				MPI_Waitall(process->second.size(), &(process->second[0]), &(statuses[0]))
-				!= MPI_SUCCESS
-			) {
-				for (const auto& status: statuses) {
-					if (status.MPI_ERROR != MPI_SUCCESS) {
-						std::cerr << __FILE__ << ":" << __LINE__
-							<< " MPI receive failed from process " << status.MPI_SOURCE
-							<< " with tag " << status.MPI_TAG
-							<< std::endl;
-						abort();
+	/*!
+	Frees datatypes of all neighbor collectives, e.g. after cell data moved.
+	*/
+	void free_neighbor_collective_types()
+	{
+		for (auto& item: this->neighbor_collectives) {
+			this->free_neighbor_collective_types(item.second);
+		}
+	}
+
+
+	/*!
+	Frees distributed graph communicator of given neighborhood's updates.
+
+	Frees those of all neighborhoods by default.
+	*/
+	void free_neighbor_collective_comms(const int neighborhood_id)
+	{
+		auto item = this->neighbor_collectives.find(neighborhood_id);
+		if (item == this->neighbor_collectives.end()) {
+			return;
+		}
+
+		this->free_neighbor_collective_types(item->second);
+
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (not finalized and item->second.comm != MPI_COMM_NULL) {
+			MPI_Comm_free(&item->second.comm);
+		}
+
+		this->neighbor_collectives.erase(item);
+	}
+
+	void free_neighbor_collective_comms()
+	{
+		while (this->neighbor_collectives.size() > 0) {
+			this->free_neighbor_collective_comms(this->neighbor_collectives.begin()->first);
+		}
+	}
+
+
+	#ifdef DEBUG
+	/*!
+	Aborts if MPI transfer info of cells differs from given info.
+	*/
+	void verify_persistent_transfer_info(
+		const std::vector<std::tuple<uint64_t, int, void*, int>>& transfer_info,
+		const bool receiving,
+		const int neighborhood_id
+	) {
+		auto& cells = receiving ? this->remote_neighbors : this->cell_data;
+		for (const auto& item: transfer_info) {
+			const uint64_t cell = std::get<0>(item);
+			const int other_process = std::get<1>(item);
+
+			void* address = NULL;
+			int count = -1;
+			MPI_Datatype datatype = MPI_DATATYPE_NULL;
+			std::tie(address, count, datatype) = detail::get_cell_mpi_datatype(
+				cells.at(cell),
+				cell,
+				receiving ? other_process : (int) this->rank,
+				receiving ? (int) this->rank : other_process,
+				receiving,
+				neighborhood_id
+			);
+			if (!Is_Named_Datatype()(datatype)) {
+				MPI_Type_free(&datatype);
+			}
+
+			if (address != std::get<2>(item) or count != std::get<3>(item)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI transfer info of cell " << cell
+					<< " changed after creating persistent requests"
+					<< ", is Cell_Data::stable_mpi_datatype correct?"
+					<< std::endl;
+				abort();
+			}
+		}
+	}
+	#endif
+
+
+	/*!
+	Frees persistent requests and datatypes of remote neighbor updates.
+
+	Frees those of all neighborhoods by default.
+	Requests must not be active.
+	*/
+	void free_persistent_transfers(const int neighborhood_id)
+	{
+		auto item = this->persistent_transfers.find(neighborhood_id);
+		if (item == this->persistent_transfers.end()) {
+			return;
+		}
+
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (not finalized) {
+			for (auto* requests: {&item->second.receives, &item->second.sends}) {
+				for (auto& process_item: *requests) {
+					for (auto& request: process_item.second) {
+						MPI_Request_free(&request);
 					}
 				}
 			}
+			for (auto& datatype: item->second.datatypes) {
+				MPI_Type_free(&datatype);
+			}
 		}
 
-		this->send_requests.clear();
+		this->persistent_transfers.erase(item);
+	}
 
-		return true;
+	void free_persistent_transfers()
+	{
+		while (this->persistent_transfers.size() > 0) {
+			this->free_persistent_transfers(this->persistent_transfers.begin()->first);
+		}
 	}
 
 public:
@@ -10717,17 +18392,79 @@ public:
 	}
 
 private:
+	/*!
+	Returns true if cell a comes before cell b on a Morton curve.
+
+	Cells are compared by the indices of their first corner,
+	a cell comes before its children and ties are
+	ordered by id.
+	*/
+	bool is_before_on_morton_curve(const uint64_t a, const uint64_t b) const
+	{
+		const auto
+			indices_a = this->mapping.get_indices(a),
+			indices_b = this->mapping.get_indices(b);
+
+		// find dimension with most significant differing bit
+		size_t dimension = 0;
+		uint64_t most_significant = 0;
+		for (size_t i = 0; i < indices_a.size(); i++) {
+			const uint64_t difference = indices_a[i] ^ indices_b[i];
+			if (
+				most_significant < difference
+				and most_significant < (most_significant ^ difference)
+			) {
+				dimension = i;
+				most_significant = difference;
+			}
+		}
+
+		if (indices_a[dimension] != indices_b[dimension]) {
+			return indices_a[dimension] < indices_b[dimension];
+		}
+
+		const int
+			ref_lvl_a = this->mapping.get_refinement_level(a),
+			ref_lvl_b = this->mapping.get_refinement_level(b);
+		if (ref_lvl_a != ref_lvl_b) {
+			return ref_lvl_a < ref_lvl_b;
+		}
+
+		return a < b;
+	}
+
+
 	/*!
 	Updates this->cells_rw and this->neighbors_rw.
+
+	Also restores the order of cell data with contiguous storage.
+
+	With incremental iterator updates neighbors are recalculated
+	only for cells_with_changed_neighbors and items of other cells
+	are reused, if cells stay in the same order and the number of
+	their neighbors doesn't change items are updated in place.
+	User update functions are called for new items and for
+	reused items whose data pointer changed.
 	*/
 	void update_cell_pointers()
 	{
-		this->cells_rw.clear();
-		this->neighbors_rw.clear();
+		// local cells are first in cells in any order
+		if (this->automatic_cell_weights) {
+			this->collect_cell_times();
+			this->cell_time_slots.reset(this->cell_data.size());
+		}
 
-		this->cells_rw.reserve(this->cell_data.size());
-		// at least this much should be needed
-		this->neighbors_rw.reserve(2 * this->cell_data.size());
+		const auto is_before = [this](const uint64_t a, const uint64_t b) {
+			return this->is_before_on_morton_curve(a, b);
+		};
+		Cell_Storage::sort(this->cell_data, is_before);
+		Cell_Storage::sort(this->remote_neighbors, is_before);
+
+		// cell data might have moved
+		if (not Cell_Storage::stable_addresses) {
+			this->free_persistent_transfers();
+			this->free_neighbor_collective_types();
+		}
 
 		size_t nr_inner = 0, nr_outer = 0, nr_remote = 0;
 
@@ -10751,6 +18488,42 @@ private:
 			nr_outer++;
 		}
 
+		const bool reuse_items
+			= this->incremental_iterator_updates
+			and not this->all_neighbors_changed;
+		this->all_neighbors_changed = false;
+
+		if (
+			reuse_items
+			and this->update_cell_pointers_in_place(ordered_cells)
+		) {
+			this->cells_with_changed_neighbors.clear();
+			return;
+		}
+
+		// items of previous update, iterators to them stay valid after swap
+		std::vector<Cells_Item> old_cells;
+		std::vector<Neighbors_Item> old_neighbors;
+		std::unordered_map<uint64_t, size_t> old_cell_indices;
+		if (reuse_items) {
+			old_cells.swap(this->cells_rw);
+			old_neighbors.swap(this->neighbors_rw);
+			old_cell_indices.reserve(old_cells.size());
+			for (size_t i = 0; i < old_cells.size(); i++) {
+				if (this->cells_with_changed_neighbors.count(old_cells[i].id) == 0) {
+					old_cell_indices[old_cells[i].id] = i;
+				}
+			}
+		}
+		this->cells_with_changed_neighbors.clear();
+
+		this->cells_rw.clear();
+		this->neighbors_rw.clear();
+
+		this->cells_rw.reserve(this->cell_data.size());
+		// at least this much should be needed
+		this->neighbors_rw.reserve(std::max(old_neighbors.size(), 2 * this->cell_data.size()));
+
 		/*
 		Cannot store iterators to neighbors_rw vector while
 		adding items, fill out iterators from this after
@@ -10771,167 +18544,64 @@ private:
 				std::cerr << __FILE__ "(" << __LINE__ << ")" << std::endl;
 				abort();
 			}
-
-			Cells_Item new_cells_item{};
-			new_cells_item.id = cell;
 			if (this->cell_data.count(cell) == 0) {
 				std::cerr << __FILE__ "(" << __LINE__ << ")" << std::endl;
 				abort();
 			}
-			new_cells_item.data = this->operator[](cell);
-			// call user-defined update function(s)
-			new_cells_item.update_caller(*this, new_cells_item, Additional_Cell_Items()...);
-			this->cells_rw.push_back(std::move(new_cells_item));
 
-			/*
-			Prepare data for creating cell's neighbor iterators
-			*/
-			const auto
-				*neighbors_of = this->get_neighbors_of(cell),
-				*neighbors_to = this->get_neighbors_to(cell);
-			if (neighbors_of == nullptr) {
-				throw std::runtime_error("No neighbors of list.");
-			}
-			if (neighbors_to == nullptr) {
-				throw std::runtime_error("No neighbors to list.");
-			}
-			#ifdef DEBUG
-			for (const auto& neighbor: *neighbors_of) {
-				if (neighbor.first == error_cell) {
-					continue;
-				}
-				if (
-					neighbor.second[0] == 0
-					and neighbor.second[1] == 0
-					and neighbor.second[2] == 0
-				) {
-					std::cerr << __FILE__ "(" << __LINE__ << "): "
-						<< "Invalid offset for neighbor " << neighbor.first
-						<< " of cell " << cell << std::endl;
-					abort();
-				}
-			}
-			#endif
+			const auto old_index = old_cell_indices.find(cell);
+			if (old_index != old_cell_indices.end()) {
+				const Cells_Item& old_cell = old_cells[old_index->second];
+				#ifdef DEBUG
+				this->verify_neighbor_items(old_cell);
+				#endif
+				nr_neighbors[i][1] = size_t(old_cell.neighbors_to.begin_ - old_cell.neighbors_of.begin_);
+				nr_neighbors[i][2] = size_t(old_cell.neighbors_of.end_ - old_cell.neighbors_to.begin_);
+				nr_neighbors[i][3] = size_t(old_cell.neighbors_to.end_ - old_cell.neighbors_of.end_);
+
+				const auto
+					first = old_neighbors.begin() + (old_cell.neighbors_of.begin_ - old_neighbors.cbegin()),
+					last = old_neighbors.begin() + (old_cell.neighbors_to.end_ - old_neighbors.cbegin());
 
-			std::set<uint64_t> ids_of, ids_to;
-			for (const auto& n: *neighbors_of) {
-				if (n.first != error_cell) {
-					ids_of.insert(n.first);
+				this->cells_rw.push_back(std::move(old_cells[old_index->second]));
+				const bool cell_moved = this->update_data_pointer(this->cells_rw.back());
+				if (cell_moved) {
+					this->cells_rw.back().update_caller(*this, this->cells_rw.back(), Additional_Cell_Items()...);
 				}
-			}
-			for (const auto& n: *neighbors_to) {
-				if (n.first != error_cell) {
-					ids_to.insert(n.first);
+				for (auto neighbor = first; neighbor != last; neighbor++) {
+					this->neighbors_rw.push_back(std::move(*neighbor));
+					auto& item = this->neighbors_rw.back();
+					if (this->update_data_pointer(item) or cell_moved) {
+						item.update_caller(*this, this->cells_rw.back(), item, Additional_Neighbor_Items()...);
+					}
 				}
+				continue;
 			}
-			ids_of.erase(error_cell);
-			ids_to.erase(error_cell);
-
-			std::set<uint64_t> only_neighbors_of, only_neighbors_to, neighbors_both;
-
-			std::set_difference(
-				ids_of.cbegin(), ids_of.cend(),
-				ids_to.cbegin(), ids_to.cend(),
-				std::inserter(only_neighbors_of, only_neighbors_of.begin())
-			);
-			nr_neighbors[i][1] = only_neighbors_of.size();
-
-			std::set_intersection(
-				ids_of.cbegin(), ids_of.cend(),
-				ids_to.cbegin(), ids_to.cend(),
-				std::inserter(neighbors_both, neighbors_both.begin())
-			);
-			nr_neighbors[i][2] = neighbors_both.size();
 
-			std::set_difference(
-				ids_to.cbegin(), ids_to.cend(),
-				ids_of.cbegin(), ids_of.cend(),
-				std::inserter(only_neighbors_to, only_neighbors_to.begin())
-			);
-			nr_neighbors[i][3] = only_neighbors_to.size();
+			Cells_Item new_cells_item{};
+			new_cells_item.id = cell;
+			new_cells_item.data = this->operator[](cell);
+			// call user-defined update function(s)
+			new_cells_item.update_caller(*this, new_cells_item, Additional_Cell_Items()...);
+			this->cells_rw.push_back(std::move(new_cells_item));
 
-			// add cell's neighbors
-			std::map<uint64_t, std::array<int, 4>> all_neighbors;
-			for (const auto& n: *neighbors_of) {
-				if (n.first == error_cell) {
-					continue;
-				}
-				if (all_neighbors.count(n.first) > 0) {
-					continue;
-				}
-				all_neighbors[n.first] = n.second;
-			}
-			for (const auto& n: *neighbors_to) {
-				if (n.first == error_cell) {
-					continue;
-				}
-				if (all_neighbors.count(n.first) > 0) {
-					continue;
-				}
-				all_neighbors[n.first] = n.second;
-			}
+			// neighbors of cell in the order of neighbors_rw
+			const auto items = this->get_neighbor_items(cell);
+			nr_neighbors[i][1] = items.only_of;
+			nr_neighbors[i][2] = items.both;
+			nr_neighbors[i][3] = items.neighbors.size() - items.only_of - items.both;
 
-			for (const auto& neighbor_id: only_neighbors_of) {
-				const auto& offsets = all_neighbors.at(neighbor_id);
+			for (const auto& neighbor: items.neighbors) {
 				Neighbors_Item item{};
-				item.id = neighbor_id;
+				item.id = neighbor.first;
 				item.data = this->operator[](item.id);
-				item.x = offsets[0];
-				item.y = offsets[1];
-				item.z = offsets[2];
-				item.denom = offsets[3];
+				item.x = neighbor.second[0];
+				item.y = neighbor.second[1];
+				item.z = neighbor.second[2];
+				item.denom = neighbor.second[3];
 				// call user-defined update function(s)
 				item.update_caller(*this, this->cells_rw.back(), item, Additional_Neighbor_Items()...);
 				this->neighbors_rw.push_back(std::move(item));
-				#ifdef DEBUG
-				if (
-					this->neighbors_rw[this->neighbors_rw.size() - 1].x == 0
-					and this->neighbors_rw[this->neighbors_rw.size() - 1].y == 0
-					and this->neighbors_rw[this->neighbors_rw.size() - 1].z == 0
-				) {
-					std::cerr << __FILE__ "(" << __LINE__ << "): "
-						<< "Invalid offset saved for neighbor " << item.id
-						<< " of cell " << cell << std::endl;
-					abort();
-				}
-				#endif
-			}
-			for (const auto& neighbor_id: neighbors_both) {
-				const auto& offsets = all_neighbors.at(neighbor_id);
-				Neighbors_Item item{};
-				item.id = neighbor_id;
-				item.data = this->operator[](item.id);
-				item.x = offsets[0];
-				item.y = offsets[1];
-				item.z = offsets[2];
-				item.denom = offsets[3];
-				item.update_caller(*this, this->cells_rw.back(), item, Additional_Neighbor_Items()...);
-				this->neighbors_rw.push_back(std::move(item));
-				#ifdef DEBUG
-				if (
-					this->neighbors_rw[this->neighbors_rw.size() - 1].x == 0
-					and this->neighbors_rw[this->neighbors_rw.size() - 1].y == 0
-					and this->neighbors_rw[this->neighbors_rw.size() - 1].z == 0
-				) {
-					std::cerr << __FILE__ "(" << __LINE__ << "): "
-						<< "Invalid offset saved for neighbor " << item.id
-						<< " of cell " << cell << ": " << item.x
-						<< ", " << item.y << ", " << item.z << std::endl;
-					abort();
-				}
-				#endif
-			}
-			for (const auto& neighbor_id: only_neighbors_to) {
-				const auto& offsets = all_neighbors.at(neighbor_id);
-				Neighbors_Item item{};
-				item.id = neighbor_id;
-				item.data = this->operator[](item.id);
-				item.x = offsets[0];
-				item.y = offsets[1];
-				item.z = offsets[2];
-				item.denom = offsets[3];
-				item.update_caller(*this, this->cells_rw.back(), item, Additional_Neighbor_Items()...);
-				this->neighbors_rw.push_back(std::move(item));
 			}
 		}
 
@@ -10979,6 +18649,252 @@ private:
 	}
 
 
+	/*!
+	Updates items of cells_with_changed_neighbors in cells_rw and neighbors_rw.
+
+	Returns false without changing anything if given cells aren't
+	in the same order as in cells_rw or if the number of neighbors
+	of a changed cell differs from its number of neighbor items.
+	*/
+	bool update_cell_pointers_in_place(const std::vector<uint64_t>& ordered_cells)
+	{
+		if (ordered_cells.size() != this->cells_rw.size()) {
+			return false;
+		}
+
+		std::vector<std::pair<size_t, Neighbor_Items>> changed;
+		for (size_t i = 0; i < ordered_cells.size(); i++) {
+			if (ordered_cells[i] != this->cells_rw[i].id) {
+				return false;
+			}
+			if (
+				this->cells_with_changed_neighbors.size() == 0
+				or this->cells_with_changed_neighbors.count(ordered_cells[i]) == 0
+			) {
+				continue;
+			}
+
+			const auto& cell = this->cells_rw[i];
+			auto items = this->get_neighbor_items(cell.id);
+			if (
+				items.only_of != size_t(cell.neighbors_to.begin_ - cell.neighbors_of.begin_)
+				or items.both != size_t(cell.neighbors_of.end_ - cell.neighbors_to.begin_)
+				or items.neighbors.size() != size_t(cell.neighbors_to.end_ - cell.neighbors_of.begin_)
+			) {
+				return false;
+			}
+			changed.emplace_back(i, std::move(items));
+		}
+
+		auto changed_item = changed.cbegin();
+		for (size_t i = 0; i < this->cells_rw.size(); i++) {
+			auto& cell = this->cells_rw[i];
+			const bool new_neighbors
+				= changed_item != changed.cend()
+				and changed_item->first == i;
+
+			bool cell_moved = this->update_data_pointer(cell);
+			if (cell_moved or new_neighbors) {
+				cell.update_caller(*this, cell, Additional_Cell_Items()...);
+				cell_moved = true;
+			}
+
+			auto neighbor = this->neighbors_rw.begin() + (cell.neighbors_of.begin_ - this->neighbors.cbegin());
+			const auto end = this->neighbors_rw.begin() + (cell.neighbors_to.end_ - this->neighbors.cbegin());
+			if (new_neighbors) {
+				for (const auto& new_neighbor: changed_item->second.neighbors) {
+					Neighbors_Item item{};
+					item.id = new_neighbor.first;
+					item.data = this->operator[](item.id);
+					item.x = new_neighbor.second[0];
+					item.y = new_neighbor.second[1];
+					item.z = new_neighbor.second[2];
+					item.denom = new_neighbor.second[3];
+					item.update_caller(*this, cell, item, Additional_Neighbor_Items()...);
+					*neighbor = std::move(item);
+					neighbor++;
+				}
+				changed_item++;
+				continue;
+			}
+
+			#ifdef DEBUG
+			this->verify_neighbor_items(cell);
+			#endif
+			for ( ; neighbor != end; neighbor++) {
+				if (this->update_data_pointer(*neighbor) or cell_moved) {
+					neighbor->update_caller(*this, cell, *neighbor, Additional_Neighbor_Items()...);
+				}
+			}
+		}
+
+		return true;
+	}
+
+
+	/*!
+	Sets data pointer of given cells or neighbors item from its id.
+
+	Returns true if the pointer changed.
+	*/
+	template<class Item> bool update_data_pointer(Item& item)
+	{
+		Cell_Data* const data = this->operator[](item.id);
+		if (data == item.data) {
+			return false;
+		}
+		item.data = data;
+		return true;
+	}
+
+
+	#ifdef DEBUG
+	/*!
+	Aborts if neighbor items of given cell differ from its current neighbors.
+	*/
+	void verify_neighbor_items(const Cells_Item& cell) const
+	{
+		const auto rebuilt = this->get_neighbor_items(cell.id);
+		bool same
+			= rebuilt.only_of == size_t(cell.neighbors_to.begin_ - cell.neighbors_of.begin_)
+			and rebuilt.both == size_t(cell.neighbors_of.end_ - cell.neighbors_to.begin_)
+			and rebuilt.neighbors.size() == size_t(cell.neighbors_to.end_ - cell.neighbors_of.begin_);
+		auto neighbor = cell.neighbors_of.begin_;
+		for (size_t i = 0; same and i < rebuilt.neighbors.size(); i++, neighbor++) {
+			same
+				= neighbor->id == rebuilt.neighbors[i].first
+				and neighbor->x == rebuilt.neighbors[i].second[0]
+				and neighbor->y == rebuilt.neighbors[i].second[1]
+				and neighbor->z == rebuilt.neighbors[i].second[2]
+				and neighbor->denom == rebuilt.neighbors[i].second[3];
+		}
+		if (not same) {
+			std::cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Previous neighbors of cell " << cell.id
+				<< " differ from current neighbors"
+				<< std::endl;
+			abort();
+		}
+	}
+	#endif
+
+
+	/*!
+	Returns neighbors of given local cell in the order used by neighbors_rw.
+
+	Neighbors only in cell's neighbors_of list come first followed
+	by neighbors in both neighbors_of and neighbors_to and last
+	neighbors only in neighbors_to, each sorted by id. Offset of
+	a neighbor in both lists is taken from neighbors_of.
+	*/
+	Neighbor_Items get_neighbor_items(const uint64_t cell) const
+	{
+		const auto
+			*neighbors_of = this->get_neighbors_of(cell),
+			*neighbors_to = this->get_neighbors_to(cell);
+		if (neighbors_of == nullptr) {
+			throw std::runtime_error("No neighbors of list.");
+		}
+		if (neighbors_to == nullptr) {
+			throw std::runtime_error("No neighbors to list.");
+		}
+		#ifdef DEBUG
+		for (const auto& neighbor: *neighbors_of) {
+			if (neighbor.first == error_cell) {
+				continue;
+			}
+			if (
+				neighbor.second[0] == 0
+				and neighbor.second[1] == 0
+				and neighbor.second[2] == 0
+			) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): "
+					<< "Invalid offset for neighbor " << neighbor.first
+					<< " of cell " << cell << std::endl;
+				abort();
+			}
+		}
+		#endif
+
+		std::set<uint64_t> ids_of, ids_to;
+		for (const auto& n: *neighbors_of) {
+			if (n.first != error_cell) {
+				ids_of.insert(n.first);
+			}
+		}
+		for (const auto& n: *neighbors_to) {
+			if (n.first != error_cell) {
+				ids_to.insert(n.first);
+			}
+		}
+
+		std::vector<uint64_t> only_neighbors_of, only_neighbors_to, neighbors_both;
+
+		std::set_difference(
+			ids_of.cbegin(), ids_of.cend(),
+			ids_to.cbegin(), ids_to.cend(),
+			std::back_inserter(only_neighbors_of)
+		);
+		std::set_intersection(
+			ids_of.cbegin(), ids_of.cend(),
+			ids_to.cbegin(), ids_to.cend(),
+			std::back_inserter(neighbors_both)
+		);
+		std::set_difference(
+			ids_to.cbegin(), ids_to.cend(),
+			ids_of.cbegin(), ids_of.cend(),
+			std::back_inserter(only_neighbors_to)
+		);
+
+		// offsets of cell's neighbors
+		std::map<uint64_t, std::array<int, 4>> all_neighbors;
+		for (const auto& n: *neighbors_of) {
+			if (n.first == error_cell) {
+				continue;
+			}
+			if (all_neighbors.count(n.first) > 0) {
+				continue;
+			}
+			all_neighbors[n.first] = n.second;
+		}
+		for (const auto& n: *neighbors_to) {
+			if (n.first == error_cell) {
+				continue;
+			}
+			if (all_neighbors.count(n.first) > 0) {
+				continue;
+			}
+			all_neighbors[n.first] = n.second;
+		}
+
+		Neighbor_Items items;
+		items.only_of = only_neighbors_of.size();
+		items.both = neighbors_both.size();
+		items.neighbors.reserve(all_neighbors.size());
+		for (const auto* ids: {&only_neighbors_of, &neighbors_both, &only_neighbors_to}) {
+			for (const uint64_t neighbor_id: *ids) {
+				items.neighbors.push_back(
+					std::make_pair(neighbor_id, all_neighbors.at(neighbor_id))
+				);
+			}
+		}
+
+		#ifdef DEBUG
+		for (size_t i = 0; i < items.only_of + items.both; i++) {
+			const auto& offsets = items.neighbors[i].second;
+			if (offsets[0] == 0 and offsets[1] == 0 and offsets[2] == 0) {
+				std::cerr << __FILE__ "(" << __LINE__ << "): "
+					<< "Invalid offset saved for neighbor " << items.neighbors[i].first
+					<< " of cell " << cell << std::endl;
+				abort();
+			}
+		}
+		#endif
+
+		return items;
+	}
+
+
 	/*!
 	Returns the number of values needed to represent the coordinate of a cell
 	*/
@@ -11007,13 +18923,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11047,13 +18965,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11078,13 +18998,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11101,12 +19023,9 @@ private:
 
 			global_ids[i] = item.first;
 
-			if (number_of_weights_per_object > 0) {
-				if (dccrg_instance->cell_weights.count(item.first) > 0) {
-					object_weights[i] = float(dccrg_instance->cell_weights.at(item.first));
-				} else {
-					object_weights[i] = 1;
-				}
+			for (int j = 0; j < number_of_weights_per_object; j++) {
+				object_weights[i * number_of_weights_per_object + j]
+					= float(dccrg_instance->get_balancing_weight(item.first, uint64_t(j)));
 			}
 
 			i++;
@@ -11131,13 +19050,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11186,13 +19107,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11250,13 +19173,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11300,13 +19225,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11371,13 +19298,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11405,13 +19334,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11460,13 +19391,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 		*error = ZOLTAN_OK;
@@ -11483,13 +19416,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 
@@ -11536,13 +19471,15 @@ private:
 			Cell_Data,
 			Geometry,
 			std::tuple<Additional_Cell_Items...>,
-			std::tuple<Additional_Neighbor_Items...>
+			std::tuple<Additional_Neighbor_Items...>,
+			Cell_Storage
 		>* dccrg_instance = reinterpret_cast<
 			Dccrg<
 				Cell_Data,
 				Geometry,
 				std::tuple<Additional_Cell_Items...>,
-				std::tuple<Additional_Neighbor_Items...>
+				std::tuple<Additional_Neighbor_Items...>,
+				Cell_Storage
 			>*
 		>(data);
 
@@ -11573,9 +19510,49 @@ private:
 	#ifdef DEBUG
 	/*!
 	Returns false if the same cells don't exist on the same process for all processes.
+
+	With distributed ownership processes know different cells
+	so instead returns false if the cell directory doesn't
+	have this process as the owner of every local cell
+	without children, except cells being moved away.
 	*/
 	bool is_consistent()
 	{
+		if (this->distributed_ownership) {
+			std::vector<uint64_t> local_cells;
+			local_cells.reserve(this->cell_data.size());
+			for (const auto& item: this->cell_data) {
+				if (
+					item.first == this->get_child(item.first)
+					and this->removed_cells.count(item.first) == 0
+				) {
+					local_cells.push_back(item.first);
+				}
+			}
+			std::sort(local_cells.begin(), local_cells.end());
+
+			bool consistent = true;
+			const auto owners = this->cell_directory.get_process(local_cells, this->comm);
+			for (size_t i = 0; i < local_cells.size(); i++) {
+				if (
+					owners[i] != this->rank
+					or this->cell_process.count(local_cells[i]) == 0
+					or this->cell_process.at(local_cells[i]) != this->rank
+				) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Local cell " << local_cells[i]
+						<< " of process " << this->rank
+						<< " has owner " << owners[i]
+						<< " in cell directory"
+						<< std::endl;
+					consistent = false;
+					break;
+				}
+			}
+
+			return All_Reduce()(consistent ? 0 : 1, this->comm) == 0;
+		}
+
 		// sort existing cells from this process
 		std::vector<uint64_t> local_cells;
 		local_cells.reserve(this->cell_process.size());
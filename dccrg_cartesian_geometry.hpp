@@ -25,15 +25,20 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "cassert"
 #include "cmath"
 #include "cstdlib"
+#include "cstring"
 #include "iostream"
 #include "limits"
+#ifndef DCCRG_NO_MPI
 #include "mpi.h"
+#endif
 #include "stdint.h"
 #include "vector"
 
 #include "dccrg_length.hpp"
 #include "dccrg_mapping.hpp"
+#ifndef DCCRG_NO_MPI
 #include "dccrg_mpi_support.hpp"
+#endif
 #include "dccrg_topology.hpp"
 #include "dccrg_types.hpp"
 
@@ -607,6 +612,7 @@ public:
 	}
 
 
+	#ifndef DCCRG_NO_MPI
 	/*!
 	Writes the geometry into given open file starting at given offset.
 
@@ -749,6 +755,49 @@ public:
 
 		return true;
 	}
+	#endif
+
+
+	/*!
+	Reads the geometry from given data in memory.
+
+	Given data must be in the format written by write(),
+	given size is the number of bytes available in data.
+	Returns true on success, false otherwise.
+	*/
+	bool read(const uint8_t* const data, const size_t size)
+	{
+		if (size < this->data_size()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Not enough data for geometry: " << size
+				<< std::endl;
+			return false;
+		}
+
+		int read_geometry_id = Cartesian_Geometry::geometry_id + 1;
+		std::memcpy(&read_geometry_id, data, sizeof(int));
+		if (read_geometry_id != Cartesian_Geometry::geometry_id) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong geometry: " << read_geometry_id
+				<< ", should be " << Cartesian_Geometry::geometry_id
+				<< std::endl;
+			return false;
+		}
+
+		Parameters read_parameters;
+		std::memcpy(read_parameters.start.data(), data + sizeof(int), 3 * sizeof(double));
+		std::memcpy(
+			read_parameters.level_0_cell_length.data(),
+			data + sizeof(int) + 3 * sizeof(double),
+			3 * sizeof(double)
+		);
+
+		if (!this->set(read_parameters)) {
+			return false;
+		}
+
+		return true;
+	}
 
 
 	/*!
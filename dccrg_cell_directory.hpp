@@ -0,0 +1,230 @@
+/*
+Distributed directory of cell owners for dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DCCRG_CELL_DIRECTORY_HPP
+#define DCCRG_CELL_DIRECTORY_HPP
+
+
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "limits"
+#include "unordered_map"
+#include "utility"
+#include "vector"
+
+#include "mpi.h"
+
+#include "dccrg_mpi_support.hpp"
+
+
+namespace dccrg {
+
+/*!
+\brief Distributed mapping of cells to the processes that own them.
+
+Every cell has a home process given by get_home_process()
+and only the home process stores the owner of that cell.
+With N cells and P processes each process therefore stores
+about N / P owners instead of N.
+
+All functions that take a communicator are collective
+and must be called by all processes in that communicator.
+Lookups and updates are batched into a few all-to-all
+exchanges regardless of the number of cells involved.
+*/
+class Cell_Directory
+{
+
+public:
+
+	/*!
+	Returned by get_process() for cells that don't exist in the directory.
+	*/
+	static uint64_t error_process()
+	{
+		return std::numeric_limits<uint64_t>::max();
+	}
+
+
+	/*!
+	Returns the process that stores the owner of given cell.
+
+	Cells are hashed to spread neighboring cells,
+	which usually are refined together, across processes.
+	*/
+	static int get_home_process(const uint64_t cell, const int comm_size)
+	{
+		// multiplicative (Fibonacci) hashing
+		const uint64_t hash = (cell * uint64_t(0x9E3779B97F4A7C15)) >> 32;
+		return int(hash % uint64_t(comm_size));
+	}
+
+
+	/*!
+	Replaces the contents of the directory with given cells and their owners.
+
+	Every process gives the cells it wants to be stored in the directory,
+	the same cell can be given by several processes in which case
+	all of them must give the same owner for it.
+	*/
+	void set(
+		const std::vector<std::pair<uint64_t, uint64_t>>& cells_and_processes,
+		MPI_Comm& comm
+	) {
+		int comm_size = 0;
+		MPI_Comm_size(comm, &comm_size);
+
+		std::vector<std::vector<uint64_t>> outgoing(comm_size), incoming;
+		for (const auto& item: cells_and_processes) {
+			auto& destination = outgoing[get_home_process(item.first, comm_size)];
+			destination.push_back(item.first);
+			destination.push_back(item.second);
+		}
+		All_To_All()(outgoing, incoming, comm);
+		outgoing.clear();
+
+		this->owners.clear();
+		for (const auto& items: incoming) {
+			for (size_t i = 0; i + 1 < items.size(); i += 2) {
+				#ifdef DEBUG
+				if (
+					this->owners.count(items[i]) > 0
+					and this->owners.at(items[i]) != items[i + 1]
+				) {
+					std::cerr << __FILE__ << ":" << __LINE__
+						<< " Different owners given for cell " << items[i]
+						<< ": " << this->owners.at(items[i])
+						<< " and " << items[i + 1]
+						<< std::endl;
+					abort();
+				}
+				#endif
+				this->owners[items[i]] = items[i + 1];
+			}
+		}
+	}
+
+
+	/*!
+	Returns the owners of given cells.
+
+	Owner of a cell that doesn't exist in the directory is error_process().
+	Returned processes are in the same order as given cells.
+	*/
+	std::vector<uint64_t> get_process(
+		const std::vector<uint64_t>& cells,
+		MPI_Comm& comm
+	) const {
+		int comm_size = 0;
+		MPI_Comm_size(comm, &comm_size);
+
+		// send queries to home processes and remember
+		// where each reply has to be placed
+		std::vector<std::vector<uint64_t>> queries(comm_size), incoming;
+		std::vector<std::vector<size_t>> positions(comm_size);
+		for (size_t i = 0; i < cells.size(); i++) {
+			const int home = get_home_process(cells[i], comm_size);
+			queries[home].push_back(cells[i]);
+			positions[home].push_back(i);
+		}
+		All_To_All()(queries, incoming, comm);
+
+		// answer queries of other processes
+		std::vector<std::vector<uint64_t>> replies(comm_size);
+		for (size_t process = 0; process < incoming.size(); process++) {
+			replies[process].reserve(incoming[process].size());
+			for (const uint64_t cell: incoming[process]) {
+				const auto owner = this->owners.find(cell);
+				if (owner == this->owners.cend()) {
+					replies[process].push_back(error_process());
+				} else {
+					replies[process].push_back(owner->second);
+				}
+			}
+		}
+		incoming.clear();
+		All_To_All()(replies, incoming, comm);
+
+		std::vector<uint64_t> result(cells.size(), error_process());
+		for (size_t process = 0; process < incoming.size(); process++) {
+			if (incoming[process].size() != positions[process].size()) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << process
+					<< " answered " << incoming[process].size()
+					<< " queries instead of " << positions[process].size()
+					<< std::endl;
+				abort();
+			}
+
+			for (size_t i = 0; i < positions[process].size(); i++) {
+				result[positions[process][i]] = incoming[process][i];
+			}
+		}
+
+		return result;
+	}
+
+
+	/*!
+	Removes all cells from the directory on this process.
+	*/
+	void clear()
+	{
+		this->owners.clear();
+	}
+
+
+	/*!
+	Returns the number of cells stored on this process.
+	*/
+	size_t size() const
+	{
+		return this->owners.size();
+	}
+
+
+	/*!
+	Returns an estimate of the memory in bytes used by the directory on this process.
+	*/
+	uint64_t get_memory_usage() const
+	{
+		return
+			this->owners.bucket_count() * sizeof(void*)
+			+ this->owners.size() * (sizeof(std::pair<const uint64_t, uint64_t>) + 2 * sizeof(void*));
+	}
+
+
+	/*!
+	Cells whose home process is this one and their owners.
+	*/
+	const std::unordered_map<uint64_t, uint64_t>& get_owners() const
+	{
+		return this->owners;
+	}
+
+
+private:
+
+	std::unordered_map<uint64_t, uint64_t> owners;
+
+};
+
+}	// namespace
+
+#endif
@@ -0,0 +1,411 @@
+/*
+Storage policies for cell data of dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DCCRG_CELL_STORAGE_HPP
+#define DCCRG_CELL_STORAGE_HPP
+
+
+#include "algorithm"
+#include "cstdint"
+#include "iterator"
+#include "numeric"
+#include "stdexcept"
+#include "string"
+#include "unordered_map"
+#include "utility"
+#include "vector"
+
+
+namespace dccrg {
+
+
+/*!
+\brief Map-like container of cell data stored in contiguous arrays.
+
+Ids of cells and their data are stored in separate arrays
+at the same position (slot) and an index from cell ids
+to slots is kept next to them.
+New cells are appended to the end of the arrays and removed
+cells are replaced by the last cell so neither keeps
+the order of cells, use sort() to restore it.
+
+Unlike with std::unordered_map inserting or removing cells
+can move the data of other cells in memory.
+*/
+template <class Cell_Data> class Contiguous_Cell_Container
+{
+public:
+
+	/*!
+	Type returned when dereferencing an iterator.
+
+	Behaves like the value_type of std::unordered_map
+	except that it is returned by value.
+	*/
+	template <class Data> struct Item : public std::pair<const uint64_t&, Data&>
+	{
+		Item(const uint64_t& id, Data& data) :
+			std::pair<const uint64_t&, Data&>(id, data)
+		{}
+
+		// allows iterator->first and ->second
+		const Item* operator->() const
+		{
+			return this;
+		}
+	};
+
+	/*!
+	Forward iterator over cells and their data in storage order.
+	*/
+	template <class Container, class Data> class Iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Item<Data> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef Item<Data> pointer;
+		typedef Item<Data> reference;
+
+		Iterator(Container& given_container, const size_t given_slot) :
+			container(&given_container),
+			slot(given_slot)
+		{}
+
+		Item<Data> operator*() const
+		{
+			return Item<Data>(this->container->ids[this->slot], this->container->data[this->slot]);
+		}
+
+		Item<Data> operator->() const
+		{
+			return this->operator*();
+		}
+
+		Iterator& operator++()
+		{
+			this->slot++;
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			Iterator old(*this);
+			this->slot++;
+			return old;
+		}
+
+		bool operator==(const Iterator& other) const
+		{
+			return this->slot == other.slot;
+		}
+
+		bool operator!=(const Iterator& other) const
+		{
+			return this->slot != other.slot;
+		}
+
+	private:
+		Container* container;
+		size_t slot;
+	};
+
+	typedef Iterator<Contiguous_Cell_Container<Cell_Data>, Cell_Data> iterator;
+	typedef Iterator<const Contiguous_Cell_Container<Cell_Data>, const Cell_Data> const_iterator;
+	typedef std::pair<const uint64_t, Cell_Data> value_type;
+
+
+	/*!
+	Returns data of given cell, default constructs it first if it doesn't exist.
+	*/
+	Cell_Data& operator[](const uint64_t cell)
+	{
+		const auto slot = this->slots.find(cell);
+		if (slot != this->slots.end()) {
+			return this->data[slot->second];
+		}
+
+		this->slots[cell] = this->ids.size();
+		this->ids.push_back(cell);
+		this->data.emplace_back();
+		this->sorted = false;
+		return this->data.back();
+	}
+
+	/*!
+	Returns data of given cell, throws std::out_of_range if it doesn't exist.
+	*/
+	Cell_Data& at(const uint64_t cell)
+	{
+		return this->data[this->get_slot(cell)];
+	}
+
+	const Cell_Data& at(const uint64_t cell) const
+	{
+		return this->data[this->get_slot(cell)];
+	}
+
+	size_t count(const uint64_t cell) const
+	{
+		return this->slots.count(cell);
+	}
+
+	/*!
+	Removes given cell and returns the number of removed cells.
+
+	Data of the last cell in storage order is moved into the removed cell's slot.
+	*/
+	size_t erase(const uint64_t cell)
+	{
+		const auto item = this->slots.find(cell);
+		if (item == this->slots.end()) {
+			return 0;
+		}
+
+		const size_t slot = item->second, last = this->ids.size() - 1;
+		this->slots.erase(item);
+		if (slot != last) {
+			this->ids[slot] = this->ids[last];
+			this->data[slot] = std::move(this->data[last]);
+			this->slots[this->ids[slot]] = slot;
+			this->sorted = false;
+		}
+		this->ids.pop_back();
+		this->data.pop_back();
+
+		return 1;
+	}
+
+	size_t size() const
+	{
+		return this->ids.size();
+	}
+
+	bool empty() const
+	{
+		return this->ids.empty();
+	}
+
+	void clear()
+	{
+		this->ids.clear();
+		this->data.clear();
+		this->slots.clear();
+		this->sorted = true;
+	}
+
+	iterator begin()
+	{
+		return iterator(*this, 0);
+	}
+
+	iterator end()
+	{
+		return iterator(*this, this->ids.size());
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(*this, 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(*this, this->ids.size());
+	}
+
+	const_iterator cbegin() const
+	{
+		return this->begin();
+	}
+
+	const_iterator cend() const
+	{
+		return this->end();
+	}
+
+
+	/*!
+	Reorders cells so that ids are in the order given by is_before.
+
+	Does nothing if cells haven't been added or removed since
+	the previous call. is_before must be a strict weak ordering
+	of cell ids, for example std::less<uint64_t>.
+	*/
+	template <class Comparator> void sort(const Comparator& is_before)
+	{
+		if (this->sorted) {
+			return;
+		}
+
+		std::vector<size_t> order(this->ids.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(
+			order.begin(),
+			order.end(),
+			[this, &is_before](const size_t a, const size_t b) {
+				return is_before(this->ids[a], this->ids[b]);
+			}
+		);
+
+		std::vector<uint64_t> new_ids;
+		new_ids.reserve(this->ids.size());
+		std::vector<Cell_Data> new_data;
+		new_data.reserve(this->data.size());
+		for (const size_t slot: order) {
+			new_ids.push_back(this->ids[slot]);
+			new_data.push_back(std::move(this->data[slot]));
+		}
+		this->ids.swap(new_ids);
+		this->data.swap(new_data);
+
+		for (size_t slot = 0; slot < this->ids.size(); slot++) {
+			this->slots.at(this->ids[slot]) = slot;
+		}
+
+		this->sorted = true;
+	}
+
+
+	/*!
+	Returns ids of cells in storage order.
+	*/
+	const std::vector<uint64_t>& get_ids() const
+	{
+		return this->ids;
+	}
+
+	/*!
+	Returns data of cells in storage order.
+	*/
+	const std::vector<Cell_Data>& get_data() const
+	{
+		return this->data;
+	}
+
+
+	/*!
+	Returns an estimate of memory in bytes used by the container.
+
+	Memory allocated by cells' data themselves is not included.
+	*/
+	uint64_t get_memory_usage() const
+	{
+		return
+			this->ids.capacity() * sizeof(uint64_t)
+			+ this->data.capacity() * sizeof(Cell_Data)
+			+ this->slots.bucket_count() * sizeof(void*)
+			+ this->slots.size() * (sizeof(std::pair<const uint64_t, size_t>) + 2 * sizeof(void*));
+	}
+
+
+private:
+
+	size_t get_slot(const uint64_t cell) const
+	{
+		const auto slot = this->slots.find(cell);
+		if (slot == this->slots.end()) {
+			throw std::out_of_range(
+				__FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Cell " + std::to_string(cell) + " doesn't exist"
+			);
+		}
+		return slot->second;
+	}
+
+	std::vector<uint64_t> ids;
+	std::vector<Cell_Data> data;
+
+	// position of each cell in ids and data
+	std::unordered_map<uint64_t, size_t> slots;
+
+	// whether cells are in the order of the latest sort()
+	bool sorted = true;
+};
+
+
+/*!
+\brief Default storage policy of dccrg, stores cell data in std::unordered_map.
+
+Data of a cell stays at the same address until the cell is removed.
+
+\see Dccrg
+*/
+struct Unordered_Cell_Storage
+{
+	template <class Cell_Data> using container = std::unordered_map<uint64_t, Cell_Data>;
+
+	//! Whether data of a cell stays at the same address when other cells are added or removed
+	static constexpr bool stable_addresses = true;
+
+	/*!
+	Does nothing since unordered_map has no order.
+	*/
+	template <class Cell_Data, class Comparator> static void sort(
+		container<Cell_Data>&,
+		const Comparator&
+	) {}
+
+	template <class Cell_Data> static uint64_t get_memory_usage(
+		const container<Cell_Data>& cells
+	) {
+		return
+			cells.bucket_count() * sizeof(void*)
+			+ cells.size() * (sizeof(std::pair<const uint64_t, Cell_Data>) + 2 * sizeof(void*));
+	}
+};
+
+
+/*!
+\brief Storage policy of dccrg that stores cell data in contiguous arrays.
+
+Local cells and copies of remote neighbors are each stored in one
+array ordered by the cells' positions on a Morton space-filling curve,
+which is restored every time dccrg updates its cells and neighbors
+iterators. Cells_Item::data and Neighbors_Item::data point into
+these arrays so iterating over cells in order accesses memory
+mostly sequentially.
+
+Pointers to cell data, e.g. from Dccrg::operator[](), are invalidated
+when refining, balancing load and adding or removing neighborhoods.
+
+\see Dccrg Contiguous_Cell_Container
+*/
+struct Contiguous_Cell_Storage
+{
+	template <class Cell_Data> using container = Contiguous_Cell_Container<Cell_Data>;
+
+	static constexpr bool stable_addresses = false;
+
+	template <class Cell_Data, class Comparator> static void sort(
+		container<Cell_Data>& cells,
+		const Comparator& is_before
+	) {
+		cells.sort(is_before);
+	}
+
+	template <class Cell_Data> static uint64_t get_memory_usage(
+		const container<Cell_Data>& cells
+	) {
+		return cells.get_memory_usage();
+	}
+};
+
+}	// namespace
+
+#endif
@@ -0,0 +1,329 @@
+/*
+Codecs for compressing cell data in files written by dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DCCRG_CHECKPOINT_CODEC_HPP
+#define DCCRG_CHECKPOINT_CODEC_HPP
+
+
+#include "cstdint"
+#include "cstring"
+#include "vector"
+
+
+namespace dccrg {
+
+
+/*!
+Written instead of number of cells into compressed files, format after it:
+
+uint64_t  id of codec
+uint64_t  number of cells
+uint64_t  number of compressed blocks
+uint64_t  id of 1st cell
+uint64_t  start of data of 1st cell in uncompressed cell data
+...
+uint64_t  start of 1st compressed block in file
+uint64_t  size of 1st compressed block in file
+uint64_t  start of 1st block in uncompressed cell data
+uint64_t  size of 1st block in uncompressed cell data
+...
+uint8_t*A 1st compressed block
+...
+
+\see Dccrg::set_checkpoint_codec()
+*/
+static const uint64_t compressed_cells_marker = ~uint64_t(0xdcc);
+
+
+/*!
+\brief Interface of codecs that compress blocks of cell data in grid files.
+
+Each block of cell data is compressed and decompressed
+independently so compress() and decompress() must not
+depend on earlier calls.
+
+\see Dccrg::set_checkpoint_codec()
+*/
+class Checkpoint_Codec
+{
+public:
+
+	virtual ~Checkpoint_Codec() {}
+
+	/*!
+	Returns the number identifying this codec in files.
+
+	Written into files and compared to the codec used when loading,
+	0 is reserved for uncompressed files.
+	*/
+	virtual uint64_t get_id() const = 0;
+
+	/*!
+	Appends compressed version of given size bytes of data to result.
+	*/
+	virtual void compress(
+		const uint8_t* const data,
+		const size_t size,
+		std::vector<uint8_t>& result
+	) const = 0;
+
+	/*!
+	Decompresses given size bytes of data into result_size bytes of result.
+
+	Returns false if data is invalid or doesn't decompress
+	into exactly result_size bytes.
+	*/
+	virtual bool decompress(
+		const uint8_t* const data,
+		const size_t size,
+		uint8_t* const result,
+		const size_t result_size
+	) const = 0;
+};
+
+
+/*!
+\brief Built-in codec with byte shuffling and LZ77 style compression.
+
+Bytes of data are first shuffled so that the 1st bytes of
+every element_size bytes come first, then 2nd bytes, etc.
+which makes e.g. smooth fields of doubles compress better.
+Shuffled data is compressed by replacing repeated sequences
+of at least 4 bytes with references to earlier data.
+
+Compressed format:
+\verbatim
+uint8_t  element size
+varint   number of literal bytes
+uint8_t  literal bytes...
+varint   match length (>= 4)
+varint   match distance backwards from end of output
+varint   number of literal bytes
+...
+\endverbatim
+ending with literal bytes, where varint is an unsigned
+integer stored 7 bits at a time in little endian order
+with highest bit of each byte set if more bytes follow.
+*/
+class Shuffle_LZ_Codec : public Checkpoint_Codec
+{
+public:
+
+	/*!
+	Creates a codec that shuffles bytes of elements of given size.
+
+	Given size is clamped to [1, 255].
+	*/
+	explicit Shuffle_LZ_Codec(const size_t given_element_size = sizeof(double)) :
+		element_size(
+			given_element_size < 1 ? 1 : (given_element_size > 255 ? 255 : given_element_size)
+		)
+	{}
+
+	uint64_t get_id() const override
+	{
+		return 1;
+	}
+
+	void compress(
+		const uint8_t* const data,
+		const size_t size,
+		std::vector<uint8_t>& result
+	) const override {
+		result.push_back(uint8_t(this->element_size));
+
+		std::vector<uint8_t> shuffled(size);
+		shuffle(data, size, this->element_size, shuffled.data(), false);
+
+		// last position of every hash of 4 bytes
+		std::vector<size_t> positions(size_t(1) << hash_bits, ~size_t(0));
+
+		size_t literals_start = 0, i = 0;
+		while (i + min_match <= size) {
+			const size_t hash = get_hash(shuffled.data() + i);
+			const size_t candidate = positions[hash];
+			positions[hash] = i;
+
+			if (
+				candidate == ~size_t(0)
+				or std::memcmp(shuffled.data() + candidate, shuffled.data() + i, min_match) != 0
+			) {
+				i++;
+				continue;
+			}
+
+			size_t length = min_match;
+			while (i + length < size and shuffled[candidate + length] == shuffled[i + length]) {
+				length++;
+			}
+
+			write_varint(i - literals_start, result);
+			result.insert(result.end(), shuffled.begin() + literals_start, shuffled.begin() + i);
+			write_varint(length, result);
+			write_varint(i - candidate, result);
+
+			i += length;
+			literals_start = i;
+		}
+
+		write_varint(size - literals_start, result);
+		result.insert(result.end(), shuffled.begin() + literals_start, shuffled.end());
+	}
+
+	bool decompress(
+		const uint8_t* const data,
+		const size_t size,
+		uint8_t* const result,
+		const size_t result_size
+	) const override {
+		if (size == 0) {
+			return false;
+		}
+		const size_t data_element_size = data[0];
+		if (data_element_size == 0) {
+			return false;
+		}
+
+		std::vector<uint8_t> shuffled(result_size);
+		size_t in = 1, out = 0;
+		while (true) {
+			uint64_t literals = 0;
+			if (not read_varint(data, size, in, literals)) {
+				return false;
+			}
+			if (literals > size - in or literals > result_size - out) {
+				return false;
+			}
+			std::memcpy(shuffled.data() + out, data + in, size_t(literals));
+			in += size_t(literals);
+			out += size_t(literals);
+
+			if (in == size) {
+				break;
+			}
+
+			uint64_t length = 0, distance = 0;
+			if (
+				not read_varint(data, size, in, length)
+				or not read_varint(data, size, in, distance)
+			) {
+				return false;
+			}
+			if (
+				length < min_match
+				or distance == 0
+				or distance > out
+				or length > result_size - out
+			) {
+				return false;
+			}
+			// source and destination can overlap
+			for (size_t j = 0; j < length; j++) {
+				shuffled[out + j] = shuffled[out - size_t(distance) + j];
+			}
+			out += size_t(length);
+		}
+
+		if (out != result_size) {
+			return false;
+		}
+
+		shuffle(shuffled.data(), result_size, data_element_size, result, true);
+		return true;
+	}
+
+
+private:
+
+	size_t element_size;
+
+	static constexpr size_t min_match = 4, hash_bits = 16;
+
+
+	static size_t get_hash(const uint8_t* const data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return size_t((value * uint32_t(2654435761u)) >> (32 - hash_bits));
+	}
+
+	/*!
+	Shuffles or unshuffles bytes of elements of given size.
+
+	Bytes that don't fill a whole element are copied as is.
+	*/
+	static void shuffle(
+		const uint8_t* const data,
+		const size_t size,
+		const size_t element_size,
+		uint8_t* const result,
+		const bool unshuffle
+	) {
+		const size_t elements = size / element_size;
+		for (size_t byte = 0; byte < element_size; byte++) {
+			for (size_t element = 0; element < elements; element++) {
+				const size_t
+					unshuffled_i = element * element_size + byte,
+					shuffled_i = byte * elements + element;
+				if (unshuffle) {
+					result[unshuffled_i] = data[shuffled_i];
+				} else {
+					result[shuffled_i] = data[unshuffled_i];
+				}
+			}
+		}
+		const size_t tail_start = elements * element_size;
+		if (size > tail_start) {
+			std::memcpy(result + tail_start, data + tail_start, size - tail_start);
+		}
+	}
+
+	static void write_varint(uint64_t value, std::vector<uint8_t>& result)
+	{
+		while (value >= 0x80) {
+			result.push_back(uint8_t(value | 0x80));
+			value >>= 7;
+		}
+		result.push_back(uint8_t(value));
+	}
+
+	static bool read_varint(
+		const uint8_t* const data,
+		const size_t size,
+		size_t& position,
+		uint64_t& value
+	) {
+		value = 0;
+		for (unsigned int shift = 0; shift < 64; shift += 7) {
+			if (position >= size) {
+				return false;
+			}
+			const uint8_t byte = data[position++];
+			value |= uint64_t(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+
+} // namespace
+
+#endif
@@ -0,0 +1,773 @@
+/*
+Checksums of files written by dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DCCRG_CHECKSUM_HPP
+#define DCCRG_CHECKSUM_HPP
+
+
+#include "algorithm"
+#include "array"
+#include "climits"
+#include "cstdint"
+#include "cstring"
+#include "iostream"
+#include "vector"
+
+#ifndef DCCRG_NO_MPI
+#include "mpi.h"
+#endif
+
+#ifndef DCCRG_NO_MPI
+#include "dccrg_mpi_support.hpp"
+#endif
+
+
+namespace dccrg {
+
+
+/*!
+\brief Calculates CRC-32C (Castagnoli) checksums.
+
+Uses 8 lookup tables to process 8 bytes at a time.
+*/
+class Crc32c
+{
+public:
+
+	/*!
+	Returns checksum of given data continuing from given checksum.
+
+	Checksum of data split into several parts can be
+	calculated by giving the result of previous part.
+	*/
+	uint32_t operator()(
+		const uint8_t* data,
+		size_t size,
+		const uint32_t previous = 0
+	) const {
+		const auto& table = get_table();
+
+		uint32_t crc = ~previous;
+		while (size >= 8) {
+			const uint32_t
+				first = crc ^ (
+					uint32_t(data[0])
+					| (uint32_t(data[1]) << 8)
+					| (uint32_t(data[2]) << 16)
+					| (uint32_t(data[3]) << 24)
+				),
+				second
+					= uint32_t(data[4])
+					| (uint32_t(data[5]) << 8)
+					| (uint32_t(data[6]) << 16)
+					| (uint32_t(data[7]) << 24);
+			crc
+				= table[7][first & 0xff]
+				^ table[6][(first >> 8) & 0xff]
+				^ table[5][(first >> 16) & 0xff]
+				^ table[4][first >> 24]
+				^ table[3][second & 0xff]
+				^ table[2][(second >> 8) & 0xff]
+				^ table[1][(second >> 16) & 0xff]
+				^ table[0][second >> 24];
+			data += 8;
+			size -= 8;
+		}
+		while (size > 0) {
+			crc = table[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+			data++;
+			size--;
+		}
+
+		return ~crc;
+	}
+
+
+	/*!
+	Returns checksum of two parts of data from their checksums.
+
+	first and second are checksums of the first and second part
+	of data and second_size is the number of bytes in the second
+	part. Multiplies the first checksum by the CRC of second_size
+	zero bytes in GF(2) as in zlib's crc32_combine().
+	*/
+	static uint32_t combine(uint32_t first, const uint32_t second, uint64_t second_size)
+	{
+		if (second_size == 0) {
+			return first;
+		}
+
+		// operator for one zero bit in odd, two in even, etc.
+		gf2_matrix_t odd, even;
+		odd[0] = 0x82f63b78;
+		for (size_t i = 1; i < odd.size(); i++) {
+			odd[i] = uint32_t(1) << (i - 1);
+		}
+		square(even, odd);
+		square(odd, even);
+
+		// apply operators for one zero byte, two, four, etc.
+		while (true) {
+			square(even, odd);
+			if (second_size & 1) {
+				first = times(even, first);
+			}
+			second_size >>= 1;
+			if (second_size == 0) {
+				break;
+			}
+
+			square(odd, even);
+			if (second_size & 1) {
+				first = times(odd, first);
+			}
+			second_size >>= 1;
+			if (second_size == 0) {
+				break;
+			}
+		}
+
+		return first ^ second;
+	}
+
+
+private:
+
+	typedef std::array<std::array<uint32_t, 256>, 8> table_t;
+	typedef std::array<uint32_t, 32> gf2_matrix_t;
+
+	static uint32_t times(const gf2_matrix_t& matrix, uint32_t vector)
+	{
+		uint32_t result = 0;
+		for (size_t i = 0; vector != 0; i++, vector >>= 1) {
+			if (vector & 1) {
+				result ^= matrix[i];
+			}
+		}
+		return result;
+	}
+
+	static void square(gf2_matrix_t& result, const gf2_matrix_t& matrix)
+	{
+		for (size_t i = 0; i < matrix.size(); i++) {
+			result[i] = times(matrix, matrix[i]);
+		}
+	}
+
+	static const table_t& get_table()
+	{
+		static const table_t table = make_table();
+		return table;
+	}
+
+	static table_t make_table()
+	{
+		table_t table;
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++) {
+				crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78 : 0);
+			}
+			table[0][i] = crc;
+		}
+		for (size_t slice = 1; slice < table.size(); slice++) {
+			for (uint32_t i = 0; i < 256; i++) {
+				const uint32_t previous = table[slice - 1][i];
+				table[slice][i] = (previous >> 8) ^ table[0][previous & 0xff];
+			}
+		}
+		return table;
+	}
+};
+
+
+/*!
+\brief Checksums of fixed size blocks of a file.
+
+Checksums cover bytes from start to end of a file in blocks of
+block_size bytes, the last block can be smaller. Written into
+the file after checksummed data in format:
+
+uint64_t  checksum of 1st block
+uint64_t  checksum of 2nd block
+...
+uint64_t  start
+uint64_t  end, also start of checksums
+uint64_t  block_size
+uint64_t  checksum of above items
+uint64_t  File_Checksums::marker
+
+so that the file ends with checksums and they can be found without
+knowing the format of checksummed data. Blocks are divided evenly
+between processes which calculate checksums in parallel.
+
+When saving, processes give the data they write to add() and
+checksums of blocks are combined from checksums of those parts
+by calculate_from_parts() without reading the file.
+
+\see Dccrg::set_checkpoint_checksums()
+*/
+class File_Checksums
+{
+public:
+
+	// last item in files with checksums
+	static constexpr uint64_t marker = 0xdcc0c5c3c4ec5a11;
+
+	uint64_t start = 0, end = 0, block_size = 0;
+	std::vector<uint64_t> checksums;
+
+	/*
+	Parts of blocks given to add(), for each one the index of its
+	block, its offset from start of block, its size and checksum.
+	*/
+	std::vector<uint64_t> parts;
+
+
+	//! Returns the number of blocks between start and end.
+	uint64_t get_number_of_blocks() const
+	{
+		if (this->block_size == 0) {
+			return 0;
+		}
+		return (this->end - this->start + this->block_size - 1) / this->block_size;
+	}
+
+
+	//! Returns the size of checksums in file in bytes.
+	uint64_t get_trailer_size() const
+	{
+		return (this->get_number_of_blocks() + 5) * sizeof(uint64_t);
+	}
+
+
+	/*!
+	Records checksums of given data which is written into file at given offset.
+
+	Data before start isn't checksummed, start and block_size must
+	be set before calling this. Data after end is ignored by
+	calculate_from_parts().
+	*/
+	void add(uint64_t offset, const uint8_t* data, uint64_t size)
+	{
+		if (this->block_size == 0) {
+			return;
+		}
+
+		if (offset < this->start) {
+			const uint64_t skipped = std::min(size, this->start - offset);
+			offset += skipped;
+			data += skipped;
+			size -= skipped;
+		}
+
+		while (size > 0) {
+			const uint64_t
+				block = (offset - this->start) / this->block_size,
+				offset_in_block = (offset - this->start) % this->block_size,
+				part_size = std::min(size, this->block_size - offset_in_block);
+
+			this->parts.push_back(block);
+			this->parts.push_back(offset_in_block);
+			this->parts.push_back(part_size);
+			this->parts.push_back(Crc32c()(data, size_t(part_size)));
+
+			offset += part_size;
+			data += part_size;
+			size -= part_size;
+		}
+	}
+
+
+	#ifndef DCCRG_NO_MPI
+	/*!
+	Calculates checksums of blocks from checksums given to add().
+
+	Parts of each block are sent to the process calculating its
+	checksum which combines them. Blocks not completely covered
+	by parts, for example ones with data written without calling
+	add(), are read from given file as in calculate(), in which
+	case the file must have been opened for reading.
+
+	Must be called simultaneously on all processes with identical
+	start, end and block_size. Returns true on success and false
+	otherwise.
+	*/
+	bool calculate_from_parts(MPI_File& file, MPI_Comm comm)
+	{
+		int comm_size = 1;
+		MPI_Comm_size(comm, &comm_size);
+
+		const uint64_t
+			number_of_blocks = this->get_number_of_blocks(),
+			blocks_per_process = (number_of_blocks + uint64_t(comm_size) - 1) / uint64_t(comm_size);
+
+		std::vector<std::vector<uint64_t>> sends(comm_size), receives;
+		for (size_t i = 0; i < this->parts.size(); i += 4) {
+			if (this->parts[i] >= number_of_blocks) {
+				continue;
+			}
+			auto& send = sends[this->parts[i] / blocks_per_process];
+			send.insert(send.end(), this->parts.begin() + i, this->parts.begin() + i + 4);
+		}
+		All_To_All()(sends, receives, comm);
+
+		std::vector<std::array<uint64_t, 4>> local_parts;
+		for (const auto& receive: receives) {
+			for (size_t i = 0; i < receive.size(); i += 4) {
+				local_parts.push_back({{receive[i], receive[i + 1], receive[i + 2], receive[i + 3]}});
+			}
+		}
+		std::sort(local_parts.begin(), local_parts.end());
+
+		this->checksums.assign(number_of_blocks, 0);
+
+		uint64_t first = 0, last = 0;
+		this->get_local_blocks(comm, first, last);
+
+		std::vector<uint64_t> incomplete_blocks;
+		auto part = local_parts.cbegin();
+		for (uint64_t i = first; i < last; i++) {
+			uint32_t checksum = 0;
+			uint64_t size = 0;
+			bool complete = true;
+			for ( ; part != local_parts.cend() and (*part)[0] == i; part++) {
+				if ((*part)[1] != size) {
+					complete = false;
+				}
+				checksum = Crc32c::combine(checksum, uint32_t((*part)[3]), (*part)[2]);
+				size += (*part)[2];
+			}
+
+			if (complete and size == std::min(this->block_size, this->end - this->start - i * this->block_size)) {
+				this->checksums[i] = checksum;
+			} else {
+				incomplete_blocks.push_back(i);
+			}
+		}
+
+		// all processes must synchronize file before anyone reads it
+		uint64_t total_incomplete = 0;
+		const uint64_t local_incomplete = incomplete_blocks.size();
+		int ret_val = MPI_Allreduce(
+			&local_incomplete,
+			&total_incomplete,
+			1,
+			MPI_UINT64_T,
+			MPI_SUM,
+			comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Allreduce failed: " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+
+		if (total_incomplete > 0) {
+			if (not this->synchronize(file, comm)) {
+				return false;
+			}
+
+			std::vector<uint8_t> buffer;
+			for (const auto block: incomplete_blocks) {
+				if (not this->calculate_block(file, block, buffer, this->checksums[block])) {
+					return false;
+				}
+			}
+		}
+
+		return this->sum_checksums(comm);
+	}
+
+
+	/*!
+	Calculates checksums of given file between start and end.
+
+	Data written to given file by any process before calling this
+	is included. Given file must have been opened for reading on
+	all processes of given communicator.
+
+	Must be called simultaneously on all processes with identical
+	start, end and block_size. Returns true on success and false
+	otherwise.
+	*/
+	bool calculate(MPI_File& file, MPI_Comm comm)
+	{
+		return
+			this->synchronize(file, comm)
+			and this->calculate_local(file, comm, this->checksums)
+			and this->sum_checksums(comm);
+	}
+
+
+	/*!
+	Writes checksums into given file at end.
+
+	Also sets the size of given file to end of checksums.
+	Must be called simultaneously on all processes after calculate().
+	*/
+	bool write(MPI_File& file, MPI_Comm comm) const
+	{
+		int rank = 0;
+		MPI_Comm_rank(comm, &rank);
+
+		const std::vector<uint64_t> trailer = this->get_trailer();
+		if (trailer.size() > uint64_t(INT_MAX)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Too many checksums: " << trailer.size()
+				<< std::endl;
+			return false;
+		}
+
+		int ret_val = MPI_File_set_size(file, MPI_Offset(this->end + this->get_trailer_size()));
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't set size of file: " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+
+		ret_val = MPI_File_write_at_all(
+			file,
+			MPI_Offset(this->end),
+			(void*) trailer.data(),
+			rank == 0 ? int(trailer.size()) : 0,
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't write checksums: " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+
+	/*!
+	Reads checksums from the end of given file.
+
+	Returns false if given file doesn't end with valid checksums.
+	Must be called simultaneously on all processes.
+	*/
+	bool read(MPI_File& file)
+	{
+		this->checksums.clear();
+
+		MPI_Offset file_size = 0;
+		int ret_val = MPI_File_get_size(file, &file_size);
+		if (ret_val != MPI_SUCCESS or uint64_t(file_size) < 5 * sizeof(uint64_t)) {
+			return false;
+		}
+
+		std::array<uint64_t, 5> last{{0, 0, 0, 0, 0}};
+		ret_val = MPI_File_read_at_all(
+			file,
+			file_size - MPI_Offset(last.size() * sizeof(uint64_t)),
+			(void*) last.data(),
+			int(last.size()),
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS or not this->set_from_trailer_end(last.data(), uint64_t(file_size))) {
+			return false;
+		}
+
+		this->checksums.resize(this->get_number_of_blocks());
+		if (this->checksums.size() > uint64_t(INT_MAX)) {
+			return false;
+		}
+		uint64_t dummy = 0;
+		ret_val = MPI_File_read_at_all(
+			file,
+			MPI_Offset(this->end),
+			this->checksums.size() > 0 ? (void*) this->checksums.data() : (void*) &dummy,
+			int(this->checksums.size()),
+			MPI_UINT64_T,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			return false;
+		}
+
+		return this->get_trailer()[this->checksums.size() + 3] == last[3];
+	}
+	#endif
+
+
+	/*!
+	Reads checksums from the end of given size bytes of data in memory.
+
+	Returns false if data doesn't end with valid checksums.
+	*/
+	bool read(const uint8_t* const data, const size_t size)
+	{
+		this->checksums.clear();
+
+		if (size < 5 * sizeof(uint64_t)) {
+			return false;
+		}
+
+		std::array<uint64_t, 5> last;
+		std::memcpy(last.data(), data + size - sizeof(last), sizeof(last));
+		if (not this->set_from_trailer_end(last.data(), uint64_t(size))) {
+			return false;
+		}
+
+		this->checksums.resize(this->get_number_of_blocks());
+		std::memcpy(
+			this->checksums.data(),
+			data + this->end,
+			this->checksums.size() * sizeof(uint64_t)
+		);
+
+		return this->get_trailer()[this->checksums.size() + 3] == last[3];
+	}
+
+
+	#ifndef DCCRG_NO_MPI
+	/*!
+	Verifies data of given file against checksums.
+
+	Indices of blocks whose data doesn't match its checksum
+	are stored into bad_blocks on all processes.
+
+	Must be called simultaneously on all processes after read().
+	Returns true on success and false otherwise.
+	*/
+	bool verify(MPI_File& file, MPI_Comm comm, std::vector<uint64_t>& bad_blocks) const
+	{
+		bad_blocks.clear();
+
+		std::vector<uint64_t> local_checksums;
+		if (not this->calculate_local(file, comm, local_checksums)) {
+			return false;
+		}
+
+		std::vector<uint64_t> local_bad_blocks;
+		uint64_t first = 0, last = 0;
+		this->get_local_blocks(comm, first, last);
+		for (uint64_t i = first; i < last; i++) {
+			if (local_checksums[i] != this->checksums[i]) {
+				local_bad_blocks.push_back(i);
+			}
+		}
+
+		std::vector<std::vector<uint64_t>> all_bad_blocks;
+		All_Gather()(local_bad_blocks, all_bad_blocks, comm);
+		for (const auto& blocks: all_bad_blocks) {
+			bad_blocks.insert(bad_blocks.end(), blocks.begin(), blocks.end());
+		}
+
+		return true;
+	}
+	#endif
+
+
+private:
+
+	/*!
+	Returns checksums and other items written into file.
+	*/
+	std::vector<uint64_t> get_trailer() const
+	{
+		std::vector<uint64_t> trailer(this->checksums);
+		trailer.push_back(this->start);
+		trailer.push_back(this->end);
+		trailer.push_back(this->block_size);
+		trailer.push_back(
+			Crc32c()((const uint8_t*) trailer.data(), trailer.size() * sizeof(uint64_t))
+		);
+		trailer.push_back(uint64_t(marker));
+		return trailer;
+	}
+
+
+	/*!
+	Sets start, end and block size from last 5 items of file of given size.
+
+	Returns false if they aren't valid.
+	*/
+	bool set_from_trailer_end(const uint64_t* const last, const uint64_t file_size)
+	{
+		this->start = last[0];
+		this->end = last[1];
+		this->block_size = last[2];
+
+		return
+			last[4] == marker
+			and this->block_size > 0
+			and this->start <= this->end
+			and this->end <= file_size
+			and (file_size - this->end) / sizeof(uint64_t) == this->get_number_of_blocks() + 5
+			and (file_size - this->end) % sizeof(uint64_t) == 0;
+	}
+
+
+	#ifndef DCCRG_NO_MPI
+	/*!
+	Stores range of blocks of this process into first and last (exclusive).
+	*/
+	void get_local_blocks(MPI_Comm comm, uint64_t& first, uint64_t& last) const
+	{
+		int rank = 0, comm_size = 1;
+		MPI_Comm_rank(comm, &rank);
+		MPI_Comm_size(comm, &comm_size);
+
+		const uint64_t
+			number_of_blocks = this->get_number_of_blocks(),
+			blocks_per_process = (number_of_blocks + uint64_t(comm_size) - 1) / uint64_t(comm_size);
+		first = std::min(number_of_blocks, uint64_t(rank) * blocks_per_process);
+		last = std::min(number_of_blocks, first + blocks_per_process);
+	}
+
+
+	/*!
+	Makes data written into given file by all processes visible to all.
+	*/
+	bool synchronize(MPI_File& file, MPI_Comm comm) const
+	{
+		int ret_val = MPI_File_sync(file);
+		if (ret_val == MPI_SUCCESS) {
+			ret_val = MPI_Barrier(comm);
+		}
+		if (ret_val == MPI_SUCCESS) {
+			ret_val = MPI_File_sync(file);
+		}
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't synchronize file: " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+		return true;
+	}
+
+
+	/*!
+	Adds checksums of all processes together.
+
+	Each checksum must be non-zero on at most one process.
+	*/
+	bool sum_checksums(MPI_Comm comm)
+	{
+		const uint64_t number_of_blocks = this->checksums.size();
+		for (uint64_t first = 0; first < number_of_blocks; first += uint64_t(INT_MAX)) {
+			const int ret_val = MPI_Allreduce(
+				MPI_IN_PLACE,
+				this->checksums.data() + first,
+				int(std::min(uint64_t(INT_MAX), number_of_blocks - first)),
+				MPI_UINT64_T,
+				MPI_SUM,
+				comm
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Allreduce failed: " << Error_String()(ret_val)
+					<< std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	/*!
+	Reads given block from given file and stores its checksum into result.
+
+	Uses given buffer for data of the block.
+	*/
+	bool calculate_block(
+		MPI_File& file,
+		const uint64_t block,
+		std::vector<uint8_t>& buffer,
+		uint64_t& result
+	) const {
+		if (this->block_size == 0 or this->block_size > uint64_t(INT_MAX)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Invalid block size: " << this->block_size
+				<< std::endl;
+			return false;
+		}
+
+		const uint64_t
+			block_start = this->start + block * this->block_size,
+			size = std::min(this->block_size, this->end - block_start);
+
+		buffer.resize(size);
+		MPI_Status status;
+		const int ret_val = MPI_File_read_at(
+			file,
+			MPI_Offset(block_start),
+			(void*) buffer.data(),
+			int(size),
+			MPI_BYTE,
+			&status
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't read block " << block
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+
+		// checksum of a truncated block doesn't match
+		int read_bytes = 0;
+		MPI_Get_count(&status, MPI_BYTE, &read_bytes);
+		result = Crc32c()(buffer.data(), size_t(std::max(0, read_bytes)));
+		if (uint64_t(read_bytes) != size) {
+			result = ~result;
+		}
+
+		return true;
+	}
+
+
+	/*!
+	Calculates checksums of blocks of this process.
+
+	Stores them into result at their block's index,
+	checksums of other blocks are zero.
+	*/
+	bool calculate_local(MPI_File& file, MPI_Comm comm, std::vector<uint64_t>& result) const
+	{
+		result.assign(this->get_number_of_blocks(), 0);
+
+		uint64_t first = 0, last = 0;
+		this->get_local_blocks(comm, first, last);
+
+		std::vector<uint8_t> buffer;
+		for (uint64_t i = first; i < last; i++) {
+			if (not this->calculate_block(file, i, buffer, result[i])) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+	#endif
+};
+
+
+} // namespace
+
+#endif
@@ -0,0 +1,639 @@
+/*
+Reader of files written by dccrg's save_grid_data() that doesn't use MPI.
+
+Copyright 2018 Finnish Meteorological Institute
+
+Dccrg is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+Dccrg is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with dccrg. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DCCRG_FILE_READER_HPP
+#define DCCRG_FILE_READER_HPP
+
+
+#include "algorithm"
+#include "cstdint"
+#include "cstring"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "unistd.h"
+
+#include "dccrg_checkpoint_codec.hpp"
+#include "dccrg_checksum.hpp"
+#include "dccrg_length.hpp"
+#include "dccrg_mapping.hpp"
+#include "dccrg_no_geometry.hpp"
+#include "dccrg_topology.hpp"
+#include "dccrg_types.hpp"
+
+
+namespace dccrg {
+
+
+/*!
+\brief Read-only view of cell data in a file written by save_grid_data().
+
+The file is memory mapped and nothing is read from it except
+the grid's metadata until used, so opening even large files is
+fast and MPI doesn't have to be initialized. The list of cells
+and cell data are accessed directly from the mapping, the only
+memory allocated in proportion to the number of cells is a sorted
+index of cells which is created only if the list of cells in the
+file consists of more than a given number of sorted runs (each
+process writes its cells in sorted order).
+
+Geometry must be the geometry class with which the file was
+written, files with compressed cell data aren't supported.
+If DCCRG_NO_MPI is defined before including this or any other
+header of dccrg mpi.h isn't included and MPI isn't linked.
+
+Example:
+\verbatim
+dccrg::File_Reader<dccrg::Cartesian_Geometry> reader;
+if (reader.open("grid.dc", sizeof(header))) {
+	const auto data = reader.get_cell_data(cell);
+	...
+}
+\endverbatim
+*/
+template<class Geometry = No_Geometry> class File_Reader
+{
+public:
+
+	//! Cell data of one cell in the file
+	struct Cell_Data_Span {
+		const uint8_t* data = nullptr;
+		uint64_t size = 0;
+	};
+
+	File_Reader() :
+		geometry(this->mapping.length, this->mapping, this->topology)
+	{}
+
+	File_Reader(const File_Reader&) = delete;
+	File_Reader& operator=(const File_Reader&) = delete;
+
+	~File_Reader()
+	{
+		this->close();
+	}
+
+
+	/*!
+	Memory maps given file and reads grid's metadata from it.
+
+	Given offset is the number of bytes before the grid's
+	metadata, i.e. the offset given to save_grid_data() plus
+	the size of the header. The skipped data can be accessed
+	with get_file_data().
+
+	If the list of cells has more than max_sorted_runs sorted
+	runs a sorted index of cells is created, otherwise get_cell_data()
+	binary searches each run.
+
+	Closes previously opened file if any.
+	Returns true on success, false otherwise.
+	*/
+	bool open(
+		const std::string& name,
+		const uint64_t offset = 0,
+		const size_t max_sorted_runs = 64
+	) {
+		this->close();
+
+		this->file_descriptor = ::open(name.c_str(), O_RDONLY);
+		if (this->file_descriptor < 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't open file " << name
+				<< std::endl;
+			return false;
+		}
+
+		struct stat file_status;
+		if (fstat(this->file_descriptor, &file_status) != 0) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't get size of file " << name
+				<< std::endl;
+			this->close();
+			return false;
+		}
+		this->file_size = uint64_t(file_status.st_size);
+
+		if (this->file_size > 0) {
+			void* const mapped = mmap(
+				nullptr,
+				size_t(this->file_size),
+				PROT_READ,
+				MAP_SHARED,
+				this->file_descriptor,
+				0
+			);
+			if (mapped == MAP_FAILED) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't memory map file " << name
+					<< std::endl;
+				this->close();
+				return false;
+			}
+			this->file_data = (const uint8_t*) mapped;
+		}
+
+		// checksums written after grid data aren't cell data
+		File_Checksums checksums;
+		this->data_end
+			= checksums.read(this->file_data, size_t(this->file_size))
+			? checksums.end
+			: this->file_size;
+
+		if (!this->read_metadata(name, offset)) {
+			this->close();
+			return false;
+		}
+
+		this->create_index(max_sorted_runs);
+
+		return true;
+	}
+
+
+	/*!
+	Unmaps and closes the file, does nothing if no file is open.
+	*/
+	void close()
+	{
+		if (this->file_data != nullptr) {
+			munmap((void*) this->file_data, size_t(this->file_size));
+			this->file_data = nullptr;
+		}
+		if (this->file_descriptor >= 0) {
+			::close(this->file_descriptor);
+			this->file_descriptor = -1;
+		}
+		this->file_size = 0;
+		this->data_end = 0;
+		this->cell_list_start = 0;
+		this->number_of_cells = 0;
+		this->sorted_runs.clear();
+		this->sorted_positions.clear();
+	}
+
+
+	/*!
+	Returns the start of the memory mapped file, nullptr if no file is open.
+	*/
+	const uint8_t* get_file_data() const
+	{
+		return this->file_data;
+	}
+
+	/*!
+	Returns the size of the open file in bytes.
+	*/
+	uint64_t get_file_size() const
+	{
+		return this->file_size;
+	}
+
+	const Mapping& get_mapping() const
+	{
+		return this->mapping;
+	}
+
+	const Grid_Topology& get_topology() const
+	{
+		return this->topology;
+	}
+
+	const Geometry& get_geometry() const
+	{
+		return this->geometry;
+	}
+
+	unsigned int get_neighborhood_length() const
+	{
+		return this->neighborhood_length;
+	}
+
+	/*!
+	Returns the number of cells in the file.
+	*/
+	uint64_t get_number_of_cells() const
+	{
+		return this->number_of_cells;
+	}
+
+
+	/*!
+	Returns the cell at given position in the file's list of cells.
+
+	Position must be less than get_number_of_cells().
+	*/
+	uint64_t get_cell(const uint64_t position) const
+	{
+		return this->read_uint64(this->cell_list_start + 2 * position * sizeof(uint64_t));
+	}
+
+	/*!
+	Returns data of the cell at given position in the file's list of cells.
+
+	Data of a cell extends to the start of next cell's data
+	or to the end of grid data for the last cell.
+	Position must be less than get_number_of_cells().
+	*/
+	Cell_Data_Span get_data(const uint64_t position) const
+	{
+		const uint64_t
+			start = this->get_data_start(position),
+			end
+				= (position + 1 < this->number_of_cells)
+				? this->get_data_start(position + 1)
+				: this->data_end;
+
+		Cell_Data_Span span;
+		if (start <= end and end <= this->data_end) {
+			span.data = this->file_data + start;
+			span.size = end - start;
+		}
+		return span;
+	}
+
+	/*!
+	Returns the position of given cell in the file's list of cells.
+
+	Returns get_number_of_cells() if the cell doesn't exist in the file.
+	*/
+	uint64_t find(const uint64_t cell) const
+	{
+		if (this->sorted_positions.size() > 0) {
+			const auto position = std::lower_bound(
+				this->sorted_positions.cbegin(),
+				this->sorted_positions.cend(),
+				cell,
+				[this](const uint64_t position, const uint64_t given_cell) {
+					return this->get_cell(position) < given_cell;
+				}
+			);
+			if (position != this->sorted_positions.cend() and this->get_cell(*position) == cell) {
+				return *position;
+			}
+			return this->number_of_cells;
+		}
+
+		for (size_t i = 0; i + 1 < this->sorted_runs.size(); i++) {
+			const uint64_t first = this->lower_bound_in_run(i, cell);
+			if (first < this->sorted_runs[i + 1] and this->get_cell(first) == cell) {
+				return first;
+			}
+		}
+
+		return this->number_of_cells;
+	}
+
+	/*!
+	Returns data of given cell.
+
+	Returned span has nullptr data if cell doesn't exist in the file.
+	*/
+	Cell_Data_Span get_cell_data(const uint64_t cell) const
+	{
+		const uint64_t position = this->find(cell);
+		if (position >= this->number_of_cells) {
+			return Cell_Data_Span();
+		}
+		return this->get_data(position);
+	}
+
+
+	/*!
+	Returns cells in the file overlapping given volume.
+
+	Volume is given as the smallest and largest indices it
+	contains, see Mapping::get_indices(), use the geometry's
+	get_indices() to get indices of coordinates. Cells are
+	returned in the order of the file's list of cells.
+	Ids of cells of one refinement level in one row of the
+	volume are contiguous so they're searched from the index
+	of cells, unless the volume has more rows than the file
+	has cells in which case the whole list of cells is scanned.
+	*/
+	std::vector<uint64_t> get_cells(
+		const Types<3>::indices_t& min_indices,
+		const Types<3>::indices_t& max_indices
+	) const {
+		std::vector<uint64_t> ret_val;
+
+		const auto& grid_length = this->mapping.length.get();
+		const int max_refinement_level = this->mapping.get_maximum_refinement_level();
+
+		Types<3>::indices_t last_indices;
+		for (size_t dimension = 0; dimension < last_indices.size(); dimension++) {
+			const uint64_t end_index = grid_length[dimension] << max_refinement_level;
+			if (
+				min_indices[dimension] > max_indices[dimension]
+				or min_indices[dimension] >= end_index
+			) {
+				return ret_val;
+			}
+			last_indices[dimension] = std::min(max_indices[dimension], end_index - 1);
+		}
+
+		// each row is searched from every sorted run
+		const uint64_t searches_per_row
+			= this->sorted_positions.size() > 0
+			? 1
+			: std::max(size_t(1), this->sorted_runs.size()) - 1;
+		uint64_t number_of_searches = 0;
+		for (int level = 0; level <= max_refinement_level; level++) {
+			const uint64_t length = uint64_t(1) << (max_refinement_level - level);
+			number_of_searches
+				+= (last_indices[1] / length - min_indices[1] / length + 1)
+				* (last_indices[2] / length - min_indices[2] / length + 1)
+				* searches_per_row;
+			if (number_of_searches >= this->number_of_cells) {
+				break;
+			}
+		}
+
+		if (number_of_searches >= this->number_of_cells) {
+			for (uint64_t i = 0; i < this->number_of_cells; i++) {
+				const uint64_t cell = this->get_cell(i);
+				const Types<3>::indices_t indices = this->mapping.get_indices(cell);
+				if (indices[0] == error_index) {
+					continue;
+				}
+				const uint64_t length = this->mapping.get_cell_length_in_indices(cell);
+
+				bool overlaps = true;
+				for (size_t dimension = 0; dimension < indices.size(); dimension++) {
+					if (
+						indices[dimension] > last_indices[dimension]
+						or indices[dimension] + length - 1 < min_indices[dimension]
+					) {
+						overlaps = false;
+						break;
+					}
+				}
+				if (overlaps) {
+					ret_val.push_back(cell);
+				}
+			}
+			return ret_val;
+		}
+
+		std::vector<uint64_t> positions;
+		for (int level = 0; level <= max_refinement_level; level++) {
+			const uint64_t length = uint64_t(1) << (max_refinement_level - level);
+			for (uint64_t z = min_indices[2] / length; z <= last_indices[2] / length; z++)
+			for (uint64_t y = min_indices[1] / length; y <= last_indices[1] / length; y++) {
+				this->add_positions(
+					this->mapping.get_cell_from_indices({{min_indices[0], y * length, z * length}}, level),
+					this->mapping.get_cell_from_indices({{last_indices[0], y * length, z * length}}, level),
+					positions
+				);
+			}
+		}
+
+		std::sort(positions.begin(), positions.end());
+		ret_val.reserve(positions.size());
+		for (const auto position: positions) {
+			ret_val.push_back(this->get_cell(position));
+		}
+
+		return ret_val;
+	}
+
+
+
+private:
+
+	int file_descriptor = -1;
+	const uint8_t* file_data = nullptr;
+	uint64_t file_size = 0;
+	// end of grid data, smaller than file_size if file has checksums
+	uint64_t data_end = 0;
+
+	Mapping mapping;
+	Grid_Topology topology;
+	Geometry geometry;
+	unsigned int neighborhood_length = 0;
+
+	uint64_t cell_list_start = 0, number_of_cells = 0;
+
+	// first position of each sorted run in list of cells and number of cells
+	std::vector<uint64_t> sorted_runs;
+	// positions in list of cells sorted by cell, empty if runs are searched
+	std::vector<uint64_t> sorted_positions;
+
+
+	uint64_t read_uint64(const uint64_t offset) const
+	{
+		uint64_t value;
+		std::memcpy(&value, this->file_data + offset, sizeof(uint64_t));
+		return value;
+	}
+
+	uint64_t get_data_start(const uint64_t position) const
+	{
+		return this->read_uint64(this->cell_list_start + (2 * position + 1) * sizeof(uint64_t));
+	}
+
+
+	/*!
+	Returns the first position in given sorted run whose cell isn't less than given cell.
+
+	Returns the end of the run if there's no such position.
+	*/
+	uint64_t lower_bound_in_run(const size_t run, const uint64_t cell) const
+	{
+		uint64_t
+			first = this->sorted_runs[run],
+			count = this->sorted_runs[run + 1] - first;
+		while (count > 0) {
+			const uint64_t step = count / 2, middle = first + step;
+			if (this->get_cell(middle) < cell) {
+				first = middle + 1;
+				count -= step + 1;
+			} else {
+				count = step;
+			}
+		}
+		return first;
+	}
+
+	/*!
+	Appends positions of cells from first to last, inclusive, to given positions.
+	*/
+	void add_positions(
+		const uint64_t first,
+		const uint64_t last,
+		std::vector<uint64_t>& positions
+	) const {
+		if (this->sorted_positions.size() > 0) {
+			for (
+				auto position = std::lower_bound(
+					this->sorted_positions.cbegin(),
+					this->sorted_positions.cend(),
+					first,
+					[this](const uint64_t position, const uint64_t given_cell) {
+						return this->get_cell(position) < given_cell;
+					}
+				);
+				position != this->sorted_positions.cend() and this->get_cell(*position) <= last;
+				position++
+			) {
+				positions.push_back(*position);
+			}
+			return;
+		}
+
+		for (size_t i = 0; i + 1 < this->sorted_runs.size(); i++) {
+			for (
+				uint64_t position = this->lower_bound_in_run(i, first);
+				position < this->sorted_runs[i + 1] and this->get_cell(position) <= last;
+				position++
+			) {
+				positions.push_back(position);
+			}
+		}
+	}
+
+
+	/*!
+	Reads metadata written by save_grid_data() starting at given offset.
+	*/
+	bool read_metadata(const std::string& name, uint64_t offset)
+	{
+		if (offset > this->file_size or this->file_size - offset < sizeof(uint64_t)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " File " << name << " is too small"
+				<< std::endl;
+			return false;
+		}
+
+		const uint64_t endianness_original = 0x1234567890abcdef;
+		if (this->read_uint64(offset) != endianness_original) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " File " << name
+				<< " has wrong endianness or offset " << offset << " is wrong"
+				<< std::endl;
+			return false;
+		}
+		offset += sizeof(uint64_t);
+
+		if (!this->mapping.read(this->file_data + offset, size_t(this->file_size - offset))) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't read mapping from file " << name
+				<< std::endl;
+			return false;
+		}
+		offset += this->mapping.data_size();
+
+		if (this->file_size - offset < sizeof(unsigned int)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " File " << name << " is too small"
+				<< std::endl;
+			return false;
+		}
+		std::memcpy(&(this->neighborhood_length), this->file_data + offset, sizeof(unsigned int));
+		offset += sizeof(unsigned int);
+
+		if (!this->topology.read(this->file_data + offset, size_t(this->file_size - offset))) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't read grid topology from file " << name
+				<< std::endl;
+			return false;
+		}
+		offset += this->topology.data_size();
+
+		if (!this->geometry.read(this->file_data + offset, size_t(this->file_size - offset))) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't read geometry from file " << name
+				<< std::endl;
+			return false;
+		}
+		offset += this->geometry.data_size();
+
+		if (this->file_size - offset < sizeof(uint64_t)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " File " << name << " is too small"
+				<< std::endl;
+			return false;
+		}
+		this->number_of_cells = this->read_uint64(offset);
+		offset += sizeof(uint64_t);
+
+		if (this->number_of_cells == compressed_cells_marker) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " File " << name << " has compressed cell data which isn't supported"
+				<< std::endl;
+			this->number_of_cells = 0;
+			return false;
+		}
+
+		if ((this->file_size - offset) / (2 * sizeof(uint64_t)) < this->number_of_cells) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " File " << name << " is too small for "
+				<< this->number_of_cells << " cells"
+				<< std::endl;
+			this->number_of_cells = 0;
+			return false;
+		}
+		this->cell_list_start = offset;
+
+		return true;
+	}
+
+
+	/*!
+	Finds sorted runs in list of cells and sorts positions if there are too many.
+	*/
+	void create_index(const size_t max_sorted_runs)
+	{
+		this->sorted_runs.clear();
+		this->sorted_positions.clear();
+
+		uint64_t previous_cell = 0;
+		for (uint64_t i = 0; i < this->number_of_cells; i++) {
+			const uint64_t cell = this->get_cell(i);
+			if (i == 0 or cell <= previous_cell) {
+				this->sorted_runs.push_back(i);
+			}
+			previous_cell = cell;
+		}
+		this->sorted_runs.push_back(this->number_of_cells);
+
+		if (this->sorted_runs.size() - 1 <= max_sorted_runs) {
+			return;
+		}
+
+		this->sorted_positions.resize(this->number_of_cells);
+		for (uint64_t i = 0; i < this->number_of_cells; i++) {
+			this->sorted_positions[i] = i;
+		}
+		std::sort(
+			this->sorted_positions.begin(),
+			this->sorted_positions.end(),
+			[this](const uint64_t a, const uint64_t b) {
+				return this->get_cell(a) < this->get_cell(b);
+			}
+		);
+	}
+};
+
+}	// namespace
+
+#endif
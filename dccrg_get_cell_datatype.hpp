@@ -22,7 +22,10 @@ along with dccrg. If not, see <http://www.gnu.org/licenses/>.
 #define DCCRG_GET_CELL_DATATYPE_HPP
 
 
+#include "array"
 #include "cstdint"
+#include "cstdlib"
+#include "iostream"
 #include "tuple"
 #include "type_traits"
 
@@ -32,6 +35,8 @@ along with dccrg. If not, see <http://www.gnu.org/licenses/>.
 #include "boost/mpl/vector.hpp"
 #include "boost/tti/has_member_function.hpp"
 
+#include "dccrg_mpi_support.hpp"
+
 
 namespace dccrg {
 namespace detail {
@@ -339,6 +344,378 @@ template<
 }
 
 
+/*!
+Whether MPI transfer info of Cell_Data can be cached.
+
+True if the address, count and datatype returned by
+get_cell_mpi_datatype() for a cell don't change as long
+as the cell itself isn't moved in memory.
+Cell_Data declares this with a static member, e.g.:
+\verbatim
+struct Cell {
+	static constexpr bool stable_mpi_datatype = true;
+	...
+};
+\endverbatim
+Supported built-in types and std::arrays of them are always stable.
+*/
+template<
+	class Cell_Data,
+	class Enable = void
+> struct has_stable_mpi_datatype :
+	std::integral_constant<bool, std::is_arithmetic<Cell_Data>::value>
+{};
+
+template<
+	class Cell_Data,
+	size_t N
+> struct has_stable_mpi_datatype<std::array<Cell_Data, N>, void> :
+	std::integral_constant<bool, std::is_arithmetic<Cell_Data>::value>
+{};
+
+template<
+	class Cell_Data
+> struct has_stable_mpi_datatype<
+	Cell_Data,
+	typename std::enable_if<Cell_Data::stable_mpi_datatype>::type
+> :
+	std::true_type
+{};
+
+
+BOOST_TTI_HAS_MEMBER_FUNCTION(get_packed_size)
+BOOST_TTI_HAS_MEMBER_FUNCTION(pack)
+BOOST_TTI_HAS_MEMBER_FUNCTION(unpack)
+
+/*!
+Whether Cell_Data packs its own data for packed transfers.
+
+True if Cell_Data has all of:
+\verbatim
+size_t get_packed_size() const;
+void pack(char* buffer) const;
+void unpack(const char* buffer);
+\endverbatim
+unpack() can change the size of a copy of a remote cell,
+after unpack() get_packed_size() must return the number of
+bytes unpacked, i.e. packed by the owner of the cell.
+Otherwise get_mpi_datatype() is used with MPI_Pack.
+*/
+template<class Cell_Data> struct has_pack_hooks :
+	std::integral_constant<
+		bool,
+		has_member_function_get_packed_size<
+			Cell_Data,
+			size_t,
+			boost::mpl::vector<>,
+			boost::function_types::const_qualified
+		>::value
+		and has_member_function_pack<
+			Cell_Data,
+			void,
+			boost::mpl::vector<char*>,
+			boost::function_types::const_qualified
+		>::value
+		and has_member_function_unpack<
+			Cell_Data,
+			void,
+			boost::mpl::vector<const char*>
+		>::value
+	>
+{};
+
+
+/*!
+Returns the maximum number of bytes given cell's data takes when packed.
+
+Version for cell with pack hooks.
+*/
+template<
+	class Cell_Data
+> typename std::enable_if<
+	has_pack_hooks<Cell_Data>::value,
+	int
+>::type get_cell_packed_size(
+	const Cell_Data& cell,
+	const uint64_t /*cell_id*/,
+	const int /*sender*/,
+	const int /*receiver*/,
+	const bool /*receiving*/,
+	const int /*neighborhood_id*/,
+	MPI_Comm /*comm*/
+) {
+	return int(cell.get_packed_size());
+}
+
+/*!
+Returns the maximum number of bytes given cell's data takes when packed.
+
+Version for cell without pack hooks, uses MPI_Pack_size.
+*/
+template<
+	class Cell_Data
+> typename std::enable_if<
+	not has_pack_hooks<Cell_Data>::value,
+	int
+>::type get_cell_packed_size(
+	Cell_Data& cell,
+	const uint64_t cell_id,
+	const int sender,
+	const int receiver,
+	const bool receiving,
+	const int neighborhood_id,
+	MPI_Comm comm
+) {
+	void* address = NULL;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = get_cell_mpi_datatype(
+		cell, cell_id, sender, receiver, receiving, neighborhood_id
+	);
+
+	const bool is_named_datatype = Is_Named_Datatype()(datatype);
+	if (!is_named_datatype) {
+		MPI_Type_commit(&datatype);
+	}
+
+	int size = -1;
+	const int ret_val = MPI_Pack_size(count, datatype, comm, &size);
+	if (ret_val != MPI_SUCCESS) {
+		std::cerr << __FILE__ << ":" << __LINE__
+			<< " MPI_Pack_size failed for cell " << cell_id
+			<< ": " << Error_String()(ret_val)
+			<< std::endl;
+		abort();
+	}
+
+	if (!is_named_datatype) {
+		MPI_Type_free(&datatype);
+	}
+
+	return size;
+}
+
+
+/*!
+Returns the number of bytes in given cell's data described by get_mpi_datatype().
+*/
+template<
+	class Cell_Data
+> uint64_t get_cell_transfer_size(
+	Cell_Data& cell,
+	const uint64_t cell_id,
+	const int sender,
+	const int receiver,
+	const bool receiving,
+	const int neighborhood_id
+) {
+	void* address = NULL;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = get_cell_mpi_datatype(
+		cell, cell_id, sender, receiver, receiving, neighborhood_id
+	);
+
+	int size = 0;
+	const int ret_val = MPI_Type_size(datatype, &size);
+	if (ret_val != MPI_SUCCESS) {
+		std::cerr << __FILE__ << ":" << __LINE__
+			<< " MPI_Type_size failed for cell " << cell_id
+			<< ": " << Error_String()(ret_val)
+			<< std::endl;
+		abort();
+	}
+
+	if (!Is_Named_Datatype()(datatype)) {
+		MPI_Type_free(&datatype);
+	}
+
+	return uint64_t(count) * uint64_t(size);
+}
+
+
+/*!
+Packs given cell's data into buffer starting at position.
+
+Version for cell with pack hooks.
+Position is incremented by the number of bytes packed.
+Aborts if cell's data doesn't fit into buffer.
+*/
+template<
+	class Cell_Data
+> typename std::enable_if<
+	has_pack_hooks<Cell_Data>::value
+>::type pack_cell(
+	const Cell_Data& cell,
+	const uint64_t cell_id,
+	const int /*sender*/,
+	const int /*receiver*/,
+	const int /*neighborhood_id*/,
+	MPI_Comm /*comm*/,
+	char* buffer,
+	const int buffer_size,
+	int& position
+) {
+	const uint64_t size = cell.get_packed_size();
+	if (uint64_t(position) + size > uint64_t(buffer_size)) {
+		std::cerr << __FILE__ << ":" << __LINE__
+			<< " Packed data of cell " << cell_id
+			<< " (" << size << " bytes) doesn't fit into buffer of " << buffer_size
+			<< " bytes at position " << position
+			<< std::endl;
+		abort();
+	}
+
+	cell.pack(buffer + position);
+	position += int(size);
+}
+
+/*!
+Packs given cell's data into buffer starting at position.
+
+Version for cell without pack hooks, uses MPI_Pack.
+*/
+template<
+	class Cell_Data
+> typename std::enable_if<
+	not has_pack_hooks<Cell_Data>::value
+>::type pack_cell(
+	Cell_Data& cell,
+	const uint64_t cell_id,
+	const int sender,
+	const int receiver,
+	const int neighborhood_id,
+	MPI_Comm comm,
+	char* buffer,
+	const int buffer_size,
+	int& position
+) {
+	void* address = NULL;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = get_cell_mpi_datatype(
+		cell, cell_id, sender, receiver, false, neighborhood_id
+	);
+
+	const bool is_named_datatype = Is_Named_Datatype()(datatype);
+	if (!is_named_datatype) {
+		MPI_Type_commit(&datatype);
+	}
+
+	const int ret_val = MPI_Pack(
+		address, count, datatype, buffer, buffer_size, &position, comm
+	);
+	if (ret_val != MPI_SUCCESS) {
+		std::cerr << __FILE__ << ":" << __LINE__
+			<< " MPI_Pack failed for cell " << cell_id
+			<< ": " << Error_String()(ret_val)
+			<< std::endl;
+		abort();
+	}
+
+	if (!is_named_datatype) {
+		MPI_Type_free(&datatype);
+	}
+}
+
+
+/*!
+Unpacks given cell's data from buffer starting at position.
+
+Version for cell with pack hooks.
+Position is incremented by get_packed_size() after unpacking
+because unpack() can change the size of cell's data.
+Aborts if no data is left in buffer or if unpacked data
+extends past the end of buffer.
+*/
+template<
+	class Cell_Data
+> typename std::enable_if<
+	has_pack_hooks<Cell_Data>::value
+>::type unpack_cell(
+	Cell_Data& cell,
+	const uint64_t cell_id,
+	const int /*sender*/,
+	const int /*receiver*/,
+	const int /*neighborhood_id*/,
+	MPI_Comm /*comm*/,
+	char* buffer,
+	const int buffer_size,
+	int& position
+) {
+	if (position > buffer_size) {
+		std::cerr << __FILE__ << ":" << __LINE__
+			<< " No data left for cell " << cell_id
+			<< " in buffer of " << buffer_size
+			<< " bytes at position " << position
+			<< std::endl;
+		abort();
+	}
+
+	cell.unpack(buffer + position);
+
+	const uint64_t size = cell.get_packed_size();
+	if (uint64_t(position) + size > uint64_t(buffer_size)) {
+		std::cerr << __FILE__ << ":" << __LINE__
+			<< " Unpacked data of cell " << cell_id
+			<< " (" << size << " bytes) extends past buffer of " << buffer_size
+			<< " bytes at position " << position
+			<< ", do sender and receiver agree on its size?"
+			<< std::endl;
+		abort();
+	}
+	position += int(size);
+}
+
+/*!
+Unpacks given cell's data from buffer starting at position.
+
+Version for cell without pack hooks, uses MPI_Unpack.
+*/
+template<
+	class Cell_Data
+> typename std::enable_if<
+	not has_pack_hooks<Cell_Data>::value
+>::type unpack_cell(
+	Cell_Data& cell,
+	const uint64_t cell_id,
+	const int sender,
+	const int receiver,
+	const int neighborhood_id,
+	MPI_Comm comm,
+	char* buffer,
+	const int buffer_size,
+	int& position
+) {
+	void* address = NULL;
+	int count = -1;
+	MPI_Datatype datatype = MPI_DATATYPE_NULL;
+	std::tie(address, count, datatype) = get_cell_mpi_datatype(
+		cell, cell_id, sender, receiver, true, neighborhood_id
+	);
+
+	const bool is_named_datatype = Is_Named_Datatype()(datatype);
+	if (!is_named_datatype) {
+		MPI_Type_commit(&datatype);
+	}
+
+	const int ret_val = MPI_Unpack(
+		buffer, buffer_size, &position, address, count, datatype, comm
+	);
+	if (ret_val != MPI_SUCCESS) {
+		std::cerr << __FILE__ << ":" << __LINE__
+			<< " MPI_Unpack failed for cell " << cell_id
+			<< ": " << Error_String()(ret_val)
+			<< std::endl;
+		abort();
+	}
+
+	if (!is_named_datatype) {
+		MPI_Type_free(&datatype);
+	}
+}
+
+
 }} // namespaces
 
 #endif
@@ -24,10 +24,13 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "array"
 #include "cmath"
 #include "cstdint"
+#include "cstring"
 #include "iostream"
 
 #include "dccrg_length.hpp"
+#ifndef DCCRG_NO_MPI
 #include "dccrg_mpi_support.hpp"
+#endif
 #include "dccrg_types.hpp"
 
 
@@ -479,6 +482,7 @@ public:
 	typedef std::array<uint8_t, 3> mapping_file_data_t;
 
 
+	#ifndef DCCRG_NO_MPI
 	/*!
 	Reads the mapping from given open file starting at given offset.
 
@@ -539,8 +543,48 @@ public:
 
 		return true;
 	}
+	#endif
+
+
+	/*!
+	Reads the mapping from given data in memory.
+
+	Given data must be in the format written by write(),
+	given size is the number of bytes available in data.
+	Returns true on success, false otherwise.
+	*/
+	bool read(const uint8_t* const data, const size_t size)
+	{
+		if (size < this->data_size()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Not enough data for mapping: " << size
+				<< std::endl;
+			return false;
+		}
+
+		Grid_Length::type length = {{0, 0, 0}};
+		std::memcpy(length.data(), data, sizeof(Grid_Length::type));
+		if (!this->set_length(length)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't set length of grid"
+				<< std::endl;
+			return false;
+		}
+
+		int max_ref_lvl = -1;
+		std::memcpy(&max_ref_lvl, data + sizeof(Grid_Length::type), sizeof(int));
+		if (!this->set_maximum_refinement_level(max_ref_lvl)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< "Couldn't set maximum refinement level to " << max_ref_lvl
+				<< std::endl;
+			return false;
+		}
+
+		return true;
+	}
 
 
+	#ifndef DCCRG_NO_MPI
 	/*!
 	Writes the mapping into given open file starting at given offset.
 
@@ -584,6 +628,7 @@ public:
 
 		return true;
 	}
+	#endif
 
 
 	/*!
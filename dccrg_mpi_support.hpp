@@ -25,6 +25,7 @@ along with dccrg. If not, see <http://www.gnu.org/licenses/>.
 #include "cstdint"
 #include "cstdlib"
 #include "iostream"
+#include "limits"
 #include "mpi.h"
 #include "string"
 #include "unordered_map"
@@ -92,6 +93,52 @@ public:
 };
 
 
+/*!
+\brief Returns a committed datatype of given number of contiguous bytes.
+
+Can represent more than INT_MAX bytes with a count of 1,
+returned datatype must be freed with MPI_Type_free.
+*/
+class Byte_Datatype
+{
+public:
+
+	MPI_Datatype operator()(const uint64_t size) const
+	{
+		const uint64_t chunk_size = uint64_t(1) << 30;
+		const uint64_t
+			chunks = size / chunk_size,
+			remainder = size % chunk_size;
+
+		MPI_Datatype chunk = MPI_DATATYPE_NULL, chunks_type = MPI_DATATYPE_NULL, result = MPI_DATATYPE_NULL;
+		int ret_val = MPI_Type_contiguous(int(chunk_size), MPI_BYTE, &chunk);
+		if (ret_val == MPI_SUCCESS) {
+			ret_val = MPI_Type_contiguous(int(chunks), chunk, &chunks_type);
+		}
+		if (ret_val == MPI_SUCCESS) {
+			int block_lengths[2] = {1, int(remainder)};
+			MPI_Aint displacements[2] = {0, MPI_Aint(chunks * chunk_size)};
+			MPI_Datatype datatypes[2] = {chunks_type, MPI_BYTE};
+			ret_val = MPI_Type_create_struct(2, block_lengths, displacements, datatypes, &result);
+		}
+		if (ret_val == MPI_SUCCESS) {
+			ret_val = MPI_Type_commit(&result);
+		}
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't create datatype of " << size << " bytes: "
+				<< Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+		MPI_Type_free(&chunks_type);
+		MPI_Type_free(&chunk);
+
+		return result;
+	}
+};
+
+
 /*!
 \brief Wrapper for MPI_Allgatherv(..., uint64_t, ...).
 */
@@ -187,6 +234,8 @@ public:
 
 		if(total_send_count == 0) {
 			//Early abort if there is nothing to communicate.
+			result.clear();
+			result.resize(comm_size);
 			return;
 		}
 		std::vector<uint64_t> temp_result(total_send_count, std::numeric_limits<uint64_t>::max());
@@ -235,6 +284,131 @@ public:
 };
 
 
+/*!
+\brief Wrapper for MPI_Alltoallv(..., uint64_t, ...).
+*/
+class All_To_All
+{
+public:
+
+	/*!
+	Sends values[i] to process i and stores values received from process i into result[i].
+
+	values must have one item for every process in comm.
+	result is cleared before use, values and comm are not changed.
+	*/
+	void operator()(
+		const std::vector<std::vector<uint64_t>>& values,
+		std::vector<std::vector<uint64_t>>& result,
+		MPI_Comm& comm
+	) {
+		int comm_size;
+		if (MPI_Comm_size(comm, &comm_size) != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
+			abort();
+		}
+
+		if (values.size() != (size_t) comm_size) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Number of value lists (" << values.size()
+				<< ") differs from number of processes (" << comm_size
+				<< ")"
+				<< std::endl;
+			abort();
+		}
+
+		std::vector<int>
+			send_counts(comm_size, 0),
+			receive_counts(comm_size, 0),
+			send_displacements(comm_size, 0),
+			receive_displacements(comm_size, 0);
+
+		for (size_t i = 0; i < values.size(); i++) {
+			if (values[i].size() > INT_MAX) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Tried to send more values than INT_MAX."
+					<< std::endl;
+				abort();
+			}
+			send_counts[i] = int(values[i].size());
+		}
+
+		const int ret_val = MPI_Alltoall(
+			send_counts.data(),
+			1,
+			MPI_INT,
+			receive_counts.data(),
+			1,
+			MPI_INT,
+			comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Alltoall failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+
+		uint64_t total_send_count = 0, total_receive_count = 0;
+		for (size_t i = 0; i < (size_t) comm_size; i++) {
+			if (i > 0) {
+				send_displacements[i] = send_displacements[i - 1] + send_counts[i - 1];
+				receive_displacements[i] = receive_displacements[i - 1] + receive_counts[i - 1];
+			}
+			total_send_count += (uint64_t) send_counts[i];
+			total_receive_count += (uint64_t) receive_counts[i];
+		}
+
+		if (total_send_count > INT_MAX || total_receive_count > INT_MAX) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Tried to transfer more values than INT_MAX."
+				<< std::endl;
+			abort();
+		}
+
+		// give sane addresses to alltoallv also when nothing to transfer
+		std::vector<uint64_t>
+			temp_send(total_send_count + 1),
+			temp_receive(total_receive_count + 1);
+
+		for (size_t i = 0; i < values.size(); i++) {
+			std::copy(
+				values[i].begin(),
+				values[i].end(),
+				temp_send.begin() + send_displacements[i]
+			);
+		}
+
+		const int ret_val2 = MPI_Alltoallv(
+			temp_send.data(),
+			send_counts.data(),
+			send_displacements.data(),
+			MPI_UINT64_T,
+			temp_receive.data(),
+			receive_counts.data(),
+			receive_displacements.data(),
+			MPI_UINT64_T,
+			comm
+		);
+		if (ret_val2 != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Alltoallv failed: " << Error_String()(ret_val2)
+				<< std::endl;
+			abort();
+		}
+
+		result.clear();
+		result.resize(comm_size);
+		for (size_t i = 0; i < (size_t) comm_size; i++) {
+			result[i].assign(
+				temp_receive.begin() + receive_displacements[i],
+				temp_receive.begin() + receive_displacements[i] + receive_counts[i]
+			);
+		}
+	}
+};
+
+
 /*!
 \brief Wrapper for MPI_Allreduce(uint64_t, ..., MPI_SUM).
 */
@@ -380,6 +554,185 @@ public:
 
 }; // class
 
+
+/*!
+\brief Similar to All_To_All but communicates only with processes given in neighbors.
+
+Sends values[i] to process i and stores values received from
+process i into result[i] for every process i in neighbors.
+Aborts if values has non-empty values for a process not in neighbors.
+Given neighbors must not include the process itself.
+Any pair of processes in the given communicator either must or must not have each
+other in neighbors.
+result is cleared before use, values and comm are not changed.
+Uses tags 2 and 3 so messages of other point-to-point communication
+in the given communicator might be received instead, give
+a communicator reserved for this class, e.g. a duplicate.
+*/
+class Some_To_Some
+{
+public:
+
+	void operator()(
+		const std::unordered_map<int, std::vector<uint64_t>>& values,
+		const std::unordered_set<int>& neighbors,
+		std::unordered_map<int, std::vector<uint64_t>>& result,
+		MPI_Comm& comm
+	) {
+		result.clear();
+
+		for (const auto& item: values) {
+			if (item.second.size() > 0 and neighbors.count(item.first) == 0) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Values given for process " << item.first
+					<< " which isn't a neighbor"
+					<< std::endl;
+				abort();
+			}
+		}
+
+		std::unordered_map<int, uint64_t> send_counts, receive_counts;
+		for (const int process: neighbors) {
+			send_counts[process] = values.count(process) > 0 ? values.at(process).size() : 0;
+			receive_counts[process] = 0;
+		}
+
+		// exchange counts
+		std::vector<MPI_Request> requests;
+		requests.reserve(2 * neighbors.size());
+		for (const int process: neighbors) {
+			requests.push_back(MPI_REQUEST_NULL);
+			const int ret_val = MPI_Irecv(
+				&(receive_counts.at(process)),
+				1,
+				MPI_UINT64_T,
+				process,
+				2,
+				comm,
+				&(requests.back())
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Irecv from process " << process
+					<< " failed: " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
+		for (const int process: neighbors) {
+			requests.push_back(MPI_REQUEST_NULL);
+			const int ret_val = MPI_Isend(
+				&(send_counts.at(process)),
+				1,
+				MPI_UINT64_T,
+				process,
+				2,
+				comm,
+				&(requests.back())
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Isend to process " << process
+					<< " failed: " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
+		this->wait(requests);
+
+		// exchange values
+		for (const int process: neighbors) {
+			const uint64_t count = receive_counts.at(process);
+			if (count == 0) {
+				continue;
+			}
+			if (count > INT_MAX) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Tried to receive more values than INT_MAX."
+					<< std::endl;
+				abort();
+			}
+
+			auto& received = result[process];
+			received.resize(count);
+			requests.push_back(MPI_REQUEST_NULL);
+			const int ret_val = MPI_Irecv(
+				received.data(),
+				int(count),
+				MPI_UINT64_T,
+				process,
+				3,
+				comm,
+				&(requests.back())
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Irecv from process " << process
+					<< " failed: " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
+		for (const int process: neighbors) {
+			const uint64_t count = send_counts.at(process);
+			if (count == 0) {
+				continue;
+			}
+			if (count > INT_MAX) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Tried to send more values than INT_MAX."
+					<< std::endl;
+				abort();
+			}
+
+			requests.push_back(MPI_REQUEST_NULL);
+			// TODO: make address const when MPI is const correct
+			const int ret_val = MPI_Isend(
+				const_cast<uint64_t*>(values.at(process).data()),
+				int(count),
+				MPI_UINT64_T,
+				process,
+				3,
+				comm,
+				&(requests.back())
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Isend to process " << process
+					<< " failed: " << Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+		}
+		this->wait(requests);
+	}
+
+
+private:
+
+	//! Waits for and clears given requests.
+	void wait(std::vector<MPI_Request>& requests)
+	{
+		if (requests.size() == 0) {
+			return;
+		}
+
+		const int ret_val = MPI_Waitall(
+			int(requests.size()),
+			requests.data(),
+			MPI_STATUSES_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Waitall failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+		requests.clear();
+	}
+
+}; // class
+
 } // namespace
 
 #endif
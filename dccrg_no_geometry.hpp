@@ -24,14 +24,19 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "cmath"
 #include "cstdint"
 #include "cstdlib"
+#include "cstring"
 #include "iostream"
 #include "limits"
+#ifndef DCCRG_NO_MPI
 #include "mpi.h"
+#endif
 #include "vector"
 
 #include "dccrg_length.hpp"
 #include "dccrg_mapping.hpp"
+#ifndef DCCRG_NO_MPI
 #include "dccrg_mpi_support.hpp"
+#endif
 #include "dccrg_topology.hpp"
 
 
@@ -475,6 +480,7 @@ public:
 	}
 
 
+	#ifndef DCCRG_NO_MPI
 	/*!
 	Writes the geometry into given open file starting at given offset.
 
@@ -539,6 +545,37 @@ public:
 
 		return true;
 	}
+	#endif
+
+
+	/*!
+	Reads the geometry from given data in memory.
+
+	Given data must be in the format written by write(),
+	given size is the number of bytes available in data.
+	Returns true on success, false otherwise.
+	*/
+	bool read(const uint8_t* const data, const size_t size) const
+	{
+		if (size < sizeof(int)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Not enough data for geometry: " << size
+				<< std::endl;
+			return false;
+		}
+
+		int read_geometry_id = No_Geometry::geometry_id + 1;
+		std::memcpy(&read_geometry_id, data, sizeof(int));
+		if (read_geometry_id != No_Geometry::geometry_id) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong geometry: " << read_geometry_id
+				<< ", should be " << No_Geometry::geometry_id
+				<< std::endl;
+			return false;
+		}
+
+		return true;
+	}
 
 
 	/*!
@@ -26,6 +26,7 @@ along with this dccrg. If not, see <http://www.gnu.org/licenses/>.
 #include "cmath"
 #include "cstdint"
 #include "cstdlib"
+#include "cstring"
 #include "iostream"
 #include "limits"
 #include "vector"
@@ -641,6 +642,7 @@ public:
 	}
 
 
+	#ifndef DCCRG_NO_MPI
 	/*!
 	Writes the geometry into given open file starting at given offset.
 
@@ -798,6 +800,63 @@ public:
 
 		return true;
 	}
+	#endif
+
+
+	/*!
+	Reads the geometry from given data in memory.
+
+	Given data must be in the format written by write(),
+	given size is the number of bytes available in data.
+	Returns true on success, false otherwise.
+	*/
+	bool read(const uint8_t* const data, const size_t size)
+	{
+		size_t offset = sizeof(int) + 3 * sizeof(uint64_t);
+		if (size < offset) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Not enough data for geometry: " << size
+				<< std::endl;
+			return false;
+		}
+
+		int read_geometry_id = Stretched_Cartesian_Geometry::geometry_id + 1;
+		std::memcpy(&read_geometry_id, data, sizeof(int));
+		if (read_geometry_id != Stretched_Cartesian_Geometry::geometry_id) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong geometry: " << read_geometry_id
+				<< ", should be " << Stretched_Cartesian_Geometry::geometry_id
+				<< std::endl;
+			return false;
+		}
+
+		std::array<uint64_t, 3> number_of_coordinates = {{0, 0, 0}};
+		std::memcpy(number_of_coordinates.data(), data + sizeof(int), 3 * sizeof(uint64_t));
+
+		Parameters read_parameters;
+		for (size_t dimension = 0; dimension < this->parameters.coordinates.size(); dimension++) {
+			if ((size - offset) / sizeof(double) < number_of_coordinates[dimension]) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Not enough data for coordinates in dimension " << dimension
+					<< std::endl;
+				return false;
+			}
+
+			read_parameters.coordinates[dimension].resize(number_of_coordinates[dimension]);
+			std::memcpy(
+				read_parameters.coordinates[dimension].data(),
+				data + offset,
+				number_of_coordinates[dimension] * sizeof(double)
+			);
+			offset += number_of_coordinates[dimension] * sizeof(double);
+		}
+
+		if (!this->set(read_parameters)) {
+			return false;
+		}
+
+		return true;
+	}
 
 
 	/*!
@@ -0,0 +1,288 @@
+/*
+Thread pool for processing cells of dccrg with several threads.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DCCRG_THREAD_POOL_HPP
+#define DCCRG_THREAD_POOL_HPP
+
+
+#include "algorithm"
+#include "atomic"
+#include "condition_variable"
+#include "cstdint"
+#include "exception"
+#include "functional"
+#include "iterator"
+#include "memory"
+#include "mutex"
+#include "stdexcept"
+#include "string"
+#include "thread"
+#include "vector"
+
+
+namespace dccrg {
+
+
+/*!
+\brief Runs a function for items of a range with several threads.
+
+Ranges are split into chunks of consecutive items, e.g. cells
+in the order of dccrg's local_cells, so that threads usually
+process cells that are close to each other in the grid.
+Idle threads take the next unprocessed chunk so threads
+that finish early do the work of slower ones.
+
+Only one range can be processed at a time.
+Member functions must be called from the thread that
+created the pool, which also processes chunks in wait().
+
+Example:
+\verbatim
+typedef dccrg::Dccrg<Cell_Data> Grid;
+Grid grid;
+...
+dccrg::Thread_Pool pool(4);
+pool.parallel_for(grid.local_cells, [](const Grid::cells_item_t& cell) {
+	cell.data->...
+});
+\endverbatim
+\see Dccrg::process_cells_with_remote_neighbor_updates()
+*/
+class Thread_Pool
+{
+public:
+
+	/*!
+	Creates given number of threads in total including the calling one.
+
+	Uses std::thread::hardware_concurrency() threads by default.
+	*/
+	explicit Thread_Pool(size_t number_of_threads = 0)
+	{
+		if (number_of_threads == 0) {
+			number_of_threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (size_t i = 1; i < number_of_threads; i++) {
+			this->workers.emplace_back(&Thread_Pool::work, this);
+		}
+	}
+
+	~Thread_Pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->job_available.notify_all();
+		for (auto& worker: this->workers) {
+			worker.join();
+		}
+	}
+
+	Thread_Pool(const Thread_Pool&) = delete;
+	Thread_Pool& operator=(const Thread_Pool&) = delete;
+
+
+	//! Returns the number of threads including the calling one.
+	size_t size() const
+	{
+		return this->workers.size() + 1;
+	}
+
+
+	/*!
+	Starts calling function for every item of given range and returns.
+
+	Function is called with a const reference to each item,
+	by other threads of the pool in any order and concurrently.
+	Range must have random access begin() and end() and
+	must not change before wait() returns.
+
+	Each chunk has chunk_size items, by default range
+	is split into 8 chunks per thread.
+	If function throws remaining chunks are skipped and
+	the first exception is rethrown by wait().
+
+	Throws std::logic_error if previous range hasn't been waited for.
+	*/
+	template<class Range, class Function> void start(
+		const Range& range,
+		Function function,
+		size_t chunk_size = 0
+	) {
+		if (this->job) {
+			throw std::logic_error(
+				__FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Previous range is still being processed"
+			);
+		}
+
+		const auto begin = range.begin();
+		const size_t number_of_items = size_t(std::distance(begin, range.end()));
+		if (number_of_items == 0) {
+			return;
+		}
+		if (chunk_size == 0) {
+			chunk_size = std::max(size_t(1), number_of_items / (8 * this->size()));
+		}
+
+		auto new_job = std::make_shared<Job>();
+		new_job->number_of_chunks = (number_of_items + chunk_size - 1) / chunk_size;
+		new_job->process_chunk = [=](const size_t chunk) {
+			const size_t first = chunk * chunk_size;
+			const size_t last = std::min(first + chunk_size, number_of_items);
+			auto item = begin;
+			std::advance(item, first);
+			for (size_t i = first; i < last; i++, item++) {
+				function(*item);
+			}
+		};
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->job = new_job;
+			this->generation++;
+		}
+		this->job_available.notify_all();
+	}
+
+
+	/*!
+	Processes remaining chunks of range given to start() and returns when all are done.
+
+	Returns immediately if no range is being processed.
+	Rethrows the first exception thrown by function of start()
+	in any thread after all threads have stopped processing
+	the range, after which another range can be started.
+	*/
+	void wait()
+	{
+		if (not this->job) {
+			return;
+		}
+
+		this->run(*this->job);
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->job_finished.wait(lock, [this]() {
+			return this->job->finished_chunks == this->job->number_of_chunks;
+		});
+		const std::exception_ptr exception = this->job->exception;
+		this->job.reset();
+		lock.unlock();
+
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+
+
+	/*!
+	Calls function for every item of given range and returns when done.
+
+	Calling thread also processes the range.
+	\see start()
+	*/
+	template<class Range, class Function> void parallel_for(
+		const Range& range,
+		Function function,
+		const size_t chunk_size = 0
+	) {
+		this->start(range, function, chunk_size);
+		this->wait();
+	}
+
+
+private:
+
+	struct Job {
+		std::function<void(const size_t)> process_chunk;
+		size_t number_of_chunks = 0;
+		std::atomic<size_t> next_chunk{0}, finished_chunks{0};
+		// first exception thrown by process_chunk, guarded by mutex
+		std::exception_ptr exception;
+		std::atomic<bool> failed{false};
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable job_available, job_finished;
+	std::shared_ptr<Job> job;
+	// incremented for every new job so workers don't repeat one
+	uint64_t generation = 0;
+	bool stopping = false;
+
+
+	/*!
+	Processes chunks of given job until none are left.
+
+	Exceptions are stored in the job instead of terminating
+	the program, after which chunks are only counted.
+	*/
+	void run(Job& current)
+	{
+		size_t chunk = current.next_chunk++;
+		while (chunk < current.number_of_chunks) {
+			if (not current.failed) {
+				try {
+					current.process_chunk(chunk);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(this->mutex);
+					if (not current.exception) {
+						current.exception = std::current_exception();
+					}
+					current.failed = true;
+				}
+			}
+			if (++current.finished_chunks == current.number_of_chunks) {
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->job_finished.notify_all();
+			}
+			chunk = current.next_chunk++;
+		}
+	}
+
+	//! Main loop of worker threads.
+	void work()
+	{
+		uint64_t processed_generation = 0;
+		while (true) {
+			std::shared_ptr<Job> current;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->job_available.wait(lock, [&]() {
+					return this->stopping or this->generation != processed_generation;
+				});
+				if (this->stopping) {
+					return;
+				}
+				processed_generation = this->generation;
+				current = this->job;
+			}
+			if (current) {
+				this->run(*current);
+			}
+		}
+	}
+};
+
+
+} // namespace
+
+#endif
@@ -23,8 +23,12 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 
 #include "array"
+#include "cstdint"
+#include "iostream"
 
+#ifndef DCCRG_NO_MPI
 #include "dccrg_mpi_support.hpp"
+#endif
 
 
 namespace dccrg {
@@ -99,6 +103,7 @@ public:
 	typedef std::array<uint8_t, 3> topology_file_data_t;
 
 
+	#ifndef DCCRG_NO_MPI
 	/*!
 	Reads the topology from given open file starting at given offset.
 
@@ -134,8 +139,40 @@ public:
 
 		return true;
 	}
+	#endif
+
+
+	/*!
+	Reads the topology from given data in memory.
+
+	Given data must be in the format written by write(),
+	given size is the number of bytes available in data.
+	Returns true on success, false otherwise.
+	*/
+	bool read(const uint8_t* const data, const size_t size)
+	{
+		if (size < this->data_size()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Not enough data for topology: " << size
+				<< std::endl;
+			return false;
+		}
+
+		for (size_t dimension = 0; dimension < this->periodic.size(); dimension++) {
+			const bool is_periodic = (data[dimension] > 0) ? true : false;
+			if (!this->set_periodicity(dimension, is_periodic)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Couldn't set periodicity in dimension: " << dimension
+					<< std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
 
 
+	#ifndef DCCRG_NO_MPI
 	/*!
 	Writes the topology into given open file starting at given offset.
 
@@ -171,6 +208,7 @@ public:
 
 		return true;
 	}
+	#endif
 
 
 	/*!
@@ -0,0 +1,438 @@
+/*
+Parallel writer of dccrg grids in XDMF format.
+
+Copyright 2018 Finnish Meteorological Institute
+
+Dccrg is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+Dccrg is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with dccrg. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DCCRG_XDMF_WRITER_HPP
+#define DCCRG_XDMF_WRITER_HPP
+
+
+#include "array"
+#include "climits"
+#include "cstdint"
+#include "fstream"
+#include "functional"
+#include "iomanip"
+#include "iostream"
+#include "stdexcept"
+#include "string"
+#include "vector"
+
+#include "mpi.h"
+
+#include "dccrg_mpi_support.hpp"
+
+
+namespace dccrg {
+
+
+/*!
+\brief Writes local cells of a grid into XDMF files in parallel.
+
+Every call to write() creates a binary file with all cell data
+and a small XML file describing it, written only by process 0,
+which can be opened e.g. in ParaView or VisIt. Binary data is
+written with collective MPI-IO so each process writes only the
+data of its own cells into one file.
+
+Every cell is written as a hexahedron whose corners are obtained
+from the grid's Geometry::get_min() and get_max() and cell data is
+converted to fields with callbacks given to add_field(). Cell
+corners and connectivity are written only when local cells differ
+from the previous call, otherwise the XML file refers to the binary
+file of the earliest call with the same cells, so keep binary files
+of earlier calls while their XML files are used. Binary files
+are referred to without directory so XML and binary files of all
+calls must be in the same directory.
+
+Example:
+\verbatim
+dccrg::Xdmf_Writer<Grid> writer;
+writer.add_field("density", 1, [](const Grid::cells_item_t& cell, double* values) {
+	values[0] = cell.data->density();
+});
+for (step...) {
+	...
+	if (step % 10 == 0) {
+		writer.write(grid, "output_" + std::to_string(step), time);
+	}
+}
+\endverbatim
+*/
+template<class Grid> class Xdmf_Writer
+{
+public:
+
+	/*!
+	Sets values of a field for given cell.
+
+	Values has room for the number of components given to add_field().
+	*/
+	typedef std::function<void(const typename Grid::cells_item_t&, double* const)> field_function_t;
+
+
+	/*!
+	Adds a field of given name and number of components written for every cell.
+
+	Fields with 1 component are written as scalars, with 3 as
+	vectors and otherwise as matrices of 1 row.
+	Throws std::invalid_argument if components == 0.
+	*/
+	Xdmf_Writer<Grid>& add_field(
+		const std::string& name,
+		const size_t components,
+		const field_function_t& function
+	) {
+		if (components == 0) {
+			throw std::invalid_argument(
+				"\n" __FILE__ "(" + std::to_string(__LINE__) + "): "
+				+ "Field " + name + " must have at least one component"
+			);
+		}
+		this->fields.push_back(Field{name, components, function});
+		return *this;
+	}
+
+
+	/*!
+	Makes next call to write() write cell corners and connectivity.
+
+	Call this if the grid's geometry changes without changing cells.
+	*/
+	void forget_mesh()
+	{
+		this->mesh_cells.clear();
+		this->mesh_path.clear();
+		this->mesh_file.clear();
+	}
+
+
+	/*!
+	Writes local cells of given grid into files name.xmf and name.bin.
+
+	Given time is written into the XML file. Files are overwritten.
+
+	Must be called simultaneously on all processes of given grid.
+	Returns true on success, false otherwise (on one or more processes).
+	*/
+	bool write(
+		const Grid& grid,
+		const std::string& name,
+		const double time = 0
+	) {
+		MPI_Comm comm = grid.get_communicator();
+		const int rank = grid.get_rank();
+
+		std::vector<uint64_t> local_cells;
+		for (const auto& cell: grid.local_cells) {
+			local_cells.push_back(cell.id);
+		}
+		const uint64_t number_of_cells = local_cells.size();
+
+		const std::string
+			binary_name = name + ".bin",
+			binary_basename = binary_name.substr(binary_name.find_last_of('/') + 1);
+
+		// previous mesh can't be used if its file is overwritten
+		const bool write_mesh
+			= All_Reduce()(
+				uint64_t(
+					this->mesh_path.size() == 0
+					or this->mesh_path == binary_name
+					or local_cells != this->mesh_cells
+					? 1 : 0
+				),
+				comm
+			) > 0;
+
+		// number of cells before this process' cells and in total
+		std::vector<uint64_t> all_counts(grid.get_comm_size(), 0);
+		int ret_val = MPI_Allgather(
+			&number_of_cells,
+			1,
+			MPI_UINT64_T,
+			all_counts.data(),
+			1,
+			MPI_UINT64_T,
+			comm
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " MPI_Allgather failed: " << Error_String()(ret_val)
+				<< std::endl;
+			abort();
+		}
+		uint64_t cells_before = 0, total_cells = 0;
+		for (int i = 0; i < grid.get_comm_size(); i++) {
+			if (i < rank) {
+				cells_before += all_counts[i];
+			}
+			total_cells += all_counts[i];
+		}
+
+		MPI_File outfile;
+		ret_val = MPI_File_open(
+			comm,
+			const_cast<char*>(binary_name.c_str()),
+			MPI_MODE_CREATE | MPI_MODE_WRONLY,
+			MPI_INFO_NULL,
+			&outfile
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << rank
+				<< " Couldn't open file " << binary_name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			MPI_Comm_free(&comm);
+			return false;
+		}
+
+		// remove data from previous file with same name
+		ret_val = MPI_File_set_size(outfile, 0);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << rank
+				<< " Couldn't set size of file " << binary_name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			MPI_Comm_free(&comm);
+			return false;
+		}
+
+		bool success = true;
+		uint64_t section_start = 0;
+
+		if (write_mesh) {
+			this->mesh_cells = local_cells;
+			this->mesh_path = binary_name;
+			this->mesh_file = binary_basename;
+			this->mesh_total_cells = total_cells;
+
+			// corners in the order of XDMF and VTK hexahedron
+			std::vector<double> points;
+			points.reserve(number_of_cells * 8 * 3);
+			for (const auto& cell: local_cells) {
+				const std::array<double, 3>
+					min = grid.geometry.get_min(cell),
+					max = grid.geometry.get_max(cell);
+				for (const auto& z: {min[2], max[2]}) {
+					points.insert(points.end(), {min[0], min[1], z});
+					points.insert(points.end(), {max[0], min[1], z});
+					points.insert(points.end(), {max[0], max[1], z});
+					points.insert(points.end(), {min[0], max[1], z});
+				}
+			}
+			this->points_seek = section_start;
+			if (!this->write_section(
+				outfile,
+				section_start + cells_before * 8 * 3 * sizeof(double),
+				points.data(),
+				points.size(),
+				MPI_DOUBLE
+			)) {
+				success = false;
+			}
+			section_start += total_cells * 8 * 3 * sizeof(double);
+			points.clear();
+			points.shrink_to_fit();
+
+			std::vector<uint64_t> connectivity(number_of_cells * 8);
+			for (uint64_t i = 0; i < connectivity.size(); i++) {
+				connectivity[i] = cells_before * 8 + i;
+			}
+			this->connectivity_seek = section_start;
+			if (!this->write_section(
+				outfile,
+				section_start + cells_before * 8 * sizeof(uint64_t),
+				connectivity.data(),
+				connectivity.size(),
+				MPI_UINT64_T
+			)) {
+				success = false;
+			}
+			section_start += total_cells * 8 * sizeof(uint64_t);
+		}
+
+		std::vector<uint64_t> field_seeks;
+		std::vector<double> values;
+		for (const auto& field: this->fields) {
+			values.resize(number_of_cells * field.components);
+			size_t i = 0;
+			for (const auto& cell: grid.local_cells) {
+				field.function(cell, values.data() + i);
+				i += field.components;
+			}
+
+			field_seeks.push_back(section_start);
+			if (!this->write_section(
+				outfile,
+				section_start + cells_before * field.components * sizeof(double),
+				values.data(),
+				values.size(),
+				MPI_DOUBLE
+			)) {
+				success = false;
+			}
+			section_start += total_cells * field.components * sizeof(double);
+		}
+
+		ret_val = MPI_File_close(&outfile);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << rank
+				<< " Couldn't close file " << binary_name
+				<< ": " << Error_String()(ret_val)
+				<< std::endl;
+			success = false;
+		}
+
+		if (rank == 0 and success) {
+			success = this->write_xml(name + ".xmf", binary_basename, field_seeks, time);
+		}
+
+		const uint64_t failures = All_Reduce()(uint64_t(success ? 0 : 1), comm);
+		MPI_Comm_free(&comm);
+
+		return failures == 0;
+	}
+
+
+
+private:
+
+	struct Field {
+		std::string name;
+		size_t components;
+		field_function_t function;
+	};
+
+	std::vector<Field> fields;
+
+	// local cells in previously written mesh
+	std::vector<uint64_t> mesh_cells;
+	// file with previously written mesh as given and without directory, empty if none
+	std::string mesh_path, mesh_file;
+	uint64_t mesh_total_cells = 0, points_seek = 0, connectivity_seek = 0;
+
+
+	/*!
+	Writes given items collectively at given offset in given file.
+	*/
+	bool write_section(
+		MPI_File& file,
+		const uint64_t offset,
+		const void* const data,
+		const size_t number_of_items,
+		MPI_Datatype datatype
+	) {
+		if (number_of_items > size_t(INT_MAX)) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Too many items to write at once: " << number_of_items
+				<< std::endl;
+			abort();
+		}
+
+		// give a valid buffer to ...write_at_all even if nothing to write
+		const uint64_t dummy = 0;
+		const int ret_val = MPI_File_write_at_all(
+			file,
+			(MPI_Offset) offset,
+			number_of_items > 0 ? const_cast<void*>(data) : (void*) &dummy,
+			int(number_of_items),
+			datatype,
+			MPI_STATUS_IGNORE
+		);
+		if (ret_val != MPI_SUCCESS) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't write data: " << Error_String()(ret_val)
+				<< std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+
+	/*!
+	Writes XML file describing the binary file of given name.
+	*/
+	bool write_xml(
+		const std::string& name,
+		const std::string& binary_name,
+		const std::vector<uint64_t>& field_seeks,
+		const double time
+	) const {
+		std::ofstream xml(name);
+		if (not xml.is_open()) {
+			std::cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't open file " << name
+				<< std::endl;
+			return false;
+		}
+
+		const auto data_item = [&xml](
+			const std::string& dimensions,
+			const std::string& number_type,
+			const std::string& file,
+			const uint64_t seek
+		) {
+			xml << "    <DataItem Dimensions=\"" << dimensions
+				<< "\" NumberType=\"" << number_type
+				<< "\" Precision=\"8\" Format=\"Binary\" Endian=\"Native\" Seek=\"" << seek
+				<< "\">" << file << "</DataItem>\n";
+		};
+
+		const uint64_t cells = this->mesh_total_cells;
+		xml << std::setprecision(17)
+			<< "<?xml version=\"1.0\" ?>\n"
+			<< "<Xdmf Version=\"3.0\">\n"
+			<< " <Domain>\n"
+			<< "  <Grid Name=\"dccrg\" GridType=\"Uniform\">\n"
+			<< "   <Time Value=\"" << time << "\"/>\n"
+			<< "   <Topology TopologyType=\"Hexahedron\" NumberOfElements=\"" << cells << "\">\n";
+		data_item(std::to_string(cells) + " 8", "UInt", this->mesh_file, this->connectivity_seek);
+		xml << "   </Topology>\n"
+			<< "   <Geometry GeometryType=\"XYZ\">\n";
+		data_item(std::to_string(8 * cells) + " 3", "Float", this->mesh_file, this->points_seek);
+		xml << "   </Geometry>\n";
+
+		for (size_t i = 0; i < this->fields.size(); i++) {
+			const Field& field = this->fields[i];
+			xml << "   <Attribute Name=\"" << field.name << "\" AttributeType=\""
+				<< (field.components == 1 ? "Scalar" : (field.components == 3 ? "Vector" : "Matrix"))
+				<< "\" Center=\"Cell\">\n";
+			data_item(
+				std::to_string(cells)
+					+ (field.components == 1 ? "" : " " + std::to_string(field.components)),
+				"Float",
+				binary_name,
+				field_seeks[i]
+			);
+			xml << "   </Attribute>\n";
+		}
+
+		xml << "  </Grid>\n"
+			<< " </Domain>\n"
+			<< "</Xdmf>\n";
+
+		return xml.good();
+	}
+};
+
+}	// namespace
+
+#endif
@@ -10,254 +10,47 @@ visualize for example with VisIt (https://wci.llnl.gov/codes/visit/)
 #include "iostream"
 #include "cstdint"
 
-#include "mpi.h"
-
+// files are memory mapped so MPI isn't needed
+#define DCCRG_NO_MPI
 #include "../dccrg_cartesian_geometry.hpp"
+#include "../dccrg_file_reader.hpp"
 
 using namespace std;
 
 int main(int argc, char* argv[])
 {
-	int ret_val;
-
-	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
-		cerr << "Coudln't initialize MPI." << endl;
-		abort();
-	}
-
-	MPI_Comm comm = MPI_COMM_WORLD;
-
-	int rank = 0, comm_size = 0;
-	MPI_Comm_rank(comm, &rank);
-	if (rank < 0) {
-		std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
-		abort();
-	}
-	MPI_Comm_size(comm, &comm_size);
-	if (comm_size < 0) {
-		std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
-		abort();
-	}
-
-	// each process converts its own files
 	for (int arg = 1; arg < argc; arg++) {
 
-		if ((arg - 1) % comm_size != rank) {
-			continue;
-		}
-
 		const std::string name(argv[arg]);
 
-		MPI_File file;
-		MPI_Offset offset = 0;
-
-		ret_val = MPI_File_open(
-			MPI_COMM_SELF,
-			argv[arg],
-			MPI_MODE_RDONLY,
-			MPI_INFO_NULL,
-			&file
-		);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " Couldn't open file " << name
-				<< ": " << dccrg::Error_String()(ret_val)
-				<< std::endl;
-			continue;
-		}
-
-		/*
-		Header (time step) was saved first, starting at byte 0 in the file
-		*/
-		uint64_t time_step;
-		ret_val = MPI_File_read_at(
-			file,
-			offset,
-			&time_step,
-			1,
-			MPI_UINT64_T,
-			MPI_STATUS_IGNORE
-		);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " Couldn't read time step from file " << name
-				<< ": " << dccrg::Error_String()(ret_val)
-				<< std::endl;
-			continue;
-		}
-		offset += sizeof(uint64_t);
-		//cout << "time step: " << time_step << endl;
-
 		/*
-		Format of the grid data file written by its save_grid_data() member function:
-		1. endianness
-		2. info for mapping cell ids to logical position & size
-		3. neighborhood size
-		4. grid topology
-		5. grid geometry
-		6. number of cells
-		7. list of cell ids and data offsets in file
-		8. cell data
+		Header (time step) was saved first, starting at byte 0 in the file,
+		followed by the grid's metadata, list of cells and cell data
 		*/
-
-		// check endianness
-		uint64_t
-			endianness_original = 0x1234567890abcdef,
-			endianness_read = 0;
-
-		ret_val = MPI_File_read_at(
-			file,
-			offset,
-			&endianness_read,
-			1,
-			MPI_UINT64_T,
-			MPI_STATUS_IGNORE
-		);
-		if (ret_val != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " Couldn't read endianness check from file " << name
-				<< ": " << dccrg::Error_String()(ret_val)
-				<< std::endl;
-			continue;
-		}
-		offset += sizeof(uint64_t);
-
-		if (endianness_original != endianness_read) {
+		dccrg::File_Reader<dccrg::Cartesian_Geometry> reader;
+		if (!reader.open(name, sizeof(uint64_t))) {
 			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " File " << name
-				<< " has wrong endianness, value from file is "
-				<< endianness_read
-				<< " but should be " << endianness_original
-				<< std::endl;
-			continue;
-		}
-
-		// initialize mapping
-		dccrg::Mapping mapping;
-		if (!mapping.read(file, offset)) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " Couldn't read mapping from file " << name
-				<< std::endl;
-			continue;
-		}
-		offset += mapping.data_size();
-
-		//cout << "x_length: " << mapping.length.get()[0] << "\n"
-		//	<< "y_length: " << mapping.length.get()[1] << "\n"
-		//	<< "z_length: " << mapping.length.get()[2] << "\n"
-		//	<< "max_ref_level: " << mapping.get_maximum_refinement_level()
-		//	<< endl;
-
-		// read neighborhood length
-		unsigned int neighborhood_length = 0;
-		if (MPI_File_read_at(
-			file,
-			offset,
-			(void*) &neighborhood_length,
-			1,
-			MPI_UNSIGNED,
-			MPI_STATUS_IGNORE
-		) != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " Couldn't read length of cells' neighborhood from file " << name
-				<< std::endl;
-			continue;
-		}
-		offset += sizeof(unsigned int);
-
-		// initialize topology
-		dccrg::Grid_Topology topology;
-		if (!topology.read(file, offset)) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " Couldn't read grid topology from file " << name
-				<< std::endl;
-			continue;
-		}
-		offset += topology.data_size();
-
-		//cout << "periodic in x: " << topology.is_periodic(0) << "\n"
-		//	<< "periodic in y: " << topology.is_periodic(1) << "\n"
-		//	<< "periodic in z: " << topology.is_periodic(2) << "\n"
-		//	<< endl;
-
-		// initialize geometry
-		dccrg::Cartesian_Geometry geometry(mapping.length, mapping, topology);
-		if (!geometry.read(file, offset)) {
-			std::cerr << __FILE__ << ":" << __LINE__
-				<< " Process " << rank
-				<< " Couldn't read geometry from file"
+				<< " Couldn't open file " << name
 				<< std::endl;
 			continue;
 		}
-		offset += geometry.data_size();
-
-		//cout << "x_start: " << geometry.get_start()[0] << "\n"
-		//	<< "y_start: " << geometry.get_start()[1] << "\n"
-		//	<< "z_start: " << geometry.get_start()[2] << "\n"
-		//	<< "level 0 cell x size: " << geometry.get_level_0_cell_length()[0] << "\n"
-		//	<< "level 0 cell y size: " << geometry.get_level_0_cell_length()[1] << "\n"
-		//	<< "level 0 cell z size: " << geometry.get_level_0_cell_length()[2]
-		//	<< endl;
-
-		uint64_t number_of_cells;
-		if (MPI_File_read_at(
-			file,
-			offset,
-			&number_of_cells,
-			1,
-			MPI_UINT64_T,
-			MPI_STATUS_IGNORE
-		) != MPI_SUCCESS) {
-			std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
-			abort();
-		}
-		offset += sizeof(uint64_t);
-		//cout << "number of cells: " << number_of_cells << endl;
+		const dccrg::Cartesian_Geometry& geometry = reader.get_geometry();
 
 		// read in game data (1st cell, is_alive 1st), (2nd cell, is_alive 2nd), ...
-		std::vector<std::pair<uint64_t, unsigned int>> cell_data(number_of_cells);
-
-		// read in cell list
-		for (uint64_t i = 0; i < number_of_cells; i++) {
-			if (MPI_File_read_at(
-				file,
-				offset,
-				&(cell_data[i].first),
-				1,
-				MPI_UINT64_T,
-				MPI_STATUS_IGNORE
-			) != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
-				abort();
-			}
-			offset += sizeof(uint64_t);
-			// skip data offset
-			offset += sizeof(uint64_t);
-		}
-
-		// read in cell data
-		for (uint64_t i = 0; i < number_of_cells; i++) {
-			if (MPI_File_read_at(
-				file,
-				offset,
-				&(cell_data[i].second),
-				1,
-				MPI_UNSIGNED,
-				MPI_STATUS_IGNORE
-			) != MPI_SUCCESS) {
-				std::cerr << __FILE__ << ":" << __LINE__ << std::endl;
+		std::vector<std::pair<uint64_t, unsigned int>> cell_data(reader.get_number_of_cells());
+		for (uint64_t i = 0; i < cell_data.size(); i++) {
+			cell_data[i].first = reader.get_cell(i);
+
+			const auto data = reader.get_data(i);
+			if (data.size < sizeof(unsigned int)) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " Not enough data for cell " << cell_data[i].first
+					<< " in file " << name
+					<< std::endl;
 				abort();
 			}
-			offset += sizeof(unsigned int);
+			std::memcpy(&(cell_data[i].second), data.data, sizeof(unsigned int));
 		}
-		MPI_File_close(&file);
 
 		// write the game data to a .vtk file
 		const string
@@ -320,8 +113,6 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	MPI_Finalize();
-
 	return EXIT_SUCCESS;
 }
 
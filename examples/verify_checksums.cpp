@@ -0,0 +1,109 @@
+/*
+Verifies files saved by dccrg with checkpoint checksums enabled,
+see Dccrg::set_checkpoint_checksums().
+
+Run for example with
+mpirun -np 4 ./verify_checksums.exe grid_*.dc
+Each file is verified in parallel by all processes, the exit
+status is non-zero if any file doesn't have checksums or
+is corrupted.
+*/
+
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "mpi.h"
+
+#include "../dccrg_checksum.hpp"
+
+using namespace std;
+
+/*!
+Returns true if given file has checksums which match its data.
+*/
+bool verify(const string& name, MPI_Comm comm, const int rank)
+{
+	MPI_File file;
+	int ret_val = MPI_File_open(
+		comm,
+		const_cast<char*>(name.c_str()),
+		MPI_MODE_RDONLY,
+		MPI_INFO_NULL,
+		&file
+	);
+	if (ret_val != MPI_SUCCESS) {
+		if (rank == 0) {
+			cerr << "Couldn't open file " << name
+				<< ": " << dccrg::Error_String()(ret_val)
+				<< endl;
+		}
+		return false;
+	}
+
+	bool ok = true;
+	dccrg::File_Checksums checksums;
+	std::vector<uint64_t> bad_blocks;
+	if (!checksums.read(file)) {
+		if (rank == 0) {
+			cerr << name << ": no checksums" << endl;
+		}
+		ok = false;
+	} else if (!checksums.verify(file, comm, bad_blocks)) {
+		if (rank == 0) {
+			cerr << name << ": couldn't verify checksums" << endl;
+		}
+		ok = false;
+	} else if (bad_blocks.size() > 0) {
+		if (rank == 0) {
+			cerr << name << ": " << bad_blocks.size() << " corrupted block(s) of "
+				<< checksums.block_size << " bytes starting at byte "
+				<< checksums.start << ":";
+			for (const auto& block: bad_blocks) {
+				cerr << " " << block;
+			}
+			cerr << endl;
+		}
+		ok = false;
+	} else if (rank == 0) {
+		cout << name << ": OK, " << checksums.get_number_of_blocks()
+			<< " block(s)" << endl;
+	}
+
+	MPI_File_close(&file);
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0;
+	MPI_Comm_rank(comm, &rank);
+
+	if (argc < 2) {
+		if (rank == 0) {
+			cout << "Usage: " << argv[0] << " file1 [file2 ...]" << endl;
+		}
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	bool all_ok = true;
+	for (int arg = 1; arg < argc; arg++) {
+		if (!verify(argv[arg], comm, rank)) {
+			all_ok = false;
+		}
+	}
+
+	MPI_Finalize();
+
+	return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,262 @@
+/*
+Tests saving grid data in the background while solving the advection equation.
+
+The advection solver is run three times from identical initial
+state: without saving, saving with save_grid_data() and saving with
+start_saving_grid_data() which is finished only before the next save.
+Files written by the latter two must be identical. Run times are
+printed along with the fraction of blocking save time hidden by
+background saving, compile without DEBUG for meaningful timings.
+
+Copyright 2018 Finnish Meteorological Institute
+
+Dccrg is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+Dccrg is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with dccrg. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iomanip"
+#include "iostream"
+#include "iterator"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+#include "cell.hpp"
+#include "initialize.hpp"
+#include "solve.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+bool Cell::transfer_all_data = false;
+
+typedef Dccrg<
+	Cell,
+	Cartesian_Geometry,
+	std::tuple<Center>,
+	std::tuple<Is_Local>
+> Grid;
+
+enum Saving {no_saving, blocking_saving, background_saving};
+
+const string base_output_name("tests/advection/overlapped_save_");
+
+string get_output_name(const Saving saving, const unsigned int step)
+{
+	return base_output_name
+		+ (saving == blocking_saving ? "blocking_" : "background_")
+		+ to_string(step) + ".dc";
+}
+
+/*!
+Solves given number of steps from initial state saving every save_n'th step.
+
+Returns time spent in solving and saving.
+*/
+double run(
+	Grid& grid,
+	MPI_Comm& comm,
+	const Saving saving,
+	const unsigned int steps,
+	const unsigned int save_n,
+	const double cfl
+) {
+	initialize(grid);
+	const double dt = max_time_step(comm, grid);
+
+	std::tuple<void*, int, MPI_Datatype> header;
+	std::get<0>(header) = &header;
+	std::get<1>(header) = 0;
+	std::get<2>(header) = MPI_INT;
+
+	MPI_Barrier(comm);
+	const double start = MPI_Wtime();
+
+	for (unsigned int step = 0; step < steps; step++) {
+
+		grid.start_remote_neighbor_copy_updates();
+		calculate_fluxes(cfl * dt, true, grid);
+		grid.wait_remote_neighbor_copy_update_receives();
+		calculate_fluxes(cfl * dt, false, grid);
+		grid.wait_remote_neighbor_copy_update_sends();
+
+		if (saving != no_saving and step % save_n == 0) {
+			Cell::transfer_all_data = true;
+			if (saving == blocking_saving) {
+				if (!grid.save_grid_data(get_output_name(saving, step), 0, header)) {
+					cerr << __FILE__ << ":" << __LINE__ << endl;
+					abort();
+				}
+			} else {
+				if (
+					!grid.finish_saving_grid_data()
+					or !grid.start_saving_grid_data(get_output_name(saving, step), 0, header)
+				) {
+					cerr << __FILE__ << ":" << __LINE__ << endl;
+					abort();
+				}
+			}
+			Cell::transfer_all_data = false;
+		}
+
+		apply_fluxes(grid);
+	}
+
+	if (!grid.finish_saving_grid_data()) {
+		cerr << __FILE__ << ":" << __LINE__ << endl;
+		abort();
+	}
+
+	MPI_Barrier(comm);
+	return MPI_Wtime() - start;
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	unsigned int cells, steps, save_n;
+	double cfl;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("cells",
+			boost::program_options::value<unsigned int>(&cells)->default_value(10000),
+			"Total number of cells in the grid")
+		("steps",
+			boost::program_options::value<unsigned int>(&steps)->default_value(50),
+			"Number of time steps to solve")
+		("save-n",
+			boost::program_options::value<unsigned int>(&save_n)->default_value(10),
+			"Save grid every arg'th time step")
+		("cfl",
+			boost::program_options::value<double>(&cfl)->default_value(0.5),
+			"Fraction of maximum time step to use (0..1)");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	if (save_n == 0) {
+		cerr << "save-n must be > 0" << endl;
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	cells = (unsigned int) round(sqrt(double(cells)));
+
+	Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{0, 0, 0}};
+	geom_params.level_0_cell_length = {{1.0 / cells, 1.0 / cells, 1.0 / cells}};
+
+	Grid grid;
+	grid
+		.set_initial_length({cells, cells, 1})
+		.set_periodic(true, true, false)
+		.set_neighborhood_length(0)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.set_geometry(geom_params)
+		.balance_load();
+
+	const double
+		solve_time = run(grid, comm, no_saving, steps, save_n, cfl),
+		blocking_time = run(grid, comm, blocking_saving, steps, save_n, cfl),
+		background_time = run(grid, comm, background_saving, steps, save_n, cfl);
+
+	// files saved both ways must be identical
+	if (rank == 0) {
+		for (unsigned int step = 0; step < steps; step += save_n) {
+			const string
+				blocking_name = get_output_name(blocking_saving, step),
+				background_name = get_output_name(background_saving, step);
+
+			ifstream blocking_file(blocking_name, ios::binary), background_file(background_name, ios::binary);
+			const vector<char>
+				blocking_data{istreambuf_iterator<char>(blocking_file), istreambuf_iterator<char>()},
+				background_data{istreambuf_iterator<char>(background_file), istreambuf_iterator<char>()};
+			if (blocking_data.size() == 0 or blocking_data != background_data) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Files " << blocking_name << " and " << background_name
+					<< " differ"
+					<< endl;
+				abort();
+			}
+
+			remove(blocking_name.c_str());
+			remove(background_name.c_str());
+		}
+	}
+
+	// unsupported save options must fail on all processes without starting to save
+	std::tuple<void*, int, MPI_Datatype> header{nullptr, 0, MPI_INT};
+	grid.set_save_aggregators(1);
+	if (grid.start_saving_grid_data(base_output_name + "refused.dc", 0, header) or grid.is_saving_grid_data()) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Saving in the background with save aggregators didn't fail"
+			<< endl;
+		abort();
+	}
+	grid.set_save_aggregators(0);
+
+	if (rank == 0) {
+		const double blocking_save_time = blocking_time - solve_time;
+		cout << "Processes: " << comm_size
+			<< ", solving without saving: " << solve_time
+			<< " s, with save_grid_data(): " << blocking_time
+			<< " s, with start_saving_grid_data(): " << background_time
+			<< " s, fraction of saving time hidden: "
+			<< (blocking_save_time > 0 ? (blocking_time - background_time) / blocking_save_time : 0)
+			<< endl;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
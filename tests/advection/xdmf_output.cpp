@@ -0,0 +1,330 @@
+/*
+Tests writing XDMF output with Xdmf_Writer while solving the advection equation.
+
+The advection solver is run twice from identical initial state:
+without output and writing density and velocity every save_n'th
+step. Every process verifies its part of the first and last
+binary files and run times are printed, compile without DEBUG
+for meaningful timings.
+
+Copyright 2018 Finnish Meteorological Institute
+
+Dccrg is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+Dccrg is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with dccrg. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "array"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iomanip"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+#include "dccrg_xdmf_writer.hpp"
+#include "cell.hpp"
+#include "initialize.hpp"
+#include "solve.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+bool Cell::transfer_all_data = false;
+
+typedef Dccrg<
+	Cell,
+	Cartesian_Geometry,
+	std::tuple<Center>,
+	std::tuple<Is_Local>
+> Grid;
+
+const string base_output_name("tests/advection/xdmf_output_");
+
+string get_output_name(const unsigned int step)
+{
+	return base_output_name + to_string(step);
+}
+
+/*!
+Reads given number of doubles from given file at given offset.
+*/
+vector<double> read_doubles(const string& name, const uint64_t offset, const uint64_t number)
+{
+	vector<double> result(number);
+	ifstream file(name, ios::binary);
+	file.seekg(offset);
+	file.read((char*) result.data(), number * sizeof(double));
+	if (not file.good()) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Couldn't read " << number << " doubles from " << name
+			<< " at offset " << offset
+			<< endl;
+		abort();
+	}
+	return result;
+}
+
+/*!
+Verifies density and velocity of local cells in given binary file.
+
+Data of local cells starts after data of cells_before cells,
+mesh is expected in the file if with_mesh == true.
+*/
+void verify(
+	const Grid& grid,
+	const string& name,
+	const uint64_t cells_before,
+	const uint64_t total_cells,
+	const bool with_mesh
+) {
+	uint64_t local_cells = 0;
+	for (const auto& cell: grid.local_cells) {
+		(void) cell;
+		local_cells++;
+	}
+
+	uint64_t field_start = 0;
+	if (with_mesh) {
+		const auto points = read_doubles(name, cells_before * 8 * 3 * sizeof(double), local_cells * 8 * 3);
+		size_t i = 0;
+		for (const auto& cell: grid.local_cells) {
+			const auto min = grid.geometry.get_min(cell.id), max = grid.geometry.get_max(cell.id);
+			// first and last corner of hexahedron
+			if (
+				points[24 * i + 0] != min[0] or points[24 * i + 1] != min[1] or points[24 * i + 2] != min[2]
+				or points[24 * i + 21] != min[0] or points[24 * i + 22] != max[1] or points[24 * i + 23] != max[2]
+			) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Wrong corners for cell " << cell.id << " in " << name
+					<< endl;
+				abort();
+			}
+			i++;
+		}
+		field_start = total_cells * 8 * (3 * sizeof(double) + sizeof(uint64_t));
+	}
+
+	const auto
+		density = read_doubles(name, field_start + cells_before * sizeof(double), local_cells),
+		velocity = read_doubles(
+			name,
+			field_start + (total_cells + 3 * cells_before) * sizeof(double),
+			3 * local_cells
+		);
+	size_t i = 0;
+	for (const auto& cell: grid.local_cells) {
+		if (
+			density[i] != cell.data->density()
+			or velocity[3 * i] != cell.data->vx()
+			or velocity[3 * i + 1] != cell.data->vy()
+			or velocity[3 * i + 2] != cell.data->vz()
+		) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong data for cell " << cell.id << " in " << name
+				<< endl;
+			abort();
+		}
+		i++;
+	}
+}
+
+/*!
+Solves given number of steps from initial state writing output every save_n'th step.
+
+Returns time spent in solving and writing.
+*/
+double run(
+	Grid& grid,
+	MPI_Comm& comm,
+	const bool output,
+	const unsigned int steps,
+	const unsigned int save_n,
+	const double cfl
+) {
+	initialize(grid);
+	const double dt = max_time_step(comm, grid);
+
+	Xdmf_Writer<Grid> writer;
+	writer
+		.add_field("density", 1, [](const Grid::cells_item_t& cell, double* const values) {
+			values[0] = cell.data->density();
+		})
+		.add_field("velocity", 3, [](const Grid::cells_item_t& cell, double* const values) {
+			values[0] = cell.data->vx();
+			values[1] = cell.data->vy();
+			values[2] = cell.data->vz();
+		});
+
+	uint64_t local_cells = 0;
+	for (const auto& cell: grid.local_cells) {
+		(void) cell;
+		local_cells++;
+	}
+	uint64_t cells_before = 0, total_cells = 0;
+	MPI_Exscan(&local_cells, &cells_before, 1, MPI_UINT64_T, MPI_SUM, comm);
+	MPI_Allreduce(&local_cells, &total_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
+	if (grid.get_rank() == 0) {
+		cells_before = 0;
+	}
+
+	MPI_Barrier(comm);
+	const double start = MPI_Wtime();
+
+	for (unsigned int step = 0; step < steps; step++) {
+
+		grid.start_remote_neighbor_copy_updates();
+		calculate_fluxes(cfl * dt, true, grid);
+		grid.wait_remote_neighbor_copy_update_receives();
+		calculate_fluxes(cfl * dt, false, grid);
+		grid.wait_remote_neighbor_copy_update_sends();
+
+		if (output and step % save_n == 0) {
+			if (!writer.write(grid, get_output_name(step), step * cfl * dt)) {
+				cerr << __FILE__ << ":" << __LINE__ << endl;
+				abort();
+			}
+
+			// first file has the mesh, later ones refer to it
+			if (step == 0 or step + save_n >= steps) {
+				verify(grid, get_output_name(step) + ".bin", cells_before, total_cells, step == 0);
+			}
+		}
+
+		apply_fluxes(grid);
+	}
+
+	MPI_Barrier(comm);
+	return MPI_Wtime() - start;
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	unsigned int cells, steps, save_n;
+	double cfl;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("cells",
+			boost::program_options::value<unsigned int>(&cells)->default_value(10000),
+			"Total number of cells in the grid")
+		("steps",
+			boost::program_options::value<unsigned int>(&steps)->default_value(50),
+			"Number of time steps to solve")
+		("save-n",
+			boost::program_options::value<unsigned int>(&save_n)->default_value(10),
+			"Write output every arg'th time step")
+		("cfl",
+			boost::program_options::value<double>(&cfl)->default_value(0.5),
+			"Fraction of maximum time step to use (0..1)");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	if (save_n == 0) {
+		cerr << "save-n must be > 0" << endl;
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	cells = (unsigned int) round(sqrt(double(cells)));
+
+	Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{0, 0, 0}};
+	geom_params.level_0_cell_length = {{1.0 / cells, 1.0 / cells, 1.0 / cells}};
+
+	Grid grid;
+	grid
+		.set_initial_length({cells, cells, 1})
+		.set_periodic(true, true, false)
+		.set_neighborhood_length(0)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.set_geometry(geom_params)
+		.balance_load();
+
+	const double
+		solve_time = run(grid, comm, false, steps, save_n, cfl),
+		output_time = run(grid, comm, true, steps, save_n, cfl);
+
+	MPI_Barrier(comm);
+	if (rank == 0) {
+		// xml file must refer to mesh in first binary file
+		const string name = get_output_name(save_n) + ".xmf";
+		ifstream xml_file(name);
+		const string xml{istreambuf_iterator<char>(xml_file), istreambuf_iterator<char>()};
+		if (
+			steps > save_n
+			and (
+				xml.find(">xdmf_output_0.bin<") == string::npos
+				or xml.find(">xdmf_output_" + to_string(save_n) + ".bin<") == string::npos
+			)
+		) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong references to binary files in " << name
+				<< endl;
+			abort();
+		}
+
+		for (unsigned int step = 0; step < steps; step += save_n) {
+			remove((get_output_name(step) + ".xmf").c_str());
+			remove((get_output_name(step) + ".bin").c_str());
+		}
+
+		cout << "Processes: " << comm_size
+			<< ", solving without output: " << solve_time
+			<< " s, with output every " << save_n << " steps: " << output_time
+			<< " s" << endl;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
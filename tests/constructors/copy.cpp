@@ -17,6 +17,7 @@ You should have received a copy of the GNU Lesser General Public License
 along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "algorithm"
 #include "cstdlib"
 #include "ctime"
 #include "iostream"
@@ -167,6 +168,39 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	// check copying between grids with different cell storage
+	dccrg::Dccrg<
+		Cell1,
+		dccrg::Cartesian_Geometry,
+		std::tuple<>,
+		std::tuple<>,
+		dccrg::Contiguous_Cell_Storage
+	> grid3(grid1);
+	dccrg::Dccrg<Cell2, dccrg::Cartesian_Geometry> grid4(grid3);
+
+	auto sorted_cells1 = cells1, cells3 = grid3.get_cells(), cells4 = grid4.get_cells();
+	std::sort(sorted_cells1.begin(), sorted_cells1.end());
+	std::sort(cells3.begin(), cells3.end());
+	std::sort(cells4.begin(), cells4.end());
+	if (cells3 != sorted_cells1 or cells4 != sorted_cells1) {
+		cerr << "Rank " << rank << ": Cells of copies with different storage don't match" << endl;
+		abort();
+	}
+
+	for (const auto& cell: grid3.local_cells) {
+		cell.data->data = 3 * rank;
+	}
+	grid3.update_copies_of_remote_neighbors();
+	for (const auto& cell: grid3.remote_cells) {
+		if (cell.data->data != 3 * int(grid3.get_process(cell.id))) {
+			cerr << "Rank " << rank
+				<< ": Wrong data in copy of remote cell " << cell.id
+				<< " in grid3: " << cell.data->data
+				<< endl;
+			abort();
+		}
+	}
+
 	MPI_Finalize();
 
 	return EXIT_SUCCESS;
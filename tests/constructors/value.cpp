@@ -0,0 +1,139 @@
+/*
+Tests copying dccrg of the same type, returning it by value and storing it in a vector.
+
+Copies of a grid whose remote neighbor updates use persistent
+requests or neighbor collectives must not free those of the
+original grid.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cstdlib"
+#include "iostream"
+#include "tuple"
+#include "utility"
+#include "vector"
+
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+
+using namespace std;
+
+struct Cell {
+	int data = -1;
+
+	static constexpr bool stable_mpi_datatype = true;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple((void*) &(this->data), 1, MPI_INT);
+	}
+};
+
+typedef dccrg::Dccrg<Cell, dccrg::Cartesian_Geometry> Grid;
+
+Grid get_grid()
+{
+	Grid grid;
+	grid
+		.set_initial_length({10, 10, 10})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0);
+	return grid;
+}
+
+/*!
+Aborts if remote neighbor data of given grid isn't given value times owner.
+*/
+void check_update(Grid& grid, const int value)
+{
+	for (const auto& cell: grid.get_cells()) {
+		grid[cell]->data = value * int(grid.get_rank());
+	}
+
+	grid.update_copies_of_remote_neighbors();
+
+	for (const auto& cell: grid.get_remote_cells_on_process_boundary_internal()) {
+		const int correct = value * int(grid.get_process(cell));
+		if (grid[cell]->data != correct) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Data of cell " << cell << " incorrect: " << grid[cell]->data
+				<< ", should be " << correct
+				<< endl;
+			abort();
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cout << "Zoltan_Initialize failed" << endl;
+		return EXIT_FAILURE;
+	}
+
+	{
+		vector<Grid> grids;
+		grids.reserve(2);
+		grids.emplace_back();
+		grids.push_back(get_grid());
+
+		grids[0]
+			.set_initial_length({10, 10, 10})
+			.set_neighborhood_length(1)
+			.set_maximum_refinement_level(0);
+
+		for (auto& grid: grids) {
+			grid
+				.initialize(comm)
+				.set_geometry(dccrg::Cartesian_Geometry::Parameters{{0,0,0}, {1,1,1}});
+			check_update(grid, 1);
+		}
+
+		Grid& grid = grids[1];
+
+		grid.set_persistent_remote_neighbor_updates(true);
+		check_update(grid, 2);
+		{
+			Grid copy(grid);
+			check_update(copy, 3);
+		}
+		check_update(grid, 4);
+		grid.set_persistent_remote_neighbor_updates(false);
+
+		grid.set_neighbor_collective_updates(true);
+		check_update(grid, 5);
+		{
+			Grid copy(grid);
+			check_update(copy, 6);
+		}
+		check_update(grid, 7);
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
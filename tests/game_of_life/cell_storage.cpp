@@ -0,0 +1,242 @@
+/*
+Compares the speed of iterating over cells with different cell storage policies of dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "array"
+#include "chrono"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "tuple"
+
+#include "zoltan.h"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+
+#include "game_of_life_cell.hpp"
+
+
+using namespace std;
+using namespace std::chrono;
+using namespace dccrg;
+
+/*!
+Plays game of life with a line of live cells in given grid.
+
+Returns cells processed / second on this process.
+*/
+template<class Grid> double play(
+	Grid& grid,
+	const uint64_t line,
+	const size_t time_steps
+) {
+	for (const auto& cell: grid.local_cells) {
+		cell.data->data[1] = 0;
+
+		const auto y = grid.mapping.get_indices(cell.id)[1]
+			/ grid.mapping.get_cell_length_in_indices(cell.id);
+		if (y == line) {
+			cell.data->data[0] = 1;
+		} else {
+			cell.data->data[0] = 0;
+		}
+	}
+
+	MPI_Barrier(grid.get_communicator());
+
+	const auto before = high_resolution_clock::now();
+	for (size_t step = 0; step < time_steps; step++) {
+
+		grid.start_remote_neighbor_copy_updates();
+		for (const auto& cell: grid.inner_cells) {
+			cell.data->data[1] = 0;
+			for (const auto& neighbor: cell.neighbors_of) {
+				if (neighbor.data->data[0] == 1) {
+					cell.data->data[1]++;
+				}
+			}
+		}
+
+		grid.wait_remote_neighbor_copy_update_receives();
+		for (const auto& cell: grid.outer_cells) {
+			cell.data->data[1] = 0;
+			for (const auto& neighbor: cell.neighbors_of) {
+				if (neighbor.data->data[0] == 1) {
+					cell.data->data[1]++;
+				}
+			}
+		}
+
+		for (const auto& cell: grid.inner_cells) {
+			if (cell.data->data[1] == 3) {
+				cell.data->data[0] = 1;
+			} else if (cell.data->data[1] != 2) {
+				cell.data->data[0] = 0;
+			}
+		}
+
+		grid.wait_remote_neighbor_copy_update_sends();
+		for (const auto& cell: grid.outer_cells) {
+			if (cell.data->data[1] == 3) {
+				cell.data->data[0] = 1;
+			} else if (cell.data->data[1] != 2) {
+				cell.data->data[0] = 0;
+			}
+		}
+	}
+	const auto after = high_resolution_clock::now();
+	const auto total = duration_cast<duration<double>>(after - before).count();
+
+	// a line of live cells splits into two lines moving away from each other
+	for (const auto& cell: grid.local_cells) {
+		const auto y = grid.mapping.get_indices(cell.id)[1]
+			/ grid.mapping.get_cell_length_in_indices(cell.id);
+		const bool alive = (y + time_steps == line or y - time_steps == line);
+		if (alive != (cell.data->data[0] == 1)) {
+			cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Wrong state of cell " << cell.id
+				<< endl;
+			abort();
+		}
+	}
+
+	const auto number_of_cells = std::distance(grid.local_cells.begin(), grid.local_cells.end());
+	return double(number_of_cells * time_steps) / total;
+}
+
+
+/*!
+Returns cells / second processed by given grid type before and after shuffling cells.
+
+Cells are shuffled by refining and unrefining every other cell
+and by moving cells between processes, which scatters the
+cell data of std::unordered_map in memory.
+*/
+template<class Grid> std::array<double, 2> benchmark(
+	const uint64_t length,
+	const size_t time_steps,
+	MPI_Comm comm
+) {
+	Grid grid;
+	grid
+		.set_initial_length({length, length, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(1)
+		.set_periodic(true, true, false)
+		.initialize(comm)
+		.balance_load();
+
+	Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{0, 0, 0}};
+	geom_params.level_0_cell_length = {{1, 1, 1}};
+	grid.set_geometry(geom_params);
+
+	std::array<double, 2> speeds{{0, 0}};
+	speeds[0] = play(grid, length / 2, time_steps);
+
+	for (const auto& cell: grid.local_cells) {
+		if (cell.id % 2 == 0) {
+			grid.refine_completely(cell.id);
+		}
+	}
+	grid.stop_refining();
+	grid.clear_refined_unrefined_data();
+
+	for (const auto& cell: grid.local_cells) {
+		if (grid.mapping.get_refinement_level(cell.id) > 0) {
+			grid.unrefine_completely(cell.id);
+		}
+	}
+	grid.initialize_refines();
+	grid.execute_refines();
+	grid.finish_refining();
+	grid.clear_refined_unrefined_data();
+
+	const int rank = grid.get_rank(), comm_size = grid.get_comm_size();
+	for (const auto& cell: grid.local_cells) {
+		if (cell.id % 3 == 0) {
+			grid.pin(cell.id, (rank + 1) % comm_size);
+		}
+	}
+	grid.balance_load(false);
+	grid.unpin_all_cells();
+
+	speeds[1] = play(grid, length / 2, time_steps);
+
+	return speeds;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+	    cout << "Zoltan_Initialize failed" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	uint64_t length = 500;
+	if (argc > 1) {
+		length = std::stoull(argv[1]);
+	}
+	constexpr size_t TIME_STEPS = 16;
+	// lines of live cells mustn't meet across periodic boundaries
+	if (length < 2 * TIME_STEPS + 3) {
+		cerr << "Grid length must be at least " << 2 * TIME_STEPS + 3 << endl;
+		abort();
+	}
+
+	const auto unordered = benchmark<
+		Dccrg<game_of_life_cell, Cartesian_Geometry>
+	>(length, TIME_STEPS, comm);
+
+	const auto contiguous = benchmark<
+		Dccrg<
+			game_of_life_cell,
+			Cartesian_Geometry,
+			std::tuple<>,
+			std::tuple<>,
+			Contiguous_Cell_Storage
+		>
+	>(length, TIME_STEPS, comm);
+
+	const std::array<std::string, 2> names{{"initial", "shuffled"}};
+	for (size_t i = 0; i < names.size(); i++) {
+		cout << "Process " << rank << ", " << names[i]
+			<< " cells / second with unordered storage: " << unordered[i]
+			<< ", contiguous storage: " << contiguous[i]
+			<< ", speedup: " << contiguous[i] / unordered[i]
+			<< endl;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+/*
+A minimal game of life cell shared by the scalability tests of dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAME_OF_LIFE_CELL_HPP
+#define GAME_OF_LIFE_CELL_HPP
+
+#include "tuple"
+
+#include "mpi.h"
+
+/*!
+Game of life cell of which only the alive flag is sent to other processes.
+*/
+struct game_of_life_cell {
+
+	// data[0] == 1 if cell is alive, data[1] holds the number of live neighbors
+	unsigned int data[2];
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(&(this->data), 1, MPI_UNSIGNED);
+	}
+};
+
+#endif
@@ -0,0 +1,401 @@
+/*
+Compares the latency of different ways of updating copies of remote neighbors in dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "array"
+#include "chrono"
+#include "cstdint"
+#include "cstdlib"
+#include "cstring"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "dccrg.hpp"
+#include "dccrg_cartesian_geometry.hpp"
+
+
+using namespace std;
+using namespace std::chrono;
+using namespace dccrg;
+
+/*!
+Cell with given number of doubles.
+*/
+template<size_t N> struct Cell {
+	std::array<double, N> data;
+
+	// transfer info depends only on the cell's address
+	static constexpr bool stable_mpi_datatype = true;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(this->data.data(), int(N), MPI_DOUBLE);
+	}
+};
+
+/*!
+Cell which transfers every other of 2 * N doubles.
+
+Datatype consists of N small blocks.
+*/
+template<size_t N> struct Strided_Cell {
+	std::array<double, 2 * N> data;
+
+	static constexpr bool stable_mpi_datatype = true;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		MPI_Datatype datatype;
+		MPI_Type_vector(int(N), 1, 2, MPI_DOUBLE, &datatype);
+		return std::make_tuple(this->data.data(), 1, datatype);
+	}
+};
+
+/*!
+Strided_Cell which packs its own data.
+
+Member functions of base classes aren't detected by dccrg.
+*/
+template<size_t N> struct Packing_Cell {
+	std::array<double, 2 * N> data;
+
+	static constexpr bool stable_mpi_datatype = true;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		MPI_Datatype datatype;
+		MPI_Type_vector(int(N), 1, 2, MPI_DOUBLE, &datatype);
+		return std::make_tuple(this->data.data(), 1, datatype);
+	}
+
+	size_t get_packed_size() const
+	{
+		return N * sizeof(double);
+	}
+
+	void pack(char* buffer) const
+	{
+		double* const packed = reinterpret_cast<double*>(buffer);
+		for (size_t i = 0; i < N; i++) {
+			packed[i] = this->data[2 * i];
+		}
+	}
+
+	void unpack(const char* buffer)
+	{
+		const double* const packed = reinterpret_cast<const double*>(buffer);
+		for (size_t i = 0; i < N; i++) {
+			this->data[2 * i] = packed[i];
+		}
+	}
+};
+
+/*!
+Cell whose number of doubles only its owner knows.
+
+Packed data starts with the number of doubles.
+*/
+struct Variable_Cell {
+	std::vector<double> data;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(this->data.data(), int(this->data.size()), MPI_DOUBLE);
+	}
+
+	size_t get_packed_size() const
+	{
+		return sizeof(uint64_t) + this->data.size() * sizeof(double);
+	}
+
+	void pack(char* buffer) const
+	{
+		const uint64_t size = this->data.size();
+		std::memcpy(buffer, &size, sizeof(uint64_t));
+		std::memcpy(buffer + sizeof(uint64_t), this->data.data(), size * sizeof(double));
+	}
+
+	void unpack(const char* buffer)
+	{
+		uint64_t size = 0;
+		std::memcpy(&size, buffer, sizeof(uint64_t));
+		this->data.resize(size);
+		std::memcpy(this->data.data(), buffer + sizeof(uint64_t), size * sizeof(double));
+	}
+};
+
+/*!
+Checks packed updates of cells whose size changes between updates.
+*/
+void check_variable_size(const uint64_t length, MPI_Comm comm)
+{
+	Dccrg<Variable_Cell, Cartesian_Geometry> grid;
+	grid
+		.set_initial_length({length, length, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_periodic(true, true, false)
+		.set_packed_remote_neighbor_updates(true)
+		.initialize(comm)
+		.balance_load();
+
+	for (const size_t step: {1, 3, 2}) {
+		for (const auto& cell: grid.local_cells) {
+			cell.data->data.assign(size_t(cell.id % 5) * step, double(cell.id));
+		}
+		grid.update_copies_of_remote_neighbors();
+
+		for (const auto& cell: grid.outer_cells) {
+			for (const auto& neighbor: cell.neighbors_of) {
+				if (
+					neighbor.data->data.size() != size_t(neighbor.id % 5) * step
+					or (
+						neighbor.data->data.size() > 0
+						and neighbor.data->data.back() != double(neighbor.id)
+					)
+				) {
+					cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Wrong data in copy of remote neighbor " << neighbor.id
+						<< " of cell " << cell.id
+						<< endl;
+					abort();
+				}
+			}
+		}
+	}
+}
+
+/*!
+Cell without stable_mpi_datatype.
+*/
+struct Unstable_Cell {
+	double data = 0;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(&(this->data), 1, MPI_DOUBLE);
+	}
+};
+
+/*!
+Checks neighbor collective updates of a user neighborhood
+of cells whose datatypes are recreated by every update.
+*/
+void check_user_neighborhood_collectives(const uint64_t length, MPI_Comm comm)
+{
+	Dccrg<Unstable_Cell, Cartesian_Geometry> grid;
+	grid
+		.set_initial_length({length, length, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_periodic(true, true, false)
+		.set_neighbor_collective_updates(true, 1)
+		.initialize(comm)
+		.balance_load();
+
+	if (!grid.add_neighborhood(1, {{{1, 0, 0}}, {{-1, 0, 0}}})) {
+		cerr << __FILE__ "(" << __LINE__ << "): Couldn't add neighborhood" << endl;
+		abort();
+	}
+
+	for (const double offset: {1, 2}) {
+		for (const auto& cell: grid.local_cells) {
+			cell.data->data = double(cell.id) + offset;
+		}
+		grid.update_copies_of_remote_neighbors(1);
+
+		for (const auto& cell: grid.local_cells) {
+			for (const auto& neighbor: *grid.get_neighbors_of(cell.id, 1)) {
+				if (grid[neighbor.first]->data != double(neighbor.first) + offset) {
+					cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Wrong data in copy of remote neighbor " << neighbor.first
+						<< " of cell " << cell.id
+						<< endl;
+					abort();
+				}
+			}
+		}
+	}
+}
+
+/*!
+Updates copies of remote neighbors given number of times in given grid.
+
+Returns maximum over processes of average time of one update in seconds.
+*/
+template<class Grid> double time_updates(Grid& grid, const size_t updates)
+{
+	// differs from data of previous calls
+	static double offset = 0;
+	offset++;
+
+	for (const auto& cell: grid.local_cells) {
+		cell.data->data.fill(double(cell.id) + offset);
+	}
+
+	MPI_Barrier(grid.get_communicator());
+	const auto before = high_resolution_clock::now();
+	for (size_t i = 0; i < updates; i++) {
+		grid.update_copies_of_remote_neighbors();
+	}
+	const auto after = high_resolution_clock::now();
+
+	for (const auto& cell: grid.outer_cells) {
+		for (const auto& neighbor: cell.neighbors_of) {
+			if (neighbor.data->data.front() != double(neighbor.id) + offset) {
+				cerr << __FILE__ "(" << __LINE__ << "): "
+					<< "Wrong data in copy of remote neighbor " << neighbor.id
+					<< " of cell " << cell.id
+					<< endl;
+				abort();
+			}
+		}
+	}
+
+	double time = duration_cast<duration<double>>(after - before).count() / updates;
+	MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, grid.get_communicator());
+	return time;
+}
+
+/*!
+Prints latency of remote neighbor updates with and without
+persistent requests, packed buffers and neighbor collectives.
+*/
+template<class Cell_Data> void benchmark(
+	const std::string& cell_name,
+	const uint64_t length,
+	const size_t updates,
+	MPI_Comm comm
+) {
+	Dccrg<Cell_Data, Cartesian_Geometry> grid;
+	grid
+		.set_initial_length({length, length, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(1)
+		.set_periodic(true, true, false)
+		.initialize(comm)
+		.balance_load();
+
+	// refine some cells for more complex messages
+	for (const auto& cell: grid.local_cells) {
+		if (cell.id % 7 == 0) {
+			grid.refine_completely(cell.id);
+		}
+	}
+	grid.stop_refining();
+	grid.clear_refined_unrefined_data();
+
+	for (const bool single_cells: {false, true}) {
+		grid.set_send_single_cells(single_cells);
+
+		grid.set_persistent_remote_neighbor_updates(false);
+		const auto normal = time_updates(grid, updates);
+		grid.set_persistent_remote_neighbor_updates(true);
+		const auto persistent = time_updates(grid, updates);
+
+		grid.set_persistent_remote_neighbor_updates(false);
+
+		if (grid.get_rank() == 0) {
+			cout << cell_name << ", "
+				<< (single_cells ? "one message per cell" : "one message per process")
+				<< ", microseconds per update: " << normal * 1e6
+				<< " normal, " << persistent * 1e6
+				<< " persistent, speedup " << normal / persistent
+				<< endl;
+		}
+	}
+
+	grid.set_send_single_cells(false);
+	const auto normal = time_updates(grid, updates);
+	grid.set_packed_remote_neighbor_updates(true);
+	const auto packed = time_updates(grid, updates);
+	grid.set_packed_remote_neighbor_updates(false);
+	grid.set_neighbor_collective_updates(true);
+	const auto collective = time_updates(grid, updates);
+	grid.set_neighbor_collective_updates(false);
+	if (grid.get_rank() == 0) {
+		cout << cell_name
+			<< ", one message per process, microseconds per update: " << normal * 1e6
+			<< " normal, " << packed * 1e6
+			<< " packed, speedup " << normal / packed
+			<< ", " << collective * 1e6
+			<< " neighbor collective, speedup " << normal / collective
+			<< endl;
+	}
+
+	// persistent requests and buffers must be recreated after cells move
+	const uint64_t next = (grid.get_rank() + 1) % grid.get_comm_size();
+	for (const auto& cell: grid.local_cells) {
+		if (cell.id % 3 == 0) {
+			grid.pin(cell.id, next);
+		}
+	}
+	grid.balance_load(false);
+	grid.unpin_all_cells();
+	grid.set_packed_remote_neighbor_updates(true);
+	time_updates(grid, 1);
+	grid.set_packed_remote_neighbor_updates(false);
+	grid.set_persistent_remote_neighbor_updates(true);
+	time_updates(grid, 1);
+	grid.set_persistent_remote_neighbor_updates(false);
+	grid.set_neighbor_collective_updates(true);
+	time_updates(grid, 1);
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+	    cout << "Zoltan_Initialize failed" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	uint64_t length = 100;
+	if (argc > 1) {
+		length = std::stoull(argv[1]);
+	}
+	size_t updates = 100;
+	if (argc > 2) {
+		updates = std::stoull(argv[2]);
+	}
+
+	benchmark<Cell<1>>("1 double per cell", length, updates, comm);
+	benchmark<Cell<64>>("64 doubles per cell", length, updates, comm);
+	benchmark<Strided_Cell<4>>("4 strided doubles per cell", length, updates, comm);
+	benchmark<Strided_Cell<64>>("64 strided doubles per cell", length, updates, comm);
+	benchmark<Packing_Cell<4>>("4 strided doubles per cell with pack()", length, updates, comm);
+	benchmark<Packing_Cell<64>>("64 strided doubles per cell with pack()", length, updates, comm);
+	check_variable_size(length, comm);
+	check_user_neighborhood_collectives(length, comm);
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
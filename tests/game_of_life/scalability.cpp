@@ -33,17 +33,7 @@ along with this program. If not, see <http://www.gnu.org/licenses/>.
 #include "dccrg_stretched_cartesian_geometry.hpp"
 #include "dccrg.hpp"
 
-// TODO: move this to a separate file
-struct game_of_life_cell {
-
-	// data[0] == 1 if cell is alive, data[1] holds the number of live neighbors
-	unsigned int data[2];
-
-	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
-	{
-		return std::make_tuple(&(this->data), 1, MPI_INT);
-	}
-};
+#include "game_of_life_cell.hpp"
 
 
 using namespace std;
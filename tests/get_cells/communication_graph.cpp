@@ -0,0 +1,177 @@
+/*
+Program for testing get_neighbor_processes() and get_communication_graph() of dccrg.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "algorithm"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "sstream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "dccrg.hpp"
+
+using namespace std;
+using namespace dccrg;
+
+struct Cell {
+	double data[3];
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple((void*) this->data, 3, MPI_DOUBLE);
+	}
+};
+
+typedef Dccrg<Cell> Grid;
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	Grid grid;
+	grid
+		.set_initial_length({10, 10, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.initialize(comm)
+		.balance_load();
+
+	// only cells in positive x direction
+	const int hood_id = 1;
+	const std::vector<Types<3>::neighborhood_item_t> hood{{{1, 0, 0}}};
+	if (not grid.add_neighborhood(hood_id, hood)) {
+		cerr << __FILE__ "(" << __LINE__ << "): Couldn't add neighborhood" << endl;
+		abort();
+	}
+
+	// processes must have each other as neighbors
+	const auto& neighbor_processes = grid.get_neighbor_processes();
+	std::vector<std::vector<uint64_t>> flags(comm_size), received_flags;
+	for (const auto process: neighbor_processes) {
+		if (process == uint64_t(rank) or process >= uint64_t(comm_size)) {
+			cerr << __FILE__ "(" << __LINE__ << "): Invalid neighbor process " << process << endl;
+			abort();
+		}
+		flags[process].push_back(1);
+	}
+	All_To_All()(flags, received_flags, comm);
+	for (int process = 0; process < comm_size; process++) {
+		if (received_flags[process].size() != neighbor_processes.count(process)) {
+			cerr << __FILE__ "(" << __LINE__ << "): Process " << rank
+				<< " and " << process << " disagree about being neighbors" << endl;
+			abort();
+		}
+	}
+	if (comm_size > 1 and neighbor_processes.size() == 0) {
+		cerr << __FILE__ "(" << __LINE__ << "): No neighbor processes" << endl;
+		abort();
+	}
+
+	// cells sent by one process must be received by the other,
+	// graph is available from a const grid
+	const Grid& const_grid = grid;
+	const auto graph = const_grid.get_communication_graph();
+	std::vector<std::vector<uint64_t>> edges(comm_size), received_edges;
+	for (const auto& edge: graph) {
+		if (neighbor_processes.count(edge.process) == 0) {
+			cerr << __FILE__ "(" << __LINE__ << "): Edge to non-neighbor " << edge.process << endl;
+			abort();
+		}
+		if (
+			edge.sent_bytes != edge.sent_cells * 3 * sizeof(double)
+			or edge.received_bytes != edge.received_cells * 3 * sizeof(double)
+		) {
+			cerr << __FILE__ "(" << __LINE__ << "): Wrong number of bytes" << endl;
+			abort();
+		}
+		edges[edge.process].push_back(uint64_t(edge.neighborhood_id));
+		edges[edge.process].push_back(edge.sent_cells);
+		edges[edge.process].push_back(edge.received_cells);
+	}
+	All_To_All()(edges, received_edges, comm);
+
+	size_t received_total = 0;
+	for (int process = 0; process < comm_size; process++) {
+		const auto& items = received_edges[process];
+		received_total += items.size() / 3;
+		for (size_t i = 0; i + 2 < items.size(); i += 3) {
+			const auto edge = find_if(graph.cbegin(), graph.cend(),
+				[&](const Grid::Communication_Graph_Edge& e) {
+					return e.process == process and e.neighborhood_id == int(items[i]);
+				}
+			);
+			if (
+				edge == graph.cend()
+				or edge->received_cells != items[i + 1]
+				or edge->sent_cells != items[i + 2]
+			) {
+				cerr << __FILE__ "(" << __LINE__ << "): Process " << rank
+					<< " and " << process << " disagree about cells of neighborhood "
+					<< int(items[i]) << endl;
+				abort();
+			}
+		}
+	}
+	if (received_total != graph.size()) {
+		cerr << __FILE__ "(" << __LINE__ << "): Processes disagree about number of edges" << endl;
+		abort();
+	}
+
+	// one line per edge and header
+	ostringstream csv, json;
+	const_grid.write_communication_graph_csv(csv);
+	const_grid.write_communication_graph_json(json);
+	const string csv_string = csv.str();
+	if (size_t(count(csv_string.begin(), csv_string.end(), '\n')) != graph.size() + 1) {
+		cerr << __FILE__ "(" << __LINE__ << "): Wrong number of CSV lines" << endl;
+		abort();
+	}
+	const string json_string = json.str();
+	if (size_t(count(json_string.begin(), json_string.end(), '{')) != graph.size() + 1) {
+		cerr << __FILE__ "(" << __LINE__ << "): Wrong number of JSON objects" << endl;
+		abort();
+	}
+
+	if (rank == 0) {
+		cout << csv_string << json_string;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
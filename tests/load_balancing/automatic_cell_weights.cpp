@@ -0,0 +1,260 @@
+/*
+Tests cell weights from measured costs with set_automatic_cell_weights().
+
+Known times are given to cells, cells at small z being more
+expensive, and after balancing the load their estimated costs
+must be correct on the new owners and the total cost of cells
+of processes must be balanced. Estimates must be smoothed,
+split between children of refined cells and summed for parents
+of unrefined cells. Times given from several threads must
+add up and Cell_Timer must give positive costs, and nothing
+if automatic cell weights are enabled while it's running.
+*/
+
+#include "algorithm"
+#include "cmath"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "memory"
+#include "stdexcept"
+#include "tuple"
+#include "unordered_map"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+#include "../../dccrg_thread_pool.hpp"
+
+#include "weights.hpp"
+
+using namespace std;
+using namespace dccrg;
+
+struct Cell {
+	double data = 0;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(&(this->data), 1, MPI_DOUBLE);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+/*!
+Returns the time given to cell in each step.
+*/
+double get_time(const Grid& grid, const uint64_t cell)
+{
+	return 1e-3 * get_weight(grid, cell);
+}
+
+bool is_close(const double a, const double b)
+{
+	return abs(a - b) <= 1e-12 * max(abs(a), abs(b));
+}
+
+/*!
+Aborts if estimated cost of any local cell differs from given factor times its time.
+*/
+void check_costs(const Grid& grid, const double factor, const int line)
+{
+	for (const auto& cell: grid.local_cells) {
+		const double expected = factor * get_time(grid, cell.id);
+		if (not is_close(grid.get_cell_cost(cell.id), expected)) {
+			cerr << __FILE__ << ":" << line
+				<< " Wrong cost for cell " << cell.id << ": " << grid.get_cell_cost(cell.id)
+				<< ", should be " << expected
+				<< endl;
+			abort();
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(8),
+			"Create a grid with arg number of unrefined cells in each direction");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(1)
+		.set_load_balancing_method("HILBERT")
+		.initialize(comm)
+		.set_geometry({
+			{0, 0, 0},
+			{1.0 / length, 1.0 / length, 1.0 / length}
+		})
+		.set_automatic_cell_weights(true)
+		.set_cell_cost_smoothing(1);
+
+	try {
+		grid.set_cell_cost_smoothing(0);
+		cerr << __FILE__ << ":" << __LINE__ << " Invalid smoothing accepted" << endl;
+		abort();
+	} catch (const std::invalid_argument&) {}
+
+	Thread_Pool pool(4);
+
+	// estimates move with cells and balance the load
+	for (int step = 0; step < 3; step++) {
+		pool.parallel_for(grid.local_cells, [&grid](const Grid::cells_item_t& cell) {
+			grid.add_cell_time(cell, get_time(grid, cell.id) / 3);
+		});
+	}
+	grid.balance_load();
+	check_costs(grid, 1, __LINE__);
+
+	double local_cost = 0, max_time = 0;
+	for (const auto& cell: grid.local_cells) {
+		local_cost += get_time(grid, cell.id);
+		max_time = max(max_time, get_time(grid, cell.id));
+	}
+	double total_cost = 0, max_cost = 0;
+	MPI_Allreduce(&local_cost, &total_cost, 1, MPI_DOUBLE, MPI_SUM, comm);
+	MPI_Allreduce(&local_cost, &max_cost, 1, MPI_DOUBLE, MPI_MAX, comm);
+	if (max_cost > total_cost / comm_size + max_time) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Process " << rank << " has too much cost: " << max_cost
+			<< ", average " << total_cost / comm_size
+			<< endl;
+		abort();
+	}
+
+	// without new measurements estimates don't change
+	grid.balance_load();
+	check_costs(grid, 1, __LINE__);
+
+	// smoothing
+	grid.set_cell_cost_smoothing(0.5);
+	for (const auto& cell: grid.local_cells) {
+		grid.add_cell_time(cell.id, 2 * get_time(grid, cell.id));
+	}
+	grid.balance_load();
+	check_costs(grid, 1.5, __LINE__);
+
+	// refined cells split their cost between children
+	for (const auto& cell: grid.local_cells) {
+		if (grid.geometry.get_center(cell.id)[0] < 0.5) {
+			grid.refine_completely(cell.id);
+		}
+	}
+	grid.stop_refining();
+	for (const auto& cell: grid.local_cells) {
+		const double expected
+			= grid.mapping.get_refinement_level(cell.id) > 0
+			? 1.5 / 8 * get_time(grid, grid.get_parent(cell.id))
+			: 1.5 * get_time(grid, cell.id);
+		if (not is_close(grid.get_cell_cost(cell.id), expected)) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong cost for cell " << cell.id << ": " << grid.get_cell_cost(cell.id)
+				<< ", should be " << expected
+				<< endl;
+			abort();
+		}
+	}
+
+	// unrefined cells give their cost to parent
+	for (const auto& cell: grid.local_cells) {
+		if (grid.mapping.get_refinement_level(cell.id) > 0) {
+			grid.unrefine_completely(cell.id);
+		}
+	}
+	grid.initialize_refines();
+	grid.execute_refines();
+	grid.finish_refining();
+	check_costs(grid, 1.5, __LINE__);
+
+	// measured times
+	pool.parallel_for(grid.local_cells, [&grid](const Grid::cells_item_t& cell) {
+		const Grid::Cell_Timer timer(grid, cell);
+		double sum = 0;
+		for (int i = 0; i < 1000; i++) {
+			sum += sqrt(double(i) + cell.data->data);
+		}
+		cell.data->data = sum;
+	});
+	grid.balance_load();
+	for (const auto& cell: grid.local_cells) {
+		const double cost = grid.get_cell_cost(cell.id);
+		if (not (cost > 0 and cost < 1)) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong measured cost for cell " << cell.id << ": " << cost
+				<< endl;
+			abort();
+		}
+	}
+
+	// timers measure only if automatic cell weights were enabled when started
+	unordered_map<uint64_t, double> costs;
+	for (const auto& cell: grid.local_cells) {
+		costs[cell.id] = grid.get_cell_cost(cell.id);
+	}
+	grid.set_automatic_cell_weights(false);
+	{
+		vector<unique_ptr<Grid::Cell_Timer>> timers;
+		for (const auto& cell: grid.local_cells) {
+			timers.emplace_back(new Grid::Cell_Timer(grid, cell));
+		}
+		grid.set_automatic_cell_weights(true);
+	}
+	// without moving cells
+	grid.balance_load(false);
+	for (const auto& cell: grid.local_cells) {
+		if (grid.get_cell_cost(cell.id) != costs.at(cell.id)) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Cost of cell " << cell.id << " changed by timer started without automatic weights: "
+				<< costs.at(cell.id) << " -> " << grid.get_cell_cost(cell.id)
+				<< endl;
+			abort();
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+/*
+Tests that a grid with distributed cell ownership behaves
+identically to a grid in which every process knows every cell.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cmath"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "vector"
+
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+using namespace std;
+using namespace dccrg;
+
+struct Cell {
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype() const
+	{
+		return std::make_tuple((void*) this, 0, MPI_BYTE);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+/*!
+Returns local cells of given grid and their sorted neighbor lists.
+*/
+vector<pair<uint64_t, vector<uint64_t>>> get_neighbor_lists(const Grid& grid)
+{
+	vector<pair<uint64_t, vector<uint64_t>>> neighbor_lists;
+
+	for (const uint64_t cell: grid.get_cells({}, false, default_neighborhood_id, true)) {
+		vector<uint64_t> neighbors;
+		for (const auto& neighbor: *grid.get_neighbors_of(cell)) {
+			neighbors.push_back(neighbor.first);
+		}
+		// separate neighbors_of from neighbors_to
+		neighbors.push_back(error_cell);
+		for (const auto& neighbor: *grid.get_neighbors_to(cell)) {
+			neighbors.push_back(neighbor.first);
+		}
+		sort(neighbors.begin(), neighbors.end());
+		neighbor_lists.push_back(make_pair(cell, neighbors));
+	}
+
+	return neighbor_lists;
+}
+
+/*!
+Aborts if the grids don't have the same local cells and neighbors.
+
+Returns the number of local cells.
+*/
+size_t compare(Grid& replicated, Grid& distributed, const string& step)
+{
+	if (get_neighbor_lists(replicated) != get_neighbor_lists(distributed)) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Local cells or neighbor lists differ after " << step
+			<< endl;
+		abort();
+	}
+
+	// query every cell in the grid from every process
+	vector<uint64_t> all_cells;
+	for (const auto& item: replicated.get_cell_process()) {
+		all_cells.push_back(item.first);
+	}
+	sort(all_cells.begin(), all_cells.end());
+	// also a few cells that don't exist
+	all_cells.push_back(error_cell);
+	all_cells.push_back(replicated.mapping.get_last_cell());
+
+	if (replicated.get_process(all_cells) != distributed.get_process(all_cells)) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Processes of cells differ after " << step
+			<< endl;
+		abort();
+	}
+
+	vector<array<double, 3>> coordinates;
+	for (double x = -0.25; x < 21; x += 0.5) {
+	for (double y = -0.25; y < 21; y += 0.5) {
+		coordinates.push_back({{x, y, 0.5}});
+	}}
+	if (replicated.get_existing_cells(coordinates) != distributed.get_existing_cells(coordinates)) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Existing cells at coordinates differ after " << step
+			<< endl;
+		abort();
+	}
+
+	if (
+		distributed.get_cell_process().size() > replicated.get_cell_process().size()
+		or (
+			distributed.get_comm_size() > 1
+			and distributed.get_cell_process().size() == replicated.get_cell_process().size()
+		)
+	) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Process " << distributed.get_rank()
+			<< " knows too many cells after " << step << ": "
+			<< distributed.get_cell_process().size()
+			<< ", total " << replicated.get_cell_process().size()
+			<< endl;
+		abort();
+	}
+
+	return get_neighbor_lists(distributed).size();
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+	    cout << "Zoltan_Initialize failed" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{0, 0, 0}};
+	geom_params.level_0_cell_length = {{1, 1, 1}};
+
+	Grid replicated, distributed;
+	for (Grid* grid: {&replicated, &distributed}) {
+		grid->set_distributed_ownership(grid == &distributed);
+		grid->set_initial_length({20, 20, 1})
+			.set_neighborhood_length(1)
+			.set_maximum_refinement_level(2)
+			.set_periodic(true, false, false)
+			.initialize(comm)
+			.set_geometry(geom_params);
+	}
+
+	if (not distributed.get_distributed_ownership()) {
+		cerr << __FILE__ << ":" << __LINE__ << " Ownership not distributed" << endl;
+		abort();
+	}
+
+	compare(replicated, distributed, "initialization");
+
+	// refine twice around a circle, unrefine its inside and move cells around
+	for (int step = 0; step < 4; step++) {
+
+		for (Grid* grid: {&replicated, &distributed}) {
+			for (const uint64_t cell: grid->get_cells()) {
+				const auto center = grid->geometry.get_center(cell);
+				const double distance = sqrt(
+					(center[0] - 7) * (center[0] - 7)
+					+ (center[1] - 9) * (center[1] - 9)
+				);
+
+				if (step < 2) {
+					if (distance > 3 and distance < 5) {
+						grid->refine_completely(cell);
+					}
+				} else if (distance < 3.5) {
+					grid->unrefine_completely(cell);
+				}
+			}
+			// unrefined cells' data is transferred to their parents
+			grid->initialize_refines();
+			grid->execute_refines();
+			grid->finish_refining();
+			grid->clear_refined_unrefined_data();
+		}
+		compare(replicated, distributed, "refining at step " + to_string(step));
+
+		// move cells of every process to the next process in a slab of the grid
+		for (Grid* grid: {&replicated, &distributed}) {
+			for (const uint64_t cell: grid->get_cells()) {
+				const auto center = grid->geometry.get_center(cell);
+				if (center[1] > 4 * step and center[1] < 4 * step + 8) {
+					grid->pin(cell, (rank + 1) % comm_size);
+				} else {
+					grid->unpin(cell);
+				}
+			}
+			grid->balance_load(false);
+		}
+		compare(replicated, distributed, "balancing load at step " + to_string(step));
+	}
+
+	// ownership can also be changed after initialization
+	distributed.set_distributed_ownership(false);
+	if (distributed.get_cell_process() != replicated.get_cell_process()) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Cell processes differ after disabling distributed ownership"
+			<< endl;
+		abort();
+	}
+	distributed.set_distributed_ownership(true);
+	const size_t local_cells = compare(replicated, distributed, "enabling distributed ownership");
+
+	const auto memory = distributed.get_memory_usage();
+	if (memory.at("cell_process") == 0 or memory.at("cell_directory") == 0) {
+		if (local_cells > 0) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << rank << " reported no memory usage"
+				<< endl;
+			abort();
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
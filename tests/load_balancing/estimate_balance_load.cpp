@@ -0,0 +1,184 @@
+/*
+Tests predicting results of load balancing with estimate_balance_load().
+
+Cells are weighted as in weights.hpp. Estimates must not change
+the grid and must agree with statistics of balance_load() called
+afterwards, and with the actual halo size, both with load
+balancing method HILBERT and incremental load balancing.
+*/
+
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+#include "weights.hpp"
+
+using namespace std;
+using namespace dccrg;
+
+struct Cell {
+	uint64_t data = 0;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(&(this->data), 1, MPI_UINT64_T);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+void set_weights(Grid& grid)
+{
+	for (const auto& cell: grid.local_cells) {
+		grid.set_cell_weight(cell.id, get_weight(grid, cell.id));
+	}
+}
+
+vector<uint64_t> get_local_cells(const Grid& grid)
+{
+	vector<uint64_t> cells;
+	for (const auto& cell: grid.local_cells) {
+		cells.push_back(cell.id);
+	}
+	return cells;
+}
+
+uint64_t get_halo_size(const Grid& grid, MPI_Comm comm)
+{
+	return All_Reduce()(uint64_t(grid.get_remote_cells_on_process_boundary_internal().size()), comm);
+}
+
+/*!
+Aborts if estimate doesn't match statistics of following balance_load().
+*/
+void check(Grid& grid, MPI_Comm comm, const string& name)
+{
+	int rank = 0;
+	MPI_Comm_rank(comm, &rank);
+
+	set_weights(grid);
+	const auto cells = get_local_cells(grid);
+	const auto estimate = grid.estimate_balance_load();
+	if (get_local_cells(grid) != cells) {
+		cerr << __FILE__ << ":" << __LINE__ << " " << name << ": Estimate changed local cells" << endl;
+		abort();
+	}
+	if (estimate.halo_before != get_halo_size(grid, comm)) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " " << name << ": Wrong halo size before balancing: " << estimate.halo_before
+			<< ", should be " << get_halo_size(grid, comm)
+			<< endl;
+		abort();
+	}
+
+	grid.balance_load();
+	const auto statistics = grid.get_load_balance_statistics();
+	const uint64_t halo_after = get_halo_size(grid, comm);
+	if (
+		estimate.imbalance_before != statistics.imbalance_before
+		or estimate.imbalance_after != statistics.imbalance_after
+		or estimate.cells_moved != statistics.cells_moved
+		or estimate.bytes_moved != statistics.bytes_moved
+		or estimate.bytes_moved != estimate.cells_moved * sizeof(uint64_t)
+		or estimate.halo_after != halo_after
+	) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " " << name << ": Estimate differs from load balancing: imbalance "
+			<< estimate.imbalance_before << " -> " << estimate.imbalance_after
+			<< " (" << statistics.imbalance_before << " -> " << statistics.imbalance_after
+			<< "), moved " << estimate.cells_moved << " (" << statistics.cells_moved
+			<< ") cells, " << estimate.bytes_moved << " (" << statistics.bytes_moved
+			<< ") bytes, halo " << estimate.halo_after << " (" << halo_after << ")"
+			<< endl;
+		abort();
+	}
+
+	if (rank == 0) {
+		cout << name << ": imbalance " << estimate.imbalance_before
+			<< " -> " << estimate.imbalance_after
+			<< ", moved " << estimate.cells_moved << " cells, "
+			<< estimate.bytes_moved << " bytes, halo "
+			<< estimate.halo_before << " -> " << estimate.halo_after
+			<< endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0;
+	MPI_Comm_rank(comm, &rank);
+
+	/*
+	Options
+	*/
+	uint64_t length;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(8),
+			"Create a grid with arg number of unrefined cells in each direction");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("HILBERT")
+		.initialize(comm)
+		.set_geometry({
+			{0, 0, 0},
+			{1.0 / length, 1.0 / length, 1.0 / length}
+		})
+		.set_load_balance_statistics(true);
+
+	check(grid, comm, "HILBERT");
+
+	grid.set_incremental_load_balancing(true);
+	for (const auto& cell: grid.local_cells) {
+		grid.pin(cell.id, 0);
+		break;
+	}
+	check(grid, comm, "Incremental");
+	grid.unpin_all_cells();
+	check(grid, comm, "Incremental");
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,257 @@
+/*
+Tests and benchmarks load balancing method HILBERT against Zoltan's RCB.
+
+A refined grid with varying cell weights is balanced several
+times with both methods and the time spent in balance_load()
+is printed, compile without DEBUG for meaningful timings.
+HILBERT must divide the total weight of cells evenly between
+processes and give the same partition when repeated. Consecutive
+cells on the curve through a uniform grid must be face neighbors.
+*/
+
+#include "algorithm"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "utility"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+using namespace std;
+using namespace dccrg;
+
+struct Cell {
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple((void*) this, 0, MPI_BYTE);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+/*!
+Returns the weight of given cell, larger at larger x.
+*/
+double get_weight(const Grid& grid, const uint64_t cell)
+{
+	return 1 + 3 * grid.geometry.get_center(cell)[0];
+}
+
+/*!
+Aborts if consecutive cells on Hilbert curve through a uniform grid aren't face neighbors.
+
+Grid has given number of cells in every dimension which must
+be a power of two so that the curve doesn't leave the grid.
+*/
+void check_curve(MPI_Comm comm, const uint64_t length)
+{
+	Grid grid;
+	grid
+		.set_initial_length({length, length, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.initialize(comm);
+
+	// curve index and cell of every cell in the grid
+	vector<pair<uint64_t, uint64_t>> curve;
+	for (uint64_t cell = 1; cell <= length * length * length; cell++) {
+		curve.push_back(make_pair(grid.get_hilbert_index(cell, 0), cell));
+	}
+	sort(curve.begin(), curve.end());
+
+	for (size_t i = 1; i < curve.size(); i++) {
+		const auto
+			previous = grid.mapping.get_indices(curve[i - 1].second),
+			current = grid.mapping.get_indices(curve[i].second);
+		uint64_t distance = 0;
+		for (size_t dim = 0; dim < 3; dim++) {
+			distance += max(previous[dim], current[dim]) - min(previous[dim], current[dim]);
+		}
+		if (curve[i].first != curve[i - 1].first + 1 or distance != 1) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Cells " << curve[i - 1].second << " and " << curve[i].second
+				<< " at curve indices " << curve[i - 1].first << " and " << curve[i].first
+				<< " of grid with length " << length << " aren't face neighbors"
+				<< endl;
+			abort();
+		}
+	}
+}
+
+/*!
+Balances the load of a new grid with given method given number of times.
+
+Returns time spent in balance_load(), checks results of HILBERT.
+*/
+double run(
+	const string& method,
+	MPI_Comm comm,
+	const uint64_t length,
+	const unsigned int iterations
+) {
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(2)
+		.set_load_balancing_method(method)
+		.initialize(comm)
+		.set_geometry({
+			{0, 0, 0},
+			{1.0 / length, 1.0 / length, 1.0 / length}
+		});
+
+	for (int round = 0; round < 2; round++) {
+		for (const auto& cell: grid.local_cells) {
+			const auto center = grid.geometry.get_center(cell.id);
+			const double
+				x = center[0] - 0.5,
+				y = center[1] - 0.5,
+				z = center[2] - 0.5;
+			if (sqrt(x * x + y * y + z * z) < 0.2) {
+				grid.refine_completely(cell.id);
+			}
+		}
+		grid.stop_refining();
+	}
+
+	uint64_t total_cells = 0;
+	for (const auto& cell: grid.local_cells) {
+		(void) cell;
+		total_cells++;
+	}
+	total_cells = All_Reduce()(total_cells, comm);
+
+	double time = 0;
+	vector<uint64_t> previous_cells;
+	for (unsigned int i = 0; i < iterations; i++) {
+		for (const auto& cell: grid.local_cells) {
+			grid.set_cell_weight(cell.id, get_weight(grid, cell.id));
+		}
+
+		MPI_Barrier(comm);
+		const double start = MPI_Wtime();
+		grid.balance_load();
+		time += MPI_Wtime() - start;
+
+		if (method != "HILBERT") {
+			continue;
+		}
+
+		uint64_t local_cells = 0;
+		double local_weight = 0, max_cell_weight = 0;
+		vector<uint64_t> cells;
+		for (const auto& cell: grid.local_cells) {
+			local_cells++;
+			const double weight = get_weight(grid, cell.id);
+			local_weight += weight;
+			max_cell_weight = max(max_cell_weight, weight);
+			cells.push_back(cell.id);
+		}
+		sort(cells.begin(), cells.end());
+
+		if (All_Reduce()(local_cells, comm) != total_cells) {
+			cerr << __FILE__ << ":" << __LINE__ << " Wrong number of cells" << endl;
+			abort();
+		}
+
+		double total_weight = 0, max_weight = 0, max_of_max_cell_weight = 0;
+		MPI_Allreduce(&local_weight, &total_weight, 1, MPI_DOUBLE, MPI_SUM, comm);
+		MPI_Allreduce(&local_weight, &max_weight, 1, MPI_DOUBLE, MPI_MAX, comm);
+		MPI_Allreduce(&max_cell_weight, &max_of_max_cell_weight, 1, MPI_DOUBLE, MPI_MAX, comm);
+		if (max_weight > total_weight / comm_size + max_of_max_cell_weight) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << rank << " has too much weight: " << max_weight
+				<< ", average " << total_weight / comm_size
+				<< endl;
+			abort();
+		}
+
+		if (i > 0 and cells != previous_cells) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << rank << " got different cells with same weights"
+				<< endl;
+			abort();
+		}
+		previous_cells = cells;
+	}
+
+	return time;
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length;
+	unsigned int iterations;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(12),
+			"Create a grid with arg number of unrefined cells in each direction")
+		("iterations",
+			boost::program_options::value<unsigned int>(&iterations)->default_value(3),
+			"Balance the load arg times with each method");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	for (const uint64_t curve_length: {2, 4, 8, 16}) {
+		check_curve(comm, curve_length);
+	}
+
+	const double
+		rcb_time = run("RCB", comm, length, iterations),
+		hilbert_time = run("HILBERT", comm, length, iterations);
+
+	if (rank == 0) {
+		cout << "Processes: " << comm_size
+			<< ", " << iterations << " load balancings with RCB: " << rcb_time
+			<< " s, HILBERT: " << hilbert_time << " s"
+			<< endl;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/*
+Tests incremental load balancing with set_incremental_load_balancing().
+
+Starting from the imbalanced partition given by weights.hpp the
+load is balanced incrementally several times and statistics
+of each call must agree with the actual load of processes, cell
+data must move with cells and the imbalance must decrease.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "stdexcept"
+#include "tuple"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+#include "weights.hpp"
+
+using namespace std;
+using namespace dccrg;
+
+struct Cell {
+	std::array<uint64_t, 4> data{{0, 0, 0, 0}};
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(this->data.data(), 4, MPI_UINT64_T);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length;
+	unsigned int iterations;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(16),
+			"Create a grid with arg number of unrefined cells in z direction")
+		("iterations",
+			boost::program_options::value<unsigned int>(&iterations)->default_value(20),
+			"Balance the load incrementally arg times");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	Grid grid;
+	grid
+		.set_initial_length({6, 6, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.set_geometry({
+			{0, 0, 0},
+			{1.0 / 6, 1.0 / 6, 1.0 / length}
+		})
+		.set_incremental_load_balancing(true)
+		.set_load_balance_statistics(true);
+
+	try {
+		grid.set_incremental_migration_limit(1.5);
+		cerr << __FILE__ << ":" << __LINE__ << " Invalid migration limit accepted" << endl;
+		abort();
+	} catch (const std::invalid_argument&) {}
+
+	for (const auto& cell: grid.local_cells) {
+		cell.data->data.fill(cell.id);
+	}
+
+	// nothing moves without migration
+	grid.set_incremental_migration_limit(0);
+	for (const auto& cell: grid.local_cells) {
+		grid.set_cell_weight(cell.id, get_weight(grid, cell.id));
+	}
+	grid.balance_load();
+	if (grid.get_load_balance_statistics().cells_moved != 0) {
+		cerr << __FILE__ << ":" << __LINE__ << " Cells moved with zero migration limit" << endl;
+		abort();
+	}
+
+	const double initial_imbalance = get_imbalance(grid, comm);
+	double imbalance = initial_imbalance;
+	grid.set_incremental_migration_limit(0.2);
+	for (unsigned int i = 0; i < iterations; i++) {
+		for (const auto& cell: grid.local_cells) {
+			grid.set_cell_weight(cell.id, get_weight(grid, cell.id));
+		}
+		grid.balance_load();
+
+		const auto statistics = grid.get_load_balance_statistics();
+		const double new_imbalance = get_imbalance(grid, comm);
+		if (
+			abs(statistics.imbalance_before - imbalance) > 1e-9
+			or abs(statistics.imbalance_after - new_imbalance) > 1e-9
+			or statistics.bytes_moved != statistics.cells_moved * sizeof(Cell::data)
+			or new_imbalance > imbalance + 1e-9
+		) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong statistics: imbalance before " << statistics.imbalance_before
+				<< " (" << imbalance << "), after " << statistics.imbalance_after
+				<< " (" << new_imbalance << "), moved " << statistics.cells_moved
+				<< " cells and " << statistics.bytes_moved << " bytes"
+				<< endl;
+			abort();
+		}
+		imbalance = new_imbalance;
+
+		if (rank == 0) {
+			cout << "Imbalance " << statistics.imbalance_before
+				<< " -> " << statistics.imbalance_after
+				<< ", moved " << statistics.cells_moved << " cells, "
+				<< statistics.bytes_moved << " bytes" << endl;
+		}
+	}
+
+	for (const auto& cell: grid.local_cells) {
+		for (const auto& value: cell.data->data) {
+			if (value != cell.id) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Wrong data in cell " << cell.id << ": " << value
+					<< endl;
+				abort();
+			}
+		}
+	}
+
+	if (comm_size > 1 and imbalance > 1 + (initial_imbalance - 1) / 2) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Imbalance decreased too little: " << initial_imbalance
+			<< " -> " << imbalance
+			<< endl;
+		abort();
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
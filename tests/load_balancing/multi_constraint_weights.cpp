@@ -0,0 +1,168 @@
+/*
+Tests several weights per cell with set_cell_weights().
+
+Cells at small z are expensive to compute and cells at large z
+use a lot of memory. Balancing the load with load balancing
+method HILBERT using only compute weights leaves memory
+imbalanced, balancing with both weights must improve the
+memory balance while keeping compute reasonably balanced.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "tuple"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+#include "weights.hpp"
+
+using namespace std;
+using namespace dccrg;
+
+struct Cell {
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple((void*) this, 0, MPI_BYTE);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+/*!
+Returns memory weight of given cell, compute weight is get_weight().
+*/
+double get_memory_weight(const Grid& grid, const uint64_t cell)
+{
+	return grid.geometry.get_center(cell)[2] > 0.7 ? 4 : 1;
+}
+
+/*!
+Returns compute and memory weights of given cell.
+*/
+std::array<double, 2> get_weights(const Grid& grid, const uint64_t cell)
+{
+	return {{get_weight(grid, cell), get_memory_weight(grid, cell)}};
+}
+
+/*!
+Returns maximum of weights of processes divided by average for both weights.
+*/
+std::array<double, 2> get_imbalances(const Grid& grid, MPI_Comm comm)
+{
+	return {{
+		get_imbalance(grid, comm),
+		get_imbalance(grid, comm, get_memory_weight)
+	}};
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(10),
+			"Create a grid with arg number of unrefined cells in each direction");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("HILBERT")
+		.initialize(comm)
+		.set_geometry({
+			{0, 0, 0},
+			{1.0 / length, 1.0 / length, 1.0 / length}
+		});
+
+	// compute only
+	for (const auto& cell: grid.local_cells) {
+		if (not grid.set_cell_weights(cell.id, std::array<double, 1>{{get_weights(grid, cell.id)[0]}})) {
+			cerr << __FILE__ << ":" << __LINE__ << " Couldn't set weights of cell " << cell.id << endl;
+			abort();
+		}
+	}
+	grid.balance_load();
+	const auto single = get_imbalances(grid, comm);
+
+	// compute and memory
+	for (const auto& cell: grid.local_cells) {
+		const auto weights = get_weights(grid, cell.id);
+		if (not grid.set_cell_weights(cell.id, weights)) {
+			cerr << __FILE__ << ":" << __LINE__ << " Couldn't set weights of cell " << cell.id << endl;
+			abort();
+		}
+		if (grid.get_cell_weight(cell.id) != weights[0]) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong first weight of cell " << cell.id << ": " << grid.get_cell_weight(cell.id)
+				<< endl;
+			abort();
+		}
+	}
+	grid.balance_load();
+	const auto multi = get_imbalances(grid, comm);
+
+	if (rank == 0) {
+		cout << "Compute and memory imbalance with one weight: "
+			<< single[0] << ", " << single[1]
+			<< ", with two weights: " << multi[0] << ", " << multi[1]
+			<< endl;
+	}
+
+	if (comm_size > 1 and (multi[1] >= single[1] or multi[0] > 1.5)) {
+		cerr << __FILE__ << ":" << __LINE__ << " Two weights weren't balanced" << endl;
+		abort();
+	}
+
+	// weights are removed by balance_load()
+	if (grid.get_additional_cell_weights().size() > 0) {
+		cerr << __FILE__ << ":" << __LINE__ << " Weights remain after balancing" << endl;
+		abort();
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+/*
+Cell weights and load imbalance shared by load balancing tests.
+
+Cells at small z are heavier so a partition with an equal
+number of cells on every process is imbalanced.
+*/
+
+#ifndef WEIGHTS_HPP
+#define WEIGHTS_HPP
+
+#include "cstdint"
+
+#include "mpi.h"
+
+/*!
+Returns the weight of given cell, 4 at z < 0.3 and 1 elsewhere.
+*/
+template<class Grid> double get_weight(const Grid& grid, const uint64_t cell)
+{
+	return grid.geometry.get_center(cell)[2] < 0.3 ? 4 : 1;
+}
+
+/*!
+Returns maximum total weight of local cells of processes divided by average.
+
+Weight of each cell is returned by get_cell_weight(grid, cell).
+*/
+template<class Grid, class Weight_Function> double get_imbalance(
+	const Grid& grid,
+	MPI_Comm comm,
+	Weight_Function get_cell_weight
+) {
+	int comm_size = 0;
+	MPI_Comm_size(comm, &comm_size);
+
+	double local_weight = 0, max_weight = 0, total_weight = 0;
+	for (const auto& cell: grid.local_cells) {
+		local_weight += get_cell_weight(grid, cell.id);
+	}
+	MPI_Allreduce(&local_weight, &max_weight, 1, MPI_DOUBLE, MPI_MAX, comm);
+	MPI_Allreduce(&local_weight, &total_weight, 1, MPI_DOUBLE, MPI_SUM, comm);
+	return total_weight > 0 ? max_weight * comm_size / total_weight : 1;
+}
+
+/*!
+Returns imbalance of weights given by get_weight().
+*/
+template<class Grid> double get_imbalance(const Grid& grid, MPI_Comm comm)
+{
+	return get_imbalance(grid, comm, get_weight<Grid>);
+}
+
+#endif
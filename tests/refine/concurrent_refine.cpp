@@ -0,0 +1,222 @@
+/*
+Tests and times refinement requests made concurrently from several threads.
+
+Two identical grids are adapted with the same criteria, one with
+serial refinement functions called in a fixed order and one with
+thread-safe versions called from a thread pool, after which their
+cells must be identical. Number of threads can be given as the
+first argument, compile without DEBUG for meaningful timings.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "algorithm"
+#include "array"
+#include "chrono"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+#include "hash.hpp"
+
+
+using namespace std;
+using namespace std::chrono;
+using namespace dccrg;
+
+struct Cell {
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(this, 0, MPI_BYTE);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+/*!
+Returns kind of refinement request for given cell.
+
+0 == none, 1 == dont_refine, 2 == refine, 3 == dont_unrefine, 4 == unrefine
+*/
+int get_request(const Grid& grid, const uint64_t cell, const size_t step)
+{
+	const auto ref_lvl = grid.get_refinement_level(cell);
+	const auto hash = get_hash(cell, step) % 64;
+	if (ref_lvl < grid.get_maximum_refinement_level()) {
+		if (hash < 2) {
+			return 1;
+		}
+		if (hash < 8) {
+			return 2;
+		}
+	}
+	if (ref_lvl > 0) {
+		if (hash == 8) {
+			return 3;
+		}
+		if (hash < 16) {
+			return 4;
+		}
+	}
+	return 0;
+}
+
+/*!
+Makes requests of given grid with serial refinement functions.
+
+Requests of each kind are made in order of cell id like
+the concurrent ones in stop_refining().
+*/
+void request_serially(Grid& grid, const size_t step)
+{
+	std::array<std::vector<uint64_t>, 5> requests;
+	for (const auto& cell: grid.local_cells) {
+		requests[get_request(grid, cell.id, step)].push_back(cell.id);
+	}
+	for (auto& cells: requests) {
+		std::sort(cells.begin(), cells.end());
+	}
+
+	for (const auto& cell: requests[1]) {
+		grid.dont_refine(cell);
+	}
+	for (const auto& cell: requests[2]) {
+		grid.refine_completely(cell);
+	}
+	for (const auto& cell: requests[3]) {
+		grid.dont_unrefine(cell);
+	}
+	for (const auto& cell: requests[4]) {
+		grid.unrefine_completely(cell);
+	}
+}
+
+/*!
+Makes requests of given grid with thread-safe refinement functions.
+*/
+void request_concurrently(Grid& grid, Thread_Pool& pool, const size_t step)
+{
+	pool.parallel_for(grid.local_cells, [&grid, step](const Grid::cells_item_t& cell) {
+		switch (get_request(grid, cell.id, step)) {
+		case 1:
+			grid.dont_refine_concurrent(cell.id);
+			break;
+		case 2:
+			grid.refine_completely_concurrent(cell.id);
+			break;
+		case 3:
+			grid.dont_unrefine_concurrent(cell.id);
+			break;
+		case 4:
+			grid.unrefine_completely_concurrent(cell.id);
+			break;
+		default:
+			break;
+		}
+	});
+}
+
+/*!
+Aborts if local cells of given grids differ.
+*/
+void compare(const Grid& serial, const Grid& concurrent, const size_t step)
+{
+	if (
+		serial.get_cells({}, false, default_neighborhood_id, true)
+		!= concurrent.get_cells({}, false, default_neighborhood_id, true)
+	) {
+		cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Different cells at step " << step << std::endl;
+		abort();
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+	    cout << "Zoltan_Initialize failed" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	size_t threads = 4;
+	if (argc > 1) {
+		threads = std::stoull(argv[1]);
+	}
+	constexpr size_t STEPS = 5;
+
+	Thread_Pool pool(threads);
+
+	Grid serial, concurrent;
+	for (auto* grid: {&serial, &concurrent}) {
+		grid
+			->set_initial_length({8, 8, 3})
+			.set_neighborhood_length(1)
+			.set_maximum_refinement_level(2)
+			.initialize(comm);
+	}
+
+	// [0] == serial, [1] == concurrent
+	std::array<double, 2> request_time{{0, 0}};
+	for (size_t step = 1; step <= STEPS; step++) {
+		auto before = high_resolution_clock::now();
+		request_serially(serial, step);
+		auto after = high_resolution_clock::now();
+		request_time[0] += duration_cast<duration<double>>(after - before).count();
+
+		before = high_resolution_clock::now();
+		request_concurrently(concurrent, pool, step);
+		after = high_resolution_clock::now();
+		request_time[1] += duration_cast<duration<double>>(after - before).count();
+
+		serial.stop_refining();
+		serial.clear_refined_unrefined_data();
+		concurrent.stop_refining();
+		concurrent.clear_refined_unrefined_data();
+		compare(serial, concurrent, step);
+	}
+
+	if (rank == 0) {
+		cout << "Process 0 with " << serial.get_cells().size()
+			<< " cells, requests: " << request_time[0]
+			<< " s serial, " << request_time[1]
+			<< " s with " << pool.size() << " threads" << endl;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+/*
+Pseudo-random numbers for refining and balancing cells in refine tests.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include "cstdint"
+
+/*!
+Returns a pseudo-random number that depends only on given cell and step.
+
+Identical on all processes so all of them
+make the same decisions about a cell.
+*/
+uint64_t get_hash(const uint64_t cell, const uint64_t step)
+{
+	uint64_t hash = (cell + 1) * 0x9E3779B97F4A7C15ull + step * 0xC2B2AE3D27D4EB4Full;
+	hash ^= hash >> 29;
+	hash *= 0xBF58476D1CE4E5B9ull;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+#endif
@@ -0,0 +1,221 @@
+/*
+Tests and times incremental updates of cell iterators after refining and load balancing.
+
+Two identical grids are refined, unrefined and balanced identically,
+one with incremental iterator updates and one without, after which
+their cell iterators must be identical. Time spent in stop_refining()
+and balance_load() is printed for both, compile without DEBUG for
+meaningful timings.
+
+Copyright 2018 Finnish Meteorological Institute
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License version 3
+as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "array"
+#include "chrono"
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+#include "hash.hpp"
+
+
+using namespace std;
+using namespace std::chrono;
+using namespace dccrg;
+
+struct Cell {
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(this, 0, MPI_BYTE);
+	}
+};
+
+typedef Dccrg<Cell, Cartesian_Geometry> Grid;
+
+/*!
+Aborts if cell iterators of given grids differ.
+*/
+void compare(const Grid& incremental, const Grid& full, const size_t step)
+{
+	auto full_cell = full.local_cells.begin();
+	for (const auto& cell: incremental.local_cells) {
+		if (full_cell == full.local_cells.end() or cell.id != full_cell->id) {
+			cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Different cells at step " << step << std::endl;
+			abort();
+		}
+
+		const std::array<
+			std::pair<decltype(cell.neighbors_of), decltype(cell.neighbors_of)>, 2
+		> neighbors{{
+			{cell.neighbors_of, full_cell->neighbors_of},
+			{cell.neighbors_to, full_cell->neighbors_to}
+		}};
+		for (const auto& item: neighbors) {
+			auto full_neighbor = item.second.begin();
+			for (const auto& neighbor: item.first) {
+				if (
+					full_neighbor == item.second.end()
+					or neighbor.id != full_neighbor->id
+					or neighbor.x != full_neighbor->x
+					or neighbor.y != full_neighbor->y
+					or neighbor.z != full_neighbor->z
+					or neighbor.denom != full_neighbor->denom
+				) {
+					cerr << __FILE__ "(" << __LINE__ << "): "
+						<< "Different neighbors of cell " << cell.id
+						<< " at step " << step << std::endl;
+					abort();
+				}
+				full_neighbor++;
+			}
+			if (full_neighbor != item.second.end()) {
+				cerr << __FILE__ "(" << __LINE__ << "): "
+					<< "Different number of neighbors of cell " << cell.id
+					<< " at step " << step << std::endl;
+				abort();
+			}
+		}
+
+		full_cell++;
+	}
+	if (full_cell != full.local_cells.end()) {
+		cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Different number of cells at step " << step << std::endl;
+		abort();
+	}
+}
+
+/*!
+Refines and unrefines a few percent of given grid's cells.
+
+Returns time spent in stop_refining().
+*/
+double adapt(Grid& grid, const size_t step)
+{
+	const auto max_ref_lvl = grid.get_maximum_refinement_level();
+	for (const auto& cell: grid.local_cells) {
+		const auto ref_lvl = grid.get_refinement_level(cell.id);
+		const auto hash = get_hash(cell.id, step);
+		if (ref_lvl < max_ref_lvl and hash % 32 == 0) {
+			grid.refine_completely(cell.id);
+		} else if (ref_lvl > 0 and hash % 32 == 1) {
+			grid.unrefine_completely(cell.id);
+		}
+	}
+
+	MPI_Barrier(grid.get_communicator());
+	const auto before = high_resolution_clock::now();
+	grid.stop_refining();
+	const auto after = high_resolution_clock::now();
+	grid.clear_refined_unrefined_data();
+
+	return duration_cast<duration<double>>(after - before).count();
+}
+
+/*!
+Moves a few percent of given grid's cells to next process.
+
+Returns time spent in balance_load().
+*/
+double move(Grid& grid, const size_t step)
+{
+	const uint64_t next = (grid.get_rank() + 1) % grid.get_comm_size();
+	for (const auto& cell: grid.local_cells) {
+		if (get_hash(cell.id, step) % 16 == 2) {
+			grid.pin(cell.id, next);
+		}
+	}
+
+	MPI_Barrier(grid.get_communicator());
+	const auto before = high_resolution_clock::now();
+	grid.balance_load(false);
+	const auto after = high_resolution_clock::now();
+	grid.unpin_all_cells();
+
+	return duration_cast<duration<double>>(after - before).count();
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+	    cout << "Zoltan_Initialize failed" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	uint64_t length = 8;
+	if (argc > 1) {
+		length = std::stoull(argv[1]);
+	}
+	constexpr size_t STEPS = 5;
+
+	Grid incremental, full;
+	for (auto* grid: {&incremental, &full}) {
+		grid
+			->set_initial_length({length, length, 3})
+			.set_neighborhood_length(1)
+			.set_maximum_refinement_level(2)
+			.set_incremental_iterator_updates(grid == &incremental)
+			.initialize(comm);
+	}
+	compare(incremental, full, 0);
+
+	// [0] == stop_refining(), [1] == balance_load()
+	std::array<double, 2> incremental_time{{0, 0}}, full_time{{0, 0}};
+	for (size_t step = 1; step <= STEPS; step++) {
+		incremental_time[0] += adapt(incremental, step);
+		full_time[0] += adapt(full, step);
+		compare(incremental, full, step);
+
+		incremental_time[1] += move(incremental, step);
+		full_time[1] += move(full, step);
+		compare(incremental, full, step);
+	}
+
+	if (rank == 0) {
+		cout << "Process 0 with " << distance(incremental.local_cells.begin(), incremental.local_cells.end())
+			<< " cells, stop_refining(): " << incremental_time[0]
+			<< " s incremental, " << full_time[0]
+			<< " s full, balance_load(): " << incremental_time[1]
+			<< " s incremental, " << full_time[1]
+			<< " s full" << endl;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -1,13 +1,18 @@
 /*
-Tests the speed of refining the grid in 3-d by refining random cells until enough cell exist
+Tests the speed of refining the grid in 3-d by refining random cells until enough cell exist.
+
+Two identical grids are refined identically, one spreading refinement
+requests to all processes and one only to neighboring processes (see
+Dccrg::set_neighbor_refine_propagation()), after which their cells must
+be identical. Time spent in stop_refining() is printed for both,
+compile without DEBUG for meaningful timings.
 */
 
+#include "algorithm"
+#include "cstdint"
 #include "cstdlib"
-#include "ctime"
-#include "fstream"
-#include "functional"
 #include "iostream"
-#include "sstream"
+#include "vector"
 
 #include "boost/program_options.hpp"
 #include "mpi.h"
@@ -15,6 +20,8 @@ Tests the speed of refining the grid in 3-d by refining random cells until enoug
 
 #include "../../dccrg.hpp"
 
+#include "hash.hpp"
+
 
 using namespace std;
 using namespace dccrg;
@@ -26,6 +33,41 @@ struct Cell {
 	}
 };
 
+typedef Dccrg<Cell> Grid;
+
+/*!
+Refines a fraction of given grid's local cells and prevents refining a few.
+
+Returns new cells and time spent in stop_refining().
+*/
+pair<vector<uint64_t>, double> refine(
+	Grid& grid,
+	const uint64_t round,
+	const uint64_t max_refines,
+	const double max_refine_fraction
+) {
+	const auto cells = grid.get_cells({}, false, default_neighborhood_id, true);
+	const uint64_t refine_limit = uint64_t(1000 * max_refine_fraction);
+
+	uint64_t refined = 0;
+	for (const auto& cell: cells) {
+		const uint64_t hash = get_hash(cell, round) % 1000;
+		if (hash < refine_limit and refined < max_refines) {
+			grid.refine_completely(cell);
+			refined++;
+		} else if (hash >= 995) {
+			grid.dont_refine(cell);
+		}
+	}
+
+	MPI_Barrier(grid.get_communicator());
+	const double before = MPI_Wtime();
+	const auto new_cells = grid.stop_refining(true);
+	const double after = MPI_Wtime();
+
+	return make_pair(new_cells, after - before);
+}
+
 int main(int argc, char* argv[])
 {
 	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
@@ -55,19 +97,19 @@ int main(int argc, char* argv[])
 	options.add_options()
 		("help", "print this help message")
 		("x_length",
-			boost::program_options::value<uint64_t>(&x_length)->default_value(22),
+			boost::program_options::value<uint64_t>(&x_length)->default_value(8),
 			"Create a grid with arg number of unrefined cells in the x direction")
 		("y_length",
-			boost::program_options::value<uint64_t>(&y_length)->default_value(22),
+			boost::program_options::value<uint64_t>(&y_length)->default_value(8),
 			"Create a grid with arg number of unrefined cells in the y direction")
 		("z_length",
-			boost::program_options::value<uint64_t>(&z_length)->default_value(22),
+			boost::program_options::value<uint64_t>(&z_length)->default_value(8),
 			"Create a grid with arg number of unrefined cells in the z direction")
 		("maximum_refinement_level",
 			boost::program_options::value<int>(&maximum_refinement_level)->default_value(-1),
 			"Maximum refinement level of the grid (0 == not refined, -1 == maximum possible for given lengths)")
 		("maximum_cells",
-			boost::program_options::value<uint64_t>(&maximum_cells)->default_value(1061208),
+			boost::program_options::value<uint64_t>(&maximum_cells)->default_value(3000),
 			"Stop refining after grid has arg number of total cells")
 		("max_refines",
 			boost::program_options::value<uint64_t>(&max_refines)->default_value(1000),
@@ -94,49 +136,55 @@ int main(int argc, char* argv[])
 	}
 
 	// initialize
-	Dccrg<Cell> grid;
-
-	const std::array<uint64_t, 3> grid_length = {{x_length, y_length, z_length}};
-	grid.initialize(grid_length, comm, "RCB", neighborhood_size, maximum_refinement_level);
-	grid.balance_load();
-
-	vector<uint64_t> cells = grid.get_cells();
-	const uint64_t initial_cells = cells.size();
+	Grid global, neighbor;
+	for (auto* grid: {&global, &neighbor}) {
+		grid
+			->set_initial_length({x_length, y_length, z_length})
+			.set_neighborhood_length(neighborhood_size)
+			.set_maximum_refinement_level(maximum_refinement_level)
+			.set_neighbor_refine_propagation(grid == &neighbor)
+			.set_load_balancing_method("RCB")
+			.initialize(comm)
+			.balance_load();
+	}
 
-	clock_t before, after, total = 0;
+	const uint64_t initial_cells = global.get_cells().size();
 
-	size_t local_cells = cells.size(), total_cells = 0;
+	double global_time = 0, neighbor_time = 0;
+	uint64_t round = 0, total_cells = 0;
 	do {
-		random_shuffle(cells.begin(), cells.end());
-
-		// refine a fraction of all cells each round
-		before = clock();
-		uint64_t refined = 0;
-		for (int i = 0; i < int(cells.size() * max_refine_fraction) && refined < max_refines; i++) {
-			grid.refine_completely(cells[i]);
-			refined++;
+		const auto global_result = refine(global, round, max_refines, max_refine_fraction);
+		const auto neighbor_result = refine(neighbor, round, max_refines, max_refine_fraction);
+		global_time += global_result.second;
+		neighbor_time += neighbor_result.second;
+		round++;
+
+		if (
+			global_result.first != neighbor_result.first
+			or global.get_cells({}, false, default_neighborhood_id, true)
+				!= neighbor.get_cells({}, false, default_neighborhood_id, true)
+		) {
+			cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Process " << rank << ": different cells after round " << round
+				<< endl;
+			abort();
 		}
-		vector<uint64_t> new_cells = grid.stop_refining();
-		after = clock();
-		total += after - before;
-		cout << "Proc " << rank << ": " << new_cells.size() << " new cells" << endl;
 
-		cells = grid.get_cells();
-
-		local_cells = cells.size();
+		const uint64_t local_cells = global.get_cells().size();
 		total_cells = 0;
 		MPI_Allreduce(&local_cells, &total_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
 	} while (total_cells < maximum_cells);
 
+	const uint64_t new_cells = global.get_cells().size() - initial_cells;
 	cout << "Process " << rank
-		<< ": " << cells.size() - initial_cells
-		<< " new cells created in " << double(total) / CLOCKS_PER_SEC
-		<< " s, (" << (cells.size() - initial_cells) / (double(total) / CLOCKS_PER_SEC)
-		<< " new cells / s)"
+		<< ": " << new_cells << " new cells created in " << round
+		<< " rounds, stop_refining(): " << global_time
+		<< " s (" << new_cells / global_time << " new cells / s) with global propagation, "
+		<< neighbor_time
+		<< " s (" << new_cells / neighbor_time << " new cells / s) with neighbor propagation"
 		<< endl;
 
 	MPI_Finalize();
 
 	return EXIT_SUCCESS;
 }
-
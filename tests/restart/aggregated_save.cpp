@@ -0,0 +1,253 @@
+/*
+Tests the speed of saving grid data with and without save aggregators.
+
+Cells have varying amounts of data as in variable_cell_data.cpp.
+The grid is saved with different numbers of save aggregators,
+all files must be identical and the last one is loaded and verified.
+Time spent in save_grid_data() is printed for each number of
+aggregators, compile without DEBUG for meaningful timings.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "iterator"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+
+using namespace std;
+
+struct Cell
+{
+public:
+	uint64_t data_size = 0;
+	std::vector<int> data;
+
+	static bool transfer_all, transfer_data;
+
+	std::tuple<
+		void*,
+		int,
+		MPI_Datatype
+	> get_mpi_datatype() const
+	{
+		if (Cell::transfer_all) {
+			std::array<int, 2> counts = {{1, int(this->data.size())}};
+			std::array<MPI_Aint, 2> displacements = {{
+				0,
+				(uint8_t*) this->data.data() - (uint8_t*) &(this->data_size)
+			}};
+			if (this->data.size() == 0) {
+				displacements[1] = 0;
+			}
+			std::array<MPI_Datatype, 2> datatypes = {{MPI_UINT64_T, MPI_INT}};
+
+			MPI_Datatype final_datatype;
+			const int ret_val = MPI_Type_create_struct(
+				2,
+				&counts[0],
+				&displacements[0],
+				&datatypes[0],
+				&final_datatype
+			);
+			if (ret_val != MPI_SUCCESS) {
+				std::cerr << __FILE__ << ":" << __LINE__
+					<< " MPI_Type_create_struct failed: " << dccrg::Error_String()(ret_val)
+					<< std::endl;
+				abort();
+			}
+
+			return std::make_tuple((void*) &(this->data_size), 1, final_datatype);
+
+		} else if (Cell::transfer_data) {
+			return std::make_tuple((void*) this->data.data(), int(this->data.size()), MPI_INT);
+		} else {
+			return std::make_tuple((void*) &(this->data_size), 1, MPI_UINT64_T);
+		}
+	}
+};
+
+bool
+	Cell::transfer_all = true,
+	Cell::transfer_data = false;
+
+typedef dccrg::Dccrg<Cell, dccrg::Cartesian_Geometry> Grid;
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length, stripe_size;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(300),
+			"Create a grid with arg number of cells in x direction, cell i has i % 4 == 0 ? 0 : i ints")
+		("stripe_size",
+			boost::program_options::value<uint64_t>(&stripe_size)->default_value(4096),
+			"Align file ranges written by save aggregators to arg bytes");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	std::tuple<void*, int, MPI_Datatype> header;
+	std::get<0>(header) = &header;
+	std::get<1>(header) = 0;
+	std::get<2>(header) = MPI_INT;
+
+	Grid grid;
+	grid
+		.set_initial_length({length, 1, 1})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.set_save_stripe_size(stripe_size)
+		.initialize(comm)
+		.balance_load();
+
+	for (const auto& cell: grid.local_cells) {
+		if (cell.id % 4 != 0) {
+			for (uint64_t i = 0; i < cell.id; i++) {
+				cell.data->data.push_back(int(i));
+			}
+		}
+		cell.data->data_size = cell.data->data.size();
+	}
+
+	vector<int> aggregators{0, 1, max(1, comm_size / 2), comm_size};
+	aggregators.erase(unique(aggregators.begin(), aggregators.end()), aggregators.end());
+
+	vector<string> names;
+	for (const auto& number_of_aggregators: aggregators) {
+		names.push_back("aggregated_save_" + to_string(number_of_aggregators) + ".dc");
+		grid.set_save_aggregators(number_of_aggregators);
+
+		MPI_Barrier(comm);
+		const double before = MPI_Wtime();
+		if (!grid.save_grid_data(names.back(), 0, header)) {
+			cerr << "Process " << rank
+				<< " Writing grid to file " << names.back() << " failed"
+				<< endl;
+			abort();
+		}
+		MPI_Barrier(comm);
+		const double after = MPI_Wtime();
+
+		if (rank == 0) {
+			cout << comm_size << " processes, " << number_of_aggregators
+				<< " save aggregators: " << after - before << " s"
+				<< endl;
+		}
+	}
+
+	// files must be identical
+	if (rank == 0) {
+		ifstream first_file(names[0], ios::binary);
+		const vector<char> first_data{istreambuf_iterator<char>(first_file), istreambuf_iterator<char>()};
+		for (size_t i = 1; i < names.size(); i++) {
+			ifstream file(names[i], ios::binary);
+			const vector<char> data{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+			if (first_data.size() == 0 or data != first_data) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Files " << names[0] << " and " << names[i] << " differ"
+					<< endl;
+				abort();
+			}
+		}
+	}
+	MPI_Barrier(comm);
+
+	// last file must be loadable
+	Grid loaded;
+	if (!loaded.start_loading_grid_data(names.back(), 0, header, comm, "RCB")) {
+		cerr << "Couldn't start loading " << names.back() << endl;
+		abort();
+	}
+
+	Cell::transfer_all = false;
+	Cell::transfer_data = false;
+	if (!loaded.continue_loading_grid_data()) {
+		cerr << "Couldn't load data sizes" << endl;
+		abort();
+	}
+	for (const auto& cell: loaded.local_cells) {
+		cell.data->data.resize(cell.data->data_size);
+	}
+	Cell::transfer_data = true;
+	if (!loaded.continue_loading_grid_data()) {
+		cerr << "Couldn't load data" << endl;
+		abort();
+	}
+	loaded.finish_loading_grid_data();
+
+	for (const auto& cell: loaded.local_cells) {
+		const uint64_t expected_size = (cell.id % 4 != 0) ? cell.id : 0;
+		if (cell.data->data.size() != expected_size) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Cell " << cell.id << " has " << cell.data->data.size()
+				<< " items but should have " << expected_size
+				<< endl;
+			abort();
+		}
+		for (uint64_t i = 0; i < expected_size; i++) {
+			if (cell.data->data[i] != int(i)) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Wrong data in cell " << cell.id << " at index " << i
+					<< endl;
+				abort();
+			}
+		}
+	}
+
+	MPI_Barrier(comm);
+	if (rank == 0) {
+		for (const auto& name: names) {
+			remove(name.c_str());
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
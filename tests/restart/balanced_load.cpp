@@ -0,0 +1,191 @@
+/*
+Tests loading a saved grid with set_balanced_loading().
+
+A grid refined only at small z is saved by all processes and
+loaded by one process less, once with default assignment of cells
+and once balanced by size of cell data. Both must load correct
+data into every cell and balanced loading must give each process
+about the same amount of data.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+#include "common.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+typedef Dccrg<Id_Cell, Cartesian_Geometry> Grid;
+
+/*!
+Loads given file balanced or not and returns maximum number of local cells.
+
+With distributed == true owners of cells are stored in a cell directory.
+*/
+uint64_t load(
+	const string& name,
+	std::tuple<void*, int, MPI_Datatype> header,
+	MPI_Comm comm,
+	const bool balanced,
+	const uint64_t saved_cells,
+	const bool distributed = false
+) {
+	Grid grid;
+	grid
+		.set_balanced_loading(balanced)
+		.set_distributed_ownership(distributed);
+	if (!grid.load_grid_data(name, 0, header, comm, "RCB")) {
+		cerr << "Couldn't load " << name << endl;
+		abort();
+	}
+
+	uint64_t local_cells = 0;
+	for (const auto& cell: grid.local_cells) {
+		if (cell.data->id != cell.id) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong data in cell " << cell.id << ": " << cell.data->id
+				<< endl;
+			abort();
+		}
+		local_cells++;
+	}
+
+	if (All_Reduce()(local_cells, comm) != saved_cells) {
+		cerr << __FILE__ << ":" << __LINE__ << " Wrong number of cells loaded" << endl;
+		abort();
+	}
+
+	uint64_t max_local_cells = 0;
+	MPI_Allreduce(&local_cells, &max_local_cells, 1, MPI_UINT64_T, MPI_MAX, comm);
+	return max_local_cells;
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(9),
+			"Create a grid with arg number of unrefined cells in each direction");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	uint64_t header_data = 0;
+	const auto header = get_header(header_data);
+
+	const string name("balanced_load.dc");
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(1)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.balance_load();
+
+	for (const auto& cell: grid.local_cells) {
+		if (grid.geometry.get_center(cell.id)[2] < length / 3.0) {
+			grid.refine_completely(cell.id);
+		}
+	}
+	grid.stop_refining();
+
+	uint64_t saved_cells = 0;
+	for (const auto& cell: grid.local_cells) {
+		cell.data->id = cell.id;
+		saved_cells++;
+	}
+	saved_cells = All_Reduce()(saved_cells, comm);
+
+	if (!grid.save_grid_data(name, 0, header)) {
+		cerr << "Process " << rank << " Couldn't save " << name << endl;
+		abort();
+	}
+
+	// restart with a different number of processes
+	const int load_size = std::max(1, comm_size - 1);
+	MPI_Comm load_comm;
+	MPI_Comm_split(comm, rank < load_size ? 0 : 1, rank, &load_comm);
+
+	if (rank < load_size) {
+		const uint64_t
+			default_max = load(name, header, load_comm, false, saved_cells),
+			balanced_max = load(name, header, load_comm, true, saved_cells),
+			distributed_max = load(name, header, load_comm, true, saved_cells, true),
+			// refined level 0 cells at both ends of a range aren't split
+			allowed_max = saved_cells / load_size + 2 * 9;
+
+		if (
+			balanced_max > allowed_max
+			or balanced_max > default_max
+			or distributed_max != balanced_max
+		) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Too many cells on one process: " << balanced_max
+				<< ", default " << default_max
+				<< ", with cell directory " << distributed_max
+				<< ", allowed " << allowed_max
+				<< endl;
+			abort();
+		}
+	}
+
+	MPI_Comm_free(&load_comm);
+	MPI_Barrier(comm);
+	if (rank == 0) {
+		remove(name.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,301 @@
+/*
+Tests checksums of files written with set_checkpoint_checksums().
+
+A grid is saved with checksums using every method of saving,
+with and without reading the file back, each file must load
+and verify correctly and be readable with File_Reader. After corrupting one byte loading must fail and
+verification must find the corrupted block. Saving without
+checksums over a file with checksums must remove them.
+*/
+
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "memory"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_checkpoint_codec.hpp"
+#include "../../dccrg_checksum.hpp"
+#include "../../dccrg_file_reader.hpp"
+#include "../../dccrg_no_geometry.hpp"
+
+#include "common.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+typedef Dccrg<Id_Cell> Grid;
+
+/*!
+Reads checksums of given file and stores its corrupted blocks into bad_blocks.
+
+Returns false if file doesn't have checksums.
+*/
+bool verify(
+	const string& name,
+	MPI_Comm comm,
+	File_Checksums& checksums,
+	vector<uint64_t>& bad_blocks
+) {
+	MPI_File file;
+	if (
+		MPI_File_open(
+			comm,
+			const_cast<char*>(name.c_str()),
+			MPI_MODE_RDONLY,
+			MPI_INFO_NULL,
+			&file
+		) != MPI_SUCCESS
+	) {
+		cerr << __FILE__ << ":" << __LINE__ << " Couldn't open " << name << endl;
+		abort();
+	}
+
+	const bool has_checksums = checksums.read(file);
+	if (has_checksums and not checksums.verify(file, comm, bad_blocks)) {
+		cerr << __FILE__ << ":" << __LINE__ << " Couldn't verify " << name << endl;
+		abort();
+	}
+
+	MPI_File_close(&file);
+	return has_checksums;
+}
+
+/*!
+Loads given file with checksums and checks data of cells.
+
+Returns false if loading fails.
+*/
+bool load(const string& name, std::tuple<void*, int, MPI_Datatype> header, MPI_Comm comm)
+{
+	Grid grid;
+	grid.set_checkpoint_checksums(true);
+	if (!grid.load_grid_data(name, 0, header, comm, "RCB")) {
+		return false;
+	}
+
+	for (const auto& cell: grid.local_cells) {
+		if (cell.data->id != cell.id) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong data in cell " << cell.id << ": " << cell.data->id
+				<< endl;
+			abort();
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length, block_size;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(7),
+			"Create a grid with arg number of unrefined cells in each direction")
+		("block_size",
+			boost::program_options::value<uint64_t>(&block_size)->default_value(300),
+			"Calculate checksums of blocks of arg bytes");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	// check value of CRC-32C, also in parts
+	{
+		const string data("123456789");
+		const Crc32c crc;
+		if (
+			crc((const uint8_t*) data.data(), data.size()) != 0xe3069283
+			or crc((const uint8_t*) data.data() + 4, 5, crc((const uint8_t*) data.data(), 4)) != 0xe3069283
+			or Crc32c::combine(
+				crc((const uint8_t*) data.data(), 4),
+				crc((const uint8_t*) data.data() + 4, 5),
+				5
+			) != 0xe3069283
+		) {
+			cerr << __FILE__ << ":" << __LINE__ << " Wrong CRC-32C" << endl;
+			abort();
+		}
+	}
+
+	uint64_t header_data = 0;
+	const auto header = get_header(header_data);
+
+	const string name("checksum.dc");
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length, length})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(0)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.balance_load();
+
+	for (const auto& cell: grid.local_cells) {
+		cell.data->id = cell.id;
+	}
+
+	grid
+		.set_checkpoint_checksums(true)
+		.set_checkpoint_block_size(block_size);
+
+	// 0: save_grid_data, 1: start..finish_saving_grid_data, 2: aggregated, 3: compressed
+	for (int i = 0; i < 8; i++) {
+		const int method = i % 4;
+		grid
+			.set_checkpoint_checksum_readback(i >= 4)
+			.set_save_aggregators(method == 2 ? 1 : 0)
+			.set_checkpoint_codec(
+				method == 3
+				? std::make_shared<Shuffle_LZ_Codec>()
+				: std::shared_ptr<Shuffle_LZ_Codec>()
+			);
+
+		bool saved = false;
+		if (method == 1) {
+			saved
+				= grid.start_saving_grid_data(name, 0, header)
+				and grid.finish_saving_grid_data();
+		} else {
+			saved = grid.save_grid_data(name, 0, header);
+		}
+		if (not saved) {
+			cerr << "Process " << rank << " Couldn't save " << name << endl;
+			abort();
+		}
+
+		File_Checksums checksums;
+		vector<uint64_t> bad_blocks;
+		if (not verify(name, comm, checksums, bad_blocks) or bad_blocks.size() > 0) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Saving method " << method << " didn't write valid checksums"
+				<< endl;
+			abort();
+		}
+		if (checksums.block_size != block_size or checksums.start != 0) {
+			cerr << __FILE__ << ":" << __LINE__ << " Wrong checksum parameters" << endl;
+			abort();
+		}
+
+		if (not load(name, header, comm)) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Couldn't load file saved with method " << method
+				<< endl;
+			abort();
+		}
+
+		// checksums mustn't be read as data of last cell
+		if (rank == 0 and method < 3) {
+			File_Reader<> reader;
+			if (!reader.open(name, sizeof(uint64_t))) {
+				cerr << __FILE__ << ":" << __LINE__ << " Couldn't open " << name << endl;
+				abort();
+			}
+			for (uint64_t i = 0; i < reader.get_number_of_cells(); i++) {
+				const auto data = reader.get_data(i);
+				if (data.size != sizeof(uint64_t) or *((const uint64_t*) data.data) != reader.get_cell(i)) {
+					cerr << __FILE__ << ":" << __LINE__
+						<< " Wrong data for cell " << reader.get_cell(i)
+						<< " in file saved with method " << method
+						<< endl;
+					abort();
+				}
+			}
+		}
+	}
+
+	// corrupt one byte of cell data
+	File_Checksums checksums;
+	vector<uint64_t> bad_blocks;
+	verify(name, comm, checksums, bad_blocks);
+	const uint64_t corrupted = checksums.end - 3;
+	if (rank == 0) {
+		fstream file(name, ios::in | ios::out | ios::binary);
+		file.seekg(corrupted);
+		const char original = char(file.get());
+		file.seekp(corrupted);
+		file.put(char(~original));
+	}
+	MPI_Barrier(comm);
+
+	if (load(name, header, comm)) {
+		cerr << __FILE__ << ":" << __LINE__ << " Corrupted file loaded" << endl;
+		abort();
+	}
+
+	if (
+		not verify(name, comm, checksums, bad_blocks)
+		or bad_blocks.size() != 1
+		or bad_blocks[0] != (corrupted - checksums.start) / checksums.block_size
+	) {
+		cerr << __FILE__ << ":" << __LINE__ << " Corrupted block not found" << endl;
+		abort();
+	}
+
+	// checksums of previous file must not remain
+	grid
+		.set_checkpoint_checksums(false)
+		.set_checkpoint_codec(nullptr);
+	if (!grid.save_grid_data(name, 0, header)) {
+		cerr << "Process " << rank << " Couldn't save " << name << endl;
+		abort();
+	}
+	if (verify(name, comm, checksums, bad_blocks)) {
+		cerr << __FILE__ << ":" << __LINE__ << " Checksums remain in file" << endl;
+		abort();
+	}
+	if (load(name, header, comm)) {
+		cerr << __FILE__ << ":" << __LINE__ << " File without checksums loaded" << endl;
+		abort();
+	}
+
+	MPI_Barrier(comm);
+	if (rank == 0) {
+		remove(name.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+/*
+Cell data, file headers and file sizes shared by restart tests.
+*/
+
+#ifndef RESTART_COMMON_HPP
+#define RESTART_COMMON_HPP
+
+#include "cstdint"
+#include "fstream"
+#include "string"
+#include "tuple"
+
+#include "mpi.h"
+
+#include "../../dccrg_mapping.hpp"
+
+/*!
+Cell whose data is its own id, error_cell if not set.
+*/
+struct Id_Cell {
+	uint64_t id = dccrg::error_cell;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(&(this->id), 1, MPI_UINT64_T);
+	}
+};
+
+/*!
+Returns a file header consisting of given value.
+*/
+inline std::tuple<void*, int, MPI_Datatype> get_header(uint64_t& header_data)
+{
+	return std::make_tuple(&header_data, 1, MPI_UINT64_T);
+}
+
+/*!
+Returns an empty file header.
+*/
+inline std::tuple<void*, int, MPI_Datatype> get_empty_header()
+{
+	return std::make_tuple(nullptr, 0, MPI_INT);
+}
+
+/*!
+Returns the size of given file in bytes.
+*/
+inline uint64_t get_file_size(const std::string& name)
+{
+	std::ifstream file(name, std::ios::binary | std::ios::ate);
+	return uint64_t(file.tellg());
+}
+
+#endif
@@ -0,0 +1,258 @@
+/*
+Tests saving and loading grid data compressed with Shuffle_LZ_Codec.
+
+The codec is first tested on small inputs, then a grid with a smooth
+field of doubles in each cell is saved without and with compression,
+sizes of both files are printed and the compressed file is loaded
+with different block sizes and verified.
+*/
+
+#include "algorithm"
+#include "cmath"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "iostream"
+#include "memory"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_checkpoint_codec.hpp"
+
+#include "common.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+constexpr size_t values_per_cell = 16;
+
+// range of values transferred by the next call to get_mpi_datatype()
+size_t transfer_begin = 0, transfer_end = values_per_cell;
+
+struct Cell {
+	std::array<double, values_per_cell> data;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		return std::make_tuple(
+			this->data.data() + transfer_begin,
+			int(transfer_end - transfer_begin),
+			MPI_DOUBLE
+		);
+	}
+};
+
+typedef Dccrg<Cell> Grid;
+
+double get_value(const uint64_t cell, const size_t index)
+{
+	return 1000 + std::sin(0.01 * double(cell)) + 1e-3 * double(index);
+}
+
+void test_codec(const Checkpoint_Codec& codec, const vector<uint8_t>& data)
+{
+	vector<uint8_t> compressed;
+	codec.compress(data.data(), data.size(), compressed);
+
+	vector<uint8_t> decompressed(data.size());
+	if (
+		not codec.decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size())
+		or decompressed != data
+	) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Round trip of " << data.size() << " bytes failed"
+			<< endl;
+		abort();
+	}
+
+	// wrong size must be detected
+	decompressed.resize(data.size() + 1);
+	if (codec.decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size())) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Decompression into wrong size succeeded for " << data.size() << " bytes"
+			<< endl;
+		abort();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length, block_size;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(20),
+			"Create a grid with arg number of cells in each direction")
+		("block_size",
+			boost::program_options::value<uint64_t>(&block_size)->default_value(4096),
+			"Compress cell data in blocks of at most arg bytes");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	const Shuffle_LZ_Codec codec;
+	test_codec(codec, {});
+	test_codec(codec, {1});
+	test_codec(codec, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11});
+	test_codec(codec, vector<uint8_t>(10000, 7));
+	{
+		vector<uint8_t> data;
+		for (size_t i = 0; i < 10000; i++) {
+			data.push_back(uint8_t((i * i) % 251));
+		}
+		test_codec(codec, data);
+		test_codec(Shuffle_LZ_Codec(3), data);
+	}
+
+	const auto header = get_empty_header();
+
+	const string
+		uncompressed_name("compressed_checkpoint_0.dc"),
+		compressed_name("compressed_checkpoint_1.dc");
+
+	{
+		Grid grid;
+		grid
+			.set_initial_length({length, length, length})
+			.set_neighborhood_length(1)
+			.set_maximum_refinement_level(0)
+			.set_load_balancing_method("RCB")
+			.initialize(comm)
+			.balance_load();
+
+		for (const auto& cell: grid.local_cells) {
+			for (size_t i = 0; i < values_per_cell; i++) {
+				cell.data->data[i] = get_value(cell.id, i);
+			}
+		}
+
+		if (!grid.save_grid_data(uncompressed_name, 0, header)) {
+			cerr << "Process " << rank << " Couldn't save " << uncompressed_name << endl;
+			abort();
+		}
+
+		grid
+			.set_checkpoint_codec(std::make_shared<Shuffle_LZ_Codec>())
+			.set_checkpoint_block_size(block_size);
+		if (!grid.save_grid_data(compressed_name, 0, header)) {
+			cerr << "Process " << rank << " Couldn't save " << compressed_name << endl;
+			abort();
+		}
+	}
+	MPI_Barrier(comm);
+
+	if (rank == 0) {
+		const uint64_t
+			uncompressed_size = get_file_size(uncompressed_name),
+			compressed_size = get_file_size(compressed_name);
+		cout << "Uncompressed file: " << uncompressed_size
+			<< " bytes, compressed file: " << compressed_size
+			<< " bytes, ratio: " << double(uncompressed_size) / double(compressed_size)
+			<< endl;
+		if (compressed_size >= uncompressed_size) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Compressed file isn't smaller than uncompressed"
+				<< endl;
+			abort();
+		}
+	}
+
+	// load without setting a codec and with one, in one and in several reads
+	// of parts of cell data
+	for (const bool set_codec: {false, true})
+	for (const size_t values_per_read: {values_per_cell, size_t(5)}) {
+		Grid grid;
+		if (set_codec) {
+			grid.set_checkpoint_codec(std::make_shared<Shuffle_LZ_Codec>());
+		}
+		if (!grid.start_loading_grid_data(compressed_name, 0, header, comm, "RCB", 1, 100)) {
+			cerr << "Process " << rank << " Couldn't start loading " << compressed_name << endl;
+			abort();
+		}
+		for (
+			transfer_begin = 0;
+			transfer_begin < values_per_cell;
+			transfer_begin += values_per_read
+		) {
+			transfer_end = std::min(transfer_begin + values_per_read, values_per_cell);
+			if (!grid.continue_loading_grid_data()) {
+				cerr << "Process " << rank << " Couldn't load " << compressed_name
+					<< " from value " << transfer_begin
+					<< endl;
+				abort();
+			}
+		}
+		transfer_begin = 0;
+		transfer_end = values_per_cell;
+		grid.finish_loading_grid_data();
+
+		uint64_t local_cells = 0, loaded_cells = 0;
+		for (const auto& cell: grid.local_cells) {
+			local_cells++;
+			for (size_t i = 0; i < values_per_cell; i++) {
+				if (cell.data->data[i] != get_value(cell.id, i)) {
+					cerr << __FILE__ << ":" << __LINE__
+						<< " Process " << rank
+						<< " Wrong data in cell " << cell.id << " at index " << i
+						<< ": " << cell.data->data[i]
+						<< endl;
+					abort();
+				}
+			}
+		}
+		MPI_Allreduce(&local_cells, &loaded_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
+		if (loaded_cells != length * length * length) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Loaded " << loaded_cells << " cells"
+				<< endl;
+			abort();
+		}
+	}
+
+	MPI_Barrier(comm);
+	if (rank == 0) {
+		remove(uncompressed_name.c_str());
+		remove(compressed_name.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
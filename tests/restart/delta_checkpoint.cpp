@@ -0,0 +1,283 @@
+/*
+Tests saving changed cells with save_grid_data_delta() and loading them.
+
+A grid is saved fully, then data of a few cells is modified and
+only changed cells are appended to a delta file several times,
+also after an empty delta and after load balancing. Saving a delta
+after refining must fail. The full file and the delta file are
+loaded in two reads, in the second one the number of values read
+from each cell depends on whether the cell is in a delta, and data
+of every cell is compared to the final state. This is repeated with
+a compressed full file. Sizes of the files are printed.
+*/
+
+#include "algorithm"
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "iostream"
+#include "memory"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_checkpoint_codec.hpp"
+
+#include "common.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+// which part of cell data get_mpi_datatype() returns
+enum class Transfer {all, number_of_values, values} transfer = Transfer::all;
+
+struct Cell {
+	// number of values followed by values
+	std::array<double, 9> data;
+
+	std::tuple<void*, int, MPI_Datatype> get_mpi_datatype()
+	{
+		switch (transfer) {
+		case Transfer::number_of_values:
+			return std::make_tuple(this->data.data(), 1, MPI_DOUBLE);
+		case Transfer::values:
+			return std::make_tuple(this->data.data() + 1, int(this->data[0]), MPI_DOUBLE);
+		default:
+			return std::make_tuple(this->data.data(), 1 + int(this->data[0]), MPI_DOUBLE);
+		}
+	}
+};
+
+typedef Dccrg<Cell> Grid;
+
+uint64_t get_modifications(const uint64_t cell, const uint64_t step)
+{
+	uint64_t modifications = 0;
+	for (uint64_t i = 1; i <= step; i++) {
+		if (cell % (10 * i + 3) == 0) {
+			modifications++;
+		}
+	}
+	return modifications;
+}
+
+// number of values in cell after given number of modifications
+size_t get_number_of_values(const uint64_t cell, const uint64_t step)
+{
+	return 4 + std::min(uint64_t(4), get_modifications(cell, step));
+}
+
+// value of cell's data after given number of modifications
+double get_value(const uint64_t cell, const size_t index, const uint64_t step)
+{
+	return double(cell) + 0.125 * double(index) + 1000.0 * double(get_modifications(cell, step));
+}
+
+void set_data(Cell& cell_data, const uint64_t cell, const uint64_t step)
+{
+	cell_data.data[0] = double(get_number_of_values(cell, step));
+	for (size_t i = 0; i < get_number_of_values(cell, step); i++) {
+		cell_data.data[i + 1] = get_value(cell, i, step);
+	}
+}
+
+void check_data(const Grid& grid, const uint64_t length, const uint64_t steps)
+{
+	uint64_t local_cells = 0, loaded_cells = 0;
+	for (const auto& cell: grid.local_cells) {
+		local_cells++;
+		const size_t number_of_values = get_number_of_values(cell.id, steps);
+		if (cell.data->data[0] != double(number_of_values)) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Process " << grid.get_rank()
+				<< " Wrong number of values in cell " << cell.id
+				<< ": " << cell.data->data[0]
+				<< ", should be " << number_of_values
+				<< endl;
+			abort();
+		}
+		for (size_t i = 0; i < number_of_values; i++) {
+			if (cell.data->data[i + 1] != get_value(cell.id, i, steps)) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Process " << grid.get_rank()
+					<< " Wrong data in cell " << cell.id << " at index " << i
+					<< ": " << cell.data->data[i + 1]
+					<< ", should be " << get_value(cell.id, i, steps)
+					<< endl;
+				abort();
+			}
+		}
+	}
+	MPI_Allreduce(&local_cells, &loaded_cells, 1, MPI_UINT64_T, MPI_SUM, grid.get_communicator());
+	if (loaded_cells != length * length * length) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Loaded " << loaded_cells << " cells"
+			<< endl;
+		abort();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length, steps;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(20),
+			"Create a grid with arg number of cells in each direction")
+		("steps",
+			boost::program_options::value<uint64_t>(&steps)->default_value(4),
+			"Save arg deltas, every (10 * step + 3)'th cell is modified in each step");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	const auto header = get_empty_header();
+
+	const string
+		base_name("delta_checkpoint_base.dc"),
+		delta_name("delta_checkpoint_delta.dc");
+
+	for (const bool compress: {false, true}) {
+		{
+			Grid grid;
+			grid
+				.set_initial_length({length, length, length})
+				.set_neighborhood_length(1)
+				.set_maximum_refinement_level(1)
+				.set_load_balancing_method("RCB")
+				.initialize(comm)
+				.balance_load();
+
+			if (grid.save_grid_data_delta(delta_name)) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Delta saved without full save"
+					<< endl;
+				abort();
+			}
+
+			for (const auto& cell: grid.local_cells) {
+				set_data(*cell.data, cell.id, 0);
+			}
+
+			if (compress) {
+				grid.set_checkpoint_codec(std::make_shared<Shuffle_LZ_Codec>());
+			}
+			grid.set_delta_checkpoints(true);
+			if (!grid.save_grid_data(base_name, 0, header)) {
+				cerr << "Process " << rank << " Couldn't save " << base_name << endl;
+				abort();
+			}
+
+			// nothing changed
+			if (!grid.save_grid_data_delta(delta_name)) {
+				cerr << "Process " << rank << " Couldn't save empty delta" << endl;
+				abort();
+			}
+
+			for (uint64_t step = 1; step <= steps; step++) {
+				for (const auto& cell: grid.local_cells) {
+					set_data(*cell.data, cell.id, step);
+				}
+
+				if (step == steps / 2) {
+					grid.balance_load();
+				}
+
+				if (!grid.save_grid_data_delta(delta_name)) {
+					cerr << "Process " << rank << " Couldn't save delta " << step << endl;
+					abort();
+				}
+			}
+
+			// delta of refined grid couldn't be loaded
+			if (grid.get_rank() == grid.get_process(1)) {
+				grid.refine_completely(1);
+			}
+			grid.stop_refining();
+			if (grid.save_grid_data_delta(delta_name)) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Delta saved after refining"
+					<< endl;
+				abort();
+			}
+		}
+		MPI_Barrier(comm);
+
+		if (rank == 0) {
+			cout << (compress ? "Compressed full" : "Full") << " file: "
+				<< get_file_size(base_name)
+				<< " bytes, " << steps << " deltas: " << get_file_size(delta_name)
+				<< " bytes" << endl;
+		}
+
+		// number of values is known only after 1st read
+		{
+			Grid grid;
+			if (
+				not grid.start_loading_grid_data(base_name, 0, header, comm, "RCB")
+				or not grid.start_loading_grid_data_delta(delta_name)
+			) {
+				cerr << "Process " << rank << " Couldn't start loading " << base_name << " and " << delta_name << endl;
+				abort();
+			}
+			for (const auto part: {Transfer::number_of_values, Transfer::values}) {
+				transfer = part;
+				if (!grid.continue_loading_grid_data()) {
+					cerr << "Process " << rank << " Couldn't load " << base_name << " and " << delta_name << endl;
+					abort();
+				}
+			}
+			transfer = Transfer::all;
+			grid.finish_loading_grid_data();
+			check_data(grid, length, steps);
+		}
+
+		MPI_Barrier(comm);
+		if (rank == 0) {
+			remove(base_name.c_str());
+			remove(delta_name.c_str());
+		}
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
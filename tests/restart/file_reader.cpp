@@ -0,0 +1,274 @@
+/*
+Tests reading a file written by save_grid_data() with File_Reader.
+
+A refined grid is saved by all processes and process 0 reads it
+back with File_Reader, both by searching sorted runs of cells and
+with a sorted index, and verifies metadata, data of every cell and
+that every point in the grid is inside exactly one cell returned
+by a range query and cells of a smaller volume.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "cstring"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+#include "../../dccrg_file_reader.hpp"
+
+#include "common.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+typedef Dccrg<Id_Cell, Cartesian_Geometry> Grid;
+
+void verify(
+	const File_Reader<Cartesian_Geometry>& reader,
+	const uint64_t saved_cells,
+	const uint64_t length
+) {
+	if (reader.get_number_of_cells() != saved_cells) {
+		cerr << __FILE__ << ":" << __LINE__
+			<< " Wrong number of cells: " << reader.get_number_of_cells()
+			<< ", should be " << saved_cells
+			<< endl;
+		abort();
+	}
+
+	const std::array<uint64_t, 3> expected_length{{length, length + 1, length + 2}};
+	if (
+		reader.get_mapping().length.get() != expected_length
+		or reader.get_mapping().get_maximum_refinement_level() != 2
+		or not reader.get_topology().is_periodic(1)
+		or reader.get_topology().is_periodic(0)
+		or reader.get_neighborhood_length() != 1
+		or reader.get_geometry().get_start()[2] != -1.0
+		or reader.get_geometry().get_level_0_cell_length()[0] != 0.5
+	) {
+		cerr << __FILE__ << ":" << __LINE__ << " Wrong metadata" << endl;
+		abort();
+	}
+
+	for (uint64_t i = 0; i < reader.get_number_of_cells(); i++) {
+		const uint64_t cell = reader.get_cell(i);
+		if (reader.find(cell) != i) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Cell " << cell << " not found at position " << i
+				<< endl;
+			abort();
+		}
+
+		const auto data = reader.get_cell_data(cell);
+		uint64_t id = error_cell;
+		if (data.data == nullptr or data.size != sizeof(uint64_t)) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong data size of cell " << cell << ": " << data.size
+				<< endl;
+			abort();
+		}
+		std::memcpy(&id, data.data, sizeof(id));
+		if (id != cell) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong data in cell " << cell << ": " << id
+				<< endl;
+			abort();
+		}
+
+		// refined cells don't exist in the file
+		const uint64_t parent = reader.get_mapping().get_parent(cell);
+		if (parent != cell and reader.find(parent) != reader.get_number_of_cells()) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Parent " << parent << " of cell " << cell << " found"
+				<< endl;
+			abort();
+		}
+	}
+
+	if (reader.get_cell_data(error_cell).data != nullptr) {
+		cerr << __FILE__ << ":" << __LINE__ << " Found error_cell" << endl;
+		abort();
+	}
+
+	// whole grid
+	const uint64_t max_index_factor = uint64_t(1) << reader.get_mapping().get_maximum_refinement_level();
+	const Types<3>::indices_t max_indices{{
+		expected_length[0] * max_index_factor - 1,
+		expected_length[1] * max_index_factor - 1,
+		expected_length[2] * max_index_factor - 1
+	}};
+	if (reader.get_cells({{0, 0, 0}}, max_indices).size() != saved_cells) {
+		cerr << __FILE__ << ":" << __LINE__ << " Wrong number of cells in whole grid" << endl;
+		abort();
+	}
+
+	// every index is inside exactly one cell
+	for (uint64_t x = 0; x <= max_indices[0]; x += 3) {
+	for (uint64_t y = 0; y <= max_indices[1]; y += 5) {
+	for (uint64_t z = 0; z <= max_indices[2]; z += 7) {
+		const Types<3>::indices_t indices{{x, y, z}};
+		if (reader.get_cells(indices, indices).size() != 1) {
+			cerr << __FILE__ << ":" << __LINE__
+				<< " Wrong number of cells at " << x << ", " << y << ", " << z
+				<< endl;
+			abort();
+		}
+	}}}
+
+	// cells of a smaller volume in file order
+	const Types<3>::indices_t
+		volume_min{{1, 2, 3}},
+		volume_max{{max_indices[0] / 2, max_indices[1] / 3, max_indices[2] / 2}};
+	std::vector<uint64_t> volume_cells;
+	for (uint64_t i = 0; i < reader.get_number_of_cells(); i++) {
+		const uint64_t cell = reader.get_cell(i);
+		const auto indices = reader.get_mapping().get_indices(cell);
+		const uint64_t cell_length = reader.get_mapping().get_cell_length_in_indices(cell);
+		bool overlaps = true;
+		for (size_t dimension = 0; dimension < indices.size(); dimension++) {
+			if (
+				indices[dimension] > volume_max[dimension]
+				or indices[dimension] + cell_length - 1 < volume_min[dimension]
+			) {
+				overlaps = false;
+			}
+		}
+		if (overlaps) {
+			volume_cells.push_back(cell);
+		}
+	}
+	if (reader.get_cells(volume_min, volume_max) != volume_cells) {
+		cerr << __FILE__ << ":" << __LINE__ << " Wrong cells in volume" << endl;
+		abort();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length, refine_stride;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(6),
+			"Create a grid with about arg number of unrefined cells in each direction")
+		("refine_stride",
+			boost::program_options::value<uint64_t>(&refine_stride)->default_value(5),
+			"Refine every arg'th cell before saving the grid");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	uint64_t header_data = 123;
+	const auto header = get_header(header_data);
+
+	const string name("file_reader.dc");
+
+	Cartesian_Geometry::Parameters geom_params;
+	geom_params.start = {{0, 0, -1}};
+	geom_params.level_0_cell_length = {{0.5, 1, 2}};
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length + 1, length + 2})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(2)
+		.set_periodic(false, true, false)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.set_geometry(geom_params)
+		.balance_load();
+
+	for (const auto& cell: grid.local_cells) {
+		if (cell.id % refine_stride == 0) {
+			grid.refine_completely(cell.id);
+		}
+	}
+	grid.stop_refining();
+
+	for (const auto& cell: grid.local_cells) {
+		cell.data->id = cell.id;
+	}
+
+	const uint64_t local_cells = grid.get_cells().size();
+	uint64_t saved_cells = 0;
+	MPI_Allreduce(&local_cells, &saved_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
+
+	if (!grid.save_grid_data(name, 0, header)) {
+		cerr << "Process " << rank << " Couldn't save " << name << endl;
+		abort();
+	}
+	MPI_Barrier(comm);
+
+	if (rank == 0) {
+		File_Reader<Cartesian_Geometry> reader;
+
+		// wrong offset must be detected
+		if (reader.open(name, 0)) {
+			cerr << __FILE__ << ":" << __LINE__ << " Opened with wrong offset" << endl;
+			abort();
+		}
+
+		for (const size_t max_sorted_runs: {size_t(0), size_t(1000)}) {
+			if (!reader.open(name, sizeof(uint64_t), max_sorted_runs)) {
+				cerr << __FILE__ << ":" << __LINE__ << " Couldn't open " << name << endl;
+				abort();
+			}
+
+			uint64_t read_header = 0;
+			std::memcpy(&read_header, reader.get_file_data(), sizeof(read_header));
+			if (read_header != header_data) {
+				cerr << __FILE__ << ":" << __LINE__ << " Wrong header: " << read_header << endl;
+				abort();
+			}
+
+			verify(reader, saved_cells, length);
+		}
+
+		remove(name.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
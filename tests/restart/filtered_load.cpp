@@ -0,0 +1,232 @@
+/*
+Tests loading a part of a grid saved by save_grid_data().
+
+A refined grid is saved and loaded back several times with
+different regions and ranges of refinement levels. Every cell
+of the file inside the region and range must be loaded with
+correct data, other cells must not be loaded and no cell
+of larger refinement level than maximum must exist.
+*/
+
+#include "array"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "iostream"
+#include "stdexcept"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+#include "../../dccrg_cartesian_geometry.hpp"
+
+#include "common.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+typedef Dccrg<Id_Cell, Cartesian_Geometry> Grid;
+
+/*!
+Returns true if given cell of given grid should be loaded with given filter.
+
+Coordinates of region must not be on cell boundaries.
+*/
+bool is_loaded(
+	const Grid& grid,
+	const uint64_t cell,
+	const std::array<double, 3>& region_min,
+	const std::array<double, 3>& region_max,
+	const int min_ref_lvl,
+	const int max_ref_lvl
+) {
+	const int ref_lvl = grid.mapping.get_refinement_level(cell);
+	if (ref_lvl < min_ref_lvl or ref_lvl > max_ref_lvl) {
+		return false;
+	}
+
+	const auto
+		cell_min = grid.geometry.get_min(cell),
+		cell_max = grid.geometry.get_max(cell);
+	for (size_t dim = 0; dim < 3; dim++) {
+		if (cell_min[dim] > region_max[dim] or cell_max[dim] < region_min[dim]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	/*
+	Options
+	*/
+	uint64_t length, refine_stride;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(6),
+			"Create a grid with about arg number of unrefined cells in each direction")
+		("refine_stride",
+			boost::program_options::value<uint64_t>(&refine_stride)->default_value(4),
+			"Refine every arg'th cell twice before saving the grid");
+
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+		cerr << "Zoltan_Initialize failed" << endl;
+		abort();
+	}
+
+	uint64_t header_data = 0;
+	const auto header = get_header(header_data);
+
+	const string name("filtered_load.dc");
+
+	Grid grid;
+	grid
+		.set_initial_length({length, length + 1, length + 2})
+		.set_neighborhood_length(1)
+		.set_maximum_refinement_level(2)
+		.set_load_balancing_method("RCB")
+		.initialize(comm)
+		.balance_load();
+
+	for (int round = 0; round < 2; round++) {
+		for (const auto& cell: grid.local_cells) {
+			if (cell.id % refine_stride == 0) {
+				grid.refine_completely(cell.id);
+			}
+		}
+		grid.stop_refining();
+	}
+
+	for (const auto& cell: grid.local_cells) {
+		cell.data->id = cell.id;
+	}
+
+	if (!grid.save_grid_data(name, 0, header)) {
+		cerr << "Process " << rank << " Couldn't save " << name << endl;
+		abort();
+	}
+
+	// invalid filters must be rejected
+	Grid invalid;
+	try {
+		invalid.set_loaded_region({{0, 0, 1}}, {{1, 1, 0}});
+		cerr << __FILE__ << ":" << __LINE__ << " Invalid region accepted" << endl;
+		abort();
+	} catch (const std::invalid_argument&) {}
+	try {
+		invalid.set_loaded_refinement_levels(2, 1);
+		cerr << __FILE__ << ":" << __LINE__ << " Invalid refinement levels accepted" << endl;
+		abort();
+	} catch (const std::invalid_argument&) {}
+
+	const double huge = 1e300;
+	const std::vector<std::tuple<std::array<double, 3>, std::array<double, 3>, int, int>> filters{
+		std::make_tuple(std::array<double, 3>{{1.1, 2.6, 0.3}}, std::array<double, 3>{{4.45, 5.2, 6.7}}, 0, 2),
+		std::make_tuple(std::array<double, 3>{{-huge, -huge, -huge}}, std::array<double, 3>{{huge, huge, huge}}, 0, 1),
+		std::make_tuple(std::array<double, 3>{{-huge, 1.3, -huge}}, std::array<double, 3>{{2.9, huge, huge}}, 1, 2),
+		std::make_tuple(std::array<double, 3>{{-huge, -huge, 100.1}}, std::array<double, 3>{{huge, huge, huge}}, 0, 2)
+	};
+
+	for (const auto& filter: filters) {
+		const auto
+			region_min = std::get<0>(filter),
+			region_max = std::get<1>(filter);
+		const int
+			min_ref_lvl = std::get<2>(filter),
+			max_ref_lvl = std::get<3>(filter);
+
+		uint64_t expected_loaded = 0;
+		for (const auto& cell: grid.local_cells) {
+			if (is_loaded(grid, cell.id, region_min, region_max, min_ref_lvl, max_ref_lvl)) {
+				expected_loaded++;
+			}
+		}
+		expected_loaded = All_Reduce()(expected_loaded, comm);
+
+		Grid loaded;
+		loaded
+			.set_loaded_region(region_min, region_max)
+			.set_loaded_refinement_levels(min_ref_lvl, max_ref_lvl);
+		if (!loaded.load_grid_data(name, 0, header, comm, "RCB")) {
+			cerr << "Process " << rank << " Couldn't load " << name << endl;
+			abort();
+		}
+
+		uint64_t number_loaded = 0;
+		for (const auto& cell: loaded.local_cells) {
+			if (loaded.mapping.get_refinement_level(cell.id) > max_ref_lvl) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Cell " << cell.id << " of too large refinement level exists"
+					<< endl;
+				abort();
+			}
+
+			if (cell.data->id == error_cell) {
+				continue;
+			}
+			if (
+				cell.data->id != cell.id
+				or not is_loaded(loaded, cell.id, region_min, region_max, min_ref_lvl, max_ref_lvl)
+			) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Wrong data loaded for cell " << cell.id << ": " << cell.data->id
+					<< endl;
+				abort();
+			}
+			number_loaded++;
+		}
+		number_loaded = All_Reduce()(number_loaded, comm);
+
+		if (number_loaded != expected_loaded) {
+			if (rank == 0) {
+				cerr << __FILE__ << ":" << __LINE__
+					<< " Wrong number of cells loaded: " << number_loaded
+					<< ", should be " << expected_loaded
+					<< endl;
+			}
+			abort();
+		}
+	}
+
+	MPI_Barrier(comm);
+	if (rank == 0) {
+		remove(name.c_str());
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}
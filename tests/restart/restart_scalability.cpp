@@ -0,0 +1,196 @@
+/*
+Tests the speed of restarting a refined grid from a file.
+
+A grid is refined, saved and then loaded back with given limit on
+the number of cells whose ids and data offsets each process reads
+from the file at a time. Loaded data is verified and time spent in
+start_loading_grid_data() and in loading the whole grid is printed
+along with the number of processes, run with different numbers of
+processes and compile without DEBUG for meaningful timings.
+*/
+
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "string"
+#include "tuple"
+#include "vector"
+
+#include "boost/program_options.hpp"
+#include "mpi.h"
+#include "zoltan.h"
+
+#include "../../dccrg.hpp"
+
+#include "common.hpp"
+
+
+using namespace std;
+using namespace dccrg;
+
+typedef Dccrg<Id_Cell> Grid;
+
+int main(int argc, char* argv[])
+{
+	if (MPI_Init(&argc, &argv) != MPI_SUCCESS) {
+		cerr << "Coudln't initialize MPI." << endl;
+		abort();
+	}
+
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	int rank = 0, comm_size = 0;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &comm_size);
+
+	float zoltan_version;
+	if (Zoltan_Initialize(argc, argv, &zoltan_version) != ZOLTAN_OK) {
+	    cout << "Zoltan_Initialize failed" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	/*
+	Options
+	*/
+	uint64_t length, refine_stride, max_cells_per_read;
+	string restart_name;
+	boost::program_options::options_description options("Usage: program_name [options], where options are:");
+	options.add_options()
+		("help", "print this help message")
+		("length",
+			boost::program_options::value<uint64_t>(&length)->default_value(10),
+			"Create a grid with arg number of unrefined cells in each direction")
+		("refine_stride",
+			boost::program_options::value<uint64_t>(&refine_stride)->default_value(7),
+			"Refine every arg'th cell before saving the grid, 0 for none")
+		("max_cells_per_read",
+			boost::program_options::value<uint64_t>(&max_cells_per_read)->default_value(100),
+			"Read at most arg cell ids and data offsets at a time per process when loading")
+		("restart_name",
+			boost::program_options::value<string>(&restart_name)->default_value("restart_scalability.dc"),
+			"Save grid into and load it from file arg");
+
+	// read options from command line
+	boost::program_options::variables_map option_variables;
+	boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), option_variables);
+	boost::program_options::notify(option_variables);
+
+	// print a help message if asked
+	if (option_variables.count("help") > 0) {
+		if (rank == 0) {
+			cout << options << endl;
+		}
+		MPI_Finalize();
+		return EXIT_SUCCESS;
+	}
+
+	const auto header = get_empty_header();
+
+	// save refined grid
+	uint64_t saved_cells = 0;
+	{
+		Grid grid;
+		grid
+			.set_initial_length({length, length, length})
+			.set_neighborhood_length(1)
+			.set_maximum_refinement_level(-1)
+			.set_load_balancing_method("RCB")
+			.initialize(comm)
+			.balance_load();
+
+		for (const auto& cell: grid.local_cells) {
+			if (refine_stride > 0 and cell.id % refine_stride == 0) {
+				grid.refine_completely(cell.id);
+			}
+		}
+		grid.stop_refining();
+
+		for (const auto& cell: grid.local_cells) {
+			cell.data->id = cell.id;
+		}
+
+		const uint64_t local_cells = grid.get_cells().size();
+		MPI_Allreduce(&local_cells, &saved_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
+
+		if (!grid.save_grid_data(restart_name, 0, header)) {
+			cerr << "Process " << rank
+				<< " Writing grid to file " << restart_name << " failed"
+				<< endl;
+			abort();
+		}
+	}
+
+	// load it back
+	Grid grid;
+
+	MPI_Barrier(comm);
+	const double before = MPI_Wtime();
+	if (!grid.start_loading_grid_data(
+		restart_name,
+		0,
+		header,
+		comm,
+		"RCB",
+		1,
+		max_cells_per_read
+	)) {
+		cerr << "Process " << rank << " Couldn't start loading grid data" << endl;
+		abort();
+	}
+	const double started = MPI_Wtime();
+	if (!grid.continue_loading_grid_data()) {
+		cerr << "Process " << rank << " Couldn't load grid data" << endl;
+		abort();
+	}
+	if (!grid.finish_loading_grid_data()) {
+		cerr << "Process " << rank << " Couldn't finish loading grid data" << endl;
+		abort();
+	}
+	const double after = MPI_Wtime();
+
+	uint64_t iterated_cells = 0;
+	for (const auto& cell: grid.local_cells) {
+		iterated_cells++;
+		if (cell.data->id != cell.id) {
+			cerr << __FILE__ "(" << __LINE__ << "): "
+				<< "Process " << rank << ": wrong data in cell " << cell.id
+				<< ": " << cell.data->id
+				<< endl;
+			abort();
+		}
+	}
+
+	const uint64_t local_cells = grid.get_cells().size();
+	if (iterated_cells != local_cells) {
+		cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Process " << rank << ": iterated over " << iterated_cells
+			<< " local cells instead of " << local_cells
+			<< endl;
+		abort();
+	}
+
+	uint64_t loaded_cells = 0;
+	MPI_Allreduce(&local_cells, &loaded_cells, 1, MPI_UINT64_T, MPI_SUM, comm);
+	if (loaded_cells != saved_cells) {
+		cerr << __FILE__ "(" << __LINE__ << "): "
+			<< "Process " << rank << ": loaded " << loaded_cells
+			<< " cells but saved " << saved_cells
+			<< endl;
+		abort();
+	}
+
+	double start_time = started - before, total_time = after - before;
+	MPI_Allreduce(MPI_IN_PLACE, &start_time, 1, MPI_DOUBLE, MPI_MAX, comm);
+	MPI_Allreduce(MPI_IN_PLACE, &total_time, 1, MPI_DOUBLE, MPI_MAX, comm);
+	if (rank == 0) {
+		cout << comm_size << " processes loaded " << loaded_cells
+			<< " cells reading at most " << max_cells_per_read
+			<< " cells at a time, start_loading_grid_data(): " << start_time
+			<< " s, total: " << total_time << " s"
+			<< endl;
+	}
+
+	MPI_Finalize();
+
+	return EXIT_SUCCESS;
+}